@@ -14,11 +14,17 @@
 
 #include <gnome-software.h>
 
+#include <gs-app-cache.h>
 #include <gs-app-list-private.h>
 #include <gs-app-private.h>
 #include <gs-category-private.h>
+#include <gs-download-scheduler.h>
 #include <gs-fedora-third-party.h>
+#include <gs-glob-set.h>
+#include <gs-job-scheduler.h>
 #include <gs-os-release.h>
 #include <gs-plugin-loader.h>
 #include <gs-plugin-loader-sync.h>
 #include <gs-plugin-private.h>
+#include <gs-results-cache.h>
+#include <gs-search-matcher.h>
@@ -25,6 +25,7 @@
 #include <gs-icon.h>
 #include <gs-icon-downloader.h>
 #include <gs-metered.h>
+#include <gs-metrics.h>
 #include <gs-odrs-provider.h>
 #include <gs-os-release.h>
 #include <gs-plugin.h>
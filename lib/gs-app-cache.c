@@ -0,0 +1,682 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Software contributors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/**
+ * SECTION:gs-app-cache
+ * @short_description: A size-bounded, thread-safe cache of apps
+ *
+ * #GsAppCache maps string keys (typically data IDs) to #GsApps. It is what
+ * backs the per-plugin cache, gs_plugin_cache_lookup() and friends.
+ *
+ * If a maximum size is set, apps are evicted once the cache grows past it,
+ * using the CLOCK (second chance) algorithm: each lookup marks the app as
+ * recently used, and when an app needs to be evicted the oldest entries are
+ * visited in turn, clearing the mark on those which have one and evicting
+ * the first which doesn’t. This approximates least-recently-used eviction,
+ * but lookups don’t have to reorder anything.
+ *
+ * Some apps are never evicted, so the cache can exceed its maximum size:
+ * installed apps and apps with operations in progress, as plugins rely on
+ * finding those again, and apps which are referenced from outside the cache,
+ * as evicting them would free no memory and would mean the plugin creates a
+ * second #GsApp for the same app on its next lookup.
+ *
+ * The cache is split into shards by the hash of the key, each with its own
+ * read-write lock, so that threads refining different apps at the same time
+ * rarely wait for each other. Lookups only take a shard’s lock for reading:
+ * marking an app as recently used, and counting the hit or miss, are atomic
+ * operations which don’t modify the shard. Use gs_app_cache_lookup_many() to
+ * look up a batch of keys while locking each shard at most once.
+ *
+ * The size limit applies to the whole cache rather than to each shard, so
+ * that eviction isn’t skewed by an uneven spread of keys. When the cache is
+ * over its limit, the clock hand moves through the shards in turn, locking
+ * one at a time.
+ *
+ * The numbers of hits, misses and evictions are counted, and are added to
+ * the `plugin-cache-hits:<name>`, `plugin-cache-misses:<name>` and
+ * `plugin-cache-evictions:<name>` counters in #GsMetrics in batches, so the
+ * metrics lock isn’t taken on every lookup.
+ *
+ * Since: 48
+ */
+
+#include "config.h"
+
+#include <appstream.h>
+
+#include "gs-app-cache.h"
+#include "gs-metrics.h"
+
+/* Must be a power of two. Enough that the worker threads rarely need the
+ * same shard at once, without making whole-cache operations slow. */
+#define N_SHARDS 16
+
+/* How many lookups to count in a shard before adding them to the metrics. */
+#define METRICS_FLUSH_INTERVAL 256
+
+typedef struct {
+	gchar		*key;		/* (owned) */
+	GsApp		*app;		/* (owned) */
+	gint		 referenced;	/* (atomic) */
+	GList		 link;		/* in CacheShard.clock, data points to this */
+} CacheEntry;
+
+typedef struct {
+	GRWLock		 lock;
+	GHashTable	*entries;	/* (owned) key → (owned) CacheEntry */
+	GQueue		 clock;		/* oldest entry at the head */
+
+	/* all (atomic), as they’re updated with only a reader lock held */
+	gsize		 n_hits;
+	gsize		 n_misses;
+	gsize		 n_evictions;
+	gint		 unflushed_lookups;
+	gint		 unflushed_hits;
+	gint		 unflushed_misses;
+	gint		 unflushed_evictions;
+} CacheShard;
+
+struct _GsAppCache {
+	CacheShard	 shards[N_SHARDS];
+	gint		 size;		/* (atomic) total entries in all shards */
+	gint		 max_size;	/* (atomic) 0 means unbounded */
+	guint		 clock_shard;	/* (atomic) shard the clock hand is in */
+
+	GMutex		 name_mutex;
+	gchar		*name;		/* (owned) (nullable) (locked-by name_mutex) */
+};
+
+static CacheEntry *
+cache_entry_new (const gchar *key,
+		 GsApp       *app)
+{
+	CacheEntry *entry = g_new0 (CacheEntry, 1);
+
+	entry->key = g_strdup (key);
+	entry->app = g_object_ref (app);
+	entry->link.data = entry;
+
+	return entry;
+}
+
+static void
+cache_entry_free (CacheEntry *entry)
+{
+	g_free (entry->key);
+	g_clear_object (&entry->app);
+	g_free (entry);
+}
+
+static CacheShard *
+get_shard (GsAppCache  *cache,
+	   const gchar *key)
+{
+	/* the same hash as the shards’ hash tables, so that keys which are
+	 * equal despite wildcards end up in the same shard */
+	guint hash = as_utils_data_id_hash (key);
+	return &cache->shards[hash & (N_SHARDS - 1)];
+}
+
+static void
+flush_metrics (GsAppCache *cache,
+	       CacheShard *shard)
+{
+	g_autofree gchar *name = NULL;
+	struct {
+		const gchar *prefix;
+		gint value;
+	} counters[] = {
+		{ "plugin-cache-hits", g_atomic_int_exchange (&shard->unflushed_hits, 0) },
+		{ "plugin-cache-misses", g_atomic_int_exchange (&shard->unflushed_misses, 0) },
+		{ "plugin-cache-evictions", g_atomic_int_exchange (&shard->unflushed_evictions, 0) },
+	};
+
+	g_mutex_lock (&cache->name_mutex);
+	name = g_strdup (cache->name);
+	g_mutex_unlock (&cache->name_mutex);
+
+	if (name == NULL)
+		return;
+
+	for (gsize i = 0; i < G_N_ELEMENTS (counters); i++) {
+		g_autofree gchar *counter_name = NULL;
+
+		if (counters[i].value == 0)
+			continue;
+		counter_name = g_strdup_printf ("%s:%s", counters[i].prefix, name);
+		gs_metrics_increment_counter (counter_name, counters[i].value);
+	}
+}
+
+/* Count a lookup. Must not be called with a shard lock held, as it may take
+ * the metrics lock. */
+static void
+count_lookup (GsAppCache *cache,
+	      CacheShard *shard,
+	      gboolean    hit)
+{
+	if (hit) {
+		g_atomic_pointer_add (&shard->n_hits, 1);
+		g_atomic_int_inc (&shard->unflushed_hits);
+	} else {
+		g_atomic_pointer_add (&shard->n_misses, 1);
+		g_atomic_int_inc (&shard->unflushed_misses);
+	}
+
+	if (g_atomic_int_add (&shard->unflushed_lookups, 1) + 1 == METRICS_FLUSH_INTERVAL) {
+		g_atomic_int_set (&shard->unflushed_lookups, 0);
+		flush_metrics (cache, shard);
+	}
+}
+
+static gboolean
+is_evictable (GsApp *app)
+{
+	/* apps which are shown or being operated on elsewhere */
+	if (G_OBJECT (app)->ref_count > 1)
+		return FALSE;
+
+	switch (gs_app_get_state (app)) {
+	case GS_APP_STATE_INSTALLED:
+	case GS_APP_STATE_UPDATABLE:
+	case GS_APP_STATE_UPDATABLE_LIVE:
+	case GS_APP_STATE_INSTALLING:
+	case GS_APP_STATE_REMOVING:
+	case GS_APP_STATE_DOWNLOADING:
+	case GS_APP_STATE_QUEUED_FOR_INSTALL:
+	case GS_APP_STATE_PENDING_INSTALL:
+	case GS_APP_STATE_PENDING_REMOVE:
+		return FALSE;
+	default:
+		return TRUE;
+	}
+}
+
+/* Called with the shard’s writer lock held. Removes @entry from the shard and
+ * returns it, so it can be freed once the lock is released. */
+static CacheEntry *
+steal_entry (GsAppCache *cache,
+	     CacheShard *shard,
+	     CacheEntry *entry)
+{
+	g_hash_table_steal (shard->entries, entry->key);
+	g_queue_unlink (&shard->clock, &entry->link);
+	g_atomic_int_add (&cache->size, -1);
+	return entry;
+}
+
+static gboolean
+is_over_max_size (GsAppCache *cache)
+{
+	gint max_size = g_atomic_int_get (&cache->max_size);
+	return max_size > 0 && g_atomic_int_get (&cache->size) > max_size;
+}
+
+/* Called with the shard’s writer lock held. Visits each entry in the shard
+ * once, from the oldest, until the cache is within its maximum size: clears
+ * the referenced mark of entries which have one, and evicts the first which
+ * don’t and can be evicted, appending them to @evicted. */
+static void
+sweep_shard (GsAppCache *cache,
+	     CacheShard *shard,
+	     GPtrArray  *evicted)
+{
+	guint n_visits = shard->clock.length;
+
+	while (n_visits-- > 0 && is_over_max_size (cache)) {
+		GList *link = g_queue_pop_head_link (&shard->clock);
+		CacheEntry *entry = link->data;
+
+		if (g_atomic_int_compare_and_exchange (&entry->referenced, TRUE, FALSE) ||
+		    !is_evictable (entry->app)) {
+			g_queue_push_tail_link (&shard->clock, link);
+			continue;
+		}
+
+		g_hash_table_steal (shard->entries, entry->key);
+		g_atomic_int_add (&cache->size, -1);
+		g_ptr_array_add (evicted, entry);
+		g_atomic_pointer_add (&shard->n_evictions, 1);
+		g_atomic_int_inc (&shard->unflushed_evictions);
+	}
+}
+
+/* Must be called without any shard lock held. Moves the clock hand through the
+ * shards until the cache is within its maximum size. Two passes are needed, as
+ * the first may only clear the referenced marks. Some apps can’t be evicted,
+ * so this may give up before the cache is small enough. */
+static void
+evict_entries (GsAppCache *cache)
+{
+	g_autoptr(GPtrArray) evicted = NULL;
+
+	if (!is_over_max_size (cache))
+		return;
+
+	evicted = g_ptr_array_new_with_free_func ((GDestroyNotify) cache_entry_free);
+	for (guint i = 0; i < 2 * N_SHARDS && is_over_max_size (cache); i++) {
+		guint shard_index = g_atomic_int_add (&cache->clock_shard, 1) & (N_SHARDS - 1);
+		CacheShard *shard = &cache->shards[shard_index];
+
+		g_rw_lock_writer_lock (&shard->lock);
+		sweep_shard (cache, shard, evicted);
+		g_rw_lock_writer_unlock (&shard->lock);
+	}
+
+	/* the evicted entries are freed here, with no lock held */
+}
+
+/**
+ * gs_app_cache_new:
+ *
+ * Create a new, empty and unbounded #GsAppCache.
+ *
+ * Returns: (transfer full): a new #GsAppCache
+ *
+ * Since: 48
+ */
+GsAppCache *
+gs_app_cache_new (void)
+{
+	GsAppCache *cache = g_new0 (GsAppCache, 1);
+
+	for (gsize i = 0; i < N_SHARDS; i++) {
+		CacheShard *shard = &cache->shards[i];
+
+		g_rw_lock_init (&shard->lock);
+		shard->entries = g_hash_table_new_full ((GHashFunc) as_utils_data_id_hash,
+							(GEqualFunc) as_utils_data_id_equal,
+							NULL,
+							(GDestroyNotify) cache_entry_free);
+		g_queue_init (&shard->clock);
+	}
+	g_mutex_init (&cache->name_mutex);
+
+	return cache;
+}
+
+/**
+ * gs_app_cache_free:
+ * @cache: (transfer full): a #GsAppCache
+ *
+ * Free @cache and drop its references to the cached apps.
+ *
+ * Since: 48
+ */
+void
+gs_app_cache_free (GsAppCache *cache)
+{
+	for (gsize i = 0; i < N_SHARDS; i++) {
+		CacheShard *shard = &cache->shards[i];
+
+		flush_metrics (cache, shard);
+
+		/* the entries own the queue links */
+		g_queue_init (&shard->clock);
+		g_hash_table_unref (shard->entries);
+		g_rw_lock_clear (&shard->lock);
+	}
+	g_free (cache->name);
+	g_mutex_clear (&cache->name_mutex);
+	g_free (cache);
+}
+
+/**
+ * gs_app_cache_set_name:
+ * @cache: a #GsAppCache
+ * @name: (nullable): name to use in the metrics counters, or %NULL to not
+ *   count them in the metrics
+ *
+ * Set the name used for the cache’s counters in #GsMetrics.
+ *
+ * Since: 48
+ */
+void
+gs_app_cache_set_name (GsAppCache  *cache,
+		       const gchar *name)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&cache->name_mutex);
+
+	g_free (cache->name);
+	cache->name = g_strdup (name);
+}
+
+/**
+ * gs_app_cache_set_max_size:
+ * @cache: a #GsAppCache
+ * @max_size: the number of apps to keep, or 0 for no limit
+ *
+ * Set how many apps the cache may hold before it starts evicting them. Apps
+ * which can’t be evicted are not limited.
+ *
+ * If the cache is already larger than @max_size, apps are evicted now.
+ *
+ * Since: 48
+ */
+void
+gs_app_cache_set_max_size (GsAppCache *cache,
+			   guint       max_size)
+{
+	g_return_if_fail (max_size <= G_MAXINT);
+
+	g_atomic_int_set (&cache->max_size, max_size);
+	evict_entries (cache);
+}
+
+/**
+ * gs_app_cache_get_max_size:
+ * @cache: a #GsAppCache
+ *
+ * Get the maximum size set with gs_app_cache_set_max_size().
+ *
+ * Returns: the maximum number of apps, or 0 if there is no limit
+ *
+ * Since: 48
+ */
+guint
+gs_app_cache_get_max_size (GsAppCache *cache)
+{
+	return g_atomic_int_get (&cache->max_size);
+}
+
+/**
+ * gs_app_cache_get_size:
+ * @cache: a #GsAppCache
+ *
+ * Get the number of apps in the cache.
+ *
+ * Returns: the number of cached apps
+ *
+ * Since: 48
+ */
+guint
+gs_app_cache_get_size (GsAppCache *cache)
+{
+	return g_atomic_int_get (&cache->size);
+}
+
+/**
+ * gs_app_cache_get_stats:
+ * @cache: a #GsAppCache
+ * @out_hits: (out) (optional): return location for the number of lookups
+ *   which found an app
+ * @out_misses: (out) (optional): return location for the number of lookups
+ *   which didn’t
+ * @out_evictions: (out) (optional): return location for the number of apps
+ *   evicted to keep the cache within its maximum size
+ *
+ * Get the counts of what the cache has done since it was created.
+ *
+ * Since: 48
+ */
+void
+gs_app_cache_get_stats (GsAppCache *cache,
+			guint64    *out_hits,
+			guint64    *out_misses,
+			guint64    *out_evictions)
+{
+	guint64 hits = 0, misses = 0, evictions = 0;
+
+	for (gsize i = 0; i < N_SHARDS; i++) {
+		CacheShard *shard = &cache->shards[i];
+
+		hits += (gsize) g_atomic_pointer_get (&shard->n_hits);
+		misses += (gsize) g_atomic_pointer_get (&shard->n_misses);
+		evictions += (gsize) g_atomic_pointer_get (&shard->n_evictions);
+	}
+
+	if (out_hits != NULL)
+		*out_hits = hits;
+	if (out_misses != NULL)
+		*out_misses = misses;
+	if (out_evictions != NULL)
+		*out_evictions = evictions;
+}
+
+/* Called with the shard’s lock held for reading or writing. */
+static GsApp *
+lookup_in_shard (CacheShard  *shard,
+		 const gchar *key)
+{
+	CacheEntry *entry = g_hash_table_lookup (shard->entries, key);
+
+	if (entry == NULL)
+		return NULL;
+
+	g_atomic_int_set (&entry->referenced, TRUE);
+	return g_object_ref (entry->app);
+}
+
+/**
+ * gs_app_cache_lookup:
+ * @cache: a #GsAppCache
+ * @key: the key to look up
+ *
+ * Look up the app cached under @key, and mark it as recently used.
+ *
+ * Returns: (transfer full) (nullable): the #GsApp, or %NULL
+ *
+ * Since: 48
+ */
+GsApp *
+gs_app_cache_lookup (GsAppCache  *cache,
+		     const gchar *key)
+{
+	CacheShard *shard;
+	GsApp *app;
+
+	g_return_val_if_fail (key != NULL, NULL);
+
+	shard = get_shard (cache, key);
+	g_rw_lock_reader_lock (&shard->lock);
+	app = lookup_in_shard (shard, key);
+	g_rw_lock_reader_unlock (&shard->lock);
+
+	count_lookup (cache, shard, app != NULL);
+
+	return app;
+}
+
+/**
+ * gs_app_cache_lookup_many:
+ * @cache: a #GsAppCache
+ * @keys: (array length=n_keys): the keys to look up
+ * @n_keys: the number of keys
+ * @out_apps: (out caller-allocates) (array length=n_keys) (transfer full):
+ *   return location for the app cached under each key, or %NULL for the keys
+ *   which aren’t cached
+ *
+ * Look up several keys at once, like calling gs_app_cache_lookup() for each of
+ * them, but locking each shard at most once.
+ *
+ * Returns: the number of keys which were found
+ *
+ * Since: 48
+ */
+guint
+gs_app_cache_lookup_many (GsAppCache   *cache,
+			  const gchar **keys,
+			  gsize         n_keys,
+			  GsApp       **out_apps)
+{
+	g_autofree guint8 *key_shards = NULL;
+	guint n_found = 0;
+
+	g_return_val_if_fail (keys != NULL || n_keys == 0, 0);
+	g_return_val_if_fail (out_apps != NULL || n_keys == 0, 0);
+
+	/* group the keys by shard, so each shard is visited once */
+	key_shards = g_new (guint8, n_keys);
+	for (gsize i = 0; i < n_keys; i++) {
+		key_shards[i] = get_shard (cache, keys[i]) - cache->shards;
+		out_apps[i] = NULL;
+	}
+
+	for (gsize s = 0; s < N_SHARDS; s++) {
+		CacheShard *shard = &cache->shards[s];
+		gboolean locked = FALSE;
+
+		for (gsize i = 0; i < n_keys; i++) {
+			if (key_shards[i] != s)
+				continue;
+			if (!locked) {
+				g_rw_lock_reader_lock (&shard->lock);
+				locked = TRUE;
+			}
+			out_apps[i] = lookup_in_shard (shard, keys[i]);
+		}
+
+		if (locked)
+			g_rw_lock_reader_unlock (&shard->lock);
+	}
+
+	for (gsize i = 0; i < n_keys; i++) {
+		count_lookup (cache, &cache->shards[key_shards[i]], out_apps[i] != NULL);
+		if (out_apps[i] != NULL)
+			n_found++;
+	}
+
+	return n_found;
+}
+
+/**
+ * gs_app_cache_add:
+ * @cache: a #GsAppCache
+ * @key: the key to cache @app under
+ * @app: a #GsApp
+ *
+ * Add @app to the cache, replacing any app already cached under @key. This
+ * may evict other apps.
+ *
+ * Since: 48
+ */
+void
+gs_app_cache_add (GsAppCache  *cache,
+		  const gchar *key,
+		  GsApp       *app)
+{
+	CacheShard *shard;
+	CacheEntry *entry;
+	CacheEntry *replaced = NULL;
+
+	g_return_if_fail (key != NULL);
+	g_return_if_fail (GS_IS_APP (app));
+
+	shard = get_shard (cache, key);
+	g_rw_lock_writer_lock (&shard->lock);
+
+	entry = g_hash_table_lookup (shard->entries, key);
+	if (entry != NULL && entry->app == app) {
+		g_rw_lock_writer_unlock (&shard->lock);
+		return;
+	}
+	if (entry != NULL)
+		replaced = steal_entry (cache, shard, entry);
+
+	entry = cache_entry_new (key, app);
+	g_hash_table_insert (shard->entries, entry->key, entry);
+	g_queue_push_tail_link (&shard->clock, &entry->link);
+	g_atomic_int_inc (&cache->size);
+
+	g_rw_lock_writer_unlock (&shard->lock);
+
+	g_clear_pointer (&replaced, cache_entry_free);
+	evict_entries (cache);
+}
+
+/**
+ * gs_app_cache_remove:
+ * @cache: a #GsAppCache
+ * @key: the key to remove
+ *
+ * Remove the app cached under @key, if there is one.
+ *
+ * Since: 48
+ */
+void
+gs_app_cache_remove (GsAppCache  *cache,
+		     const gchar *key)
+{
+	CacheShard *shard;
+	CacheEntry *entry;
+
+	g_return_if_fail (key != NULL);
+
+	shard = get_shard (cache, key);
+	g_rw_lock_writer_lock (&shard->lock);
+	entry = g_hash_table_lookup (shard->entries, key);
+	if (entry != NULL)
+		steal_entry (cache, shard, entry);
+	g_rw_lock_writer_unlock (&shard->lock);
+
+	g_clear_pointer (&entry, cache_entry_free);
+}
+
+/**
+ * gs_app_cache_clear:
+ * @cache: a #GsAppCache
+ *
+ * Remove all the apps from the cache.
+ *
+ * Since: 48
+ */
+void
+gs_app_cache_clear (GsAppCache *cache)
+{
+	for (gsize i = 0; i < N_SHARDS; i++) {
+		CacheShard *shard = &cache->shards[i];
+		g_autoptr(GHashTable) old_entries = NULL;
+
+		/* swap in a new table, so the apps are freed without the
+		 * lock held */
+		g_rw_lock_writer_lock (&shard->lock);
+		old_entries = g_steal_pointer (&shard->entries);
+		shard->entries = g_hash_table_new_full ((GHashFunc) as_utils_data_id_hash,
+							(GEqualFunc) as_utils_data_id_equal,
+							NULL,
+							(GDestroyNotify) cache_entry_free);
+		g_queue_init (&shard->clock);
+		g_atomic_int_add (&cache->size, -(gint) g_hash_table_size (old_entries));
+		g_rw_lock_writer_unlock (&shard->lock);
+	}
+}
+
+/**
+ * gs_app_cache_foreach:
+ * @cache: a #GsAppCache
+ * @func: function to call for each cached app
+ * @user_data: data to pass to @func
+ *
+ * Call @func for each app in the cache, in no particular order. Each shard of
+ * the cache is locked while @func is called for the apps in it. This doesn’t
+ * count as using the apps.
+ *
+ * Since: 48
+ */
+void
+gs_app_cache_foreach (GsAppCache            *cache,
+		      GsAppCacheForeachFunc  func,
+		      gpointer               user_data)
+{
+	g_return_if_fail (func != NULL);
+
+	for (gsize i = 0; i < N_SHARDS; i++) {
+		CacheShard *shard = &cache->shards[i];
+		GHashTableIter iter;
+		gpointer value;
+
+		g_rw_lock_reader_lock (&shard->lock);
+		g_hash_table_iter_init (&iter, shard->entries);
+		while (g_hash_table_iter_next (&iter, NULL, &value)) {
+			CacheEntry *entry = value;
+			func (entry->key, entry->app, user_data);
+		}
+		g_rw_lock_reader_unlock (&shard->lock);
+	}
+}
@@ -0,0 +1,66 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Software contributors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include "gs-app.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GsAppCache GsAppCache;
+
+/**
+ * GsAppCacheForeachFunc:
+ * @key: the key @app is cached under
+ * @app: a cached #GsApp
+ * @user_data: data passed to gs_app_cache_foreach()
+ *
+ * Callback for gs_app_cache_foreach(). It must not call other #GsAppCache
+ * functions on the same cache.
+ *
+ * Since: 48
+ */
+typedef void (*GsAppCacheForeachFunc) (const gchar *key,
+				       GsApp       *app,
+				       gpointer     user_data);
+
+GsAppCache	*gs_app_cache_new		(void);
+void		 gs_app_cache_free		(GsAppCache		*cache);
+
+void		 gs_app_cache_set_name		(GsAppCache		*cache,
+						 const gchar		*name);
+void		 gs_app_cache_set_max_size	(GsAppCache		*cache,
+						 guint			 max_size);
+guint		 gs_app_cache_get_max_size	(GsAppCache		*cache);
+guint		 gs_app_cache_get_size		(GsAppCache		*cache);
+void		 gs_app_cache_get_stats		(GsAppCache		*cache,
+						 guint64		*out_hits,
+						 guint64		*out_misses,
+						 guint64		*out_evictions);
+
+GsApp		*gs_app_cache_lookup		(GsAppCache		*cache,
+						 const gchar		*key);
+guint		 gs_app_cache_lookup_many	(GsAppCache		*cache,
+						 const gchar		**keys,
+						 gsize			 n_keys,
+						 GsApp			**out_apps);
+void		 gs_app_cache_add		(GsAppCache		*cache,
+						 const gchar		*key,
+						 GsApp			*app);
+void		 gs_app_cache_remove		(GsAppCache		*cache,
+						 const gchar		*key);
+void		 gs_app_cache_clear		(GsAppCache		*cache);
+void		 gs_app_cache_foreach		(GsAppCache		*cache,
+						 GsAppCacheForeachFunc	 func,
+						 gpointer		 user_data);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GsAppCache, gs_app_cache_free)
+
+G_END_DECLS
@@ -40,6 +40,10 @@ void		 gs_app_list_filter_duplicates	(GsAppList	*list,
 void		 gs_app_list_randomize		(GsAppList	*list);
 void		 gs_app_list_truncate		(GsAppList	*list,
 						 guint		 length);
+void		 gs_app_list_sort_top		(GsAppList	*list,
+						 GsAppListSortFunc func,
+						 gpointer	 user_data,
+						 guint		 length);
 gboolean	 gs_app_list_has_flag		(GsAppList	*list,
 						 GsAppListFlags	 flag);
 void		 gs_app_list_add_flag		(GsAppList	*list,
@@ -20,6 +20,7 @@
 #include "config.h"
 
 #include <glib.h>
+#include <string.h>
 
 #include "gs-app-private.h"
 #include "gs-app-list-private.h"
@@ -30,7 +31,12 @@ struct _GsAppList
 {
 	GObject			 parent_instance;
 	GPtrArray		*array;
+	GHashTable		*app_index;	/* (owned) (element-type GsApp GsAppListIndexEntry) */
+	GHashTable		*id_index;	/* (owned) (element-type utf8 GPtrArray) */
+	GPtrArray		*unindexed;	/* (owned) (element-type GsApp) */
 	GMutex			 mutex;
+	GMutex			 moved_mutex;	/* lock order: after the app mutex */
+	GPtrArray		*moved;		/* (owned) (element-type GsApp) (mutex moved_mutex) apps whose ID changed */
 	guint			 size_peak;
 	GsAppListFlags		 flags;
 	GsAppState		 state;
@@ -53,6 +59,230 @@ enum {
 
 static guint signals [SIGNAL_LAST] = { 0 };
 
+/* The apps in the list are indexed by pointer, so checking whether an app is
+ * already in the list is O(1), and by the ID part of their unique ID, so
+ * looking up a unique ID only has to check the apps with the same ID.
+ *
+ * The ID is taken when an app is first added. Apps which don’t have an ID yet
+ * (for example, because it’s lazy-loaded), or have a wildcard one, are kept in
+ * @unindexed, which is always checked, and are moved into @id_index once an
+ * ID is found for them. Apps can also be given a different ID while they’re
+ * in the list: each app in the list has an ID watch which queues it in
+ * @moved, and only those apps are indexed again before the next lookup. The
+ * origin and branch aren’t part of the key, so changes to them don’t matter
+ * here. */
+typedef struct {
+	guint			 n_refs;	/* number of times the app is in the array */
+	gchar			*key;		/* (owned) (nullable) key in @id_index */
+} GsAppListIndexEntry;
+
+static void
+gs_app_list_index_entry_free (GsAppListIndexEntry *entry)
+{
+	g_free (entry->key);
+	g_free (entry);
+}
+
+/* Returns the ID part of @unique_id, or %NULL if it’s a wildcard or
+ * @unique_id is not in the usual format */
+static gchar *
+gs_app_list_get_index_key (const gchar *unique_id)
+{
+	const gchar *start = unique_id;
+	const gchar *end;
+
+	if (unique_id == NULL)
+		return NULL;
+	for (guint i = 0; i < 3; i++) {
+		start = strchr (start, '/');
+		if (start == NULL)
+			return NULL;
+		start++;
+	}
+	end = strchr (start, '/');
+	if (end == NULL || strchr (end + 1, '/') != NULL)
+		return NULL;
+	if (end == start || (end - start == 1 && *start == '*'))
+		return NULL;
+	return g_strndup (start, end - start);
+}
+
+static void
+gs_app_list_indices_add_key (GsAppList *list, GsApp *app, const gchar *key)
+{
+	GPtrArray *apps = g_hash_table_lookup (list->id_index, key);
+	if (apps == NULL) {
+		apps = g_ptr_array_new ();
+		g_hash_table_insert (list->id_index, g_strdup (key), apps);
+	}
+	g_ptr_array_add (apps, app);
+}
+
+static void
+gs_app_list_indices_link (GsAppList *list, GsApp *app, GsAppListIndexEntry *entry)
+{
+	if (entry->key != NULL)
+		gs_app_list_indices_add_key (list, app, entry->key);
+	else
+		g_ptr_array_add (list->unindexed, app);
+}
+
+static void
+gs_app_list_indices_unlink (GsAppList *list, GsApp *app, GsAppListIndexEntry *entry)
+{
+	if (entry->key != NULL) {
+		GPtrArray *apps = g_hash_table_lookup (list->id_index, entry->key);
+		g_ptr_array_remove_fast (apps, app);
+		if (apps->len == 0)
+			g_hash_table_remove (list->id_index, entry->key);
+	} else {
+		g_ptr_array_remove_fast (list->unindexed, app);
+	}
+}
+
+/* called with the lock of @app held, so this can only queue it */
+static void
+gs_app_list_app_id_changed_cb (GsApp *app, gpointer user_data)
+{
+	GsAppList *list = GS_APP_LIST (user_data);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&list->moved_mutex);
+
+	g_ptr_array_add (list->moved, app);
+}
+
+/* mutex must be held */
+static void
+gs_app_list_indices_add (GsAppList *list, GsApp *app)
+{
+	GsAppListIndexEntry *entry = g_hash_table_lookup (list->app_index, app);
+
+	if (entry != NULL) {
+		entry->n_refs++;
+		return;
+	}
+
+	entry = g_new0 (GsAppListIndexEntry, 1);
+	entry->n_refs = 1;
+	entry->key = gs_app_list_get_index_key (gs_app_get_unique_id (app));
+	g_hash_table_insert (list->app_index, app, entry);
+	gs_app_list_indices_link (list, app, entry);
+	gs_app_add_id_watch (app, gs_app_list_app_id_changed_cb, list);
+}
+
+/* mutex must be held */
+static void
+gs_app_list_indices_remove (GsAppList *list, GsApp *app)
+{
+	GsAppListIndexEntry *entry = g_hash_table_lookup (list->app_index, app);
+
+	if (entry == NULL)
+		return;
+	if (--entry->n_refs > 0)
+		return;
+
+	gs_app_remove_id_watch (app, gs_app_list_app_id_changed_cb, list);
+	gs_app_list_indices_unlink (list, app, entry);
+	g_hash_table_remove (list->app_index, app);
+}
+
+/* mutex must be held */
+static void
+gs_app_list_indices_clear (GsAppList *list)
+{
+	GHashTableIter iter;
+	gpointer app;
+
+	g_hash_table_iter_init (&iter, list->app_index);
+	while (g_hash_table_iter_next (&iter, &app, NULL))
+		gs_app_remove_id_watch (app, gs_app_list_app_id_changed_cb, list);
+
+	g_hash_table_remove_all (list->app_index);
+	g_hash_table_remove_all (list->id_index);
+	g_ptr_array_set_size (list->unindexed, 0);
+}
+
+/* Move any apps which have gained an ID since they were added into
+ * @id_index; mutex must be held */
+static void
+gs_app_list_indices_update_unindexed (GsAppList *list)
+{
+	for (guint i = 0; i < list->unindexed->len; ) {
+		GsApp *app = g_ptr_array_index (list->unindexed, i);
+		g_autofree gchar *key = gs_app_list_get_index_key (gs_app_get_unique_id (app));
+		GsAppListIndexEntry *entry;
+
+		if (key == NULL) {
+			i++;
+			continue;
+		}
+
+		entry = g_hash_table_lookup (list->app_index, app);
+		entry->key = g_steal_pointer (&key);
+		gs_app_list_indices_add_key (list, app, entry->key);
+		g_ptr_array_remove_index_fast (list->unindexed, i);
+	}
+}
+
+/* Move any apps whose ID has changed since they were indexed to the right
+ * place in the index; mutex must be held */
+static void
+gs_app_list_indices_update_moved (GsAppList *list)
+{
+	g_autoptr(GPtrArray) moved = NULL;
+
+	/* don’t hold @moved_mutex while locking the apps */
+	{
+		g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&list->moved_mutex);
+		if (list->moved->len == 0)
+			return;
+		moved = g_steal_pointer (&list->moved);
+		list->moved = g_ptr_array_new ();
+	}
+
+	for (guint i = 0; i < moved->len; i++) {
+		GsApp *app = g_ptr_array_index (moved, i);
+		GsAppListIndexEntry *entry = g_hash_table_lookup (list->app_index, app);
+		g_autofree gchar *key = NULL;
+
+		/* removed since */
+		if (entry == NULL)
+			continue;
+
+		key = gs_app_list_get_index_key (gs_app_get_unique_id (app));
+		if (g_strcmp0 (key, entry->key) == 0)
+			continue;
+
+		gs_app_list_indices_unlink (list, app, entry);
+		g_free (entry->key);
+		entry->key = g_steal_pointer (&key);
+		gs_app_list_indices_link (list, app, entry);
+	}
+}
+
+/* Returns (transfer container) the apps which may have a unique ID matching
+ * @unique_id, or %NULL if all the apps have to be checked; mutex must be held */
+static GPtrArray *
+gs_app_list_indices_get_candidates (GsAppList *list, const gchar *unique_id)
+{
+	g_autofree gchar *key = gs_app_list_get_index_key (unique_id);
+	GPtrArray *apps;
+	GPtrArray *candidates;
+
+	if (key == NULL)
+		return NULL;
+
+	gs_app_list_indices_update_moved (list);
+	gs_app_list_indices_update_unindexed (list);
+
+	candidates = g_ptr_array_new ();
+	apps = g_hash_table_lookup (list->id_index, key);
+	if (apps != NULL)
+		g_ptr_array_extend (candidates, apps, NULL, NULL);
+	g_ptr_array_extend (candidates, list->unindexed, NULL, NULL);
+
+	return candidates;
+}
+
 /**
  * gs_app_list_get_state:
  * @list: A #GsAppList
@@ -165,6 +395,13 @@ static GPtrArray *
 gs_app_list_get_watched (GsAppList *list)
 {
 	GPtrArray *apps = g_ptr_array_new ();
+
+	/* avoid iterating over the list if nothing can be watched */
+	if ((list->flags & (GS_APP_LIST_FLAG_WATCH_APPS |
+			    GS_APP_LIST_FLAG_WATCH_APPS_ADDONS |
+			    GS_APP_LIST_FLAG_WATCH_APPS_RELATED)) == 0)
+		return apps;
+
 	for (guint i = 0; i < list->array->len; i++) {
 		GsApp *app_tmp = g_ptr_array_index (list->array, i);
 		gs_app_list_add_watched_for_app (list, apps, app_tmp);
@@ -303,6 +540,26 @@ gs_app_list_set_size_peak (GsAppList *list,
 static GsApp *
 gs_app_list_lookup_safe (GsAppList *list, const gchar *unique_id)
 {
+	g_autoptr(GPtrArray) candidates = gs_app_list_indices_get_candidates (list, unique_id);
+
+	if (candidates != NULL) {
+		GsApp *found = NULL;
+		guint n_found = 0;
+
+		for (guint i = 0; i < candidates->len && n_found < 2; i++) {
+			GsApp *app = g_ptr_array_index (candidates, i);
+			if (as_utils_data_id_equal (gs_app_get_unique_id (app), unique_id)) {
+				found = app;
+				n_found++;
+			}
+		}
+
+		/* if several apps match, the first one in the list is needed,
+		 * so fall back to checking them in order */
+		if (n_found < 2)
+			return found;
+	}
+
 	for (guint i = 0; i < list->array->len; i++) {
 		GsApp *app = g_ptr_array_index (list->array, i);
 		if (as_utils_data_id_equal (gs_app_get_unique_id (app), unique_id))
@@ -380,8 +637,11 @@ gs_app_list_check_for_duplicate (GsAppList *list, GsApp *app)
 
 	/* adding a wildcard */
 	if (gs_app_has_quirk (app, GS_APP_QUIRK_IS_WILDCARD)) {
-		for (guint i = 0; i < list->array->len; i++) {
-			GsApp *app_tmp = g_ptr_array_index (list->array, i);
+		g_autoptr(GPtrArray) candidates = gs_app_list_indices_get_candidates (list, gs_app_get_unique_id (app));
+		GPtrArray *apps = (candidates != NULL) ? candidates : list->array;
+
+		for (guint i = 0; i < apps->len; i++) {
+			GsApp *app_tmp = g_ptr_array_index (apps, i);
 			if (!gs_app_has_quirk (app_tmp, GS_APP_QUIRK_IS_WILDCARD))
 				continue;
 			/* not adding exactly the same wildcard */
@@ -392,11 +652,8 @@ gs_app_list_check_for_duplicate (GsAppList *list, GsApp *app)
 		return TRUE;
 	}
 
-	for (guint i = 0; i < list->array->len; i++) {
-		GsApp *app_tmp = g_ptr_array_index (list->array, i);
-		if (app_tmp == app)
-			return FALSE;
-	}
+	if (g_hash_table_contains (list->app_index, app))
+		return FALSE;
 
 	/* does not exist */
 	id = gs_app_get_unique_id (app);
@@ -433,6 +690,7 @@ gs_app_list_add_safe (GsAppList *list, GsApp *app, GsAppListAddFlag flag)
 	/* just use the ref */
 	gs_app_list_maybe_watch_app (list, app);
 	g_ptr_array_add (list->array, g_object_ref (app));
+	gs_app_list_indices_add (list, app);
 
 	/* update the historical max */
 	if (list->array->len > list->size_peak)
@@ -489,6 +747,10 @@ gs_app_list_remove (GsAppList *list, GsApp *app)
 	g_return_val_if_fail (GS_IS_APP (app), FALSE);
 
 	locker = g_mutex_locker_new (&list->mutex);
+	if (!g_hash_table_contains (list->app_index, app))
+		return FALSE;
+
+	gs_app_list_indices_remove (list, app);
 	removed = g_ptr_array_remove (list->array, app);
 	if (removed) {
 		gs_app_list_maybe_unwatch_app (list, app);
@@ -533,6 +795,40 @@ gs_app_list_add_list (GsAppList *list, GsAppList *donor)
 	gs_app_list_invalidate_progress (list);
 }
 
+/**
+ * gs_app_list_add_many:
+ * @list: A #GsAppList
+ * @apps: (array length=n_apps): apps to add
+ * @n_apps: number of apps in @apps
+ *
+ * Adds each of @apps to @list, as if with gs_app_list_add(), but only
+ * recalculates the state and progress of the list once.
+ *
+ * Since: 48
+ **/
+void
+gs_app_list_add_many (GsAppList    *list,
+		      GsApp * const *apps,
+		      guint         n_apps)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (GS_IS_APP_LIST (list));
+	g_return_if_fail (apps != NULL || n_apps == 0);
+
+	for (guint i = 0; i < n_apps; i++)
+		g_return_if_fail (GS_IS_APP (apps[i]));
+
+	locker = g_mutex_locker_new (&list->mutex);
+
+	for (guint i = 0; i < n_apps; i++)
+		gs_app_list_add_safe (list, apps[i], GS_APP_LIST_ADD_FLAG_CHECK_FOR_DUPE);
+
+	/* recalculate global state */
+	gs_app_list_invalidate_state (list);
+	gs_app_list_invalidate_progress (list);
+}
+
 /**
  * gs_app_list_index:
  * @list: A #GsAppList
@@ -575,6 +871,7 @@ gs_app_list_remove_all_safe (GsAppList *list)
 		gs_app_list_maybe_unwatch_app (list, app);
 	}
 	g_ptr_array_set_size (list->array, 0);
+	gs_app_list_indices_clear (list);
 	gs_app_list_invalidate_state (list);
 	gs_app_list_invalidate_progress (list);
 }
@@ -667,6 +964,134 @@ gs_app_list_sort (GsAppList *list, GsAppListSortFunc func, gpointer user_data)
 	g_ptr_array_sort_with_data (list->array, gs_app_list_sort_cb, &helper);
 }
 
+/* an app along with its position in the list before sorting, so that apps
+ * which @func ranks equally keep their order, as with gs_app_list_sort() */
+typedef struct {
+	GsApp		*app;  /* (unowned) */
+	guint		 position;
+} GsAppListRanked;
+
+static gint
+gs_app_list_ranked_cmp (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	const GsAppListRanked *ranked1 = *(const GsAppListRanked **) a;
+	const GsAppListRanked *ranked2 = *(const GsAppListRanked **) b;
+	const GsAppListSortHelper *helper = (GsAppListSortHelper *) user_data;
+	gint rc = helper->func (ranked1->app, ranked2->app, helper->user_data);
+
+	if (rc != 0)
+		return rc;
+	return (ranked1->position < ranked2->position) ? -1 : (ranked1->position > ranked2->position);
+}
+
+/* move the entry at @i down the max-heap in heap[0, @len) until it is no
+ * better than its children */
+static void
+gs_app_list_heap_sift_down (gpointer                   *heap,
+                            guint                       len,
+                            guint                       i,
+                            const GsAppListSortHelper  *helper)
+{
+	while (TRUE) {
+		guint worst = i;
+		guint left = 2 * i + 1;
+		guint right = 2 * i + 2;
+		gpointer tmp;
+
+		if (left < len && gs_app_list_ranked_cmp (&heap[left], &heap[worst], (gpointer) helper) > 0)
+			worst = left;
+		if (right < len && gs_app_list_ranked_cmp (&heap[right], &heap[worst], (gpointer) helper) > 0)
+			worst = right;
+		if (worst == i)
+			return;
+
+		tmp = heap[i];
+		heap[i] = heap[worst];
+		heap[worst] = tmp;
+		i = worst;
+	}
+}
+
+/**
+ * gs_app_list_sort_top:
+ * @list: A #GsAppList
+ * @func: A #GsAppListSortFunc
+ * @user_data: user data to pass to @func
+ * @length: the maximum length of the list
+ *
+ * Sorts the application list and truncates it to at most @length apps, like
+ * gs_app_list_sort() followed by gs_app_list_truncate(), but without sorting
+ * the apps which will be removed. This selects the first @length apps with a
+ * bounded heap, so takes O(n log @length) rather than O(n log n) time.
+ *
+ * If @length is zero, the whole list is sorted.
+ *
+ * Since: 48
+ **/
+void
+gs_app_list_sort_top (GsAppList         *list,
+                      GsAppListSortFunc  func,
+                      gpointer           user_data,
+                      guint              length)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GPtrArray) heap = NULL;
+	g_autofree GsAppListRanked *ranked = NULL;
+	GsAppListSortHelper helper;
+	gpointer *pdata;
+	guint len;
+
+	g_return_if_fail (GS_IS_APP_LIST (list));
+
+	if (length == 0 || length >= gs_app_list_length (list)) {
+		gs_app_list_sort (list, func, user_data);
+		return;
+	}
+
+	locker = g_mutex_locker_new (&list->mutex);
+	helper.func = func;
+	helper.user_data = user_data;
+	len = list->array->len;
+	ranked = g_new (GsAppListRanked, len);
+	heap = g_ptr_array_sized_new (len);
+	for (guint i = 0; i < len; i++) {
+		ranked[i].app = g_ptr_array_index (list->array, i);
+		ranked[i].position = i;
+		g_ptr_array_add (heap, &ranked[i]);
+	}
+	pdata = heap->pdata;
+
+	/* keep the best @length apps in a max-heap at the start of the array,
+	 * with the worst of them at the root, swapping better apps in; ties
+	 * are broken by position, so the same apps are kept as by sorting */
+	for (guint i = length / 2; i-- > 0;)
+		gs_app_list_heap_sift_down (pdata, length, i, &helper);
+	for (guint i = length; i < len; i++) {
+		if (gs_app_list_ranked_cmp (&pdata[i], &pdata[0], &helper) < 0) {
+			gpointer tmp = pdata[0];
+			pdata[0] = pdata[i];
+			pdata[i] = tmp;
+			gs_app_list_heap_sift_down (pdata, length, 0, &helper);
+		}
+	}
+
+	/* mark this list as unworthy */
+	list->flags |= GS_APP_LIST_FLAG_IS_TRUNCATED;
+
+	/* put the apps back in their new order, with the dropped ones at the
+	 * end to be unreffed */
+	for (guint i = length; i < len; i++) {
+		GsApp *app = ((GsAppListRanked *) pdata[i])->app;
+		list->array->pdata[i] = app;
+		gs_app_list_indices_remove (list, app);
+	}
+	g_ptr_array_set_size (heap, length);
+	g_ptr_array_sort_with_data (heap, gs_app_list_ranked_cmp, &helper);
+	for (guint i = 0; i < length; i++)
+		list->array->pdata[i] = ((GsAppListRanked *) g_ptr_array_index (heap, i))->app;
+	g_ptr_array_set_size (list->array, length);
+}
+
 /**
  * gs_app_list_truncate:
  * @list: A #GsAppList
@@ -696,6 +1121,8 @@ gs_app_list_truncate (GsAppList *list, guint length)
 
 	/* remove the apps in the positions larger than the length */
 	locker = g_mutex_locker_new (&list->mutex);
+	for (guint i = length; i < list->array->len; i++)
+		gs_app_list_indices_remove (list, g_ptr_array_index (list->array, i));
 	g_ptr_array_set_size (list->array, length);
 }
 
@@ -775,7 +1202,8 @@ gs_app_list_filter_app_get_keys (GsApp *app, GsAppListFilterFlags flags)
 	/* use the ID and any provided items */
 	if (flags & GS_APP_LIST_FILTER_FLAG_KEY_ID_PROVIDES) {
 		GPtrArray *provided = gs_app_get_provided (app);
-		g_ptr_array_add (keys, g_strdup (gs_app_get_id (app)));
+		if (gs_app_get_id (app) != NULL)
+			g_ptr_array_add (keys, g_strdup (gs_app_get_id (app)));
 		for (guint i = 0; i < provided->len; i++) {
 			AsProvided *prov = g_ptr_array_index (provided, i);
 			GPtrArray *items;
@@ -945,8 +1373,14 @@ static void
 gs_app_list_finalize (GObject *object)
 {
 	GsAppList *list = GS_APP_LIST (object);
+	gs_app_list_indices_clear (list);
 	g_ptr_array_unref (list->array);
+	g_hash_table_unref (list->app_index);
+	g_hash_table_unref (list->id_index);
+	g_ptr_array_unref (list->unindexed);
+	g_ptr_array_unref (list->moved);
 	g_mutex_clear (&list->mutex);
+	g_mutex_clear (&list->moved_mutex);
 	G_OBJECT_CLASS (gs_app_list_parent_class)->finalize (object);
 }
 
@@ -1001,6 +1435,13 @@ gs_app_list_init (GsAppList *list)
 {
 	g_mutex_init (&list->mutex);
 	list->array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	list->app_index = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+						 NULL, (GDestroyNotify) gs_app_list_index_entry_free);
+	list->id_index = g_hash_table_new_full (g_str_hash, g_str_equal,
+						g_free, (GDestroyNotify) g_ptr_array_unref);
+	list->unindexed = g_ptr_array_new ();
+	g_mutex_init (&list->moved_mutex);
+	list->moved = g_ptr_array_new ();
 	list->custom_progress = GS_APP_PROGRESS_UNKNOWN;
 }
 
@@ -68,6 +68,9 @@ GsAppList	*gs_app_list_new		(void);
 GsAppList	*gs_app_list_copy		(GsAppList	*list);
 void		 gs_app_list_add		(GsAppList	*list,
 						 GsApp		*app);
+void		 gs_app_list_add_many		(GsAppList	*list,
+						 GsApp * const	*apps,
+						 guint		 n_apps);
 void		 gs_app_list_add_list		(GsAppList	*list,
 						 GsAppList	*donor);
 gboolean	 gs_app_list_remove		(GsAppList	*list,
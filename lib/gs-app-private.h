@@ -13,11 +13,76 @@
 
 G_BEGIN_DECLS
 
+/**
+ * GsAppSnapshot:
+ *
+ * An immutable, reference counted copy of the most frequently read properties
+ * of a #GsApp. See gs_app_dup_snapshot().
+ *
+ * Since: 48
+ */
+typedef struct _GsAppSnapshot GsAppSnapshot;
+
+/**
+ * GsAppLazyField:
+ * @GS_APP_LAZY_FIELD_NONE:		No fields
+ * @GS_APP_LAZY_FIELD_DESCRIPTION:	The long description
+ * @GS_APP_LAZY_FIELD_SCREENSHOTS:	The screenshots
+ * @GS_APP_LAZY_FIELD_VERSION_HISTORY:	The version history
+ *
+ * The #GsApp fields which can be filled in on first access by a
+ * #GsAppLazyLoadFunc, rather than when the app is refined.
+ *
+ * Since: 48
+ */
+typedef enum {
+	GS_APP_LAZY_FIELD_NONE			= 0,
+	GS_APP_LAZY_FIELD_DESCRIPTION		= 1 << 0,
+	GS_APP_LAZY_FIELD_SCREENSHOTS		= 1 << 1,
+	GS_APP_LAZY_FIELD_VERSION_HISTORY	= 1 << 2,
+} GsAppLazyField;
+
+/**
+ * GsAppLazyLoadFunc:
+ * @app: a #GsApp
+ * @field: the single #GsAppLazyField to load
+ * @user_data: data passed to gs_app_set_lazy_loader()
+ *
+ * Fills in @field on @app using the normal setters.
+ *
+ * Returns: %FALSE if the data @field was loaded from has since been replaced,
+ *   in which case @app is refined again the next time it is asked for
+ *
+ * Since: 48
+ */
+typedef gboolean (*GsAppLazyLoadFunc)		(GsApp		*app,
+						 GsAppLazyField	 field,
+						 gpointer	 user_data);
+
 void		 gs_app_set_priority		(GsApp		*app,
 						 guint		 priority);
 guint		 gs_app_get_priority		(GsApp		*app);
 void		 gs_app_set_unique_id		(GsApp		*app,
 						 const gchar	*unique_id);
+
+/**
+ * GsAppIdChangedFunc:
+ * @app: a #GsApp
+ * @user_data: data passed to gs_app_add_id_watch()
+ *
+ * Called when the ID of @app changes, with the lock of @app held.
+ *
+ * Since: 48
+ */
+typedef void (*GsAppIdChangedFunc)		(GsApp		*app,
+						 gpointer	 user_data);
+
+void		 gs_app_add_id_watch		(GsApp		*app,
+						 GsAppIdChangedFunc func,
+						 gpointer	 user_data);
+void		 gs_app_remove_id_watch		(GsApp		*app,
+						 GsAppIdChangedFunc func,
+						 gpointer	 user_data);
 void		 gs_app_remove_addon		(GsApp		*app,
 						 GsApp		*addon);
 GCancellable	*gs_app_get_cancellable		(GsApp		*app);
@@ -29,5 +94,41 @@ gint		 gs_app_compare_priority	(GsApp		*app1,
 						 GsApp		*app2);
 void		 gs_app_set_icons_state		(GsApp		*app,
 						 GsAppIconsState icons_state);
+void		 gs_app_add_refined_flags	(GsApp		*app,
+						 GsPluginRefineFlags flags,
+						 gint64		 refine_time);
+GsPluginRefineFlags
+		 gs_app_get_refined_flags	(GsApp		*app,
+						 gint64		 max_age);
+void		 gs_app_invalidate_refined_flags
+						(GsApp		*app);
+void		 gs_app_invalidate_all_refined_flags
+						(void);
+GArray		*gs_app_peek_key_colors		(GsApp		*app);
+void		 gs_app_set_lazy_loader		(GsApp		*app,
+						 GsAppLazyField	 fields,
+						 GsAppLazyLoadFunc load_func,
+						 gpointer	 user_data,
+						 GDestroyNotify	 user_data_free);
+void		 gs_app_drop_lazy_loader	(GsApp		*app,
+						 gpointer	 user_data);
+GsAppLazyField	 gs_app_get_lazy_fields		(GsApp		*app);
+
+GsAppSnapshot	*gs_app_dup_snapshot		(GsApp		*app);
+GsAppSnapshot	*gs_app_snapshot_ref		(GsAppSnapshot	*snapshot);
+void		 gs_app_snapshot_unref		(GsAppSnapshot	*snapshot);
+const gchar	*gs_app_snapshot_get_name	(GsAppSnapshot	*snapshot);
+const gchar	*gs_app_snapshot_get_summary	(GsAppSnapshot	*snapshot);
+const gchar	*gs_app_snapshot_get_version	(GsAppSnapshot	*snapshot);
+GsAppState	 gs_app_snapshot_get_state	(GsAppSnapshot	*snapshot);
+GsSizeType	 gs_app_snapshot_get_size_download
+						(GsAppSnapshot	*snapshot,
+						 guint64	*size_bytes_out);
+GsSizeType	 gs_app_snapshot_get_size_installed
+						(GsAppSnapshot	*snapshot,
+						 guint64	*size_bytes_out);
+GPtrArray	*gs_app_snapshot_get_icons	(GsAppSnapshot	*snapshot);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GsAppSnapshot, gs_app_snapshot_unref)
 
 G_END_DECLS
@@ -492,6 +492,10 @@ gs_app_query_class_init (GsAppQueryClass *klass)
 	 *
 	 * Maximum number of results to return, or 0 for no limit.
 	 *
+	 * If this is set, only as many apps as needed are refined when the
+	 * results are in random order, or sorted in an order which plugins
+	 * can produce while listing. See gs_app_query_get_max_candidates().
+	 *
 	 * Since: 43
 	 */
 	props[PROP_MAX_RESULTS] =
@@ -522,6 +526,12 @@ gs_app_query_class_init (GsAppQueryClass *klass)
 	 *
 	 * This must be of type #GsAppListSortFunc.
 	 *
+	 * If #GsAppQuery:max-results is also set, prefer
+	 * gs_utils_app_sort_match_value() or gs_utils_app_sort_release_date()
+	 * where they give the wanted order, as then only the top results are
+	 * listed and refined. Any other function may use data added by
+	 * refining, so all the matching apps are refined before sorting.
+	 *
 	 * Since: 43
 	 */
 	props[PROP_SORT_FUNC] =
@@ -1061,6 +1071,54 @@ gs_app_query_get_sort_func (GsAppQuery *self,
 	return self->sort_func;
 }
 
+/* How many candidates to list and refine for each result wanted, when only
+ * the top few results are needed. Some candidates are filtered out after
+ * refining (by the filter function, the license and developer verification
+ * checks, and deduplication), so more are needed than results. This is an
+ * estimate rather than a measured filter rate: if too many are filtered
+ * out, #GsPluginJobListApps refines another batch of candidates, which costs
+ * time but does not change the results. */
+#define CANDIDATES_PER_RESULT 3
+
+/**
+ * gs_app_query_get_max_candidates:
+ * @self: a #GsAppQuery
+ * @sort_func: (nullable): the order the caller can list candidates in, or
+ *   %NULL for random order
+ *
+ * Get how many candidates need to be listed for the query, if they are listed
+ * in the order given by @sort_func, or in random order if @sort_func is %NULL.
+ *
+ * This allows a plugin which can cheaply find the best matches for a query to
+ * create apps only for as many as are needed, rather than for every match. It
+ * is only possible if #GsAppQuery:max-results is set and the query is sorted
+ * with @sort_func (or not sorted at all, if @sort_func is %NULL).
+ *
+ * Only orders whose sort keys are set when apps are listed, rather than added
+ * by refining them, are supported: gs_utils_app_sort_match_value() and
+ * gs_utils_app_sort_release_date(). For these, #GsPluginJobListApps also
+ * refines only the top candidates.
+ *
+ * Returns: the number of candidates to list, or `0` if all matching apps must
+ *   be listed
+ * Since: 48
+ */
+guint
+gs_app_query_get_max_candidates (GsAppQuery        *self,
+                                 GsAppListSortFunc  sort_func)
+{
+	g_return_val_if_fail (GS_IS_APP_QUERY (self), 0);
+
+	if (self->max_results == 0 || self->sort_func != sort_func)
+		return 0;
+	if (sort_func != NULL &&
+	    sort_func != gs_utils_app_sort_match_value &&
+	    sort_func != gs_utils_app_sort_release_date)
+		return 0;
+
+	return self->max_results * CANDIDATES_PER_RESULT;
+}
+
 /**
  * gs_app_query_get_filter_func:
  * @self: a #GsAppQuery
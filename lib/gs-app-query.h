@@ -115,6 +115,8 @@ guint			 gs_app_query_get_max_results	(GsAppQuery *self);
 GsAppListFilterFlags	 gs_app_query_get_dedupe_flags	(GsAppQuery *self);
 GsAppListSortFunc	 gs_app_query_get_sort_func	(GsAppQuery *self,
 							 gpointer   *user_data_out);
+guint			 gs_app_query_get_max_candidates (GsAppQuery        *self,
+							  GsAppListSortFunc  sort_func);
 GsAppListFilterFunc	 gs_app_query_get_filter_func	(GsAppQuery *self,
 							 gpointer   *user_data_out);
 
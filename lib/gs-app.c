@@ -52,21 +52,37 @@
 #include "gs-remote-icon.h"
 #include "gs-utils.h"
 
+#define GS_APP_N_LAZY_FIELDS	3
+
+/* One call to gs_app_set_lazy_loader(), shared by the fields it covers */
+typedef struct
+{
+	GsAppLazyLoadFunc	 func;
+	gpointer		 user_data;  /* (nullable) (owned) */
+	GDestroyNotify		 user_data_free;  /* (nullable) */
+} GsAppLazyLoader;
+
+typedef struct {
+	GsAppIdChangedFunc	 func;
+	gpointer		 user_data;
+} GsAppIdWatch;
+
 typedef struct
 {
 	GMutex			 mutex;
 	gchar			*id;
 	gchar			*unique_id;
 	gboolean		 unique_id_valid;
-	gchar			*branch;
+	GArray			*id_watches;  /* (nullable) (owned) (element-type GsAppIdWatch) */
+	gchar			*branch;  /* (nullable) (owned) (interned) */
 	gchar			*name;
 	gchar			*renamed_from;
 	GsAppQuality		 name_quality;
 	GPtrArray		*icons;  /* (nullable) (owned) (element-type AsIcon), sorted by pixel size, smallest first */
 	GPtrArray		*sources;
 	GPtrArray		*source_ids;
-	gchar			*project_group;
-	gchar			*developer_name;
+	gchar			*project_group;  /* (nullable) (owned) (interned) */
+	gchar			*developer_name;  /* (nullable) (owned) (interned) */
 	gchar			*agreement;
 	gchar			*version;
 	gchar			*version_ui;
@@ -76,19 +92,19 @@ typedef struct
 	gchar			*description;
 	GsAppQuality		 description_quality;
 	GPtrArray		*screenshots;
-	GPtrArray		*categories;
+	GPtrArray		*categories;  /* (owned) (element-type utf8) (interned) */
 	GArray			*key_colors;  /* (nullable) (element-type GdkRGBA) */
 	gboolean		 user_key_colors;
 	GHashTable		*urls;  /* (element-type AsUrlKind utf8) (owned) (nullable) */
 	GHashTable		*launchables;
 	gchar			*url_missing;
-	gchar			*license;
+	gchar			*license;  /* (nullable) (owned) (interned) */
 	GsAppQuality		 license_quality;
 	gchar			**menu_path;
-	gchar			*origin;
-	gchar			*origin_ui;
-	gchar			*origin_appstream;
-	gchar			*origin_hostname;
+	gchar			*origin;  /* (nullable) (owned) (interned) */
+	gchar			*origin_ui;  /* (nullable) (owned) (interned) */
+	gchar			*origin_appstream;  /* (nullable) (owned) (interned) */
+	gchar			*origin_hostname;  /* (nullable) (owned) (interned) */
 	gchar			*update_version;
 	gchar			*update_version_ui;
 	gchar			*update_details_markup;
@@ -120,7 +136,7 @@ typedef struct
 	AsBundleKind		 bundle_kind;
 	guint			 progress;  /* integer 0–100 (inclusive), or %GS_APP_PROGRESS_UNKNOWN */
 	gboolean		 allow_cancel;
-	GHashTable		*metadata;
+	GHashTable		*metadata;  /* (owned) (element-type utf8 GVariant), keys are interned */
 	GsAppList		*addons;
 	GsAppList		*related;
 	GsAppList		*history;
@@ -147,8 +163,36 @@ typedef struct
 	gboolean		 key_color_for_dark_set;
 	GdkRGBA			 key_color_for_dark;
 	gboolean		 mok_key_pending;
+	gint64			*refined_time;  /* (nullable) (owned) (array fixed-size=32), monotonic time each #GsPluginRefineFlags bit was last refined, or zero */
+	gint64			 refined_invalidated_time;
+	GsAppSnapshot		*snapshot;  /* (atomic) (owned) (nullable) */
+	gint			 snapshot_readers;  /* (atomic) */
+	gint			 snapshot_serial;  /* (atomic) */
+	guint			 lazy_fields;  /* (atomic) GsAppLazyField still to be loaded */
+	GsAppLazyLoader		*lazy_loaders[GS_APP_N_LAZY_FIELDS];  /* (nullable) (owned) (locked-by lazy_mutex), indexed by the bit number of the field */
 } GsAppPrivate;
 
+struct _GsAppSnapshot
+{
+	gchar			*name;
+	gchar			*summary;
+	gchar			*version;
+	GsAppState		 state;
+	GsSizeType		 size_download_type;
+	guint64			 size_download;
+	GsSizeType		 size_installed_type;
+	guint64			 size_installed;
+	GPtrArray		*icons;  /* (nullable) (owned) (element-type GIcon), never empty */
+};
+
+/* bumped by gs_app_invalidate_all_refined_flags() */
+static GMutex refined_all_mutex;
+static gint64 refined_all_invalidated_time = 0;
+
+/* held while a GsAppLazyLoadFunc runs; recursive as the loaders call the
+ * setters, which themselves make sure the field is loaded */
+static GRecMutex lazy_mutex;
+
 typedef enum {
 	PROP_ID = 1,
 	PROP_NAME,
@@ -195,6 +239,130 @@ static GParamSpec *obj_props[PROP_MOK_KEY_PENDING + 1] = { NULL, };
 
 G_DEFINE_TYPE_WITH_PRIVATE (GsApp, gs_app, G_TYPE_OBJECT)
 
+static void
+gs_app_snapshot_clear (GsAppSnapshot *snapshot)
+{
+	g_free (snapshot->name);
+	g_free (snapshot->summary);
+	g_free (snapshot->version);
+	g_clear_pointer (&snapshot->icons, g_ptr_array_unref);
+}
+
+/**
+ * gs_app_snapshot_ref:
+ * @snapshot: a #GsAppSnapshot
+ *
+ * Increase the reference count of @snapshot.
+ *
+ * Returns: (transfer full): @snapshot
+ *
+ * Since: 48
+ **/
+GsAppSnapshot *
+gs_app_snapshot_ref (GsAppSnapshot *snapshot)
+{
+	return g_atomic_rc_box_acquire (snapshot);
+}
+
+/**
+ * gs_app_snapshot_unref:
+ * @snapshot: (transfer full): a #GsAppSnapshot
+ *
+ * Decrease the reference count of @snapshot, freeing it if that was the last
+ * reference.
+ *
+ * Since: 48
+ **/
+void
+gs_app_snapshot_unref (GsAppSnapshot *snapshot)
+{
+	g_atomic_rc_box_release_full (snapshot, (GDestroyNotify) gs_app_snapshot_clear);
+}
+
+/* Drop the published snapshot after one of the fields in it has changed, so
+ * the next gs_app_dup_snapshot() builds a new one. This may be called with or
+ * without priv->mutex held, but must be called after the field is changed. */
+static void
+gs_app_invalidate_snapshot (GsApp *app)
+{
+	GsAppPrivate *priv = gs_app_get_instance_private (app);
+	GsAppSnapshot *old;
+
+	g_atomic_int_inc (&priv->snapshot_serial);
+
+	old = g_atomic_pointer_exchange (&priv->snapshot, NULL);
+	if (old == NULL)
+		return;
+
+	/* readers may have loaded @old without having taken a ref on it yet;
+	 * that window is only a few instructions long */
+	while (g_atomic_int_get (&priv->snapshot_readers) > 0)
+		g_thread_yield ();
+
+	gs_app_snapshot_unref (old);
+}
+
+static void
+gs_app_lazy_loader_clear (GsAppLazyLoader *loader)
+{
+	if (loader->user_data_free != NULL && loader->user_data != NULL)
+		loader->user_data_free (loader->user_data);
+}
+
+/* loaders are only ever touched with lazy_mutex held */
+static void
+gs_app_lazy_loader_unref (GsAppLazyLoader *loader)
+{
+	g_rc_box_release_full (loader, (GDestroyNotify) gs_app_lazy_loader_clear);
+}
+
+/* must be called with lazy_mutex held */
+static void
+gs_app_clear_lazy_loaders (GsApp *app)
+{
+	GsAppPrivate *priv = gs_app_get_instance_private (app);
+
+	g_atomic_int_set (&priv->lazy_fields, GS_APP_LAZY_FIELD_NONE);
+	for (guint i = 0; i < G_N_ELEMENTS (priv->lazy_loaders); i++)
+		g_clear_pointer (&priv->lazy_loaders[i], gs_app_lazy_loader_unref);
+}
+
+/* Load @field if it was deferred with gs_app_set_lazy_loader(). This must be
+ * called without priv->mutex held, as the loader uses the normal setters. */
+static void
+gs_app_ensure_lazy_field (GsApp *app, GsAppLazyField field)
+{
+	GsAppPrivate *priv = gs_app_get_instance_private (app);
+	gboolean stale = FALSE;
+
+	/* fast path, taken by almost every call */
+	if ((g_atomic_int_get (&priv->lazy_fields) & field) == 0)
+		return;
+
+	g_rec_mutex_lock (&lazy_mutex);
+
+	/* clear the bit first, so the setters called by the loader do not
+	 * recurse; another thread may also have got here first */
+	if ((g_atomic_int_and (&priv->lazy_fields, ~field) & field) != 0) {
+		guint idx = g_bit_nth_lsf (field, -1);
+		GsAppLazyLoader *loader = g_steal_pointer (&priv->lazy_loaders[idx]);
+
+		if (loader != NULL) {
+			stale = !loader->func (app, field, loader->user_data);
+			gs_app_lazy_loader_unref (loader);
+		}
+	}
+
+	g_rec_mutex_unlock (&lazy_mutex);
+
+	/* the data the field was loaded from has since been replaced, so
+	 * get the next refine to fill it in again */
+	if (stale) {
+		g_debug ("lazy data for %s is stale", gs_app_get_unique_id (app));
+		gs_app_invalidate_refined_flags (app);
+	}
+}
+
 static gboolean
 _g_set_strv (gchar ***strv_ptr, gchar **new_strv)
 {
@@ -205,6 +373,21 @@ _g_set_strv (gchar ***strv_ptr, gchar **new_strv)
 	return TRUE;
 }
 
+/* Strings which are shared by many apps, such as origins and licenses, are
+ * stored as interned #GRefStrings, so thousands of apps from one repository
+ * share one copy of each. Such fields must be freed with
+ * g_ref_string_release(), and two of them are equal iff their pointers are. */
+static gboolean
+_g_set_interned_str (gchar **str_ptr, const gchar *new_str)
+{
+	if (*str_ptr == new_str || g_strcmp0 (*str_ptr, new_str) == 0)
+		return FALSE;
+	g_clear_pointer (str_ptr, g_ref_string_release);
+	if (new_str != NULL)
+		*str_ptr = g_ref_string_new_intern (new_str);
+	return TRUE;
+}
+
 static gboolean
 _g_set_ptr_array (GPtrArray **array_ptr, GPtrArray *new_array)
 {
@@ -600,6 +783,10 @@ gs_app_to_string_append (GsApp *app, GString *str)
 		gs_app_kv_lpad (str, "summary", priv->summary);
 	if (priv->description != NULL)
 		gs_app_kv_lpad (str, "description", priv->description);
+	if (g_atomic_int_get (&priv->lazy_fields) != 0) {
+		gs_app_kv_printf (str, "lazy-fields", "0x%x",
+				  g_atomic_int_get (&priv->lazy_fields));
+	}
 	for (i = 0; i < priv->screenshots->len; i++) {
 		AsScreenshot *ss = g_ptr_array_index (priv->screenshots, i);
 		g_autofree gchar *key = NULL;
@@ -824,11 +1011,90 @@ notify_idle_cb (gpointer data)
 	return G_SOURCE_REMOVE;
 }
 
+/* Icon state notifications are queued from any thread and emitted in batches
+ * from a single idle callback, so the icons arriving for a page of apps cost
+ * one main loop wakeup rather than one per app. An app whose icon state
+ * changes several times in a batch is only notified once. */
+static GMutex notify_mutex;
+static GPtrArray *notify_queue = NULL;  /* (mutex notify_mutex) (owned) (nullable) (element-type AppNotifyData) */
+static GHashTable *notify_queued = NULL;  /* (mutex notify_mutex) (owned) (nullable) set of elements of notify_queue */
+
+static guint
+app_notify_data_hash (gconstpointer v)
+{
+	const AppNotifyData *notify_data = v;
+	return g_direct_hash (notify_data->app) ^ g_direct_hash (notify_data->pspec);
+}
+
+static gboolean
+app_notify_data_equal (gconstpointer a,
+		       gconstpointer b)
+{
+	const AppNotifyData *notify_data_a = a;
+	const AppNotifyData *notify_data_b = b;
+	return notify_data_a->app == notify_data_b->app &&
+	       notify_data_a->pspec == notify_data_b->pspec;
+}
+
+static void
+app_notify_data_free (AppNotifyData *notify_data)
+{
+	g_object_unref (notify_data->app);
+	g_free (notify_data);
+}
+
+static gboolean
+notify_icons_state_idle_cb (gpointer data)
+{
+	g_autoptr(GPtrArray) queue = NULL;
+
+	/* notifications queued by the handlers go into the next batch */
+	g_mutex_lock (&notify_mutex);
+	queue = g_steal_pointer (&notify_queue);
+	g_clear_pointer (&notify_queued, g_hash_table_unref);
+	g_mutex_unlock (&notify_mutex);
+
+	for (guint i = 0; i < queue->len; i++) {
+		AppNotifyData *notify_data = g_ptr_array_index (queue, i);
+		g_object_notify_by_pspec (G_OBJECT (notify_data->app), notify_data->pspec);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gs_app_queue_notify_icons_state (GsApp *app, GParamSpec *pspec)
+{
+	AppNotifyData lookup = { app, pspec };
+	AppNotifyData *notify_data;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&notify_mutex);
+
+	if (notify_queue == NULL) {
+		notify_queue = g_ptr_array_new_with_free_func ((GDestroyNotify) app_notify_data_free);
+		notify_queued = g_hash_table_new (app_notify_data_hash, app_notify_data_equal);
+		g_idle_add (notify_icons_state_idle_cb, NULL);
+	} else if (g_hash_table_contains (notify_queued, &lookup)) {
+		return;
+	}
+
+	notify_data = g_new (AppNotifyData, 1);
+	notify_data->app = g_object_ref (app);
+	notify_data->pspec = pspec;
+
+	g_ptr_array_add (notify_queue, notify_data);
+	g_hash_table_add (notify_queued, notify_data);
+}
+
 static void
 gs_app_queue_notify (GsApp *app, GParamSpec *pspec)
 {
 	AppNotifyData *notify_data;
 
+	if (pspec == obj_props[PROP_ICONS_STATE]) {
+		gs_app_queue_notify_icons_state (app, pspec);
+		return;
+	}
+
 	notify_data = g_new (AppNotifyData, 1);
 	notify_data->app = g_object_ref (app);
 	notify_data->pspec = pspec;
@@ -836,6 +1102,18 @@ gs_app_queue_notify (GsApp *app, GParamSpec *pspec)
 	g_idle_add (notify_idle_cb, notify_data);
 }
 
+/* mutex must be held */
+static void
+gs_app_emit_id_changed_locked (GsApp *app)
+{
+	GsAppPrivate *priv = gs_app_get_instance_private (app);
+
+	for (guint i = 0; priv->id_watches != NULL && i < priv->id_watches->len; i++) {
+		GsAppIdWatch *watch = &g_array_index (priv->id_watches, GsAppIdWatch, i);
+		watch->func (app, watch->user_data);
+	}
+}
+
 /**
  * gs_app_get_id:
  * @app: a #GsApp
@@ -866,10 +1144,76 @@ gs_app_set_id (GsApp *app, const gchar *id)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
 	g_autoptr(GMutexLocker) locker = NULL;
+	gboolean had_id;
 	g_return_if_fail (GS_IS_APP (app));
 	locker = g_mutex_locker_new (&priv->mutex);
-	if (g_set_str (&priv->id, id))
+	had_id = (priv->id != NULL);
+	if (g_set_str (&priv->id, id)) {
 		priv->unique_id_valid = FALSE;
+		if (had_id)
+			gs_app_emit_id_changed_locked (app);
+	}
+}
+
+/**
+ * gs_app_add_id_watch:
+ * @app: a #GsApp
+ * @func: function to call when the ID of @app changes
+ * @user_data: data to pass to @func
+ *
+ * Call @func whenever @app, which already has an ID, is given a different
+ * one by gs_app_set_id() or gs_app_set_unique_id(). This is for #GsAppList to
+ * keep its index of apps by ID up to date, so only the apps which changed
+ * need to be indexed again.
+ *
+ * @func is called synchronously, in the thread which changed the ID, with the
+ * lock of @app held, so it must not call any #GsApp methods.
+ *
+ * Since: 48
+ **/
+void
+gs_app_add_id_watch (GsApp *app, GsAppIdChangedFunc func, gpointer user_data)
+{
+	GsAppPrivate *priv = gs_app_get_instance_private (app);
+	GsAppIdWatch watch = { func, user_data };
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (GS_IS_APP (app));
+	g_return_if_fail (func != NULL);
+
+	locker = g_mutex_locker_new (&priv->mutex);
+	if (priv->id_watches == NULL)
+		priv->id_watches = g_array_new (FALSE, FALSE, sizeof (GsAppIdWatch));
+	g_array_append_val (priv->id_watches, watch);
+}
+
+/**
+ * gs_app_remove_id_watch:
+ * @app: a #GsApp
+ * @func: the function passed to gs_app_add_id_watch()
+ * @user_data: the data passed to gs_app_add_id_watch()
+ *
+ * Remove a watch added with gs_app_add_id_watch(). Once this returns, @func
+ * won’t be called again for it.
+ *
+ * Since: 48
+ **/
+void
+gs_app_remove_id_watch (GsApp *app, GsAppIdChangedFunc func, gpointer user_data)
+{
+	GsAppPrivate *priv = gs_app_get_instance_private (app);
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (GS_IS_APP (app));
+
+	locker = g_mutex_locker_new (&priv->mutex);
+	for (guint i = 0; priv->id_watches != NULL && i < priv->id_watches->len; i++) {
+		GsAppIdWatch *watch = &g_array_index (priv->id_watches, GsAppIdWatch, i);
+		if (watch->func == func && watch->user_data == user_data) {
+			g_array_remove_index_fast (priv->id_watches, i);
+			return;
+		}
+	}
 }
 
 /**
@@ -1087,6 +1431,8 @@ gs_app_set_state_recover (GsApp *app)
 	gs_app_set_progress (app, GS_APP_PROGRESS_UNKNOWN);
 
 	priv->state = priv->state_recover;
+	priv->refined_invalidated_time = g_get_monotonic_time ();
+	gs_app_invalidate_snapshot (app);
 	gs_app_queue_notify (app, obj_props[PROP_STATE]);
 }
 
@@ -1100,7 +1446,13 @@ gs_app_set_state_internal (GsApp *app, GsAppState state)
 	if (priv->state == state)
 		return FALSE;
 
+	/* anything refined for the old state may be stale; plugins setting the
+	 * state of a new app while refining it don’t count */
+	if (priv->state != GS_APP_STATE_UNKNOWN)
+		priv->refined_invalidated_time = g_get_monotonic_time ();
+
 	priv->state = state;
+	gs_app_invalidate_snapshot (app);
 
 	if (state == GS_APP_STATE_UNKNOWN ||
 	    state == GS_APP_STATE_AVAILABLE_LOCAL ||
@@ -1387,6 +1739,7 @@ gs_app_set_unique_id (GsApp *app, const gchar *unique_id)
 	g_free (priv->unique_id);
 	priv->unique_id = g_strdup (unique_id);
 	priv->unique_id_valid = TRUE;
+	gs_app_emit_id_changed_locked (app);
 }
 
 /**
@@ -1430,8 +1783,10 @@ gs_app_set_name (GsApp *app, GsAppQuality quality, const gchar *name)
 	if (quality < priv->name_quality)
 		return;
 	priv->name_quality = quality;
-	if (g_set_str (&priv->name, name))
+	if (g_set_str (&priv->name, name)) {
+		gs_app_invalidate_snapshot (app);
 		gs_app_queue_notify (app, obj_props[PROP_NAME]);
+	}
 }
 
 /**
@@ -1506,7 +1861,7 @@ gs_app_set_branch (GsApp *app, const gchar *branch)
 	g_autoptr(GMutexLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 	locker = g_mutex_locker_new (&priv->mutex);
-	if (g_set_str (&priv->branch, branch))
+	if (_g_set_interned_str (&priv->branch, branch))
 		priv->unique_id_valid = FALSE;
 }
 
@@ -1758,7 +2113,7 @@ gs_app_set_project_group (GsApp *app, const gchar *project_group)
 	g_autoptr(GMutexLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 	locker = g_mutex_locker_new (&priv->mutex);
-	g_set_str (&priv->project_group, project_group);
+	_g_set_interned_str (&priv->project_group, project_group);
 }
 
 /**
@@ -1777,7 +2132,7 @@ gs_app_set_developer_name (GsApp *app, const gchar *developer_name)
 	g_autoptr(GMutexLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 	locker = g_mutex_locker_new (&priv->mutex);
-	g_set_str (&priv->developer_name, developer_name);
+	_g_set_interned_str (&priv->developer_name, developer_name);
 }
 
 static GtkIconTheme *
@@ -1846,8 +2201,8 @@ gs_app_get_icon_for_size (GsApp       *app,
                           guint        scale,
                           const gchar *fallback_icon_name)
 {
-	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GsAppSnapshot) snapshot = NULL;
+	GPtrArray *icons;
 
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
 	g_return_val_if_fail (size > 0, NULL);
@@ -1856,13 +2211,16 @@ gs_app_get_icon_for_size (GsApp       *app,
 	g_debug ("Looking for icon for %s, at size %u×%u, with fallback %s",
 		 gs_app_get_id (app), size, scale, fallback_icon_name);
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	/* Use a snapshot of the icons, so the file and theme lookups below
+	 * don’t block other threads changing the app. */
+	snapshot = gs_app_dup_snapshot (app);
+	icons = gs_app_snapshot_get_icons (snapshot);
 
 	/* See if there’s an icon of the right size, or the first one which is too
 	 * big which could be scaled down. Note that the icons array may be
 	 * lazily created. */
-	for (guint i = 0; priv->icons != NULL && i < priv->icons->len; i++) {
-		GIcon *icon = priv->icons->pdata[i];
+	for (guint i = 0; icons != NULL && i < icons->len; i++) {
+		GIcon *icon = icons->pdata[i];
 		g_autofree gchar *icon_str = g_icon_to_string (icon);
 		guint icon_width = gs_icon_get_width (icon);
 		guint icon_scale = gs_icon_get_scale (icon);
@@ -1895,8 +2253,8 @@ gs_app_get_icon_for_size (GsApp       *app,
 
 	/* Fallback to themed icons with no width set. Typically
 	 * themed icons are available in any given size. */
-	for (guint i = 0; priv->icons != NULL && i < priv->icons->len; i++) {
-		GIcon *icon = priv->icons->pdata[i];
+	for (guint i = 0; icons != NULL && i < icons->len; i++) {
+		GIcon *icon = icons->pdata[i];
 		guint icon_width = gs_icon_get_width (icon);
 
 		if (icon_width == 0 && G_IS_THEMED_ICON (icon)) {
@@ -1908,8 +2266,6 @@ gs_app_get_icon_for_size (GsApp       *app,
 		}
 	}
 
-	g_clear_pointer (&locker, g_mutex_locker_free);
-
 	if (scale > 1) {
 		g_debug ("Retrying at scale 1");
 		return gs_app_get_icon_for_size (app, size, 1, fallback_icon_name);
@@ -1989,20 +2345,20 @@ gs_app_get_icons (GsApp *app)
 GPtrArray *
 gs_app_dup_icons (GsApp *app)
 {
-	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GsAppSnapshot) snapshot = NULL;
+	GPtrArray *icons;
 	GPtrArray *copy;
 
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
 
-	locker = g_mutex_locker_new (&priv->mutex);
-
-	if (priv->icons == NULL || priv->icons->len == 0)
+	snapshot = gs_app_dup_snapshot (app);
+	icons = gs_app_snapshot_get_icons (snapshot);
+	if (icons == NULL)
 		return NULL;
 
-	copy = g_ptr_array_new_full (priv->icons->len, g_object_unref);
-	for (guint i = 0; i < priv->icons->len; i++) {
-		g_ptr_array_add (copy, g_object_ref (g_ptr_array_index (priv->icons, i)));
+	copy = g_ptr_array_new_full (icons->len, g_object_unref);
+	for (guint i = 0; i < icons->len; i++) {
+		g_ptr_array_add (copy, g_object_ref (g_ptr_array_index (icons, i)));
 	}
 
 	return copy;
@@ -2021,14 +2377,13 @@ gs_app_dup_icons (GsApp *app)
 gboolean
 gs_app_has_icons (GsApp *app)
 {
-	GsAppPrivate *priv = gs_app_get_instance_private (app);
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GsAppSnapshot) snapshot = NULL;
 
 	g_return_val_if_fail (GS_IS_APP (app), FALSE);
 
-	locker = g_mutex_locker_new (&priv->mutex);
+	snapshot = gs_app_dup_snapshot (app);
 
-	return priv->icons != NULL && priv->icons->len > 0;
+	return gs_app_snapshot_get_icons (snapshot) != NULL;
 }
 
 static gint
@@ -2078,6 +2433,8 @@ gs_app_add_icon (GsApp *app, GIcon *icon)
 
 	/* Ensure the array is sorted by increasing width. */
 	g_ptr_array_sort (priv->icons, icon_sort_width_cb);
+
+	gs_app_invalidate_snapshot (app);
 }
 
 /**
@@ -2098,6 +2455,8 @@ gs_app_remove_all_icons (GsApp *app)
 
 	if (priv->icons != NULL)
 		g_ptr_array_set_size (priv->icons, 0);
+
+	gs_app_invalidate_snapshot (app);
 }
 
 /**
@@ -2446,6 +2805,7 @@ gs_app_set_version (GsApp *app, const gchar *version)
 
 	if (g_set_str (&priv->version, version)) {
 		gs_app_ui_versions_invalidate (app);
+		gs_app_invalidate_snapshot (app);
 		gs_app_queue_notify (app, obj_props[PROP_VERSION]);
 	}
 }
@@ -2491,8 +2851,10 @@ gs_app_set_summary (GsApp *app, GsAppQuality quality, const gchar *summary)
 	if (quality < priv->summary_quality)
 		return;
 	priv->summary_quality = quality;
-	if (g_set_str (&priv->summary, summary))
+	if (g_set_str (&priv->summary, summary)) {
+		gs_app_invalidate_snapshot (app);
 		gs_app_queue_notify (app, obj_props[PROP_SUMMARY]);
+	}
 }
 
 /**
@@ -2510,6 +2872,7 @@ gs_app_get_description (GsApp *app)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
+	gs_app_ensure_lazy_field (app, GS_APP_LAZY_FIELD_DESCRIPTION);
 	return priv->description;
 }
 
@@ -2530,6 +2893,7 @@ gs_app_set_description (GsApp *app, GsAppQuality quality, const gchar *descripti
 	g_autoptr(GMutexLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 
+	gs_app_ensure_lazy_field (app, GS_APP_LAZY_FIELD_DESCRIPTION);
 	locker = g_mutex_locker_new (&priv->mutex);
 
 	/* only save this if the data is sufficiently high quality */
@@ -2765,7 +3129,7 @@ gs_app_set_license (GsApp *app, GsAppQuality quality, const gchar *license)
 
 	priv->license_is_free = as_license_is_free_license (license);
 
-	if (g_set_str (&priv->license, license))
+	if (_g_set_interned_str (&priv->license, license))
 		gs_app_queue_notify (app, obj_props[PROP_LICENSE]);
 }
 
@@ -2944,8 +3308,7 @@ gs_app_set_origin (GsApp *app, const gchar *origin)
 		return;
 	}
 
-	g_free (priv->origin);
-	priv->origin = g_strdup (origin);
+	_g_set_interned_str (&priv->origin, origin);
 
 	/* no longer valid */
 	priv->unique_id_valid = FALSE;
@@ -2987,12 +3350,7 @@ gs_app_set_origin_appstream (GsApp *app, const gchar *origin_appstream)
 
 	locker = g_mutex_locker_new (&priv->mutex);
 
-	/* same */
-	if (g_strcmp0 (origin_appstream, priv->origin_appstream) == 0)
-		return;
-
-	g_free (priv->origin_appstream);
-	priv->origin_appstream = g_strdup (origin_appstream);
+	_g_set_interned_str (&priv->origin_appstream, origin_appstream);
 }
 
 /**
@@ -3044,7 +3402,6 @@ gs_app_set_origin_hostname (GsApp *app, const gchar *origin_hostname)
 	/* same */
 	if (g_strcmp0 (origin_hostname, priv->origin_hostname) == 0)
 		return;
-	g_free (priv->origin_hostname);
 
 	/* convert a URL */
 	uri = g_uri_parse (origin_hostname, SOUP_HTTP_URI_FLAGS, NULL);
@@ -3062,7 +3419,7 @@ gs_app_set_origin_hostname (GsApp *app, const gchar *origin_hostname)
 		origin_hostname = "localhost";
 
 	/* success */
-	priv->origin_hostname = g_strdup (origin_hostname);
+	_g_set_interned_str (&priv->origin_hostname, origin_hostname);
 }
 
 /**
@@ -3083,6 +3440,7 @@ gs_app_add_screenshot (GsApp *app, AsScreenshot *screenshot)
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (AS_IS_SCREENSHOT (screenshot));
 
+	gs_app_ensure_lazy_field (app, GS_APP_LAZY_FIELD_SCREENSHOTS);
 	locker = g_mutex_locker_new (&priv->mutex);
 	g_ptr_array_add (priv->screenshots, g_object_ref (screenshot));
 }
@@ -3102,6 +3460,7 @@ gs_app_get_screenshots (GsApp *app)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
+	gs_app_ensure_lazy_field (app, GS_APP_LAZY_FIELD_SCREENSHOTS);
 	return priv->screenshots;
 }
 
@@ -3665,11 +4024,13 @@ gs_app_set_size_download (GsApp      *app,
 
 	if (priv->size_download_type != size_type) {
 		priv->size_download_type = size_type;
+		gs_app_invalidate_snapshot (app);
 		gs_app_queue_notify (app, obj_props[PROP_SIZE_DOWNLOAD_TYPE]);
 	}
 
 	if (priv->size_download != size_bytes) {
 		priv->size_download = size_bytes;
+		gs_app_invalidate_snapshot (app);
 		gs_app_queue_notify (app, obj_props[PROP_SIZE_DOWNLOAD]);
 	}
 }
@@ -3867,11 +4228,13 @@ gs_app_set_size_installed (GsApp      *app,
 
 	if (priv->size_installed_type != size_type) {
 		priv->size_installed_type = size_type;
+		gs_app_invalidate_snapshot (app);
 		gs_app_queue_notify (app, obj_props[PROP_SIZE_INSTALLED_TYPE]);
 	}
 
 	if (priv->size_installed != size_bytes) {
 		priv->size_installed = size_bytes;
+		gs_app_invalidate_snapshot (app);
 		gs_app_queue_notify (app, obj_props[PROP_SIZE_INSTALLED]);
 	}
 }
@@ -4164,9 +4527,11 @@ gs_app_set_metadata_variant (GsApp *app, const gchar *key, GVariant *value)
 
 	locker = g_mutex_locker_new (&priv->mutex);
 
-	/* if no value, then remove the key */
+	/* if no value, then remove the key; plugins may have refined the app
+	 * based on the old set of keys, so any refine is stale after a change */
 	if (value == NULL) {
-		g_hash_table_remove (priv->metadata, key);
+		if (g_hash_table_remove (priv->metadata, key))
+			priv->refined_invalidated_time = g_get_monotonic_time ();
 		return;
 	}
 
@@ -4189,7 +4554,8 @@ gs_app_set_metadata_variant (GsApp *app, const gchar *key, GVariant *value)
 		}
 		return;
 	}
-	g_hash_table_insert (priv->metadata, g_strdup (key), g_variant_ref (value));
+	g_hash_table_insert (priv->metadata, g_ref_string_new_intern (key), g_variant_ref (value));
+	priv->refined_invalidated_time = g_get_monotonic_time ();
 }
 
 /**
@@ -4310,8 +4676,10 @@ gs_app_add_related (GsApp *app, GsApp *app2)
 	/* if the app is updatable-live and any related app is not then
 	 * degrade to the offline state */
 	if (priv->state == GS_APP_STATE_UPDATABLE_LIVE &&
-	    priv2->state == GS_APP_STATE_UPDATABLE)
+	    priv2->state == GS_APP_STATE_UPDATABLE) {
 		priv->state = priv2->state;
+		gs_app_invalidate_snapshot (app);
+	}
 
 	gs_app_list_add (priv->related, app2);
 
@@ -4519,7 +4887,7 @@ gs_app_has_category (GsApp *app, const gchar *category)
 	/* find the category */
 	for (i = 0; i < priv->categories->len; i++) {
 		tmp = g_ptr_array_index (priv->categories, i);
-		if (g_strcmp0 (tmp, category) == 0)
+		if (tmp == category || g_strcmp0 (tmp, category) == 0)
 			return TRUE;
 	}
 	return FALSE;
@@ -4542,7 +4910,11 @@ gs_app_set_categories (GsApp *app, GPtrArray *categories)
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (categories != NULL);
 	locker = g_mutex_locker_new (&priv->mutex);
-	_g_set_ptr_array (&priv->categories, categories);
+	if (categories == priv->categories)
+		return;
+	g_ptr_array_set_size (priv->categories, 0);
+	for (guint i = 0; i < categories->len; i++)
+		g_ptr_array_add (priv->categories, g_ref_string_new_intern (g_ptr_array_index (categories, i)));
 }
 
 /**
@@ -4564,7 +4936,7 @@ gs_app_add_category (GsApp *app, const gchar *category)
 	locker = g_mutex_locker_new (&priv->mutex);
 	if (gs_app_has_category (app, category))
 		return;
-	g_ptr_array_add (priv->categories, g_strdup (category));
+	g_ptr_array_add (priv->categories, g_ref_string_new_intern (category));
 }
 
 /**
@@ -4638,11 +5010,160 @@ gs_app_get_is_update_downloaded (GsApp *app)
 	return priv->is_update_downloaded;
 }
 
+/* Bump this if gs_calculate_key_colors() changes such that previously cached
+ * results should be recalculated. */
+#define KEY_COLORS_CACHE_VERSION 1
+
+static gchar *
+get_key_colors_cache_filename (const gchar  *checksum,
+			       GError      **error)
+{
+	g_autofree gchar *basename = g_strdup_printf ("%s-%u", checksum, (guint) KEY_COLORS_CACHE_VERSION);
+	return gs_utils_get_cache_filename ("key-colors", basename,
+					    GS_UTILS_CACHE_FLAG_WRITEABLE |
+					    GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
+					    error);
+}
+
+/* Key colors are the centroids of 8-bit colors, so can be stored as 8-bit
+ * colors without losing precision. */
+static GArray *
+load_cached_key_colors (const gchar *checksum)
+{
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *data = NULL;
+	gsize data_len;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GVariant) variant = NULL;
+	g_autoptr(GArray) colors = NULL;
+	GVariantIter iter;
+	guint8 red, green, blue;
+
+	filename = get_key_colors_cache_filename (checksum, NULL);
+	if (filename == NULL ||
+	    !g_file_get_contents (filename, &data, &data_len, NULL))
+		return NULL;
+
+	bytes = g_bytes_new_take (g_steal_pointer (&data), data_len);
+	variant = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE ("a(yyy)"), bytes, FALSE));
+	if (!g_variant_is_normal_form (variant))
+		return NULL;
+
+	colors = g_array_sized_new (FALSE, FALSE, sizeof (GdkRGBA), g_variant_n_children (variant));
+	g_variant_iter_init (&iter, variant);
+	while (g_variant_iter_next (&iter, "(yyy)", &red, &green, &blue)) {
+		GdkRGBA rgba;
+		rgba.red = (gdouble) red / 255.0;
+		rgba.green = (gdouble) green / 255.0;
+		rgba.blue = (gdouble) blue / 255.0;
+		rgba.alpha = 1.0;
+		g_array_append_val (colors, rgba);
+	}
+
+	return g_steal_pointer (&colors);
+}
+
+static void
+save_cached_key_colors (const gchar *checksum,
+			GArray      *colors)
+{
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GVariant) variant = NULL;
+	g_autoptr(GError) local_error = NULL;
+	GVariantBuilder builder;
+
+	filename = get_key_colors_cache_filename (checksum, &local_error);
+	if (filename == NULL) {
+		g_debug ("Failed to cache key colors: %s", local_error->message);
+		return;
+	}
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(yyy)"));
+	for (guint i = 0; i < colors->len; i++) {
+		const GdkRGBA *rgba = &g_array_index (colors, GdkRGBA, i);
+		g_variant_builder_add (&builder, "(yyy)",
+				       (guint8) (rgba->red * 255.0 + 0.5),
+				       (guint8) (rgba->green * 255.0 + 0.5),
+				       (guint8) (rgba->blue * 255.0 + 0.5));
+	}
+	variant = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+	if (!g_file_set_contents (filename, g_variant_get_data (variant),
+				  g_variant_get_size (variant), &local_error))
+		g_debug ("Failed to cache key colors: %s", local_error->message);
+}
+
+static GBytes *
+read_stream_bytes (GInputStream *stream)
+{
+	g_autoptr(GOutputStream) output = g_memory_output_stream_new_resizable ();
+
+	if (g_output_stream_splice (output, stream,
+				    G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+				    G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+				    NULL, NULL) < 0)
+		return NULL;
+
+	return g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (output));
+}
+
+/* Load the encoded image data for @icon at 32×32, so it can be hashed
+ * before it’s decoded. */
+static GBytes *
+load_icon_bytes (GIcon *icon)
+{
+	if (G_IS_LOADABLE_ICON (icon)) {
+		g_autoptr(GInputStream) icon_stream = g_loadable_icon_load (G_LOADABLE_ICON (icon), 32, NULL, NULL, NULL);
+		if (icon_stream != NULL)
+			return read_stream_bytes (icon_stream);
+	} else if (G_IS_THEMED_ICON (icon)) {
+		g_autoptr(GtkIconPaintable) icon_paintable = NULL;
+		g_autoptr(GtkIconTheme) theme = get_icon_theme ();
+
+		icon_paintable = gtk_icon_theme_lookup_by_gicon (theme, icon,
+								 32, 1,
+								 gtk_get_locale_direction (),
+								 0);
+		if (icon_paintable != NULL) {
+			g_autoptr(GFile) file = NULL;
+			g_autofree gchar *path = NULL;
+
+			file = gtk_icon_paintable_get_file (icon_paintable);
+			if (file != NULL)
+				path = g_file_get_path (file);
+
+			if (path != NULL) {
+				return g_file_load_bytes (file, NULL, NULL, NULL);
+			} else {
+				const gchar *const *names = g_themed_icon_get_names (G_THEMED_ICON (icon));
+				for (guint i = 0; names != NULL && names[i] != NULL; i++) {
+					g_autoptr(GError) local_error = NULL;
+					g_autofree gchar *resource_path = NULL;
+					GBytes *bytes;
+
+					resource_path = g_strconcat ("/org/gnome/Software/icons/scalable/apps/", names[i], ".svg", NULL);
+					bytes = g_resources_lookup_data (resource_path, G_RESOURCE_LOOKUP_FLAGS_NONE, &local_error);
+					if (bytes != NULL)
+						return bytes;
+					g_warning ("Failed to load icon from resource '%s': %s", resource_path, local_error != NULL ? local_error->message : "Unknown error");
+				}
+			}
+		}
+	} else {
+		g_debug ("unsupported pixbuf, so no key colors");
+	}
+
+	return NULL;
+}
+
 static void
 calculate_key_colors (GsApp *app)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
 	g_autoptr(GIcon) icon_small = NULL;
+	g_autoptr(GBytes) icon_bytes = NULL;
+	g_autofree gchar *checksum = NULL;
+	g_autoptr(GArray) key_colors = NULL;
 	g_autoptr(GdkPixbuf) pb_small = NULL;
 	const gchar *overrides_str;
 
@@ -4698,60 +5219,41 @@ calculate_key_colors (GsApp *app)
 		}
 	}
 
-	/* Try and load the pixbuf. */
+	/* Try and load the icon. */
 	icon_small = gs_app_get_icon_for_size (app, 32, 1, NULL);
 
 	if (icon_small == NULL) {
 		g_debug ("no pixbuf, so no key colors");
 		return;
-	} else if (G_IS_LOADABLE_ICON (icon_small)) {
-		g_autoptr(GInputStream) icon_stream = g_loadable_icon_load (G_LOADABLE_ICON (icon_small), 32, NULL, NULL, NULL);
-		if (icon_stream)
-			pb_small = gdk_pixbuf_new_from_stream_at_scale (icon_stream, 32, 32, TRUE, NULL, NULL);
-	} else if (G_IS_THEMED_ICON (icon_small)) {
-		g_autoptr(GtkIconPaintable) icon_paintable = NULL;
-		g_autoptr(GtkIconTheme) theme = get_icon_theme ();
-
-		icon_paintable = gtk_icon_theme_lookup_by_gicon (theme, icon_small,
-								 32, 1,
-								 gtk_get_locale_direction (),
-								 0);
-		if (icon_paintable != NULL) {
-			g_autoptr(GFile) file = NULL;
-			g_autofree gchar *path = NULL;
-
-			file = gtk_icon_paintable_get_file (icon_paintable);
-			if (file != NULL)
-				path = g_file_get_path (file);
-
-			if (path != NULL) {
-				pb_small = gdk_pixbuf_new_from_file_at_size (path, 32, 32, NULL);
-			} else {
-				const gchar *const *names = g_themed_icon_get_names (G_THEMED_ICON (icon_small));
-				for (guint i = 0; names != NULL && names[i] != NULL && pb_small == NULL; i++) {
-					g_autoptr(GError) local_error = NULL;
-					g_autofree gchar *resource_path = NULL;
-					resource_path = g_strconcat ("/org/gnome/Software/icons/scalable/apps/", names[i], ".svg", NULL);
-					pb_small = gdk_pixbuf_new_from_resource (resource_path, &local_error);
-					if (pb_small == NULL)
-						g_warning ("Failed to load icon from resource '%s': %s", resource_path, local_error != NULL ? local_error->message : "Unknown error");
-				}
-			}
-		}
-
-	} else {
-		g_debug ("unsupported pixbuf, so no key colors");
-		return;
 	}
 
-	if (pb_small == NULL) {
+	icon_bytes = load_icon_bytes (icon_small);
+	if (icon_bytes == NULL) {
 		g_debug ("pixbuf couldn’t be loaded, so no key colors");
 		return;
 	}
 
+	/* The same icon is used every time an app is loaded, and often by
+	 * several apps, so the key colors are cached by the icon contents to
+	 * avoid decoding it and clustering its pixels each time. */
+	checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, icon_bytes);
+	key_colors = load_cached_key_colors (checksum);
+	if (key_colors == NULL) {
+		g_autoptr(GInputStream) icon_stream = g_memory_input_stream_new_from_bytes (icon_bytes);
+
+		pb_small = gdk_pixbuf_new_from_stream_at_scale (icon_stream, 32, 32, TRUE, NULL, NULL);
+		if (pb_small == NULL) {
+			g_debug ("pixbuf couldn’t be loaded, so no key colors");
+			return;
+		}
+
+		key_colors = gs_calculate_key_colors (pb_small);
+		save_cached_key_colors (checksum, key_colors);
+	}
+
 	/* get a list of key colors */
 	g_clear_pointer (&priv->key_colors, g_array_unref);
-	priv->key_colors = gs_calculate_key_colors (pb_small);
+	priv->key_colors = g_steal_pointer (&key_colors);
 }
 
 /**
@@ -4776,6 +5278,28 @@ gs_app_get_key_colors (GsApp *app)
 	return priv->key_colors;
 }
 
+/**
+ * gs_app_peek_key_colors:
+ * @app: a #GsApp
+ *
+ * Gets the key colors used in the application icon, like
+ * gs_app_get_key_colors(), but without calculating them from the icon if they
+ * have not been set or calculated yet.
+ *
+ * Returns: (element-type GdkRGBA) (transfer none) (nullable): the key colors,
+ *   or %NULL if they are not known yet
+ *
+ * Since: 48
+ **/
+GArray *
+gs_app_peek_key_colors (GsApp *app)
+{
+	GsAppPrivate *priv = gs_app_get_instance_private (app);
+	g_return_val_if_fail (GS_IS_APP (app), NULL);
+
+	return priv->key_colors;
+}
+
 /**
  * gs_app_set_key_colors:
  * @app: a #GsApp
@@ -5383,7 +5907,7 @@ gs_app_get_property (GObject *object, guint prop_id, GValue *value, GParamSpec *
 		g_value_set_string (value, priv->summary);
 		break;
 	case PROP_DESCRIPTION:
-		g_value_set_string (value, priv->description);
+		g_value_set_string (value, gs_app_get_description (app));
 		break;
 	case PROP_RATING:
 		g_value_set_int (value, priv->rating);
@@ -5668,6 +6192,10 @@ gs_app_dispose (GObject *object)
 	g_clear_pointer (&priv->relations, g_ptr_array_unref);
 	g_weak_ref_clear (&priv->management_plugin_weak);
 
+	g_rec_mutex_lock (&lazy_mutex);
+	gs_app_clear_lazy_loaders (app);
+	g_rec_mutex_unlock (&lazy_mutex);
+
 	G_OBJECT_CLASS (gs_app_parent_class)->dispose (object);
 }
 
@@ -5680,22 +6208,23 @@ gs_app_finalize (GObject *object)
 	g_mutex_clear (&priv->mutex);
 	g_free (priv->id);
 	g_free (priv->unique_id);
-	g_free (priv->branch);
+	g_clear_pointer (&priv->id_watches, g_array_unref);
+	g_clear_pointer (&priv->branch, g_ref_string_release);
 	g_free (priv->name);
 	g_free (priv->renamed_from);
 	g_free (priv->url_missing);
 	g_clear_pointer (&priv->urls, g_hash_table_unref);
 	g_hash_table_unref (priv->launchables);
-	g_free (priv->license);
+	g_clear_pointer (&priv->license, g_ref_string_release);
 	g_strfreev (priv->menu_path);
-	g_free (priv->origin);
-	g_free (priv->origin_ui);
-	g_free (priv->origin_appstream);
-	g_free (priv->origin_hostname);
+	g_clear_pointer (&priv->origin, g_ref_string_release);
+	g_clear_pointer (&priv->origin_ui, g_ref_string_release);
+	g_clear_pointer (&priv->origin_appstream, g_ref_string_release);
+	g_clear_pointer (&priv->origin_hostname, g_ref_string_release);
 	g_ptr_array_unref (priv->sources);
 	g_ptr_array_unref (priv->source_ids);
-	g_free (priv->project_group);
-	g_free (priv->developer_name);
+	g_clear_pointer (&priv->project_group, g_ref_string_release);
+	g_clear_pointer (&priv->developer_name, g_ref_string_release);
 	g_free (priv->agreement);
 	g_free (priv->version);
 	g_free (priv->version_ui);
@@ -5705,6 +6234,8 @@ gs_app_finalize (GObject *object)
 	g_free (priv->update_version);
 	g_free (priv->update_version_ui);
 	g_free (priv->update_details_markup);
+	g_free (priv->refined_time);
+	g_clear_pointer (&priv->snapshot, gs_app_snapshot_unref);
 	g_hash_table_unref (priv->metadata);
 	g_ptr_array_unref (priv->categories);
 	g_clear_pointer (&priv->key_colors, g_array_unref);
@@ -6206,7 +6737,7 @@ gs_app_init (GsApp *app)
 	priv->rating = -1;
 	priv->sources = g_ptr_array_new_with_free_func (g_free);
 	priv->source_ids = g_ptr_array_new_with_free_func (g_free);
-	priv->categories = g_ptr_array_new_with_free_func (g_free);
+	priv->categories = g_ptr_array_new_with_free_func ((GDestroyNotify) g_ref_string_release);
 	priv->related = gs_app_list_new ();
 	priv->history = gs_app_list_new ();
 	priv->screenshots = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
@@ -6214,7 +6745,7 @@ gs_app_init (GsApp *app)
 	priv->provided = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	priv->metadata = g_hash_table_new_full (g_str_hash,
 	                                        g_str_equal,
-	                                        g_free,
+	                                        (GDestroyNotify) g_ref_string_release,
 	                                        (GDestroyNotify) g_variant_unref);
 	priv->launchables = g_hash_table_new_full (g_str_hash,
 	                                           g_str_equal,
@@ -6415,11 +6946,9 @@ gs_app_set_origin_ui (GsApp *app,
 	if (origin_ui && !*origin_ui)
 		origin_ui = NULL;
 
-	if (g_strcmp0 (priv->origin_ui, origin_ui) == 0)
+	if (!_g_set_interned_str (&priv->origin_ui, origin_ui))
 		return;
 
-	g_free (priv->origin_ui);
-	priv->origin_ui = g_strdup (origin_ui);
 	gs_app_queue_notify (app, obj_props[PROP_ORIGIN_UI]);
 }
 
@@ -6658,6 +7187,7 @@ gs_app_get_version_history (GsApp *app)
 	g_autoptr(GMutexLocker) locker = NULL;
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
 
+	gs_app_ensure_lazy_field (app, GS_APP_LAZY_FIELD_VERSION_HISTORY);
 	locker = g_mutex_locker_new (&priv->mutex);
 	if (priv->version_history == NULL)
 		return NULL;
@@ -6684,6 +7214,7 @@ gs_app_set_version_history (GsApp *app, GPtrArray *version_history)
 	if (version_history != NULL && version_history->len == 0)
 		version_history = NULL;
 
+	gs_app_ensure_lazy_field (app, GS_APP_LAZY_FIELD_VERSION_HISTORY);
 	locker = g_mutex_locker_new (&priv->mutex);
 	_g_set_ptr_array (&priv->version_history, version_history);
 }
@@ -7035,3 +7566,437 @@ gs_app_set_mok_key_pending (GsApp    *app,
 	g_return_if_fail (GS_IS_APP (app));
 	#endif
 }
+
+/**
+ * gs_app_add_refined_flags:
+ * @app: a #GsApp
+ * @flags: the #GsPluginRefineFlags @app has been refined with
+ * @refine_time: monotonic time when the refine started
+ *
+ * Record that @app has been successfully refined with @flags, so that later
+ * refines can skip them while they are still fresh. Modifier flags such as
+ * %GS_PLUGIN_REFINE_FLAGS_ALLOW_PACKAGES are ignored.
+ *
+ * The refine is recorded as happening at @refine_time, rather than when it
+ * finished, so that it is still considered stale if the state of @app
+ * changed or gs_app_invalidate_all_refined_flags() was called while it was
+ * running.
+ *
+ * Since: 48
+ **/
+void
+gs_app_add_refined_flags (GsApp               *app,
+                          GsPluginRefineFlags  flags,
+                          gint64               refine_time)
+{
+	GsAppPrivate *priv = gs_app_get_instance_private (app);
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (GS_IS_APP (app));
+
+	flags &= ~(GS_PLUGIN_REFINE_FLAGS_ALLOW_PACKAGES |
+		   GS_PLUGIN_REFINE_FLAGS_DISABLE_FILTERING);
+	if (flags == 0)
+		return;
+
+	locker = g_mutex_locker_new (&priv->mutex);
+
+	if (priv->refined_time == NULL)
+		priv->refined_time = g_new0 (gint64, 32);
+	for (guint i = 0; i < 32; i++) {
+		if (flags & (1u << i))
+			priv->refined_time[i] = MAX (priv->refined_time[i], refine_time);
+	}
+}
+
+/**
+ * gs_app_get_refined_flags:
+ * @app: a #GsApp
+ * @max_age: maximum age of a refine to count as fresh, in microseconds
+ *
+ * Get the #GsPluginRefineFlags @app has been refined with no more than
+ * @max_age ago, and since its state last changed.
+ *
+ * Returns: the fresh refined flags, or zero
+ *
+ * Since: 48
+ **/
+GsPluginRefineFlags
+gs_app_get_refined_flags (GsApp  *app,
+                          gint64  max_age)
+{
+	GsAppPrivate *priv = gs_app_get_instance_private (app);
+	g_autoptr(GMutexLocker) locker = NULL;
+	GsPluginRefineFlags flags = 0;
+	gint64 now = g_get_monotonic_time ();
+	gint64 invalidated_time;
+
+	g_return_val_if_fail (GS_IS_APP (app), 0);
+
+	g_mutex_lock (&refined_all_mutex);
+	invalidated_time = refined_all_invalidated_time;
+	g_mutex_unlock (&refined_all_mutex);
+
+	locker = g_mutex_locker_new (&priv->mutex);
+
+	if (priv->refined_time == NULL)
+		return 0;
+
+	invalidated_time = MAX (invalidated_time, priv->refined_invalidated_time);
+	for (guint i = 0; i < 32; i++) {
+		gint64 refined_time = priv->refined_time[i];
+		if (refined_time > invalidated_time && now - refined_time <= max_age)
+			flags |= (1u << i);
+	}
+
+	return flags;
+}
+
+/**
+ * gs_app_invalidate_refined_flags:
+ * @app: a #GsApp
+ *
+ * Forget which flags @app has been refined with, so the next refine
+ * requests everything again.
+ *
+ * Since: 48
+ **/
+void
+gs_app_invalidate_refined_flags (GsApp *app)
+{
+	GsAppPrivate *priv = gs_app_get_instance_private (app);
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (GS_IS_APP (app));
+
+	locker = g_mutex_locker_new (&priv->mutex);
+	priv->refined_invalidated_time = g_get_monotonic_time ();
+}
+
+/**
+ * gs_app_invalidate_all_refined_flags:
+ *
+ * Forget which flags every #GsApp has been refined with, for example
+ * because the metadata has changed.
+ *
+ * Since: 48
+ **/
+void
+gs_app_invalidate_all_refined_flags (void)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&refined_all_mutex);
+	refined_all_invalidated_time = g_get_monotonic_time ();
+}
+
+/**
+ * gs_app_set_lazy_loader:
+ * @app: a #GsApp
+ * @fields: the #GsAppLazyField values to load on demand
+ * @load_func: function to load one of the fields
+ * @user_data: (transfer full) (nullable): data to pass to @load_func
+ * @user_data_free: (nullable): function to free @user_data
+ *
+ * Defers setting @fields until they are first read, which saves building
+ * the description, screenshots and version history of apps which are only
+ * ever shown in a list.
+ *
+ * @load_func is called at most once per field, from whichever thread first
+ * reads it. Calling a setter for one of @fields loads it first, so the
+ * result is the same as if @load_func had been called straight away.
+ *
+ * Each field is loaded by the loader most recently set for it, so a field
+ * still waiting for an earlier loader and not in @fields keeps using that
+ * one. @user_data is freed once none of @fields are waiting for it.
+ *
+ * Since: 48
+ **/
+void
+gs_app_set_lazy_loader (GsApp             *app,
+                        GsAppLazyField     fields,
+                        GsAppLazyLoadFunc  load_func,
+                        gpointer           user_data,
+                        GDestroyNotify     user_data_free)
+{
+	GsAppPrivate *priv = gs_app_get_instance_private (app);
+	GsAppLazyLoader *loader;
+
+	g_return_if_fail (GS_IS_APP (app));
+	g_return_if_fail (fields != GS_APP_LAZY_FIELD_NONE);
+	g_return_if_fail (fields < (1u << GS_APP_N_LAZY_FIELDS));
+	g_return_if_fail (load_func != NULL);
+
+	loader = g_rc_box_new0 (GsAppLazyLoader);
+	loader->func = load_func;
+	loader->user_data = user_data;
+	loader->user_data_free = user_data_free;
+
+	g_rec_mutex_lock (&lazy_mutex);
+	for (guint i = 0; i < G_N_ELEMENTS (priv->lazy_loaders); i++) {
+		if ((fields & (1u << i)) == 0)
+			continue;
+		g_clear_pointer (&priv->lazy_loaders[i], gs_app_lazy_loader_unref);
+		priv->lazy_loaders[i] = g_rc_box_acquire (loader);
+	}
+	g_atomic_int_or (&priv->lazy_fields, fields);
+	gs_app_lazy_loader_unref (loader);
+	g_rec_mutex_unlock (&lazy_mutex);
+}
+
+/**
+ * gs_app_drop_lazy_loader:
+ * @app: a #GsApp
+ * @user_data: (nullable): the data passed to gs_app_set_lazy_loader()
+ *
+ * Forgets the fields still waiting to be loaded from @user_data, for example
+ * because the data they would be loaded from has been replaced, and marks
+ * @app as needing to be refined again so they are filled in from the new
+ * data.
+ *
+ * Since: 48
+ **/
+void
+gs_app_drop_lazy_loader (GsApp    *app,
+                         gpointer  user_data)
+{
+	GsAppPrivate *priv = gs_app_get_instance_private (app);
+
+	g_return_if_fail (GS_IS_APP (app));
+
+	g_rec_mutex_lock (&lazy_mutex);
+	for (guint i = 0; i < G_N_ELEMENTS (priv->lazy_loaders); i++) {
+		if (priv->lazy_loaders[i] == NULL ||
+		    priv->lazy_loaders[i]->user_data != user_data)
+			continue;
+		g_atomic_int_and (&priv->lazy_fields, ~(1u << i));
+		g_clear_pointer (&priv->lazy_loaders[i], gs_app_lazy_loader_unref);
+	}
+	g_rec_mutex_unlock (&lazy_mutex);
+
+	gs_app_invalidate_refined_flags (app);
+}
+
+/**
+ * gs_app_get_lazy_fields:
+ * @app: a #GsApp
+ *
+ * Gets the fields set with gs_app_set_lazy_loader() which have not been
+ * read yet.
+ *
+ * Returns: a #GsAppLazyField bitfield
+ *
+ * Since: 48
+ **/
+GsAppLazyField
+gs_app_get_lazy_fields (GsApp *app)
+{
+	GsAppPrivate *priv = gs_app_get_instance_private (app);
+	g_return_val_if_fail (GS_IS_APP (app), GS_APP_LAZY_FIELD_NONE);
+	return g_atomic_int_get (&priv->lazy_fields);
+}
+
+static GsAppSnapshot *
+gs_app_snapshot_new (GsApp *app)
+{
+	GsAppPrivate *priv = gs_app_get_instance_private (app);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->mutex);
+	GsAppSnapshot *snapshot = g_atomic_rc_box_new0 (GsAppSnapshot);
+
+	snapshot->name = g_strdup (priv->name);
+	snapshot->summary = g_strdup (priv->summary);
+	snapshot->version = g_strdup (priv->version);
+	snapshot->state = priv->state;
+	snapshot->size_download_type = priv->size_download_type;
+	snapshot->size_download = priv->size_download;
+	snapshot->size_installed_type = priv->size_installed_type;
+	snapshot->size_installed = priv->size_installed;
+
+	if (priv->icons != NULL && priv->icons->len > 0) {
+		snapshot->icons = g_ptr_array_new_full (priv->icons->len, g_object_unref);
+		for (guint i = 0; i < priv->icons->len; i++)
+			g_ptr_array_add (snapshot->icons, g_object_ref (g_ptr_array_index (priv->icons, i)));
+	}
+
+	return snapshot;
+}
+
+/**
+ * gs_app_dup_snapshot:
+ * @app: a #GsApp
+ *
+ * Get an immutable copy of the most frequently read properties of @app: its
+ * name, summary, version, state, download and installed sizes, and icons.
+ *
+ * This is meant for code which reads several of these at once, such as when
+ * rendering or sorting long lists of apps, while other threads may be
+ * changing them. Unless @app has changed since the last call, this takes no
+ * locks and returns the same snapshot; otherwise a new snapshot is built
+ * once and shared by later callers.
+ *
+ * The snapshot is not updated when @app changes; connect to #GObject::notify
+ * to know when to get a new one.
+ *
+ * Returns: (transfer full): a snapshot of @app
+ *
+ * Since: 48
+ **/
+GsAppSnapshot *
+gs_app_dup_snapshot (GsApp *app)
+{
+	GsAppPrivate *priv = gs_app_get_instance_private (app);
+	GsAppSnapshot *snapshot;
+	gint serial;
+
+	g_return_val_if_fail (GS_IS_APP (app), NULL);
+
+	/* fast path: see gs_app_invalidate_snapshot() for why this needs to
+	 * be bracketed by the readers count */
+	g_atomic_int_inc (&priv->snapshot_readers);
+	snapshot = g_atomic_pointer_get (&priv->snapshot);
+	if (snapshot != NULL)
+		gs_app_snapshot_ref (snapshot);
+	g_atomic_int_dec_and_test (&priv->snapshot_readers);
+
+	if (snapshot != NULL)
+		return snapshot;
+
+	/* slow path: build a new one and publish it, unless another thread
+	 * got there first */
+	serial = g_atomic_int_get (&priv->snapshot_serial);
+	snapshot = gs_app_snapshot_new (app);
+	gs_app_snapshot_ref (snapshot);
+	if (!g_atomic_pointer_compare_and_exchange (&priv->snapshot, NULL, snapshot)) {
+		gs_app_snapshot_unref (snapshot);
+		return snapshot;
+	}
+
+	/* a setter which doesn’t take the mutex changed a field while the
+	 * snapshot was being built, so it may be stale already */
+	if (g_atomic_int_get (&priv->snapshot_serial) != serial)
+		gs_app_invalidate_snapshot (app);
+
+	return snapshot;
+}
+
+/**
+ * gs_app_snapshot_get_name:
+ * @snapshot: a #GsAppSnapshot
+ *
+ * Gets the name of the app, as from gs_app_get_name().
+ *
+ * Returns: (nullable): a string, or %NULL for unset
+ *
+ * Since: 48
+ **/
+const gchar *
+gs_app_snapshot_get_name (GsAppSnapshot *snapshot)
+{
+	return snapshot->name;
+}
+
+/**
+ * gs_app_snapshot_get_summary:
+ * @snapshot: a #GsAppSnapshot
+ *
+ * Gets the summary of the app, as from gs_app_get_summary().
+ *
+ * Returns: (nullable): a string, or %NULL for unset
+ *
+ * Since: 48
+ **/
+const gchar *
+gs_app_snapshot_get_summary (GsAppSnapshot *snapshot)
+{
+	return snapshot->summary;
+}
+
+/**
+ * gs_app_snapshot_get_version:
+ * @snapshot: a #GsAppSnapshot
+ *
+ * Gets the version of the app, as from gs_app_get_version().
+ *
+ * Returns: (nullable): a string, or %NULL for unset
+ *
+ * Since: 48
+ **/
+const gchar *
+gs_app_snapshot_get_version (GsAppSnapshot *snapshot)
+{
+	return snapshot->version;
+}
+
+/**
+ * gs_app_snapshot_get_state:
+ * @snapshot: a #GsAppSnapshot
+ *
+ * Gets the state of the app, as from gs_app_get_state().
+ *
+ * Returns: a #GsAppState
+ *
+ * Since: 48
+ **/
+GsAppState
+gs_app_snapshot_get_state (GsAppSnapshot *snapshot)
+{
+	return snapshot->state;
+}
+
+/**
+ * gs_app_snapshot_get_size_download:
+ * @snapshot: a #GsAppSnapshot
+ * @size_bytes_out: (optional) (out caller-allocates): return location for
+ *   the download size, in bytes, or %NULL to ignore
+ *
+ * Gets the download size of the app, as from gs_app_get_size_download().
+ *
+ * Returns: type of the download size
+ *
+ * Since: 48
+ **/
+GsSizeType
+gs_app_snapshot_get_size_download (GsAppSnapshot *snapshot,
+                                   guint64       *size_bytes_out)
+{
+	if (size_bytes_out != NULL)
+		*size_bytes_out = (snapshot->size_download_type == GS_SIZE_TYPE_VALID) ? snapshot->size_download : 0;
+	return snapshot->size_download_type;
+}
+
+/**
+ * gs_app_snapshot_get_size_installed:
+ * @snapshot: a #GsAppSnapshot
+ * @size_bytes_out: (optional) (out caller-allocates): return location for
+ *   the installed size, in bytes, or %NULL to ignore
+ *
+ * Gets the installed size of the app, as from gs_app_get_size_installed().
+ *
+ * Returns: type of the installed size
+ *
+ * Since: 48
+ **/
+GsSizeType
+gs_app_snapshot_get_size_installed (GsAppSnapshot *snapshot,
+                                    guint64       *size_bytes_out)
+{
+	if (size_bytes_out != NULL)
+		*size_bytes_out = (snapshot->size_installed_type == GS_SIZE_TYPE_VALID) ? snapshot->size_installed : 0;
+	return snapshot->size_installed_type;
+}
+
+/**
+ * gs_app_snapshot_get_icons:
+ * @snapshot: a #GsAppSnapshot
+ *
+ * Gets the icons of the app, sorted by increasing width. The array must not
+ * be modified.
+ *
+ * Returns: (transfer none) (element-type GIcon) (nullable): an array of
+ *   icons, or %NULL if there are no icons
+ *
+ * Since: 48
+ **/
+GPtrArray *
+gs_app_snapshot_get_icons (GsAppSnapshot *snapshot)
+{
+	return snapshot->icons;
+}
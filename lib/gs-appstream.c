@@ -15,6 +15,7 @@
 
 #include "gs-external-appstream-utils.h"
 #include "gs-appstream.h"
+#include "gs-app-private.h"
 
 #define	GS_APPSTREAM_MAX_SCREENSHOTS	5
 
@@ -25,6 +26,49 @@
 #define HAVE_FIXED_LIBXMLB 1
 #endif
 
+/* Creates a new, uncached app for @component, refined just enough to have a
+ * unique ID. */
+static GsApp *
+gs_appstream_new_app_for_component (GsPlugin *plugin,
+				    XbSilo *silo,
+				    XbNode *component,
+				    const gchar *appstream_source_file,
+				    AsComponentScope default_scope,
+				    GError **error)
+{
+	g_autoptr(GsApp) app_new = gs_app_new (NULL);
+
+	/* counted so benchmarks can show how many apps listing creates */
+	gs_metrics_increment_counter ("appstream-apps-created", 1);
+
+	/* refine enough to get the unique ID */
+	if (!gs_appstream_refine_app (plugin, app_new, silo, component,
+				      GS_PLUGIN_REFINE_FLAGS_REQUIRE_ID,
+				      NULL, appstream_source_file, default_scope, error))
+		return NULL;
+
+	return g_steal_pointer (&app_new);
+}
+
+static gboolean
+gs_appstream_app_is_cacheable (GsPlugin *plugin,
+			       GsApp *app)
+{
+	/* never add wildcard apps to the plugin cache, and only add to
+	 * the cache if it’s available */
+	return plugin != NULL && !gs_app_has_quirk (app, GS_APP_QUIRK_IS_WILDCARD);
+}
+
+static void
+gs_appstream_cache_add_app (GsPlugin *plugin,
+			    GsApp *app_new)
+{
+	/* use the temp object we just created */
+	gs_app_set_metadata (app_new, "GnomeSoftware::Creator",
+			     gs_plugin_get_name (plugin));
+	gs_plugin_cache_add (plugin, NULL, app_new);
+}
+
 GsApp *
 gs_appstream_create_app (GsPlugin *plugin,
 			 XbSilo *silo,
@@ -40,20 +84,13 @@ gs_appstream_create_app (GsPlugin *plugin,
 	g_return_val_if_fail (XB_IS_SILO (silo), NULL);
 	g_return_val_if_fail (XB_IS_NODE (component), NULL);
 
-	app_new = gs_app_new (NULL);
-
-	/* refine enough to get the unique ID */
-	if (!gs_appstream_refine_app (plugin, app_new, silo, component,
-				      GS_PLUGIN_REFINE_FLAGS_REQUIRE_ID,
-				      NULL, appstream_source_file, default_scope, error))
+	app_new = gs_appstream_new_app_for_component (plugin, silo, component,
+							appstream_source_file,
+							default_scope, error);
+	if (app_new == NULL)
 		return NULL;
 
-	/* never add wildcard apps to the plugin cache, and only add to
-	 * the cache if it’s available */
-	if (gs_app_has_quirk (app_new, GS_APP_QUIRK_IS_WILDCARD) || plugin == NULL)
-		return g_steal_pointer (&app_new);
-
-	if (plugin == NULL)
+	if (!gs_appstream_app_is_cacheable (plugin, app_new))
 		return g_steal_pointer (&app_new);
 
 	/* look for existing object */
@@ -61,13 +98,89 @@ gs_appstream_create_app (GsPlugin *plugin,
 	if (app != NULL)
 		return app;
 
-	/* use the temp object we just created */
-	gs_app_set_metadata (app_new, "GnomeSoftware::Creator",
-			     gs_plugin_get_name (plugin));
-	gs_plugin_cache_add (plugin, NULL, app_new);
+	gs_appstream_cache_add_app (plugin, app_new);
 	return g_steal_pointer (&app_new);
 }
 
+/**
+ * gs_appstream_create_apps:
+ * @plugin: (nullable): a #GsPlugin, or %NULL
+ * @silo: an #XbSilo
+ * @components: (element-type XbNode): components to create apps for
+ * @appstream_source_file: source file of @silo
+ * @default_scope: default scope for the components
+ * @error: return location for a #GError
+ *
+ * Like gs_appstream_create_app(), but for a whole array of components. The
+ * plugin cache is searched for all of the apps at once using
+ * gs_plugin_cache_lookup_many(), rather than once per component.
+ *
+ * Returns: (transfer container) (element-type GsApp): apps for @components,
+ *   in the same order, or %NULL on error
+ */
+GPtrArray *
+gs_appstream_create_apps (GsPlugin *plugin,
+			  XbSilo *silo,
+			  GPtrArray *components,
+			  const gchar *appstream_source_file,
+			  AsComponentScope default_scope,
+			  GError **error)
+{
+	g_autoptr(GPtrArray) apps = g_ptr_array_new_with_free_func (g_object_unref);
+	g_autoptr(GsAppList) cacheable = gs_app_list_new ();
+	g_autoptr(GsAppList) cached = NULL;
+	g_autoptr(GHashTable) cached_by_id = NULL;
+	g_autoptr(GPtrArray) apps_new = g_ptr_array_new_with_free_func (g_object_unref);
+
+	g_return_val_if_fail (XB_IS_SILO (silo), NULL);
+	g_return_val_if_fail (components != NULL, NULL);
+
+	for (guint i = 0; i < components->len; i++) {
+		XbNode *component = g_ptr_array_index (components, i);
+		GsApp *app_new;
+
+		app_new = gs_appstream_new_app_for_component (plugin, silo, component,
+								appstream_source_file,
+								default_scope, error);
+		if (app_new == NULL)
+			return NULL;
+		g_ptr_array_add (apps_new, app_new);
+		if (gs_appstream_app_is_cacheable (plugin, app_new))
+			gs_app_list_add (cacheable, app_new);
+	}
+
+	/* look for existing objects, all in one go */
+	cached_by_id = g_hash_table_new (g_str_hash, g_str_equal);
+	if (gs_app_list_length (cacheable) > 0) {
+		cached = gs_plugin_cache_lookup_many (plugin, cacheable);
+		for (guint i = 0; i < gs_app_list_length (cached); i++) {
+			GsApp *app = gs_app_list_index (cached, i);
+			g_hash_table_insert (cached_by_id, (gpointer) gs_app_get_unique_id (app), app);
+		}
+	}
+
+	for (guint i = 0; i < apps_new->len; i++) {
+		GsApp *app_new = g_ptr_array_index (apps_new, i);
+		GsApp *app = NULL;
+
+		if (!gs_appstream_app_is_cacheable (plugin, app_new)) {
+			g_ptr_array_add (apps, g_object_ref (app_new));
+			continue;
+		}
+
+		app = g_hash_table_lookup (cached_by_id, gs_app_get_unique_id (app_new));
+		if (app == NULL) {
+			gs_appstream_cache_add_app (plugin, app_new);
+			/* a later duplicate component resolves to this one */
+			g_hash_table_insert (cached_by_id, (gpointer) gs_app_get_unique_id (app_new), app_new);
+			app = app_new;
+		}
+		g_ptr_array_add (apps, g_object_ref (app));
+	}
+
+	return g_steal_pointer (&apps);
+}
+
 /* Helper function to do the equivalent of
  *  *node = xb_node_get_next (*node)
  * but with correct reference counting, since xb_node_get_next() returns a new
@@ -403,6 +516,7 @@ gs_appstream_refine_add_addons (GsPlugin *plugin,
 	g_autofree gchar *xpath = NULL;
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) addons = NULL;
+	g_autoptr(GPtrArray) addon_apps = NULL;
 	g_autoptr(GsAppList) addons_list = NULL;
 
 	/* get all components */
@@ -416,18 +530,13 @@ gs_appstream_refine_add_addons (GsPlugin *plugin,
 		return FALSE;
 	}
 
-	addons_list = gs_app_list_new ();
-
-	for (guint i = 0; i < addons->len; i++) {
-		XbNode *addon = g_ptr_array_index (addons, i);
-		g_autoptr(GsApp) addon_app = NULL;
-
-		addon_app = gs_appstream_create_app (plugin, silo, addon, appstream_source_file, default_scope, error);
-		if (addon_app == NULL)
-			return FALSE;
+	addon_apps = gs_appstream_create_apps (plugin, silo, addons, appstream_source_file, default_scope, error);
+	if (addon_apps == NULL)
+		return FALSE;
 
-		gs_app_list_add (addons_list, addon_app);
-	}
+	addons_list = gs_app_list_new ();
+	for (guint i = 0; i < addon_apps->len; i++)
+		gs_app_list_add (addons_list, g_ptr_array_index (addon_apps, i));
 
 	gs_app_add_addons (app, addons_list);
 
@@ -644,6 +753,327 @@ gs_appstream_find_description_and_issues_nodes (XbNode *release_node,
 		*out_issues_node = g_steal_pointer (&issues_node);
 }
 
+static XbNode *
+gs_appstream_get_child_by_element (XbNode      *parent,
+				   const gchar *element)
+{
+	g_autoptr(XbNode) child = NULL;
+	g_autoptr(XbNode) next = NULL;
+
+	for (child = xb_node_get_child (parent); child != NULL; g_object_unref (child), child = g_steal_pointer (&next)) {
+		next = xb_node_get_next (child);
+		if (g_strcmp0 (xb_node_get_element (child), element) == 0)
+			return g_steal_pointer (&child);
+	}
+
+	return NULL;
+}
+
+static AsRelease *
+gs_appstream_release_new (XbNode *release_node,
+			  XbNode *description_node,
+			  XbNode *issues_node)
+{
+	g_autoptr(AsRelease) release = as_release_new ();
+	g_autofree gchar *description = NULL;
+	guint64 timestamp;
+	const gchar *date_str;
+
+	timestamp = xb_node_get_attr_as_uint (release_node, "timestamp");
+	date_str = xb_node_get_attr (release_node, "date");
+
+	/* include updates with or without a description */
+	if (description_node != NULL || issues_node != NULL)
+		description = gs_appstream_format_description (description_node, issues_node);
+
+	as_release_set_version (release, xb_node_get_attr (release_node, "version"));
+	if (timestamp != G_MAXUINT64)
+		as_release_set_timestamp (release, timestamp);
+	else if (date_str != NULL)  /* timestamp takes precedence over date */
+		as_release_set_date (release, date_str);
+	if (description != NULL)
+		as_release_set_description (release, description, NULL);
+
+	return g_steal_pointer (&release);
+}
+
+static void
+gs_appstream_refine_app_version_history (GsApp  *app,
+					 XbNode *releases)
+{
+	g_autoptr(GPtrArray) version_history = g_ptr_array_new_with_free_func (g_object_unref);
+	g_autoptr(XbNode) child = NULL;
+	g_autoptr(XbNode) next = NULL;
+
+	for (child = xb_node_get_child (releases); child != NULL; g_object_unref (child), child = g_steal_pointer (&next)) {
+		g_autoptr(XbNode) description_node = NULL;
+		g_autoptr(XbNode) issues_node = NULL;
+
+		next = xb_node_get_next (child);
+		if (g_strcmp0 (xb_node_get_element (child), "release") != 0)
+			continue;
+
+		/* ignore releases with no version */
+		if (xb_node_get_attr (child, "version") == NULL)
+			continue;
+
+		gs_appstream_find_description_and_issues_nodes (child, &description_node, &issues_node);
+		g_ptr_array_add (version_history, gs_appstream_release_new (child, description_node, issues_node));
+	}
+
+	if (version_history->len > 0)
+		gs_app_set_version_history (app, version_history);
+}
+
+/* whether gs_appstream_refine_app_screenshots() would add anything */
+static gboolean
+gs_appstream_has_screenshots (XbNode *screenshots)
+{
+	g_autoptr(XbNode) child = NULL;
+	g_autoptr(XbNode) next = NULL;
+
+	for (child = xb_node_get_child (screenshots); child != NULL; g_object_unref (child), child = g_steal_pointer (&next)) {
+		g_autoptr(XbNode) image = NULL;
+		g_autoptr(XbNode) video = NULL;
+
+		next = xb_node_get_next (child);
+		if (g_strcmp0 (xb_node_get_element (child), "screenshot") != 0)
+			continue;
+
+		image = gs_appstream_get_child_by_element (child, "image");
+		if (image != NULL)
+			return TRUE;
+		video = gs_appstream_get_child_by_element (child, "video");
+		if (video != NULL)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void
+gs_appstream_refine_app_screenshots (GsApp  *app,
+				     XbNode *screenshots)
+{
+	g_autoptr(XbNode) scrs_child = NULL;
+	g_autoptr(XbNode) scrs_next = NULL;
+
+	for (scrs_child = xb_node_get_child (screenshots); scrs_child != NULL; g_object_unref (scrs_child), scrs_child = g_steal_pointer (&scrs_next)) {
+		scrs_next = xb_node_get_next (scrs_child);
+		if (g_strcmp0 (xb_node_get_element (scrs_child), "screenshot") == 0) {
+			g_autoptr(AsScreenshot) scr = as_screenshot_new ();
+			g_autoptr(XbNode) scr_child = NULL;
+			g_autoptr(XbNode) scr_next = NULL;
+			gboolean any_added = FALSE;
+			for (scr_child = xb_node_get_child (scrs_child); scr_child != NULL; g_object_unref (scr_child), scr_child = g_steal_pointer (&scr_next)) {
+				scr_next = xb_node_get_next (scr_child);
+				if (g_strcmp0 (xb_node_get_element (scr_child), "image") == 0) {
+					g_autoptr(AsImage) im = as_image_new ();
+					as_image_set_height (im, xb_node_get_attr_as_uint (scr_child, "height"));
+					as_image_set_width (im, xb_node_get_attr_as_uint (scr_child, "width"));
+					as_image_set_kind (im, as_image_kind_from_string (xb_node_get_attr (scr_child, "type")));
+					as_image_set_url (im, xb_node_get_text (scr_child));
+					as_screenshot_add_image (scr, im);
+					any_added = TRUE;
+				} else if (g_strcmp0 (xb_node_get_element (scr_child), "video") == 0) {
+					g_autoptr(AsVideo) vid = as_video_new ();
+					as_video_set_height (vid, xb_node_get_attr_as_uint (scr_child, "height"));
+					as_video_set_width (vid, xb_node_get_attr_as_uint (scr_child, "width"));
+					as_video_set_codec_kind (vid, as_video_codec_kind_from_string (xb_node_get_attr (scr_child, "codec")));
+					as_video_set_container_kind (vid, as_video_container_kind_from_string (xb_node_get_attr (scr_child, "container")));
+					as_video_set_url (vid, xb_node_get_text (scr_child));
+					as_screenshot_add_video (scr, vid);
+					any_added = TRUE;
+				}
+			}
+			if (any_added)
+				gs_app_add_screenshot (app, scr);
+		}
+	}
+}
+
+/* The component the lazy fields of a #GsApp are loaded from. The silo is
+ * kept so the app can be refined again once it has been regenerated.
+ *
+ * Refcounted: the app’s lazy loader holds one reference, and the set in
+ * lazy_data_by_silo holds another while the silo is still in use, so that
+ * gs_appstream_drop_lazy_data() can pass it to gs_app_drop_lazy_loader()
+ * without its address being reused by a newer loader in the meantime. */
+typedef struct {
+	XbSilo		*silo;  /* (owned) (nullable) (locked-by lazy_data_mutex) */
+	XbNode		*component;  /* (owned) (nullable) (locked-by lazy_data_mutex) */
+	GWeakRef	 app;  /* (element-type GsApp) */
+} GsAppstreamLazyData;
+
+/* All the GsAppstreamLazyData still referencing each silo, so that
+ * gs_appstream_drop_lazy_data() can let go of an old silo straight away
+ * rather than once every app refined from it has been read or freed */
+static GMutex lazy_data_mutex;
+static GHashTable *lazy_data_by_silo = NULL;  /* (owned) (nullable) (element-type XbSilo GHashTable), keys are not reffed */
+
+static void
+gs_appstream_lazy_data_clear (GsAppstreamLazyData *data)
+{
+	g_clear_object (&data->silo);
+	g_clear_object (&data->component);
+	g_weak_ref_clear (&data->app);
+}
+
+static void
+gs_appstream_lazy_data_unref (GsAppstreamLazyData *data)
+{
+	g_atomic_rc_box_release_full (data, (GDestroyNotify) gs_appstream_lazy_data_clear);
+}
+
+static GsAppstreamLazyData *
+gs_appstream_lazy_data_new (GsApp  *app,
+			    XbSilo *silo,
+			    XbNode *component)
+{
+	GsAppstreamLazyData *data = g_atomic_rc_box_new0 (GsAppstreamLazyData);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&lazy_data_mutex);
+	GHashTable *set;
+
+	data->silo = g_object_ref (silo);
+	data->component = g_object_ref (component);
+	g_weak_ref_init (&data->app, app);
+
+	if (lazy_data_by_silo == NULL)
+		lazy_data_by_silo = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+							   NULL, (GDestroyNotify) g_hash_table_unref);
+	set = g_hash_table_lookup (lazy_data_by_silo, silo);
+	if (set == NULL) {
+		set = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+					     (GDestroyNotify) gs_appstream_lazy_data_unref, NULL);
+		g_hash_table_insert (lazy_data_by_silo, silo, set);
+	}
+	g_hash_table_add (set, g_atomic_rc_box_acquire (data));
+
+	return data;
+}
+
+/* the #GDestroyNotify for the app’s lazy loader */
+static void
+gs_appstream_lazy_data_free (gpointer user_data)
+{
+	GsAppstreamLazyData *data = user_data;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&lazy_data_mutex);
+
+	/* already gone if gs_appstream_drop_lazy_data() was called; this
+	 * drops the set’s reference */
+	if (data->silo != NULL) {
+		GHashTable *set = g_hash_table_lookup (lazy_data_by_silo, data->silo);
+		g_hash_table_remove (set, data);
+		if (g_hash_table_size (set) == 0)
+			g_hash_table_remove (lazy_data_by_silo, data->silo);
+	}
+	g_clear_object (&data->silo);
+	g_clear_object (&data->component);
+	g_clear_pointer (&locker, g_mutex_locker_free);
+
+	gs_appstream_lazy_data_unref (data);
+}
+
+/**
+ * gs_appstream_drop_lazy_data:
+ * @silo: an #XbSilo which is being replaced
+ *
+ * Drops the references which apps refined from @silo hold on it for the
+ * fields they load on demand, and marks those apps as needing to be refined
+ * again. Call this when @silo is invalidated, so its mapping is freed as
+ * soon as the plugin is done with it.
+ **/
+void
+gs_appstream_drop_lazy_data (XbSilo *silo)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&lazy_data_mutex);
+	g_autoptr(GHashTable) set = NULL;
+	g_autoptr(GPtrArray) apps = g_ptr_array_new_with_free_func (g_object_unref);
+	g_autoptr(GPtrArray) datas = g_ptr_array_new_with_free_func ((GDestroyNotify) gs_appstream_lazy_data_unref);
+	g_autoptr(GPtrArray) objects = g_ptr_array_new_with_free_func (g_object_unref);
+	GHashTableIter iter;
+	gpointer key;
+
+	g_return_if_fail (XB_IS_SILO (silo));
+
+	if (lazy_data_by_silo == NULL ||
+	    !g_hash_table_steal_extended (lazy_data_by_silo, silo, NULL, (gpointer *) &set))
+		return;
+
+	/* take over the set’s references, so each @data stays alive, and its
+	 * address can’t be reused for another app’s loader, until the apps
+	 * have been updated below */
+	g_hash_table_iter_init (&iter, set);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		GsAppstreamLazyData *data = key;
+		GsApp *app = g_weak_ref_get (&data->app);
+
+		g_hash_table_iter_steal (&iter);
+		g_ptr_array_add (objects, g_steal_pointer (&data->silo));
+		g_ptr_array_add (objects, g_steal_pointer (&data->component));
+		if (app != NULL) {
+			g_ptr_array_add (apps, app);
+			g_ptr_array_add (datas, data);
+		} else {
+			gs_appstream_lazy_data_unref (data);
+		}
+	}
+	g_clear_pointer (&locker, g_mutex_locker_free);
+
+	g_debug ("dropping lazy data of %u apps", apps->len);
+
+	/* this is a no-op for apps which have been refined again since, as
+	 * their loader no longer has @data */
+	for (guint i = 0; i < apps->len; i++)
+		gs_app_drop_lazy_loader (g_ptr_array_index (apps, i), g_ptr_array_index (datas, i));
+}
+
+static gboolean
+gs_appstream_lazy_load_cb (GsApp          *app,
+			   GsAppLazyField  field,
+			   gpointer        user_data)
+{
+	GsAppstreamLazyData *data = user_data;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&lazy_data_mutex);
+	g_autoptr(XbSilo) silo = (data->silo != NULL) ? g_object_ref (data->silo) : NULL;
+	g_autoptr(XbNode) component = (data->component != NULL) ? g_object_ref (data->component) : NULL;
+	g_autoptr(XbNode) node = NULL;
+
+	g_clear_pointer (&locker, g_mutex_locker_free);
+
+	/* dropped since, so the app is already due to be refined again */
+	if (component == NULL)
+		return FALSE;
+
+	/* an invalidated silo is still readable while referenced, so fill
+	 * in the field with what @app was refined with either way */
+	switch (field) {
+	case GS_APP_LAZY_FIELD_DESCRIPTION:
+		node = gs_appstream_get_child_by_element (component, "description");
+		if (node != NULL) {
+			g_autofree gchar *description = gs_appstream_format_description (node, NULL);
+			if (description != NULL)
+				gs_app_set_description (app, GS_APP_QUALITY_HIGHEST, description);
+		}
+		break;
+	case GS_APP_LAZY_FIELD_SCREENSHOTS:
+		node = gs_appstream_get_child_by_element (component, "screenshots");
+		if (node != NULL)
+			gs_appstream_refine_app_screenshots (app, node);
+		break;
+	case GS_APP_LAZY_FIELD_VERSION_HISTORY:
+		node = gs_appstream_get_child_by_element (component, "releases");
+		if (node != NULL)
+			gs_appstream_refine_app_version_history (app, node);
+		break;
+	case GS_APP_LAZY_FIELD_NONE:
+	default:
+		g_assert_not_reached ();
+	}
+
+	return xb_silo_is_valid (silo);
+}
+
 typedef enum {
 	ELEMENT_KIND_UNKNOWN = -1,
 	ELEMENT_KIND_BRANDING,
@@ -741,6 +1171,7 @@ gs_appstream_refine_app (GsPlugin *plugin,
 	g_autoptr(XbNode) launchable_desktop_id = NULL;
 	g_autoptr(XbNode) child = NULL;
 	g_autoptr(XbNode) next = NULL;
+	GsAppLazyField lazy_fields = GS_APP_LAZY_FIELD_NONE;
 
 	/* The 'plugin' can be NULL, when creating app for --show-metainfo */
 	g_return_val_if_fail (GS_IS_APP (app), FALSE);
@@ -962,10 +1393,13 @@ gs_appstream_refine_app (GsPlugin *plugin,
 			}
 			} break;
 		case ELEMENT_KIND_DESCRIPTION:
+			/* formatted when first shown; an empty description
+			 * would not have replaced one set by an earlier refine,
+			 * so must not replace the source of a pending one */
 			if ((refine_flags & GS_PLUGIN_REFINE_FLAGS_REQUIRE_DESCRIPTION) != 0) {
-				g_autofree gchar *description = gs_appstream_format_description (child, NULL);
-				if (description != NULL)
-					gs_app_set_description (app, GS_APP_QUALITY_HIGHEST, description);
+				g_autoptr(XbNode) first = xb_node_get_child (child);
+				if (first != NULL)
+					lazy_fields |= GS_APP_LAZY_FIELD_DESCRIPTION;
 			}
 			break;
 		case ELEMENT_KIND_DEVELOPER:
@@ -1203,8 +1637,7 @@ gs_appstream_refine_app (GsPlugin *plugin,
 			}
 			break;
 		case ELEMENT_KIND_RELEASES: {
-			g_autoptr(GPtrArray) current_version_history = gs_app_get_version_history (app);
-			gboolean needs_version_history = current_version_history == NULL || current_version_history->len == 0;
+			gboolean needs_version_history = FALSE;
 			gboolean needs_update_details = (refine_flags & GS_PLUGIN_REFINE_FLAGS_REQUIRE_UPDATE_DETAILS) != 0 &&
 							silo != NULL && gs_app_is_updatable (app);
 			/* set the release date */
@@ -1228,6 +1661,20 @@ gs_appstream_refine_app (GsPlugin *plugin,
 					}
 				}
 			}
+			/* one still waiting to be loaded from an earlier refine
+			 * counts as being set, as it would have been if built
+			 * straight away */
+			if ((gs_app_get_lazy_fields (app) & GS_APP_LAZY_FIELD_VERSION_HISTORY) == 0) {
+				g_autoptr(GPtrArray) current_version_history = gs_app_get_version_history (app);
+				needs_version_history = current_version_history == NULL || current_version_history->len == 0;
+			}
+			/* the version history is only shown on the details page, so
+			 * build it when first asked for unless the releases have to
+			 * be walked for the update details anyway */
+			if (needs_version_history && !needs_update_details) {
+				lazy_fields |= GS_APP_LAZY_FIELD_VERSION_HISTORY;
+				needs_version_history = FALSE;
+			}
 			if (needs_version_history || needs_update_details) {
 				g_autoptr(GPtrArray) version_history = NULL; /* (element-type AsRelease) */
 				g_autoptr(GHashTable) installed = NULL;
@@ -1285,30 +1732,8 @@ gs_appstream_refine_app (GsPlugin *plugin,
 
 					gs_appstream_find_description_and_issues_nodes (rels_child, &description_node, &issues_node);
 
-					if (version_history != NULL) {
-						g_autoptr(AsRelease) release = NULL;
-						g_autofree gchar *description = NULL;
-						guint64 timestamp;
-						const gchar *date_str;
-
-						timestamp = xb_node_get_attr_as_uint (rels_child, "timestamp");
-						date_str = xb_node_get_attr (rels_child, "date");
-
-						/* include updates with or without a description */
-						if (description_node != NULL || issues_node != NULL)
-							description = gs_appstream_format_description (description_node, issues_node);
-
-						release = as_release_new ();
-						as_release_set_version (release, version);
-						if (timestamp != G_MAXUINT64)
-							as_release_set_timestamp (release, timestamp);
-						else if (date_str != NULL)  /* timestamp takes precedence over date */
-							as_release_set_date (release, date_str);
-						if (description != NULL)
-							as_release_set_description (release, description, NULL);
-
-						g_ptr_array_add (version_history, g_steal_pointer (&release));
-					}
+					if (version_history != NULL)
+						g_ptr_array_add (version_history, gs_appstream_release_new (rels_child, description_node, issues_node));
 
 					if (needs_update_details) {
 						AsUrgencyKind urgency_tmp;
@@ -1398,45 +1823,15 @@ gs_appstream_refine_app (GsPlugin *plugin,
 			}
 			break;
 		case ELEMENT_KIND_SCREENSHOTS:
+			/* only check there are some for the kudo, the rest is
+			 * parsed when they are first shown */
 			if ((refine_flags & GS_PLUGIN_REFINE_FLAGS_REQUIRE_SCREENSHOTS) != 0 &&
-			    gs_app_get_screenshots (app)->len == 0) {
-				g_autoptr(XbNode) scrs_child = NULL;
-				g_autoptr(XbNode) scrs_next = NULL;
-				for (scrs_child = xb_node_get_child (child); scrs_child != NULL; g_object_unref (scrs_child), scrs_child = g_steal_pointer (&scrs_next)) {
-					scrs_next = xb_node_get_next (scrs_child);
-					if (g_strcmp0 (xb_node_get_element (scrs_child), "screenshot") == 0) {
-						g_autoptr(AsScreenshot) scr = as_screenshot_new ();
-						g_autoptr(XbNode) scr_child = NULL;
-						g_autoptr(XbNode) scr_next = NULL;
-						gboolean any_added = FALSE;
-						for (scr_child = xb_node_get_child (scrs_child); scr_child != NULL; g_object_unref (scr_child), scr_child = g_steal_pointer (&scr_next)) {
-							scr_next = xb_node_get_next (scr_child);
-							if (g_strcmp0 (xb_node_get_element (scr_child), "image") == 0) {
-								g_autoptr(AsImage) im = as_image_new ();
-								as_image_set_height (im, xb_node_get_attr_as_uint (scr_child, "height"));
-								as_image_set_width (im, xb_node_get_attr_as_uint (scr_child, "width"));
-								as_image_set_kind (im, as_image_kind_from_string (xb_node_get_attr (scr_child, "type")));
-								as_image_set_url (im, xb_node_get_text (scr_child));
-								as_screenshot_add_image (scr, im);
-								any_added = TRUE;
-							} else if (g_strcmp0 (xb_node_get_element (scr_child), "video") == 0) {
-								g_autoptr(AsVideo) vid = as_video_new ();
-								as_video_set_height (vid, xb_node_get_attr_as_uint (scr_child, "height"));
-								as_video_set_width (vid, xb_node_get_attr_as_uint (scr_child, "width"));
-								as_video_set_codec_kind (vid, as_video_codec_kind_from_string (xb_node_get_attr (scr_child, "codec")));
-								as_video_set_container_kind (vid, as_video_container_kind_from_string (xb_node_get_attr (scr_child, "container")));
-								as_video_set_url (vid, xb_node_get_text (scr_child));
-								as_screenshot_add_video (scr, vid);
-								any_added = TRUE;
-							}
-						}
-						if (any_added)
-							gs_app_add_screenshot (app, scr);
-					}
-				}
+			    (gs_app_get_lazy_fields (app) & GS_APP_LAZY_FIELD_SCREENSHOTS) == 0 &&
+			    gs_app_get_screenshots (app)->len == 0 &&
+			    gs_appstream_has_screenshots (child)) {
+				lazy_fields |= GS_APP_LAZY_FIELD_SCREENSHOTS;
 				/* FIXME: move into no refine flags section? */
-				if (gs_app_get_screenshots (app)->len)
-					gs_app_add_kudo (app, GS_APP_KUDO_HAS_SCREENSHOTS);
+				gs_app_add_kudo (app, GS_APP_KUDO_HAS_SCREENSHOTS);
 			}
 			break;
 		case ELEMENT_KIND_SUMMARY:
@@ -1465,6 +1860,12 @@ gs_appstream_refine_app (GsPlugin *plugin,
 		}
 	}
 
+	if (lazy_fields != GS_APP_LAZY_FIELD_NONE) {
+		GsAppstreamLazyData *data = gs_appstream_lazy_data_new (app, silo, component);
+		gs_app_set_lazy_loader (app, lazy_fields, gs_appstream_lazy_load_cb,
+					data, gs_appstream_lazy_data_free);
+	}
+
 	if (developer_name_fallback != NULL &&
 	    gs_app_get_developer_name (app) == NULL) {
 		gs_app_set_developer_name (app, developer_name_fallback);
@@ -1613,6 +2014,18 @@ gs_appstream_read_silo_info_from_component (XbNode *component,
 	}
 }
 
+typedef enum {
+	MATCH_KIND_TOKENS,	/* `[text()~=stem(?)]` */
+	MATCH_KIND_CONTAINS,	/* `[contains(text(),stem(?))]` */
+} MatchKind;
+
+typedef struct {
+	guint16			match_value;
+	const gchar		*element;	/* relative to the component */
+	const gchar		*attr;		/* (nullable), match the text if %NULL */
+	MatchKind		 kind;
+} Query;
+
 typedef struct {
 	guint16			 match_value;
 	XbQuery			*query;
@@ -1625,6 +2038,21 @@ gs_appstream_search_helper_free (GsAppstreamSearchHelper *helper)
 	g_free (helper);
 }
 
+static gchar *
+gs_appstream_query_build_xpath (const Query *query)
+{
+	g_autofree gchar *subject = NULL;
+
+	if (query->attr != NULL)
+		subject = g_strdup_printf ("@%s", query->attr);
+	else
+		subject = g_strdup ("text()");
+
+	if (query->kind == MATCH_KIND_CONTAINS)
+		return g_strdup_printf ("%s[contains(%s,stem(?))]", query->element, subject);
+	return g_strdup_printf ("%s[%s~=stem(?)]", query->element, subject);
+}
+
 static guint16
 gs_appstream_silo_search_component2 (GPtrArray *array, XbNode *component, const gchar *search)
 {
@@ -1643,56 +2071,410 @@ gs_appstream_silo_search_component2 (GPtrArray *array, XbNode *component, const
 	return match_value;
 }
 
-static guint16
-gs_appstream_silo_search_component (GPtrArray *array, XbNode *component, const gchar * const *search)
+/* The search index is an inverted index of every word found in the searched
+ * fields of the components of a silo. Words are split and casefolded with
+ * g_str_tokenize_and_fold(), as libxmlb does for the `~=` operator, and their
+ * ASCII alternates (such as `cafe` for `café`) are indexed too.
+ * The distinct words are compiled into a small silo of their own, so the
+ * same `~=` and `contains()` operators (including stemming of the search
+ * term) can be run once per search token over the distinct words, rather
+ * than once per component and field. Words from the elements which the
+ * component silo tokenizes are tokenized in the index too, with
+ * xb_builder_node_tokenize_text(), so `~=` compares the search term with
+ * them exactly as it would with the component’s own tokens.
+ *
+ * Each word has a posting list of the (component, query) pairs it was found
+ * in, stored in its `p` attribute as `component.query` pairs separated by
+ * commas, so the index is self-contained and can be saved next to the
+ * component silo. It is keyed on the GUID of the component silo, so a saved
+ * index is only used for the silo it was built for.
+ *
+ * gs_appstream_search_index_build() builds or loads the index when a plugin
+ * compiles its silo. Otherwise, it is built the first time a silo is
+ * searched. Either way it is attached to the silo, so it is thrown away along
+ * with the silo when that is regenerated. */
+typedef struct {
+	XbSilo			*silo;		/* (owned) */
+	XbQuery			*tokens_query;	/* (owned) */
+	XbQuery			*contains_query; /* (owned) */
+} GsAppstreamSearchIndex;
+
+/* The index for one silo and query table, attached to the silo. The index is
+ * built with the mutex held, so concurrent searches of the same silo wait for
+ * one build, without blocking searches of other silos. */
+typedef struct {
+	GMutex			 mutex;
+	GsAppstreamSearchIndex	*index;		/* (owned) (nullable) (locked-by mutex) */
+} GsAppstreamSearchIndexSlot;
+
+/* bump this when the format of the saved index changes */
+#define GS_APPSTREAM_SEARCH_INDEX_VERSION "1"
+
+static void
+gs_appstream_search_index_free (GsAppstreamSearchIndex *index)
 {
-	guint16 matches_sum = 0;
+	g_clear_object (&index->tokens_query);
+	g_clear_object (&index->contains_query);
+	g_clear_object (&index->silo);
+	g_free (index);
+}
 
-	/* do *all* search keywords match */
-	for (guint i = 0; search[i] != NULL; i++) {
-		guint tmp = gs_appstream_silo_search_component2 (array, component, search[i]);
-		if (tmp == 0)
-			return 0;
-		matches_sum |= tmp;
-	}
-	return matches_sum;
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GsAppstreamSearchIndex, gs_appstream_search_index_free)
+
+static void
+gs_appstream_search_index_slot_free (GsAppstreamSearchIndexSlot *slot)
+{
+	g_clear_pointer (&slot->index, gs_appstream_search_index_free);
+	g_mutex_clear (&slot->mutex);
+	g_free (slot);
 }
 
-typedef struct {
-	guint16			match_value;
-	const gchar		*xpath;
-} Query;
+static void
+gs_appstream_search_index_postings_free (GString *postings)
+{
+	g_string_free (postings, TRUE);
+}
 
-static gboolean
-gs_appstream_do_search (GsPlugin *plugin,
-			XbSilo *silo,
-			const gchar * const *values,
-			const Query queries[],
-			GsAppList *list,
-			GCancellable *cancellable,
-			GError **error)
+static void
+gs_appstream_search_index_add_word (GHashTable *words, /* (element-type utf8 GString) */
+				    const gchar *word,
+				    guint32 component,
+				    guint32 query)
 {
-	AsComponentScope default_scope = AS_COMPONENT_SCOPE_UNKNOWN;
-	g_autofree gchar *silo_filename = NULL;
-	g_autoptr(GError) error_local = NULL;
-	g_autoptr(GPtrArray) array = g_ptr_array_new_with_free_func ((GDestroyNotify) gs_appstream_search_helper_free);
-	g_autoptr(GPtrArray) components = NULL;
-	g_autoptr(GTimer) timer = g_timer_new ();
-#if AS_CHECK_VERSION(1, 0, 0)
-	const guint16 component_id_weight = as_utils_get_tag_search_weight ("id");
-#else
-	const guint16 component_id_weight = AS_SEARCH_TOKEN_MATCH_ID;
-#endif
+	GString *postings = g_hash_table_lookup (words, word);
 
-	g_return_val_if_fail (GS_IS_PLUGIN (plugin), FALSE);
-	g_return_val_if_fail (XB_IS_SILO (silo), FALSE);
-	g_return_val_if_fail (values != NULL, FALSE);
-	g_return_val_if_fail (GS_IS_APP_LIST (list), FALSE);
+	if (postings == NULL) {
+		postings = g_string_new (NULL);
+		g_hash_table_insert (words, g_strdup (word), postings);
+	} else {
+		g_string_append_c (postings, ',');
+	}
+	g_string_append_printf (postings, "%" G_GUINT32_FORMAT ".%" G_GUINT32_FORMAT, component, query);
+}
 
-	/* add some weighted queries */
-	for (guint i = 0; queries[i].xpath != NULL; i++) {
+static void
+gs_appstream_search_index_add_text (GHashTable *words, /* (element-type utf8 GString) */
+				    const gchar *text,
+				    guint32 component,
+				    guint32 query)
+{
+	g_auto(GStrv) tokens = NULL;
+	g_auto(GStrv) ascii_alternates = NULL;
+
+	if (text == NULL)
+		return;
+
+	tokens = g_str_tokenize_and_fold (text, NULL, &ascii_alternates);
+	for (guint i = 0; tokens[i] != NULL; i++)
+		gs_appstream_search_index_add_word (words, tokens[i], component, query);
+	for (guint i = 0; ascii_alternates[i] != NULL; i++)
+		gs_appstream_search_index_add_word (words, ascii_alternates[i], component, query);
+}
+
+/* Whether the silo tokenizes the text which @query matches */
+static gboolean
+gs_appstream_search_query_is_tokenized (const Query *query,
+					const gchar * const *tokenized_elements)
+{
+	const gchar *element;
+
+	if (tokenized_elements == NULL || query->attr != NULL)
+		return FALSE;
+
+	element = strrchr (query->element, '/');
+	element = (element != NULL) ? element + 1 : query->element;
+
+	return g_strv_contains (tokenized_elements, element);
+}
+
+static void
+gs_appstream_search_index_insert_words (XbBuilderNode *root,
+					GHashTable *words, /* (element-type utf8 GString) */
+					gboolean tokenize)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_hash_table_iter_init (&iter, words);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		GString *postings = value;
+		g_autoptr(XbBuilderNode) bn = xb_builder_node_insert (root, "w", "p", postings->str, NULL);
+
+		xb_builder_node_set_text (bn, key, -1);
+		if (tokenize)
+			xb_builder_node_tokenize_text (bn);
+	}
+}
+
+static GsAppstreamSearchIndex *
+gs_appstream_search_index_new_for_silo (XbSilo *index_silo,
+					GError **error)
+{
+	g_autoptr(GsAppstreamSearchIndex) index = g_new0 (GsAppstreamSearchIndex, 1);
+
+	index->silo = g_object_ref (index_silo);
+	index->tokens_query = xb_query_new (index->silo, "index/w[text()~=stem(?)]", error);
+	if (index->tokens_query == NULL)
+		return NULL;
+	index->contains_query = xb_query_new (index->silo, "index/w[contains(text(),stem(?))]", error);
+	if (index->contains_query == NULL)
+		return NULL;
+
+	return g_steal_pointer (&index);
+}
+
+/* Builds the index silo for @components of @silo. Words found by the
+ * @queries on the elements in @tokenized_elements are tokenized the same way
+ * as the silo tokenizes them; pass %NULL if the silo has no tokens. */
+static XbSilo *
+gs_appstream_search_index_compile (XbSilo *silo,
+				   GPtrArray *components,
+				   const Query queries[],
+				   const gchar * const *tokenized_elements,
+				   GCancellable *cancellable,
+				   GError **error)
+{
+	g_autoptr(GHashTable) words = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) gs_appstream_search_index_postings_free);
+	g_autoptr(GHashTable) tokenized_words = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) gs_appstream_search_index_postings_free);
+	g_autoptr(XbBuilder) builder = xb_builder_new ();
+	g_autoptr(XbBuilderNode) root = xb_builder_node_new ("index");
+	g_autoptr(XbSilo) index_silo = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+	g_autofree gchar *silo_guid = xb_silo_get_guid (silo);
+
+	xb_builder_node_set_attr (root, "version", GS_APPSTREAM_SEARCH_INDEX_VERSION);
+	xb_builder_node_set_attr (root, "silo", silo_guid);
+
+	for (guint i = 0; i < components->len; i++) {
+		XbNode *component = g_ptr_array_index (components, i);
+
+		for (guint j = 0; queries[j].element != NULL; j++) {
+			g_autoptr(GPtrArray) nodes = xb_node_query (component, queries[j].element, 0, NULL);
+			GHashTable *query_words = gs_appstream_search_query_is_tokenized (&queries[j], tokenized_elements) ? tokenized_words : words;
+
+			for (guint k = 0; nodes != NULL && k < nodes->len; k++) {
+				XbNode *n = g_ptr_array_index (nodes, k);
+				const gchar *text;
+
+				if (queries[j].attr != NULL)
+					text = xb_node_get_attr (n, queries[j].attr);
+				else
+					text = xb_node_get_text (n);
+				gs_appstream_search_index_add_text (query_words, text, i, j);
+			}
+		}
+
+		if (g_cancellable_set_error_if_cancelled (cancellable, error))
+			return NULL;
+	}
+
+	gs_appstream_search_index_insert_words (root, words, FALSE);
+	gs_appstream_search_index_insert_words (root, tokenized_words, TRUE);
+	xb_builder_import_node (builder, root);
+
+	index_silo = xb_builder_compile (builder, XB_BUILDER_COMPILE_FLAG_NONE, cancellable, error);
+	if (index_silo == NULL)
+		return NULL;
+
+	g_debug ("building search index of %u words for %u components took %fms",
+		 g_hash_table_size (words) + g_hash_table_size (tokenized_words),
+		 components->len, g_timer_elapsed (timer, NULL) * 1000);
+
+	return g_steal_pointer (&index_silo);
+}
+
+/* Loads the index saved in @file, if it was built for @silo */
+static XbSilo *
+gs_appstream_search_index_load (XbSilo *silo,
+				GFile *file,
+				GCancellable *cancellable)
+{
+	g_autoptr(XbSilo) index_silo = xb_silo_new ();
+	g_autoptr(XbNode) root = NULL;
+	g_autoptr(GError) local_error = NULL;
+	g_autofree gchar *silo_guid = xb_silo_get_guid (silo);
+
+	if (!xb_silo_load_from_file (index_silo, file, XB_SILO_LOAD_FLAG_NONE, cancellable, &local_error)) {
+		if (!g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+			g_debug ("failed to load search index: %s", local_error->message);
+		return NULL;
+	}
+
+	root = xb_silo_query_first (index_silo, "index", NULL);
+	if (root == NULL ||
+	    g_strcmp0 (xb_node_get_attr (root, "version"), GS_APPSTREAM_SEARCH_INDEX_VERSION) != 0 ||
+	    g_strcmp0 (xb_node_get_attr (root, "silo"), silo_guid) != 0)
+		return NULL;
+
+	return g_steal_pointer (&index_silo);
+}
+
+/* Returns (transfer none) the slot for the index of @silo identified by @key,
+ * adding it if needed; it is owned by @silo. */
+static GsAppstreamSearchIndexSlot *
+gs_appstream_search_index_get_slot (XbSilo *silo,
+				    const gchar *key)
+{
+	GsAppstreamSearchIndexSlot *slot;
+	GsAppstreamSearchIndexSlot *new_slot;
+
+	slot = g_object_get_data (G_OBJECT (silo), key);
+	if (slot != NULL)
+		return slot;
+
+	new_slot = g_new0 (GsAppstreamSearchIndexSlot, 1);
+	g_mutex_init (&new_slot->mutex);
+	if (g_object_replace_data (G_OBJECT (silo), key, NULL, new_slot,
+				   (GDestroyNotify) gs_appstream_search_index_slot_free, NULL))
+		return new_slot;
+
+	/* another thread added it first */
+	gs_appstream_search_index_slot_free (new_slot);
+	return g_object_get_data (G_OBJECT (silo), key);
+}
+
+/* Returns (transfer none) the index for @silo, building it if needed; it is
+ * owned by @silo. @key identifies the @queries table the index is built for.
+ *
+ * If @file is set, the index is loaded from it if it was saved there for
+ * @silo, or saved to it otherwise. */
+static GsAppstreamSearchIndex *
+gs_appstream_search_index_ensure (XbSilo *silo,
+				  const gchar *key,
+				  const Query queries[],
+				  const gchar * const *tokenized_elements,
+				  GFile *file,
+				  GCancellable *cancellable,
+				  GError **error)
+{
+	GsAppstreamSearchIndexSlot *slot = gs_appstream_search_index_get_slot (silo, key);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&slot->mutex);
+	g_autoptr(XbSilo) index_silo = NULL;
+	g_autoptr(GPtrArray) components = NULL;
+
+	if (slot->index != NULL)
+		return slot->index;
+
+	if (file != NULL)
+		index_silo = gs_appstream_search_index_load (silo, file, cancellable);
+
+	if (index_silo == NULL) {
+		components = xb_silo_query (silo, "components/component", 0, error);
+		if (components == NULL)
+			return NULL;
+		index_silo = gs_appstream_search_index_compile (silo, components, queries, tokenized_elements,
+								cancellable, error);
+		if (index_silo == NULL)
+			return NULL;
+
+		if (file != NULL) {
+			g_autoptr(GError) local_error = NULL;
+
+			if (!xb_silo_save_to_file (index_silo, file, cancellable, &local_error))
+				g_debug ("failed to save search index: %s", local_error->message);
+		}
+	}
+
+	slot->index = gs_appstream_search_index_new_for_silo (index_silo, error);
+
+	return slot->index;
+}
+
+/* Only search tokens which g_str_tokenize_and_fold() keeps as a single word
+ * can be looked up in the index; anything else can match across word
+ * boundaries. */
+static gboolean
+gs_appstream_search_index_can_lookup (const gchar *search)
+{
+	g_auto(GStrv) tokens = g_str_tokenize_and_fold (search, NULL, NULL);
+
+	if (tokens[0] == NULL || tokens[1] != NULL)
+		return FALSE;
+	for (const gchar *p = search; *p != '\0'; p = g_utf8_next_char (p)) {
+		gunichar c = g_utf8_get_char (p);
+		if (!g_unichar_isalnum (c) && !g_unichar_ismark (c))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+gs_appstream_search_index_lookup (GsAppstreamSearchIndex *index,
+				  const Query queries[],
+				  guint n_components,
+				  MatchKind kind,
+				  const gchar *search,
+				  guint16 *matches,
+				  GError **error)
+{
+	XbQuery *query = (kind == MATCH_KIND_TOKENS) ? index->tokens_query : index->contains_query;
+	g_auto(XbQueryContext) context = XB_QUERY_CONTEXT_INIT ();
+	g_autoptr(GPtrArray) words = NULL;
+	g_autoptr(GError) error_local = NULL;
+	guint n_queries = 0;
+
+	while (queries[n_queries].element != NULL)
+		n_queries++;
+
+	xb_value_bindings_bind_str (xb_query_context_get_bindings (&context), 0, search, NULL);
+	words = xb_silo_query_with_context (index->silo, query, &context, &error_local);
+	if (words == NULL) {
+		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+			return TRUE;
+		g_propagate_error (error, g_steal_pointer (&error_local));
+		return FALSE;
+	}
+
+	for (guint i = 0; i < words->len; i++) {
+		XbNode *word = g_ptr_array_index (words, i);
+		const gchar *p = xb_node_get_attr (word, "p");
+
+		/* parse the `component.query` pairs */
+		while (p != NULL && *p != '\0') {
+			gchar *end = NULL;
+			guint64 component = g_ascii_strtoull (p, &end, 10);
+			guint64 query_idx;
+
+			if (end == p || *end != '.')
+				break;
+			p = end + 1;
+			query_idx = g_ascii_strtoull (p, &end, 10);
+			if (end == p)
+				break;
+			p = (*end == ',') ? end + 1 : end;
+
+			if (component < n_components && query_idx < n_queries &&
+			    queries[query_idx].kind == kind)
+				matches[component] |= queries[query_idx].match_value;
+		}
+	}
+
+	return TRUE;
+}
+
+/* Returns (transfer full) the match value of each of @components for the
+ * search tokens in @values, which is zero if it doesn’t match all of them. */
+static guint16 *
+gs_appstream_match_components (XbSilo *silo,
+			       const gchar *index_key,
+			       GPtrArray *components,
+			       const gchar * const *values,
+			       const Query queries[],
+			       GCancellable *cancellable,
+			       GError **error)
+{
+	GsAppstreamSearchIndex *index;
+	g_autofree guint16 *match_values = NULL;
+	g_autofree guint16 *token_matches = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) array = g_ptr_array_new_with_free_func ((GDestroyNotify) gs_appstream_search_helper_free);
+
+	/* add some weighted queries, used for search tokens which can’t
+	 * be looked up in the index */
+	for (guint i = 0; queries[i].element != NULL; i++) {
 		g_autoptr(GError) error_query = NULL;
-		g_autoptr(XbQuery) query = xb_query_new (silo, queries[i].xpath, &error_query);
+		g_autofree gchar *xpath = gs_appstream_query_build_xpath (&queries[i]);
+		g_autoptr(XbQuery) query = xb_query_new (silo, xpath, &error_query);
 		if (query != NULL) {
 			GsAppstreamSearchHelper *helper = g_new0 (GsAppstreamSearchHelper, 1);
 			helper->match_value = queries[i].match_value;
@@ -1703,6 +2485,123 @@ gs_appstream_do_search (GsPlugin *plugin,
 		}
 	}
 
+	index = gs_appstream_search_index_ensure (silo, index_key, queries, NULL, NULL, cancellable, &error_local);
+	if (index == NULL) {
+		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			g_propagate_error (error, g_steal_pointer (&error_local));
+			return NULL;
+		}
+		g_debug ("not using search index: %s", error_local->message);
+		g_clear_error (&error_local);
+	}
+
+	/* do *all* search keywords match; a component is still a candidate
+	 * while its match value is non-zero */
+	match_values = g_new0 (guint16, components->len);
+	token_matches = g_new (guint16, components->len);
+	for (guint i = 0; values[i] != NULL; i++) {
+		memset (token_matches, 0, components->len * sizeof (guint16));
+
+		if (index != NULL && gs_appstream_search_index_can_lookup (values[i])) {
+			if (!gs_appstream_search_index_lookup (index, queries, components->len, MATCH_KIND_TOKENS, values[i], token_matches, error) ||
+			    !gs_appstream_search_index_lookup (index, queries, components->len, MATCH_KIND_CONTAINS, values[i], token_matches, error))
+				return NULL;
+		} else {
+			for (guint j = 0; j < components->len; j++) {
+				if (i > 0 && match_values[j] == 0)
+					continue;
+				token_matches[j] = gs_appstream_silo_search_component2 (array, g_ptr_array_index (components, j), values[i]);
+			}
+		}
+
+		for (guint j = 0; j < components->len; j++) {
+			if (token_matches[j] == 0 || (i > 0 && match_values[j] == 0))
+				match_values[j] = 0;
+			else
+				match_values[j] |= token_matches[j];
+		}
+
+		if (g_cancellable_set_error_if_cancelled (cancellable, error))
+			return NULL;
+	}
+
+	return g_steal_pointer (&match_values);
+}
+
+static gint
+compare_guint16_descending (gconstpointer a,
+			    gconstpointer b,
+			    gpointer user_data)
+{
+	guint16 value_a = *((const guint16 *) a);
+	guint16 value_b = *((const guint16 *) b);
+
+	return (gint) value_b - (gint) value_a;
+}
+
+/* Returns the lowest match value, with @mask removed, which a component needs
+ * to be among the best @max_results matches; all the components with that
+ * match value are kept, so ties aren’t broken arbitrarily. Returns 0 if all
+ * the matches should be kept. */
+static guint16
+gs_appstream_get_match_value_cutoff (const guint16 *match_values,
+				     guint n_match_values,
+				     guint16 mask,
+				     guint max_results)
+{
+	g_autoptr(GArray) matched = NULL;
+
+	if (max_results == 0)
+		return 0;
+
+	matched = g_array_new (FALSE, FALSE, sizeof (guint16));
+	for (guint i = 0; i < n_match_values; i++) {
+		if (match_values[i] != 0) {
+			guint16 value = match_values[i] & (~mask);
+			g_array_append_val (matched, value);
+		}
+	}
+
+	if (matched->len <= max_results)
+		return 0;
+
+	g_array_sort_with_data (matched, compare_guint16_descending, NULL);
+
+	return g_array_index (matched, guint16, max_results - 1);
+}
+
+/* If @max_results is non-zero, only the components with the best
+ * @max_results match values are returned, plus any which tie with the last of
+ * them, as ranked by gs_utils_app_sort_match_value(). */
+static gboolean
+gs_appstream_do_search (GsPlugin *plugin,
+			XbSilo *silo,
+			const gchar *index_key,
+			const gchar * const *values,
+			const Query queries[],
+			GsAppList *list,
+			guint max_results,
+			GCancellable *cancellable,
+			GError **error)
+{
+	AsComponentScope default_scope = AS_COMPONENT_SCOPE_UNKNOWN;
+	g_autofree gchar *silo_filename = NULL;
+	g_autofree guint16 *match_values = NULL;
+	guint16 match_value_cutoff;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) components = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+#if AS_CHECK_VERSION(1, 0, 0)
+	const guint16 component_id_weight = as_utils_get_tag_search_weight ("id");
+#else
+	const guint16 component_id_weight = AS_SEARCH_TOKEN_MATCH_ID;
+#endif
+
+	g_return_val_if_fail (GS_IS_PLUGIN (plugin), FALSE);
+	g_return_val_if_fail (XB_IS_SILO (silo), FALSE);
+	g_return_val_if_fail (values != NULL, FALSE);
+	g_return_val_if_fail (GS_IS_APP_LIST (list), FALSE);
+
 	/* get all components */
 	components = xb_silo_query (silo, "components/component", 0, &error_local);
 	if (components == NULL) {
@@ -1714,10 +2613,19 @@ gs_appstream_do_search (GsPlugin *plugin,
 	if (components->len > 0)
 		gs_appstream_read_silo_info_from_component (g_ptr_array_index (components, 0), &silo_filename, &default_scope);
 
+	match_values = gs_appstream_match_components (silo, index_key, components, values, queries, cancellable, error);
+	if (match_values == NULL)
+		return FALSE;
+
+	/* only create apps for the best matches, if that’s all which is needed */
+	match_value_cutoff = gs_appstream_get_match_value_cutoff (match_values, components->len,
+								  component_id_weight, max_results);
+
 	for (guint i = 0; i < components->len; i++) {
 		XbNode *component = g_ptr_array_index (components, i);
-		guint16 match_value = gs_appstream_silo_search_component (array, component, values);
-		if (match_value != 0) {
+		guint16 match_value = match_values[i];
+		if (match_value != 0 &&
+		    (match_value & (~component_id_weight)) >= match_value_cutoff) {
 			g_autoptr(GsApp) app = gs_appstream_create_app (plugin, silo, component, silo_filename ? silo_filename : "", default_scope, error);
 			if (app == NULL)
 				return FALSE;
@@ -1761,56 +2669,257 @@ gs_appstream_do_search (GsPlugin *plugin,
 	return TRUE;
 }
 
+/* The queries used by gs_appstream_search(), and by
+ * gs_appstream_search_match_apps() to rank apps the same way; terminated by
+ * an entry with a %NULL element. */
+static const Query *
+gs_appstream_search_get_queries (void)
+{
+	static Query queries[11];
+	static gsize queries_initialised = 0;
+
+	if (g_once_init_enter (&queries_initialised)) {
+#if AS_CHECK_VERSION(1, 0, 0)
+		guint16 pkgname_weight = as_utils_get_tag_search_weight ("pkgname");
+		guint16 name_weight = as_utils_get_tag_search_weight ("name");
+		guint16 id_weight = as_utils_get_tag_search_weight ("id");
+		const Query tmp[] = {
+			{ as_utils_get_tag_search_weight ("mediatype"),	"provides/mediatype",	NULL,		MATCH_KIND_TOKENS },
+			/* Search once with a tokenize-and-casefold operator (`~=`) to support casefolded
+			 * full-text search, then again using substring matching (`contains()`), to
+			 * support prefix matching. Only do the prefix matches on a few fields, and at a
+			 * lower priority, otherwise things will get confusing.
+			 *
+			 * See https://gitlab.gnome.org/GNOME/gnome-software/-/issues/2277 */
+			{ pkgname_weight,				"pkgname",		NULL,		MATCH_KIND_TOKENS },
+			{ pkgname_weight / 2,				"pkgname",		NULL,		MATCH_KIND_CONTAINS },
+			{ as_utils_get_tag_search_weight ("summary"),	"summary",		NULL,		MATCH_KIND_TOKENS },
+			{ name_weight,					"name",			NULL,		MATCH_KIND_TOKENS },
+			{ name_weight / 2,				"name",			NULL,		MATCH_KIND_CONTAINS },
+			{ as_utils_get_tag_search_weight ("keyword"),	"keywords/keyword",	NULL,		MATCH_KIND_TOKENS },
+			{ id_weight,					"id",			NULL,		MATCH_KIND_TOKENS },
+			{ id_weight,					"launchable",		NULL,		MATCH_KIND_TOKENS },
+			{ as_utils_get_tag_search_weight ("origin"),	"../components",	"origin",	MATCH_KIND_TOKENS },
+			{ 0,						NULL,			NULL,		MATCH_KIND_TOKENS }
+		};
+#else
+		const Query tmp[] = {
+			{ AS_SEARCH_TOKEN_MATCH_MEDIATYPE,	"mimetypes/mimetype",	NULL,		MATCH_KIND_TOKENS },
+			{ AS_SEARCH_TOKEN_MATCH_PKGNAME,	"pkgname",		NULL,		MATCH_KIND_TOKENS },
+			{ AS_SEARCH_TOKEN_MATCH_PKGNAME / 2,	"pkgname",		NULL,		MATCH_KIND_CONTAINS },
+			{ AS_SEARCH_TOKEN_MATCH_SUMMARY,	"summary",		NULL,		MATCH_KIND_TOKENS },
+			{ AS_SEARCH_TOKEN_MATCH_NAME,		"name",			NULL,		MATCH_KIND_TOKENS },
+			{ AS_SEARCH_TOKEN_MATCH_NAME / 2,	"name",			NULL,		MATCH_KIND_CONTAINS },
+			{ AS_SEARCH_TOKEN_MATCH_KEYWORD,	"keywords/keyword",	NULL,		MATCH_KIND_TOKENS },
+			{ AS_SEARCH_TOKEN_MATCH_ID,		"id",			NULL,		MATCH_KIND_TOKENS },
+			{ AS_SEARCH_TOKEN_MATCH_ID,		"launchable",		NULL,		MATCH_KIND_TOKENS },
+			{ AS_SEARCH_TOKEN_MATCH_ORIGIN,		"../components",	"origin",	MATCH_KIND_TOKENS },
+			{ AS_SEARCH_TOKEN_MATCH_NONE,		NULL,			NULL,		MATCH_KIND_TOKENS }
+		};
+#endif
+
+		G_STATIC_ASSERT (sizeof (tmp) == sizeof (queries));
+		memcpy (queries, tmp, sizeof (tmp));
+		g_once_init_leave (&queries_initialised, 1);
+	}
+
+	return queries;
+}
+
 /* This tokenises and stems @values internally for comparison against the
- * already-stemmed tokens in the libxmlb silo */
+ * already-stemmed tokens in the libxmlb silo.
+ *
+ * If @max_results is non-zero, only about that many of the best matches are
+ * added to @list; pass gs_app_query_get_max_candidates() for the query, with
+ * gs_utils_app_sort_match_value(). */
 gboolean
 gs_appstream_search (GsPlugin *plugin,
 		     XbSilo *silo,
 		     const gchar * const *values,
 		     GsAppList *list,
+		     guint max_results,
 		     GCancellable *cancellable,
 		     GError **error)
+{
+	return gs_appstream_do_search (plugin, silo, "gs-appstream-search-index",
+				       values, gs_appstream_search_get_queries (),
+				       list, max_results, cancellable, error);
+}
+
+/* Returns (transfer full) a silo with a component for each of @list, in the
+ * same order, holding the fields of the apps which gs_appstream_search()
+ * matches against, so that gs_appstream_search_match_apps() can rank them
+ * the same way as the silo they came from. */
+XbSilo *
+gs_appstream_search_silo_new_for_apps (GsAppList *list,
+				       GCancellable *cancellable,
+				       GError **error)
+{
+	g_autoptr(XbBuilder) builder = xb_builder_new ();
+
+	g_return_val_if_fail (GS_IS_APP_LIST (list), NULL);
+
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		GsApp *app = gs_app_list_index (list, i);
+		GPtrArray *sources = gs_app_get_sources (app);
+		const gchar *fields[][2] = {
+			{ "id",		gs_app_get_id (app) },
+			{ "name",	gs_app_get_name (app) },
+			{ "summary",	gs_app_get_summary (app) },
+			{ "launchable",	gs_app_get_launchable (app, AS_LAUNCHABLE_KIND_DESKTOP_ID) },
+		};
+		g_autoptr(XbBuilderNode) root = xb_builder_node_new ("components");
+		g_autoptr(XbBuilderNode) component = xb_builder_node_insert (root, "component", NULL);
+
+		/* one root per app, as the origin is an attribute of it */
+		if (gs_app_get_origin (app) != NULL)
+			xb_builder_node_set_attr (root, "origin", gs_app_get_origin (app));
+		for (guint j = 0; j < G_N_ELEMENTS (fields); j++) {
+			if (fields[j][1] != NULL)
+				xb_builder_node_insert_text (component, fields[j][0], fields[j][1], NULL);
+		}
+		for (guint j = 0; sources != NULL && j < sources->len; j++)
+			xb_builder_node_insert_text (component, "pkgname", g_ptr_array_index (sources, j), NULL);
+
+		xb_builder_import_node (builder, root);
+	}
+
+	return xb_builder_compile (builder, XB_BUILDER_COMPILE_FLAG_NONE, cancellable, error);
+}
+
+/* Returns (transfer full) the match value of each app in @silo, which must
+ * have come from gs_appstream_search_silo_new_for_apps(), for the search
+ * tokens in @values. It is zero for the apps which don’t match all of them,
+ * and is what gs_appstream_search() would have matched them with otherwise.
+ * The array has one element per app, or is %NULL on error. */
+guint16 *
+gs_appstream_search_match_apps (XbSilo *silo,
+				const gchar * const *values,
+				GCancellable *cancellable,
+				GError **error)
+{
+	g_autoptr(GPtrArray) components = NULL;
+
+	g_return_val_if_fail (XB_IS_SILO (silo), NULL);
+	g_return_val_if_fail (values != NULL, NULL);
+
+	components = xb_silo_query (silo, "components/component", 0, error);
+	if (components == NULL)
+		return NULL;
+
+	return gs_appstream_match_components (silo, "gs-appstream-search-index", components,
+					      values, gs_appstream_search_get_queries (),
+					      cancellable, error);
+}
+
+/* Returns whether every app which gs_appstream_search() matches with
+ * @keyword is also matched with @prev_keyword, which @keyword extends.
+ *
+ * That isn’t always the case, as the search terms are stemmed before being
+ * matched as prefixes, and a longer word can have a shorter stem than its
+ * prefix (such as `running` and `runn`). The stems can’t be got directly, so
+ * instead both keywords are matched against each prefix of @keyword with the
+ * same operator and tokenising as the search: @keyword only narrows the
+ * search if every prefix which matches it also matches @prev_keyword. */
+gboolean
+gs_appstream_search_keyword_narrows (const gchar *keyword,
+				     const gchar *prev_keyword)
+{
+	g_autofree gchar *folded = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new ();
+	g_autoptr(XbBuilderNode) root = xb_builder_node_new ("prefixes");
+	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(XbQuery) query = NULL;
+	g_autoptr(GPtrArray) matches = NULL;
+	g_autoptr(GPtrArray) prev_matches = NULL;
+	g_autoptr(GError) local_error = NULL;
+	g_auto(XbQueryContext) context = XB_QUERY_CONTEXT_INIT ();
+	g_auto(XbQueryContext) prev_context = XB_QUERY_CONTEXT_INIT ();
+
+	g_return_val_if_fail (keyword != NULL, FALSE);
+	g_return_val_if_fail (prev_keyword != NULL, FALSE);
+
+	/* only single words are prefixes of each other */
+	if (!gs_appstream_search_index_can_lookup (keyword) ||
+	    !gs_appstream_search_index_can_lookup (prev_keyword))
+		return FALSE;
+
+	folded = g_utf8_casefold (keyword, -1);
+	for (const gchar *p = folded; *p != '\0'; ) {
+		g_autoptr(XbBuilderNode) bn = NULL;
+		g_autofree gchar *prefix = NULL;
+
+		p = g_utf8_next_char (p);
+		prefix = g_strndup (folded, p - folded);
+		bn = xb_builder_node_insert (root, "p", NULL);
+		xb_builder_node_set_text (bn, prefix, -1);
+		xb_builder_node_tokenize_text (bn);
+	}
+	xb_builder_import_node (builder, root);
+
+	silo = xb_builder_compile (builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &local_error);
+	if (silo != NULL)
+		query = xb_query_new (silo, "prefixes/p[text()~=stem(?)]", &local_error);
+	if (query == NULL) {
+		g_debug ("failed to compare search keywords: %s", local_error->message);
+		return FALSE;
+	}
+
+	xb_value_bindings_bind_str (xb_query_context_get_bindings (&context), 0, keyword, NULL);
+	matches = xb_silo_query_with_context (silo, query, &context, NULL);
+	xb_value_bindings_bind_str (xb_query_context_get_bindings (&prev_context), 0, prev_keyword, NULL);
+	prev_matches = xb_silo_query_with_context (silo, query, &prev_context, NULL);
+
+	/* if no prefix matches, the stem isn’t a prefix of @keyword, so
+	 * there’s no telling what it matches */
+	if (matches == NULL)
+		return FALSE;
+	for (guint i = 0; i < matches->len; i++) {
+		const gchar *text = xb_node_get_text (g_ptr_array_index (matches, i));
+		gboolean found = FALSE;
+
+		for (guint j = 0; prev_matches != NULL && j < prev_matches->len && !found; j++)
+			found = (g_strcmp0 (text, xb_node_get_text (g_ptr_array_index (prev_matches, j))) == 0);
+		if (!found)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* The queries used by gs_appstream_search_developer_apps(); terminated by an
+ * entry with a %NULL element. */
+static const Query *
+gs_appstream_search_developer_get_queries (void)
 {
 #if AS_CHECK_VERSION(1, 0, 0)
-	guint16 pkgname_weight = as_utils_get_tag_search_weight ("pkgname");
-	guint16 name_weight = as_utils_get_tag_search_weight ("name");
-	guint16 id_weight = as_utils_get_tag_search_weight ("id");
-	const Query queries[] = {
-		{ as_utils_get_tag_search_weight ("mediatype"),	"provides/mediatype[text()~=stem(?)]" },
-		/* Search once with a tokenize-and-casefold operator (`~=`) to support casefolded
-		 * full-text search, then again using substring matching (`contains()`), to
-		 * support prefix matching. Only do the prefix matches on a few fields, and at a
-		 * lower priority, otherwise things will get confusing.
-		 *
-		 * See https://gitlab.gnome.org/GNOME/gnome-software/-/issues/2277 */
-		{ pkgname_weight,				"pkgname[text()~=stem(?)]" },
-		{ pkgname_weight / 2,				"pkgname[contains(text(),stem(?))]" },
-		{ as_utils_get_tag_search_weight ("summary"),	"summary[text()~=stem(?)]" },
-		{ name_weight,					"name[text()~=stem(?)]" },
-		{ name_weight / 2,				"name[contains(text(),stem(?))]" },
-		{ as_utils_get_tag_search_weight ("keyword"),	"keywords/keyword[text()~=stem(?)]" },
-		{ id_weight,					"id[text()~=stem(?)]" },
-		{ id_weight,					"launchable[text()~=stem(?)]" },
-		{ as_utils_get_tag_search_weight ("origin"),	"../components[@origin~=stem(?)]" },
-		{ 0,						NULL }
-	};
+	static Query queries[4];
+	static gsize queries_initialised = 0;
+
+	if (g_once_init_enter (&queries_initialised)) {
+		const Query tmp[] = {
+			{ as_utils_get_tag_search_weight ("pkgname"), "developer/name",	NULL,	MATCH_KIND_TOKENS },
+			{ as_utils_get_tag_search_weight ("summary"), "project_group",	NULL,	MATCH_KIND_TOKENS },
+			/* for legacy support */
+			{ as_utils_get_tag_search_weight ("pkgname"), "developer_name",	NULL,	MATCH_KIND_TOKENS },
+			{ 0,					      NULL,		NULL,	MATCH_KIND_TOKENS }
+		};
+
+		G_STATIC_ASSERT (sizeof (tmp) == sizeof (queries));
+		memcpy (queries, tmp, sizeof (tmp));
+		g_once_init_leave (&queries_initialised, 1);
+	}
+
+	return queries;
 #else
-	const Query queries[] = {
-		{ AS_SEARCH_TOKEN_MATCH_MEDIATYPE,	"mimetypes/mimetype[text()~=stem(?)]" },
-		{ AS_SEARCH_TOKEN_MATCH_PKGNAME,	"pkgname[text()~=stem(?)]" },
-		{ AS_SEARCH_TOKEN_MATCH_PKGNAME / 2,	"pkgname[contains(text(),stem(?))]" },
-		{ AS_SEARCH_TOKEN_MATCH_SUMMARY,	"summary[text()~=stem(?)]" },
-		{ AS_SEARCH_TOKEN_MATCH_NAME,		"name[text()~=stem(?)]" },
-		{ AS_SEARCH_TOKEN_MATCH_NAME / 2,	"name[contains(text(),stem(?))]" },
-		{ AS_SEARCH_TOKEN_MATCH_KEYWORD,	"keywords/keyword[text()~=stem(?)]" },
-		{ AS_SEARCH_TOKEN_MATCH_ID,		"id[text()~=stem(?)]" },
-		{ AS_SEARCH_TOKEN_MATCH_ID,		"launchable[text()~=stem(?)]" },
-		{ AS_SEARCH_TOKEN_MATCH_ORIGIN,		"../components[@origin~=stem(?)]" },
-		{ AS_SEARCH_TOKEN_MATCH_NONE,		NULL }
+	static const Query queries[] = {
+		{ AS_SEARCH_TOKEN_MATCH_PKGNAME,	"developer_name",	NULL,	MATCH_KIND_TOKENS },
+		{ AS_SEARCH_TOKEN_MATCH_SUMMARY,	"project_group",	NULL,	MATCH_KIND_TOKENS },
+		{ AS_SEARCH_TOKEN_MATCH_NONE,		NULL,			NULL,	MATCH_KIND_TOKENS }
 	};
-#endif
 
-	return gs_appstream_do_search (plugin, silo, values, queries, list, cancellable, error);
+	return queries;
+#endif
 }
 
 gboolean
@@ -1821,23 +2930,56 @@ gs_appstream_search_developer_apps (GsPlugin *plugin,
 				    GCancellable *cancellable,
 				    GError **error)
 {
-#if AS_CHECK_VERSION(1, 0, 0)
-	const Query queries[] = {
-		{ as_utils_get_tag_search_weight ("pkgname"), "developer/name[text()~=stem(?)]" },
-		{ as_utils_get_tag_search_weight ("summary"), "project_group[text()~=stem(?)]" },
-		/* for legacy support */
-		{ as_utils_get_tag_search_weight ("pkgname"), "developer_name[text()~=stem(?)]" },
-		{ 0,					      NULL }
-	};
-#else
-	const Query queries[] = {
-		{ AS_SEARCH_TOKEN_MATCH_PKGNAME,	"developer_name[text()~=stem(?)]" },
-		{ AS_SEARCH_TOKEN_MATCH_SUMMARY,	"project_group[text()~=stem(?)]" },
-		{ AS_SEARCH_TOKEN_MATCH_NONE,		NULL }
+	return gs_appstream_do_search (plugin, silo, "gs-appstream-search-developer-index",
+				       values, gs_appstream_search_developer_get_queries (),
+				       list, 0, cancellable, error);
+}
+
+/* Builds the indexes which gs_appstream_search() and
+ * gs_appstream_search_developer_apps() use for @silo, so the first search
+ * doesn’t have to. Call this when the silo is compiled.
+ *
+ * @tokenized_elements lists the elements which were tokenized when compiling
+ * @silo, so the index tokenizes the words from them in the same way.
+ *
+ * If @silo_file is set, the indexes are saved next to it, and loaded from
+ * there rather than rebuilt as long as @silo is unchanged. */
+gboolean
+gs_appstream_search_index_build (XbSilo *silo,
+				 GFile *silo_file,
+				 const gchar * const *tokenized_elements,
+				 GCancellable *cancellable,
+				 GError **error)
+{
+	const struct {
+		const gchar *key;
+		const Query *queries;
+	} tables[] = {
+		{ "gs-appstream-search-index", gs_appstream_search_get_queries () },
+		{ "gs-appstream-search-developer-index", gs_appstream_search_developer_get_queries () },
 	};
-#endif
+	g_autofree gchar *silo_path = NULL;
+
+	g_return_val_if_fail (XB_IS_SILO (silo), FALSE);
+	g_return_val_if_fail (silo_file == NULL || G_IS_FILE (silo_file), FALSE);
 
-	return gs_appstream_do_search (plugin, silo, values, queries, list, cancellable, error);
+	if (silo_file != NULL)
+		silo_path = g_file_get_path (silo_file);
+
+	for (gsize i = 0; i < G_N_ELEMENTS (tables); i++) {
+		g_autoptr(GFile) file = NULL;
+
+		if (silo_path != NULL) {
+			g_autofree gchar *path = g_strconcat (silo_path, ".", tables[i].key, NULL);
+			file = g_file_new_for_path (path);
+		}
+		if (gs_appstream_search_index_ensure (silo, tables[i].key, tables[i].queries,
+						      tokenized_elements, file,
+						      cancellable, error) == NULL)
+			return FALSE;
+	}
+
+	return TRUE;
 }
 
 gboolean
@@ -1904,38 +3046,91 @@ gs_appstream_add_category_apps (GsPlugin *plugin,
 	return TRUE;
 }
 
-static guint
-gs_appstream_count_component_for_groups (XbSilo      *silo,
-                                         const gchar *desktop_group)
+static void
+increment_category_count (GHashTable  *histogram,
+                          const gchar *group)
 {
-	/* the overview page checks for 100 apps, then try to get them */
-	const guint limit = 100;
-	g_autofree gchar *xpath = NULL;
-	g_auto(GStrv) split = g_strsplit (desktop_group, "::", -1);
+	gpointer key, value;
+
+	if (g_hash_table_lookup_extended (histogram, group, &key, &value))
+		g_hash_table_insert (histogram, key, GUINT_TO_POINTER (GPOINTER_TO_UINT (value) + 1));
+	else
+		g_hash_table_insert (histogram, g_strdup (group), GUINT_TO_POINTER (1));
+}
+
+/* Count the components in @silo in each desktop group, in a single pass over
+ * the categories of every component, rather than querying each group in turn.
+ * The histogram maps both single categories (`Graphics`) and ordered pairs of
+ * categories (`Graphics::Viewer`) to the number of components which have all
+ * of them. Silos are immutable, so this is cached on @silo and dropped with
+ * it when the silo is rebuilt. */
+static GHashTable *
+gs_appstream_dup_category_histogram (XbSilo        *silo,
+                                     GCancellable  *cancellable,
+                                     GError       **error)
+{
+	const gchar *data_key = "GnomeSoftware::category-histogram";
+	g_autoptr(GHashTable) histogram = NULL;
 	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GPtrArray) categories = g_ptr_array_new ();
+	g_autoptr(GString) pair = g_string_new (NULL);
 	g_autoptr(GError) error_local = NULL;
+	GHashTable *cached;
 
-	if (g_strv_length (split) == 1) { /* "all" group for a parent category */
-		xpath = g_strdup_printf ("components/component[not(@merge)]/categories/"
-					 "category[text()='%s']/../..",
-					 split[0]);
-	} else if (g_strv_length (split) == 2) {
-		xpath = g_strdup_printf ("components/component[not(@merge)]/categories/"
-					 "category[text()='%s']/../"
-					 "category[text()='%s']/../..",
-					 split[0], split[1]);
-	} else {
-		return 0;
+	/* this is never replaced once set, so stays valid as long as @silo */
+	cached = g_object_get_data (G_OBJECT (silo), data_key);
+	if (cached != NULL)
+		return g_hash_table_ref (cached);
+
+	if (g_cancellable_set_error_if_cancelled (cancellable, error))
+		return NULL;
+
+	histogram = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	array = xb_silo_query (silo, "components/component[not(@merge)]/categories", 0, &error_local);
+	if (array == NULL &&
+	    !g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND)) {
+		g_propagate_error (error, g_steal_pointer (&error_local));
+		return NULL;
 	}
 
-	array = xb_silo_query (silo, xpath, limit, &error_local);
-	if (array == NULL) {
-		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-			return 0;
-		g_warning ("%s", error_local->message);
-		return 0;
+	for (guint i = 0; array != NULL && i < array->len; i++) {
+		XbNode *categories_node = g_ptr_array_index (array, i);
+
+		/* each category of the component, only once */
+		g_ptr_array_set_size (categories, 0);
+		for (g_autoptr(XbNode) n = xb_node_get_child (categories_node); n != NULL; node_set_to_next (&n)) {
+			const gchar *category = xb_node_get_text (n);
+			if (g_strcmp0 (xb_node_get_element (n), "category") != 0 || category == NULL)
+				continue;
+			if (!g_ptr_array_find_with_equal_func (categories, category, g_str_equal, NULL))
+				g_ptr_array_add (categories, (gpointer) category);
+		}
+
+		for (guint j = 0; j < categories->len; j++) {
+			const gchar *category = g_ptr_array_index (categories, j);
+
+			increment_category_count (histogram, category);
+			for (guint k = 0; k < categories->len; k++) {
+				if (k == j)
+					continue;
+				g_string_printf (pair, "%s::%s", category,
+						 (const gchar *) g_ptr_array_index (categories, k));
+				increment_category_count (histogram, pair->str);
+			}
+		}
 	}
-	return array->len;
+
+	g_debug ("counted %u categories and pairs of categories in %u components",
+		 g_hash_table_size (histogram), (array != NULL) ? array->len : 0);
+
+	/* another thread may have got there first, in which case both
+	 * histograms are the same and the extra reference is dropped */
+	if (!g_object_replace_data (G_OBJECT (silo), data_key, NULL,
+				    g_hash_table_ref (histogram),
+				    (GDestroyNotify) g_hash_table_unref, NULL))
+		g_hash_table_unref (histogram);
+
+	return g_steal_pointer (&histogram);
 }
 
 /* we're not actually adding categories here, we're just setting the number of
@@ -1946,9 +3141,22 @@ gs_appstream_refine_category_sizes (XbSilo        *silo,
                                     GCancellable  *cancellable,
                                     GError       **error)
 {
+	g_autoptr(GHashTable) histogram = NULL;
+	g_autoptr(GError) error_local = NULL;
+
 	g_return_val_if_fail (XB_IS_SILO (silo), FALSE);
 	g_return_val_if_fail (list != NULL, FALSE);
 
+	histogram = gs_appstream_dup_category_histogram (silo, cancellable, &error_local);
+	if (histogram == NULL) {
+		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			g_propagate_error (error, g_steal_pointer (&error_local));
+			return FALSE;
+		}
+		g_warning ("%s", error_local->message);
+		return TRUE;
+	}
+
 	for (guint j = 0; j < list->len; j++) {
 		GsCategory *parent = GS_CATEGORY (g_ptr_array_index (list, j));
 		GPtrArray *children = gs_category_get_children (parent);
@@ -1958,7 +3166,7 @@ gs_appstream_refine_category_sizes (XbSilo        *silo,
 			GPtrArray *groups = gs_category_get_desktop_groups (cat);
 			for (guint k = 0; k < groups->len; k++) {
 				const gchar *group = g_ptr_array_index (groups, k);
-				guint cnt = gs_appstream_count_component_for_groups (silo, group);
+				guint cnt = GPOINTER_TO_UINT (g_hash_table_lookup (histogram, group));
 				if (cnt > 0) {
 					gs_category_increment_size (parent, cnt);
 					if (children->len > 1) {
@@ -2044,11 +3252,33 @@ gs_appstream_add_popular (XbSilo *silo,
 	return TRUE;
 }
 
+typedef struct {
+	XbNode *component;  /* (unowned) */
+	guint64 timestamp;
+} RecentComponent;
+
+static gint
+compare_recent_components (gconstpointer a,
+			   gconstpointer b,
+			   gpointer user_data)
+{
+	const RecentComponent *recent_a = a;
+	const RecentComponent *recent_b = b;
+
+	if (recent_a->timestamp != recent_b->timestamp)
+		return (recent_a->timestamp < recent_b->timestamp) ? 1 : -1;
+	return 0;
+}
+
+/* If @max_results is non-zero, only the @max_results most recently released
+ * components are added to @list, plus any released at the same time as the
+ * last of them, as ranked by gs_utils_app_sort_release_date(). */
 gboolean
 gs_appstream_add_recent (GsPlugin *plugin,
 			 XbSilo *silo,
 			 GsAppList *list,
 			 guint64 age,
+			 guint max_results,
 			 GCancellable *cancellable,
 			 GError **error)
 {
@@ -2058,6 +3288,7 @@ gs_appstream_add_recent (GsPlugin *plugin,
 	g_autofree gchar *silo_filename = NULL;
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GArray) recent = NULL;
 
 	g_return_val_if_fail (GS_IS_PLUGIN (plugin), FALSE);
 	g_return_val_if_fail (XB_IS_SILO (silo), FALSE);
@@ -2080,19 +3311,39 @@ gs_appstream_add_recent (GsPlugin *plugin,
 	/* This is to cover mistakes when the release date is set in the future,
 	   to not have it picked for too long. */
 	max_future_timestamp = now + (3 * 24 * 60 * 60);
+	recent = g_array_sized_new (FALSE, FALSE, sizeof (RecentComponent), array->len);
 	for (guint i = 0; i < array->len; i++) {
 		XbNode *component = g_ptr_array_index (array, i);
+		RecentComponent item = { component, component_get_release_timestamp (component) };
+		if (item.timestamp != G_MAXUINT64 && item.timestamp < max_future_timestamp)
+			g_array_append_val (recent, item);
+	}
+
+	/* only create apps for the most recent ones, if that’s all which is
+	 * needed; the sort is stable, so the silo order is kept otherwise */
+	if (max_results > 0 && recent->len > max_results) {
+		guint64 cutoff;
+		guint n_kept = max_results;
+
+		g_array_sort_with_data (recent, compare_recent_components, NULL);
+		cutoff = g_array_index (recent, RecentComponent, max_results - 1).timestamp;
+		while (n_kept < recent->len &&
+		       g_array_index (recent, RecentComponent, n_kept).timestamp == cutoff)
+			n_kept++;
+		g_array_set_size (recent, n_kept);
+	}
+
+	for (guint i = 0; i < recent->len; i++) {
+		const RecentComponent *item = &g_array_index (recent, RecentComponent, i);
 		g_autoptr(GsApp) app = NULL;
-		guint64 timestamp = component_get_release_timestamp (component);
-		/* set the release date */
-		if (timestamp != G_MAXUINT64 && timestamp < max_future_timestamp) {
-			app = gs_appstream_create_app (plugin, silo, component, silo_filename ? silo_filename : "", default_scope, error);
-			if (app == NULL)
-				return FALSE;
 
-			gs_app_set_release_date (app, timestamp);
-			gs_app_list_add (list, app);
-		}
+		app = gs_appstream_create_app (plugin, silo, item->component, silo_filename ? silo_filename : "", default_scope, error);
+		if (app == NULL)
+			return FALSE;
+
+		/* set the release date */
+		gs_app_set_release_date (app, item->timestamp);
+		gs_app_list_add (list, app);
 	}
 	return TRUE;
 }
@@ -2824,12 +4075,59 @@ gs_appstream_create_silo_index (XbSilo *silo,
 	return index;
 }
 
-static MergeData *
-gs_appstream_gather_merge_data (GPtrArray *appstream_paths,
-				GPtrArray *desktop_paths,
-				GCancellable *cancellable)
+/* Compiles the merge silo from the sources added to @builder, or loads it from
+ * the cache if none of them changed since it was last compiled. The merge data
+ * does not depend on the components it is merged into, so a change to one of
+ * those (such as a refreshed flatpak remote) should not recompile it too.
+ *
+ * The cache file is named after @kind and the @paths the sources were gathered
+ * from, so each set of paths has its own. */
+static XbSilo *
+gs_appstream_ensure_merge_silo (XbBuilder *builder,
+				const gchar *kind,
+				GPtrArray *paths,
+				GCancellable *cancellable,
+				GError **error)
+{
+	XbBuilderCompileFlags flags = XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID |
+				      XB_BUILDER_COMPILE_FLAG_SINGLE_LANG;
+	g_autoptr(GString) key = g_string_new (kind);
+	g_autoptr(GError) local_error = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autofree gchar *checksum = NULL;
+	g_autofree gchar *basename = NULL;
+	g_autofree gchar *blobfn = NULL;
+
+	for (guint i = 0; i < paths->len; i++) {
+		g_string_append_c (key, '\n');
+		g_string_append (key, g_ptr_array_index (paths, i));
+	}
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA256, key->str, -1);
+	basename = g_strdup_printf ("%s-%s.xmlb", kind, checksum);
+	blobfn = gs_utils_get_cache_filename ("appstream-merge", basename,
+					      GS_UTILS_CACHE_FLAG_WRITEABLE |
+					      GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
+					      &local_error);
+	if (blobfn == NULL) {
+		g_debug ("Failed to get %s merge silo cache filename, compiling it: %s",
+			 kind, local_error->message);
+		return xb_builder_compile (builder, flags, cancellable, error);
+	}
+
+	/* regenerate with each minor release */
+	xb_builder_append_guid (builder, PACKAGE_VERSION);
+
+	file = g_file_new_for_path (blobfn);
+	return xb_builder_ensure (builder, file, flags, cancellable, error);
+}
+
+/* Both gatherers fill in disjoint members of @md, so they can run at the
+ * same time from different threads. */
+static void
+gs_appstream_gather_appstream_merge_data (MergeData *md,
+					  GPtrArray *appstream_paths,
+					  GCancellable *cancellable)
 {
-	MergeData *md = merge_data_new ();
 	g_autoptr(GPtrArray) common_appstream_paths = gs_appstream_get_appstream_data_dirs ();
 	if (appstream_paths != NULL) {
 		g_autoptr(GError) local_error = NULL;
@@ -2854,10 +4152,15 @@ gs_appstream_gather_merge_data (GPtrArray *appstream_paths,
 			any_loaded = gs_appstream_load_appstream_dir (builder, path, cancellable) || any_loaded;
 		}
 		if (any_loaded && !g_cancellable_is_cancelled (cancellable)) {
-			md->appstream_silo = xb_builder_compile (builder,
-								 XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID |
-								 XB_BUILDER_COMPILE_FLAG_SINGLE_LANG,
-								 cancellable, &local_error);
+			g_autoptr(GPtrArray) paths = g_ptr_array_new ();
+
+			for (guint i = 0; i < appstream_paths->len; i++)
+				g_ptr_array_add (paths, g_ptr_array_index (appstream_paths, i));
+			for (guint i = 0; i < common_appstream_paths->len; i++)
+				g_ptr_array_add (paths, g_ptr_array_index (common_appstream_paths, i));
+
+			md->appstream_silo = gs_appstream_ensure_merge_silo (builder, "appstream", paths,
+									     cancellable, &local_error);
 			if (md->appstream_silo != NULL)
 				md->appstream_index = gs_appstream_create_silo_index (md->appstream_silo, TRUE);
 			else
@@ -2873,38 +4176,86 @@ gs_appstream_gather_merge_data (GPtrArray *appstream_paths,
 			any_loaded = gs_appstream_load_appstream_dir (builder, path, cancellable) || any_loaded;
 		}
 		if (any_loaded && !g_cancellable_is_cancelled (cancellable)) {
-			md->appstream_silo = xb_builder_compile (builder,
-								 XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID |
-								 XB_BUILDER_COMPILE_FLAG_SINGLE_LANG,
-								 cancellable, &local_error);
+			md->appstream_silo = gs_appstream_ensure_merge_silo (builder, "appstream", common_appstream_paths,
+									     cancellable, &local_error);
 			if (md->appstream_silo != NULL)
 				md->appstream_index = gs_appstream_create_silo_index (md->appstream_silo, TRUE);
 			else
 				g_warning ("Failed to compile common paths appstream silo: %s", local_error->message);
 		}
 	}
+}
+
+static void
+gs_appstream_gather_desktop_merge_data (MergeData *md,
+					GPtrArray *desktop_paths,
+					GCancellable *cancellable)
+{
+	g_autoptr(GError) local_error = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new ();
+	gboolean any_loaded = FALSE;
+	gs_appstream_add_current_locales (builder);
+	for (guint i = 0; i < desktop_paths->len && !g_cancellable_is_cancelled (cancellable); i++) {
+		const gchar *path = g_ptr_array_index (desktop_paths, i);
+		gboolean this_loaded = FALSE;
+		gs_appstream_load_desktop_files (builder, path, &this_loaded, NULL, cancellable, NULL);
+		any_loaded = any_loaded || this_loaded;
+	}
+	if (any_loaded && !g_cancellable_is_cancelled (cancellable)) {
+		md->desktop_silo = gs_appstream_ensure_merge_silo (builder, "desktop", desktop_paths,
+								   cancellable, &local_error);
+		if (md->desktop_silo != NULL)
+			md->desktop_index = gs_appstream_create_silo_index (md->desktop_silo, FALSE);
+		else
+			g_warning ("Failed to compile desktop silo: %s", local_error->message);
+	}
+}
+
+typedef struct {
+	MergeData *md; /* (unowned) */
+	GPtrArray *desktop_paths; /* (unowned) */
+	GCancellable *cancellable; /* (unowned) (nullable) */
+} GatherDesktopData;
+
+static gpointer
+gs_appstream_gather_desktop_thread_cb (gpointer user_data)
+{
+	GatherDesktopData *data = user_data;
+	gs_appstream_gather_desktop_merge_data (data->md, data->desktop_paths, data->cancellable);
+	return NULL;
+}
+
+static MergeData *
+gs_appstream_gather_merge_data (GPtrArray *appstream_paths,
+				GPtrArray *desktop_paths,
+				GCancellable *cancellable)
+{
+	MergeData *md = merge_data_new ();
+	GatherDesktopData desktop_data = { md, desktop_paths, cancellable };
+	GThread *desktop_thread = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	/* the .desktop silo does not depend on the AppStream one, so compile
+	 * it in parallel rather than after it */
 	if (desktop_paths != NULL) {
 		g_autoptr(GError) local_error = NULL;
-		g_autoptr(XbBuilder) builder = xb_builder_new ();
-		gboolean any_loaded = FALSE;
-		gs_appstream_add_current_locales (builder);
-		for (guint i = 0; i < desktop_paths->len && !g_cancellable_is_cancelled (cancellable); i++) {
-			const gchar *path = g_ptr_array_index (desktop_paths, i);
-			gboolean this_loaded = FALSE;
-			gs_appstream_load_desktop_files (builder, path, &this_loaded, NULL, cancellable, NULL);
-			any_loaded = any_loaded || this_loaded;
-		}
-		if (any_loaded && !g_cancellable_is_cancelled (cancellable)) {
-			md->desktop_silo = xb_builder_compile (builder,
-							       XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID |
-							       XB_BUILDER_COMPILE_FLAG_SINGLE_LANG,
-							       cancellable, &local_error);
-			if (md->desktop_silo != NULL)
-				md->desktop_index = gs_appstream_create_silo_index (md->desktop_silo, FALSE);
-			else
-				g_warning ("Failed to compile desktop silo: %s", local_error->message);
+		desktop_thread = g_thread_try_new ("gs-merge-desktop",
+						   gs_appstream_gather_desktop_thread_cb,
+						   &desktop_data, &local_error);
+		if (desktop_thread == NULL) {
+			g_debug ("Failed to create thread, gathering .desktop files serially: %s",
+				 local_error->message);
+			gs_appstream_gather_desktop_merge_data (md, desktop_paths, cancellable);
 		}
 	}
+
+	gs_appstream_gather_appstream_merge_data (md, appstream_paths, cancellable);
+
+	if (desktop_thread != NULL)
+		g_thread_join (desktop_thread);
+
+	g_debug ("gathered merge data in %fms", g_timer_elapsed (timer, NULL) * 1000);
+
 	return md;
 }
 
@@ -3042,13 +4393,38 @@ gs_appstream_apply_merges_for_id (MergeData *md,
 	return FALSE;
 }
 
+typedef struct {
+	GPtrArray *appstream_paths; /* (owned) (nullable) */
+	GPtrArray *desktop_paths; /* (owned) (nullable) */
+	GCancellable *cancellable; /* (owned) (nullable) */
+	MergeData *md; /* (owned) (nullable); gathered on first use */
+} MergeFixupData;
+
+static void
+merge_fixup_data_free (MergeFixupData *mfd)
+{
+	g_clear_pointer (&mfd->appstream_paths, g_ptr_array_unref);
+	g_clear_pointer (&mfd->desktop_paths, g_ptr_array_unref);
+	g_clear_object (&mfd->cancellable);
+	g_clear_pointer (&mfd->md, merge_data_free);
+	g_free (mfd);
+}
+
 static gboolean
 gs_appstream_apply_merges_cb (XbBuilderFixup *self,
 			      XbBuilderNode *bn,
 			      gpointer user_data,
 			      GError **error)
 {
-	MergeData *md = user_data;
+	MergeFixupData *mfd = user_data;
+	MergeData *md;
+
+	/* the fixups only run when the silo is actually compiled, so there is
+	 * no need to gather the merge data when the cached blob is still valid */
+	if (mfd->md == NULL)
+		mfd->md = gs_appstream_gather_merge_data (mfd->appstream_paths, mfd->desktop_paths, mfd->cancellable);
+	md = mfd->md;
+
 	if (g_strcmp0 (xb_builder_node_get_element (bn), "component") == 0 &&
 	    !gs_appstream_is_merge_node (bn)) {
 		if (md->appstream_index != NULL) {
@@ -3129,10 +4505,14 @@ gs_appstream_add_data_merge_fixup (XbBuilder *builder,
 	g_autoptr(XbBuilderFixup) fixup1 = NULL;
 	#endif
 	g_autoptr(XbBuilderFixup) fixup2 = NULL;
-	MergeData *md;
+	MergeFixupData *mfd;
 
-	/* First read all of the merge components and .desktop files (which will be merged as well) */
-	md = gs_appstream_gather_merge_data (appstream_paths, desktop_paths, cancellable);
+	/* First read all of the merge components and .desktop files (which will be merged as well);
+	   this is deferred until the builder really compiles */
+	mfd = g_new0 (MergeFixupData, 1);
+	mfd->appstream_paths = (appstream_paths != NULL) ? g_ptr_array_ref (appstream_paths) : NULL;
+	mfd->desktop_paths = (desktop_paths != NULL) ? g_ptr_array_ref (desktop_paths) : NULL;
+	mfd->cancellable = (cancellable != NULL) ? g_object_ref (cancellable) : NULL;
 
 	#ifdef HAVE_FIXED_LIBXMLB
 	/* Then drop all the merge components from the result, because they are useless when being merged */
@@ -3146,7 +4526,7 @@ gs_appstream_add_data_merge_fixup (XbBuilder *builder,
 	/* Then apply merge data to the components */
 	fixup2 = xb_builder_fixup_new ("ApplyMerges",
 				       gs_appstream_apply_merges_cb,
-				       md, (GDestroyNotify) merge_data_free);
+				       mfd, (GDestroyNotify) merge_fixup_data_free);
 	xb_builder_fixup_set_max_depth (fixup2, 2);
 	xb_builder_add_fixup (builder, fixup2);
 }
@@ -19,6 +19,12 @@ GsApp		*gs_appstream_create_app		(GsPlugin	*plugin,
 							 const gchar	*appstream_source_file,
 							 AsComponentScope default_scope,
 							 GError		**error);
+GPtrArray	*gs_appstream_create_apps		(GsPlugin	*plugin,
+							 XbSilo		*silo,
+							 GPtrArray	*components,
+							 const gchar	*appstream_source_file,
+							 AsComponentScope default_scope,
+							 GError		**error);
 gboolean	 gs_appstream_refine_app		(GsPlugin	*plugin,
 							 GsApp		*app,
 							 XbSilo		*silo,
@@ -28,18 +34,34 @@ gboolean	 gs_appstream_refine_app		(GsPlugin	*plugin,
 							 const gchar	*appstream_source_file,
 							 AsComponentScope default_scope,
 							 GError		**error);
+void		 gs_appstream_drop_lazy_data		(XbSilo		*silo);
 gboolean	 gs_appstream_search			(GsPlugin	*plugin,
 							 XbSilo		*silo,
 							 const gchar * const *values,
 							 GsAppList	*list,
+							 guint		 max_results,
+							 GCancellable	*cancellable,
+							 GError		**error);
+XbSilo		*gs_appstream_search_silo_new_for_apps	(GsAppList	*list,
 							 GCancellable	*cancellable,
 							 GError		**error);
+guint16		*gs_appstream_search_match_apps		(XbSilo		*silo,
+							 const gchar * const *values,
+							 GCancellable	*cancellable,
+							 GError		**error);
+gboolean	 gs_appstream_search_keyword_narrows	(const gchar	*keyword,
+							 const gchar	*prev_keyword);
 gboolean	 gs_appstream_search_developer_apps	(GsPlugin	*plugin,
 							 XbSilo		*silo,
 							 const gchar * const *values,
 							 GsAppList	*list,
 							 GCancellable	*cancellable,
 							 GError		**error);
+gboolean	 gs_appstream_search_index_build	(XbSilo		*silo,
+							 GFile		*silo_file,
+							 const gchar * const *tokenized_elements,
+							 GCancellable	*cancellable,
+							 GError		**error);
 gboolean	 gs_appstream_refine_category_sizes	(XbSilo		*silo,
 							 GPtrArray	*list,
 							 GCancellable	*cancellable,
@@ -77,6 +99,7 @@ gboolean	 gs_appstream_add_recent		(GsPlugin	*plugin,
 							 XbSilo		*silo,
 							 GsAppList	*list,
 							 guint64	 age,
+							 guint		 max_results,
 							 GCancellable	*cancellable,
 							 GError		**error);
 gboolean	gs_appstream_url_to_app			(GsPlugin	*plugin,
@@ -0,0 +1,691 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Software contributors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/*
+ * The `bench` mode of gnome-software-cmd.
+ *
+ * This generates a synthetic AppStream catalogue of a given size in a
+ * temporary prefix, points the appstream plugin at it (using
+ * `GS_SELF_TEST_APPSTREAM_PREFIX`, so the files are loaded the same way as
+ * the system ones), then runs a fixed set of scenarios through a real
+ * #GsPluginLoader and prints the results as JSON.
+ *
+ * The catalogue is generated from a fixed seed, so two runs with the same
+ * arguments on different builds can be compared. One app in ten also has
+ * a metainfo file, so it is listed as installed.
+ *
+ * For each scenario the JSON contains the minimum, median, mean and maximum
+ * wall time of its iterations, the number of results, the growth in heap
+ * usage of glibc’s main arena and the peak RSS of the process afterwards,
+ * the counters in the metrics registry divided by the number of iterations
+ * (such as how many apps were created and refined), and the timings which
+ * the plugin jobs record in the metrics registry for each plugin (see
+ * gs-profiler.h).
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <glib/gstdio.h>
+#include <json-glib/json-glib.h>
+#ifdef HAVE_MALLINFO2
+#include <malloc.h>
+#endif
+#include <string.h>
+#include <sys/resource.h>
+
+#include "gnome-software-private.h"
+
+#include "gs-cmd-bench.h"
+
+/* the apps to refine in the `refine` scenario, spread over the catalogue */
+#define GS_CMD_BENCH_MAX_REFINE_APPS 1000
+
+/* arbitrary, but must not change, so runs are comparable */
+#define GS_CMD_BENCH_SEED 0x67736265
+
+static const gchar *bench_words[] = {
+	"archive", "audio", "backup", "browser", "calendar", "camera",
+	"chart", "chat", "clock", "code", "color", "compiler",
+	"contacts", "database", "diagram", "dictionary", "disk", "document",
+	"draw", "ebook", "editor", "email", "emulator", "feed",
+	"finance", "font", "game", "graph", "image", "journal",
+	"map", "math", "music", "network", "notes", "office",
+	"paint", "photo", "player", "podcast", "presentation", "puzzle",
+	"scanner", "spreadsheet", "terminal", "video", "weather", "writer",
+};
+
+/* pairs of main and additional categories, as used in desktop files */
+static const gchar *bench_categories[][2] = {
+	{ "AudioVideo", "Player" },
+	{ "AudioVideo", "AudioVideoEditing" },
+	{ "Development", "IDE" },
+	{ "Development", "Debugger" },
+	{ "Education", "Math" },
+	{ "Game", "ArcadeGame" },
+	{ "Game", "LogicGame" },
+	{ "Graphics", "Photography" },
+	{ "Graphics", "VectorGraphics" },
+	{ "Graphics", "Viewer" },
+	{ "Network", "Chat" },
+	{ "Network", "WebBrowser" },
+	{ "Office", "Calendar" },
+	{ "Office", "WordProcessor" },
+	{ "Science", "Astronomy" },
+	{ "Utility", "TextEditor" },
+};
+
+static const gchar *bench_default_allowlist[] = {
+	"appstream",
+	"generic-updates",
+	"hardcoded-blocklist",
+	"icons",
+	"os-release",
+	"provenance",
+	NULL
+};
+
+typedef struct {
+	GsPluginLoader	*plugin_loader;
+	guint64		 refine_flags;
+	guint		 n_apps;
+	const gchar * const *plugin_allowlist;
+	const gchar * const *plugin_blocklist;
+	JsonBuilder	*builder;
+} GsCmdBench;
+
+typedef gboolean (*GsCmdBenchFunc) (GsCmdBench	 *bench,
+				    guint	 *out_n_results,
+				    GError	**error);
+
+static gchar *
+gs_cmd_bench_app_id (guint i)
+{
+	return g_strdup_printf ("org.example.Bench%u", i);
+}
+
+static void
+gs_cmd_bench_append_component (GString *xml, GRand *rand, guint i, gboolean metainfo)
+{
+	g_autofree gchar *id = gs_cmd_bench_app_id (i);
+	const gchar *word = bench_words[g_rand_int_range (rand, 0, G_N_ELEMENTS (bench_words))];
+	guint category = g_rand_int_range (rand, 0, G_N_ELEMENTS (bench_categories));
+	guint n_screenshots = 1 + i % 3;
+	gint64 timestamp = 1700000000 - (gint64) g_rand_int_range (rand, 0, 1000) * 86400;
+
+	g_string_append_printf (xml,
+				"  <component type=\"desktop-application\">\n"
+				"    <id>%s</id>\n"
+				"    <name>Bench %s %u</name>\n"
+				"    <summary>A synthetic %s app</summary>\n"
+				"    <description><p>App %u is generated for benchmarking, "
+				"and is about the %s.</p></description>\n"
+				"    <project_license>GPL-2.0-or-later</project_license>\n"
+				"    <launchable type=\"desktop-id\">%s.desktop</launchable>\n"
+				"    <icon type=\"stock\">%s</icon>\n"
+				"    <categories>\n"
+				"      <category>%s</category>\n"
+				"      <category>%s</category>\n"
+				"    </categories>\n"
+				"    <keywords>\n",
+				id, word, i, word, i, word, id,
+				(i % 2 == 0) ? "application-x-executable" : "system-run",
+				bench_categories[category][0], bench_categories[category][1]);
+	for (guint j = 0; j < 3; j++) {
+		g_string_append_printf (xml, "      <keyword>%s</keyword>\n",
+					bench_words[g_rand_int_range (rand, 0, G_N_ELEMENTS (bench_words))]);
+	}
+	g_string_append (xml, "    </keywords>\n");
+
+	/* the installed metainfo doesn’t have the catalogue-only data */
+	if (!metainfo) {
+		g_string_append_printf (xml, "    <pkgname>bench%u</pkgname>\n", i);
+		g_string_append (xml, "    <screenshots>\n");
+		for (guint j = 0; j < n_screenshots; j++) {
+			g_string_append_printf (xml,
+						"      <screenshot%s>\n"
+						"        <caption>Screenshot %u</caption>\n"
+						"        <image type=\"source\" width=\"1600\" height=\"900\">"
+						"https://screenshots.example.invalid/%s/%u.png</image>\n"
+						"        <image type=\"thumbnail\" width=\"624\" height=\"351\">"
+						"https://screenshots.example.invalid/%s/%u-624x351.png</image>\n"
+						"      </screenshot>\n",
+						(j == 0) ? " type=\"default\"" : "",
+						j, id, j, id, j);
+		}
+		g_string_append (xml, "    </screenshots>\n");
+	}
+
+	g_string_append (xml, "    <releases>\n");
+	for (guint j = 0; j < (metainfo ? 1 : 3); j++) {
+		g_string_append_printf (xml,
+					"      <release version=\"1.%u.%u\" timestamp=\"%" G_GINT64_FORMAT "\">\n"
+					"        <description><p>Fixes for the %s.</p></description>\n"
+					"      </release>\n",
+					i % 10, 3 - j, timestamp - (gint64) j * 30 * 86400, word);
+	}
+	g_string_append (xml, "    </releases>\n"
+			      "  </component>\n");
+}
+
+/* Write the catalogue and metainfo files into @prefix */
+static gboolean
+gs_cmd_bench_write_catalogue (const gchar *prefix, guint n_apps, GError **error)
+{
+	g_autoptr(GRand) rand = g_rand_new_with_seed (GS_CMD_BENCH_SEED);
+	g_autoptr(GString) xml = g_string_new (NULL);
+	g_autofree gchar *catalogue_dir = g_build_filename (prefix, "swcatalog", "xml", NULL);
+	g_autofree gchar *metainfo_dir = g_build_filename (prefix, "metainfo", NULL);
+	g_autofree gchar *desktop_dir = g_build_filename (prefix, "applications", NULL);
+	g_autofree gchar *catalogue_fn = g_build_filename (catalogue_dir, "gs-bench.xml", NULL);
+	const gchar *dirs[] = { catalogue_dir, metainfo_dir, desktop_dir };
+
+	for (gsize i = 0; i < G_N_ELEMENTS (dirs); i++) {
+		if (g_mkdir_with_parents (dirs[i], 0755) != 0) {
+			int errsv = errno;
+			g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+				     "Failed to create %s: %s", dirs[i], g_strerror (errsv));
+			return FALSE;
+		}
+	}
+
+	g_string_append (xml, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+			      "<components version=\"0.14\" origin=\"gs-bench\">\n");
+	for (guint i = 0; i < n_apps; i++) {
+		gs_cmd_bench_append_component (xml, rand, i, FALSE);
+
+		/* every tenth app is installed */
+		if (i % 10 == 0) {
+			g_autoptr(GRand) metainfo_rand = g_rand_new_with_seed (GS_CMD_BENCH_SEED + i);
+			g_autoptr(GString) metainfo = g_string_new ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+			g_autofree gchar *id = gs_cmd_bench_app_id (i);
+			g_autofree gchar *basename = g_strconcat (id, ".metainfo.xml", NULL);
+			g_autofree gchar *metainfo_fn = g_build_filename (metainfo_dir, basename, NULL);
+
+			gs_cmd_bench_append_component (metainfo, metainfo_rand, i, TRUE);
+			if (!g_file_set_contents (metainfo_fn, metainfo->str, metainfo->len, error))
+				return FALSE;
+		}
+	}
+	g_string_append (xml, "</components>\n");
+
+	return g_file_set_contents (catalogue_fn, xml->str, xml->len, error);
+}
+
+#ifdef HAVE_MALLINFO2
+/* mallinfo2() only covers the main arena, not the arenas which glibc gives
+ * worker threads, so this misses most of what the plugin jobs allocate */
+static gint64
+gs_cmd_bench_get_main_arena_in_use (void)
+{
+	struct mallinfo2 info = mallinfo2 ();
+	return info.uordblks + info.hblkhd;
+}
+#endif
+
+static guint64
+gs_cmd_bench_get_peak_rss_kib (void)
+{
+	struct rusage usage;
+
+	if (getrusage (RUSAGE_SELF, &usage) != 0)
+		return 0;
+	return usage.ru_maxrss;
+}
+
+static gint
+gs_cmd_bench_compare_durations_cb (gconstpointer a, gconstpointer b)
+{
+	gint64 duration_a = *((const gint64 *) a);
+	gint64 duration_b = *((const gint64 *) b);
+
+	if (duration_a < duration_b)
+		return -1;
+	if (duration_a > duration_b)
+		return 1;
+	return 0;
+}
+
+static void
+gs_cmd_bench_add_uint_member (JsonBuilder *builder, const gchar *name, guint64 value)
+{
+	json_builder_set_member_name (builder, name);
+	json_builder_add_int_value (builder, (gint64) value);
+}
+
+/* Add the counters in the metrics registry, averaged over @n_iterations */
+static void
+gs_cmd_bench_add_counters (JsonBuilder *builder, guint n_iterations)
+{
+	g_autoptr(GVariant) metrics = g_variant_ref_sink (gs_metrics_dup_variant ());
+	g_autoptr(GVariant) counters = g_variant_get_child_value (metrics, 0);
+	GVariantIter iter;
+	const gchar *name;
+	guint64 value;
+
+	json_builder_set_member_name (builder, "counters_per_iteration");
+	json_builder_begin_object (builder);
+	g_variant_iter_init (&iter, counters);
+	while (g_variant_iter_next (&iter, "{&st}", &name, &value)) {
+		json_builder_set_member_name (builder, name);
+		json_builder_add_double_value (builder, (gdouble) value / n_iterations);
+	}
+	json_builder_end_object (builder);
+}
+
+/* Add the durations recorded in the metrics registry for each plugin */
+static void
+gs_cmd_bench_add_plugin_timings (JsonBuilder *builder)
+{
+	g_autoptr(GVariant) metrics = g_variant_ref_sink (gs_metrics_dup_variant ());
+	g_autoptr(GVariant) histograms = g_variant_get_child_value (metrics, 1);
+	GVariantIter iter;
+	const gchar *name;
+	guint64 count, sum, p50, p95, p99, max;
+
+	json_builder_set_member_name (builder, "plugin_timings");
+	json_builder_begin_object (builder);
+	g_variant_iter_init (&iter, histograms);
+	while (g_variant_iter_next (&iter, "{&s(tttttt)}", &name, &count, &sum, &p50, &p95, &p99, &max)) {
+		/* the marks for each plugin are named `GsPluginJobFoo:plugin` */
+		if (!g_str_has_prefix (name, "GsPluginJob") || strchr (name, ':') == NULL)
+			continue;
+
+		json_builder_set_member_name (builder, name);
+		json_builder_begin_object (builder);
+		gs_cmd_bench_add_uint_member (builder, "count", count);
+		gs_cmd_bench_add_uint_member (builder, "sum_usec", sum);
+		gs_cmd_bench_add_uint_member (builder, "p50_usec", p50);
+		gs_cmd_bench_add_uint_member (builder, "p95_usec", p95);
+		gs_cmd_bench_add_uint_member (builder, "p99_usec", p99);
+		gs_cmd_bench_add_uint_member (builder, "max_usec", max);
+		json_builder_end_object (builder);
+	}
+	json_builder_end_object (builder);
+}
+
+static gboolean
+gs_cmd_bench_run_scenario (GsCmdBench      *bench,
+			   const gchar     *name,
+			   GsCmdBenchFunc   func,
+			   guint            n_iterations,
+			   GError         **error)
+{
+	JsonBuilder *builder = bench->builder;
+	g_autoptr(GArray) durations = g_array_sized_new (FALSE, FALSE, sizeof (gint64), n_iterations);
+#ifdef HAVE_MALLINFO2
+	gint64 heap_before;
+	gint64 heap_after;
+#endif
+	gint64 sum = 0;
+	guint n_results = 0;
+
+	g_debug ("running benchmark scenario %s", name);
+
+	gs_metrics_reset ();
+#ifdef HAVE_MALLINFO2
+	heap_before = gs_cmd_bench_get_main_arena_in_use ();
+#endif
+
+	for (guint i = 0; i < n_iterations; i++) {
+		gint64 begin_time = g_get_monotonic_time ();
+		gint64 duration;
+
+		if (!func (bench, &n_results, error)) {
+			g_prefix_error (error, "Scenario %s failed: ", name);
+			return FALSE;
+		}
+
+		duration = g_get_monotonic_time () - begin_time;
+		g_array_append_val (durations, duration);
+		sum += duration;
+	}
+
+#ifdef HAVE_MALLINFO2
+	heap_after = gs_cmd_bench_get_main_arena_in_use ();
+#endif
+	g_array_sort (durations, gs_cmd_bench_compare_durations_cb);
+
+	json_builder_begin_object (builder);
+	json_builder_set_member_name (builder, "name");
+	json_builder_add_string_value (builder, name);
+	gs_cmd_bench_add_uint_member (builder, "iterations", n_iterations);
+	gs_cmd_bench_add_uint_member (builder, "n_results", n_results);
+
+	json_builder_set_member_name (builder, "wall_time_usec");
+	json_builder_begin_object (builder);
+	gs_cmd_bench_add_uint_member (builder, "min", g_array_index (durations, gint64, 0));
+	gs_cmd_bench_add_uint_member (builder, "median", g_array_index (durations, gint64, n_iterations / 2));
+	gs_cmd_bench_add_uint_member (builder, "mean", sum / n_iterations);
+	gs_cmd_bench_add_uint_member (builder, "max", g_array_index (durations, gint64, n_iterations - 1));
+	json_builder_end_object (builder);
+
+	/* the net change in the main thread’s heap, so leaks and caches
+	 * there show up; use peak_rss_kib for the process as a whole */
+#ifdef HAVE_MALLINFO2
+	json_builder_set_member_name (builder, "main_arena_growth_bytes");
+	json_builder_add_int_value (builder, heap_after - heap_before);
+#endif
+	gs_cmd_bench_add_uint_member (builder, "peak_rss_kib", gs_cmd_bench_get_peak_rss_kib ());
+
+	gs_cmd_bench_add_counters (builder, n_iterations);
+	gs_cmd_bench_add_plugin_timings (builder);
+	json_builder_end_object (builder);
+
+	return TRUE;
+}
+
+static gboolean
+gs_cmd_bench_setup (GsCmdBench *bench, guint *out_n_results, GError **error)
+{
+	if (!gs_plugin_loader_setup (bench->plugin_loader,
+				     bench->plugin_allowlist,
+				     bench->plugin_blocklist,
+				     NULL,
+				     error))
+		return FALSE;
+
+	*out_n_results = bench->n_apps;
+	return TRUE;
+}
+
+static gboolean
+gs_cmd_bench_list_apps (GsCmdBench *bench, GsAppQuery *query, guint *out_n_results, GError **error)
+{
+	g_autoptr(GsPluginJob) plugin_job = NULL;
+	g_autoptr(GsAppList) list = NULL;
+
+	plugin_job = gs_plugin_job_list_apps_new (query, GS_PLUGIN_LIST_APPS_FLAGS_NONE);
+	list = gs_plugin_loader_job_process (bench->plugin_loader, plugin_job, NULL, error);
+	if (list == NULL)
+		return FALSE;
+
+	*out_n_results = gs_app_list_length (list);
+	return TRUE;
+}
+
+static gboolean
+gs_cmd_bench_search (GsCmdBench *bench, guint *out_n_results, GError **error)
+{
+	const gchar *keywords[] = { bench_words[0], NULL };
+	g_autoptr(GsAppQuery) query = NULL;
+
+	query = gs_app_query_new ("keywords", keywords,
+				  "refine-flags", bench->refine_flags,
+				  "dedupe-flags", GS_PLUGIN_JOB_DEDUPE_FLAGS_DEFAULT,
+				  "sort-func", gs_utils_app_sort_match_value,
+				  NULL);
+	return gs_cmd_bench_list_apps (bench, query, out_n_results, error);
+}
+
+/* The queries the overview page makes when it loads, with the same limits
+ * and sort orders, so the number of apps created and refined per load can be
+ * compared; see gs_overview_page_load() */
+static gboolean
+gs_cmd_bench_overview (GsCmdBench *bench, guint *out_n_results, GError **error)
+{
+	g_autoptr(GsAppQuery) featured_query = NULL;
+	g_autoptr(GsAppQuery) curated_query = NULL;
+	g_autoptr(GsAppQuery) recent_query = NULL;
+	g_autoptr(GDateTime) released_since = NULL;
+	guint n_featured = 0, n_curated = 0, n_recent = 0;
+
+	featured_query = gs_app_query_new ("is-featured", GS_APP_QUERY_TRISTATE_TRUE,
+					   "max-results", 5,
+					   "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_ICON,
+					   "dedupe-flags", GS_APP_LIST_FILTER_FLAG_PREFER_INSTALLED |
+							   GS_APP_LIST_FILTER_FLAG_KEY_ID_PROVIDES,
+					   NULL);
+	if (!gs_cmd_bench_list_apps (bench, featured_query, &n_featured, error))
+		return FALSE;
+
+	curated_query = gs_app_query_new ("is-curated", GS_APP_QUERY_TRISTATE_TRUE,
+					  "max-results", 12,
+					  "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_RATING |
+							  GS_PLUGIN_REFINE_FLAGS_REQUIRE_CATEGORIES |
+							  GS_PLUGIN_REFINE_FLAGS_REQUIRE_ICON,
+					  "dedupe-flags", GS_APP_LIST_FILTER_FLAG_PREFER_INSTALLED |
+							  GS_APP_LIST_FILTER_FLAG_KEY_ID_PROVIDES,
+					  NULL);
+	if (!gs_cmd_bench_list_apps (bench, curated_query, &n_curated, error))
+		return FALSE;
+
+	/* the catalogue’s release dates are fixed, rather than relative to
+	 * now, so look back far enough to include all of them */
+	released_since = g_date_time_new_from_unix_local (1700000000 - 1100 * 86400);
+	recent_query = gs_app_query_new ("released-since", released_since,
+					 "max-results", 12,
+					 "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_RATING |
+							 GS_PLUGIN_REFINE_FLAGS_REQUIRE_ICON,
+					 "dedupe-flags", GS_APP_LIST_FILTER_FLAG_KEY_ID |
+							 GS_APP_LIST_FILTER_FLAG_PREFER_INSTALLED |
+							 GS_APP_LIST_FILTER_FLAG_KEY_ID_PROVIDES,
+					 "sort-func", gs_utils_app_sort_release_date,
+					 NULL);
+	if (!gs_cmd_bench_list_apps (bench, recent_query, &n_recent, error))
+		return FALSE;
+
+	*out_n_results = n_featured + n_curated + n_recent;
+	return TRUE;
+}
+
+static gboolean
+gs_cmd_bench_list_categories (GsCmdBench *bench, guint *out_n_results, GError **error)
+{
+	g_autoptr(GsPluginJob) plugin_job = NULL;
+	GPtrArray *categories;
+
+	plugin_job = gs_plugin_job_list_categories_new (GS_PLUGIN_REFINE_CATEGORIES_FLAGS_SIZE);
+	if (!gs_plugin_loader_job_action (bench->plugin_loader, plugin_job, NULL, error))
+		return FALSE;
+
+	categories = gs_plugin_job_list_categories_get_result_list (GS_PLUGIN_JOB_LIST_CATEGORIES (plugin_job));
+	*out_n_results = (categories != NULL) ? categories->len : 0;
+	return TRUE;
+}
+
+static gboolean
+gs_cmd_bench_category_apps (GsCmdBench *bench, guint *out_n_results, GError **error)
+{
+	GsCategoryManager *manager = gs_plugin_loader_get_category_manager (bench->plugin_loader);
+	g_autoptr(GsCategory) parent = gs_category_manager_lookup (manager, "create");
+	g_autoptr(GsAppQuery) query = NULL;
+	GsCategory *category;
+
+	category = (parent != NULL) ? gs_category_find_child (parent, "all") : NULL;
+	if (category == NULL) {
+		g_set_error_literal (error, GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_FAILED,
+				     "Could not find category ‘create/all’");
+		return FALSE;
+	}
+
+	query = gs_app_query_new ("category", category,
+				  "refine-flags", bench->refine_flags,
+				  "sort-func", gs_utils_app_sort_name,
+				  NULL);
+	return gs_cmd_bench_list_apps (bench, query, out_n_results, error);
+}
+
+static gboolean
+gs_cmd_bench_installed (GsCmdBench *bench, guint *out_n_results, GError **error)
+{
+	g_autoptr(GsAppQuery) query = NULL;
+
+	query = gs_app_query_new ("is-installed", GS_APP_QUERY_TRISTATE_TRUE,
+				  "refine-flags", bench->refine_flags,
+				  "dedupe-flags", GS_PLUGIN_JOB_DEDUPE_FLAGS_DEFAULT,
+				  NULL);
+	return gs_cmd_bench_list_apps (bench, query, out_n_results, error);
+}
+
+static gboolean
+gs_cmd_bench_updates (GsCmdBench *bench, guint *out_n_results, GError **error)
+{
+	g_autoptr(GsAppQuery) query = NULL;
+
+	query = gs_app_query_new ("is-for-update", GS_APP_QUERY_TRISTATE_TRUE,
+				  "refine-flags", bench->refine_flags,
+				  NULL);
+	return gs_cmd_bench_list_apps (bench, query, out_n_results, error);
+}
+
+static gboolean
+gs_cmd_bench_refine (GsCmdBench *bench, guint *out_n_results, GError **error)
+{
+	g_autoptr(GsAppList) list = gs_app_list_new ();
+	g_autoptr(GsPluginJob) plugin_job = NULL;
+	guint n_refine = MIN (bench->n_apps, GS_CMD_BENCH_MAX_REFINE_APPS);
+	GsAppList *result_list;
+
+	/* new apps each time, so there’s something to refine */
+	for (guint i = 0; i < n_refine; i++) {
+		g_autofree gchar *id = gs_cmd_bench_app_id (i * (bench->n_apps / n_refine));
+		g_autoptr(GsApp) app = gs_app_new (id);
+		gs_app_list_add (list, app);
+	}
+
+	plugin_job = gs_plugin_job_refine_new (list, bench->refine_flags);
+	if (!gs_plugin_loader_job_action (bench->plugin_loader, plugin_job, NULL, error))
+		return FALSE;
+
+	result_list = gs_plugin_job_refine_get_result_list (GS_PLUGIN_JOB_REFINE (plugin_job));
+	*out_n_results = (result_list != NULL) ? gs_app_list_length (result_list) : 0;
+	return TRUE;
+}
+
+/**
+ * gs_cmd_bench_run:
+ * @n_apps: number of apps in the synthetic catalogue
+ * @repeat: number of times to run each scenario
+ * @refine_flags: refine flags for the scenarios, or 0 for a default set
+ * @plugin_allowlist: (nullable): plugins to load, or %NULL for the plugins
+ *   which handle AppStream data
+ * @plugin_blocklist: (nullable): plugins not to load
+ * @output_filename: (nullable): file to write the JSON results to, or %NULL
+ *   for stdout
+ * @error: return location for a #GError
+ *
+ * Benchmark the plugin loader against a synthetic catalogue.
+ *
+ * This must be called before any other #GsPluginLoader is set up in the
+ * process, as the appstream plugin only reads its data location once.
+ *
+ * Returns: %TRUE on success
+ */
+gboolean
+gs_cmd_bench_run (guint			 n_apps,
+		  guint			 repeat,
+		  guint64		 refine_flags,
+		  const gchar * const	*plugin_allowlist,
+		  const gchar * const	*plugin_blocklist,
+		  const gchar		*output_filename,
+		  GError		**error)
+{
+	g_autoptr(GsPluginLoader) plugin_loader = NULL;
+	g_autoptr(JsonBuilder) builder = json_builder_new ();
+	g_autoptr(JsonGenerator) generator = json_generator_new ();
+	g_autoptr(JsonNode) root = NULL;
+	g_autofree gchar *tmp_root = NULL;
+	g_autofree gchar *prefix = NULL;
+	g_autofree gchar *cache_dir = NULL;
+	g_autofree gchar *json = NULL;
+	GsCmdBench bench = { NULL, };
+	gint64 begin_time;
+	gboolean ret = FALSE;
+	const struct {
+		const gchar *name;
+		GsCmdBenchFunc func;
+	} scenarios[] = {
+		{ "search", gs_cmd_bench_search },
+		{ "overview", gs_cmd_bench_overview },
+		{ "list-categories", gs_cmd_bench_list_categories },
+		{ "category-apps", gs_cmd_bench_category_apps },
+		{ "installed", gs_cmd_bench_installed },
+		{ "updates", gs_cmd_bench_updates },
+		{ "refine", gs_cmd_bench_refine },
+	};
+
+	g_return_val_if_fail (n_apps > 0, FALSE);
+	g_return_val_if_fail (repeat > 0, FALSE);
+
+	tmp_root = g_dir_make_tmp ("gnome-software-bench-XXXXXX", error);
+	if (tmp_root == NULL)
+		return FALSE;
+
+	/* generate the catalogue, and keep the caches it is compiled into
+	 * separate from the user’s */
+	prefix = g_build_filename (tmp_root, "share", NULL);
+	cache_dir = g_build_filename (tmp_root, "cache", NULL);
+	begin_time = g_get_monotonic_time ();
+	if (!gs_cmd_bench_write_catalogue (prefix, n_apps, error))
+		goto out;
+	g_debug ("generated catalogue of %u apps in %" G_GINT64_FORMAT "ms",
+		 n_apps, (g_get_monotonic_time () - begin_time) / 1000);
+	g_setenv ("GS_SELF_TEST_APPSTREAM_PREFIX", prefix, TRUE);
+	g_setenv ("GS_SELF_TEST_CACHEDIR", cache_dir, TRUE);
+
+	plugin_loader = gs_plugin_loader_new (NULL, NULL);
+	if (g_file_test (LOCALPLUGINDIR, G_FILE_TEST_EXISTS))
+		gs_plugin_loader_add_location (plugin_loader, LOCALPLUGINDIR);
+
+	bench.plugin_loader = plugin_loader;
+	bench.n_apps = n_apps;
+	bench.plugin_allowlist = (plugin_allowlist != NULL) ? plugin_allowlist : bench_default_allowlist;
+	bench.plugin_blocklist = plugin_blocklist;
+	bench.builder = builder;
+	bench.refine_flags = refine_flags;
+	if (bench.refine_flags == 0) {
+		bench.refine_flags = GS_PLUGIN_REFINE_FLAGS_REQUIRE_ICON |
+				     GS_PLUGIN_REFINE_FLAGS_REQUIRE_DESCRIPTION |
+				     GS_PLUGIN_REFINE_FLAGS_REQUIRE_CATEGORIES |
+				     GS_PLUGIN_REFINE_FLAGS_REQUIRE_SCREENSHOTS |
+				     GS_PLUGIN_REFINE_FLAGS_REQUIRE_VERSION |
+				     GS_PLUGIN_REFINE_FLAGS_REQUIRE_PROVENANCE;
+	}
+
+	json_builder_begin_object (builder);
+	json_builder_set_member_name (builder, "version");
+	json_builder_add_string_value (builder, PACKAGE_VERSION);
+	gs_cmd_bench_add_uint_member (builder, "n_apps", n_apps);
+	gs_cmd_bench_add_uint_member (builder, "n_installed", (n_apps + 9) / 10);
+	gs_cmd_bench_add_uint_member (builder, "repeat", repeat);
+	gs_cmd_bench_add_uint_member (builder, "refine_flags", bench.refine_flags);
+	json_builder_set_member_name (builder, "scenarios");
+	json_builder_begin_array (builder);
+
+	/* setting up the plugins compiles the catalogue, so only do it once */
+	if (!gs_cmd_bench_run_scenario (&bench, "setup", gs_cmd_bench_setup, 1, error))
+		goto out;
+	for (gsize i = 0; i < G_N_ELEMENTS (scenarios); i++) {
+		if (!gs_cmd_bench_run_scenario (&bench, scenarios[i].name, scenarios[i].func, repeat, error))
+			goto out;
+	}
+
+	json_builder_end_array (builder);
+	gs_cmd_bench_add_uint_member (builder, "peak_rss_kib", gs_cmd_bench_get_peak_rss_kib ());
+	json_builder_end_object (builder);
+
+	root = json_builder_get_root (builder);
+	json_generator_set_pretty (generator, TRUE);
+	json_generator_set_root (generator, root);
+	json = json_generator_to_data (generator, NULL);
+
+	if (output_filename != NULL) {
+		if (!g_file_set_contents (output_filename, json, -1, error))
+			goto out;
+	} else {
+		g_print ("%s\n", json);
+	}
+
+	ret = TRUE;
+ out:
+	/* the plugins may have files open in the prefix */
+	g_clear_object (&plugin_loader);
+	gs_utils_rmtree (tmp_root, NULL);
+	return ret;
+}
@@ -0,0 +1,23 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Software contributors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+gboolean	 gs_cmd_bench_run	(guint			 n_apps,
+					 guint			 repeat,
+					 guint64		 refine_flags,
+					 const gchar * const	*plugin_allowlist,
+					 const gchar * const	*plugin_blocklist,
+					 const gchar		*output_filename,
+					 GError			**error);
+
+G_END_DECLS
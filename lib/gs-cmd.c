@@ -15,6 +15,7 @@
 
 #include "gnome-software-private.h"
 
+#include "gs-cmd-bench.h"
 #include "gs-debug.h"
 
 typedef struct {
@@ -279,6 +280,36 @@ app_sort_kind_cb (GsApp *app1, GsApp *app2, gpointer user_data)
 	return 0;
 }
 
+static gboolean
+gs_cmd_print_metrics (GError **error)
+{
+	g_autoptr(GDBusConnection) connection = NULL;
+	g_autoptr(GVariant) reply = NULL;
+	g_autofree gchar *str = NULL;
+
+	/* the metrics are collected in the running gnome-software process */
+	connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, error);
+	if (connection == NULL)
+		return FALSE;
+	reply = g_dbus_connection_call_sync (connection,
+					     "org.gnome.Software",
+					     "/org/gnome/Software",
+					     "org.gnome.Software.Metrics",
+					     "GetMetrics",
+					     NULL,
+					     G_VARIANT_TYPE (GS_METRICS_VARIANT_TYPE),
+					     G_DBUS_CALL_FLAGS_NONE,
+					     -1,
+					     NULL,
+					     error);
+	if (reply == NULL)
+		return FALSE;
+
+	str = gs_metrics_variant_to_string (reply);
+	g_print ("%s", str);
+	return TRUE;
+}
+
 int
 main (int argc, char **argv)
 {
@@ -290,6 +321,7 @@ main (int argc, char **argv)
 	gint i;
 	guint64 cache_age_secs = 0;
 	gint repeat = 1;
+	gint bench_apps = 1000;
 	g_auto(GStrv) plugin_blocklist = NULL;
 	g_auto(GStrv) plugin_allowlist = NULL;
 	g_autoptr(GError) error = NULL;
@@ -299,6 +331,7 @@ main (int argc, char **argv)
 	g_autofree gchar *plugin_blocklist_str = NULL;
 	g_autofree gchar *plugin_allowlist_str = NULL;
 	g_autofree gchar *refine_flags_str = NULL;
+	g_autofree gchar *bench_output = NULL;
 	g_autoptr(GsApp) app = NULL;
 	g_autoptr(GFile) file = NULL;
 	g_autoptr(GsCmdSelf) self = g_new0 (GsCmdSelf, 1);
@@ -325,6 +358,10 @@ main (int argc, char **argv)
 		  "Allow interactive authentication", NULL },
 		{ "only-freely-licensed", '\0', 0, G_OPTION_ARG_NONE, &self->only_freely_licensed,
 		  "Filter results to include only freely licensed apps", NULL },
+		{ "bench-apps", '\0', 0, G_OPTION_ARG_INT, &bench_apps,
+		  "Number of apps in the catalogue generated by bench", NULL },
+		{ "bench-output", '\0', 0, G_OPTION_ARG_FILENAME, &bench_output,
+		  "Write the results of bench to this file rather than stdout", NULL },
 		{ NULL}
 	};
 
@@ -357,14 +394,40 @@ main (int argc, char **argv)
 		return EXIT_FAILURE;
 	}
 
-	/* load plugins */
-	self->plugin_loader = gs_plugin_loader_new (NULL, NULL);
-	if (g_file_test (LOCALPLUGINDIR, G_FILE_TEST_EXISTS))
-		gs_plugin_loader_add_location (self->plugin_loader, LOCALPLUGINDIR);
+	/* this queries the running instance, so doesn’t need any plugins */
+	if (argc == 2 && g_strcmp0 (argv[1], "metrics") == 0) {
+		if (!gs_cmd_print_metrics (&error)) {
+			g_print ("Failed to get metrics: %s\n", error->message);
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
 	if (plugin_allowlist_str != NULL)
 		plugin_allowlist = g_strsplit (plugin_allowlist_str, ",", -1);
 	if (plugin_blocklist_str != NULL)
 		plugin_blocklist = g_strsplit (plugin_blocklist_str, ",", -1);
+
+	/* this sets up its own plugins, using a synthetic catalogue */
+	if (argc == 2 && g_strcmp0 (argv[1], "bench") == 0) {
+		if (bench_apps <= 0 || repeat <= 0) {
+			g_print ("--bench-apps and --repeat must be positive\n");
+			return EXIT_FAILURE;
+		}
+		if (!gs_cmd_bench_run (bench_apps, repeat, self->refine_flags,
+				       (const gchar * const *) plugin_allowlist,
+				       (const gchar * const *) plugin_blocklist,
+				       bench_output, &error)) {
+			g_print ("Failed to run benchmark: %s\n", error->message);
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	/* load plugins */
+	self->plugin_loader = gs_plugin_loader_new (NULL, NULL);
+	if (g_file_test (LOCALPLUGINDIR, G_FILE_TEST_EXISTS))
+		gs_plugin_loader_add_location (self->plugin_loader, LOCALPLUGINDIR);
 	ret = gs_plugin_loader_setup (self->plugin_loader,
 				      (const gchar * const *) plugin_allowlist,
 				      (const gchar * const *) plugin_blocklist,
@@ -777,7 +840,7 @@ main (int argc, char **argv)
 				     "'updates', 'popular', 'get-categories', "
 				     "'get-category-apps', 'get-alternates', 'filename-to-app', "
 				     "'install', 'remove', "
-				     "'sources', 'refresh', 'launch' or 'search'");
+				     "'sources', 'refresh', 'launch', 'metrics', 'bench' or 'search'");
 	}
 	if (!ret) {
 		g_print ("Failed: %s\n", error->message);
@@ -0,0 +1,803 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Software contributors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/**
+ * SECTION:gs-download-scheduler
+ * @short_description: Shares and prioritises downloads between subsystems
+ *
+ * #GsDownloadScheduler runs downloads on behalf of the parts of the UI and
+ * the plugins which fetch things from the network, such as screenshots and
+ * ratings, so that they don’t compete with each other for connections.
+ *
+ * Requests for the same download which overlap are deduplicated: they all
+ * wait on a single download, and get the same result. A request for a byte
+ * download is the same as another if it has the same URI and Last-Modified
+ * date; a request for a file download is the same if it has the same URI
+ * and output file.
+ *
+ * At most gs_download_scheduler_get_max_per_host() downloads run at once for
+ * each host. The others are queued, in order of their I/O priority, so that
+ * what the user is looking at (%G_PRIORITY_DEFAULT) is downloaded before
+ * prefetches and background downloads (%G_PRIORITY_LOW). If a request joins a
+ * queued download with a higher priority, the download is moved up the
+ * queue. Local (`file://`) downloads are not limited.
+ *
+ * Cancelling a request returns %G_IO_ERROR_CANCELLED for it straight away.
+ * Once all the requests for a download have been cancelled, for example
+ * because the widgets which wanted it have been destroyed, the download is
+ * dropped from the queue, or cancelled if it has started.
+ *
+ * Each download runs in the thread-default main context of the first request
+ * for it, using that request’s #SoupSession. #GsDownloadScheduler is safe to
+ * use from any thread.
+ *
+ * Since: 48
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <libsoup/soup.h>
+
+#include "gs-download-scheduler.h"
+#include "gs-download-utils.h"
+#include "gs-metrics.h"
+
+typedef enum {
+	JOB_KIND_BYTES,
+	JOB_KIND_FILE,
+} JobKind;
+
+typedef struct _Job Job;
+
+/* A request for a download. Refcounted, as both the job and the cancel
+ * source hold a reference. */
+typedef struct {
+	GsDownloadScheduler *scheduler;  /* (owned) */
+	GTask		*task;  /* (owned) */
+	Job		*job;  /* (mutex scheduler->mutex) (nullable) NULL once detached */
+	GSource		*cancel_source;  /* (owned) (nullable) */
+	GsDownloadProgressCallback progress_callback;  /* (nullable) */
+	gpointer	 progress_user_data;  /* (closure progress_callback) */
+} Waiter;
+
+struct _Job {
+	GsDownloadScheduler *scheduler;  /* (owned) */
+	gchar		*key;  /* (owned) */
+	gchar		*uri;  /* (owned) */
+	gchar		*host;  /* (owned) (nullable) NULL for local files */
+	JobKind		 kind;
+	GFile		*output_file;  /* (owned) (nullable) */
+	GDateTime	*last_modified_date;  /* (owned) (nullable) */
+	SoupSession	*soup_session;  /* (owned) */
+	GMainContext	*context;  /* (owned) */
+	GCancellable	*cancellable;  /* (owned) */
+
+	/* all (mutex scheduler->mutex) */
+	int		 io_priority;
+	guint64		 sequence;
+	gboolean	 running;
+	GPtrArray	*waiters;  /* (owned) (element-type Waiter) */
+};
+
+typedef struct {
+	guint		 n_running;
+	GQueue		 queue;  /* (element-type Job), highest priority first */
+} Host;
+
+struct _GsDownloadScheduler
+{
+	GObject		 parent;
+
+	GMutex		 mutex;
+	guint		 max_per_host;  /* (mutex mutex) */
+	guint64		 next_sequence;  /* (mutex mutex) */
+	GHashTable	*jobs;  /* (mutex mutex) (owned) key → (owned) Job */
+	GHashTable	*hosts;  /* (mutex mutex) (owned) host → (owned) Host */
+};
+
+G_DEFINE_TYPE (GsDownloadScheduler, gs_download_scheduler, G_TYPE_OBJECT)
+
+static void
+waiter_clear (Waiter *waiter)
+{
+	g_clear_object (&waiter->scheduler);
+	g_clear_object (&waiter->task);
+	g_clear_pointer (&waiter->cancel_source, g_source_unref);
+}
+
+static Waiter *
+waiter_ref (Waiter *waiter)
+{
+	return g_atomic_rc_box_acquire (waiter);
+}
+
+static void
+waiter_unref (Waiter *waiter)
+{
+	g_atomic_rc_box_release_full (waiter, (GDestroyNotify) waiter_clear);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (Waiter, waiter_unref)
+
+static void
+job_free (Job *job)
+{
+	g_assert (job->waiters->len == 0);
+
+	g_clear_object (&job->scheduler);
+	g_free (job->key);
+	g_free (job->uri);
+	g_free (job->host);
+	g_clear_object (&job->output_file);
+	g_clear_pointer (&job->last_modified_date, g_date_time_unref);
+	g_clear_object (&job->soup_session);
+	g_clear_pointer (&job->context, g_main_context_unref);
+	g_clear_object (&job->cancellable);
+	g_ptr_array_unref (job->waiters);
+	g_free (job);
+}
+
+static void
+host_free (Host *host)
+{
+	g_queue_clear (&host->queue);
+	g_free (host);
+}
+
+static gint
+job_compare (gconstpointer a,
+	     gconstpointer b,
+	     gpointer      user_data)
+{
+	const Job *job_a = a;
+	const Job *job_b = b;
+
+	if (job_a->io_priority != job_b->io_priority)
+		return (job_a->io_priority < job_b->io_priority) ? -1 : 1;
+	return (job_a->sequence < job_b->sequence) ? -1 : (job_a->sequence > job_b->sequence);
+}
+
+/* must be called with self->mutex held */
+static Host *
+get_host (GsDownloadScheduler *self,
+	  const gchar         *host_name)
+{
+	Host *host = g_hash_table_lookup (self->hosts, host_name);
+
+	if (host == NULL) {
+		host = g_new0 (Host, 1);
+		g_queue_init (&host->queue);
+		g_hash_table_insert (self->hosts, g_strdup (host_name), host);
+	}
+
+	return host;
+}
+
+/* must be called with self->mutex held; drops @host once it has nothing
+ * running or queued, so that hosts which were only downloaded from once don’t
+ * accumulate for the lifetime of the process */
+static void
+maybe_remove_host (GsDownloadScheduler *self,
+		   const gchar         *host_name,
+		   Host                *host)
+{
+	if (host->n_running == 0 && host->queue.length == 0)
+		g_hash_table_remove (self->hosts, host_name);
+}
+
+/* must be called with self->mutex held; moves jobs which may now start from
+ * the queue of @host to @to_start */
+static void
+take_startable_jobs (GsDownloadScheduler *self,
+		     Host                *host,
+		     GPtrArray           *to_start)
+{
+	while (host->queue.length > 0 &&
+	       (self->max_per_host == 0 || host->n_running < self->max_per_host)) {
+		Job *job = g_queue_pop_head (&host->queue);
+
+		job->running = TRUE;
+		host->n_running++;
+		g_ptr_array_add (to_start, job);
+	}
+}
+
+static void job_run (Job *job);
+
+static gboolean
+job_run_cb (gpointer user_data)
+{
+	job_run (user_data);
+	return G_SOURCE_REMOVE;
+}
+
+/* must be called without self->mutex held */
+static void
+start_jobs (GPtrArray *to_start)
+{
+	for (guint i = 0; i < to_start->len; i++) {
+		Job *job = g_ptr_array_index (to_start, i);
+
+		g_debug ("Starting download of %s", job->uri);
+		g_main_context_invoke_full (job->context, job->io_priority,
+					    job_run_cb, job, NULL);
+	}
+}
+
+static void
+job_finish (Job    *job,
+	    GBytes *bytes,
+	    GError *error)
+{
+	GsDownloadScheduler *self = job->scheduler;
+	g_autoptr(GPtrArray) waiters = NULL;
+	g_autoptr(GPtrArray) to_start = g_ptr_array_new ();
+
+	g_mutex_lock (&self->mutex);
+
+	/* the job may already have been dropped from the table, if all its
+	 * waiters were cancelled */
+	if (g_hash_table_lookup (self->jobs, job->key) == job)
+		g_hash_table_steal (self->jobs, job->key);
+
+	if (job->host != NULL) {
+		Host *host = get_host (self, job->host);
+		host->n_running--;
+		take_startable_jobs (self, host, to_start);
+		maybe_remove_host (self, job->host, host);
+	}
+
+	waiters = g_steal_pointer (&job->waiters);
+	job->waiters = g_ptr_array_new ();
+	for (guint i = 0; i < waiters->len; i++) {
+		Waiter *waiter = g_ptr_array_index (waiters, i);
+		waiter->job = NULL;
+	}
+
+	g_mutex_unlock (&self->mutex);
+
+	start_jobs (to_start);
+
+	for (guint i = 0; i < waiters->len; i++) {
+		g_autoptr(Waiter) waiter = g_ptr_array_index (waiters, i);
+
+		if (waiter->cancel_source != NULL)
+			g_source_destroy (waiter->cancel_source);
+
+		if (error != NULL)
+			g_task_return_error (waiter->task, g_error_copy (error));
+		else if (job->kind == JOB_KIND_BYTES)
+			g_task_return_pointer (waiter->task, g_bytes_ref (bytes), (GDestroyNotify) g_bytes_unref);
+		else
+			g_task_return_boolean (waiter->task, TRUE);
+	}
+
+	job_free (job);
+}
+
+static void
+job_download_stream_cb (GObject      *source_object,
+			GAsyncResult *result,
+			gpointer      user_data)
+{
+	SoupSession *soup_session = SOUP_SESSION (source_object);
+	g_autoptr(GOutputStream) output_stream = G_OUTPUT_STREAM (user_data);
+	Job *job = g_object_get_data (G_OBJECT (output_stream), "gs-download-scheduler-job");
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GError) local_error = NULL;
+
+	if (gs_download_stream_finish (soup_session, result, NULL, NULL, &local_error))
+		bytes = g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (output_stream));
+
+	job_finish (job, bytes, local_error);
+}
+
+/* Called in job->context. Progress is only passed on to the requests made
+ * from that context, as the callbacks of requests from other threads can’t
+ * safely be called from here. */
+static void
+job_progress_cb (gsize    bytes_downloaded,
+		 gsize    total_download_size,
+		 gpointer user_data)
+{
+	Job *job = user_data;
+	GsDownloadScheduler *self = job->scheduler;
+	g_autoptr(GPtrArray) waiters = g_ptr_array_new_with_free_func ((GDestroyNotify) waiter_unref);
+
+	g_mutex_lock (&self->mutex);
+	for (guint i = 0; i < job->waiters->len; i++) {
+		Waiter *waiter = g_ptr_array_index (job->waiters, i);
+
+		if (waiter->progress_callback != NULL &&
+		    g_task_get_context (waiter->task) == job->context)
+			g_ptr_array_add (waiters, waiter_ref (waiter));
+	}
+	g_mutex_unlock (&self->mutex);
+
+	for (guint i = 0; i < waiters->len; i++) {
+		Waiter *waiter = g_ptr_array_index (waiters, i);
+
+		waiter->progress_callback (bytes_downloaded, total_download_size,
+					   waiter->progress_user_data);
+	}
+}
+
+static void
+job_download_file_cb (GObject      *source_object,
+		      GAsyncResult *result,
+		      gpointer      user_data)
+{
+	SoupSession *soup_session = SOUP_SESSION (source_object);
+	Job *job = user_data;
+	g_autoptr(GError) local_error = NULL;
+
+	gs_download_file_finish (soup_session, result, &local_error);
+
+	job_finish (job, NULL, local_error);
+}
+
+/* Called in job->context. */
+static void
+job_run (Job *job)
+{
+	switch (job->kind) {
+	case JOB_KIND_BYTES: {
+		GOutputStream *output_stream = g_memory_output_stream_new_resizable ();
+
+		g_object_set_data (G_OBJECT (output_stream), "gs-download-scheduler-job", job);
+		gs_download_stream_async (job->soup_session, job->uri, output_stream,
+					  NULL, job->last_modified_date, job->io_priority,
+					  NULL, NULL, job->cancellable,
+					  job_download_stream_cb, output_stream);
+		break;
+	}
+	case JOB_KIND_FILE:
+		gs_download_file_async (job->soup_session, job->uri, job->output_file,
+					job->io_priority, job_progress_cb, job, job->cancellable,
+					job_download_file_cb, job);
+		break;
+	default:
+		g_assert_not_reached ();
+	}
+}
+
+static gboolean
+waiter_cancelled_cb (GCancellable *cancellable,
+		     gpointer      user_data)
+{
+	Waiter *waiter = user_data;
+	GsDownloadScheduler *self = waiter->scheduler;
+	Job *job;
+	gboolean abandoned = FALSE;
+
+	g_mutex_lock (&self->mutex);
+
+	/* the download may have finished just before the cancellation */
+	job = waiter->job;
+	if (job == NULL) {
+		g_mutex_unlock (&self->mutex);
+		return G_SOURCE_REMOVE;
+	}
+
+	g_ptr_array_remove_fast (job->waiters, waiter);
+	waiter->job = NULL;
+
+	/* nobody wants the download any more */
+	if (job->waiters->len == 0) {
+		abandoned = TRUE;
+		g_hash_table_steal (self->jobs, job->key);
+
+		if (job->running) {
+			/* job_finish() frees it once it has stopped */
+			g_cancellable_cancel (job->cancellable);
+		} else {
+			if (job->host != NULL) {
+				Host *host = get_host (self, job->host);
+				g_queue_remove (&host->queue, job);
+				maybe_remove_host (self, job->host, host);
+			}
+			job_free (job);
+		}
+	}
+
+	g_mutex_unlock (&self->mutex);
+
+	if (abandoned)
+		gs_metrics_increment_counter ("download-scheduler:abandoned", 1);
+
+	g_task_return_error_if_cancelled (waiter->task);
+
+	/* drop the reference which job->waiters held */
+	waiter_unref (waiter);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gs_download_scheduler_queue (GsDownloadScheduler *self,
+			     GTask               *task,
+			     JobKind              kind,
+			     SoupSession         *soup_session,
+			     const gchar         *uri,
+			     GFile               *output_file,
+			     GDateTime           *last_modified_date,
+			     int                  io_priority,
+			     GsDownloadProgressCallback progress_callback,
+			     gpointer             progress_user_data,
+			     GCancellable        *cancellable)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GPtrArray) to_start = g_ptr_array_new ();
+	g_autoptr(Waiter) waiter = NULL;
+	g_autofree gchar *key = NULL;
+	Job *job;
+	Host *host = NULL;
+	gboolean deduplicated = FALSE;
+
+	if (kind == JOB_KIND_BYTES) {
+		key = g_strdup_printf ("bytes\n%s\n%" G_GINT64_FORMAT, uri,
+				       (last_modified_date != NULL) ? g_date_time_to_unix (last_modified_date) : -1);
+	} else {
+		g_autofree gchar *output_uri = g_file_get_uri (output_file);
+		key = g_strdup_printf ("file\n%s\n%s", uri, output_uri);
+	}
+
+	waiter = g_atomic_rc_box_new0 (Waiter);
+	waiter->scheduler = g_object_ref (self);
+	waiter->task = g_object_ref (task);
+	waiter->progress_callback = progress_callback;
+	waiter->progress_user_data = progress_user_data;
+
+	locker = g_mutex_locker_new (&self->mutex);
+
+	job = g_hash_table_lookup (self->jobs, key);
+	if (job != NULL) {
+		deduplicated = TRUE;
+
+		/* move the job up the queue if this request is more urgent */
+		if (io_priority < job->io_priority) {
+			job->io_priority = io_priority;
+			if (!job->running && job->host != NULL) {
+				host = get_host (self, job->host);
+				g_queue_remove (&host->queue, job);
+				g_queue_insert_sorted (&host->queue, job, job_compare, NULL);
+			}
+		}
+	} else {
+		g_autoptr(GUri) parsed_uri = g_uri_parse (uri, G_URI_FLAGS_NONE, NULL);
+		const gchar *host_name = NULL;
+
+		if (parsed_uri != NULL && !g_str_equal (g_uri_get_scheme (parsed_uri), "file"))
+			host_name = g_uri_get_host (parsed_uri);
+
+		job = g_new0 (Job, 1);
+		job->scheduler = g_object_ref (self);
+		job->key = g_strdup (key);
+		job->uri = g_strdup (uri);
+		job->host = g_strdup (host_name);
+		job->kind = kind;
+		job->output_file = (output_file != NULL) ? g_object_ref (output_file) : NULL;
+		job->last_modified_date = (last_modified_date != NULL) ? g_date_time_ref (last_modified_date) : NULL;
+		job->soup_session = g_object_ref (soup_session);
+		job->context = g_main_context_ref_thread_default ();
+		job->cancellable = g_cancellable_new ();
+		job->io_priority = io_priority;
+		job->sequence = self->next_sequence++;
+		job->waiters = g_ptr_array_new ();
+		g_hash_table_insert (self->jobs, job->key, job);
+
+		if (job->host != NULL) {
+			host = get_host (self, job->host);
+			g_queue_insert_sorted (&host->queue, job, job_compare, NULL);
+			take_startable_jobs (self, host, to_start);
+		} else {
+			job->running = TRUE;
+			g_ptr_array_add (to_start, job);
+		}
+	}
+
+	waiter->job = job;
+	g_ptr_array_add (job->waiters, waiter_ref (waiter));
+
+	/* set up the cancel source while the lock is held, so that the job
+	 * can’t finish and destroy it before it exists */
+	if (cancellable != NULL) {
+		waiter->cancel_source = g_cancellable_source_new (cancellable);
+		g_source_set_priority (waiter->cancel_source, G_PRIORITY_DEFAULT);
+		g_source_set_callback (waiter->cancel_source, G_SOURCE_FUNC (waiter_cancelled_cb),
+				       waiter_ref (waiter), (GDestroyNotify) waiter_unref);
+		g_source_attach (waiter->cancel_source, g_task_get_context (task));
+	}
+
+	g_clear_pointer (&locker, g_mutex_locker_free);
+
+	if (deduplicated) {
+		g_debug ("Deduplicated download of %s", uri);
+		gs_metrics_increment_counter ("download-scheduler:deduplicated", 1);
+	}
+
+	start_jobs (to_start);
+}
+
+/**
+ * gs_download_scheduler_download_bytes_async:
+ * @self: a #GsDownloadScheduler
+ * @soup_session: a #SoupSession to download with
+ * @uri: (not nullable): the URI to download
+ * @last_modified_date: (nullable): the last-known Last-Modified date of the
+ *   URI, or %NULL if unknown
+ * @io_priority: I/O priority of the download, which decides its place in the
+ *   queue
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @callback: callback to call once the operation is complete
+ * @user_data: (closure callback): data to pass to @callback
+ *
+ * Download @uri into memory asynchronously, sharing the download with any
+ * overlapping request for the same URI.
+ *
+ * If @last_modified_date is non-%NULL and the server reports that @uri hasn’t
+ * been modified since, the operation fails with
+ * %GS_DOWNLOAD_ERROR_NOT_MODIFIED.
+ *
+ * Since: 48
+ */
+void
+gs_download_scheduler_download_bytes_async (GsDownloadScheduler *self,
+					    SoupSession         *soup_session,
+					    const gchar         *uri,
+					    GDateTime           *last_modified_date,
+					    int                  io_priority,
+					    GCancellable        *cancellable,
+					    GAsyncReadyCallback  callback,
+					    gpointer             user_data)
+{
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (GS_IS_DOWNLOAD_SCHEDULER (self));
+	g_return_if_fail (SOUP_IS_SESSION (soup_session));
+	g_return_if_fail (uri != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gs_download_scheduler_download_bytes_async);
+
+	gs_download_scheduler_queue (self, task, JOB_KIND_BYTES, soup_session, uri,
+				     NULL, last_modified_date, io_priority, NULL, NULL, cancellable);
+}
+
+/**
+ * gs_download_scheduler_download_bytes_finish:
+ * @self: a #GsDownloadScheduler
+ * @result: result of the asynchronous operation
+ * @error: return location for a #GError
+ *
+ * Finish an asynchronous download started with
+ * gs_download_scheduler_download_bytes_async().
+ *
+ * Returns: (transfer full): the downloaded data, or %NULL on error
+ *
+ * Since: 48
+ */
+GBytes *
+gs_download_scheduler_download_bytes_finish (GsDownloadScheduler  *self,
+					     GAsyncResult         *result,
+					     GError              **error)
+{
+	g_return_val_if_fail (GS_IS_DOWNLOAD_SCHEDULER (self), NULL);
+	g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+	g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == gs_download_scheduler_download_bytes_async, NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * gs_download_scheduler_download_file_async:
+ * @self: a #GsDownloadScheduler
+ * @soup_session: a #SoupSession to download with
+ * @uri: (not nullable): the URI to download
+ * @output_file: (not nullable): an output file to write the download to
+ * @io_priority: I/O priority of the download, which decides its place in the
+ *   queue
+ * @progress_callback: (nullable): callback to call with progress information
+ * @progress_user_data: (nullable) (closure progress_callback): data to pass
+ *   to @progress_callback
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @callback: callback to call once the operation is complete
+ * @user_data: (closure callback): data to pass to @callback
+ *
+ * Download @uri to @output_file asynchronously, as gs_download_file_async()
+ * does, sharing the download with any overlapping request for the same URI
+ * and output file.
+ *
+ * If specified, @progress_callback will be called zero or more times until
+ * @callback is called, providing progress updates on the download. It is only
+ * called if the request was made from the same thread-default main context as
+ * the request which started the download.
+ *
+ * Since: 48
+ */
+void
+gs_download_scheduler_download_file_async (GsDownloadScheduler *self,
+					   SoupSession         *soup_session,
+					   const gchar         *uri,
+					   GFile               *output_file,
+					   int                  io_priority,
+					   GsDownloadProgressCallback progress_callback,
+					   gpointer             progress_user_data,
+					   GCancellable        *cancellable,
+					   GAsyncReadyCallback  callback,
+					   gpointer             user_data)
+{
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (GS_IS_DOWNLOAD_SCHEDULER (self));
+	g_return_if_fail (SOUP_IS_SESSION (soup_session));
+	g_return_if_fail (uri != NULL);
+	g_return_if_fail (G_IS_FILE (output_file));
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gs_download_scheduler_download_file_async);
+
+	gs_download_scheduler_queue (self, task, JOB_KIND_FILE, soup_session, uri,
+				     output_file, NULL, io_priority,
+				     progress_callback, progress_user_data, cancellable);
+}
+
+/**
+ * gs_download_scheduler_download_file_finish:
+ * @self: a #GsDownloadScheduler
+ * @result: result of the asynchronous operation
+ * @error: return location for a #GError
+ *
+ * Finish an asynchronous download started with
+ * gs_download_scheduler_download_file_async().
+ *
+ * Returns: %TRUE on success, %FALSE otherwise
+ *
+ * Since: 48
+ */
+gboolean
+gs_download_scheduler_download_file_finish (GsDownloadScheduler  *self,
+					    GAsyncResult         *result,
+					    GError              **error)
+{
+	g_return_val_if_fail (GS_IS_DOWNLOAD_SCHEDULER (self), FALSE);
+	g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+	g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == gs_download_scheduler_download_file_async, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+/**
+ * gs_download_scheduler_set_max_per_host:
+ * @self: a #GsDownloadScheduler
+ * @max_per_host: the maximum number of downloads to run at once from each
+ *   host, or 0 for no limit
+ *
+ * Set how many downloads may run at once from each host. The default is
+ * %GS_DOWNLOAD_SCHEDULER_MAX_PER_HOST_DEFAULT.
+ *
+ * Since: 48
+ */
+void
+gs_download_scheduler_set_max_per_host (GsDownloadScheduler *self,
+					guint                max_per_host)
+{
+	g_autoptr(GPtrArray) to_start = g_ptr_array_new ();
+	GHashTableIter iter;
+	gpointer value;
+
+	g_return_if_fail (GS_IS_DOWNLOAD_SCHEDULER (self));
+
+	g_mutex_lock (&self->mutex);
+	self->max_per_host = max_per_host;
+
+	/* the limit may have been raised */
+	g_hash_table_iter_init (&iter, self->hosts);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		take_startable_jobs (self, value, to_start);
+	g_mutex_unlock (&self->mutex);
+
+	start_jobs (to_start);
+}
+
+/**
+ * gs_download_scheduler_get_max_per_host:
+ * @self: a #GsDownloadScheduler
+ *
+ * Get the value set with gs_download_scheduler_set_max_per_host().
+ *
+ * Returns: the maximum number of downloads run at once from each host, or 0
+ *   if there is no limit
+ *
+ * Since: 48
+ */
+guint
+gs_download_scheduler_get_max_per_host (GsDownloadScheduler *self)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (GS_IS_DOWNLOAD_SCHEDULER (self), 0);
+
+	locker = g_mutex_locker_new (&self->mutex);
+	return self->max_per_host;
+}
+
+static void
+gs_download_scheduler_finalize (GObject *object)
+{
+	GsDownloadScheduler *self = GS_DOWNLOAD_SCHEDULER (object);
+
+	/* every job holds a reference to the scheduler */
+	g_assert (g_hash_table_size (self->jobs) == 0);
+
+	g_hash_table_unref (self->jobs);
+	g_hash_table_unref (self->hosts);
+	g_mutex_clear (&self->mutex);
+
+	G_OBJECT_CLASS (gs_download_scheduler_parent_class)->finalize (object);
+}
+
+static void
+gs_download_scheduler_class_init (GsDownloadSchedulerClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = gs_download_scheduler_finalize;
+}
+
+static void
+gs_download_scheduler_init (GsDownloadScheduler *self)
+{
+	g_mutex_init (&self->mutex);
+	self->max_per_host = GS_DOWNLOAD_SCHEDULER_MAX_PER_HOST_DEFAULT;
+	self->jobs = g_hash_table_new (g_str_hash, g_str_equal);
+	self->hosts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) host_free);
+}
+
+/**
+ * gs_download_scheduler_new:
+ *
+ * Create a new #GsDownloadScheduler. Most callers should use the shared one,
+ * from gs_download_scheduler_get_default(), so that their downloads are
+ * scheduled together.
+ *
+ * Returns: (transfer full): a new #GsDownloadScheduler
+ *
+ * Since: 48
+ */
+GsDownloadScheduler *
+gs_download_scheduler_new (void)
+{
+	return g_object_new (GS_TYPE_DOWNLOAD_SCHEDULER, NULL);
+}
+
+/**
+ * gs_download_scheduler_get_default:
+ *
+ * Get the #GsDownloadScheduler shared by the whole process.
+ *
+ * Returns: (transfer none): the default #GsDownloadScheduler
+ *
+ * Since: 48
+ */
+GsDownloadScheduler *
+gs_download_scheduler_get_default (void)
+{
+	static GsDownloadScheduler *scheduler = NULL;
+
+	if (g_once_init_enter (&scheduler))
+		g_once_init_leave (&scheduler, gs_download_scheduler_new ());
+
+	return scheduler;
+}
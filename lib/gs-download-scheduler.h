@@ -0,0 +1,62 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Software contributors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gio/gio.h>
+#include <libsoup/soup.h>
+
+#include "gs-download-utils.h"
+
+G_BEGIN_DECLS
+
+/* the same as browsers use; gs_build_soup_session() sets the same limit, so
+ * requests wait in the scheduler, where they are prioritised, rather than in
+ * the #SoupSession */
+#define GS_DOWNLOAD_SCHEDULER_MAX_PER_HOST_DEFAULT 6
+
+#define GS_TYPE_DOWNLOAD_SCHEDULER (gs_download_scheduler_get_type ())
+
+G_DECLARE_FINAL_TYPE (GsDownloadScheduler, gs_download_scheduler, GS, DOWNLOAD_SCHEDULER, GObject)
+
+GsDownloadScheduler	*gs_download_scheduler_new		(void);
+GsDownloadScheduler	*gs_download_scheduler_get_default	(void);
+
+void		 gs_download_scheduler_set_max_per_host		(GsDownloadScheduler	*self,
+								 guint			 max_per_host);
+guint		 gs_download_scheduler_get_max_per_host		(GsDownloadScheduler	*self);
+
+void		 gs_download_scheduler_download_bytes_async	(GsDownloadScheduler	*self,
+								 SoupSession		*soup_session,
+								 const gchar		*uri,
+								 GDateTime		*last_modified_date,
+								 int			 io_priority,
+								 GCancellable		*cancellable,
+								 GAsyncReadyCallback	 callback,
+								 gpointer		 user_data);
+GBytes		*gs_download_scheduler_download_bytes_finish	(GsDownloadScheduler	*self,
+								 GAsyncResult		*result,
+								 GError			**error);
+
+void		 gs_download_scheduler_download_file_async	(GsDownloadScheduler	*self,
+								 SoupSession		*soup_session,
+								 const gchar		*uri,
+								 GFile			*output_file,
+								 int			 io_priority,
+								 GsDownloadProgressCallback progress_callback,
+								 gpointer		 progress_user_data,
+								 GCancellable		*cancellable,
+								 GAsyncReadyCallback	 callback,
+								 gpointer		 user_data);
+gboolean	 gs_download_scheduler_download_file_finish	(GsDownloadScheduler	*self,
+								 GAsyncResult		*result,
+								 GError			**error);
+
+G_END_DECLS
@@ -25,11 +25,23 @@
 #include <glib/gi18n.h>
 #include <libsoup/soup.h>
 
+#include "gs-download-scheduler.h"
 #include "gs-download-utils.h"
 #include "gs-utils.h"
 
 G_DEFINE_QUARK (gs-download-error-quark, gs_download_error)
 
+/* Bounds for the size of each read from the network. */
+#define MIN_BUFFER_SIZE_BYTES (8 * 1024)
+#define MAX_BUFFER_SIZE_BYTES (1024 * 1024)
+
+/* How long each read should take, at the download’s throughput. */
+#define TARGET_READ_TIME_USEC (100 * G_TIME_SPAN_MILLISECOND)
+
+/* Where the validator for a partial download is stored, see
+ * gs_download_get_resume_validator(). */
+#define METADATA_RESUME_VALIDATOR_ATTRIBUTE "xattr::gnome-software::resume-validator"
+
 /**
  * gs_build_soup_session:
  *
@@ -48,6 +60,7 @@ gs_build_soup_session (void)
 {
 	return soup_session_new_with_options ("user-agent", gs_user_agent (),
 					      "timeout", 10,
+					      "max-conns-per-host", GS_DOWNLOAD_SCHEDULER_MAX_PER_HOST_DEFAULT,
 					      NULL);
 }
 
@@ -113,6 +126,9 @@ typedef struct {
 	GsDownloadProgressCallback progress_callback;  /* (nullable) */
 	gpointer progress_user_data;
 
+	goffset resume_offset;
+	gchar *resume_validator;  /* (nullable) (owned) */
+
 	/* In-progress state. */
 	SoupMessage *message;  /* (nullable) (owned) */
 	gboolean close_input_stream;
@@ -122,6 +138,8 @@ typedef struct {
 	gsize total_written_bytes;
 	gsize expected_stream_size_bytes;
 	GBytes *currently_unwritten_chunk;  /* (nullable) (owned) */
+	gint64 read_start_time_usec;
+	gsize throughput_bytes_per_sec;
 
 	/* Output data. */
 	gchar *new_etag;  /* (nullable) (owned) */
@@ -142,6 +160,7 @@ download_data_free (DownloadData *data)
 
 	g_clear_pointer (&data->last_etag, g_free);
 	g_clear_pointer (&data->last_modified_date, g_date_time_unref);
+	g_clear_pointer (&data->resume_validator, g_free);
 	g_clear_object (&data->message);
 	g_clear_pointer (&data->uri, g_free);
 	g_clear_pointer (&data->new_etag, g_free);
@@ -169,6 +188,8 @@ static void close_stream_cb (GObject      *source_object,
                              GAsyncResult *result,
                              gpointer      user_data);
 static void download_progress (GTask *task);
+static void send_download_request (GTask *task);
+static void read_next_chunk (GTask *task);
 
 /**
  * gs_download_stream_async:
@@ -200,6 +221,9 @@ static void download_progress (GTask *task);
  * If specified, @progress_callback will be called zero or more times until
  * @callback is called, providing progress updates on the download.
  *
+ * This is equivalent to calling gs_download_stream_resume_async() with a
+ * @resume_offset of zero.
+ *
  * Since: 43
  */
 void
@@ -214,25 +238,94 @@ gs_download_stream_async (SoupSession                *soup_session,
                           GCancellable               *cancellable,
                           GAsyncReadyCallback         callback,
                           gpointer                    user_data)
+{
+	gs_download_stream_resume_async (soup_session, uri, output_stream,
+					 0, NULL, last_etag, last_modified_date,
+					 io_priority, progress_callback, progress_user_data,
+					 cancellable, callback, user_data);
+}
+
+/**
+ * gs_download_stream_resume_async:
+ * @soup_session: a #SoupSession
+ * @uri: (not nullable): the URI to download
+ * @output_stream: (not nullable): an output stream to write the download to,
+ *   which already contains the first @resume_offset bytes of it
+ * @resume_offset: number of bytes of @uri already downloaded, or zero to
+ *   download all of it
+ * @resume_validator: (nullable): the ETag or Last-Modified date returned by
+ *   the server when the first @resume_offset bytes were downloaded, as
+ *   returned by gs_download_get_resume_validator(); this must be non-%NULL if
+ *   @resume_offset is non-zero
+ * @last_etag: (nullable): the last-known ETag of the URI, or %NULL if unknown
+ * @last_modified_date: (nullable): the last-known Last-Modified date of the
+ *   URI, or %NULL if unknown
+ * @io_priority: I/O priority to download and write at
+ * @progress_callback: (nullable): callback to call with progress information
+ * @progress_user_data: (nullable) (closure progress_callback): data to pass
+ *   to @progress_callback
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @callback: callback to call once the operation is complete
+ * @user_data: (closure callback): data to pass to @callback
+ *
+ * Continue an interrupted download of @uri, writing the rest of it to
+ * @output_stream asynchronously.
+ *
+ * Only the bytes after @resume_offset are requested from the server, using
+ * an HTTP `Range` request. The request is conditional on @resume_validator
+ * (using `If-Range`), so if the file has changed on the server since the
+ * first part was downloaded, the server sends the whole file instead. In that
+ * case, and if the server doesn’t support range requests, @output_stream is
+ * truncated and the whole file is written to it. This requires
+ * @output_stream to be truncatable (for example, a #GFileOutputStream from
+ * g_file_append_to()).
+ *
+ * Progress reported to @progress_callback includes the @resume_offset bytes
+ * which were already downloaded.
+ *
+ * Otherwise, this behaves as gs_download_stream_async(). It must be finished
+ * with gs_download_stream_finish(). If the download fails, the ETag and
+ * Last-Modified date returned by gs_download_stream_finish() can be passed to
+ * gs_download_get_resume_validator() to resume it again later.
+ *
+ * Since: 48
+ */
+void
+gs_download_stream_resume_async (SoupSession                *soup_session,
+                                 const gchar                *uri,
+                                 GOutputStream              *output_stream,
+                                 goffset                     resume_offset,
+                                 const gchar                *resume_validator,
+                                 const gchar                *last_etag,
+                                 GDateTime                  *last_modified_date,
+                                 int                         io_priority,
+                                 GsDownloadProgressCallback  progress_callback,
+                                 gpointer                    progress_user_data,
+                                 GCancellable               *cancellable,
+                                 GAsyncReadyCallback         callback,
+                                 gpointer                    user_data)
 {
 	g_autoptr(GTask) task = NULL;
-	g_autoptr(SoupMessage) msg = NULL;
 	DownloadData *data;
 	g_autoptr(DownloadData) data_owned = NULL;
 
 	g_return_if_fail (SOUP_IS_SESSION (soup_session));
 	g_return_if_fail (uri != NULL);
 	g_return_if_fail (G_IS_OUTPUT_STREAM (output_stream));
+	g_return_if_fail (resume_offset >= 0);
+	g_return_if_fail (resume_offset == 0 || resume_validator != NULL);
 	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
 
 	task = g_task_new (soup_session, cancellable, callback, user_data);
-	g_task_set_source_tag (task, gs_download_stream_async);
+	g_task_set_source_tag (task, gs_download_stream_resume_async);
 
 	data = data_owned = g_new0 (DownloadData, 1);
 	data->uri = g_strdup (uri);
 	data->output_stream = g_object_ref (output_stream);
 	data->close_output_stream = TRUE;
-	data->buffer_size_bytes = 8192;  /* arbitrarily chosen */
+	data->buffer_size_bytes = MIN_BUFFER_SIZE_BYTES;
+	data->resume_offset = resume_offset;
+	data->resume_validator = (resume_offset > 0) ? g_strdup (resume_validator) : NULL;
 	data->io_priority = io_priority;
 	data->progress_callback = progress_callback;
 	data->progress_user_data = progress_user_data;
@@ -247,17 +340,8 @@ gs_download_stream_async (SoupSession                *soup_session,
 	}
 
 	/* remote */
-	g_debug ("Downloading %s to %s", uri, G_OBJECT_TYPE_NAME (output_stream));
-	msg = soup_message_new (SOUP_METHOD_GET, uri);
-	if (msg == NULL) {
-		finish_download (task,
-				 g_error_new (G_IO_ERROR,
-					      G_IO_ERROR_INVALID_ARGUMENT,
-					      "Failed to parse URI ‘%s’", uri));
-		return;
-	}
-
-	data->message = g_object_ref (msg);
+	g_debug ("Downloading %s to %s from offset %" G_GOFFSET_FORMAT,
+		 uri, G_OBJECT_TYPE_NAME (output_stream), resume_offset);
 
 	/* Caching support. Prefer ETags to modification dates, as the latter
 	 * have problems with rapid updates and clock drift. */
@@ -268,19 +352,52 @@ gs_download_stream_async (SoupSession                *soup_session,
 	if (last_modified_date != NULL)
 		data->last_modified_date = g_date_time_ref (last_modified_date);
 
-	if (last_etag != NULL) {
-#if SOUP_CHECK_VERSION(3, 0, 0)
-		soup_message_headers_append (soup_message_get_request_headers (msg), "If-None-Match", last_etag);
-#else
-		soup_message_headers_append (msg->request_headers, "If-None-Match", last_etag);
-#endif
-	} else if (last_modified_date != NULL) {
-		g_autofree gchar *last_modified_date_str = date_time_to_rfc7231 (last_modified_date);
+	send_download_request (g_steal_pointer (&task));
+}
+
+/* Build and send the HTTP request for the download, resuming it from
+ * data->resume_offset if that’s non-zero. This may be called a second time
+ * for a download, if the server can’t resume it. */
+static void
+send_download_request (GTask *task_in)
+{
+	g_autoptr(GTask) task = task_in;
+	SoupSession *soup_session = g_task_get_source_object (task);
+	GCancellable *cancellable = g_task_get_cancellable (task);
+	DownloadData *data = g_task_get_task_data (task);
+	g_autoptr(SoupMessage) msg = NULL;
+	SoupMessageHeaders *request_headers;
+
+	msg = soup_message_new (SOUP_METHOD_GET, data->uri);
+	if (msg == NULL) {
+		finish_download (task,
+				 g_error_new (G_IO_ERROR,
+					      G_IO_ERROR_INVALID_ARGUMENT,
+					      "Failed to parse URI ‘%s’", data->uri));
+		return;
+	}
+
+	g_clear_object (&data->message);
+	data->message = g_object_ref (msg);
+
 #if SOUP_CHECK_VERSION(3, 0, 0)
-		soup_message_headers_append (soup_message_get_request_headers (msg), "If-Modified-Since", last_modified_date_str);
+	request_headers = soup_message_get_request_headers (msg);
 #else
-		soup_message_headers_append (msg->request_headers, "If-Modified-Since", last_modified_date_str);
+	request_headers = msg->request_headers;
 #endif
+
+	if (data->last_etag != NULL) {
+		soup_message_headers_append (request_headers, "If-None-Match", data->last_etag);
+	} else if (data->last_modified_date != NULL) {
+		g_autofree gchar *last_modified_date_str = date_time_to_rfc7231 (data->last_modified_date);
+		soup_message_headers_append (request_headers, "If-Modified-Since", last_modified_date_str);
+	}
+
+	/* Only ask for the rest of the file if it hasn’t changed since the
+	 * first part was downloaded; otherwise the server sends all of it. */
+	if (data->resume_offset > 0) {
+		soup_message_headers_set_range (request_headers, data->resume_offset, -1);
+		soup_message_headers_append (request_headers, "If-Range", data->resume_validator);
 	}
 
 #if SOUP_CHECK_VERSION(3, 0, 0)
@@ -290,6 +407,38 @@ gs_download_stream_async (SoupSession                *soup_session,
 #endif
 }
 
+/* Throw away what has been written to the output stream so far, so the
+ * download can start again from the beginning. */
+static gboolean
+truncate_output_stream (DownloadData  *data,
+                        GCancellable  *cancellable,
+                        GError       **error)
+{
+	GSeekable *seekable = G_IS_SEEKABLE (data->output_stream) ? G_SEEKABLE (data->output_stream) : NULL;
+
+	if (seekable == NULL || !g_seekable_can_truncate (seekable)) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+			     "Failed to download ‘%s’: Server could not resume the download, "
+			     "and the output stream cannot be truncated to restart it",
+			     data->uri);
+		return FALSE;
+	}
+
+	if (!g_seekable_truncate (seekable, 0, cancellable, error))
+		return FALSE;
+
+	/* Streams opened for appending always write at the end, but other
+	 * streams need to be moved back to the start. */
+	if (g_seekable_can_seek (seekable) &&
+	    !g_seekable_seek (seekable, 0, G_SEEK_SET, cancellable, error))
+		return FALSE;
+
+	data->resume_offset = 0;
+	g_clear_pointer (&data->resume_validator, g_free);
+
+	return TRUE;
+}
+
 static void
 open_input_stream_cb (GObject      *source_object,
                       GAsyncResult *result,
@@ -319,8 +468,18 @@ open_input_stream_cb (GObject      *source_object,
 		g_assert (data->input_stream == NULL);
 		data->input_stream = g_object_ref (input_stream);
 		data->close_input_stream = TRUE;
+
+		if (data->resume_offset > 0 &&
+		    !g_seekable_seek (G_SEEKABLE (input_stream), data->resume_offset,
+				      G_SEEK_SET, cancellable, &local_error)) {
+			g_prefix_error (&local_error, "Failed to resume reading ‘%s’: ",
+					g_file_peek_path (local_file));
+			finish_download (task, g_steal_pointer (&local_error));
+			return;
+		}
 	} else if (SOUP_IS_SESSION (source_object)) {
 		SoupSession *soup_session = SOUP_SESSION (source_object);
+		SoupMessageHeaders *response_headers;
 		guint status_code;
 		const gchar *new_etag, *new_last_modified_str;
 
@@ -328,11 +487,31 @@ open_input_stream_cb (GObject      *source_object,
 #if SOUP_CHECK_VERSION(3, 0, 0)
 		input_stream = soup_session_send_finish (soup_session, result, &local_error);
 		status_code = soup_message_get_status (data->message);
+		response_headers = soup_message_get_response_headers (data->message);
 #else
 		input_stream = soup_session_send_finish (soup_session, result, &local_error);
 		status_code = data->message->status_code;
+		response_headers = data->message->response_headers;
 #endif
 
+		/* The partial download is longer than the file on the server,
+		 * so it can’t be the start of it. Download all of it again. */
+		if (status_code == SOUP_STATUS_REQUESTED_RANGE_NOT_SATISFIABLE &&
+		    data->resume_offset > 0) {
+			g_debug ("Server could not resume download of %s, restarting it", data->uri);
+
+			if (input_stream != NULL)
+				g_input_stream_close_async (input_stream, data->io_priority, NULL, NULL, NULL);
+
+			if (!truncate_output_stream (data, cancellable, &local_error)) {
+				finish_download (task, g_steal_pointer (&local_error));
+				return;
+			}
+
+			send_download_request (g_steal_pointer (&task));
+			return;
+		}
+
 		if (input_stream != NULL) {
 			g_assert (data->input_stream == NULL);
 			data->input_stream = g_object_ref (input_stream);
@@ -355,7 +534,8 @@ open_input_stream_cb (GObject      *source_object,
 						      "Skipped downloading ‘%s’: %s",
 						      data->uri, soup_status_get_phrase (status_code)));
 			return;
-		} else if (status_code != SOUP_STATUS_OK) {
+		} else if (status_code != SOUP_STATUS_OK &&
+			   !(status_code == SOUP_STATUS_PARTIAL_CONTENT && data->resume_offset > 0)) {
 			g_autoptr(GString) str = g_string_new (NULL);
 			g_string_append (str, soup_status_get_phrase (status_code));
 
@@ -378,29 +558,41 @@ open_input_stream_cb (GObject      *source_object,
 
 		g_assert (input_stream != NULL);
 
+		if (status_code == SOUP_STATUS_PARTIAL_CONTENT) {
+			goffset range_start, range_end, range_total;
+
+			/* Check the server sent the part which was asked for. */
+			if (!soup_message_headers_get_content_range (response_headers, &range_start, &range_end, &range_total) ||
+			    range_start != data->resume_offset) {
+				finish_download (task,
+						 g_error_new (G_IO_ERROR,
+							      G_IO_ERROR_FAILED,
+							      "Failed to download ‘%s’: Server returned the wrong range",
+							      data->uri));
+				return;
+			}
+		} else if (data->resume_offset > 0) {
+			/* The file changed since the first part was
+			 * downloaded, or the server ignored the range. */
+			g_debug ("Server sent all of %s rather than resuming, restarting download", data->uri);
+
+			if (!truncate_output_stream (data, cancellable, &local_error)) {
+				finish_download (task, g_steal_pointer (&local_error));
+				return;
+			}
+		}
+
 		/* Get the expected download size. */
-#if SOUP_CHECK_VERSION(3, 0, 0)
-		data->expected_stream_size_bytes = soup_message_headers_get_content_length (soup_message_get_response_headers (data->message));
-#else
-		data->expected_stream_size_bytes = soup_message_headers_get_content_length (data->message->response_headers);
-#endif
+		data->expected_stream_size_bytes = data->resume_offset + soup_message_headers_get_content_length (response_headers);
 
 		/* Store the new ETag for later use. */
-#if SOUP_CHECK_VERSION(3, 0, 0)
-		new_etag = soup_message_headers_get_one (soup_message_get_response_headers (data->message), "ETag");
-#else
-		new_etag = soup_message_headers_get_one (data->message->response_headers, "ETag");
-#endif
+		new_etag = soup_message_headers_get_one (response_headers, "ETag");
 		if (new_etag != NULL && *new_etag == '\0')
 			new_etag = NULL;
 		data->new_etag = g_strdup (new_etag);
 
 		/* Store the Last-Modified date for later use. */
-#if SOUP_CHECK_VERSION(3, 0, 0)
-		new_last_modified_str = soup_message_headers_get_one (soup_message_get_response_headers (data->message), "Last-Modified");
-#else
-		new_last_modified_str = soup_message_headers_get_one (data->message->response_headers, "Last-Modified");
-#endif
+		new_last_modified_str = soup_message_headers_get_one (response_headers, "Last-Modified");
 		if (new_last_modified_str != NULL && *new_last_modified_str == '\0')
 			new_last_modified_str = NULL;
 		if (new_last_modified_str != NULL)
@@ -409,13 +601,56 @@ open_input_stream_cb (GObject      *source_object,
 		g_assert_not_reached ();
 	}
 
+	/* The first part of the download is already in the output stream. */
+	data->total_read_bytes = data->resume_offset;
+	data->total_written_bytes = data->resume_offset;
+	data->expected_stream_size_bytes = MAX (data->expected_stream_size_bytes, data->total_read_bytes);
+
 	/* Splice in an asynchronous loop. We unfortunately can’t use
 	 * g_output_stream_splice_async() here, as it doesn’t provide a progress
 	 * callback. The approach is the same though. */
-	g_input_stream_read_bytes_async (input_stream, data->buffer_size_bytes, data->io_priority,
+	read_next_chunk (g_steal_pointer (&task));
+}
+
+static void
+read_next_chunk (GTask *task_in)
+{
+	g_autoptr(GTask) task = task_in;
+	DownloadData *data = g_task_get_task_data (task);
+	GCancellable *cancellable = g_task_get_cancellable (task);
+
+	data->read_start_time_usec = g_get_monotonic_time ();
+	g_input_stream_read_bytes_async (data->input_stream, data->buffer_size_bytes, data->io_priority,
 					 cancellable, read_bytes_cb, g_steal_pointer (&task));
 }
 
+/* Size the read buffer to hold about TARGET_READ_TIME_USEC worth of data at
+ * the throughput seen so far. A small buffer limits fast downloads, as each
+ * read and write takes a main loop iteration; a large one wastes memory on
+ * slow downloads, as each read allocates the whole buffer. */
+static void
+update_buffer_size (DownloadData *data,
+                    gsize         n_read_bytes)
+{
+	gint64 elapsed_usec = MAX (g_get_monotonic_time () - data->read_start_time_usec, 1);
+	guint64 sample = (guint64) n_read_bytes * G_USEC_PER_SEC / elapsed_usec;
+	guint64 target;
+
+	/* An exponential moving average, so one slow read doesn’t shrink the
+	 * buffer straight away. */
+	if (data->throughput_bytes_per_sec == 0)
+		data->throughput_bytes_per_sec = MIN (sample, G_MAXSIZE);
+	else
+		data->throughput_bytes_per_sec = MIN ((3 * (guint64) data->throughput_bytes_per_sec + sample) / 4, G_MAXSIZE);
+
+	target = (guint64) data->throughput_bytes_per_sec * TARGET_READ_TIME_USEC / G_USEC_PER_SEC;
+	target = CLAMP (target, MIN_BUFFER_SIZE_BYTES, MAX_BUFFER_SIZE_BYTES);
+
+	/* Round up to a power of two, so the size doesn’t change on every
+	 * read. */
+	data->buffer_size_bytes = (gsize) 1 << g_bit_storage (target - 1);
+}
+
 static void
 read_bytes_cb (GObject      *source_object,
                GAsyncResult *result,
@@ -435,6 +670,8 @@ read_bytes_cb (GObject      *source_object,
 		return;
 	}
 
+	update_buffer_size (data, g_bytes_get_size (bytes));
+
 	/* Report progress. */
 	data->total_read_bytes += g_bytes_get_size (bytes);
 	data->expected_stream_size_bytes = MAX (data->expected_stream_size_bytes, data->total_read_bytes);
@@ -495,8 +732,7 @@ write_bytes_cb (GObject      *source_object,
 		/* Full write succeeded. Start the next read. */
 		g_clear_pointer (&data->currently_unwritten_chunk, g_bytes_unref);
 
-		g_input_stream_read_bytes_async (data->input_stream, data->buffer_size_bytes, data->io_priority,
-						 cancellable, read_bytes_cb, g_steal_pointer (&task));
+		read_next_chunk (g_steal_pointer (&task));
 	}
 }
 
@@ -632,7 +868,7 @@ download_progress (GTask *task)
  * @error: return location for a #GError
  *
  * Finish an asynchronous download operation started with
- * gs_download_stream_async().
+ * gs_download_stream_async() or gs_download_stream_resume_async().
  *
  * Returns: %TRUE on success, %FALSE otherwise
  * Since: 43
@@ -647,7 +883,7 @@ gs_download_stream_finish (SoupSession   *soup_session,
 	DownloadData *data;
 
 	g_return_val_if_fail (g_task_is_valid (result, soup_session), FALSE);
-	g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == gs_download_stream_async, FALSE);
+	g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == gs_download_stream_resume_async, FALSE);
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
 	data = g_task_get_task_data (G_TASK (result));
@@ -660,6 +896,36 @@ gs_download_stream_finish (SoupSession   *soup_session,
 	return g_task_propagate_boolean (G_TASK (result), error);
 }
 
+/**
+ * gs_download_get_resume_validator:
+ * @etag: (nullable): the ETag returned by the server for a download, or %NULL
+ * @last_modified_date: (nullable): the Last-Modified date returned by the
+ *   server for a download, or %NULL
+ *
+ * Get the value to pass as the `resume_validator` to
+ * gs_download_stream_resume_async(), to resume a download which returned
+ * @etag and @last_modified_date from gs_download_stream_finish().
+ *
+ * The server only resumes a download if the file is unchanged since the first
+ * part of it was downloaded, which needs a strong ETag or a Last-Modified
+ * date.
+ *
+ * Returns: (transfer full) (nullable): the validator, or %NULL if the download
+ *   can’t be resumed
+ * Since: 48
+ */
+gchar *
+gs_download_get_resume_validator (const gchar *etag,
+                                  GDateTime   *last_modified_date)
+{
+	/* Weak ETags can’t be used in If-Range. */
+	if (etag != NULL && *etag != '\0' && !g_str_has_prefix (etag, "W/"))
+		return g_strdup (etag);
+	if (last_modified_date != NULL)
+		return date_time_to_rfc7231 (last_modified_date);
+	return NULL;
+}
+
 typedef struct {
 	/* Input data. */
 	gchar *uri;  /* (not nullable) (owned) */
@@ -671,6 +937,10 @@ typedef struct {
 	/* In-progress data. */
 	gchar *last_etag;  /* (nullable) (owned) */
 	GDateTime *last_modified_date;  /* (nullable) (owned) */
+	GFile *part_file;  /* (not nullable) (owned) */
+	goffset resume_offset;
+	gchar *resume_validator;  /* (nullable) (owned) */
+	gchar *new_etag;  /* (nullable) (owned) */
 } DownloadFileData;
 
 static void
@@ -680,17 +950,26 @@ download_file_data_free (DownloadFileData *data)
 	g_clear_object (&data->output_file);
 	g_free (data->last_etag);
 	g_clear_pointer (&data->last_modified_date, g_date_time_unref);
+	g_clear_object (&data->part_file);
+	g_free (data->resume_validator);
+	g_free (data->new_etag);
 	g_free (data);
 }
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (DownloadFileData, download_file_data_free)
 
-static void download_replace_file_cb (GObject      *source_object,
-                                      GAsyncResult *result,
-                                      gpointer      user_data);
+static void download_delete_part_file_cb (GObject      *source_object,
+                                          GAsyncResult *result,
+                                          gpointer      user_data);
+static void download_append_part_file_cb (GObject      *source_object,
+                                          GAsyncResult *result,
+                                          gpointer      user_data);
 static void download_file_cb (GObject      *source_object,
                               GAsyncResult *result,
                               gpointer      user_data);
+static void download_move_part_file_cb (GObject      *source_object,
+                                        GAsyncResult *result,
+                                        gpointer      user_data);
 
 /**
  * gs_download_file_async:
@@ -711,6 +990,12 @@ static void download_file_cb (GObject      *source_object,
  * The ETag and modification time of @output_file will be queried and, if known,
  * used to skip the download if @output_file is already up to date.
  *
+ * The download is written to a `.part` file next to @output_file, which
+ * replaces @output_file once the download is complete. If the download fails
+ * or is cancelled, the `.part` file is kept, and the next call for the same
+ * @output_file resumes the download from where it stopped, if the file on the
+ * server is unchanged. See gs_download_stream_resume_async().
+ *
  * If specified, @progress_callback will be called zero or more times until
  * @callback is called, providing progress updates on the download.
  *
@@ -731,6 +1016,9 @@ gs_download_file_async (SoupSession                *soup_session,
 	DownloadFileData *data;
 	g_autoptr(DownloadFileData) data_owned = NULL;
 	g_autoptr(GFile) output_file_parent = NULL;
+	g_autofree gchar *output_basename = NULL;
+	g_autofree gchar *part_basename = NULL;
+	g_autoptr(GFileInfo) part_info = NULL;
 	g_autoptr(GError) local_error = NULL;
 
 	g_return_if_fail (SOUP_IS_SESSION (soup_session));
@@ -754,8 +1042,13 @@ gs_download_file_async (SoupSession                *soup_session,
 	 * likely to be fast. */
 	output_file_parent = g_file_get_parent (output_file);
 
-	if (output_file_parent != NULL &&
-	    !g_file_make_directory_with_parents (output_file_parent, cancellable, &local_error) &&
+	if (output_file_parent == NULL) {
+		g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_INVALID_FILENAME,
+					 "Cannot download to ‘%s’", g_file_peek_path (output_file));
+		return;
+	}
+
+	if (!g_file_make_directory_with_parents (output_file_parent, cancellable, &local_error) &&
 	    !g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_EXISTS)) {
 		g_task_return_error (task, g_steal_pointer (&local_error));
 		return;
@@ -766,34 +1059,76 @@ gs_download_file_async (SoupSession                *soup_session,
 	/* Query the old ETag and modification date if the file already exists. */
 	data->last_etag = gs_utils_get_file_etag (output_file, &data->last_modified_date, cancellable);
 
+	/* See if an earlier download was interrupted, and can be resumed.
+	 * FIXME: This should be made async too. */
+	output_basename = g_file_get_basename (output_file);
+	part_basename = g_strconcat (output_basename, ".part", NULL);
+	data->part_file = g_file_get_child (output_file_parent, part_basename);
+
+	part_info = g_file_query_info (data->part_file,
+				       G_FILE_ATTRIBUTE_STANDARD_SIZE "," METADATA_RESUME_VALIDATOR_ATTRIBUTE,
+				       G_FILE_QUERY_INFO_NONE, cancellable, NULL);
+	if (part_info != NULL &&
+	    g_file_info_get_size (part_info) > 0 &&
+	    g_file_info_get_attribute_string (part_info, METADATA_RESUME_VALIDATOR_ATTRIBUTE) != NULL) {
+		data->resume_offset = g_file_info_get_size (part_info);
+		data->resume_validator = g_strdup (g_file_info_get_attribute_string (part_info, METADATA_RESUME_VALIDATOR_ATTRIBUTE));
+
+		g_debug ("Resuming download of %s from %s at offset %" G_GOFFSET_FORMAT,
+			 uri, g_file_peek_path (data->part_file), data->resume_offset);
+
+		g_file_append_to_async (data->part_file,
+					G_FILE_CREATE_PRIVATE,
+					io_priority,
+					cancellable,
+					download_append_part_file_cb,
+					g_steal_pointer (&task));
+	} else {
+		/* Any existing partial download can’t be resumed, so start
+		 * again. */
+		g_file_delete_async (data->part_file,
+				     io_priority,
+				     cancellable,
+				     download_delete_part_file_cb,
+				     g_steal_pointer (&task));
+	}
+}
+
+static void
+download_delete_part_file_cb (GObject      *source_object,
+                              GAsyncResult *result,
+                              gpointer      user_data)
+{
+	GFile *part_file = G_FILE (source_object);
+	g_autoptr(GTask) task = g_steal_pointer (&user_data);
+	GCancellable *cancellable = g_task_get_cancellable (task);
+	DownloadFileData *data = g_task_get_task_data (task);
+	g_autoptr(GError) local_error = NULL;
+
+	if (!g_file_delete_finish (part_file, result, &local_error) &&
+	    !g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND)) {
+		g_task_return_error (task, g_steal_pointer (&local_error));
+		return;
+	}
+
 	/* Create the output file.
 	 *
-	 * Note that `data->last_etag` is *not* passed in here, as the ETag from
-	 * the server and the file modification ETag that GLib uses are
-	 * different things. For g_file_replace_async(), GLib always uses an
-	 * ETag it generates internally based on the file mtime (see
-	 * _g_local_file_info_create_etag()), which will never match what the
-	 * server returns in its ETag header.
-	 *
-	 * This is fine, as we are using the ETag to avoid an unnecessary HTTP
-	 * download if possible. We don’t care about tracking changes to the
-	 * file on disk. */
-	g_file_replace_async (output_file,
-			      NULL,  /* ETag */
-			      FALSE,  /* make_backup */
-			      G_FILE_CREATE_PRIVATE | G_FILE_CREATE_REPLACE_DESTINATION,
-			      io_priority,
-			      cancellable,
-			      download_replace_file_cb,
-			      g_steal_pointer (&task));
+	 * This is appended to, rather than replaced, so that what has been
+	 * downloaded is kept if the download is interrupted. */
+	g_file_append_to_async (part_file,
+				G_FILE_CREATE_PRIVATE,
+				data->io_priority,
+				cancellable,
+				download_append_part_file_cb,
+				g_steal_pointer (&task));
 }
 
 static void
-download_replace_file_cb (GObject      *source_object,
-                          GAsyncResult *result,
-                          gpointer      user_data)
+download_append_part_file_cb (GObject      *source_object,
+                              GAsyncResult *result,
+                              gpointer      user_data)
 {
-	GFile *output_file = G_FILE (source_object);
+	GFile *part_file = G_FILE (source_object);
 	g_autoptr(GTask) task = g_steal_pointer (&user_data);
 	SoupSession *soup_session = g_task_get_source_object (task);
 	GCancellable *cancellable = g_task_get_cancellable (task);
@@ -801,18 +1136,24 @@ download_replace_file_cb (GObject      *source_object,
 	g_autoptr(GFileOutputStream) output_stream = NULL;
 	g_autoptr(GError) local_error = NULL;
 
-	output_stream = g_file_replace_finish (output_file, result, &local_error);
+	output_stream = g_file_append_to_finish (part_file, result, &local_error);
 
 	if (output_stream == NULL) {
 		g_task_return_error (task, g_steal_pointer (&local_error));
 		return;
 	}
 
-	/* Do the download. */
-	gs_download_stream_async (soup_session, data->uri, G_OUTPUT_STREAM (output_stream),
-				  data->last_etag, data->last_modified_date, data->io_priority,
-				  data->progress_callback, data->progress_user_data,
-				  cancellable, download_file_cb, g_steal_pointer (&task));
+	/* Do the download.
+	 *
+	 * Note that `data->last_etag` is the ETag returned by the server when
+	 * @output_file was last downloaded, not the file modification ETag
+	 * that GLib uses, which will never match what the server returns in
+	 * its ETag header. */
+	gs_download_stream_resume_async (soup_session, data->uri, G_OUTPUT_STREAM (output_stream),
+					 data->resume_offset, data->resume_validator,
+					 data->last_etag, data->last_modified_date, data->io_priority,
+					 data->progress_callback, data->progress_user_data,
+					 cancellable, download_file_cb, g_steal_pointer (&task));
 }
 
 static void
@@ -825,13 +1166,64 @@ download_file_cb (GObject      *source_object,
 	GCancellable *cancellable = g_task_get_cancellable (task);
 	DownloadFileData *data = g_task_get_task_data (task);
 	g_autofree gchar *new_etag = NULL;
+	g_autoptr(GDateTime) new_last_modified_date = NULL;
+	g_autoptr(GError) local_error = NULL;
+
+	if (!gs_download_stream_finish (soup_session, result, &new_etag, &new_last_modified_date, &local_error)) {
+		g_autofree gchar *resume_validator = NULL;
+
+		if (g_error_matches (local_error, GS_DOWNLOAD_ERROR, GS_DOWNLOAD_ERROR_NOT_MODIFIED)) {
+			/* @output_file is up to date, so nothing needs
+			 * resuming. */
+			g_file_delete_async (data->part_file, G_PRIORITY_LOW, NULL, NULL, NULL);
+		} else {
+			/* Keep what was downloaded, and remember which
+			 * version of the file it’s from, so the download can
+			 * be resumed next time. If the server didn’t respond,
+			 * any validator stored earlier is still correct. */
+			resume_validator = gs_download_get_resume_validator (new_etag, new_last_modified_date);
+
+			if (resume_validator != NULL &&
+			    !g_file_set_attribute_string (data->part_file, METADATA_RESUME_VALIDATOR_ATTRIBUTE,
+							  resume_validator, G_FILE_QUERY_INFO_NONE, NULL, NULL))
+				g_debug ("Failed to store resume validator for %s; it will be downloaded again",
+					 g_file_peek_path (data->part_file));
+		}
+
+		g_task_return_error (task, g_steal_pointer (&local_error));
+		return;
+	}
+
+	data->new_etag = g_steal_pointer (&new_etag);
+
+	/* Replace @output_file with the completed download. */
+	g_file_move_async (data->part_file, data->output_file,
+			   G_FILE_COPY_OVERWRITE | G_FILE_COPY_NOFOLLOW_SYMLINKS,
+			   data->io_priority, cancellable,
+			   NULL, NULL,
+			   download_move_part_file_cb, g_steal_pointer (&task));
+}
+
+static void
+download_move_part_file_cb (GObject      *source_object,
+                            GAsyncResult *result,
+                            gpointer      user_data)
+{
+	GFile *part_file = G_FILE (source_object);
+	g_autoptr(GTask) task = g_steal_pointer (&user_data);
+	GCancellable *cancellable = g_task_get_cancellable (task);
+	DownloadFileData *data = g_task_get_task_data (task);
 	g_autoptr(GError) local_error = NULL;
 
-	if (!gs_download_stream_finish (soup_session, result, &new_etag, NULL, &local_error)) {
+	if (!g_file_move_finish (part_file, result, &local_error)) {
 		g_task_return_error (task, g_steal_pointer (&local_error));
 		return;
 	}
 
+	/* The validator was only needed while the download was incomplete. */
+	g_file_set_attribute (data->output_file, METADATA_RESUME_VALIDATOR_ATTRIBUTE, G_FILE_ATTRIBUTE_TYPE_INVALID,
+			      NULL, G_FILE_QUERY_INFO_NONE, cancellable, NULL);
+
 	/* Update the stored HTTP ETag.
 	 *
 	 * Under the assumption that this code is only ever used for locally
@@ -843,7 +1235,7 @@ download_file_cb (GObject      *source_object,
 	 * checked for updates to it — which is correct to send as the
 	 * If-Modified-Since the next time gnome-software checks for updates to
 	 * the file. */
-	gs_utils_set_file_etag (data->output_file, new_etag, cancellable);
+	gs_utils_set_file_etag (data->output_file, data->new_etag, cancellable);
 
 	g_task_return_boolean (task, TRUE);
 }
@@ -66,12 +66,28 @@ void		gs_download_stream_async	(SoupSession                *soup_session,
 						 GCancellable               *cancellable,
 						 GAsyncReadyCallback         callback,
 						 gpointer                    user_data);
+void		gs_download_stream_resume_async	(SoupSession                *soup_session,
+						 const gchar                *uri,
+						 GOutputStream              *output_stream,
+						 goffset                     resume_offset,
+						 const gchar                *resume_validator,
+						 const gchar                *last_etag,
+						 GDateTime                  *last_modified_date,
+						 int                         io_priority,
+						 GsDownloadProgressCallback  progress_callback,
+						 gpointer                    progress_user_data,
+						 GCancellable               *cancellable,
+						 GAsyncReadyCallback         callback,
+						 gpointer                    user_data);
 gboolean	gs_download_stream_finish	(SoupSession   *soup_session,
 						 GAsyncResult  *result,
 						 gchar        **new_etag_out,
 						 GDateTime    **new_last_modified_date_out,
 						 GError       **error);
 
+gchar		*gs_download_get_resume_validator (const gchar *etag,
+						   GDateTime   *last_modified_date);
+
 void		gs_download_file_async		(SoupSession                *soup_session,
 						 const gchar                *uri,
 						 GFile                      *output_file,
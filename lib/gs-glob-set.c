@@ -0,0 +1,683 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Software contributors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/**
+ * SECTION:gs-glob-set
+ * @short_description: Matches a string against many glob patterns at once
+ *
+ * #GsGlobSet holds a set of fnmatch() patterns, each with a non-zero value,
+ * and matches a string against all of them in a single pass, returning the
+ * bitwise OR of the values of the patterns which match. It gives the same
+ * results as calling fnmatch() with no flags on each pattern in turn.
+ *
+ * Patterns are sorted into groups as they are added:
+ *
+ *  - literal patterns are looked up in a hash table;
+ *  - `prefix*` and `*suffix` patterns are looked up in hash tables, one
+ *    lookup for each distinct prefix or suffix length;
+ *  - all other patterns are compiled together into an NFA, which is turned
+ *    into a DFA lazily, one state at a time, as strings are matched; so
+ *    matching a string costs one table lookup per byte however many
+ *    patterns there are.
+ *
+ * Patterns which use features the DFA doesn’t support, such as character
+ * classes (`[[:alpha:]]`), and strings which aren’t ASCII, where `?`
+ * matches a whole character, fall back to fnmatch().
+ *
+ * Adding patterns is not thread safe, but once all the patterns have been
+ * added a #GsGlobSet can be matched against from any thread.
+ *
+ * Since: 48
+ */
+
+#include "config.h"
+
+#include <fnmatch.h>
+#include <string.h>
+#include <glib.h>
+
+#include "gs-glob-set.h"
+
+/* above this, the DFA cache is cleared and rebuilt as it is used; each state
+ * takes a little over 1KB */
+#define MAX_DFA_STATES 1024
+
+#define DFA_STATE_UNKNOWN -1
+
+typedef enum {
+	POSITION_LITERAL,
+	POSITION_ANY,
+	POSITION_STAR,
+	POSITION_CLASS,
+	POSITION_ACCEPT,
+} PositionKind;
+
+/* One position in the NFA: a token of a pattern, or the end of a pattern */
+typedef struct {
+	PositionKind	 kind;
+	guint8		 literal;
+	guint32		 class_bits[8];	/* for POSITION_CLASS */
+	guint		 value;		/* for POSITION_ACCEPT */
+} Position;
+
+typedef struct {
+	guint		*positions;	/* (owned) (array length=n_positions), sorted */
+	guint		 n_positions;
+	guint		 value;		/* of the patterns which end here */
+	gint		 next[256];	/* state index, or DFA_STATE_UNKNOWN */
+} DfaState;
+
+typedef struct {
+	gchar		*pattern;	/* (owned) */
+	guint		 value;
+} FallbackPattern;
+
+struct _GsGlobSet {
+	guint		 n_patterns;
+
+	GHashTable	*literals;	/* (owned) (element-type utf8 uint) */
+	GHashTable	*prefixes;	/* (owned) (element-type utf8 uint) */
+	GArray		*prefix_lengths;	/* (owned) (element-type gsize), sorted */
+	GHashTable	*suffixes;	/* (owned) (element-type utf8 uint) */
+	GArray		*suffix_lengths;	/* (owned) (element-type gsize), sorted */
+
+	/* patterns compiled into the NFA, also kept for non-ASCII strings */
+	GArray		*positions;	/* (owned) (element-type Position) */
+	GArray		*starts;	/* (owned) (element-type guint) */
+	GArray		*general;	/* (owned) (element-type FallbackPattern) */
+	GArray		*fallback;	/* (owned) (element-type FallbackPattern) */
+
+	GMutex		 dfa_mutex;
+	GPtrArray	*dfa_states;	/* (owned) (element-type DfaState), index 0 is the start */
+	GHashTable	*dfa_index;	/* (owned) (element-type GBytes uint), positions to index + 1 */
+};
+
+static void
+fallback_pattern_clear (FallbackPattern *pattern)
+{
+	g_free (pattern->pattern);
+}
+
+static void
+dfa_state_free (DfaState *state)
+{
+	g_free (state->positions);
+	g_free (state);
+}
+
+/**
+ * gs_glob_set_new:
+ *
+ * Create a new, empty #GsGlobSet.
+ *
+ * Returns: (transfer full): a new #GsGlobSet
+ * Since: 48
+ */
+GsGlobSet *
+gs_glob_set_new (void)
+{
+	GsGlobSet *set = g_atomic_rc_box_new0 (GsGlobSet);
+
+	set->literals = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	set->prefixes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	set->prefix_lengths = g_array_new (FALSE, FALSE, sizeof (gsize));
+	set->suffixes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	set->suffix_lengths = g_array_new (FALSE, FALSE, sizeof (gsize));
+	set->positions = g_array_new (FALSE, FALSE, sizeof (Position));
+	set->starts = g_array_new (FALSE, FALSE, sizeof (guint));
+	set->general = g_array_new (FALSE, FALSE, sizeof (FallbackPattern));
+	g_array_set_clear_func (set->general, (GDestroyNotify) fallback_pattern_clear);
+	set->fallback = g_array_new (FALSE, FALSE, sizeof (FallbackPattern));
+	g_array_set_clear_func (set->fallback, (GDestroyNotify) fallback_pattern_clear);
+	g_mutex_init (&set->dfa_mutex);
+	set->dfa_states = g_ptr_array_new_with_free_func ((GDestroyNotify) dfa_state_free);
+	set->dfa_index = g_hash_table_new_full (g_bytes_hash, g_bytes_equal,
+						(GDestroyNotify) g_bytes_unref, NULL);
+
+	return set;
+}
+
+/**
+ * gs_glob_set_ref:
+ * @set: a #GsGlobSet
+ *
+ * Take a reference to @set.
+ *
+ * Returns: (transfer full): @set
+ * Since: 48
+ */
+GsGlobSet *
+gs_glob_set_ref (GsGlobSet *set)
+{
+	g_return_val_if_fail (set != NULL, NULL);
+	return g_atomic_rc_box_acquire (set);
+}
+
+static void
+gs_glob_set_clear (GsGlobSet *set)
+{
+	g_hash_table_unref (set->literals);
+	g_hash_table_unref (set->prefixes);
+	g_array_unref (set->prefix_lengths);
+	g_hash_table_unref (set->suffixes);
+	g_array_unref (set->suffix_lengths);
+	g_array_unref (set->positions);
+	g_array_unref (set->starts);
+	g_array_unref (set->general);
+	g_array_unref (set->fallback);
+	g_mutex_clear (&set->dfa_mutex);
+	g_ptr_array_unref (set->dfa_states);
+	g_hash_table_unref (set->dfa_index);
+}
+
+/**
+ * gs_glob_set_unref:
+ * @set: (transfer full): a #GsGlobSet
+ *
+ * Release a reference to @set, freeing it if it was the last one.
+ *
+ * Since: 48
+ */
+void
+gs_glob_set_unref (GsGlobSet *set)
+{
+	g_return_if_fail (set != NULL);
+	g_atomic_rc_box_release_full (set, (GDestroyNotify) gs_glob_set_clear);
+}
+
+static void
+class_set (Position *position, guint8 c)
+{
+	position->class_bits[c / 32] |= 1u << (c % 32);
+}
+
+static gboolean
+class_has (const Position *position, guint8 c)
+{
+	return (position->class_bits[c / 32] & (1u << (c % 32))) != 0;
+}
+
+/* Parse a bracket expression, with *p pointing just after the `[`. Returns
+ * %FALSE if it is one which fnmatch() has to handle: an unterminated one
+ * (which fnmatch() matches as a literal `[`), a named class, or one with
+ * non-ASCII characters. */
+static gboolean
+parse_class (const gchar **p, Position *position)
+{
+	const gchar *s = *p;
+	gboolean negate = FALSE;
+	gboolean first = TRUE;
+
+	position->kind = POSITION_CLASS;
+	memset (position->class_bits, 0, sizeof (position->class_bits));
+
+	if (*s == '!' || *s == '^') {
+		negate = TRUE;
+		s++;
+	}
+
+	while (first || *s != ']') {
+		guint8 lo, hi;
+
+		first = FALSE;
+		if (*s == '\0')
+			return FALSE;
+		if (*s == '[' && (s[1] == ':' || s[1] == '=' || s[1] == '.'))
+			return FALSE;
+		if (*s == '\\') {
+			s++;
+			if (*s == '\0')
+				return FALSE;
+		}
+		lo = (guint8) *s++;
+
+		if (*s == '-' && s[1] != ']' && s[1] != '\0') {
+			s++;
+			if (*s == '\\') {
+				s++;
+				if (*s == '\0')
+					return FALSE;
+			}
+			if (*s == '[' && (s[1] == ':' || s[1] == '=' || s[1] == '.'))
+				return FALSE;
+			hi = (guint8) *s++;
+		} else {
+			hi = lo;
+		}
+
+		if (lo >= 0x80 || hi >= 0x80)
+			return FALSE;
+		for (guint c = lo; c <= hi; c++)
+			class_set (position, c);
+	}
+
+	if (negate) {
+		for (gsize i = 0; i < G_N_ELEMENTS (position->class_bits); i++)
+			position->class_bits[i] = ~position->class_bits[i];
+	}
+
+	*p = s + 1;
+	return TRUE;
+}
+
+/* Returns %FALSE if @pattern needs fnmatch() */
+static gboolean
+parse_pattern (const gchar *pattern, GArray *positions)
+{
+	const gchar *p = pattern;
+
+	while (*p != '\0') {
+		Position position = { 0, };
+
+		if (*p == '*') {
+			position.kind = POSITION_STAR;
+			p++;
+			/* `**` is the same as `*` */
+			if (positions->len > 0 &&
+			    g_array_index (positions, Position, positions->len - 1).kind == POSITION_STAR)
+				continue;
+		} else if (*p == '?') {
+			position.kind = POSITION_ANY;
+			p++;
+		} else if (*p == '[') {
+			p++;
+			if (!parse_class (&p, &position))
+				return FALSE;
+		} else {
+			if (*p == '\\') {
+				p++;
+				if (*p == '\0')
+					return FALSE;
+			}
+			position.kind = POSITION_LITERAL;
+			position.literal = (guint8) *p++;
+		}
+
+		g_array_append_val (positions, position);
+	}
+
+	return TRUE;
+}
+
+/* Returns the literal string which @positions match from @start to @end, or
+ * %NULL if any of them aren’t literals */
+static gchar *
+positions_to_literal (GArray *positions, guint start, guint end)
+{
+	GString *str = g_string_sized_new (end - start);
+
+	for (guint i = start; i < end; i++) {
+		const Position *position = &g_array_index (positions, Position, i);
+		if (position->kind != POSITION_LITERAL) {
+			g_string_free (str, TRUE);
+			return NULL;
+		}
+		g_string_append_c (str, (gchar) position->literal);
+	}
+
+	return g_string_free (str, FALSE);
+}
+
+static void
+table_add (GHashTable *table, GArray *lengths, gchar *key, guint value)
+{
+	gsize len = strlen (key);
+	gpointer old_value;
+
+	if (g_hash_table_lookup_extended (table, key, NULL, &old_value)) {
+		g_hash_table_insert (table, key, GUINT_TO_POINTER (GPOINTER_TO_UINT (old_value) | value));
+		return;
+	}
+	g_hash_table_insert (table, key, GUINT_TO_POINTER (value));
+
+	if (lengths != NULL) {
+		guint i;
+
+		for (i = 0; i < lengths->len; i++) {
+			gsize other = g_array_index (lengths, gsize, i);
+			if (other == len)
+				return;
+			if (other > len)
+				break;
+		}
+		g_array_insert_val (lengths, i, len);
+	}
+}
+
+static void
+fallback_add (GArray *array, const gchar *pattern, guint value)
+{
+	FallbackPattern fallback_pattern = { g_strdup (pattern), value };
+	g_array_append_val (array, fallback_pattern);
+}
+
+/**
+ * gs_glob_set_add:
+ * @set: a #GsGlobSet
+ * @pattern: an fnmatch() pattern
+ * @value: a non-zero value to return when @pattern matches
+ *
+ * Add @pattern to @set. If @pattern is already in @set, @value is combined
+ * with its existing value.
+ *
+ * This must not be called while another thread is matching against @set.
+ *
+ * Since: 48
+ */
+void
+gs_glob_set_add (GsGlobSet *set, const gchar *pattern, guint value)
+{
+	g_autoptr(GArray) positions = g_array_new (FALSE, FALSE, sizeof (Position));
+	g_autofree gchar *literal = NULL;
+	Position accept = { 0, };
+	guint start;
+
+	g_return_if_fail (set != NULL);
+	g_return_if_fail (pattern != NULL);
+	g_return_if_fail (value != 0);
+
+	set->n_patterns++;
+
+	if (!parse_pattern (pattern, positions)) {
+		fallback_add (set->fallback, pattern, value);
+		return;
+	}
+
+	/* literal */
+	literal = positions_to_literal (positions, 0, positions->len);
+	if (literal != NULL) {
+		table_add (set->literals, NULL, g_steal_pointer (&literal), value);
+		return;
+	}
+
+	/* prefix* */
+	if (g_array_index (positions, Position, positions->len - 1).kind == POSITION_STAR) {
+		literal = positions_to_literal (positions, 0, positions->len - 1);
+		if (literal != NULL) {
+			table_add (set->prefixes, set->prefix_lengths, g_steal_pointer (&literal), value);
+			return;
+		}
+	}
+
+	/* *suffix */
+	if (g_array_index (positions, Position, 0).kind == POSITION_STAR) {
+		literal = positions_to_literal (positions, 1, positions->len);
+		if (literal != NULL) {
+			table_add (set->suffixes, set->suffix_lengths, g_steal_pointer (&literal), value);
+			return;
+		}
+	}
+
+	/* everything else goes in the NFA */
+	start = set->positions->len;
+	g_array_append_vals (set->positions, positions->data, positions->len);
+	accept.kind = POSITION_ACCEPT;
+	accept.value = value;
+	g_array_append_val (set->positions, accept);
+	g_array_append_val (set->starts, start);
+	fallback_add (set->general, pattern, value);
+
+	/* the cached DFA states are no longer valid */
+	g_mutex_lock (&set->dfa_mutex);
+	g_ptr_array_set_size (set->dfa_states, 0);
+	g_hash_table_remove_all (set->dfa_index);
+	g_mutex_unlock (&set->dfa_mutex);
+}
+
+/**
+ * gs_glob_set_is_empty:
+ * @set: a #GsGlobSet
+ *
+ * Get whether any patterns have been added to @set.
+ *
+ * Returns: %TRUE if @set has no patterns
+ * Since: 48
+ */
+gboolean
+gs_glob_set_is_empty (GsGlobSet *set)
+{
+	g_return_val_if_fail (set != NULL, TRUE);
+	return set->n_patterns == 0;
+}
+
+/* Add @position to @bits, along with the positions after it that can be
+ * reached without consuming a character */
+static void
+nfa_add_closure (GsGlobSet *set, guint8 *bits, guint position)
+{
+	for (;;) {
+		bits[position] = 1;
+		if (g_array_index (set->positions, Position, position).kind != POSITION_STAR)
+			break;
+		position++;
+	}
+}
+
+/* Returns the index of the DFA state for the positions set in @bits,
+ * creating it if needed */
+static gint
+dfa_state_intern (GsGlobSet *set, const guint8 *bits)
+{
+	g_autoptr(GArray) positions = g_array_new (FALSE, FALSE, sizeof (guint));
+	g_autoptr(GBytes) key = NULL;
+	DfaState *state;
+	gpointer index;
+	guint value = 0;
+
+	for (guint i = 0; i < set->positions->len; i++) {
+		if (bits[i]) {
+			const Position *position = &g_array_index (set->positions, Position, i);
+			g_array_append_val (positions, i);
+			if (position->kind == POSITION_ACCEPT)
+				value |= position->value;
+		}
+	}
+
+	key = g_bytes_new (positions->data, positions->len * sizeof (guint));
+	index = g_hash_table_lookup (set->dfa_index, key);
+	if (index != NULL)
+		return GPOINTER_TO_INT (index) - 1;
+
+	state = g_new (DfaState, 1);
+	state->n_positions = positions->len;
+	state->positions = (guint *) g_array_free (g_steal_pointer (&positions), FALSE);
+	state->value = value;
+	for (gsize i = 0; i < G_N_ELEMENTS (state->next); i++)
+		state->next[i] = DFA_STATE_UNKNOWN;
+
+	g_ptr_array_add (set->dfa_states, state);
+	g_hash_table_insert (set->dfa_index, g_steal_pointer (&key),
+			     GINT_TO_POINTER (set->dfa_states->len));
+	return set->dfa_states->len - 1;
+}
+
+static gint
+dfa_get_start (GsGlobSet *set)
+{
+	g_autofree guint8 *bits = NULL;
+
+	if (set->dfa_states->len > 0)
+		return 0;
+
+	bits = g_new0 (guint8, set->positions->len);
+	for (guint i = 0; i < set->starts->len; i++)
+		nfa_add_closure (set, bits, g_array_index (set->starts, guint, i));
+	return dfa_state_intern (set, bits);
+}
+
+/* Returns the index of the state reached from @state_index by @c */
+static gint
+dfa_step (GsGlobSet *set, gint state_index, guint8 c)
+{
+	DfaState *state = g_ptr_array_index (set->dfa_states, state_index);
+	g_autofree guint8 *bits = NULL;
+	gint next;
+
+	if (state->next[c] != DFA_STATE_UNKNOWN)
+		return state->next[c];
+
+	bits = g_new0 (guint8, set->positions->len);
+	for (guint i = 0; i < state->n_positions; i++) {
+		guint p = state->positions[i];
+		const Position *position = &g_array_index (set->positions, Position, p);
+
+		switch (position->kind) {
+		case POSITION_STAR:
+			nfa_add_closure (set, bits, p);
+			break;
+		case POSITION_ANY:
+			nfa_add_closure (set, bits, p + 1);
+			break;
+		case POSITION_LITERAL:
+			if (position->literal == c)
+				nfa_add_closure (set, bits, p + 1);
+			break;
+		case POSITION_CLASS:
+			if (class_has (position, c))
+				nfa_add_closure (set, bits, p + 1);
+			break;
+		case POSITION_ACCEPT:
+		default:
+			break;
+		}
+	}
+
+	/* keep memory bounded for pathological pattern sets; @state is freed
+	 * here, so the transition isn’t cached */
+	if (set->dfa_states->len >= MAX_DFA_STATES) {
+		g_ptr_array_set_size (set->dfa_states, 0);
+		g_hash_table_remove_all (set->dfa_index);
+		dfa_get_start (set);
+		return dfa_state_intern (set, bits);
+	}
+
+	next = dfa_state_intern (set, bits);
+	state->next[c] = next;
+	return next;
+}
+
+static guint
+match_dfa (GsGlobSet *set, const gchar *str)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&set->dfa_mutex);
+	gint state_index = dfa_get_start (set);
+
+	for (const guint8 *s = (const guint8 *) str; *s != '\0'; s++) {
+		state_index = dfa_step (set, state_index, *s);
+		/* no pattern can match any more */
+		if (((DfaState *) g_ptr_array_index (set->dfa_states, state_index))->n_positions == 0)
+			return 0;
+	}
+
+	return ((DfaState *) g_ptr_array_index (set->dfa_states, state_index))->value;
+}
+
+static guint
+match_fnmatch (GArray *patterns, const gchar *str)
+{
+	guint value = 0;
+
+	for (guint i = 0; i < patterns->len; i++) {
+		const FallbackPattern *pattern = &g_array_index (patterns, FallbackPattern, i);
+		if (fnmatch (pattern->pattern, str, 0) == 0)
+			value |= pattern->value;
+	}
+
+	return value;
+}
+
+static gboolean
+is_ascii (const gchar *str)
+{
+	for (const gchar *s = str; *s != '\0'; s++) {
+		if ((guint8) *s >= 0x80)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * gs_glob_set_match:
+ * @set: a #GsGlobSet
+ * @str: a string to match
+ *
+ * Match @str against all the patterns in @set.
+ *
+ * Returns: the bitwise OR of the values of the patterns which match @str,
+ *   or 0 if none do
+ * Since: 48
+ */
+guint
+gs_glob_set_match (GsGlobSet *set, const gchar *str)
+{
+	gsize len;
+	guint value;
+
+	g_return_val_if_fail (set != NULL, 0);
+	g_return_val_if_fail (str != NULL, 0);
+
+	if (set->n_patterns == 0)
+		return 0;
+
+	len = strlen (str);
+	value = GPOINTER_TO_UINT (g_hash_table_lookup (set->literals, str));
+
+	for (guint i = 0; i < set->suffix_lengths->len; i++) {
+		gsize suffix_len = g_array_index (set->suffix_lengths, gsize, i);
+		if (suffix_len > len)
+			break;
+		value |= GPOINTER_TO_UINT (g_hash_table_lookup (set->suffixes, str + len - suffix_len));
+	}
+
+	if (set->prefix_lengths->len > 0) {
+		gchar buf[256];
+		g_autofree gchar *heap_buf = NULL;
+		gchar *prefix = buf;
+
+		if (len >= sizeof (buf))
+			prefix = heap_buf = g_malloc (len + 1);
+
+		for (guint i = 0; i < set->prefix_lengths->len; i++) {
+			gsize prefix_len = g_array_index (set->prefix_lengths, gsize, i);
+			if (prefix_len > len)
+				break;
+			memcpy (prefix, str, prefix_len);
+			prefix[prefix_len] = '\0';
+			value |= GPOINTER_TO_UINT (g_hash_table_lookup (set->prefixes, prefix));
+		}
+	}
+
+	/* the DFA works on bytes, but `?` and bracket expressions match whole
+	 * characters */
+	if (set->general->len > 0) {
+		if (is_ascii (str))
+			value |= match_dfa (set, str);
+		else
+			value |= match_fnmatch (set->general, str);
+	}
+
+	value |= match_fnmatch (set->fallback, str);
+
+	return value;
+}
+
+/**
+ * gs_glob_set_matches:
+ * @set: a #GsGlobSet
+ * @str: a string to match
+ *
+ * Get whether @str matches any of the patterns in @set.
+ *
+ * Returns: %TRUE if any pattern matches
+ * Since: 48
+ */
+gboolean
+gs_glob_set_matches (GsGlobSet *set, const gchar *str)
+{
+	return gs_glob_set_match (set, str) != 0;
+}
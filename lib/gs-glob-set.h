@@ -0,0 +1,33 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Software contributors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GsGlobSet GsGlobSet;
+
+GsGlobSet	*gs_glob_set_new		(void);
+GsGlobSet	*gs_glob_set_ref		(GsGlobSet	*set);
+void		 gs_glob_set_unref		(GsGlobSet	*set);
+
+void		 gs_glob_set_add		(GsGlobSet	*set,
+						 const gchar	*pattern,
+						 guint		 value);
+gboolean	 gs_glob_set_is_empty		(GsGlobSet	*set);
+
+guint		 gs_glob_set_match		(GsGlobSet	*set,
+						 const gchar	*str);
+gboolean	 gs_glob_set_matches		(GsGlobSet	*set,
+						 const gchar	*str);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GsGlobSet, gs_glob_set_unref)
+
+G_END_DECLS
@@ -21,12 +21,20 @@
  * download using gs_icon_downloader_queue_app(). The actual download may
  * happen at any arbitrary time in the future.
  *
+ * Apps are taken from the queue in a worker thread, which checks the icon
+ * cache and starts downloading the missing icons without waiting for the
+ * previous app’s icons to arrive. The downloads go through the default
+ * #GsDownloadScheduler, which runs several of them at once per host and
+ * downloads the icons of apps queued interactively (typically, those on
+ * screen) before the others.
+ *
  * Since: 44
  */
 
 #include "gs-icon-downloader.h"
 
 #include "gs-app-private.h"
+#include "gs-download-scheduler.h"
 #include "gs-remote-icon.h"
 #include "gs-worker-thread.h"
 
@@ -38,7 +46,11 @@ struct _GsIconDownloader
 	SoupSession	*soup_session; /* (owned) */
 
 	GsWorkerThread	*worker; /* (owned) */
-	GCancellable	*cancellable; /* (owned) */
+	GCancellable	*cancellable; /* (owned), cancelled on shutdown */
+
+	GMutex		 mutex;
+	guint		 n_queued_apps; /* (mutex mutex) queued or downloading */
+	GTask		*shutdown_task; /* (mutex mutex) (owned) (nullable) */
 };
 
 G_DEFINE_FINAL_TYPE (GsIconDownloader, gs_icon_downloader, G_TYPE_OBJECT)
@@ -55,10 +67,13 @@ gs_icon_downloader_finalize (GObject *object)
 {
 	GsIconDownloader *self = (GsIconDownloader *)object;
 
+	g_assert (self->shutdown_task == NULL);
+
 	g_cancellable_cancel (self->cancellable);
 	g_clear_object (&self->cancellable);
 	g_clear_object (&self->worker);
 	g_clear_object (&self->soup_session);
+	g_mutex_clear (&self->mutex);
 
 	G_OBJECT_CLASS (gs_icon_downloader_parent_class)->finalize (object);
 }
@@ -147,6 +162,8 @@ static void
 gs_icon_downloader_init (GsIconDownloader *self)
 {
 	self->worker = gs_worker_thread_new ("gs-icon-downloader");
+	self->cancellable = g_cancellable_new ();
+	g_mutex_init (&self->mutex);
 }
 
 /**
@@ -169,6 +186,18 @@ gs_icon_downloader_new (SoupSession *soup_session,
 }
 
 
+typedef struct {
+	GsApp *app;  /* (owned) */
+	guint n_pending_icons;
+} DownloadAppData;
+
+static void
+download_app_data_free (DownloadAppData *data)
+{
+	g_clear_object (&data->app);
+	g_free (data);
+}
+
 static void download_remote_icons_of_the_app_cb (GTask        *task,
                                                  gpointer      source_object,
                                                  gpointer      task_data,
@@ -186,6 +215,9 @@ static void app_remote_icons_download_finished (GObject      *source_object,
  *
  * Puts @app in the queue to download icons.
  *
+ * Icons of apps queued with @interactive set are downloaded before those of
+ * other apps.
+ *
  * Since: 44
  */
 void
@@ -195,7 +227,9 @@ gs_icon_downloader_queue_app (GsIconDownloader *self,
 {
 	g_autoptr(GTask) task = NULL;
 	g_autoptr(GPtrArray) icons = NULL;
+	DownloadAppData *data;
 	gboolean has_remote_icon = FALSE;
+	int priority = interactive ? G_PRIORITY_DEFAULT : G_PRIORITY_LOW;
 
 	g_return_if_fail (GS_IS_ICON_DOWNLOADER (self));
 	g_return_if_fail (GS_IS_APP (app));
@@ -214,16 +248,73 @@ gs_icon_downloader_queue_app (GsIconDownloader *self,
 		return;
 	}
 
+	/* Nothing is downloaded once shutting down. This is checked under
+	 * @mutex so the worker can’t be shut down with the app still queued. */
+	g_mutex_lock (&self->mutex);
+	if (g_cancellable_is_cancelled (self->cancellable)) {
+		g_mutex_unlock (&self->mutex);
+		gs_app_set_icons_state (app, GS_APP_ICONS_STATE_AVAILABLE);
+		return;
+	}
+	self->n_queued_apps++;
+	g_mutex_unlock (&self->mutex);
+
 	gs_app_set_icons_state (app, GS_APP_ICONS_STATE_PENDING_DOWNLOAD);
 
+	data = g_new0 (DownloadAppData, 1);
+	data->app = g_object_ref (app);
+
 	task = g_task_new (self, self->cancellable, app_remote_icons_download_finished, NULL);
-	g_task_set_task_data (task, g_object_ref (app), g_object_unref);
+	g_task_set_task_data (task, data, (GDestroyNotify) download_app_data_free);
+	g_task_set_priority (task, priority);
 	g_task_set_source_tag (task, gs_icon_downloader_queue_app);
 
-	gs_worker_thread_queue (self->worker, interactive ? G_PRIORITY_DEFAULT : G_PRIORITY_LOW,
+	gs_worker_thread_queue (self->worker, priority,
 				download_remote_icons_of_the_app_cb, g_steal_pointer (&task));
 }
 
+static void finish_shutdown (GsIconDownloader *self,
+                             GTask            *task);
+
+/* Run in @worker. */
+static void
+finish_app_download (GTask  *task,
+                     GError *error)
+{
+	GsIconDownloader *self = g_task_get_source_object (task);
+	DownloadAppData *data = g_task_get_task_data (task);
+	g_autoptr(GTask) shutdown_task = NULL;
+
+	g_assert (gs_worker_thread_is_in_worker_context (self->worker));
+
+	gs_app_set_icons_state (data->app, GS_APP_ICONS_STATE_AVAILABLE);
+
+	g_mutex_lock (&self->mutex);
+	g_assert (self->n_queued_apps > 0);
+	self->n_queued_apps--;
+	if (self->n_queued_apps == 0)
+		shutdown_task = g_steal_pointer (&self->shutdown_task);
+	g_mutex_unlock (&self->mutex);
+
+	/* @task may hold the last reference to @self, so keep it alive until
+	 * shutdown has been started */
+	g_object_ref (self);
+
+	if (error != NULL)
+		g_task_return_error (task, error);
+	else
+		g_task_return_boolean (task, TRUE);
+
+	if (shutdown_task != NULL)
+		finish_shutdown (self, g_steal_pointer (&shutdown_task));
+
+	g_object_unref (self);
+}
+
+static void remote_icon_cached_cb (GObject      *source_object,
+                                   GAsyncResult *result,
+                                   gpointer      user_data);
+
 /* Run in @worker. */
 static void
 download_remote_icons_of_the_app_cb (GTask        *task,
@@ -232,13 +323,14 @@ download_remote_icons_of_the_app_cb (GTask        *task,
                                      GCancellable *cancellable)
 {
 	GsIconDownloader *self = GS_ICON_DOWNLOADER (source_object);
+	DownloadAppData *data = task_data;
 	g_autoptr(GPtrArray) remote_icons = NULL;
 	g_autoptr(GPtrArray) icons = NULL;
 	GsApp *app;
 
 	g_assert (gs_worker_thread_is_in_worker_context (self->worker));
 
-	app = GS_APP (task_data);
+	app = data->app;
 	icons = gs_app_dup_icons (app);
 	remote_icons = g_ptr_array_new_full (icons ? icons->len : 0, g_object_unref);
 
@@ -251,32 +343,62 @@ download_remote_icons_of_the_app_cb (GTask        *task,
 
 	g_assert (remote_icons->len > 0);
 
+	if (g_cancellable_is_cancelled (cancellable)) {
+		finish_app_download (task, g_error_new_literal (G_IO_ERROR, G_IO_ERROR_CANCELLED,
+								"Operation was cancelled"));
+		return;
+	}
+
 	g_debug ("Downloading %u icons for app %s", remote_icons->len, gs_app_get_id (app));
 
 	gs_app_set_icons_state (app, GS_APP_ICONS_STATE_DOWNLOADING);
 
+	/* Start all the downloads without waiting for them, so the worker can
+	 * go on to the next app; they complete in the worker’s main context.
+	 * Hold an extra count until they have all been started. */
+	data->n_pending_icons = remote_icons->len + 1;
+
 	for (guint j = 0; j < remote_icons->len; j++) {
-		GObject *icon = g_ptr_array_index (remote_icons, j);
-		g_autoptr(GError) local_error = NULL;
-
-		gs_remote_icon_ensure_cached (GS_REMOTE_ICON (icon),
-					      self->soup_session,
-					      self->maximum_size_px,
-					      cancellable,
-					      &local_error);
-
-		if (local_error)
-			g_debug ("Error downloading remote icon: %s", local_error->message);
-
-		if (g_task_return_error_if_cancelled (task)) {
-			gs_app_set_icons_state (app, GS_APP_ICONS_STATE_AVAILABLE);
-			return;
-		}
+		GsRemoteIcon *icon = g_ptr_array_index (remote_icons, j);
+
+		gs_remote_icon_ensure_cached_async (icon,
+						    self->soup_session,
+						    self->maximum_size_px,
+						    g_task_get_priority (task),
+						    cancellable,
+						    remote_icon_cached_cb,
+						    g_object_ref (task));
 	}
 
-	gs_app_set_icons_state (app, GS_APP_ICONS_STATE_AVAILABLE);
+	remote_icon_cached_cb (NULL, NULL, g_object_ref (task));
+}
 
-	g_task_return_boolean (task, TRUE);
+/* Run in @worker. @source_object and @result are %NULL when dropping the
+ * extra count held while starting the downloads. */
+static void
+remote_icon_cached_cb (GObject      *source_object,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	DownloadAppData *data = g_task_get_task_data (task);
+	GCancellable *cancellable = g_task_get_cancellable (task);
+	g_autoptr(GError) local_error = NULL;
+
+	if (result != NULL &&
+	    !gs_remote_icon_ensure_cached_finish (GS_REMOTE_ICON (source_object), result, &local_error) &&
+	    !g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		g_debug ("Error downloading remote icon: %s", local_error->message);
+
+	g_assert (data->n_pending_icons > 0);
+	if (--data->n_pending_icons > 0)
+		return;
+
+	if (g_cancellable_is_cancelled (cancellable))
+		finish_app_download (task, g_error_new_literal (G_IO_ERROR, G_IO_ERROR_CANCELLED,
+								"Operation was cancelled"));
+	else
+		finish_app_download (task, NULL);
 }
 
 static void
@@ -306,8 +428,9 @@ static void shutdown_cb (GObject      *source_object,
  *
  * Shut down the icon downloader.
  *
- * This will shut down the internal worker thread that @self uses to
- * queue app downloads.
+ * This will cancel the icon downloads which are queued or in progress, wait
+ * for them to finish, and then shut down the internal worker thread that @self
+ * uses to queue app downloads. Apps queued after this are not downloaded.
  *
  * This is a no-op if called subsequently.
  *
@@ -327,8 +450,42 @@ gs_icon_downloader_shutdown_async (GsIconDownloader    *self,
 	task = g_task_new (self, cancellable, callback, user_data);
 	g_task_set_source_tag (task, gs_icon_downloader_shutdown_async);
 
-	gs_worker_thread_shutdown_async (self->worker, cancellable, shutdown_cb,
-					 g_steal_pointer (&task));
+	/* Cancel the queued and in-progress downloads, and let them drain
+	 * before shutting the worker down, as their downloads complete in the
+	 * worker thread. */
+	g_cancellable_cancel (self->cancellable);
+
+	g_mutex_lock (&self->mutex);
+	if (self->n_queued_apps > 0 && self->shutdown_task == NULL) {
+		self->shutdown_task = g_steal_pointer (&task);
+		g_mutex_unlock (&self->mutex);
+		return;
+	}
+	g_mutex_unlock (&self->mutex);
+
+	finish_shutdown (self, g_steal_pointer (&task));
+}
+
+static gboolean
+finish_shutdown_cb (gpointer user_data)
+{
+	GTask *task = G_TASK (user_data);
+	GsIconDownloader *self = g_task_get_source_object (task);
+
+	gs_worker_thread_shutdown_async (self->worker, g_task_get_cancellable (task),
+					 shutdown_cb, task);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* This may be called in @worker, once the last download drains, but @worker
+ * must be shut down from the context @task was started in, or its shutdown
+ * could complete in the context it is tearing down. */
+static void
+finish_shutdown (GsIconDownloader *self,
+                 GTask            *task)
+{
+	g_main_context_invoke (g_task_get_context (task), finish_shutdown_cb, task);
 }
 
 static void
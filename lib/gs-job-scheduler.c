@@ -0,0 +1,535 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Software contributors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/**
+ * SECTION:gs-job-scheduler
+ * @short_description: Limits how many jobs run at once, by class of job
+ *
+ * #GsJobScheduler decides when a job may start, based on the #GsJobLane it
+ * is in. Each lane has its own limit on the number of jobs running at once,
+ * and jobs over that limit are queued in FIFO order until another job in
+ * the lane is released.
+ *
+ * Jobs in %GS_JOB_LANE_BACKGROUND are additionally held back while any job
+ * is running in %GS_JOB_LANE_INTERACTIVE, so that refreshing metadata in the
+ * background does not compete with the UI for CPU and I/O. To stop a busy UI
+ * from starving background work forever, a background job which has been
+ * held back for longer than the maximum delay is started anyway.
+ *
+ * Jobs which are already running are never interrupted.
+ *
+ * #GsJobScheduler is safe to use from any thread.
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+
+#include "gs-job-scheduler.h"
+#include "gs-metrics.h"
+
+/* how long a background job can be held back by interactive jobs */
+#define DEFAULT_MAX_DELAY_MS 10000
+
+typedef struct {
+	GsJobSchedulerFunc func;
+	gpointer user_data;
+	GDestroyNotify user_data_free_func;
+	gint64 queued_time_usec;
+} QueuedJob;
+
+struct _GsJobScheduler
+{
+	GObject		 parent;
+
+	GMainContext	*context;  /* (owned) */
+
+	GMutex		 mutex;
+	guint		 max_running[GS_JOB_LANE_LAST];  /* (mutex mutex); 0 means unlimited */
+	guint		 n_running[GS_JOB_LANE_LAST];  /* (mutex mutex) */
+	GQueue		 queued[GS_JOB_LANE_LAST];  /* (mutex mutex) (element-type QueuedJob) */
+	gint64		 max_delay_usec;  /* (mutex mutex) */
+	GSource		*delay_source;  /* (mutex mutex) (owned) (nullable) */
+	gboolean	 shut_down;  /* (mutex mutex) */
+};
+
+G_DEFINE_TYPE (GsJobScheduler, gs_job_scheduler, G_TYPE_OBJECT)
+
+static void
+queued_job_free (QueuedJob *job)
+{
+	if (job->user_data_free_func != NULL)
+		job->user_data_free_func (job->user_data);
+	g_free (job);
+}
+
+/**
+ * gs_job_lane_to_string:
+ * @lane: a #GsJobLane
+ *
+ * Converts the lane to a string, for debug output.
+ *
+ * Returns: a string, or %NULL for invalid values
+ **/
+const gchar *
+gs_job_lane_to_string (GsJobLane lane)
+{
+	switch (lane) {
+	case GS_JOB_LANE_INTERACTIVE:
+		return "interactive";
+	case GS_JOB_LANE_USER:
+		return "user";
+	case GS_JOB_LANE_BACKGROUND:
+		return "background";
+	case GS_JOB_LANE_LAST:
+	default:
+		return NULL;
+	}
+}
+
+/* must be called with self->mutex held; @queued_time_usec is zero for a job
+ * which has not been queued yet */
+static gboolean
+can_start (GsJobScheduler *self,
+	   GsJobLane       lane,
+	   gint64          queued_time_usec,
+	   gint64          now_usec)
+{
+	if (self->max_running[lane] != 0 &&
+	    self->n_running[lane] >= self->max_running[lane])
+		return FALSE;
+
+	/* give way to interactive jobs, but not forever */
+	if (lane == GS_JOB_LANE_BACKGROUND &&
+	    (self->n_running[GS_JOB_LANE_INTERACTIVE] > 0 ||
+	     self->queued[GS_JOB_LANE_INTERACTIVE].length > 0)) {
+		if (queued_time_usec == 0)
+			return FALSE;
+		return (now_usec - queued_time_usec >= self->max_delay_usec);
+	}
+
+	return TRUE;
+}
+
+static gboolean delay_timeout_cb (gpointer user_data);
+
+/* must be called with self->mutex held; arms a timeout for when the oldest
+ * held-back background job becomes overdue */
+static void
+update_delay_source (GsJobScheduler *self,
+		     gint64          now_usec)
+{
+	QueuedJob *oldest = g_queue_peek_head (&self->queued[GS_JOB_LANE_BACKGROUND]);
+	gint64 remaining_usec;
+
+	if (self->delay_source != NULL) {
+		g_source_destroy (self->delay_source);
+		g_clear_pointer (&self->delay_source, g_source_unref);
+	}
+
+	/* nothing is being held back, or the lane is full, in which case the
+	 * job will be started when a slot is released */
+	if (oldest == NULL ||
+	    (self->max_running[GS_JOB_LANE_BACKGROUND] != 0 &&
+	     self->n_running[GS_JOB_LANE_BACKGROUND] >= self->max_running[GS_JOB_LANE_BACKGROUND]))
+		return;
+
+	remaining_usec = MAX (oldest->queued_time_usec + self->max_delay_usec - now_usec, 0);
+	self->delay_source = g_timeout_source_new ((guint) ((remaining_usec + 999) / 1000));
+	g_source_set_static_name (self->delay_source, "gs-job-scheduler-delay");
+	g_source_set_callback (self->delay_source, delay_timeout_cb, self, NULL);
+	g_source_attach (self->delay_source, self->context);
+}
+
+/* must be called with self->mutex held; returns the jobs which may now start,
+ * in start order, which must be started once the mutex is released */
+static GPtrArray *
+dequeue_startable (GsJobScheduler *self)
+{
+	const gchar *metric_names[GS_JOB_LANE_LAST] = {
+		"scheduler-wait:interactive",
+		"scheduler-wait:user",
+		"scheduler-wait:background",
+	};
+	g_autoptr(GPtrArray) startable = g_ptr_array_new ();
+	gint64 now_usec = g_get_monotonic_time ();
+
+	for (GsJobLane lane = 0; lane < GS_JOB_LANE_LAST; lane++) {
+		QueuedJob *job;
+
+		while ((job = g_queue_peek_head (&self->queued[lane])) != NULL &&
+		       can_start (self, lane, job->queued_time_usec, now_usec)) {
+			g_queue_pop_head (&self->queued[lane]);
+			self->n_running[lane]++;
+			gs_metrics_record_duration (metric_names[lane],
+						    now_usec - job->queued_time_usec);
+			g_ptr_array_add (startable, job);
+		}
+	}
+
+	update_delay_source (self, now_usec);
+
+	return g_steal_pointer (&startable);
+}
+
+static void
+start_jobs (GPtrArray *startable)
+{
+	for (guint i = 0; i < startable->len; i++) {
+		QueuedJob *job = g_ptr_array_index (startable, i);
+		job->func (job->user_data, NULL);
+		queued_job_free (job);
+	}
+}
+
+static gboolean
+delay_timeout_cb (gpointer user_data)
+{
+	GsJobScheduler *self = GS_JOB_SCHEDULER (user_data);
+	g_autoptr(GPtrArray) startable = NULL;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->mutex);
+
+	/* this source is finished with, but may be replaced */
+	g_clear_pointer (&self->delay_source, g_source_unref);
+	startable = dequeue_startable (self);
+	g_clear_pointer (&locker, g_mutex_locker_free);
+
+	start_jobs (startable);
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * gs_job_scheduler_set_max_running:
+ * @self: a #GsJobScheduler
+ * @lane: a #GsJobLane
+ * @max_running: maximum number of jobs to run at once in @lane, or 0 for
+ *   no limit
+ *
+ * Set how many jobs may run at once in @lane. If this is raised, queued jobs
+ * are started straight away. Lowering it does not affect running jobs.
+ */
+void
+gs_job_scheduler_set_max_running (GsJobScheduler *self,
+				  GsJobLane       lane,
+				  guint           max_running)
+{
+	g_autoptr(GPtrArray) startable = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (GS_IS_JOB_SCHEDULER (self));
+	g_return_if_fail (lane < GS_JOB_LANE_LAST);
+
+	locker = g_mutex_locker_new (&self->mutex);
+	self->max_running[lane] = max_running;
+	startable = dequeue_startable (self);
+	g_clear_pointer (&locker, g_mutex_locker_free);
+
+	start_jobs (startable);
+}
+
+/**
+ * gs_job_scheduler_get_max_running:
+ * @self: a #GsJobScheduler
+ * @lane: a #GsJobLane
+ *
+ * Get how many jobs may run at once in @lane.
+ *
+ * Returns: the limit, or 0 if there is no limit
+ */
+guint
+gs_job_scheduler_get_max_running (GsJobScheduler *self,
+				  GsJobLane       lane)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (GS_IS_JOB_SCHEDULER (self), 0);
+	g_return_val_if_fail (lane < GS_JOB_LANE_LAST, 0);
+
+	locker = g_mutex_locker_new (&self->mutex);
+	return self->max_running[lane];
+}
+
+/**
+ * gs_job_scheduler_set_max_delay:
+ * @self: a #GsJobScheduler
+ * @max_delay_ms: time in milliseconds
+ *
+ * Set how long a background job may be held back while interactive jobs are
+ * running, before it is started anyway.
+ */
+void
+gs_job_scheduler_set_max_delay (GsJobScheduler *self,
+				guint           max_delay_ms)
+{
+	g_autoptr(GPtrArray) startable = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (GS_IS_JOB_SCHEDULER (self));
+
+	locker = g_mutex_locker_new (&self->mutex);
+	self->max_delay_usec = (gint64) max_delay_ms * 1000;
+	startable = dequeue_startable (self);
+	g_clear_pointer (&locker, g_mutex_locker_free);
+
+	start_jobs (startable);
+}
+
+/**
+ * gs_job_scheduler_push:
+ * @self: a #GsJobScheduler
+ * @lane: the #GsJobLane to run the job in
+ * @func: function to call when the job may start
+ * @user_data: data to pass to @func
+ * @user_data_free_func: (nullable): function to free @user_data
+ *
+ * Ask to start a job in @lane.
+ *
+ * If the job may start straight away, this returns %TRUE and the caller
+ * should start it; @func is not called and @user_data is freed. Otherwise the
+ * job is queued and @func is called once it may start, from whichever thread
+ * releases the slot it takes. If @self is shut down or disposed of first,
+ * @func is called with a %G_IO_ERROR_CANCELLED error instead.
+ *
+ * Once @self has been shut down, jobs are no longer limited, and this always
+ * returns %TRUE.
+ *
+ * Either way, gs_job_scheduler_release() must be called once the job has
+ * finished.
+ *
+ * Returns: %TRUE if the job may start now, %FALSE if it was queued
+ */
+gboolean
+gs_job_scheduler_push (GsJobScheduler     *self,
+		       GsJobLane           lane,
+		       GsJobSchedulerFunc  func,
+		       gpointer            user_data,
+		       GDestroyNotify      user_data_free_func)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+	QueuedJob *job;
+	gint64 now_usec = g_get_monotonic_time ();
+
+	g_return_val_if_fail (GS_IS_JOB_SCHEDULER (self), FALSE);
+	g_return_val_if_fail (lane < GS_JOB_LANE_LAST, FALSE);
+	g_return_val_if_fail (func != NULL, FALSE);
+
+	locker = g_mutex_locker_new (&self->mutex);
+
+	/* don’t overtake jobs which are already queued */
+	if (self->shut_down ||
+	    (self->queued[lane].length == 0 && can_start (self, lane, 0, now_usec))) {
+		self->n_running[lane]++;
+		g_clear_pointer (&locker, g_mutex_locker_free);
+
+		if (user_data_free_func != NULL)
+			user_data_free_func (user_data);
+		return TRUE;
+	}
+
+	g_debug ("queueing job in %s lane behind %u running and %u queued",
+		 gs_job_lane_to_string (lane), self->n_running[lane],
+		 self->queued[lane].length);
+
+	job = g_new0 (QueuedJob, 1);
+	job->func = func;
+	job->user_data = user_data;
+	job->user_data_free_func = user_data_free_func;
+	job->queued_time_usec = now_usec;
+	g_queue_push_tail (&self->queued[lane], job);
+
+	if (lane == GS_JOB_LANE_BACKGROUND && self->delay_source == NULL)
+		update_delay_source (self, now_usec);
+
+	return FALSE;
+}
+
+/**
+ * gs_job_scheduler_release:
+ * @self: a #GsJobScheduler
+ * @lane: the #GsJobLane the job was pushed to
+ *
+ * Mark a job started through gs_job_scheduler_push() as finished, so that
+ * queued jobs can take its place.
+ */
+void
+gs_job_scheduler_release (GsJobScheduler *self,
+			  GsJobLane       lane)
+{
+	g_autoptr(GPtrArray) startable = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (GS_IS_JOB_SCHEDULER (self));
+	g_return_if_fail (lane < GS_JOB_LANE_LAST);
+
+	locker = g_mutex_locker_new (&self->mutex);
+	g_return_if_fail (self->n_running[lane] > 0);
+	self->n_running[lane]--;
+	startable = dequeue_startable (self);
+	g_clear_pointer (&locker, g_mutex_locker_free);
+
+	start_jobs (startable);
+}
+
+/**
+ * gs_job_scheduler_get_n_running:
+ * @self: a #GsJobScheduler
+ * @lane: a #GsJobLane
+ *
+ * Get the number of jobs running in @lane.
+ *
+ * Returns: the number of jobs which have started but not been released
+ */
+guint
+gs_job_scheduler_get_n_running (GsJobScheduler *self,
+				GsJobLane       lane)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (GS_IS_JOB_SCHEDULER (self), 0);
+	g_return_val_if_fail (lane < GS_JOB_LANE_LAST, 0);
+
+	locker = g_mutex_locker_new (&self->mutex);
+	return self->n_running[lane];
+}
+
+/**
+ * gs_job_scheduler_get_n_queued:
+ * @self: a #GsJobScheduler
+ * @lane: a #GsJobLane
+ *
+ * Get the number of jobs waiting to start in @lane.
+ *
+ * Returns: the number of queued jobs
+ */
+guint
+gs_job_scheduler_get_n_queued (GsJobScheduler *self,
+			       GsJobLane       lane)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (GS_IS_JOB_SCHEDULER (self), 0);
+	g_return_val_if_fail (lane < GS_JOB_LANE_LAST, 0);
+
+	locker = g_mutex_locker_new (&self->mutex);
+	return self->queued[lane].length;
+}
+
+/**
+ * gs_job_scheduler_shutdown:
+ * @self: a #GsJobScheduler
+ *
+ * Stop scheduling jobs. Jobs which are still queued are dropped, and their
+ * #GsJobSchedulerFunc is called with a %G_IO_ERROR_CANCELLED error. Jobs
+ * pushed afterwards start straight away.
+ *
+ * Queued jobs often hold a reference to @self, through the job they start,
+ * so the owner of @self should call this when it is disposed of, rather than
+ * relying on @self being disposed of too.
+ *
+ * It is safe to call this more than once.
+ */
+void
+gs_job_scheduler_shutdown (GsJobScheduler *self)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GPtrArray) dropped = g_ptr_array_new ();
+	g_autoptr(GError) local_error = NULL;
+
+	g_return_if_fail (GS_IS_JOB_SCHEDULER (self));
+
+	locker = g_mutex_locker_new (&self->mutex);
+	self->shut_down = TRUE;
+
+	if (self->delay_source != NULL) {
+		g_source_destroy (self->delay_source);
+		g_clear_pointer (&self->delay_source, g_source_unref);
+	}
+
+	/* jobs which never started are dropped, and told so outside the lock
+	 * so they can complete straight away */
+	for (GsJobLane lane = 0; lane < GS_JOB_LANE_LAST; lane++) {
+		QueuedJob *job;
+
+		while ((job = g_queue_pop_head (&self->queued[lane])) != NULL)
+			g_ptr_array_add (dropped, job);
+	}
+
+	g_clear_pointer (&locker, g_mutex_locker_free);
+
+	local_error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_CANCELLED,
+					   "Job scheduler was shut down before the job started");
+	for (guint i = 0; i < dropped->len; i++) {
+		QueuedJob *job = g_ptr_array_index (dropped, i);
+		job->func (job->user_data, local_error);
+		queued_job_free (job);
+	}
+}
+
+static void
+gs_job_scheduler_dispose (GObject *object)
+{
+	GsJobScheduler *self = GS_JOB_SCHEDULER (object);
+
+	gs_job_scheduler_shutdown (self);
+
+	G_OBJECT_CLASS (gs_job_scheduler_parent_class)->dispose (object);
+}
+
+static void
+gs_job_scheduler_finalize (GObject *object)
+{
+	GsJobScheduler *self = GS_JOB_SCHEDULER (object);
+
+	g_main_context_unref (self->context);
+	g_mutex_clear (&self->mutex);
+
+	G_OBJECT_CLASS (gs_job_scheduler_parent_class)->finalize (object);
+}
+
+static void
+gs_job_scheduler_class_init (GsJobSchedulerClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = gs_job_scheduler_dispose;
+	object_class->finalize = gs_job_scheduler_finalize;
+}
+
+static void
+gs_job_scheduler_init (GsJobScheduler *self)
+{
+	g_mutex_init (&self->mutex);
+	self->context = g_main_context_ref_thread_default ();
+	self->max_delay_usec = (gint64) DEFAULT_MAX_DELAY_MS * 1000;
+	for (GsJobLane lane = 0; lane < GS_JOB_LANE_LAST; lane++)
+		g_queue_init (&self->queued[lane]);
+
+	/* nested jobs, such as the refine run by a list-apps job, are in this
+	 * lane too, so limiting it could deadlock */
+	self->max_running[GS_JOB_LANE_INTERACTIVE] = 0;
+	self->max_running[GS_JOB_LANE_USER] = 0;
+	self->max_running[GS_JOB_LANE_BACKGROUND] = 1;
+}
+
+/**
+ * gs_job_scheduler_new:
+ *
+ * Create a new #GsJobScheduler. The interactive and user lanes are
+ * unlimited, and one background job may run at a time.
+ *
+ * Timeouts for held-back background jobs are run in the thread-default main
+ * context of the caller.
+ *
+ * Returns: (transfer full): a new #GsJobScheduler
+ */
+GsJobScheduler *
+gs_job_scheduler_new (void)
+{
+	return g_object_new (GS_TYPE_JOB_SCHEDULER, NULL);
+}
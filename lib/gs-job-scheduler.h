@@ -0,0 +1,76 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Software contributors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GsJobLane:
+ * @GS_JOB_LANE_INTERACTIVE: Jobs the user is waiting on to see something,
+ *   such as listing or refining apps
+ * @GS_JOB_LANE_USER: Install, uninstall and update jobs, and other jobs which
+ *   change the system on the user’s request
+ * @GS_JOB_LANE_BACKGROUND: Jobs which nobody is waiting on, such as periodic
+ *   metadata refreshes and automatic updates
+ *
+ * The lanes a #GsJobScheduler runs jobs in, in decreasing order of priority.
+ */
+typedef enum {
+	GS_JOB_LANE_INTERACTIVE,
+	GS_JOB_LANE_USER,
+	GS_JOB_LANE_BACKGROUND,
+	GS_JOB_LANE_LAST  /*< skip >*/
+} GsJobLane;
+
+/**
+ * GsJobSchedulerFunc:
+ * @user_data: data passed to gs_job_scheduler_push()
+ * @error: (nullable): %NULL if the job may start, or %G_IO_ERROR_CANCELLED if
+ *   the scheduler was disposed of while the job was still queued
+ *
+ * Called when a queued job may start, or once it never will. This may be
+ * called in any thread.
+ */
+typedef void (*GsJobSchedulerFunc) (gpointer      user_data,
+				    const GError *error);
+
+#define GS_TYPE_JOB_SCHEDULER (gs_job_scheduler_get_type ())
+
+G_DECLARE_FINAL_TYPE (GsJobScheduler, gs_job_scheduler, GS, JOB_SCHEDULER, GObject)
+
+GsJobScheduler	*gs_job_scheduler_new			(void);
+
+const gchar	*gs_job_lane_to_string			(GsJobLane		 lane);
+
+void		 gs_job_scheduler_set_max_running	(GsJobScheduler		*self,
+							 GsJobLane		 lane,
+							 guint			 max_running);
+guint		 gs_job_scheduler_get_max_running	(GsJobScheduler		*self,
+							 GsJobLane		 lane);
+void		 gs_job_scheduler_set_max_delay		(GsJobScheduler		*self,
+							 guint			 max_delay_ms);
+
+gboolean	 gs_job_scheduler_push			(GsJobScheduler		*self,
+							 GsJobLane		 lane,
+							 GsJobSchedulerFunc	 func,
+							 gpointer		 user_data,
+							 GDestroyNotify		 user_data_free_func);
+void		 gs_job_scheduler_release		(GsJobScheduler		*self,
+							 GsJobLane		 lane);
+void		 gs_job_scheduler_shutdown		(GsJobScheduler		*self);
+
+guint		 gs_job_scheduler_get_n_running		(GsJobScheduler		*self,
+							 GsJobLane		 lane);
+guint		 gs_job_scheduler_get_n_queued		(GsJobScheduler		*self,
+							 GsJobLane		 lane);
+
+G_END_DECLS
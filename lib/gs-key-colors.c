@@ -50,64 +50,11 @@ const guint n_clusters = 3;
  * can’t discard non-opaque pixels entirely. */
 const guint minimum_alpha = 0.5 * 255;
 
-typedef struct {
-	guint8 red;
-	guint8 green;
-	guint8 blue;
-} Pixel8;
-
-typedef struct {
-	Pixel8 color;
-	union {
-		guint8 alpha;
-		guint8 cluster;
-	};
-} ClusterPixel8;
-
-typedef struct {
-	guint red;
-	guint green;
-	guint blue;
-	guint n_members;
-} CentroidAccumulator;
-
-static inline guint
-color_distance (const Pixel8 *a,
-                const Pixel8 *b)
-{
-	/* Take the absolute value rather than the square root to save some
-	 * time, as the caller is comparing distances.
-	 *
-	 * The arithmetic here can’t overflow, as the R/G/B components have a
-	 * maximum value of 255 but the arithmetic is done in (at least) 32-bit
-	 * variables.*/
-	gint dr = b->red - a->red;
-	gint dg = b->green - a->green;
-	gint db = b->blue - a->blue;
-
-	return abs (dr * dr + dg * dg + db * db);
-}
-
-/* NOTE: This has to return stable results when more than one cluster is
- * equidistant from the @pixel, or the k_means() function may not terminate. */
-static inline gsize
-nearest_cluster (const Pixel8 *pixel,
-                 const Pixel8 *cluster_centres,
-                 gsize         n_cluster_centres)
-{
-	gsize nearest_cluster = 0;
-	guint nearest_cluster_distance = color_distance (&cluster_centres[0], pixel);
-
-	for (gsize i = 1; i < n_cluster_centres; i++) {
-		guint distance = color_distance (&cluster_centres[i], pixel);
-		if (distance < nearest_cluster_distance) {
-			nearest_cluster = i;
-			nearest_cluster_distance = distance;
-		}
-	}
-
-	return nearest_cluster;
-}
+/* The size which icons are scaled down to before clustering. This bounds the
+ * number of pixels, so the per-pixel arrays in k_means() can be allocated on
+ * the stack. */
+#define ICON_SIZE 32
+#define MAX_PIXELS (ICON_SIZE * ICON_SIZE)
 
 /* A variant of g_random_int_range() which chooses without replacement,
  * tracking the used integers in @used_ints and @n_used_ints.
@@ -161,18 +108,34 @@ random_int_range_no_replacement (guint max_ints,
  * Various other shortcuts have been taken which make this approach quite
  * specific to key color extraction from icons, with the aim of making it
  * faster. That’s fine — it doesn’t matter if the results this function produces
- * are optimal, only that they’re good enough. */
+ * are optimal, only that they’re good enough.
+ *
+ * The opaque pixels are copied out into separate red, green, blue and cluster
+ * arrays (structure of arrays), and each step is a simple loop over one of
+ * them with no branches in the body. That lets the compiler vectorise the
+ * loops for whichever SIMD instruction set it is targeting, or fall back to
+ * scalar code, without any architecture-specific code here. The random
+ * initialisation visits the opaque pixels in the same order as the previous
+ * per-pixel implementation, so for a given random seed the results are the
+ * same. */
 static void
 k_means (GArray    *colors,
          GdkPixbuf *pb)
 {
 	gint rowstride, n_channels;
 	gint width, height;
-	guint8 *raw_pixels;
-	ClusterPixel8 *pixels;
-	const ClusterPixel8 *pixels_end;
-	Pixel8 cluster_centres[n_clusters];
-	CentroidAccumulator cluster_accumulators[n_clusters];
+	const guint8 *raw_pixels;
+	guint8 reds[MAX_PIXELS];
+	guint8 greens[MAX_PIXELS];
+	guint8 blues[MAX_PIXELS];
+	guint8 clusters[MAX_PIXELS];
+	guint8 new_clusters[MAX_PIXELS];
+	guint32 nearest_distances[MAX_PIXELS];
+	gsize n_pixels = 0;
+	guint8 centre_reds[n_clusters];
+	guint8 centre_greens[n_clusters];
+	guint8 centre_blues[n_clusters];
+	guint n_members[n_clusters];
 	gboolean used_clusters[n_clusters];
 	guint n_used_clusters = 0;
 	guint n_assignments_changed;
@@ -181,7 +144,7 @@ k_means (GArray    *colors,
 
 	n_channels = gdk_pixbuf_get_n_channels (pb);
 	rowstride = gdk_pixbuf_get_rowstride (pb);
-	raw_pixels = gdk_pixbuf_get_pixels (pb);
+	raw_pixels = gdk_pixbuf_read_pixels (pb);
 	width = gdk_pixbuf_get_width (pb);
 	height = gdk_pixbuf_get_height (pb);
 
@@ -190,26 +153,34 @@ k_means (GArray    *colors,
 	 * downsizing the #GdkPixbuf, this is a reasonable assumption. */
 	g_assert (rowstride == width * n_channels);
 	g_assert (n_channels == 4);
+	g_assert (width * height <= MAX_PIXELS);
 
-	pixels = (ClusterPixel8 *) raw_pixels;
-	pixels_end = &pixels[height * width];
-
-	memset (cluster_centres, 0, sizeof (cluster_centres));
+	memset (centre_reds, 0, sizeof (centre_reds));
+	memset (centre_greens, 0, sizeof (centre_greens));
+	memset (centre_blues, 0, sizeof (centre_blues));
+	memset (n_members, 0, sizeof (n_members));
 	memset (used_clusters, 0, sizeof (used_clusters));
 
 	/* Initialise the clusters using the Random Partition method: randomly
-	 * assign a starting cluster to each pixel.
+	 * assign a starting cluster to each pixel. Transparent pixels are
+	 * dropped here, so they don’t need to be skipped in every iteration.
 	 *
 	 * The Forgy method (choosing random pixels as the starting cluster
 	 * centroids) is not appropriate as the checks required to make sure
 	 * they aren’t transparent or duplicated colors mean that the
 	 * initialisation step may never complete. Consider the case of an icon
 	 * which is a block of solid color. */
-	for (ClusterPixel8 *p = pixels; p < pixels_end; p++) {
-		if (p->alpha < minimum_alpha)
-			p->cluster = G_N_ELEMENTS (cluster_centres);
-		else
-			p->cluster = random_int_range_no_replacement (G_N_ELEMENTS (cluster_centres), used_clusters, &n_used_clusters);
+	for (gsize i = 0; i < (gsize) (width * height); i++) {
+		const guint8 *p = &raw_pixels[i * 4];
+
+		if (p[3] < minimum_alpha)
+			continue;
+
+		reds[n_pixels] = p[0];
+		greens[n_pixels] = p[1];
+		blues[n_pixels] = p[2];
+		clusters[n_pixels] = random_int_range_no_replacement (n_clusters, used_clusters, &n_used_clusters);
+		n_pixels++;
 	}
 
 	/* Iterate until every cluster is relatively settled. This is determined
@@ -229,55 +200,74 @@ k_means (GArray    *colors,
 	n_iterations = 0;
 	do {
 		/* Update step. Re-calculate the centroid of each cluster from
-		 * the colors which are in it. */
-		memset (cluster_accumulators, 0, sizeof (cluster_accumulators));
-
-		for (const ClusterPixel8 *p = pixels; p < pixels_end; p++) {
-			if (p->cluster >= G_N_ELEMENTS (cluster_centres))
+		 * the colors which are in it. There are only a few clusters, so
+		 * a masked sum per cluster is cheaper than scattering into
+		 * per-cluster accumulators. */
+		for (gsize k = 0; k < n_clusters; k++) {
+			guint sum_red = 0, sum_green = 0, sum_blue = 0, n = 0;
+
+			for (gsize i = 0; i < n_pixels; i++) {
+				guint in_cluster = (clusters[i] == k);
+
+				sum_red += reds[i] * in_cluster;
+				sum_green += greens[i] * in_cluster;
+				sum_blue += blues[i] * in_cluster;
+				n += in_cluster;
+			}
+
+			n_members[k] = n;
+			if (n == 0)
 				continue;
 
-			cluster_accumulators[p->cluster].red += p->color.red;
-			cluster_accumulators[p->cluster].green += p->color.green;
-			cluster_accumulators[p->cluster].blue += p->color.blue;
-			cluster_accumulators[p->cluster].n_members++;
+			centre_reds[k] = sum_red / n;
+			centre_greens[k] = sum_green / n;
+			centre_blues[k] = sum_blue / n;
 		}
 
-		for (gsize i = 0; i < G_N_ELEMENTS (cluster_centres); i++) {
-			if (cluster_accumulators[i].n_members == 0)
-				continue;
-
-			cluster_centres[i].red = cluster_accumulators[i].red / cluster_accumulators[i].n_members;
-			cluster_centres[i].green = cluster_accumulators[i].green / cluster_accumulators[i].n_members;
-			cluster_centres[i].blue = cluster_accumulators[i].blue / cluster_accumulators[i].n_members;
+		/* Update assignments of colors to clusters. This has to return
+		 * stable results when more than one cluster is equidistant from
+		 * a pixel, or the loop may not terminate, so ties go to the
+		 * lowest-numbered cluster.
+		 *
+		 * Compare squared distances rather than taking the square root,
+		 * as only their order matters. The arithmetic can’t overflow, as
+		 * the R/G/B components have a maximum value of 255. */
+		for (gsize k = 0; k < n_clusters; k++) {
+			gint cr = centre_reds[k];
+			gint cg = centre_greens[k];
+			gint cb = centre_blues[k];
+
+			for (gsize i = 0; i < n_pixels; i++) {
+				gint dr = reds[i] - cr;
+				gint dg = greens[i] - cg;
+				gint db = blues[i] - cb;
+				guint32 distance = dr * dr + dg * dg + db * db;
+				gboolean nearer = (k == 0 || distance < nearest_distances[i]);
+
+				nearest_distances[i] = nearer ? distance : nearest_distances[i];
+				new_clusters[i] = nearer ? k : new_clusters[i];
+			}
 		}
 
-		/* Update assignments of colors to clusters. */
 		n_assignments_changed = 0;
-		for (ClusterPixel8 *p = pixels; p < pixels_end; p++) {
-			gsize new_cluster;
-
-			if (p->cluster >= G_N_ELEMENTS (cluster_centres))
-				continue;
-
-			new_cluster = nearest_cluster (&p->color, cluster_centres, G_N_ELEMENTS (cluster_centres));
-			if (new_cluster != p->cluster)
-				n_assignments_changed++;
-			p->cluster = new_cluster;
+		for (gsize i = 0; i < n_pixels; i++) {
+			n_assignments_changed += (new_clusters[i] != clusters[i]);
+			clusters[i] = new_clusters[i];
 		}
 
 		n_iterations++;
 	} while (n_assignments_changed > assignments_termination_limit && n_iterations < 50);
 
 	/* Output the cluster centres: these are the icon’s key colors. */
-	for (gsize i = 0; i < G_N_ELEMENTS (cluster_centres); i++) {
+	for (gsize k = 0; k < n_clusters; k++) {
 		GdkRGBA color;
 
-		if (cluster_accumulators[i].n_members == 0)
+		if (n_members[k] == 0)
 			continue;
 
-		color.red = (gdouble) cluster_centres[i].red / 255.0;
-		color.green = (gdouble) cluster_centres[i].green / 255.0;
-		color.blue = (gdouble) cluster_centres[i].blue / 255.0;
+		color.red = (gdouble) centre_reds[k] / 255.0;
+		color.green = (gdouble) centre_greens[k] / 255.0;
+		color.blue = (gdouble) centre_blues[k] / 255.0;
 		color.alpha = 1.0;
 		g_array_append_val (colors, color);
 	}
@@ -308,7 +298,7 @@ gs_calculate_key_colors (GdkPixbuf *pixbuf)
 	 * use NEAREST here since we only care about the rough colour data, not
 	 * whether the edges in the image are smooth and visually appealing;
 	 * NEAREST is twice as fast as BILINEAR */
-	pb_small = gdk_pixbuf_scale_simple (pixbuf, 32, 32, GDK_INTERP_NEAREST);
+	pb_small = gdk_pixbuf_scale_simple (pixbuf, ICON_SIZE, ICON_SIZE, GDK_INTERP_NEAREST);
 
 	/* require an alpha channel for storing temporary values; most images
 	 * have one already, about 2% don’t */
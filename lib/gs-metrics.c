@@ -0,0 +1,408 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Software contributors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/**
+ * SECTION:gs-metrics
+ * @title: Metrics
+ * @include: gnome-software.h
+ * @stability: Unstable
+ * @short_description: In-process counters and latency histograms
+ *
+ * A process-wide registry of named counters and latency histograms, which is
+ * always available, unlike the Sysprof marks from `gs-profiler.h`. Every
+ * `GS_PROFILER_*` scope and mark records its duration here under its name, so
+ * this contains the latency of each #GsPluginJob type and of each plugin’s
+ * part in a job.
+ *
+ * Histograms use logarithmic buckets, with four buckets per power of two, so
+ * the percentiles are accurate to within 25%, while recording is
+ * constant-time and the memory used does not grow with the number of samples.
+ * Recording only locks the counter or histogram being recorded to, so threads
+ * recording under different names don’t contend.
+ *
+ * A snapshot of all the metrics can be retrieved with
+ * gs_metrics_dup_variant(); gnome-software exports that on D-Bus, and it can
+ * be displayed with `gnome-software-cmd metrics`.
+ *
+ * Since: 48
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "gs-metrics.h"
+
+/* the number of low bits of a value which select a bucket within its power
+ * of two */
+#define SUB_BUCKET_BITS 2
+#define SUB_BUCKET_COUNT (1 << SUB_BUCKET_BITS)
+#define N_BUCKETS ((64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT)
+
+/* the mutex must come first in each kind of entry; see metrics_entry_new() */
+typedef struct {
+	GMutex mutex;
+	guint64 value;  /* (mutex mutex) */
+} GsMetricsCounter;
+
+typedef struct {
+	GMutex mutex;
+	guint64 count;  /* (mutex mutex) */
+	guint64 sum;  /* (mutex mutex) */
+	guint64 max;  /* (mutex mutex) */
+	guint64 buckets[N_BUCKETS];  /* (mutex mutex) */
+} GsMetricsHistogram;
+
+/* Taken for reading to look up or update an entry, and for writing only to
+ * add an entry or to reset, so recording under different names is only
+ * serialised by each entry’s own mutex. */
+static GRWLock metrics_lock;
+static GHashTable *counters = NULL;  /* (lock metrics_lock) (owned) (nullable): gchar *name ~> GsMetricsCounter * */
+static GHashTable *histograms = NULL;  /* (lock metrics_lock) (owned) (nullable): gchar *name ~> GsMetricsHistogram * */
+
+static gpointer
+metrics_entry_new (gsize size)
+{
+	GMutex *entry = g_malloc0 (size);
+	g_mutex_init (entry);
+	return entry;
+}
+
+static void
+metrics_entry_free (gpointer entry)
+{
+	g_mutex_clear ((GMutex *) entry);
+	g_free (entry);
+}
+
+/* Returns the entry called @name in *@table, adding a new one of @size bytes
+ * if needed, with metrics_lock held for reading. The caller must lock the
+ * entry’s mutex to use it, and then release metrics_lock. */
+static gpointer
+metrics_lookup_or_add (GHashTable  **table,
+		       const gchar  *name,
+		       gsize         size)
+{
+	while (TRUE) {
+		gpointer entry;
+
+		g_rw_lock_reader_lock (&metrics_lock);
+		entry = (*table != NULL) ? g_hash_table_lookup (*table, name) : NULL;
+		if (entry != NULL)
+			return entry;
+		g_rw_lock_reader_unlock (&metrics_lock);
+
+		/* the table may be reset before the reader lock is taken
+		 * again, hence the loop */
+		g_rw_lock_writer_lock (&metrics_lock);
+		if (*table == NULL)
+			*table = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, metrics_entry_free);
+		if (!g_hash_table_contains (*table, name))
+			g_hash_table_insert (*table, g_strdup (name), metrics_entry_new (size));
+		g_rw_lock_writer_unlock (&metrics_lock);
+	}
+}
+
+static guint
+bucket_for_value (guint64 value)
+{
+	guint msb;
+
+	if (value < SUB_BUCKET_COUNT)
+		return value;
+
+	msb = g_bit_storage (value) - 1;
+	return ((msb - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS) |
+	       ((value >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1));
+}
+
+/* returns the largest value which falls in @bucket */
+static guint64
+bucket_get_upper_value (guint bucket)
+{
+	guint exponent = bucket >> SUB_BUCKET_BITS;
+	guint64 mantissa = (bucket & (SUB_BUCKET_COUNT - 1)) | SUB_BUCKET_COUNT;
+
+	if (bucket < SUB_BUCKET_COUNT)
+		return bucket;
+	if (exponent + SUB_BUCKET_BITS >= 64)
+		return G_MAXUINT64;
+
+	return ((mantissa + 1) << (exponent - 1)) - 1;
+}
+
+/* must be called with @histogram’s mutex held */
+static guint64
+histogram_get_percentile (const GsMetricsHistogram *histogram,
+			  guint                     percentile)
+{
+	guint64 rank, seen = 0;
+
+	if (histogram->count == 0)
+		return 0;
+
+	/* the smallest value which at least @percentile % of samples are
+	 * less than or equal to */
+	rank = (histogram->count * percentile + 99) / 100;
+	rank = MAX (rank, 1);
+	for (guint i = 0; i < N_BUCKETS; i++) {
+		seen += histogram->buckets[i];
+		if (seen >= rank)
+			return MIN (bucket_get_upper_value (i), histogram->max);
+	}
+
+	return histogram->max;
+}
+
+/**
+ * gs_metrics_increment_counter:
+ * @name: name of the counter
+ * @delta: amount to add to it
+ *
+ * Add @delta to the counter called @name, creating it if needed.
+ *
+ * Since: 48
+ */
+void
+gs_metrics_increment_counter (const gchar *name,
+			      guint64      delta)
+{
+	GsMetricsCounter *counter;
+
+	g_return_if_fail (name != NULL);
+
+	counter = metrics_lookup_or_add (&counters, name, sizeof (GsMetricsCounter));
+	g_mutex_lock (&counter->mutex);
+	counter->value += delta;
+	g_mutex_unlock (&counter->mutex);
+	g_rw_lock_reader_unlock (&metrics_lock);
+}
+
+/**
+ * gs_metrics_get_counter:
+ * @name: name of the counter
+ *
+ * Get the value of the counter called @name.
+ *
+ * Returns: the value of the counter, or zero if it does not exist
+ * Since: 48
+ */
+guint64
+gs_metrics_get_counter (const gchar *name)
+{
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
+	GsMetricsCounter *counter;
+	g_autoptr(GMutexLocker) counter_locker = NULL;
+
+	g_return_val_if_fail (name != NULL, 0);
+
+	locker = g_rw_lock_reader_locker_new (&metrics_lock);
+	counter = (counters != NULL) ? g_hash_table_lookup (counters, name) : NULL;
+	if (counter == NULL)
+		return 0;
+
+	counter_locker = g_mutex_locker_new (&counter->mutex);
+	return counter->value;
+}
+
+/**
+ * gs_metrics_record_duration:
+ * @name: name of the histogram
+ * @duration_usec: the duration to record, in microseconds
+ *
+ * Add a sample to the latency histogram called @name, creating it if needed.
+ *
+ * Since: 48
+ */
+void
+gs_metrics_record_duration (const gchar *name,
+			    guint64      duration_usec)
+{
+	GsMetricsHistogram *histogram;
+
+	g_return_if_fail (name != NULL);
+
+	histogram = metrics_lookup_or_add (&histograms, name, sizeof (GsMetricsHistogram));
+	g_mutex_lock (&histogram->mutex);
+	histogram->count++;
+	histogram->sum += duration_usec;
+	histogram->max = MAX (histogram->max, duration_usec);
+	histogram->buckets[bucket_for_value (duration_usec)]++;
+	g_mutex_unlock (&histogram->mutex);
+	g_rw_lock_reader_unlock (&metrics_lock);
+}
+
+/**
+ * gs_metrics_get_percentiles:
+ * @name: name of the histogram
+ * @out_count: (out) (optional): return location for the number of samples
+ * @out_p50_usec: (out) (optional): return location for the median, in microseconds
+ * @out_p95_usec: (out) (optional): return location for the 95th percentile, in microseconds
+ * @out_p99_usec: (out) (optional): return location for the 99th percentile, in microseconds
+ *
+ * Get a summary of the latency histogram called @name.
+ *
+ * Returns: %TRUE if the histogram exists, %FALSE otherwise
+ * Since: 48
+ */
+gboolean
+gs_metrics_get_percentiles (const gchar *name,
+			    guint64     *out_count,
+			    guint64     *out_p50_usec,
+			    guint64     *out_p95_usec,
+			    guint64     *out_p99_usec)
+{
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
+	g_autoptr(GMutexLocker) histogram_locker = NULL;
+	GsMetricsHistogram *histogram;
+
+	g_return_val_if_fail (name != NULL, FALSE);
+
+	locker = g_rw_lock_reader_locker_new (&metrics_lock);
+	histogram = (histograms != NULL) ? g_hash_table_lookup (histograms, name) : NULL;
+	if (histogram == NULL)
+		return FALSE;
+
+	histogram_locker = g_mutex_locker_new (&histogram->mutex);
+
+	if (out_count != NULL)
+		*out_count = histogram->count;
+	if (out_p50_usec != NULL)
+		*out_p50_usec = histogram_get_percentile (histogram, 50);
+	if (out_p95_usec != NULL)
+		*out_p95_usec = histogram_get_percentile (histogram, 95);
+	if (out_p99_usec != NULL)
+		*out_p99_usec = histogram_get_percentile (histogram, 99);
+
+	return TRUE;
+}
+
+/**
+ * gs_metrics_dup_variant:
+ *
+ * Get a snapshot of all the metrics, in the format described by
+ * %GS_METRICS_VARIANT_TYPE.
+ *
+ * Returns: (transfer full): a new floating #GVariant
+ * Since: 48
+ */
+GVariant *
+gs_metrics_dup_variant (void)
+{
+	g_autoptr(GRWLockReaderLocker) locker = g_rw_lock_reader_locker_new (&metrics_lock);
+	g_auto(GVariantBuilder) counters_builder = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("a{st}"));
+	g_auto(GVariantBuilder) histograms_builder = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("a{s(tttttt)}"));
+	GHashTableIter iter;
+	gpointer key, value;
+
+	if (counters != NULL) {
+		g_hash_table_iter_init (&iter, counters);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			GsMetricsCounter *counter = value;
+			g_autoptr(GMutexLocker) counter_locker = g_mutex_locker_new (&counter->mutex);
+			g_variant_builder_add (&counters_builder, "{st}", key, counter->value);
+		}
+	}
+
+	if (histograms != NULL) {
+		g_hash_table_iter_init (&iter, histograms);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			GsMetricsHistogram *histogram = value;
+			g_autoptr(GMutexLocker) histogram_locker = g_mutex_locker_new (&histogram->mutex);
+			g_variant_builder_add (&histograms_builder, "{s(tttttt)}", key,
+					       histogram->count,
+					       histogram->sum,
+					       histogram_get_percentile (histogram, 50),
+					       histogram_get_percentile (histogram, 95),
+					       histogram_get_percentile (histogram, 99),
+					       histogram->max);
+		}
+	}
+
+	return g_variant_new ("(a{st}a{s(tttttt)})", &counters_builder, &histograms_builder);
+}
+
+static gint
+compare_strings_cb (gconstpointer a,
+		    gconstpointer b)
+{
+	return g_strcmp0 (*((const gchar * const *) a), *((const gchar * const *) b));
+}
+
+/**
+ * gs_metrics_variant_to_string:
+ * @metrics: a snapshot from gs_metrics_dup_variant()
+ *
+ * Format a snapshot of the metrics as a human readable table, sorted by name.
+ *
+ * Returns: (transfer full): a new string
+ * Since: 48
+ */
+gchar *
+gs_metrics_variant_to_string (GVariant *metrics)
+{
+	g_autoptr(GVariant) counters_variant = NULL;
+	g_autoptr(GVariant) histograms_variant = NULL;
+	g_autoptr(GPtrArray) lines = g_ptr_array_new_with_free_func (g_free);
+	GString *str;
+	GVariantIter iter;
+	const gchar *name;
+	guint64 count, sum, p50, p95, p99, max;
+
+	g_return_val_if_fail (g_variant_is_of_type (metrics, GS_METRICS_VARIANT_TYPE), NULL);
+
+	str = g_string_new (NULL);
+	g_variant_get (metrics, "(@a{st}@a{s(tttttt)})", &counters_variant, &histograms_variant);
+
+	g_variant_iter_init (&iter, histograms_variant);
+	while (g_variant_iter_next (&iter, "{&s(tttttt)}", &name, &count, &sum, &p50, &p95, &p99, &max)) {
+		g_ptr_array_add (lines,
+				 g_strdup_printf ("%-60s %8" G_GUINT64_FORMAT " %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+						  name, count,
+						  (gdouble) sum / count / 1000.0,
+						  p50 / 1000.0, p95 / 1000.0, p99 / 1000.0, max / 1000.0));
+	}
+	if (lines->len > 0) {
+		g_ptr_array_sort (lines, compare_strings_cb);
+		g_string_append_printf (str, "%-60s %8s %10s %10s %10s %10s %10s\n",
+					"Latency (ms)", "count", "mean", "p50", "p95", "p99", "max");
+		for (guint i = 0; i < lines->len; i++)
+			g_string_append (str, g_ptr_array_index (lines, i));
+	}
+
+	g_ptr_array_set_size (lines, 0);
+	g_variant_iter_init (&iter, counters_variant);
+	while (g_variant_iter_next (&iter, "{&st}", &name, &count))
+		g_ptr_array_add (lines, g_strdup_printf ("%-60s %8" G_GUINT64_FORMAT "\n", name, count));
+	if (lines->len > 0) {
+		g_ptr_array_sort (lines, compare_strings_cb);
+		if (str->len > 0)
+			g_string_append_c (str, '\n');
+		g_string_append_printf (str, "%-60s %8s\n", "Counter", "value");
+		for (guint i = 0; i < lines->len; i++)
+			g_string_append (str, g_ptr_array_index (lines, i));
+	}
+
+	return g_string_free (str, FALSE);
+}
+
+/**
+ * gs_metrics_reset:
+ *
+ * Remove all the counters and histograms.
+ *
+ * Since: 48
+ */
+void
+gs_metrics_reset (void)
+{
+	g_autoptr(GRWLockWriterLocker) locker = g_rw_lock_writer_locker_new (&metrics_lock);
+
+	g_clear_pointer (&counters, g_hash_table_unref);
+	g_clear_pointer (&histograms, g_hash_table_unref);
+}
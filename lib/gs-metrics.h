@@ -0,0 +1,41 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Software contributors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GS_METRICS_VARIANT_TYPE:
+ *
+ * The #GVariantType of a snapshot returned by gs_metrics_dup_variant(): a
+ * dictionary of counters, and a dictionary of latency summaries giving the
+ * count, sum, 50th, 95th and 99th percentiles, and maximum of each histogram,
+ * all in microseconds.
+ *
+ * Since: 48
+ */
+#define GS_METRICS_VARIANT_TYPE ((const GVariantType *) "(a{st}a{s(tttttt)})")
+
+void		 gs_metrics_increment_counter	(const gchar	*name,
+						 guint64	 delta);
+guint64		 gs_metrics_get_counter		(const gchar	*name);
+void		 gs_metrics_record_duration	(const gchar	*name,
+						 guint64	 duration_usec);
+gboolean	 gs_metrics_get_percentiles	(const gchar	*name,
+						 guint64	*out_count,
+						 guint64	*out_p50_usec,
+						 guint64	*out_p95_usec,
+						 guint64	*out_p99_usec);
+GVariant	*gs_metrics_dup_variant		(void);
+gchar		*gs_metrics_variant_to_string	(GVariant	*metrics);
+void		 gs_metrics_reset		(void);
+
+G_END_DECLS
@@ -41,10 +41,12 @@
 #include <math.h>
 #include <string.h>
 
+#include "gs-download-scheduler.h"
+
 G_DEFINE_QUARK (gs-odrs-provider-error-quark, gs_odrs_provider_error)
 
-/* Element in self->ratings, all allocated in one big block and sorted
- * alphabetically to reduce the number of allocations and fragmentation. */
+/* Used while parsing the ratings JSON, before the ratings are written out
+ * in the binary format below. */
 typedef struct {
 	gchar *app_id;  /* (owned) */
 	guint32 n_star_ratings[6];
@@ -62,6 +64,176 @@ rating_clear (GsOdrsRating *rating)
 	g_free (rating->app_id);
 }
 
+/* The parsed ratings are cached in a binary file next to the JSON, so they
+ * can be mapped and searched directly rather than parsing the JSON on every
+ * start. The file is a header, followed by @n_ratings fixed-size records
+ * sorted by app ID, followed by a table of nul-terminated strings. It is in
+ * host byte order, as it is never shared between machines.
+ *
+ * The file is regenerated whenever the key (the ETag or modification time
+ * of the JSON it was generated from) changes, or @version is bumped. */
+#define GS_ODRS_RATINGS_CACHE_MAGIC "GSODRSR"
+#define GS_ODRS_RATINGS_CACHE_VERSION 1
+
+typedef struct {
+	gchar magic[8];
+	guint32 version;
+	guint32 n_ratings;
+	guint32 key_offset;  /* into the string table */
+	guint32 strings_size;
+} GsOdrsRatingsHeader;
+
+typedef struct {
+	guint32 app_id_offset;  /* into the string table */
+	guint32 n_star_ratings[6];
+} GsOdrsRatingRecord;
+
+G_STATIC_ASSERT (sizeof (GsOdrsRatingsHeader) % sizeof (guint32) == 0);
+G_STATIC_ASSERT (sizeof (GsOdrsRatingRecord) % sizeof (guint32) == 0);
+
+static const GsOdrsRatingRecord *
+ratings_get_records (GBytes *ratings)
+{
+	const guint8 *data = g_bytes_get_data (ratings, NULL);
+	return (const GsOdrsRatingRecord *) (data + sizeof (GsOdrsRatingsHeader));
+}
+
+static const gchar *
+ratings_get_strings (GBytes *ratings)
+{
+	const guint8 *data = g_bytes_get_data (ratings, NULL);
+	const GsOdrsRatingsHeader *header = (const GsOdrsRatingsHeader *) data;
+	return (const gchar *) (data + sizeof (GsOdrsRatingsHeader) +
+				header->n_ratings * sizeof (GsOdrsRatingRecord));
+}
+
+/* returns %NULL if not found */
+static const GsOdrsRatingRecord *
+ratings_lookup (GBytes      *ratings,
+                const gchar *app_id)
+{
+	const GsOdrsRatingsHeader *header = g_bytes_get_data (ratings, NULL);
+	const GsOdrsRatingRecord *records = ratings_get_records (ratings);
+	const gchar *strings = ratings_get_strings (ratings);
+	guint32 lower = 0, upper = header->n_ratings;
+
+	while (lower < upper) {
+		guint32 mid = lower + (upper - lower) / 2;
+		gint cmp = strcmp (app_id, strings + records[mid].app_id_offset);
+
+		if (cmp == 0)
+			return &records[mid];
+		else if (cmp < 0)
+			upper = mid;
+		else
+			lower = mid + 1;
+	}
+
+	return NULL;
+}
+
+/* Checks that @ratings is a complete cache file for @key, so that the
+ * lookups can trust all the offsets and the ordering of the records in it. */
+static gboolean
+ratings_validate (GBytes      *ratings,
+                  const gchar *key)
+{
+	gsize size;
+	const guint8 *data = g_bytes_get_data (ratings, &size);
+	const GsOdrsRatingsHeader *header = (const GsOdrsRatingsHeader *) data;
+	const GsOdrsRatingRecord *records;
+	const gchar *strings;
+
+	if (size < sizeof (GsOdrsRatingsHeader) ||
+	    memcmp (header->magic, GS_ODRS_RATINGS_CACHE_MAGIC, sizeof (header->magic)) != 0 ||
+	    header->version != GS_ODRS_RATINGS_CACHE_VERSION)
+		return FALSE;
+	if (header->n_ratings > (size - sizeof (GsOdrsRatingsHeader)) / sizeof (GsOdrsRatingRecord) ||
+	    size - sizeof (GsOdrsRatingsHeader) - header->n_ratings * sizeof (GsOdrsRatingRecord) != header->strings_size)
+		return FALSE;
+
+	/* all the strings are terminated, as long as the table is */
+	strings = ratings_get_strings (ratings);
+	if (header->strings_size == 0 || strings[header->strings_size - 1] != '\0')
+		return FALSE;
+	if (header->key_offset >= header->strings_size ||
+	    g_strcmp0 (strings + header->key_offset, key) != 0)
+		return FALSE;
+
+	/* lookups binary search the records, so a cache which isn’t strictly
+	 * sorted would silently return the wrong ratings; rebuild it instead */
+	records = ratings_get_records (ratings);
+	for (guint32 i = 0; i < header->n_ratings; i++) {
+		if (records[i].app_id_offset >= header->strings_size)
+			return FALSE;
+		if (i > 0 &&
+		    strcmp (strings + records[i - 1].app_id_offset,
+			    strings + records[i].app_id_offset) >= 0)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* @ratings must be sorted by app ID */
+static GBytes *
+ratings_serialize (GArray      *ratings,
+                   const gchar *key)
+{
+	g_autoptr(GByteArray) records = g_byte_array_new ();
+	g_autoptr(GString) strings = g_string_new (NULL);
+	GsOdrsRatingsHeader header = { GS_ODRS_RATINGS_CACHE_MAGIC, };
+	GByteArray *buf;
+
+	header.version = GS_ODRS_RATINGS_CACHE_VERSION;
+	header.n_ratings = ratings->len;
+	header.key_offset = strings->len;
+	g_string_append_len (strings, key, strlen (key) + 1);
+
+	for (guint i = 0; i < ratings->len; i++) {
+		const GsOdrsRating *rating = &g_array_index (ratings, GsOdrsRating, i);
+		GsOdrsRatingRecord record;
+
+		record.app_id_offset = strings->len;
+		memcpy (record.n_star_ratings, rating->n_star_ratings, sizeof (record.n_star_ratings));
+		g_byte_array_append (records, (const guint8 *) &record, sizeof (record));
+		g_string_append_len (strings, rating->app_id, strlen (rating->app_id) + 1);
+	}
+	header.strings_size = strings->len;
+
+	buf = g_byte_array_sized_new (sizeof (header) + records->len + strings->len);
+	g_byte_array_append (buf, (const guint8 *) &header, sizeof (header));
+	g_byte_array_append (buf, records->data, records->len);
+	g_byte_array_append (buf, (const guint8 *) strings->str, strings->len);
+
+	return g_byte_array_free_to_bytes (buf);
+}
+
+/* The key identifies the contents of the ratings JSON, without reading it */
+static gchar *
+gs_odrs_provider_get_ratings_key (const gchar *filename)
+{
+	g_autoptr(GFile) file = g_file_new_for_path (filename);
+	g_autoptr(GDateTime) last_modified_date = NULL;
+	g_autofree gchar *etag = NULL;
+
+	etag = gs_utils_get_file_etag (file, &last_modified_date, NULL);
+	if (etag != NULL && *etag != '\0')
+		return g_strconcat ("etag:", etag, NULL);
+	if (last_modified_date != NULL)
+		return g_strdup_printf ("mtime:%" G_GINT64_FORMAT ".%06d",
+					g_date_time_to_unix (last_modified_date),
+					g_date_time_get_microsecond (last_modified_date));
+	return NULL;
+}
+
+static gchar *
+gs_odrs_provider_get_ratings_cache_filename (const gchar *filename)
+{
+	g_autofree gchar *dirname = g_path_get_dirname (filename);
+	return g_build_filename (dirname, "ratings.bin", NULL);
+}
+
 struct _GsOdrsProvider
 {
 	GObject		 parent_instance;
@@ -69,7 +241,7 @@ struct _GsOdrsProvider
 	gchar		*distro;  /* (not nullable) (owned) */
 	gchar		*user_hash;  /* (not nullable) (owned) */
 	gchar		*review_server;  /* (not nullable) (owned) */
-	GArray		*ratings;  /* (element-type GsOdrsRating) (mutex ratings_mutex) (owned) (nullable) */
+	GBytes		*ratings;  /* (mutex ratings_mutex) (owned) (nullable); in the binary cache format, usually mapped */
 	GMutex		 ratings_mutex;
 	guint64		 max_cache_age_secs;
 	guint		 n_results_max;
@@ -109,10 +281,9 @@ gs_odrs_provider_load_ratings_for_app (JsonObject   *json_app,
 	return TRUE;
 }
 
-static gboolean
-gs_odrs_provider_load_ratings (GsOdrsProvider  *self,
-                               const gchar     *filename,
-                               GError         **error)
+static GArray *
+gs_odrs_provider_parse_ratings (const gchar  *filename,
+                                GError      **error)
 {
 	JsonNode *json_root;
 	JsonObject *json_item;
@@ -121,7 +292,6 @@ gs_odrs_provider_load_ratings (GsOdrsProvider  *self,
 	JsonNode *json_app_node;
 	JsonObjectIter iter;
 	g_autoptr(GArray) new_ratings = NULL;
-	g_autoptr(GMutexLocker) locker = NULL;
 	g_autoptr(GError) local_error = NULL;
 
 	/* parse the data and find the success */
@@ -131,7 +301,7 @@ gs_odrs_provider_load_ratings (GsOdrsProvider  *self,
 			     GS_ODRS_PROVIDER_ERROR,
 			     GS_ODRS_PROVIDER_ERROR_PARSING_DATA,
 			     "Error parsing ODRS data: %s", local_error->message);
-		return FALSE;
+		return NULL;
 	}
 	json_root = json_parser_get_root (json_parser);
 	if (json_root == NULL) {
@@ -139,14 +309,14 @@ gs_odrs_provider_load_ratings (GsOdrsProvider  *self,
 				     GS_ODRS_PROVIDER_ERROR,
 				     GS_ODRS_PROVIDER_ERROR_PARSING_DATA,
 				     "no ratings root");
-		return FALSE;
+		return NULL;
 	}
 	if (json_node_get_node_type (json_root) != JSON_NODE_OBJECT) {
 		g_set_error_literal (error,
 				     GS_ODRS_PROVIDER_ERROR,
 				     GS_ODRS_PROVIDER_ERROR_PARSING_DATA,
 				     "no ratings array");
-		return FALSE;
+		return NULL;
 	}
 
 	json_item = json_node_get_object (json_root);
@@ -174,9 +344,61 @@ gs_odrs_provider_load_ratings (GsOdrsProvider  *self,
 	/* Allow for binary searches later. */
 	g_array_sort (new_ratings, (GCompareFunc) rating_compare);
 
+	return g_steal_pointer (&new_ratings);
+}
+
+static gboolean
+gs_odrs_provider_load_ratings (GsOdrsProvider  *self,
+                               const gchar     *filename,
+                               GError         **error)
+{
+	g_autofree gchar *key = NULL;
+	g_autofree gchar *cache_filename = NULL;
+	g_autoptr(GBytes) new_ratings = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	key = gs_odrs_provider_get_ratings_key (filename);
+	cache_filename = gs_odrs_provider_get_ratings_cache_filename (filename);
+
+	/* use the binary cache if it was generated from this JSON */
+	if (key != NULL) {
+		g_autoptr(GMappedFile) mapped_file = NULL;
+		g_autoptr(GError) local_error = NULL;
+
+		mapped_file = g_mapped_file_new (cache_filename, FALSE, &local_error);
+		if (mapped_file != NULL) {
+			g_autoptr(GBytes) bytes = g_mapped_file_get_bytes (mapped_file);
+			if (ratings_validate (bytes, key))
+				new_ratings = g_steal_pointer (&bytes);
+			else
+				g_debug ("Ignoring outdated ratings cache ‘%s’", cache_filename);
+		} else if (!g_error_matches (local_error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+			g_debug ("Failed to map ratings cache ‘%s’: %s", cache_filename, local_error->message);
+		}
+	}
+
+	if (new_ratings == NULL) {
+		g_autoptr(GArray) parsed_ratings = NULL;
+		g_autoptr(GError) local_error = NULL;
+
+		parsed_ratings = gs_odrs_provider_parse_ratings (filename, error);
+		if (parsed_ratings == NULL)
+			return FALSE;
+
+		new_ratings = ratings_serialize (parsed_ratings, (key != NULL) ? key : "");
+
+		/* a failure to write the cache only costs parsing next time */
+		if (key != NULL &&
+		    !g_file_set_contents (cache_filename,
+					  g_bytes_get_data (new_ratings, NULL),
+					  g_bytes_get_size (new_ratings),
+					  &local_error))
+			g_debug ("Failed to write ratings cache ‘%s’: %s", cache_filename, local_error->message);
+	}
+
 	/* Update the shared state */
 	locker = g_mutex_locker_new (&self->ratings_mutex);
-	g_clear_pointer (&self->ratings, g_array_unref);
+	g_clear_pointer (&self->ratings, g_bytes_unref);
 	self->ratings = g_steal_pointer (&new_ratings);
 
 	return TRUE;
@@ -605,16 +827,12 @@ gs_odrs_provider_refine_ratings (GsOdrsProvider  *self,
 
 	for (guint i = 0; i < reviewable_ids->len; i++) {
 		const gchar *id = g_ptr_array_index (reviewable_ids, i);
-		const GsOdrsRating search_rating = { (gchar *) id, { 0, }};
-		guint found_index;
-		const GsOdrsRating *found_rating;
+		const GsOdrsRatingRecord *found_rating;
 
-		if (!g_array_binary_search (self->ratings, &search_rating,
-					    (GCompareFunc) rating_compare, &found_index))
+		found_rating = ratings_lookup (self->ratings, id);
+		if (found_rating == NULL)
 			continue;
 
-		found_rating = &g_array_index (self->ratings, GsOdrsRating, found_index);
-
 		/* copy into accumulator array */
 		for (guint j = 0; j < 6; j++)
 			ratings_raw[j] += found_rating->n_star_ratings[j];
@@ -1184,7 +1402,7 @@ gs_odrs_provider_finalize (GObject *object)
 	g_free (self->user_hash);
 	g_free (self->distro);
 	g_free (self->review_server);
-	g_clear_pointer (&self->ratings, g_array_unref);
+	g_clear_pointer (&self->ratings, g_bytes_unref);
 	g_mutex_clear (&self->ratings_mutex);
 
 	G_OBJECT_CLASS (gs_odrs_provider_parent_class)->finalize (object);
@@ -1390,9 +1608,10 @@ gs_odrs_provider_refresh_ratings_async (GsOdrsProvider             *self,
 	uri = g_strdup_printf ("%s/ratings", self->review_server);
 	g_debug ("Updating ODRS cache from %s to %s", uri, cache_filename);
 
-	gs_download_file_async (self->session, uri, cache_file, G_PRIORITY_LOW,
-				progress_callback, progress_user_data,
-				cancellable, download_ratings_cb, g_steal_pointer (&task));
+	gs_download_scheduler_download_file_async (gs_download_scheduler_get_default (),
+						   self->session, uri, cache_file, G_PRIORITY_LOW,
+						   progress_callback, progress_user_data,
+						   cancellable, download_ratings_cb, g_steal_pointer (&task));
 }
 
 static void
@@ -1400,14 +1619,14 @@ download_ratings_cb (GObject      *source_object,
                      GAsyncResult *result,
                      gpointer      user_data)
 {
-	SoupSession *soup_session = SOUP_SESSION (source_object);
+	GsDownloadScheduler *scheduler = GS_DOWNLOAD_SCHEDULER (source_object);
 	g_autoptr(GTask) task = g_steal_pointer (&user_data);
 	GsOdrsProvider *self = g_task_get_source_object (task);
 	GFile *cache_file = g_task_get_task_data (task);
 	const gchar *cache_file_path = NULL;
 	g_autoptr(GError) local_error = NULL;
 
-	if (!gs_download_file_finish (soup_session, result, &local_error) &&
+	if (!gs_download_scheduler_download_file_finish (scheduler, result, &local_error) &&
 	    !g_error_matches (local_error, GS_DOWNLOAD_ERROR, GS_DOWNLOAD_ERROR_NOT_MODIFIED)) {
 		g_task_return_new_error (task, GS_ODRS_PROVIDER_ERROR,
 					 GS_ODRS_PROVIDER_ERROR_DOWNLOADING,
@@ -88,9 +88,7 @@ struct _GsPluginJobInstallApps
 	GSource *progress_source;  /* (owned) (nullable) */
 	guint last_reported_progress;
 
-#ifdef HAVE_SYSPROF
 	gint64 begin_time_nsec;
-#endif
 };
 
 G_DEFINE_TYPE (GsPluginJobInstallApps, gs_plugin_job_install_apps, GS_TYPE_PLUGIN_JOB)
@@ -244,9 +242,7 @@ gs_plugin_job_install_apps_run_async (GsPluginJob         *job,
 	self->n_pending_ops = 1;
 	plugins = gs_plugin_loader_get_plugins (plugin_loader);
 
-#ifdef HAVE_SYSPROF
-	self->begin_time_nsec = SYSPROF_CAPTURE_CURRENT_TIME;
-#endif
+	self->begin_time_nsec = GS_PROFILER_CURRENT_TIME;
 
 	for (guint i = 0; i < plugins->len; i++) {
 		GsPlugin *plugin = g_ptr_array_index (plugins, i);
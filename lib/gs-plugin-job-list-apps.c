@@ -24,6 +24,18 @@
  * calling it for all loaded plugins, with #GsPluginJobRefine used to refine
  * them.
  *
+ * If #GsAppQuery:max-results is set and the results are in random order
+ * (#GsAppQuery:sort-func is not set), only a random sample of the apps
+ * returned by the plugins is refined, a few times larger than needed to allow
+ * for apps being filtered out afterwards. If too many are filtered out, the
+ * next sample is refined, until there are enough results or no more apps.
+ *
+ * Similarly, if the results are sorted by a function whose sort keys are set
+ * when the apps are listed (see gs_app_query_get_max_candidates()), the apps
+ * are sorted before refining and only the top ones are refined. For any other
+ * #GsAppQuery:sort-func, all the apps are refined, as the refine may add data
+ * the sort depends on, but only the top results are sorted.
+ *
  * Retrieve the resulting #GsAppList using
  * gs_plugin_job_list_apps_get_result_list().
  *
@@ -42,6 +54,7 @@
 #include "gs-enums.h"
 #include "gs-plugin-job.h"
 #include "gs-plugin-job-list-apps.h"
+#include "gs-metrics.h"
 #include "gs-plugin-job-private.h"
 #include "gs-plugin-job-refine.h"
 #include "gs-plugin-private.h"
@@ -61,13 +74,13 @@ struct _GsPluginJobListApps
 	GsAppList *merged_list;  /* (owned) (nullable) */
 	GError *saved_error;  /* (owned) (nullable) */
 	guint n_pending_ops;
+	GsAppList *spare_list;  /* (owned) (nullable): candidates not refined yet */
+	GsAppList *kept_list;  /* (owned) (nullable): refined and filtered results so far */
 
 	/* Results. */
 	GsAppList *result_list;  /* (owned) (nullable) */
 
-#ifdef HAVE_SYSPROF
 	gint64 begin_time_nsec;
-#endif
 };
 
 G_DEFINE_TYPE (GsPluginJobListApps, gs_plugin_job_list_apps, GS_TYPE_PLUGIN_JOB)
@@ -88,6 +101,8 @@ gs_plugin_job_list_apps_dispose (GObject *object)
 	g_assert (self->saved_error == NULL);
 	g_assert (self->n_pending_ops == 0);
 
+	g_clear_object (&self->spare_list);
+	g_clear_object (&self->kept_list);
 	g_clear_object (&self->result_list);
 	g_clear_object (&self->query);
 
@@ -245,6 +260,11 @@ static void refine_cb (GObject      *source_object,
                        gpointer      user_data);
 static void finish_task (GTask     *task,
                          GsAppList *merged_list);
+static void refine_list (GTask     *task,
+                         GsAppList *list);
+static void refine_candidates (GTask *task);
+static void finish_refined_list (GTask     *task,
+                                 GsAppList *list);
 
 static void
 gs_plugin_job_list_apps_run_async (GsPluginJob         *job,
@@ -269,9 +289,7 @@ gs_plugin_job_list_apps_run_async (GsPluginJob         *job,
 	self->merged_list = gs_app_list_new ();
 	plugins = gs_plugin_loader_get_plugins (plugin_loader);
 
-#ifdef HAVE_SYSPROF
-	self->begin_time_nsec = SYSPROF_CAPTURE_CURRENT_TIME;
-#endif
+	self->begin_time_nsec = GS_PROFILER_CURRENT_TIME;
 
 	for (guint i = 0; i < plugins->len; i++) {
 		GsPlugin *plugin = g_ptr_array_index (plugins, i);
@@ -344,11 +362,10 @@ finish_op (GTask  *task,
            GError *error)
 {
 	GsPluginJobListApps *self = g_task_get_source_object (task);
-	GCancellable *cancellable = g_task_get_cancellable (task);
-	GsPluginLoader *plugin_loader = g_task_get_task_data (task);
 	g_autoptr(GsAppList) merged_list = NULL;
-	GsPluginRefineFlags refine_flags = GS_PLUGIN_REFINE_FLAGS_NONE;
-	GsAppQueryLicenseType license_type = GS_APP_QUERY_LICENSE_ANY;
+	guint max_candidates = 0;
+	GsAppListSortFunc sort_func = NULL;
+	gpointer sort_func_data = NULL;
 	g_autoptr(GError) error_owned = g_steal_pointer (&error);
 
 	if (error_owned != NULL && self->saved_error == NULL)
@@ -371,6 +388,43 @@ finish_op (GTask  *task,
 		return;
 	}
 
+	gs_metrics_increment_counter ("list-apps-candidates", gs_app_list_length (merged_list));
+
+	/* If only the first few randomly ordered results are wanted, only
+	 * refine a random sample of the candidates; if only the top few
+	 * results are wanted, and refining can’t change their order, only
+	 * refine the top candidates. See refine_candidates(). */
+	if (self->query != NULL) {
+		sort_func = gs_app_query_get_sort_func (self->query, &sort_func_data);
+		max_candidates = gs_app_query_get_max_candidates (self->query, sort_func);
+	}
+
+	if (max_candidates > 0 &&
+	    gs_app_list_length (merged_list) > max_candidates) {
+		if (sort_func != NULL)
+			gs_app_list_sort (merged_list, sort_func, sort_func_data);
+		else
+			gs_app_list_randomize (merged_list);
+		self->spare_list = g_steal_pointer (&merged_list);
+		refine_candidates (task);
+		return;
+	}
+
+	refine_list (task, merged_list);
+}
+
+/* Refine @list, and then pass it to finish_task() along with the results kept
+ * from refining earlier samples, if any. */
+static void
+refine_list (GTask     *task,
+             GsAppList *list)
+{
+	GsPluginJobListApps *self = g_task_get_source_object (task);
+	GCancellable *cancellable = g_task_get_cancellable (task);
+	GsPluginLoader *plugin_loader = g_task_get_task_data (task);
+	GsPluginRefineFlags refine_flags = GS_PLUGIN_REFINE_FLAGS_NONE;
+	GsAppQueryLicenseType license_type = GS_APP_QUERY_LICENSE_ANY;
+
 	/* run refine() on each one if required */
 	if (self->query != NULL) {
 		refine_flags = gs_app_query_get_refine_flags (self->query);
@@ -383,12 +437,14 @@ finish_op (GTask  *task,
 		refine_flags |= GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENSE;
 	}
 
-	if (merged_list != NULL &&
-	    gs_app_list_length (merged_list) > 0 &&
+	if (list != NULL &&
+	    gs_app_list_length (list) > 0 &&
 	    refine_flags != GS_PLUGIN_REFINE_FLAGS_NONE) {
 		g_autoptr(GsPluginJob) refine_job = NULL;
 
-		refine_job = gs_plugin_job_refine_new (merged_list,
+		gs_metrics_increment_counter ("list-apps-refined", gs_app_list_length (list));
+
+		refine_job = gs_plugin_job_refine_new (list,
 						       refine_flags |
 						       GS_PLUGIN_REFINE_FLAGS_DISABLE_FILTERING);
 		gs_plugin_loader_job_process_async (plugin_loader, refine_job,
@@ -397,8 +453,70 @@ finish_op (GTask  *task,
 						    g_object_ref (task));
 	} else {
 		g_debug ("No apps to refine");
-		finish_task (task, merged_list);
+		finish_refined_list (task, list);
+	}
+}
+
+/* Refine the next sample of candidates from self->spare_list, which is either
+ * in random order or sorted by the query’s sort function. Refining is the
+ * expensive part of listing apps, so when only the first few of the list are
+ * wanted, this is cheaper than refining them all. The sample is larger than
+ * the number of results wanted, to allow for apps being filtered out after
+ * refining; if too many are, finish_task() calls this again.
+ *
+ * All the candidates with the same ID go in the same sample, so that
+ * deduplicating them in finish_task() chooses between all of them, rather
+ * than keeping whichever was sampled first. Likewise, when sorted, all the
+ * candidates which sort equal to the last one in the sample go in it. */
+static void
+refine_candidates (GTask *task)
+{
+	GsPluginJobListApps *self = g_task_get_source_object (task);
+	g_autoptr(GsAppList) sample = gs_app_list_new ();
+	g_autoptr(GsAppList) rest = NULL;
+	g_autoptr(GHashTable) sampled_ids = NULL;
+	GsAppListSortFunc sort_func;
+	gpointer sort_func_data = NULL;
+	GsApp *last_sampled = NULL;
+	guint n_sample;
+
+	sort_func = gs_app_query_get_sort_func (self->query, &sort_func_data);
+	n_sample = gs_app_query_get_max_candidates (self->query, sort_func);
+	if (n_sample >= gs_app_list_length (self->spare_list)) {
+		g_clear_object (&sample);
+		sample = g_steal_pointer (&self->spare_list);
+	} else {
+		rest = gs_app_list_new ();
+		sampled_ids = g_hash_table_new (g_str_hash, g_str_equal);
+		for (guint i = 0; i < gs_app_list_length (self->spare_list); i++) {
+			GsApp *app = gs_app_list_index (self->spare_list, i);
+			const gchar *id = gs_app_get_id (app);
+
+			if (i < n_sample ||
+			    (last_sampled != NULL &&
+			     sort_func (app, last_sampled, sort_func_data) == 0)) {
+				gs_app_list_add (sample, app);
+				if (id != NULL)
+					g_hash_table_add (sampled_ids, (gpointer) id);
+				if (sort_func != NULL)
+					last_sampled = app;
+			} else if (id != NULL && g_hash_table_contains (sampled_ids, id)) {
+				gs_app_list_add (sample, app);
+			} else {
+				gs_app_list_add (rest, app);
+			}
+		}
+		if (gs_app_list_length (rest) > 0)
+			g_set_object (&self->spare_list, rest);
+		else
+			g_clear_object (&self->spare_list);
 	}
+
+	g_debug ("refining %u candidates, with %u more to refine if needed",
+		 gs_app_list_length (sample),
+		 (self->spare_list != NULL) ? gs_app_list_length (self->spare_list) : 0);
+
+	refine_list (task, sample);
 }
 
 static void
@@ -414,13 +532,33 @@ refine_cb (GObject      *source_object,
 
 	new_list = gs_plugin_loader_job_process_finish (plugin_loader, result, &local_error);
 	if (new_list == NULL) {
+		g_clear_object (&self->spare_list);
+		g_clear_object (&self->kept_list);
 		gs_utils_error_convert_gio (&local_error);
 		g_task_return_error (task, g_steal_pointer (&local_error));
 		g_signal_emit_by_name (G_OBJECT (self), "completed");
 		return;
 	}
 
-	finish_task (task, new_list);
+	finish_refined_list (task, new_list);
+}
+
+static void
+finish_refined_list (GTask     *task,
+                     GsAppList *list)
+{
+	GsPluginJobListApps *self = g_task_get_source_object (task);
+	g_autoptr(GsAppList) kept_list = g_steal_pointer (&self->kept_list);
+
+	/* these have already been filtered, so filtering them again along
+	 * with the new ones is harmless, and lets the new ones be
+	 * deduplicated against them */
+	if (kept_list != NULL) {
+		gs_app_list_add_list (kept_list, list);
+		finish_task (task, kept_list);
+	} else {
+		finish_task (task, list);
+	}
 }
 
 static void
@@ -484,21 +622,35 @@ finish_task (GTask     *task,
 	if (dedupe_flags != GS_APP_LIST_FILTER_FLAG_NONE)
 		gs_app_list_filter_duplicates (merged_list, dedupe_flags);
 
+	if (self->query != NULL)
+		max_results = gs_app_query_get_max_results (self->query);
+
+	/* Too many of the sampled candidates were filtered out, so refine
+	 * some more. */
+	if (max_results > 0 && gs_app_list_length (merged_list) < max_results &&
+	    self->spare_list != NULL) {
+		g_debug ("only %u of %u results after filtering; refining more candidates",
+			 gs_app_list_length (merged_list), max_results);
+		self->kept_list = g_object_ref (merged_list);
+		refine_candidates (task);
+		return;
+	}
+
+	g_clear_object (&self->spare_list);
+
 	/* Sort the results. The refine may have added useful metadata. */
 	if (self->query != NULL)
 		sort_func = gs_app_query_get_sort_func (self->query, &sort_func_data);
 
 	if (sort_func != NULL) {
-		gs_app_list_sort (merged_list, sort_func, sort_func_data);
+		/* only the results which will be kept need sorting */
+		gs_app_list_sort_top (merged_list, sort_func, sort_func_data, max_results);
 	} else {
 		g_debug ("no ->sort_func() set, using random!");
 		gs_app_list_randomize (merged_list);
 	}
 
 	/* Truncate the results if needed. */
-	if (self->query != NULL)
-		max_results = gs_app_query_get_max_results (self->query);
-
 	if (max_results > 0 && gs_app_list_length (merged_list) > max_results) {
 		g_debug ("truncating results from %u to %u",
 			 gs_app_list_length (merged_list), max_results);
@@ -513,19 +665,18 @@ finish_task (GTask     *task,
 	g_assert (self->merged_list == NULL);
 	g_assert (self->saved_error == NULL);
 	g_assert (self->n_pending_ops == 0);
+	g_assert (self->spare_list == NULL);
+	g_assert (self->kept_list == NULL);
 
 	/* success */
 	g_set_object (&self->result_list, merged_list);
 	g_task_return_boolean (task, TRUE);
 	g_signal_emit_by_name (G_OBJECT (self), "completed");
 
-#ifdef HAVE_SYSPROF
-	sysprof_collector_mark (self->begin_time_nsec,
-				SYSPROF_CAPTURE_CURRENT_TIME - self->begin_time_nsec,
-				"gnome-software",
-				G_OBJECT_TYPE_NAME (self),
-				NULL);
-#endif
+	GS_PROFILER_ADD_MARK (PluginJobListApps,
+			      self->begin_time_nsec,
+			      G_OBJECT_TYPE_NAME (self),
+			      NULL);
 }
 
 static gboolean
@@ -60,9 +60,7 @@ struct _GsPluginJobListCategories
 	/* Results. */
 	GPtrArray *result_list;  /* (element-type GsCategory) (owned) (nullable) */
 
-#ifdef HAVE_SYSPROF
 	gint64 begin_time_nsec;
-#endif
 };
 
 G_DEFINE_TYPE (GsPluginJobListCategories, gs_plugin_job_list_categories, GS_TYPE_PLUGIN_JOB)
@@ -167,9 +165,7 @@ gs_plugin_job_list_categories_run_async (GsPluginJob         *job,
 	self->n_pending_ops = 1;
 	plugins = gs_plugin_loader_get_plugins (plugin_loader);
 
-#ifdef HAVE_SYSPROF
-	self->begin_time_nsec = SYSPROF_CAPTURE_CURRENT_TIME;
-#endif
+	self->begin_time_nsec = GS_PROFILER_CURRENT_TIME;
 
 	for (guint i = 0; i < plugins->len; i++) {
 		GsPlugin *plugin = g_ptr_array_index (plugins, i);
@@ -207,9 +203,7 @@ plugin_refine_categories_cb (GObject      *source_object,
 	GsPluginClass *plugin_class = GS_PLUGIN_GET_CLASS (plugin);
 	g_autoptr(GTask) task = G_TASK (user_data);
 	g_autoptr(GError) local_error = NULL;
-#ifdef HAVE_SYSPROF
 	GsPluginJobListCategories *self = g_task_get_source_object (task);
-#endif
 
 	GS_PROFILER_ADD_MARK_TAKE (PluginJobListCategories,
 				   self->begin_time_nsec,
@@ -298,13 +292,10 @@ finish_op (GTask  *task,
 	g_task_return_boolean (task, TRUE);
 	g_signal_emit_by_name (G_OBJECT (self), "completed");
 
-#ifdef HAVE_SYSPROF
-	sysprof_collector_mark (self->begin_time_nsec,
-				SYSPROF_CAPTURE_CURRENT_TIME - self->begin_time_nsec,
-				"gnome-software",
-				G_OBJECT_TYPE_NAME (self),
-				NULL);
-#endif
+	GS_PROFILER_ADD_MARK (PluginJobListCategories,
+			      self->begin_time_nsec,
+			      G_OBJECT_TYPE_NAME (self),
+			      NULL);
 }
 
 static gboolean
@@ -45,6 +45,21 @@
  * refer to locally cached resources, rather than HTTP/HTTPS URIs for images
  * (for example).
  *
+ * Refine jobs which overlap are coalesced: if an app in the #GsAppList is
+ * already being refined by another #GsPluginJobRefine, this job waits for
+ * that one rather than asking the plugins for the same data again, and only
+ * refines the app itself for the flags which the other job is not already
+ * refining. If the other job fails (for example, because it was cancelled),
+ * the app is refined again by this job. Lists containing wildcards are never
+ * coalesced, as refining them replaces the wildcards.
+ *
+ * Each #GsApp also records which flags it has been successfully refined with,
+ * and when (see gs_app_get_refined_flags()). Flags which an app was refined
+ * with recently, and since its state last changed, are masked out before the
+ * plugins are called, and apps with nothing left to refine are skipped. Data
+ * which can change independently of the app’s state, such as sizes and
+ * update details, is always refined again.
+ *
  * FIXME: Ideally, the #GsPluginClass.refine_async() calls would happen in
  * parallel, but this cannot be the case until the results of the refine_async()
  * call in one plugin don’t depend on the results of refine_async() in another.
@@ -96,6 +111,7 @@
 #include "gs-plugin-private.h"
 #include "gs-plugin-job-private.h"
 #include "gs-plugin-job-refine.h"
+#include "gs-metrics.h"
 #include "gs-profiler.h"
 #include "gs-utils.h"
 
@@ -110,9 +126,7 @@ struct _GsPluginJobRefine
 	/* Output data. */
 	GsAppList *result_list;  /* (owned) (nullable) */
 
-#ifdef HAVE_SYSPROF
 	gint64 begin_time_nsec;
-#endif
 };
 
 G_DEFINE_TYPE (GsPluginJobRefine, gs_plugin_job_refine, GS_TYPE_PLUGIN_JOB)
@@ -256,9 +270,7 @@ typedef struct {
 	guint next_plugin_index;
 	guint next_plugin_order;
 
-#ifdef HAVE_SYSPROF
 	gint64 plugin_begin_time_nsec;
-#endif
 
 	/* Output data. */
 	GError *error;  /* (nullable) (owned) */
@@ -305,9 +317,7 @@ run_refine_internal_async (GsPluginJobRefine   *self,
 	data->plugin_loader = g_object_ref (plugin_loader);
 	data->list = g_object_ref (list);
 	data->flags = flags;
-#ifdef HAVE_SYSPROF
-	data->plugin_begin_time_nsec = SYSPROF_CAPTURE_CURRENT_TIME;
-#endif
+	data->plugin_begin_time_nsec = GS_PROFILER_CURRENT_TIME;
 	g_task_set_task_data (task, g_steal_pointer (&data_owned), (GDestroyNotify) refine_internal_data_free);
 
 	/* try to adopt each app with a plugin */
@@ -377,10 +387,8 @@ plugin_refine_cb (GObject      *source_object,
 	g_autoptr(GTask) task = g_steal_pointer (&user_data);
 	GsPluginClass *plugin_class = GS_PLUGIN_GET_CLASS (plugin);
 	g_autoptr(GError) local_error = NULL;
-#ifdef HAVE_SYSPROF
 	GsPluginJobRefine *self = g_task_get_source_object (task);
 	RefineInternalData *data = g_task_get_task_data (task);
-#endif
 
 	GS_PROFILER_ADD_MARK_TAKE (PluginJobRefine,
 				   data->plugin_begin_time_nsec,
@@ -466,9 +474,7 @@ finish_refine_internal_op (GTask  *task,
 	g_assert (data->n_pending_ops > 0);
 	data->n_pending_ops--;
 
-#ifdef HAVE_SYSPROF
-	data->plugin_begin_time_nsec = SYSPROF_CAPTURE_CURRENT_TIME;
-#endif
+	data->plugin_begin_time_nsec = GS_PROFILER_CURRENT_TIME;
 
 	if (data->n_pending_ops > 0)
 		return;
@@ -705,6 +711,326 @@ run_refine_internal_finish (GsPluginJobRefine  *self,
 	return g_task_propagate_boolean (G_TASK (result), error);
 }
 
+/* An ongoing run of run_refine_internal_async() by a #GsPluginJobRefine,
+ * which other jobs refining the same apps can wait for.
+ *
+ * These are only accessed with inflight_refines_mutex held, apart from
+ * @apps and @flags, which are immutable. */
+typedef struct {
+	GsAppList *apps;  /* (owned) */
+	GsPluginRefineFlags flags;
+	GPtrArray *waiters;  /* (owned) (element-type GTask) */
+} InflightRefine;
+
+/* flags which change how a refine is done, rather than what it refines */
+#define REFINE_MODIFIER_FLAGS (GS_PLUGIN_REFINE_FLAGS_ALLOW_PACKAGES | \
+			       GS_PLUGIN_REFINE_FLAGS_DISABLE_FILTERING)
+
+/* flags for data which can go stale without the app changing state, so are
+ * always refined again */
+#define REFINE_VOLATILE_FLAGS (GS_PLUGIN_REFINE_FLAGS_REQUIRE_SIZE | \
+			       GS_PLUGIN_REFINE_FLAGS_REQUIRE_SIZE_DATA | \
+			       GS_PLUGIN_REFINE_FLAGS_REQUIRE_UPDATE_DETAILS | \
+			       GS_PLUGIN_REFINE_FLAGS_REQUIRE_UPDATE_SEVERITY | \
+			       GS_PLUGIN_REFINE_FLAGS_REQUIRE_UPGRADE_REMOVED | \
+			       GS_PLUGIN_REFINE_FLAGS_REQUIRE_RATING | \
+			       GS_PLUGIN_REFINE_FLAGS_REQUIRE_REVIEWS | \
+			       GS_PLUGIN_REFINE_FLAGS_REQUIRE_REVIEW_RATINGS)
+
+/* how long the flags an app has been refined with stay fresh */
+#define REFINED_FLAGS_MAX_AGE_USEC (10 * 60 * G_USEC_PER_SEC)
+
+static GMutex inflight_refines_mutex;
+static GHashTable *inflight_refines = NULL;  /* (mutex inflight_refines_mutex) (owned) (nullable): GsApp * ~> GPtrArray<InflightRefine *> */
+
+typedef struct {
+	GsPluginLoader *plugin_loader;  /* (owned) */
+	GsAppList *result_list;  /* (owned) */
+
+	InflightRefine *inflight;  /* (owned) (nullable) */
+	GPtrArray *waiting_on;  /* (mutex inflight_refines_mutex) (owned) (element-type InflightRefine) (unowned) */
+	GSource *cancel_source;  /* (owned) (nullable) */
+	gint64 refine_time;  /* monotonic */
+	guint n_pending_ops;
+	gboolean needs_retry;
+	gboolean retried;
+
+	GError *error;  /* (owned) (nullable) */
+} RunData;
+
+static void
+inflight_refine_free (InflightRefine *inflight)
+{
+	g_assert (inflight->waiters->len == 0);
+
+	g_object_unref (inflight->apps);
+	g_ptr_array_unref (inflight->waiters);
+	g_free (inflight);
+}
+
+static void
+run_data_free (RunData *data)
+{
+	g_assert (data->inflight == NULL);
+	g_assert (data->waiting_on == NULL || data->waiting_on->len == 0);
+
+	if (data->cancel_source != NULL) {
+		g_source_destroy (data->cancel_source);
+		g_clear_pointer (&data->cancel_source, g_source_unref);
+	}
+	g_clear_pointer (&data->waiting_on, g_ptr_array_unref);
+	g_clear_object (&data->plugin_loader);
+	g_clear_object (&data->result_list);
+	g_clear_error (&data->error);
+	g_free (data);
+}
+
+/* must be called with inflight_refines_mutex held */
+static void
+inflight_refines_add (InflightRefine *inflight)
+{
+	if (inflight_refines == NULL)
+		inflight_refines = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+							  NULL, (GDestroyNotify) g_ptr_array_unref);
+
+	for (guint i = 0; i < gs_app_list_length (inflight->apps); i++) {
+		GsApp *app = gs_app_list_index (inflight->apps, i);
+		GPtrArray *refines = g_hash_table_lookup (inflight_refines, app);
+
+		if (refines == NULL) {
+			refines = g_ptr_array_new ();
+			g_hash_table_insert (inflight_refines, app, refines);
+		}
+		g_ptr_array_add (refines, inflight);
+	}
+}
+
+/* must be called with inflight_refines_mutex held */
+static void
+inflight_refines_remove (InflightRefine *inflight)
+{
+	for (guint i = 0; i < gs_app_list_length (inflight->apps); i++) {
+		GsApp *app = gs_app_list_index (inflight->apps, i);
+		GPtrArray *refines = g_hash_table_lookup (inflight_refines, app);
+
+		g_ptr_array_remove_fast (refines, inflight);
+		if (refines->len == 0)
+			g_hash_table_remove (inflight_refines, app);
+	}
+}
+
+typedef struct {
+	GTask *task;  /* (owned) */
+	gboolean succeeded;
+} InflightWaiter;
+
+static void
+inflight_waiter_free (InflightWaiter *waiter)
+{
+	g_object_unref (waiter->task);
+	g_free (waiter);
+}
+
+static void finish_run_op (GTask *task);
+
+static gboolean
+inflight_refine_done_cb (gpointer user_data)
+{
+	InflightWaiter *waiter = user_data;
+	RunData *data = g_task_get_task_data (waiter->task);
+
+	/* the other job didn’t refine the apps we were waiting for, so do it
+	 * ourselves once everything else is done */
+	if (!waiter->succeeded)
+		data->needs_retry = TRUE;
+
+	finish_run_op (waiter->task);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Remove @inflight from the set of ongoing refines and tell all the jobs
+ * waiting on it whether it succeeded. */
+static void
+inflight_refine_complete (InflightRefine *inflight,
+			  gboolean        succeeded)
+{
+	g_autoptr(GPtrArray) waiters = NULL;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&inflight_refines_mutex);
+
+	inflight_refines_remove (inflight);
+	waiters = g_steal_pointer (&inflight->waiters);
+	inflight->waiters = g_ptr_array_new ();
+	for (guint i = 0; i < waiters->len; i++) {
+		RunData *waiter_data = g_task_get_task_data (g_ptr_array_index (waiters, i));
+		g_ptr_array_remove_fast (waiter_data->waiting_on, inflight);
+	}
+	g_clear_pointer (&locker, g_mutex_locker_free);
+
+	for (guint i = 0; i < waiters->len; i++) {
+		GTask *waiter_task = g_ptr_array_index (waiters, i);
+		g_autoptr(GSource) source = g_idle_source_new ();
+		InflightWaiter *waiter = g_new0 (InflightWaiter, 1);
+
+		waiter->task = g_object_ref (waiter_task);
+		waiter->succeeded = succeeded;
+
+		/* the waiting job may be running in another thread */
+		g_source_set_callback (source, inflight_refine_done_cb,
+				       waiter, (GDestroyNotify) inflight_waiter_free);
+		g_source_set_static_name (source, "gs-plugin-job-refine-coalesced");
+		g_source_attach (source, g_task_get_context (waiter_task));
+	}
+
+	inflight_refine_free (inflight);
+}
+
+/* The job was cancelled while waiting on other jobs’ refines, so stop waiting
+ * for them, rather than for whichever of them is slowest. Any refine of this
+ * job’s own is cancelled too, and finishes by itself. */
+static gboolean
+waiter_cancelled_cb (GCancellable *cancellable,
+		     gpointer      user_data)
+{
+	/* the waits hold references to @task, which may be the last ones */
+	g_autoptr(GTask) task = g_object_ref (G_TASK (user_data));
+	RunData *data = g_task_get_task_data (task);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&inflight_refines_mutex);
+	guint n_stopped = 0;
+
+	for (guint i = 0; i < data->waiting_on->len; i++) {
+		InflightRefine *inflight = g_ptr_array_index (data->waiting_on, i);
+		g_ptr_array_remove_fast (inflight->waiters, task);
+		n_stopped++;
+	}
+	g_ptr_array_set_size (data->waiting_on, 0);
+	g_clear_pointer (&locker, g_mutex_locker_free);
+
+	g_clear_pointer (&data->cancel_source, g_source_unref);
+
+	if (n_stopped == 0)
+		return G_SOURCE_REMOVE;
+
+	if (data->error == NULL)
+		g_cancellable_set_error_if_cancelled (cancellable, &data->error);
+
+	for (guint i = 0; i < n_stopped; i++)
+		finish_run_op (task);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Work out which apps in @list need refining by this job, and with which
+ * flags, given what they have already been refined with and the refines
+ * already in flight, and start waiting for the ones which cover the rest.
+ * If this returns %NULL, the whole of @list needs refining with @flags. */
+static GsAppList *
+coalesce_refine (GTask               *task,
+		 GsAppList           *list,
+		 GsPluginRefineFlags  flags,
+		 GsPluginRefineFlags *out_flags)
+{
+	RunData *data = g_task_get_task_data (task);
+	g_autoptr(GsAppList) own_list = gs_app_list_new ();
+	g_autoptr(GPtrArray) waiting_on = g_ptr_array_new ();
+	g_autoptr(GMutexLocker) locker = NULL;
+	GsPluginRefineFlags own_flags = 0;
+	guint n_coalesced = 0;
+	guint n_satisfied = 0;
+
+	if ((flags & ~REFINE_MODIFIER_FLAGS) == 0)
+		return NULL;
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		if (gs_app_has_quirk (gs_app_list_index (list, i), GS_APP_QUIRK_IS_WILDCARD))
+			return NULL;
+	}
+
+	locker = g_mutex_locker_new (&inflight_refines_mutex);
+
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		GsApp *app = gs_app_list_index (list, i);
+		GPtrArray *refines = (inflight_refines != NULL) ? g_hash_table_lookup (inflight_refines, app) : NULL;
+		GsPluginRefineFlags missing = flags & ~REFINE_MODIFIER_FLAGS;
+		gboolean covered = FALSE;
+
+		missing &= ~gs_app_get_refined_flags (app, REFINED_FLAGS_MAX_AGE_USEC);
+		if (missing == 0) {
+			n_satisfied++;
+			continue;
+		}
+
+		for (guint j = 0; refines != NULL && j < refines->len; j++) {
+			InflightRefine *inflight = g_ptr_array_index (refines, j);
+
+			/* this affects what plugins return, so can’t be mixed */
+			if ((inflight->flags & GS_PLUGIN_REFINE_FLAGS_ALLOW_PACKAGES) !=
+			    (flags & GS_PLUGIN_REFINE_FLAGS_ALLOW_PACKAGES))
+				continue;
+			if ((missing & inflight->flags) == 0)
+				continue;
+
+			missing &= ~inflight->flags;
+			covered = TRUE;
+			if (!g_ptr_array_find (waiting_on, inflight, NULL))
+				g_ptr_array_add (waiting_on, inflight);
+		}
+
+		if (missing != 0) {
+			gs_app_list_add (own_list, app);
+			own_flags |= missing;
+		}
+		if (covered)
+			n_coalesced++;
+	}
+
+	/* refine anything which isn’t already being refined, and let other
+	 * jobs wait for that */
+	if (gs_app_list_length (own_list) > 0) {
+		own_flags |= flags & REFINE_MODIFIER_FLAGS;
+
+		data->inflight = g_new0 (InflightRefine, 1);
+		data->inflight->apps = g_object_ref (own_list);
+		data->inflight->flags = own_flags;
+		data->inflight->waiters = g_ptr_array_new_with_free_func (g_object_unref);
+		inflight_refines_add (data->inflight);
+	}
+
+	for (guint i = 0; i < waiting_on->len; i++) {
+		InflightRefine *inflight = g_ptr_array_index (waiting_on, i);
+		g_ptr_array_add (inflight->waiters, g_object_ref (task));
+		data->n_pending_ops++;
+	}
+
+	/* stop waiting on other jobs’ refines straight away if this job is
+	 * cancelled, as they may not be */
+	if (waiting_on->len > 0) {
+		data->waiting_on = g_ptr_array_ref (waiting_on);
+
+		if (g_task_get_cancellable (task) != NULL) {
+			data->cancel_source = g_cancellable_source_new (g_task_get_cancellable (task));
+			g_source_set_callback (data->cancel_source, G_SOURCE_FUNC (waiter_cancelled_cb),
+					       task, NULL);
+			g_source_set_static_name (data->cancel_source, "gs-plugin-job-refine-cancelled");
+			g_source_attach (data->cancel_source, g_task_get_context (task));
+		}
+	}
+
+	if (waiting_on->len == 0 && own_flags == flags &&
+	    gs_app_list_length (own_list) == gs_app_list_length (list))
+		return NULL;
+
+	g_debug ("%u of %u apps already refined; waiting on %u ongoing refines, which cover %u apps at least partly; refining %u apps",
+		 n_satisfied, gs_app_list_length (list), waiting_on->len,
+		 n_coalesced, gs_app_list_length (own_list));
+	if (n_satisfied > 0)
+		gs_metrics_increment_counter ("refine-satisfied-apps", n_satisfied);
+	if (n_coalesced > 0)
+		gs_metrics_increment_counter ("refine-coalesced-apps", n_coalesced);
+
+	*out_flags = own_flags;
+	return g_steal_pointer (&own_list);
+}
+
 static gboolean
 app_thaw_notify_idle (gpointer data)
 {
@@ -729,7 +1055,9 @@ gs_plugin_job_refine_run_async (GsPluginJob         *job,
 {
 	GsPluginJobRefine *self = GS_PLUGIN_JOB_REFINE (job);
 	g_autoptr(GTask) task = NULL;
-	g_autoptr(GsAppList) result_list = NULL;
+	RunData *data;
+	g_autoptr(GsAppList) own_list = NULL;
+	GsPluginRefineFlags own_flags = self->flags;
 
 	/* check required args */
 	task = g_task_new (job, cancellable, callback, user_data);
@@ -737,14 +1065,16 @@ gs_plugin_job_refine_run_async (GsPluginJob         *job,
 
 	/* Operate on a copy of the input list so we don’t modify it when
 	 * resolving wildcards. */
-	result_list = gs_app_list_copy (self->app_list);
-	g_task_set_task_data (task, g_object_ref (result_list), (GDestroyNotify) g_object_unref);
+	data = g_new0 (RunData, 1);
+	data->plugin_loader = g_object_ref (plugin_loader);
+	data->result_list = gs_app_list_copy (self->app_list);
+	g_task_set_task_data (task, data, (GDestroyNotify) run_data_free);
 
 	/* nothing to do */
 	if (self->flags == 0 ||
-	    gs_app_list_length (result_list) == 0) {
+	    gs_app_list_length (data->result_list) == 0) {
 		g_debug ("no refine flags set for transaction or app list is empty");
-		finish_run (task, result_list);
+		finish_run (task, data->result_list);
 		return;
 	}
 
@@ -754,14 +1084,22 @@ gs_plugin_job_refine_run_async (GsPluginJob         *job,
 		g_object_freeze_notify (G_OBJECT (app));
 	}
 
-#ifdef HAVE_SYSPROF
-	self->begin_time_nsec = SYSPROF_CAPTURE_CURRENT_TIME;
-#endif
+	self->begin_time_nsec = GS_PROFILER_CURRENT_TIME;
+	data->refine_time = g_get_monotonic_time ();
 
-	/* Start refining the apps. */
-	run_refine_internal_async (self, plugin_loader, result_list,
-				   self->flags, cancellable,
-				   run_cb, g_steal_pointer (&task));
+	/* Start refining the apps, or whichever of them are not already
+	 * refined or being refined by another job. */
+	own_list = coalesce_refine (task, data->result_list, self->flags, &own_flags);
+	if (own_list == NULL)
+		own_list = g_object_ref (data->result_list);
+
+	data->n_pending_ops++;
+	if (gs_app_list_length (own_list) > 0)
+		run_refine_internal_async (self, plugin_loader, own_list,
+					   own_flags, cancellable,
+					   run_cb, g_object_ref (task));
+	else
+		finish_run_op (task);
 }
 
 static void
@@ -771,10 +1109,62 @@ run_cb (GObject      *source_object,
 {
 	GsPluginJobRefine *self = GS_PLUGIN_JOB_REFINE (source_object);
 	g_autoptr(GTask) task = g_steal_pointer (&user_data);
-	GsAppList *result_list = g_task_get_task_data (task);
+	RunData *data = g_task_get_task_data (task);
+	g_autoptr(GError) local_error = NULL;
+	gboolean succeeded;
+
+	succeeded = run_refine_internal_finish (self, result, &local_error);
+
+	if (data->inflight != NULL) {
+		/* remember what the apps have been refined with before any
+		 * waiting jobs look at them again */
+		if (succeeded) {
+			for (guint i = 0; i < gs_app_list_length (data->inflight->apps); i++) {
+				GsApp *app = gs_app_list_index (data->inflight->apps, i);
+				gs_app_add_refined_flags (app,
+							  data->inflight->flags & ~REFINE_VOLATILE_FLAGS,
+							  data->refine_time);
+			}
+		}
+
+		inflight_refine_complete (g_steal_pointer (&data->inflight), succeeded);
+	}
+
+	if (!succeeded && data->error == NULL)
+		data->error = g_steal_pointer (&local_error);
+
+	finish_run_op (task);
+}
+
+static void
+finish_run_op (GTask *task)
+{
+	GsPluginJobRefine *self = g_task_get_source_object (task);
+	RunData *data = g_task_get_task_data (task);
+	GsAppList *result_list = data->result_list;
 	g_autoptr(GError) local_error = NULL;
 
-	if (run_refine_internal_finish (self, result, &local_error)) {
+	g_assert (data->n_pending_ops > 0);
+	data->n_pending_ops--;
+
+	if (data->n_pending_ops > 0)
+		return;
+
+	/* A refine this job was waiting on failed, so refine the apps again,
+	 * this time without waiting on anything else. */
+	if (data->needs_retry && !data->retried && data->error == NULL) {
+		g_debug ("coalesced refine failed; refining again");
+		data->retried = TRUE;
+		data->n_pending_ops++;
+		run_refine_internal_async (self, data->plugin_loader, result_list,
+					   self->flags, g_task_get_cancellable (task),
+					   run_cb, g_object_ref (task));
+		return;
+	}
+
+	local_error = g_steal_pointer (&data->error);
+
+	if (local_error == NULL) {
 		/* remove any addons that have the same source as the parent app */
 		for (guint i = 0; i < gs_app_list_length (result_list); i++) {
 			g_autoptr(GPtrArray) to_remove = g_ptr_array_new ();
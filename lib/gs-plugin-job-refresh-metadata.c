@@ -83,9 +83,7 @@ struct _GsPluginJobRefreshMetadata
 	GSource *progress_source;  /* (owned) (nullable) */
 	guint last_reported_progress;
 
-#ifdef HAVE_SYSPROF
 	gint64 begin_time_nsec;
-#endif
 };
 
 G_DEFINE_TYPE (GsPluginJobRefreshMetadata, gs_plugin_job_refresh_metadata, GS_TYPE_PLUGIN_JOB)
@@ -237,9 +235,7 @@ gs_plugin_job_refresh_metadata_run_async (GsPluginJob         *job,
 	}
 #endif
 
-#ifdef HAVE_SYSPROF
-	self->begin_time_nsec = SYSPROF_CAPTURE_CURRENT_TIME;
-#endif
+	self->begin_time_nsec = GS_PROFILER_CURRENT_TIME;
 
 	for (guint i = 0; i < plugins->len; i++) {
 		GsPlugin *plugin = g_ptr_array_index (plugins, i);
@@ -382,9 +378,7 @@ odrs_provider_refresh_ratings_cb (GObject      *source_object,
 	GsOdrsProvider *odrs_provider = GS_ODRS_PROVIDER (source_object);
 	g_autoptr(GTask) task = G_TASK (user_data);
 	g_autoptr(GError) local_error = NULL;
-#ifdef HAVE_SYSPROF
 	GsPluginJobRefreshMetadata *self = g_task_get_source_object (task);
-#endif
 
 	if (!gs_odrs_provider_refresh_ratings_finish (odrs_provider, result, &local_error))
 		g_debug ("Failed to refresh ratings: %s", local_error->message);
@@ -576,3 +570,20 @@ gs_plugin_job_refresh_metadata_new (guint64                      cache_age_secs,
 			     "flags", flags,
 			     NULL);
 }
+
+/**
+ * gs_plugin_job_refresh_metadata_get_flags:
+ * @self: a #GsPluginJobRefreshMetadata
+ *
+ * Get the flags affecting the behaviour of this #GsPluginJobRefreshMetadata.
+ *
+ * Returns: flags for the job
+ * Since: 48
+ */
+GsPluginRefreshMetadataFlags
+gs_plugin_job_refresh_metadata_get_flags (GsPluginJobRefreshMetadata *self)
+{
+	g_return_val_if_fail (GS_IS_PLUGIN_JOB_REFRESH_METADATA (self), GS_PLUGIN_REFRESH_METADATA_FLAGS_NONE);
+
+	return self->flags;
+}
@@ -25,4 +25,6 @@ G_DECLARE_FINAL_TYPE (GsPluginJobRefreshMetadata, gs_plugin_job_refresh_metadata
 GsPluginJob	*gs_plugin_job_refresh_metadata_new	(guint64                      cache_age_secs,
 							 GsPluginRefreshMetadataFlags flags);
 
+GsPluginRefreshMetadataFlags	 gs_plugin_job_refresh_metadata_get_flags	(GsPluginJobRefreshMetadata	*self);
+
 G_END_DECLS
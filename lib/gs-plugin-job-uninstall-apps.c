@@ -72,9 +72,7 @@ struct _GsPluginJobUninstallApps
 	GSource *progress_source;  /* (owned) (nullable) */
 	guint last_reported_progress;
 
-#ifdef HAVE_SYSPROF
 	gint64 begin_time_nsec;
-#endif
 };
 
 G_DEFINE_TYPE (GsPluginJobUninstallApps, gs_plugin_job_uninstall_apps, GS_TYPE_PLUGIN_JOB)
@@ -221,9 +219,7 @@ gs_plugin_job_uninstall_apps_run_async (GsPluginJob         *job,
 	self->n_pending_ops = 1;
 	plugins = gs_plugin_loader_get_plugins (plugin_loader);
 
-#ifdef HAVE_SYSPROF
-	self->begin_time_nsec = SYSPROF_CAPTURE_CURRENT_TIME;
-#endif
+	self->begin_time_nsec = GS_PROFILER_CURRENT_TIME;
 
 	for (guint i = 0; i < plugins->len; i++) {
 		GsPlugin *plugin = g_ptr_array_index (plugins, i);
@@ -26,6 +26,7 @@
 #include "gs-category-private.h"
 #include "gs-external-appstream-utils.h"
 #include "gs-ioprio.h"
+#include "gs-job-scheduler.h"
 #include "gs-os-release.h"
 #include "gs-plugin-loader.h"
 #include "gs-plugin.h"
@@ -58,7 +59,7 @@ struct _GsPluginLoader
 	GsAppList		*pending_apps;		/* (nullable) (owned) */
 	GCancellable		*pending_apps_cancellable;  /* (nullable) (owned) */
 
-	GThreadPool		*queued_ops_pool;
+	GsJobScheduler		*job_scheduler;  /* (owned) (not nullable) */
 	gint			 active_jobs;
 
 	GSettings		*settings;
@@ -92,7 +93,6 @@ struct _GsPluginLoader
 static void gs_plugin_loader_monitor_network (GsPluginLoader *plugin_loader);
 static void add_app_to_install_queue (GsPluginLoader *plugin_loader, GsApp *app);
 static gboolean remove_apps_from_install_queue (GsPluginLoader *plugin_loader, GsAppList *apps);
-static void gs_plugin_loader_process_in_thread_pool_cb (gpointer data, gpointer user_data);
 static void gs_plugin_loader_status_changed_cb (GsPlugin       *plugin,
                                                 GsApp          *app,
                                                 GsPluginStatus  status,
@@ -102,6 +102,7 @@ static void async_result_cb (GObject      *source_object,
                              gpointer      user_data);
 static void gs_plugin_loader_process_old_api_job_cb (gpointer task_data,
                                                      gpointer user_data);
+static GsJobLane get_job_lane (GsPluginJob *plugin_job);
 
 G_DEFINE_TYPE (GsPluginLoader, gs_plugin_loader, G_TYPE_OBJECT)
 
@@ -538,12 +539,11 @@ gs_plugin_loader_call_vfunc (GsPluginLoaderHelper *helper,
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GTimer) timer = g_timer_new ();
 	g_autofree gchar *sysprof_name = NULL;
-	g_autofree gchar *sysprof_message = NULL;
 
 	sysprof_name = g_strconcat ("vfunc:", gs_plugin_action_to_string (action), NULL);
-	sysprof_message = gs_plugin_job_to_string (helper->plugin_job);
 
-	GS_PROFILER_BEGIN_SCOPED (PluginLoader, sysprof_name, sysprof_message);
+	GS_PROFILER_BEGIN_SCOPED_TAKE (PluginLoader, g_strdup (sysprof_name),
+				       gs_plugin_job_to_string (helper->plugin_job));
 
 	/* load the possible symbol */
 	func = gs_plugin_get_symbol (plugin, helper->function_name);
@@ -651,14 +651,13 @@ gs_plugin_loader_run_results (GsPluginLoaderHelper *helper,
 {
 	GsPluginLoader *plugin_loader = helper->plugin_loader;
 	g_autofree gchar *sysprof_name = NULL;
-	g_autofree gchar *sysprof_message = NULL;
 
 	sysprof_name = g_strconcat ("run-results:",
 				    gs_plugin_action_to_string (gs_plugin_job_get_action (helper->plugin_job)),
 				    NULL);
-	sysprof_message = gs_plugin_job_to_string (helper->plugin_job);
 
-	GS_PROFILER_BEGIN_SCOPED (PluginLoader, sysprof_name, sysprof_message);
+	GS_PROFILER_BEGIN_SCOPED_TAKE (PluginLoader, g_strdup (sysprof_name),
+				       gs_plugin_job_to_string (helper->plugin_job));
 
 	/* Refining is done separately as it’s a special action */
 	g_assert (!GS_IS_PLUGIN_JOB_REFINE (helper->plugin_job));
@@ -1486,6 +1485,9 @@ static void
 gs_plugin_loader_reload_cb (GsPlugin *in_plugin,
 			    GsPluginLoader *plugin_loader)
 {
+	/* the metadata has changed, so previous refines may be stale */
+	gs_app_invalidate_all_refined_flags ();
+
 	if (plugin_loader->reload_id != 0)
 		return;
 	/* Let also the plugins know that the reload had been initiated;
@@ -1801,10 +1803,8 @@ typedef struct {
 	guint n_pending;
 	gchar **allowlist;
 	gchar **blocklist;
-#ifdef HAVE_SYSPROF
 	gint64 setup_begin_time_nsec;
 	gint64 plugins_begin_time_nsec;
-#endif
 } SetupData;
 
 static void
@@ -1867,9 +1867,7 @@ gs_plugin_loader_setup_async (GsPluginLoader      *plugin_loader,
 	SetupData *setup_data;
 	g_autoptr(SetupData) setup_data_owned = NULL;
 	g_autoptr(GTask) task = NULL;
-#ifdef HAVE_SYSPROF
-	gint64 begin_time_nsec G_GNUC_UNUSED = SYSPROF_CAPTURE_CURRENT_TIME;
-#endif
+	gint64 begin_time_nsec = GS_PROFILER_CURRENT_TIME;
 
 	task = g_task_new (plugin_loader, cancellable, callback, user_data);
 	g_task_set_source_tag (task, gs_plugin_loader_setup_async);
@@ -1884,9 +1882,7 @@ gs_plugin_loader_setup_async (GsPluginLoader      *plugin_loader,
 	setup_data = setup_data_owned = g_new0 (SetupData, 1);
 	setup_data->allowlist = g_strdupv ((gchar **) allowlist);
 	setup_data->blocklist = g_strdupv ((gchar **) blocklist);
-#ifdef HAVE_SYSPROF
 	setup_data->setup_begin_time_nsec = begin_time_nsec;
-#endif
 
 	g_task_set_task_data (task, g_steal_pointer (&setup_data_owned), (GDestroyNotify) setup_data_free);
 
@@ -2170,9 +2166,7 @@ finish_setup_get_bus (GTask *task)
 
 	/* run setup */
 	data->n_pending = 1;  /* incremented until all operations have been started */
-#ifdef HAVE_SYSPROF
-	data->plugins_begin_time_nsec = SYSPROF_CAPTURE_CURRENT_TIME;
-#endif
+	data->plugins_begin_time_nsec = GS_PROFILER_CURRENT_TIME;
 
 	for (i = 0; i < plugin_loader->plugins->len; i++) {
 		plugin = GS_PLUGIN (plugin_loader->plugins->pdata[i]);
@@ -2198,9 +2192,7 @@ plugin_setup_cb (GObject      *source_object,
 	GsPlugin *plugin = GS_PLUGIN (source_object);
 	g_autoptr(GTask) task = g_steal_pointer (&user_data);
 	g_autoptr(GError) local_error = NULL;
-#ifdef HAVE_SYSPROF
 	SetupData *data = g_task_get_task_data (task);
-#endif
 
 	g_assert (GS_PLUGIN_GET_CLASS (plugin)->setup_finish != NULL);
 
@@ -2463,12 +2455,11 @@ gs_plugin_loader_dispose (GObject *object)
 					     plugin_loader->network_metered_notify_handler);
 		plugin_loader->network_metered_notify_handler = 0;
 	}
-	if (plugin_loader->queued_ops_pool != NULL) {
-		/* stop accepting more requests and wait until any currently
-		 * running ones are finished */
-		g_thread_pool_free (plugin_loader->queued_ops_pool, TRUE, TRUE);
-		plugin_loader->queued_ops_pool = NULL;
-	}
+	/* queued jobs hold a reference to the scheduler, so it would never be
+	 * disposed of while any are left */
+	if (plugin_loader->job_scheduler != NULL)
+		gs_job_scheduler_shutdown (plugin_loader->job_scheduler);
+	g_clear_object (&plugin_loader->job_scheduler);
 	g_clear_object (&plugin_loader->network_monitor);
 	g_clear_object (&plugin_loader->power_profile_monitor);
 	g_clear_object (&plugin_loader->settings);
@@ -2683,11 +2674,10 @@ gs_plugin_loader_init (GsPluginLoader *plugin_loader)
 	plugin_loader->scale = 1;
 	plugin_loader->plugins = g_ptr_array_new_with_free_func (g_object_unref);
 	plugin_loader->pending_apps = NULL;
-	plugin_loader->queued_ops_pool = g_thread_pool_new (gs_plugin_loader_process_in_thread_pool_cb,
-						   plugin_loader,
-						   get_max_parallel_ops (),
-						   FALSE,
-						   NULL);
+	plugin_loader->job_scheduler = gs_job_scheduler_new ();
+	gs_job_scheduler_set_max_running (plugin_loader->job_scheduler,
+					  GS_JOB_LANE_USER,
+					  get_max_parallel_ops ());
 	plugin_loader->file_monitors = g_ptr_array_new_with_free_func (g_object_unref);
 	plugin_loader->locations = g_ptr_array_new_with_free_func (g_free);
 	plugin_loader->settings = g_settings_new ("org.gnome.software");
@@ -3118,13 +3108,17 @@ gs_plugin_loader_process_old_api_job_cb (gpointer task_data,
 	g_autoptr(GMainContext) context = g_main_context_new ();
 	g_autoptr(GMainContextPusher) pusher = g_main_context_pusher_new (context);
 	g_autofree gchar *sysprof_name = NULL;
-	g_autofree gchar *sysprof_message = NULL;
 	g_autofree gchar *job_debug = NULL;
 
+	/* Jobs in the user and background lanes shouldn’t slow down the I/O
+	 * of interactive ones. The pool’s threads are shared between lanes,
+	 * so the priority is set again for every job. */
+	gs_ioprio_set ((get_job_lane (helper->plugin_job) == GS_JOB_LANE_INTERACTIVE) ? G_PRIORITY_DEFAULT : G_PRIORITY_LOW);
+
 	sysprof_name = g_strconcat ("process-thread:", gs_plugin_action_to_string (action), NULL);
-	sysprof_message = gs_plugin_job_to_string (helper->plugin_job);
 
-	GS_PROFILER_BEGIN_SCOPED (PluginLoader, sysprof_name, sysprof_message);
+	GS_PROFILER_BEGIN_SCOPED_TAKE (PluginLoader, g_strdup (sysprof_name),
+				       gs_plugin_job_to_string (helper->plugin_job));
 
 	/* run each plugin */
 	if (!GS_IS_PLUGIN_JOB_REFINE (helper->plugin_job)) {
@@ -3196,25 +3190,131 @@ gs_plugin_loader_process_old_api_job_cb (gpointer task_data,
 	gs_job_manager_remove_job (plugin_loader->job_manager, helper->plugin_job);
 }
 
+/* Which lane of the #GsJobScheduler to run @plugin_job in. Anything which
+ * might be run as a nested job of another must stay in the interactive lane,
+ * which is unlimited, otherwise the parent job could hold the slot its child
+ * is waiting for. */
+static GsJobLane
+get_job_lane (GsPluginJob *plugin_job)
+{
+	if (GS_IS_PLUGIN_JOB_REFRESH_METADATA (plugin_job)) {
+		GsPluginRefreshMetadataFlags flags = gs_plugin_job_refresh_metadata_get_flags (GS_PLUGIN_JOB_REFRESH_METADATA (plugin_job));
+		return (flags & GS_PLUGIN_REFRESH_METADATA_FLAGS_INTERACTIVE) ? GS_JOB_LANE_USER : GS_JOB_LANE_BACKGROUND;
+	}
+	if (GS_IS_PLUGIN_JOB_UPDATE_APPS (plugin_job)) {
+		GsPluginUpdateAppsFlags flags = gs_plugin_job_update_apps_get_flags (GS_PLUGIN_JOB_UPDATE_APPS (plugin_job));
+		return (flags & GS_PLUGIN_UPDATE_APPS_FLAGS_INTERACTIVE) ? GS_JOB_LANE_USER : GS_JOB_LANE_BACKGROUND;
+	}
+	if (GS_IS_PLUGIN_JOB_INSTALL_APPS (plugin_job) ||
+	    GS_IS_PLUGIN_JOB_UNINSTALL_APPS (plugin_job) ||
+	    GS_IS_PLUGIN_JOB_DOWNLOAD_UPGRADE (plugin_job) ||
+	    GS_IS_PLUGIN_JOB_MANAGE_REPOSITORY (plugin_job) ||
+	    gs_plugin_job_get_action (plugin_job) == GS_PLUGIN_ACTION_UPGRADE_DOWNLOAD)
+		return GS_JOB_LANE_USER;
+
+	return GS_JOB_LANE_INTERACTIVE;
+}
+
+typedef struct {
+	GsJobScheduler *job_scheduler;  /* (owned) */
+	GsJobLane lane;
+	gboolean dropped;  /* dropped by the scheduler before it started */
+	GsApp *app;  /* (owned) (nullable) */
+	GsPluginAction action;
+} ScheduledJobData;
+
 static void
-gs_plugin_loader_process_in_thread_pool_cb (gpointer data,
-					    gpointer user_data)
+scheduled_job_data_free (gpointer data,
+			 GClosure *closure)
 {
-	GTask *task = data;
-	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (user_data);
-	GsPluginLoaderHelper *helper = g_task_get_task_data (task);
-	GsApp *app = gs_plugin_job_get_app (helper->plugin_job);
-	GsPluginAction action = gs_plugin_job_get_action (helper->plugin_job);
+	ScheduledJobData *scheduled = data;
 
-	gs_ioprio_set (G_PRIORITY_LOW);
+	g_object_unref (scheduled->job_scheduler);
+	g_clear_object (&scheduled->app);
+	g_free (scheduled);
+}
 
-	gs_plugin_loader_process_old_api_job_cb (g_object_ref (task), plugin_loader);
+static void
+scheduled_job_completed_cb (GObject    *object,
+			    GParamSpec *pspec,
+			    gpointer    user_data)
+{
+	ScheduledJobData *scheduled = user_data;
 
 	/* Clear any pending action set in gs_plugin_loader_schedule_task() */
-	if (app != NULL && gs_app_get_pending_action (app) == action)
-		gs_app_set_pending_action (app, GS_PLUGIN_ACTION_UNKNOWN);
+	if (scheduled->app != NULL && gs_app_get_pending_action (scheduled->app) == scheduled->action)
+		gs_app_set_pending_action (scheduled->app, GS_PLUGIN_ACTION_UNKNOWN);
+
+	if (!scheduled->dropped)
+		gs_job_scheduler_release (scheduled->job_scheduler, scheduled->lane);
+}
 
-	g_object_unref (task);
+typedef struct {
+	GTask *task;  /* (owned) */
+	GSourceFunc start_func;
+	ScheduledJobData *scheduled;  /* (unowned), lives as long as @task */
+} ScheduledJobStart;
+
+static void
+scheduled_job_start_free (ScheduledJobStart *start)
+{
+	g_object_unref (start->task);
+	g_free (start);
+}
+
+static void
+scheduled_job_start_cb (gpointer      user_data,
+			const GError *error)
+{
+	ScheduledJobStart *start = user_data;
+	g_autoptr(GSource) source = NULL;
+
+	/* the job never took a slot, so there is nothing to release */
+	if (error != NULL) {
+		start->scheduled->dropped = TRUE;
+		g_task_return_error (start->task, g_error_copy (error));
+		return;
+	}
+
+	source = g_idle_source_new ();
+
+	/* this may be called in any thread, so start the job in the task’s
+	 * context, as it would have been if it had not been queued */
+	g_task_attach_source (start->task, source, start->start_func);
+}
+
+/* Returns %TRUE if the job in @task may start now, or %FALSE if it has been
+ * queued, in which case @start_func will be called in the task’s context once
+ * it may start. The slot in the scheduler is released once @task completes. */
+static gboolean
+gs_plugin_loader_schedule_job (GsPluginLoader *plugin_loader,
+			       GTask          *task,
+			       GsPluginJob    *plugin_job,
+			       GSourceFunc     start_func)
+{
+	ScheduledJobData *scheduled;
+	ScheduledJobStart *start;
+	GsJobLane lane = get_job_lane (plugin_job);
+
+	scheduled = g_new0 (ScheduledJobData, 1);
+	scheduled->job_scheduler = g_object_ref (plugin_loader->job_scheduler);
+	scheduled->lane = lane;
+	if (gs_plugin_job_get_app (plugin_job) != NULL) {
+		scheduled->app = g_object_ref (gs_plugin_job_get_app (plugin_job));
+		scheduled->action = gs_plugin_job_get_action (plugin_job);
+	}
+	g_signal_connect_data (task, "notify::completed",
+			       G_CALLBACK (scheduled_job_completed_cb),
+			       scheduled, scheduled_job_data_free, 0);
+
+	start = g_new0 (ScheduledJobStart, 1);
+	start->task = g_object_ref (task);
+	start->start_func = start_func;
+	start->scheduled = scheduled;
+
+	return gs_job_scheduler_push (plugin_loader->job_scheduler, lane,
+				      scheduled_job_start_cb, start,
+				      (GDestroyNotify) scheduled_job_start_free);
 }
 
 static void
@@ -3228,6 +3328,18 @@ gs_plugin_loader_cancelled_cb (GCancellable *cancellable,
 	g_cancellable_cancel (child_cancellable);
 }
 
+static gboolean
+old_api_job_scheduled_cb (gpointer user_data)
+{
+	GTask *task = G_TASK (user_data);
+	GsPluginLoader *plugin_loader = g_task_get_source_object (task);
+
+	g_thread_pool_push (plugin_loader->old_api_thread_pool,
+			    g_object_ref (task), NULL);
+
+	return G_SOURCE_REMOVE;
+}
+
 static void
 gs_plugin_loader_schedule_task (GsPluginLoader *plugin_loader,
 				GTask *task)
@@ -3240,7 +3352,9 @@ gs_plugin_loader_schedule_task (GsPluginLoader *plugin_loader,
 		GsPluginAction action = gs_plugin_job_get_action (helper->plugin_job);
 		gs_app_set_pending_action (app, action);
 	}
-	g_thread_pool_push (plugin_loader->queued_ops_pool, g_object_ref (task), NULL);
+	if (gs_plugin_loader_schedule_job (plugin_loader, task, helper->plugin_job,
+					   old_api_job_scheduled_cb))
+		old_api_job_scheduled_cb (task);
 }
 
 static void
@@ -3266,6 +3380,14 @@ run_job_cb (GObject      *source_object,
 	g_assert (job_class->run_finish != NULL);
 
 	if (!job_class->run_finish (plugin_job, result, &local_error)) {
+		gboolean cancelled = (g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED) ||
+				      g_error_matches (local_error, GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_CANCELLED));
+		g_autofree gchar *counter_name = NULL;
+
+		counter_name = g_strdup_printf ("process-thread:%s:%s", G_OBJECT_TYPE_NAME (plugin_job),
+						cancelled ? "cancelled" : "failed");
+		gs_metrics_increment_counter (counter_name, 1);
+
 		if (GS_IS_PLUGIN_JOB_INSTALL_APPS (plugin_job) ||
 		    GS_IS_PLUGIN_JOB_UNINSTALL_APPS (plugin_job))
 			gs_plugin_loader_pending_apps_remove (plugin_loader, plugin_job);
@@ -3389,6 +3511,7 @@ plugin_loader_task_freed_cb (gpointer user_data,
 static gboolean job_process_setup_complete_cb (GCancellable *cancellable,
                                                gpointer      user_data);
 static void job_process_cb (GTask *task);
+static gboolean run_job_scheduled_cb (gpointer user_data);
 
 /**
  * gs_plugin_loader_job_process_async:
@@ -3472,6 +3595,23 @@ gs_plugin_loader_job_process_async (GsPluginLoader *plugin_loader,
 	}
 }
 
+static gboolean
+run_job_scheduled_cb (gpointer user_data)
+{
+	GTask *task = G_TASK (user_data);
+	g_autoptr(GsPluginJob) plugin_job = g_object_ref (g_task_get_task_data (task));
+	GsPluginLoader *plugin_loader = g_task_get_source_object (task);
+	GsPluginJobClass *job_class = GS_PLUGIN_JOB_GET_CLASS (plugin_job);
+	gint64 begin_time_nsec = GS_PROFILER_CURRENT_TIME;
+
+	g_task_set_task_data (task, GSIZE_TO_POINTER (begin_time_nsec), NULL);
+
+	job_class->run_async (plugin_job, plugin_loader, g_task_get_cancellable (task),
+			      run_job_cb, g_object_ref (task));
+
+	return G_SOURCE_REMOVE;
+}
+
 static gboolean
 job_process_setup_complete_cb (GCancellable *cancellable,
                                gpointer      user_data)
@@ -3504,12 +3644,6 @@ job_process_cb (GTask *task)
 	 * gs_plugin_loader_job_process_async() is removed. */
 
 	if (job_class->run_async != NULL) {
-#ifdef HAVE_SYSPROF
-		gint64 begin_time_nsec G_GNUC_UNUSED = SYSPROF_CAPTURE_CURRENT_TIME;
-
-		g_task_set_task_data (task, GSIZE_TO_POINTER (begin_time_nsec), NULL);
-#endif
-
 		/* these change the pending count on the installed panel */
 		if (GS_IS_PLUGIN_JOB_INSTALL_APPS (plugin_job))
 			gs_plugin_loader_pending_apps_add (plugin_loader, plugin_job);
@@ -3520,8 +3654,9 @@ job_process_cb (GTask *task)
 			}
 		}
 
-		job_class->run_async (plugin_job, plugin_loader, cancellable,
-				      run_job_cb, g_object_ref (task));
+		if (gs_plugin_loader_schedule_job (plugin_loader, task, plugin_job,
+						   run_job_scheduled_cb))
+			run_job_scheduled_cb (task);
 		return;
 	}
 
@@ -3811,19 +3946,18 @@ gs_plugin_loader_get_odrs_provider (GsPluginLoader *plugin_loader)
  * @plugin_loader: a #GsPluginLoader
  * @max_ops: the maximum number of parallel operations
  *
- * Sets the number of maximum number of queued operations (install/update/upgrade-download)
- * to be processed at a time. If @max_ops is 0, then it will set the default maximum number.
+ * Sets the maximum number of user-initiated operations (such as install, update
+ * or upgrade-download) to be processed at a time; any more are queued. If
+ * @max_ops is 0, then it will set the default maximum number.
  */
 void
 gs_plugin_loader_set_max_parallel_ops (GsPluginLoader *plugin_loader,
 				       guint max_ops)
 {
-	g_autoptr(GError) error = NULL;
 	if (max_ops == 0)
 		max_ops = get_max_parallel_ops ();
-	if (!g_thread_pool_set_max_threads (plugin_loader->queued_ops_pool, max_ops, &error))
-		g_warning ("Failed to set the maximum number of ops in parallel: %s",
-			   error->message);
+	gs_job_scheduler_set_max_running (plugin_loader->job_scheduler,
+					  GS_JOB_LANE_USER, max_ops);
 }
 
 /**
@@ -45,6 +45,11 @@ GPtrArray	*gs_plugin_get_rules			(GsPlugin	*plugin,
 							 GsPluginRule	 rule);
 gpointer	 gs_plugin_get_symbol			(GsPlugin	*plugin,
 							 const gchar	*function_name);
+void		 gs_plugin_cache_get_stats		(GsPlugin	*plugin,
+							 guint		*out_size,
+							 guint64	*out_hits,
+							 guint64	*out_misses,
+							 guint64	*out_evictions);
 void		 gs_plugin_interactive_inc		(GsPlugin	*plugin);
 void		 gs_plugin_interactive_dec		(GsPlugin	*plugin);
 gchar		*gs_plugin_refine_flags_to_string	(GsPluginRefineFlags refine_flags);
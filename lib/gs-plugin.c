@@ -36,6 +36,7 @@
 #include <gdk/gdk.h>
 #include <string.h>
 
+#include "gs-app-cache.h"
 #include "gs-app-list-private.h"
 #include "gs-download-utils.h"
 #include "gs-enums.h"
@@ -46,8 +47,7 @@
 
 typedef struct
 {
-	GHashTable		*cache;
-	GMutex			 cache_mutex;
+	GsAppCache		*cache;
 	GModule			*module;
 	GsPluginFlags		 flags;
 	GPtrArray		*rules[GS_PLUGIN_RULE_LAST];
@@ -147,6 +147,7 @@ gs_plugin_set_name (GsPlugin *plugin, const gchar *name)
 	if (priv->name != NULL)
 		g_free (priv->name);
 	priv->name = g_strdup (name);
+	gs_app_cache_set_name (priv->cache, name);
 }
 
 /**
@@ -252,9 +253,8 @@ gs_plugin_finalize (GObject *object)
 	g_free (priv->language);
 	if (priv->network_monitor != NULL)
 		g_object_unref (priv->network_monitor);
-	g_hash_table_unref (priv->cache);
+	gs_app_cache_free (priv->cache);
 	g_hash_table_unref (priv->vfuncs);
-	g_mutex_clear (&priv->cache_mutex);
 	g_mutex_clear (&priv->interactive_mutex);
 	g_mutex_clear (&priv->timer_mutex);
 	g_mutex_clear (&priv->vfuncs_mutex);
@@ -1273,17 +1273,75 @@ GsApp *
 gs_plugin_cache_lookup (GsPlugin *plugin, const gchar *key)
 {
 	GsPluginPrivate *priv = gs_plugin_get_instance_private (plugin);
-	GsApp *app;
-	g_autoptr(GMutexLocker) locker = NULL;
 
 	g_return_val_if_fail (GS_IS_PLUGIN (plugin), NULL);
 	g_return_val_if_fail (key != NULL, NULL);
 
-	locker = g_mutex_locker_new (&priv->cache_mutex);
-	app = g_hash_table_lookup (priv->cache, key);
-	if (app == NULL)
-		return NULL;
-	return g_object_ref (app);
+	return gs_app_cache_lookup (priv->cache, key);
+}
+
+/**
+ * gs_plugin_cache_lookup_many:
+ * @plugin: a #GsPlugin
+ * @list: a #GsAppList
+ *
+ * Looks up each app in @list in the per-plugin cache, by its unique ID, which
+ * is the key gs_plugin_cache_add() uses by default. This is quicker than
+ * calling gs_plugin_cache_lookup() for each app, as the cache is locked once
+ * for the whole list rather than once per app.
+ *
+ * Apps in @list without a unique ID are skipped.
+ *
+ * Returns: (transfer full): the cached apps which were found, in the same
+ *   order as in @list
+ *
+ * Since: 48
+ **/
+GsAppList *
+gs_plugin_cache_lookup_many (GsPlugin *plugin, GsAppList *list)
+{
+	GsPluginPrivate *priv = gs_plugin_get_instance_private (plugin);
+	g_autoptr(GsAppList) found = gs_app_list_new ();
+	g_autoptr(GPtrArray) keys = NULL;
+	g_autofree GsApp **apps = NULL;
+
+	g_return_val_if_fail (GS_IS_PLUGIN (plugin), NULL);
+	g_return_val_if_fail (GS_IS_APP_LIST (list), NULL);
+
+	keys = g_ptr_array_sized_new (gs_app_list_length (list));
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		const gchar *unique_id = gs_app_get_unique_id (gs_app_list_index (list, i));
+		if (unique_id != NULL)
+			g_ptr_array_add (keys, (gpointer) unique_id);
+	}
+
+	apps = g_new (GsApp *, keys->len);
+	gs_app_cache_lookup_many (priv->cache, (const gchar **) keys->pdata, keys->len, apps);
+
+	for (guint i = 0; i < keys->len; i++) {
+		g_autoptr(GsApp) app = g_steal_pointer (&apps[i]);
+		if (app != NULL)
+			gs_app_list_add (found, app);
+	}
+
+	return g_steal_pointer (&found);
+}
+
+typedef struct {
+	GsAppList *list;
+	GsAppState state;
+} LookupByStateData;
+
+static void
+lookup_by_state_cb (const gchar *key,
+		    GsApp       *app,
+		    gpointer     user_data)
+{
+	LookupByStateData *data = user_data;
+
+	if (data->state == GS_APP_STATE_UNKNOWN ||
+	    data->state == gs_app_get_state (app))
+		gs_app_list_add (data->list, app);
 }
 
 /**
@@ -1304,24 +1362,13 @@ gs_plugin_cache_lookup_by_state (GsPlugin *plugin,
 				 GsAppState state)
 {
 	GsPluginPrivate *priv;
-	GHashTableIter iter;
-	gpointer value;
-	g_autoptr(GMutexLocker) locker = NULL;
+	LookupByStateData data = { list, state };
 
 	g_return_if_fail (GS_IS_PLUGIN (plugin));
 	g_return_if_fail (GS_IS_APP_LIST (list));
 
 	priv = gs_plugin_get_instance_private (plugin);
-	locker = g_mutex_locker_new (&priv->cache_mutex);
-
-	g_hash_table_iter_init (&iter, priv->cache);
-	while (g_hash_table_iter_next (&iter, NULL, &value)) {
-		GsApp *app = value;
-
-		if (state == GS_APP_STATE_UNKNOWN ||
-		    state == gs_app_get_state (app))
-			gs_app_list_add (list, app);
-	}
+	gs_app_cache_foreach (priv->cache, lookup_by_state_cb, &data);
 }
 
 /**
@@ -1337,13 +1384,11 @@ void
 gs_plugin_cache_remove (GsPlugin *plugin, const gchar *key)
 {
 	GsPluginPrivate *priv = gs_plugin_get_instance_private (plugin);
-	g_autoptr(GMutexLocker) locker = NULL;
 
 	g_return_if_fail (GS_IS_PLUGIN (plugin));
 	g_return_if_fail (key != NULL);
 
-	locker = g_mutex_locker_new (&priv->cache_mutex);
-	g_hash_table_remove (priv->cache, key);
+	gs_app_cache_remove (priv->cache, key);
 }
 
 /**
@@ -1355,19 +1400,19 @@ gs_plugin_cache_remove (GsPlugin *plugin, const gchar *key)
  * Adds an application to the per-plugin cache. This is optional,
  * and the plugin can use the cache however it likes.
  *
+ * The cache is bounded, see gs_plugin_cache_set_max_size(), so this may
+ * evict other apps which are not installed and are not in use elsewhere.
+ *
  * Since: 3.22
  **/
 void
 gs_plugin_cache_add (GsPlugin *plugin, const gchar *key, GsApp *app)
 {
 	GsPluginPrivate *priv = gs_plugin_get_instance_private (plugin);
-	g_autoptr(GMutexLocker) locker = NULL;
 
 	g_return_if_fail (GS_IS_PLUGIN (plugin));
 	g_return_if_fail (GS_IS_APP (app));
 
-	locker = g_mutex_locker_new (&priv->cache_mutex);
-
 	/* the user probably doesn't want to do this */
 	if (gs_app_has_quirk (app, GS_APP_QUIRK_IS_WILDCARD)) {
 		g_warning ("adding wildcard app %s to plugin cache",
@@ -1380,9 +1425,66 @@ gs_plugin_cache_add (GsPlugin *plugin, const gchar *key, GsApp *app)
 
 	g_return_if_fail (key != NULL);
 
-	if (g_hash_table_lookup (priv->cache, key) == app)
-		return;
-	g_hash_table_insert (priv->cache, g_strdup (key), g_object_ref (app));
+	gs_app_cache_add (priv->cache, key, app);
+}
+
+/**
+ * gs_plugin_cache_set_max_size:
+ * @plugin: a #GsPlugin
+ * @max_size: the number of apps to keep, or 0 for no limit
+ *
+ * Sets how many apps the per-plugin cache keeps before it starts evicting the
+ * least recently used ones. Installed apps, apps with an operation in
+ * progress and apps which are referenced outside the cache are never
+ * evicted, so they are not limited by this.
+ *
+ * The default is %GS_PLUGIN_CACHE_MAX_SIZE_DEFAULT. Plugins which rely on
+ * finding apps in the cache which may be evicted, or which keep their own
+ * references to every app, should set this to 0.
+ *
+ * Since: 48
+ **/
+void
+gs_plugin_cache_set_max_size (GsPlugin *plugin,
+			      guint     max_size)
+{
+	GsPluginPrivate *priv = gs_plugin_get_instance_private (plugin);
+
+	g_return_if_fail (GS_IS_PLUGIN (plugin));
+
+	gs_app_cache_set_max_size (priv->cache, max_size);
+}
+
+/**
+ * gs_plugin_cache_get_stats:
+ * @plugin: a #GsPlugin
+ * @out_size: (out) (optional): return location for the number of cached apps
+ * @out_hits: (out) (optional): return location for the number of lookups
+ *   which found an app
+ * @out_misses: (out) (optional): return location for the number of lookups
+ *   which didn’t
+ * @out_evictions: (out) (optional): return location for the number of apps
+ *   evicted from the cache
+ *
+ * Gets statistics about the per-plugin cache, for monitoring. The same counts
+ * are also added to #GsMetrics.
+ *
+ * Since: 48
+ **/
+void
+gs_plugin_cache_get_stats (GsPlugin *plugin,
+			   guint    *out_size,
+			   guint64  *out_hits,
+			   guint64  *out_misses,
+			   guint64  *out_evictions)
+{
+	GsPluginPrivate *priv = gs_plugin_get_instance_private (plugin);
+
+	g_return_if_fail (GS_IS_PLUGIN (plugin));
+
+	if (out_size != NULL)
+		*out_size = gs_app_cache_get_size (priv->cache);
+	gs_app_cache_get_stats (priv->cache, out_hits, out_misses, out_evictions);
 }
 
 /**
@@ -1403,12 +1505,19 @@ void
 gs_plugin_cache_invalidate (GsPlugin *plugin)
 {
 	GsPluginPrivate *priv = gs_plugin_get_instance_private (plugin);
-	g_autoptr(GMutexLocker) locker = NULL;
 
 	g_return_if_fail (GS_IS_PLUGIN (plugin));
 
-	locker = g_mutex_locker_new (&priv->cache_mutex);
-	g_hash_table_remove_all (priv->cache);
+	gs_app_cache_clear (priv->cache);
+}
+
+static void
+list_cached_cb (const gchar *key,
+		GsApp       *app,
+		gpointer     user_data)
+{
+	GsAppList *list = user_data;
+	gs_app_list_add (list, app);
 }
 
 /**
@@ -1426,20 +1535,11 @@ gs_plugin_list_cached (GsPlugin *plugin)
 {
 	GsPluginPrivate *priv = gs_plugin_get_instance_private (plugin);
 	GsAppList *list = NULL;
-	GHashTableIter iter;
-	gpointer value = NULL;
-	g_autoptr(GMutexLocker) locker = NULL;
 
 	g_return_val_if_fail (GS_IS_PLUGIN (plugin), NULL);
 
-	locker = g_mutex_locker_new (&priv->cache_mutex);
 	list = gs_app_list_new ();
-
-	g_hash_table_iter_init (&iter, priv->cache);
-	while (g_hash_table_iter_next (&iter, NULL, &value)) {
-		GsApp *app = value;
-		gs_app_list_add (list, app);
-	}
+	gs_app_cache_foreach (priv->cache, list_cached_cb, list);
 
 	return list;
 }
@@ -1879,13 +1979,10 @@ gs_plugin_init (GsPlugin *plugin)
 
 	priv->enabled = TRUE;
 	priv->scale = 1;
-	priv->cache = g_hash_table_new_full ((GHashFunc) as_utils_data_id_hash,
-					     (GEqualFunc) as_utils_data_id_equal,
-					     g_free,
-					     (GDestroyNotify) g_object_unref);
+	priv->cache = gs_app_cache_new ();
+	gs_app_cache_set_max_size (priv->cache, GS_PLUGIN_CACHE_MAX_SIZE_DEFAULT);
 	priv->vfuncs = g_hash_table_new_full (g_str_hash, g_str_equal,
 					      g_free, NULL);
-	g_mutex_init (&priv->cache_mutex);
 	g_mutex_init (&priv->interactive_mutex);
 	g_mutex_init (&priv->timer_mutex);
 	g_mutex_init (&priv->vfuncs_mutex);
@@ -1975,6 +2072,38 @@ gs_plugin_repository_changed (GsPlugin *plugin,
 	g_source_attach (idle_source, NULL);
 }
 
+typedef struct {
+	GsApp *repository;
+	GsPlugin *repo_plugin;
+	const gchar *repo_id;
+	GsAppState repo_state;
+} UpdateCacheStateData;
+
+static void
+update_cache_state_for_repository_cb (const gchar *key,
+				      GsApp       *app,
+				      gpointer     user_data)
+{
+	UpdateCacheStateData *data = user_data;
+	GsAppState app_state = gs_app_get_state (app);
+	g_autoptr(GsPlugin) app_plugin = gs_app_dup_management_plugin (app);
+
+	if (app_plugin != data->repo_plugin ||
+	    gs_app_get_scope (app) != gs_app_get_scope (data->repository) ||
+	    gs_app_get_bundle_kind (app) != gs_app_get_bundle_kind (data->repository))
+		return;
+
+	if (((app_state == GS_APP_STATE_AVAILABLE &&
+	    data->repo_state != GS_APP_STATE_INSTALLED) ||
+	    (app_state == GS_APP_STATE_UNAVAILABLE &&
+	    data->repo_state == GS_APP_STATE_INSTALLED)) &&
+	    g_strcmp0 (gs_app_get_origin (app), data->repo_id) == 0) {
+		/* First reset the state, because move from 'available' to 'unavailable' is not correct */
+		gs_app_set_state (app, GS_APP_STATE_UNKNOWN);
+		gs_app_set_state (app, data->repo_state == GS_APP_STATE_INSTALLED ? GS_APP_STATE_AVAILABLE : GS_APP_STATE_UNAVAILABLE);
+	}
+}
+
 /**
  * gs_plugin_update_cache_state_for_repository:
  * @plugin: a #GsPlugin
@@ -1990,44 +2119,20 @@ gs_plugin_update_cache_state_for_repository (GsPlugin *plugin,
 					     GsApp *repository)
 {
 	GsPluginPrivate *priv;
-	GHashTableIter iter;
-	g_autoptr(GMutexLocker) locker = NULL;
 	g_autoptr(GsPlugin) repo_plugin = NULL;
-	gpointer value;
-	const gchar *repo_id;
-	GsAppState repo_state;
+	UpdateCacheStateData data;
 
 	g_return_if_fail (GS_IS_PLUGIN (plugin));
 	g_return_if_fail (GS_IS_APP (repository));
 
 	priv = gs_plugin_get_instance_private (plugin);
-	repo_id = gs_app_get_id (repository);
-	repo_state = gs_app_get_state (repository);
 	repo_plugin = gs_app_dup_management_plugin (repository);
 
-	locker = g_mutex_locker_new (&priv->cache_mutex);
-
-	g_hash_table_iter_init (&iter, priv->cache);
-	while (g_hash_table_iter_next (&iter, NULL, &value)) {
-		GsApp *app = value;
-		GsAppState app_state = gs_app_get_state (app);
-		g_autoptr(GsPlugin) app_plugin = gs_app_dup_management_plugin (app);
-
-		if (app_plugin != repo_plugin ||
-		    gs_app_get_scope (app) != gs_app_get_scope (repository) ||
-		    gs_app_get_bundle_kind (app) != gs_app_get_bundle_kind (repository))
-			continue;
-
-		if (((app_state == GS_APP_STATE_AVAILABLE &&
-		    repo_state != GS_APP_STATE_INSTALLED) ||
-		    (app_state == GS_APP_STATE_UNAVAILABLE &&
-		    repo_state == GS_APP_STATE_INSTALLED)) &&
-		    g_strcmp0 (gs_app_get_origin (app), repo_id) == 0) {
-			/* First reset the state, because move from 'available' to 'unavailable' is not correct */
-			gs_app_set_state (app, GS_APP_STATE_UNKNOWN);
-			gs_app_set_state (app, repo_state == GS_APP_STATE_INSTALLED ? GS_APP_STATE_AVAILABLE : GS_APP_STATE_UNAVAILABLE);
-		}
-	}
+	data.repository = repository;
+	data.repo_plugin = repo_plugin;
+	data.repo_id = gs_app_get_id (repository);
+	data.repo_state = gs_app_get_state (repository);
+	gs_app_cache_foreach (priv->cache, update_cache_state_for_repository_cb, &data);
 }
 
 /**
@@ -364,6 +364,16 @@ struct _GsPluginClass
 /* helpers */
 #define	GS_PLUGIN_ERROR					gs_plugin_error_quark ()
 
+/**
+ * GS_PLUGIN_CACHE_MAX_SIZE_DEFAULT:
+ *
+ * The default maximum number of apps in a per-plugin cache. See
+ * gs_plugin_cache_set_max_size().
+ *
+ * Since: 48
+ */
+#define GS_PLUGIN_CACHE_MAX_SIZE_DEFAULT		4096
+
 GQuark		 gs_plugin_error_quark			(void);
 
 /* public getters and setters */
@@ -391,6 +401,8 @@ gboolean	 gs_plugin_check_distro_id		(GsPlugin	*plugin,
 							 const gchar	*distro_id);
 GsApp		*gs_plugin_cache_lookup			(GsPlugin	*plugin,
 							 const gchar	*key);
+GsAppList	*gs_plugin_cache_lookup_many		(GsPlugin	*plugin,
+							 GsAppList	*list);
 void		 gs_plugin_cache_lookup_by_state	(GsPlugin	*plugin,
 							 GsAppList	*list,
 							 GsAppState	 state);
@@ -400,6 +412,8 @@ void		 gs_plugin_cache_add			(GsPlugin	*plugin,
 void		 gs_plugin_cache_remove			(GsPlugin	*plugin,
 							 const gchar	*key);
 void		 gs_plugin_cache_invalidate		(GsPlugin	*plugin);
+void		 gs_plugin_cache_set_max_size		(GsPlugin	*plugin,
+							 guint		 max_size);
 GsAppList	*gs_plugin_list_cached			(GsPlugin	*plugin);
 void		 gs_plugin_status_update		(GsPlugin	*plugin,
 							 GsApp		*app,
@@ -76,12 +76,30 @@
  * GS_PROFILER_ADD_MARK(Foo, task->begin_time, "do-something", NULL);
  *```
  *
+ * The begin time must be taken with `GS_PROFILER_CURRENT_TIME`.
+ *
+ * Descriptions are only used by Sysprof, so the description arguments of all
+ * the macros are only evaluated while a Sysprof collector is active. They can
+ * be costly to build, such as with gs_plugin_job_to_string(), so should be
+ * passed to the macros directly rather than being built beforehand.
+ *
+ * Whether or not Sysprof support is enabled, the duration of every scope
+ * and mark is also recorded in the metrics registry under its name, so that
+ * timing data is available in production; see gs_metrics_record_duration().
+ *
  * Since: 44
  */
 
 #ifdef HAVE_SYSPROF
 #include <sysprof-capture.h>
 
+#define GS_PROFILER_CURRENT_TIME SYSPROF_CAPTURE_CURRENT_TIME
+#define GS_PROFILER_DESCRIPTION(description) (sysprof_collector_is_active () ? (description) : NULL)
+#else
+#define GS_PROFILER_CURRENT_TIME (g_get_monotonic_time () * 1000)
+#define GS_PROFILER_DESCRIPTION(description) NULL
+#endif
+
 typedef struct
 {
 	int64_t begin_time;
@@ -89,14 +107,30 @@ typedef struct
 	gchar *description;
 } GsProfilerHead;
 
+/* Durations are always recorded in the metrics registry (see gs-metrics.h),
+ * and additionally as a Sysprof mark if Sysprof support is enabled. */
 static inline void
-gs_profiler_tracing_end (GsProfilerHead *head)
+gs_profiler_add_mark (int64_t      begin_time,
+		      const gchar *name,
+		      const gchar *description)
 {
-	sysprof_collector_mark (head->begin_time,
-				SYSPROF_CAPTURE_CURRENT_TIME - head->begin_time,
+	int64_t duration = GS_PROFILER_CURRENT_TIME - begin_time;
+
+#ifdef HAVE_SYSPROF
+	sysprof_collector_mark (begin_time,
+				duration,
 				"gnome-software",
-				head->name,
-				head->description);
+				name,
+				description);
+#endif
+
+	gs_metrics_record_duration (name, MAX (duration, 0) / 1000);
+}
+
+static inline void
+gs_profiler_tracing_end (GsProfilerHead *head)
+{
+	gs_profiler_add_mark (head->begin_time, head->name, head->description);
 
 	g_clear_pointer (&head->name, g_free);
 	g_clear_pointer (&head->description, g_free);
@@ -114,9 +148,9 @@ gs_profiler_auto_trace_end_helper (GsProfilerHead **head)
 	__attribute__((cleanup (gs_profiler_auto_trace_end_helper))) \
 		GsProfilerHead *ScopedGsProfilerTraceHead##Name = &GsProfiler##Name; \
 	GsProfiler##Name = (GsProfilerHead) { \
-		.begin_time = SYSPROF_CAPTURE_CURRENT_TIME, \
+		.begin_time = GS_PROFILER_CURRENT_TIME, \
 		.name = sysprof_name, \
-		.description = sysprof_description, \
+		.description = GS_PROFILER_DESCRIPTION (sysprof_description), \
 	};
 
 #define GS_PROFILER_BEGIN_SCOPED(Name, sysprof_name, sysprof_description) \
@@ -128,26 +162,11 @@ gs_profiler_auto_trace_end_helper (GsProfilerHead **head)
 #define GS_PROFILER_ADD_MARK_TAKE(Name, begin_time, sysprof_name, sysprof_description) \
 	G_STMT_START { \
 		g_autofree char *_owned_sysprof_name_##Name = sysprof_name; \
-		g_autofree char *_owned_sysprof_description_##Name = sysprof_description; \
-		sysprof_collector_mark (begin_time, \
-					SYSPROF_CAPTURE_CURRENT_TIME - begin_time, \
-					"gnome-software", \
-					_owned_sysprof_name_##Name, \
-					_owned_sysprof_description_##Name); \
+		g_autofree char *_owned_sysprof_description_##Name = GS_PROFILER_DESCRIPTION (sysprof_description); \
+		gs_profiler_add_mark (begin_time, \
+				      _owned_sysprof_name_##Name, \
+				      _owned_sysprof_description_##Name); \
 	} G_STMT_END
 
 #define GS_PROFILER_ADD_MARK(Name, begin_time, sysprof_name, sysprof_description) \
-	GS_PROFILER_ADD_MARK_TAKE (Name, begin_time, g_strdup (sysprof_name), g_strdup (sysprof_description))
-
-#else
-
-#define GS_PROFILER_BEGIN_SCOPED_TAKE(Name, sysprof_name, sysprof_description) \
-	G_STMT_START {
-#define GS_PROFILER_BEGIN_SCOPED(Name, sysprof_name, sysprof_description) \
-	G_STMT_START {
-#define GS_PROFILER_END_SCOPED(Name) \
-	} G_STMT_END
-#define GS_PROFILER_ADD_MARK_TAKE(Name, begin_time, sysprof_name, sysprof_description)
-#define GS_PROFILER_ADD_MARK(Name, begin_time, sysprof_name, sysprof_description)
-
-#endif
+	gs_profiler_add_mark (begin_time, sysprof_name, GS_PROFILER_DESCRIPTION (sysprof_description))
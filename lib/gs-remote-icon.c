@@ -14,8 +14,9 @@
  *
  * #GsRemoteIcon is a #GIcon implementation which represents remote icons —
  * icons which have an HTTP or HTTPS URI. It provides a well-known local filename
- * for a cached copy of the icon, accessible as #GFileIcon:file, and a method
- * to download the icon to the cache, gs_remote_icon_ensure_cached().
+ * for a cached copy of the icon, accessible as #GFileIcon:file, and methods
+ * to download the icon to the cache, gs_remote_icon_ensure_cached() and
+ * gs_remote_icon_ensure_cached_async().
  *
  * Constructing a #GsRemoteIcon does not guarantee that the icon is cached. Call
  * gs_remote_icon_ensure_cached() for that.
@@ -39,6 +40,7 @@
 #include <sys/stat.h>
 #include <libsoup/soup.h>
 
+#include "gs-download-scheduler.h"
 #include "gs-remote-icon.h"
 #include "gs-utils.h"
 
@@ -57,6 +59,7 @@ struct _GsRemoteIcon
 	/* } */
 
 	gchar		*uri;  /* (owned), immutable after construction */
+	gint		 cached;  /* (atomic) */
 };
 
 G_DEFINE_TYPE (GsRemoteIcon, gs_remote_icon, G_TYPE_FILE_ICON)
@@ -236,6 +239,59 @@ gs_remote_icon_get_uri (GsRemoteIcon *self)
 	return self->uri;
 }
 
+/**
+ * gs_remote_icon_get_cached:
+ * @self: a #GsRemoteIcon
+ *
+ * Gets whether the icon is known to be in the local cache, because
+ * gs_remote_icon_ensure_cached() or gs_remote_icon_ensure_cached_async() has
+ * succeeded for it. This does no I/O.
+ *
+ * Returns: %TRUE if the icon has been cached locally
+ * Since: 48
+ */
+gboolean
+gs_remote_icon_get_cached (GsRemoteIcon *self)
+{
+	g_return_val_if_fail (GS_IS_REMOTE_ICON (self), FALSE);
+
+	return g_atomic_int_get (&self->cached);
+}
+
+/* Scale the icon in @stream down to at most @max_size, and save it to
+ * @destination_path. */
+static GdkPixbuf *
+gs_icon_save_from_stream (GInputStream  *stream,
+                          const gchar   *destination_path,
+                          guint          max_size,
+                          GCancellable  *cancellable,
+                          GError       **error)
+{
+	g_autoptr(GdkPixbuf) pixbuf = NULL;
+	g_autoptr(GdkPixbuf) scaled_pixbuf = NULL;
+
+	/* Typically these icons are 64x64px PNG files. If not, resize down
+	 * so it’s at most @max_size square, to minimise the size of the on-disk
+	 * cache.*/
+	pixbuf = gdk_pixbuf_new_from_stream (stream, cancellable, error);
+	if (pixbuf == NULL)
+		return NULL;
+
+	if ((guint) gdk_pixbuf_get_height (pixbuf) <= max_size &&
+	    (guint) gdk_pixbuf_get_width (pixbuf) <= max_size) {
+		scaled_pixbuf = g_object_ref (pixbuf);
+	} else {
+		scaled_pixbuf = gdk_pixbuf_scale_simple (pixbuf, max_size, max_size,
+							 GDK_INTERP_BILINEAR);
+	}
+
+	/* write file */
+	if (!gdk_pixbuf_save (scaled_pixbuf, destination_path, "png", error, NULL))
+		return NULL;
+
+	return g_steal_pointer (&scaled_pixbuf);
+}
+
 static GdkPixbuf *
 gs_icon_download (SoupSession   *session,
                   const gchar   *uri,
@@ -247,8 +303,6 @@ gs_icon_download (SoupSession   *session,
 	guint status_code;
 	g_autoptr(SoupMessage) msg = NULL;
 	g_autoptr(GInputStream) stream = NULL;
-	g_autoptr(GdkPixbuf) pixbuf = NULL;
-	g_autoptr(GdkPixbuf) scaled_pixbuf = NULL;
 
 	/* Create the request */
 	msg = soup_message_new (SOUP_METHOD_GET, uri);
@@ -279,26 +333,33 @@ gs_icon_download (SoupSession   *session,
 		return NULL;
 	}
 
-	/* Typically these icons are 64x64px PNG files. If not, resize down
-	 * so it’s at most @max_size square, to minimise the size of the on-disk
-	 * cache.*/
-	pixbuf = gdk_pixbuf_new_from_stream (stream, cancellable, error);
-	if (pixbuf == NULL)
-		return NULL;
+	return gs_icon_save_from_stream (stream, destination_path, max_size, cancellable, error);
+}
 
-	if ((guint) gdk_pixbuf_get_height (pixbuf) <= max_size &&
-	    (guint) gdk_pixbuf_get_width (pixbuf) <= max_size) {
-		scaled_pixbuf = g_object_ref (pixbuf);
-	} else {
-		scaled_pixbuf = gdk_pixbuf_scale_simple (pixbuf, max_size, max_size,
-							 GDK_INTERP_BILINEAR);
+/* Check whether the icon is already in the cache at @cache_filename and not
+ * older than 30 days. */
+static gboolean
+gs_remote_icon_is_cached (GsRemoteIcon *self,
+                          const gchar  *cache_filename)
+{
+	GStatBuf stat_buf;
+	gint width = 0, height = 0;
+
+	if (g_stat (cache_filename, &stat_buf) == -1 ||
+	    !S_ISREG (stat_buf.st_mode) ||
+	    (g_get_real_time () / G_USEC_PER_SEC) - stat_buf.st_mtim.tv_sec >= (60 * 60 * 24 * 30))
+		return FALSE;
+
+	/* Ensure the downloaded image dimensions are stored on the icon */
+	if (!g_object_get_data (G_OBJECT (self), "width") &&
+	    gdk_pixbuf_get_file_info (cache_filename, &width, &height)) {
+		g_object_set_data (G_OBJECT (self), "width", GINT_TO_POINTER (width));
+		g_object_set_data (G_OBJECT (self), "height", GINT_TO_POINTER (height));
 	}
 
-	/* write file */
-	if (!gdk_pixbuf_save (scaled_pixbuf, destination_path, "png", error, NULL))
-		return NULL;
+	g_atomic_int_set (&self->cached, TRUE);
 
-	return g_steal_pointer (&scaled_pixbuf);
+	return TRUE;
 }
 
 /**
@@ -334,7 +395,6 @@ gs_remote_icon_ensure_cached (GsRemoteIcon  *self,
 	const gchar *uri;
 	g_autofree gchar *cache_filename = NULL;
 	g_autoptr(GdkPixbuf) cached_pixbuf = NULL;
-	GStatBuf stat_buf;
 
 	g_return_val_if_fail (GS_IS_REMOTE_ICON (self), FALSE);
 	g_return_val_if_fail (SOUP_IS_SESSION (soup_session), FALSE);
@@ -350,18 +410,8 @@ gs_remote_icon_ensure_cached (GsRemoteIcon  *self,
 		return FALSE;
 
 	/* Already in cache and not older than 30 days */
-	if (g_stat (cache_filename, &stat_buf) != -1 &&
-	    S_ISREG (stat_buf.st_mode) &&
-	    (g_get_real_time () / G_USEC_PER_SEC) - stat_buf.st_mtim.tv_sec < (60 * 60 * 24 * 30)) {
-		gint width = 0, height = 0;
-		/* Ensure the downloaded image dimensions are stored on the icon */
-		if (!g_object_get_data (G_OBJECT (self), "width") &&
-		    gdk_pixbuf_get_file_info (cache_filename, &width, &height)) {
-			g_object_set_data (G_OBJECT (self), "width", GINT_TO_POINTER (width));
-			g_object_set_data (G_OBJECT (self), "height", GINT_TO_POINTER (height));
-		}
+	if (gs_remote_icon_is_cached (self, cache_filename))
 		return TRUE;
-	}
 
 	cached_pixbuf = gs_icon_download (soup_session, uri, cache_filename, maximum_icon_size, cancellable, error);
 	if (cached_pixbuf == NULL)
@@ -370,6 +420,152 @@ gs_remote_icon_ensure_cached (GsRemoteIcon  *self,
 	/* Ensure the dimensions are set correctly on the icon. */
 	g_object_set_data (G_OBJECT (self), "width", GUINT_TO_POINTER (gdk_pixbuf_get_width (cached_pixbuf)));
 	g_object_set_data (G_OBJECT (self), "height", GUINT_TO_POINTER (gdk_pixbuf_get_height (cached_pixbuf)));
+	g_atomic_int_set (&self->cached, TRUE);
 
 	return TRUE;
 }
+
+typedef struct {
+	gchar *cache_filename;  /* (owned) */
+	guint maximum_icon_size;
+} EnsureCachedData;
+
+static void
+ensure_cached_data_free (EnsureCachedData *data)
+{
+	g_free (data->cache_filename);
+	g_free (data);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (EnsureCachedData, ensure_cached_data_free)
+
+static void ensure_cached_download_cb (GObject      *source_object,
+                                       GAsyncResult *result,
+                                       gpointer      user_data);
+
+/**
+ * gs_remote_icon_ensure_cached_async:
+ * @self: a #GsRemoteIcon
+ * @soup_session: a #SoupSession to use to download the icon
+ * @maximum_icon_size: maximum size (in device pixels) of the icon to save
+ * @io_priority: I/O priority of the download, typically %G_PRIORITY_DEFAULT
+ *   for icons which are on screen and %G_PRIORITY_LOW for others
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @callback: callback to call once the operation is complete
+ * @user_data: (closure callback): data to pass to @callback
+ *
+ * Asynchronous version of gs_remote_icon_ensure_cached().
+ *
+ * The download is queued on the default #GsDownloadScheduler, so several
+ * icons can be downloaded at once and requests for the same icon are shared.
+ * Checking the cache, and decoding and saving the downloaded icon, are done
+ * synchronously in the calling thread’s main context, so this should be
+ * called from a worker thread rather than the UI thread.
+ *
+ * Since: 48
+ */
+void
+gs_remote_icon_ensure_cached_async (GsRemoteIcon        *self,
+                                    SoupSession         *soup_session,
+                                    guint                maximum_icon_size,
+                                    int                  io_priority,
+                                    GCancellable        *cancellable,
+                                    GAsyncReadyCallback  callback,
+                                    gpointer             user_data)
+{
+	g_autoptr(GTask) task = NULL;
+	g_autoptr(EnsureCachedData) data = NULL;
+	g_autoptr(GError) local_error = NULL;
+	const gchar *uri;
+
+	g_return_if_fail (GS_IS_REMOTE_ICON (self));
+	g_return_if_fail (SOUP_IS_SESSION (soup_session));
+	g_return_if_fail (maximum_icon_size > 0);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gs_remote_icon_ensure_cached_async);
+
+	uri = gs_remote_icon_get_uri (self);
+
+	data = g_new0 (EnsureCachedData, 1);
+	data->maximum_icon_size = maximum_icon_size;
+	data->cache_filename = gs_remote_icon_get_cache_filename (uri, TRUE, &local_error);
+	if (data->cache_filename == NULL) {
+		g_task_return_error (task, g_steal_pointer (&local_error));
+		return;
+	}
+
+	/* Already in cache and not older than 30 days */
+	if (gs_remote_icon_is_cached (self, data->cache_filename)) {
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+
+	g_task_set_task_data (task, g_steal_pointer (&data), (GDestroyNotify) ensure_cached_data_free);
+
+	gs_download_scheduler_download_bytes_async (gs_download_scheduler_get_default (),
+						    soup_session, uri, NULL, io_priority, cancellable,
+						    ensure_cached_download_cb, g_steal_pointer (&task));
+}
+
+static void
+ensure_cached_download_cb (GObject      *source_object,
+                           GAsyncResult *result,
+                           gpointer      user_data)
+{
+	g_autoptr(GTask) task = g_steal_pointer (&user_data);
+	GsRemoteIcon *self = g_task_get_source_object (task);
+	EnsureCachedData *data = g_task_get_task_data (task);
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GInputStream) stream = NULL;
+	g_autoptr(GdkPixbuf) cached_pixbuf = NULL;
+	g_autoptr(GError) local_error = NULL;
+
+	bytes = gs_download_scheduler_download_bytes_finish (GS_DOWNLOAD_SCHEDULER (source_object),
+							     result, &local_error);
+	if (bytes == NULL) {
+		g_task_return_error (task, g_steal_pointer (&local_error));
+		return;
+	}
+
+	stream = g_memory_input_stream_new_from_bytes (bytes);
+	cached_pixbuf = gs_icon_save_from_stream (stream, data->cache_filename, data->maximum_icon_size,
+						  g_task_get_cancellable (task), &local_error);
+	if (cached_pixbuf == NULL) {
+		g_task_return_error (task, g_steal_pointer (&local_error));
+		return;
+	}
+
+	/* Ensure the dimensions are set correctly on the icon. */
+	g_object_set_data (G_OBJECT (self), "width", GUINT_TO_POINTER (gdk_pixbuf_get_width (cached_pixbuf)));
+	g_object_set_data (G_OBJECT (self), "height", GUINT_TO_POINTER (gdk_pixbuf_get_height (cached_pixbuf)));
+	g_atomic_int_set (&self->cached, TRUE);
+
+	g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * gs_remote_icon_ensure_cached_finish:
+ * @self: a #GsRemoteIcon
+ * @result: result of the asynchronous operation
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finish an asynchronous operation started with
+ * gs_remote_icon_ensure_cached_async().
+ *
+ * Returns: %TRUE on success, %FALSE otherwise
+ * Since: 48
+ */
+gboolean
+gs_remote_icon_ensure_cached_finish (GsRemoteIcon  *self,
+                                     GAsyncResult  *result,
+                                     GError       **error)
+{
+	g_return_val_if_fail (GS_IS_REMOTE_ICON (self), FALSE);
+	g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+	g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == gs_remote_icon_ensure_cached_async, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	return g_task_propagate_boolean (G_TASK (result), error);
+}
@@ -27,11 +27,22 @@ G_DECLARE_FINAL_TYPE (GsRemoteIcon, gs_remote_icon, GS, REMOTE_ICON, GObject)
 GIcon		*gs_remote_icon_new		(const gchar		 *uri);
 
 const gchar	*gs_remote_icon_get_uri		(GsRemoteIcon		 *self);
+gboolean	 gs_remote_icon_get_cached	(GsRemoteIcon		 *self);
 
 gboolean	 gs_remote_icon_ensure_cached	(GsRemoteIcon		 *self,
 						 SoupSession		 *soup_session,
 						 guint			  maximum_icon_size,
 						 GCancellable		 *cancellable,
 						 GError			**error);
+void		 gs_remote_icon_ensure_cached_async	(GsRemoteIcon		 *self,
+							 SoupSession		 *soup_session,
+							 guint			  maximum_icon_size,
+							 int			  io_priority,
+							 GCancellable		 *cancellable,
+							 GAsyncReadyCallback	  callback,
+							 gpointer		  user_data);
+gboolean	 gs_remote_icon_ensure_cached_finish	(GsRemoteIcon		 *self,
+							 GAsyncResult		 *result,
+							 GError			**error);
 
 G_END_DECLS
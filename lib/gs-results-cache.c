@@ -0,0 +1,455 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Software contributors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/**
+ * SECTION:gs-results-cache
+ * @short_description: Persistent cache of the last results shown on a page
+ *
+ * The results cache stores a compact copy of the apps last shown on a page,
+ * such as the installed apps, so that they can be shown straight away the
+ * next time the page is loaded, while the plugins are queried for the
+ * current results in the background.
+ *
+ * Only what is needed to draw the apps in a list or a tile is stored: their
+ * IDs, names, summaries, versions, states, sizes, quirks, release dates,
+ * icons which are available locally, and key colors. The results are stored
+ * as a #GVariant in the user’s cache directory, so loading them is a single
+ * mapped read.
+ *
+ * The apps returned by gs_results_cache_load() are not known to any plugin,
+ * so no operations can be done on them. gs_results_cache_is_cached_app()
+ * identifies them so that pages can disable any actions on them until they
+ * have been replaced with the current results.
+ *
+ * Since: 48
+ */
+
+#include "config.h"
+
+#include "gs-app-private.h"
+#include "gs-icon.h"
+#include "gs-remote-icon.h"
+#include "gs-results-cache.h"
+#include "gs-utils.h"
+
+/* bump this if the format changes incompatibly, to ignore old caches */
+#define RESULTS_CACHE_VERSION 1
+#define RESULTS_CACHE_FORMAT "(uaa{sv})"
+
+#define CACHED_APP_METADATA_KEY "GnomeSoftware::results-cache"
+
+/* This is called for every icon of every app each time results are saved,
+ * on the main thread, so it must not do any I/O. */
+static gboolean
+icon_is_local (GIcon *icon)
+{
+	/* remote icons are file icons for where they are cached, which may
+	 * not have been downloaded yet */
+	if (GS_IS_REMOTE_ICON (icon))
+		return gs_remote_icon_get_cached (GS_REMOTE_ICON (icon));
+
+	/* other file icons are only created for files which exist, see
+	 * gs_icon_new_for_appstream_icon() */
+	return G_IS_FILE_ICON (icon) || G_IS_THEMED_ICON (icon);
+}
+
+static GVariant *
+serialize_app (GsApp *app)
+{
+	g_auto(GVariantDict) dict = G_VARIANT_DICT_INIT (NULL);
+	g_autoptr(GsAppSnapshot) snapshot = NULL;
+	GVariantBuilder icons_builder;
+	GPtrArray *icons;
+	GArray *key_colors;
+	const gchar *tmp;
+	guint64 size_bytes;
+	guint64 quirks = 0;
+
+	if (gs_app_get_id (app) == NULL)
+		return NULL;
+
+	snapshot = gs_app_dup_snapshot (app);
+
+	g_variant_dict_insert (&dict, "id", "s", gs_app_get_id (app));
+	g_variant_dict_insert (&dict, "kind", "u", (guint32) gs_app_get_kind (app));
+	g_variant_dict_insert (&dict, "scope", "u", (guint32) gs_app_get_scope (app));
+	g_variant_dict_insert (&dict, "bundle-kind", "u", (guint32) gs_app_get_bundle_kind (app));
+
+	/* operations in progress won’t be when the cache is next loaded */
+	switch (gs_app_snapshot_get_state (snapshot)) {
+	case GS_APP_STATE_DOWNLOADING:
+	case GS_APP_STATE_INSTALLING:
+	case GS_APP_STATE_REMOVING:
+	case GS_APP_STATE_QUEUED_FOR_INSTALL:
+		break;
+	default:
+		g_variant_dict_insert (&dict, "state", "u", (guint32) gs_app_snapshot_get_state (snapshot));
+		break;
+	}
+
+	tmp = gs_app_get_origin (app);
+	if (tmp != NULL)
+		g_variant_dict_insert (&dict, "origin", "s", tmp);
+	tmp = gs_app_get_branch (app);
+	if (tmp != NULL)
+		g_variant_dict_insert (&dict, "branch", "s", tmp);
+	tmp = gs_app_snapshot_get_name (snapshot);
+	if (tmp != NULL)
+		g_variant_dict_insert (&dict, "name", "s", tmp);
+	tmp = gs_app_snapshot_get_summary (snapshot);
+	if (tmp != NULL)
+		g_variant_dict_insert (&dict, "summary", "s", tmp);
+	tmp = gs_app_snapshot_get_version (snapshot);
+	if (tmp != NULL)
+		g_variant_dict_insert (&dict, "version", "s", tmp);
+
+	if (gs_app_snapshot_get_size_download (snapshot, &size_bytes) == GS_SIZE_TYPE_VALID)
+		g_variant_dict_insert (&dict, "size-download", "t", size_bytes);
+	if (gs_app_snapshot_get_size_installed (snapshot, &size_bytes) == GS_SIZE_TYPE_VALID)
+		g_variant_dict_insert (&dict, "size-installed", "t", size_bytes);
+	if (gs_app_get_release_date (app) != 0)
+		g_variant_dict_insert (&dict, "release-date", "t", gs_app_get_release_date (app));
+
+	for (guint i = 0; (1u << i) < GS_APP_QUIRK_LAST; i++) {
+		if (gs_app_has_quirk (app, 1u << i))
+			quirks |= 1u << i;
+	}
+	if (quirks != 0)
+		g_variant_dict_insert (&dict, "quirks", "t", quirks);
+
+	icons = gs_app_snapshot_get_icons (snapshot);
+	g_variant_builder_init (&icons_builder, G_VARIANT_TYPE ("a(uuuv)"));
+	for (guint i = 0; icons != NULL && i < icons->len; i++) {
+		GIcon *icon = g_ptr_array_index (icons, i);
+		g_autoptr(GVariant) serialized = NULL;
+
+		if (!icon_is_local (icon))
+			continue;
+		serialized = g_icon_serialize (icon);
+		if (serialized == NULL)
+			continue;
+		g_variant_builder_add (&icons_builder, "(uuuv)",
+				       gs_icon_get_width (icon),
+				       gs_icon_get_height (icon),
+				       gs_icon_get_scale (icon),
+				       serialized);
+	}
+	g_variant_dict_insert_value (&dict, "icons", g_variant_builder_end (&icons_builder));
+
+	/* don’t calculate the key colors here if they’re not known yet, as that
+	 * means loading the icon */
+	key_colors = gs_app_peek_key_colors (app);
+	if (key_colors != NULL && key_colors->len > 0) {
+		GVariantBuilder colors_builder;
+
+		g_variant_builder_init (&colors_builder, G_VARIANT_TYPE ("a(dddd)"));
+		for (guint i = 0; i < key_colors->len; i++) {
+			const GdkRGBA *color = &g_array_index (key_colors, GdkRGBA, i);
+			g_variant_builder_add (&colors_builder, "(dddd)",
+					       (gdouble) color->red, (gdouble) color->green,
+					       (gdouble) color->blue, (gdouble) color->alpha);
+		}
+		g_variant_dict_insert_value (&dict, "key-colors", g_variant_builder_end (&colors_builder));
+	}
+
+	return g_variant_dict_end (&dict);
+}
+
+static GsApp *
+deserialize_app (GVariant *variant)
+{
+	g_auto(GVariantDict) dict = G_VARIANT_DICT_INIT (variant);
+	g_autoptr(GsApp) app = NULL;
+	g_autoptr(GVariant) icons = NULL;
+	g_autoptr(GVariant) key_colors = NULL;
+	const gchar *tmp;
+	guint32 value32;
+	guint64 value64;
+
+	if (!g_variant_dict_lookup (&dict, "id", "&s", &tmp))
+		return NULL;
+	app = gs_app_new (tmp);
+
+	if (g_variant_dict_lookup (&dict, "kind", "u", &value32))
+		gs_app_set_kind (app, (AsComponentKind) value32);
+	if (g_variant_dict_lookup (&dict, "scope", "u", &value32))
+		gs_app_set_scope (app, (AsComponentScope) value32);
+	if (g_variant_dict_lookup (&dict, "bundle-kind", "u", &value32))
+		gs_app_set_bundle_kind (app, (AsBundleKind) value32);
+	if (g_variant_dict_lookup (&dict, "origin", "&s", &tmp))
+		gs_app_set_origin (app, tmp);
+	if (g_variant_dict_lookup (&dict, "branch", "&s", &tmp))
+		gs_app_set_branch (app, tmp);
+	if (g_variant_dict_lookup (&dict, "name", "&s", &tmp))
+		gs_app_set_name (app, GS_APP_QUALITY_LOWEST, tmp);
+	if (g_variant_dict_lookup (&dict, "summary", "&s", &tmp))
+		gs_app_set_summary (app, GS_APP_QUALITY_LOWEST, tmp);
+	if (g_variant_dict_lookup (&dict, "version", "&s", &tmp))
+		gs_app_set_version (app, tmp);
+	if (g_variant_dict_lookup (&dict, "size-download", "t", &value64))
+		gs_app_set_size_download (app, GS_SIZE_TYPE_VALID, value64);
+	if (g_variant_dict_lookup (&dict, "size-installed", "t", &value64))
+		gs_app_set_size_installed (app, GS_SIZE_TYPE_VALID, value64);
+	if (g_variant_dict_lookup (&dict, "release-date", "t", &value64))
+		gs_app_set_release_date (app, value64);
+
+	if (g_variant_dict_lookup (&dict, "quirks", "t", &value64)) {
+		for (guint i = 0; (1u << i) < GS_APP_QUIRK_LAST; i++) {
+			if (value64 & (1u << i))
+				gs_app_add_quirk (app, 1u << i);
+		}
+	}
+
+	icons = g_variant_dict_lookup_value (&dict, "icons", G_VARIANT_TYPE ("a(uuuv)"));
+	for (gsize i = 0; icons != NULL && i < g_variant_n_children (icons); i++) {
+		g_autoptr(GVariant) serialized = NULL;
+		g_autoptr(GIcon) icon = NULL;
+		guint32 width, height, scale;
+
+		g_variant_get_child (icons, i, "(uuuv)", &width, &height, &scale, &serialized);
+		icon = g_icon_deserialize (serialized);
+		if (icon == NULL)
+			continue;
+		gs_icon_set_width (icon, width);
+		gs_icon_set_height (icon, height);
+		gs_icon_set_scale (icon, scale);
+		gs_app_add_icon (app, icon);
+	}
+
+	key_colors = g_variant_dict_lookup_value (&dict, "key-colors", G_VARIANT_TYPE ("a(dddd)"));
+	if (key_colors != NULL && g_variant_n_children (key_colors) > 0) {
+		g_autoptr(GArray) colors = g_array_new (FALSE, FALSE, sizeof (GdkRGBA));
+
+		for (gsize i = 0; i < g_variant_n_children (key_colors); i++) {
+			gdouble red, green, blue, alpha;
+			GdkRGBA color;
+
+			g_variant_get_child (key_colors, i, "(dddd)", &red, &green, &blue, &alpha);
+			color.red = red;
+			color.green = green;
+			color.blue = blue;
+			color.alpha = alpha;
+			g_array_append_val (colors, color);
+		}
+		gs_app_set_key_colors (app, colors);
+	}
+
+	/* set the state last, as it’s what pages watch for changes */
+	if (g_variant_dict_lookup (&dict, "state", "u", &value32) &&
+	    value32 < GS_APP_STATE_LAST)
+		gs_app_set_state (app, (GsAppState) value32);
+
+	gs_app_set_metadata (app, CACHED_APP_METADATA_KEY, "true");
+
+	return g_steal_pointer (&app);
+}
+
+/**
+ * gs_results_cache_serialize:
+ * @list: a #GsAppList
+ *
+ * Serialize the apps in @list into the results cache format.
+ *
+ * Apps which have no ID are skipped.
+ *
+ * Returns: (transfer full): the serialized apps
+ *
+ * Since: 48
+ */
+GBytes *
+gs_results_cache_serialize (GsAppList *list)
+{
+	GVariantBuilder builder;
+	g_autoptr(GVariant) variant = NULL;
+
+	g_return_val_if_fail (GS_IS_APP_LIST (list), NULL);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		GVariant *app_variant = serialize_app (gs_app_list_index (list, i));
+		if (app_variant != NULL)
+			g_variant_builder_add_value (&builder, app_variant);
+	}
+
+	variant = g_variant_ref_sink (g_variant_new ("(u@aa{sv})",
+						     (guint32) RESULTS_CACHE_VERSION,
+						     g_variant_builder_end (&builder)));
+
+	return g_variant_get_data_as_bytes (variant);
+}
+
+/**
+ * gs_results_cache_deserialize:
+ * @bytes: apps serialized with gs_results_cache_serialize()
+ * @error: return location for a #GError, or %NULL
+ *
+ * Create apps from the serialized results in @bytes. The apps are marked so
+ * that gs_results_cache_is_cached_app() returns %TRUE for them.
+ *
+ * Returns: (transfer full): the apps, or %NULL on error
+ *
+ * Since: 48
+ */
+GsAppList *
+gs_results_cache_deserialize (GBytes  *bytes,
+			      GError **error)
+{
+	g_autoptr(GVariant) variant = NULL;
+	g_autoptr(GVariant) apps = NULL;
+	g_autoptr(GsAppList) list = NULL;
+	guint32 version;
+
+	g_return_val_if_fail (bytes != NULL, NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* the file may have been truncated or written by another version */
+	variant = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (RESULTS_CACHE_FORMAT),
+								bytes, FALSE));
+	if (!g_variant_is_normal_form (variant)) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+				     "results cache is corrupt");
+		return NULL;
+	}
+
+	g_variant_get (variant, "(u@aa{sv})", &version, &apps);
+	if (version != RESULTS_CACHE_VERSION) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			     "results cache has unsupported version %u", version);
+		return NULL;
+	}
+
+	list = gs_app_list_new ();
+	for (gsize i = 0; i < g_variant_n_children (apps); i++) {
+		g_autoptr(GVariant) app_variant = g_variant_get_child_value (apps, i);
+		g_autoptr(GsApp) app = deserialize_app (app_variant);
+		if (app != NULL)
+			gs_app_list_add (list, app);
+	}
+
+	return g_steal_pointer (&list);
+}
+
+static gchar *
+get_cache_filename (const gchar  *name,
+		    gboolean      create_directory,
+		    GError      **error)
+{
+	g_autofree gchar *basename = g_strconcat (name, ".gvariant", NULL);
+	GsUtilsCacheFlags flags = GS_UTILS_CACHE_FLAG_WRITEABLE;
+
+	if (create_directory)
+		flags |= GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY;
+
+	return gs_utils_get_cache_filename ("results", basename, flags, error);
+}
+
+static void
+save_cb (GObject      *source_object,
+	 GAsyncResult *result,
+	 gpointer      user_data)
+{
+	GFile *file = G_FILE (source_object);
+	g_autoptr(GError) local_error = NULL;
+
+	if (!g_file_replace_contents_finish (file, result, NULL, &local_error))
+		g_warning ("Failed to save results cache %s: %s",
+			   g_file_peek_path (file), local_error->message);
+}
+
+/**
+ * gs_results_cache_save:
+ * @name: name of the results, such as `installed`
+ * @list: the results to save
+ *
+ * Save @list as the results called @name, replacing any which were saved
+ * before, to be loaded with gs_results_cache_load().
+ *
+ * The apps are serialized before this returns, but the file is written
+ * asynchronously. Errors are only logged, as the cache is not essential.
+ *
+ * Since: 48
+ */
+void
+gs_results_cache_save (const gchar *name,
+		       GsAppList   *list)
+{
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GError) local_error = NULL;
+
+	g_return_if_fail (name != NULL);
+	g_return_if_fail (GS_IS_APP_LIST (list));
+
+	filename = get_cache_filename (name, TRUE, &local_error);
+	if (filename == NULL) {
+		g_warning ("Failed to save results cache %s: %s", name, local_error->message);
+		return;
+	}
+
+	bytes = gs_results_cache_serialize (list);
+	file = g_file_new_for_path (filename);
+	g_file_replace_contents_bytes_async (file, bytes, NULL, FALSE,
+					     G_FILE_CREATE_REPLACE_DESTINATION,
+					     NULL, save_cb, NULL);
+}
+
+/**
+ * gs_results_cache_load:
+ * @name: name of the results, such as `installed`
+ * @error: return location for a #GError, or %NULL
+ *
+ * Load the results called @name which were last saved with
+ * gs_results_cache_save().
+ *
+ * Returns: (transfer full): the apps, or %NULL if none have been saved or on
+ *   error
+ *
+ * Since: 48
+ */
+GsAppList *
+gs_results_cache_load (const gchar  *name,
+		       GError      **error)
+{
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GMappedFile) mapped_file = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+
+	g_return_val_if_fail (name != NULL, NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	filename = get_cache_filename (name, FALSE, error);
+	if (filename == NULL)
+		return NULL;
+
+	mapped_file = g_mapped_file_new (filename, FALSE, error);
+	if (mapped_file == NULL)
+		return NULL;
+
+	bytes = g_mapped_file_get_bytes (mapped_file);
+	return gs_results_cache_deserialize (bytes, error);
+}
+
+/**
+ * gs_results_cache_is_cached_app:
+ * @app: a #GsApp
+ *
+ * Check whether @app was loaded from the results cache, rather than returned
+ * by a plugin, in which case no operations can be done on it.
+ *
+ * Returns: %TRUE if @app was loaded from the results cache
+ *
+ * Since: 48
+ */
+gboolean
+gs_results_cache_is_cached_app (GsApp *app)
+{
+	g_return_val_if_fail (GS_IS_APP (app), FALSE);
+
+	return gs_app_get_metadata_item (app, CACHED_APP_METADATA_KEY) != NULL;
+}
@@ -0,0 +1,29 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Software contributors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include "gs-app.h"
+#include "gs-app-list.h"
+
+G_BEGIN_DECLS
+
+GBytes		*gs_results_cache_serialize		(GsAppList	*list);
+GsAppList	*gs_results_cache_deserialize		(GBytes		*bytes,
+							 GError		**error);
+
+void		 gs_results_cache_save			(const gchar	*name,
+							 GsAppList	*list);
+GsAppList	*gs_results_cache_load			(const gchar	*name,
+							 GError		**error);
+
+gboolean	 gs_results_cache_is_cached_app		(GsApp		*app);
+
+G_END_DECLS
@@ -34,9 +34,7 @@ typedef struct {
 	GError *saved_error;  /* (owned) (nullable) */
 	guint n_pending_ops;
 
-#ifdef HAVE_SYSPROF
 	gint64 begin_time_nsec;
-#endif
 } RewriteResourcesData;
 
 static void
@@ -107,9 +105,7 @@ gs_rewrite_resources_async (GsAppList           *list,
 
 	g_task_set_task_data (task, g_steal_pointer (&data_owned), (GDestroyNotify) rewrite_resources_data_free);
 
-#ifdef HAVE_SYSPROF
-	data->begin_time_nsec = SYSPROF_CAPTURE_CURRENT_TIME;
-#endif
+	data->begin_time_nsec = GS_PROFILER_CURRENT_TIME;
 
 	for (guint i = 0; i < gs_app_list_length (list); i++) {
 		GsApp *app = gs_app_list_index (list, i);
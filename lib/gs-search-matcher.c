@@ -0,0 +1,219 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Software contributors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/**
+ * SECTION:gs-search-matcher
+ * @short_description: Matches a list of apps against search keywords
+ *
+ * #GsSearchMatcher matches the apps in a #GsAppList against search keywords
+ * locally, the same way as a search of the appstream data would match them:
+ * with the same fields, operators, tokenising and stemming, and giving the
+ * same match values. This allows the results of a search to be narrowed down
+ * without running the search through the plugins again.
+ *
+ * Only the fields which are available on the #GsApp are matched, so apps
+ * which a plugin matched on other data (such as keywords) won’t match.
+ *
+ * A #GsSearchMatcher is immutable once created, so can be used from any
+ * thread.
+ *
+ * Since: 48
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "gs-app-query.h"
+#include "gs-appstream.h"
+#include "gs-search-matcher.h"
+
+struct _GsSearchMatcher {
+	gatomicrefcount	 ref_count;
+	guint		 n_apps;
+	XbSilo		*silo;		/* (owned) (nullable) fields of the apps, in order */
+};
+
+/**
+ * gs_search_matcher_new:
+ * @list: the apps to match
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Create a new #GsSearchMatcher for the apps in @list, in their current
+ * order. Later changes to @list or its apps are not seen by it.
+ *
+ * Returns: (transfer full): a new #GsSearchMatcher, or %NULL on error
+ *
+ * Since: 48
+ */
+GsSearchMatcher *
+gs_search_matcher_new (GsAppList     *list,
+		       GCancellable  *cancellable,
+		       GError       **error)
+{
+	g_autoptr(GsSearchMatcher) matcher = g_new0 (GsSearchMatcher, 1);
+
+	g_return_val_if_fail (GS_IS_APP_LIST (list), NULL);
+
+	g_atomic_ref_count_init (&matcher->ref_count);
+	matcher->n_apps = gs_app_list_length (list);
+	if (matcher->n_apps > 0) {
+		matcher->silo = gs_appstream_search_silo_new_for_apps (list, cancellable, error);
+		if (matcher->silo == NULL)
+			return NULL;
+	}
+
+	return g_steal_pointer (&matcher);
+}
+
+/**
+ * gs_search_matcher_ref:
+ * @matcher: a #GsSearchMatcher
+ *
+ * Returns: (transfer full): @matcher
+ *
+ * Since: 48
+ */
+GsSearchMatcher *
+gs_search_matcher_ref (GsSearchMatcher *matcher)
+{
+	g_return_val_if_fail (matcher != NULL, NULL);
+
+	g_atomic_ref_count_inc (&matcher->ref_count);
+	return matcher;
+}
+
+/**
+ * gs_search_matcher_unref:
+ * @matcher: (transfer full): a #GsSearchMatcher
+ *
+ * Since: 48
+ */
+void
+gs_search_matcher_unref (GsSearchMatcher *matcher)
+{
+	g_return_if_fail (matcher != NULL);
+
+	if (!g_atomic_ref_count_dec (&matcher->ref_count))
+		return;
+
+	g_clear_object (&matcher->silo);
+	g_free (matcher);
+}
+
+/**
+ * gs_search_matcher_match:
+ * @matcher: a #GsSearchMatcher
+ * @keywords: (array zero-terminated=1): search keywords, as from
+ *   gs_search_matcher_tokenize()
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Match each of the apps of @matcher against @keywords. The match value of
+ * an app is zero unless it matches *all* of them, and is otherwise the match
+ * value which a search of the appstream data would give it.
+ *
+ * Returns: (transfer full) (array): one match value for each of the apps, in
+ *   order, or %NULL on error; or %NULL with no error if there are no apps
+ *
+ * Since: 48
+ */
+guint16 *
+gs_search_matcher_match (GsSearchMatcher     *matcher,
+			 const gchar * const *keywords,
+			 GCancellable        *cancellable,
+			 GError             **error)
+{
+	guint16 *match_values;
+#if AS_CHECK_VERSION(1, 0, 0)
+	const guint16 id_weight = as_utils_get_tag_search_weight ("id");
+#else
+	const guint16 id_weight = AS_SEARCH_TOKEN_MATCH_ID;
+#endif
+
+	g_return_val_if_fail (matcher != NULL, NULL);
+	g_return_val_if_fail (keywords != NULL, NULL);
+
+	if (matcher->silo == NULL)
+		return NULL;
+
+	match_values = gs_appstream_search_match_apps (matcher->silo, keywords, cancellable, error);
+	if (match_values == NULL)
+		return NULL;
+
+	/* as with gs_appstream_search(), the ID is not visible in the UI so
+	 * don’t use it for prioritising results */
+	for (guint i = 0; i < matcher->n_apps; i++) {
+		if (match_values[i] != 0)
+			match_values[i] = MAX (match_values[i] & ~id_weight, 1);
+	}
+
+	return match_values;
+}
+
+/**
+ * gs_search_matcher_tokenize:
+ * @text: (nullable): search text
+ *
+ * Split @text into keywords exactly as #GsAppQuery does for the plugins.
+ *
+ * Returns: (transfer full) (nullable) (array zero-terminated=1): the
+ *   keywords, or %NULL if @text is %NULL or has none
+ *
+ * Since: 48
+ */
+gchar **
+gs_search_matcher_tokenize (const gchar *text)
+{
+	const gchar *keywords[2] = { text, NULL };
+	g_autoptr(GsAppQuery) query = NULL;
+
+	if (text == NULL)
+		return NULL;
+
+	query = gs_app_query_new ("keywords", keywords, NULL);
+	return g_strdupv ((gchar **) gs_app_query_get_keywords (query));
+}
+
+/**
+ * gs_search_matcher_keyword_narrows:
+ * @keyword: a search keyword
+ * @prev_keyword: a previous search keyword
+ *
+ * Check whether every app which matches @keyword also matches @prev_keyword,
+ * so that the results of searching for @keyword can be found by matching the
+ * results of searching for @prev_keyword.
+ *
+ * @keyword having @prev_keyword as a prefix is not enough for that, as the
+ * keywords are stemmed before being matched, and a longer word can have a
+ * shorter stem. This returns %FALSE whenever it can’t tell.
+ *
+ * Returns: %TRUE if @keyword narrows the results of @prev_keyword
+ *
+ * Since: 48
+ */
+gboolean
+gs_search_matcher_keyword_narrows (const gchar *keyword,
+				   const gchar *prev_keyword)
+{
+	g_autofree gchar *folded = NULL;
+	g_autofree gchar *prev_folded = NULL;
+
+	g_return_val_if_fail (keyword != NULL, FALSE);
+	g_return_val_if_fail (prev_keyword != NULL, FALSE);
+
+	folded = g_utf8_casefold (keyword, -1);
+	prev_folded = g_utf8_casefold (prev_keyword, -1);
+	if (!g_str_has_prefix (folded, prev_folded))
+		return FALSE;
+	if (g_str_equal (folded, prev_folded))
+		return TRUE;
+
+	return gs_appstream_search_keyword_narrows (keyword, prev_keyword);
+}
@@ -0,0 +1,36 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Software contributors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "gs-app-list.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GsSearchMatcher GsSearchMatcher;
+
+GsSearchMatcher	*gs_search_matcher_new			(GsAppList	*list,
+							 GCancellable	*cancellable,
+							 GError		**error);
+GsSearchMatcher	*gs_search_matcher_ref			(GsSearchMatcher *matcher);
+void		 gs_search_matcher_unref		(GsSearchMatcher *matcher);
+
+guint16		*gs_search_matcher_match		(GsSearchMatcher *matcher,
+							 const gchar * const *keywords,
+							 GCancellable	*cancellable,
+							 GError		**error);
+
+gchar		**gs_search_matcher_tokenize		(const gchar	*text);
+gboolean	 gs_search_matcher_keyword_narrows	(const gchar	*keyword,
+							 const gchar	*prev_keyword);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GsSearchMatcher, gs_search_matcher_unref)
+
+G_END_DECLS
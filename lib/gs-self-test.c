@@ -9,9 +9,15 @@
 
 #include "config.h"
 
+#include <fnmatch.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
+
 #include "gnome-software-private.h"
 
+#include "gs-appstream.h"
 #include "gs-debug.h"
+#include "gs-key-colors.h"
 #include "gs-test.h"
 
 static gboolean
@@ -102,6 +108,90 @@ gs_utils_append_kv_func (void)
 	g_assert_cmpstr (str->str, ==, "key: val\n");
 }
 
+static guint64
+file_size_allocated (const gchar *path)
+{
+	GStatBuf st;
+
+	g_assert_cmpint (g_lstat (path, &st), ==, 0);
+	return (guint64) st.st_blocks * 512;
+}
+
+static gboolean
+file_size_exclude_subdir_cb (const gchar *filename,
+			     GFileTest    file_kind,
+			     gpointer     user_data)
+{
+	return g_strcmp0 (filename, "subdir") != 0;
+}
+
+static void
+gs_utils_file_size_func (void)
+{
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *root = NULL;
+	g_autofree gchar *subdir = NULL;
+	g_autofree gchar *file_a = NULL;
+	g_autofree gchar *file_b = NULL;
+	g_autofree gchar *file_c = NULL;
+	g_autofree gchar *hardlink = NULL;
+	g_autofree gchar *symlink_path = NULL;
+	g_autofree gchar *missing = NULL;
+	g_autofree gchar *contents = NULL;
+	gsize contents_size = 64 * 1024;
+	guint64 expected;
+
+	root = g_dir_make_tmp ("gs-self-test-file-size-XXXXXX", &error);
+	g_assert_no_error (error);
+	subdir = g_build_filename (root, "subdir", NULL);
+	file_a = g_build_filename (root, "a", NULL);
+	file_b = g_build_filename (subdir, "b", NULL);
+	file_c = g_build_filename (subdir, "c", NULL);
+	hardlink = g_build_filename (subdir, "a-link", NULL);
+	symlink_path = g_build_filename (subdir, "root-link", NULL);
+	missing = g_build_filename (root, "missing", NULL);
+
+	contents = g_malloc (contents_size);
+	memset (contents, 'x', contents_size);
+	g_assert_cmpint (g_mkdir (subdir, 0755), ==, 0);
+	g_file_set_contents (file_a, contents, contents_size, &error);
+	g_assert_no_error (error);
+	g_file_set_contents (file_b, contents, contents_size / 2, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (link (file_a, hardlink), ==, 0);
+	g_assert_cmpint (symlink (root, symlink_path), ==, 0);
+
+	/* a plain file */
+	g_assert_cmpuint (gs_utils_get_file_size (file_a, NULL, NULL, NULL), ==, file_size_allocated (file_a));
+
+	/* the hard link is counted once, and the symlink isn’t followed */
+	expected = file_size_allocated (root) + file_size_allocated (subdir) +
+		   file_size_allocated (file_a) + file_size_allocated (file_b) +
+		   file_size_allocated (symlink_path);
+	g_assert_cmpuint (gs_utils_get_file_size (root, NULL, NULL, NULL), ==, expected);
+
+	/* the second time comes from the cache */
+	g_assert_cmpuint (gs_utils_get_file_size (root, NULL, NULL, NULL), ==, expected);
+
+	/* adding a file modifies its directory, so is noticed */
+	g_file_set_contents (file_c, contents, contents_size, &error);
+	g_assert_no_error (error);
+	expected = file_size_allocated (root) + file_size_allocated (subdir) +
+		   file_size_allocated (file_a) + file_size_allocated (file_b) +
+		   file_size_allocated (file_c) + file_size_allocated (symlink_path);
+	g_assert_cmpuint (gs_utils_get_file_size (root, NULL, NULL, NULL), ==, expected);
+
+	/* excluded directories aren’t descended into */
+	expected = file_size_allocated (root) + file_size_allocated (file_a);
+	g_assert_cmpuint (gs_utils_get_file_size (root, file_size_exclude_subdir_cb, NULL, NULL), ==, expected);
+
+	/* missing files have no size */
+	g_assert_cmpuint (gs_utils_get_file_size (missing, NULL, NULL, NULL), ==, 0);
+
+	gs_utils_rmtree (root, &error);
+	g_assert_no_error (error);
+}
+
 static void
 gs_utils_cache_func (void)
 {
@@ -211,6 +301,722 @@ gs_plugin_download_rewrite_func (void)
 	g_assert (css != NULL);
 }
 
+typedef struct {
+	GBytes *content;  /* (owned) */
+	const gchar *etag;
+	guint n_requests;
+	gchar *last_range;  /* (owned) (nullable) */
+} DownloadTestServer;
+
+/* Serve @server->content, resuming from the requested offset if the If-Range
+ * validator matches, as a real server would. Returns the status, and the
+ * offset to serve from in @start_out. */
+static guint
+download_test_server_handle (DownloadTestServer *server,
+			     SoupMessageHeaders *request_headers,
+			     SoupMessageHeaders *response_headers,
+			     goffset            *start_out)
+{
+	gsize content_size = g_bytes_get_size (server->content);
+	const gchar *range = soup_message_headers_get_one (request_headers, "Range");
+	const gchar *if_range = soup_message_headers_get_one (request_headers, "If-Range");
+	gchar *endptr = NULL;
+	guint64 start = 0;
+
+	server->n_requests++;
+	g_free (server->last_range);
+	server->last_range = g_strdup (range);
+
+	soup_message_headers_replace (response_headers, "ETag", server->etag);
+	*start_out = 0;
+
+	if (range != NULL && g_str_has_prefix (range, "bytes="))
+		start = g_ascii_strtoull (range + strlen ("bytes="), &endptr, 10);
+
+	if (endptr == NULL || *endptr != '-' || g_strcmp0 (if_range, server->etag) != 0) {
+		/* Stop libsoup from answering the range request itself. */
+		soup_message_headers_remove (request_headers, "Range");
+		return SOUP_STATUS_OK;
+	}
+
+	if (start >= content_size) {
+		g_autofree gchar *content_range = g_strdup_printf ("bytes */%" G_GSIZE_FORMAT, content_size);
+		soup_message_headers_replace (response_headers, "Content-Range", content_range);
+		return SOUP_STATUS_REQUESTED_RANGE_NOT_SATISFIABLE;
+	}
+
+	soup_message_headers_set_content_range (response_headers, start, content_size - 1, content_size);
+	*start_out = start;
+
+	return SOUP_STATUS_PARTIAL_CONTENT;
+}
+
+#if SOUP_CHECK_VERSION(3, 0, 0)
+static void
+download_test_server_cb (SoupServer        *soup_server,
+			 SoupServerMessage *msg,
+			 const char        *path,
+			 GHashTable        *query,
+			 gpointer           user_data)
+{
+	DownloadTestServer *server = user_data;
+	const guint8 *content = g_bytes_get_data (server->content, NULL);
+	goffset start;
+	guint status;
+
+	status = download_test_server_handle (server,
+					      soup_server_message_get_request_headers (msg),
+					      soup_server_message_get_response_headers (msg),
+					      &start);
+	soup_server_message_set_status (msg, status, NULL);
+	if (status != SOUP_STATUS_REQUESTED_RANGE_NOT_SATISFIABLE)
+		soup_server_message_set_response (msg, "application/octet-stream", SOUP_MEMORY_COPY,
+						  (const gchar *) content + start,
+						  g_bytes_get_size (server->content) - start);
+}
+#else
+static void
+download_test_server_cb (SoupServer        *soup_server,
+			 SoupMessage       *msg,
+			 const char        *path,
+			 GHashTable        *query,
+			 SoupClientContext *client,
+			 gpointer           user_data)
+{
+	DownloadTestServer *server = user_data;
+	const guint8 *content = g_bytes_get_data (server->content, NULL);
+	goffset start;
+	guint status;
+
+	status = download_test_server_handle (server, msg->request_headers, msg->response_headers, &start);
+	soup_message_set_status (msg, status);
+	if (status != SOUP_STATUS_REQUESTED_RANGE_NOT_SATISFIABLE)
+		soup_message_set_response (msg, "application/octet-stream", SOUP_MEMORY_COPY,
+					   (const gchar *) content + start,
+					   g_bytes_get_size (server->content) - start);
+}
+#endif
+
+/* Serve @server on a local port, and return the URI of its file. */
+static gchar *
+download_test_server_listen (SoupServer         *soup_server,
+			     DownloadTestServer *server)
+{
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *base_uri = NULL;
+	GSList *uris;
+
+	soup_server_add_handler (soup_server, "/file", download_test_server_cb, server, NULL);
+	soup_server_listen_local (soup_server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &error);
+	g_assert_no_error (error);
+	uris = soup_server_get_uris (soup_server);
+#if SOUP_CHECK_VERSION(3, 0, 0)
+	base_uri = g_uri_to_string (uris->data);
+	g_slist_free_full (uris, (GDestroyNotify) g_uri_unref);
+#else
+	base_uri = soup_uri_to_string (uris->data, FALSE);
+	g_slist_free_full (uris, (GDestroyNotify) soup_uri_free);
+#endif
+
+	return g_strconcat (base_uri, "file", NULL);
+}
+
+static void
+download_cancel_progress_cb (gsize    bytes_downloaded,
+			     gsize    total_download_size,
+			     gpointer user_data)
+{
+	GCancellable *cancellable = G_CANCELLABLE (user_data);
+
+	/* interrupt the download part of the way through */
+	if (bytes_downloaded > 0 && bytes_downloaded < total_download_size)
+		g_cancellable_cancel (cancellable);
+}
+
+/* Resume downloading @uri into a memory stream which already contains
+ * @initial, and return what the stream contains afterwards. */
+static GBytes *
+download_test_resume (SoupSession   *soup_session,
+		      GMainContext  *context,
+		      const gchar   *uri,
+		      GBytes        *initial,
+		      const gchar   *resume_validator,
+		      GCancellable  *cancellable,
+		      gchar        **new_etag_out,
+		      GError       **error)
+{
+	g_autoptr(GOutputStream) output_stream = g_memory_output_stream_new_resizable ();
+	g_autoptr(GAsyncResult) result = NULL;
+	gsize initial_size = (initial != NULL) ? g_bytes_get_size (initial) : 0;
+
+	if (initial != NULL)
+		g_assert_true (g_output_stream_write_all (output_stream, g_bytes_get_data (initial, NULL),
+							  initial_size, NULL, NULL, NULL));
+
+	gs_download_stream_resume_async (soup_session, uri, output_stream,
+					 initial_size, resume_validator, NULL, NULL,
+					 G_PRIORITY_DEFAULT,
+					 (cancellable != NULL) ? download_cancel_progress_cb : NULL, cancellable,
+					 cancellable, async_result_cb, &result);
+
+	while (result == NULL)
+		g_main_context_iteration (context, TRUE);
+
+	gs_download_stream_finish (soup_session, result, new_etag_out, NULL, error);
+
+	return g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (output_stream));
+}
+
+static void
+gs_download_resume_func (void)
+{
+	g_autoptr(GMainContext) context = g_main_context_new ();
+	g_autoptr(GMainContextPusher) context_pusher = g_main_context_pusher_new (context);
+	g_autoptr(SoupServer) soup_server = NULL;
+	g_autoptr(SoupSession) soup_session = NULL;
+	g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GBytes) partial = NULL;
+	g_autoptr(GBytes) longer = NULL;
+	g_autoptr(GBytes) downloaded = NULL;
+	g_autoptr(GFile) output_file = NULL;
+	g_autoptr(GFile) part_file = NULL;
+	g_autoptr(GAsyncResult) result = NULL;
+	g_autofree gchar *uri = NULL;
+	g_autofree gchar *new_etag = NULL;
+	g_autofree gchar *resume_validator = NULL;
+	g_autofree gchar *expected_range = NULL;
+	g_autofree gchar *file_contents = NULL;
+	g_autofree guint8 *content = NULL;
+	gsize content_size = 256 * 1024;
+	gsize file_size;
+	DownloadTestServer server = { NULL, "\"v1\"", 0, NULL };
+
+	content = g_malloc (content_size + 16);
+	for (gsize i = 0; i < content_size + 16; i++)
+		content[i] = (guint8) (i * 7);
+	server.content = g_bytes_new_static (content, content_size);
+
+	soup_server = soup_server_new (NULL, NULL);
+	uri = download_test_server_listen (soup_server, &server);
+
+	soup_session = gs_build_soup_session ();
+
+	/* interrupt a download part of the way through */
+	partial = download_test_resume (soup_session, context, uri, NULL, NULL, cancellable, &new_etag, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	g_clear_error (&error);
+	g_assert_cmpuint (g_bytes_get_size (partial), >, 0);
+	g_assert_cmpuint (g_bytes_get_size (partial), <, content_size);
+	g_assert_cmpmem (g_bytes_get_data (partial, NULL), g_bytes_get_size (partial),
+			 content, g_bytes_get_size (partial));
+	g_assert_cmpstr (new_etag, ==, server.etag);
+	g_assert_null (server.last_range);
+
+	/* resuming it only downloads the rest */
+	resume_validator = gs_download_get_resume_validator (new_etag, NULL);
+	g_assert_cmpstr (resume_validator, ==, server.etag);
+	downloaded = download_test_resume (soup_session, context, uri, partial, resume_validator, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpmem (g_bytes_get_data (downloaded, NULL), g_bytes_get_size (downloaded),
+			 content, content_size);
+	expected_range = g_strdup_printf ("bytes=%" G_GSIZE_FORMAT "-", g_bytes_get_size (partial));
+	g_assert_cmpstr (server.last_range, ==, expected_range);
+	g_assert_cmpuint (server.n_requests, ==, 2);
+	g_clear_pointer (&downloaded, g_bytes_unref);
+
+	/* if the file has changed since, all of it is downloaded again */
+	server.etag = "\"v2\"";
+	downloaded = download_test_resume (soup_session, context, uri, partial, resume_validator, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpmem (g_bytes_get_data (downloaded, NULL), g_bytes_get_size (downloaded),
+			 content, content_size);
+	g_assert_cmpuint (server.n_requests, ==, 3);
+	g_clear_pointer (&downloaded, g_bytes_unref);
+
+	/* a partial download longer than the file is thrown away */
+	longer = g_bytes_new_static (content, content_size + 16);
+	downloaded = download_test_resume (soup_session, context, uri, longer, server.etag, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpmem (g_bytes_get_data (downloaded, NULL), g_bytes_get_size (downloaded),
+			 content, content_size);
+	g_assert_null (server.last_range);
+	g_assert_cmpuint (server.n_requests, ==, 5);
+	g_clear_pointer (&downloaded, g_bytes_unref);
+
+	/* downloading to a file goes through a .part file */
+	output_file = g_file_new_build_filename (g_get_user_cache_dir (), "download-test", "file", NULL);
+	part_file = g_file_new_build_filename (g_get_user_cache_dir (), "download-test", "file.part", NULL);
+	gs_download_file_async (soup_session, uri, output_file, G_PRIORITY_DEFAULT,
+				NULL, NULL, NULL, async_result_cb, &result);
+
+	while (result == NULL)
+		g_main_context_iteration (context, TRUE);
+
+	gs_download_file_finish (soup_session, result, &error);
+	g_assert_no_error (error);
+	g_assert_true (g_file_load_contents (output_file, NULL, &file_contents, &file_size, NULL, &error));
+	g_assert_no_error (error);
+	g_assert_cmpmem (file_contents, file_size, content, content_size);
+	g_assert_false (g_file_query_exists (part_file, NULL));
+
+	g_free (server.last_range);
+	g_bytes_unref (server.content);
+}
+
+typedef struct {
+	GPtrArray *order;  /* (element-type utf8) (unowned) */
+	const gchar *label;
+	GBytes *bytes;  /* (owned) (nullable) */
+	GError *error;  /* (owned) (nullable) */
+	gboolean done;
+} DownloadSchedulerRequest;
+
+static void
+download_scheduler_request_cb (GObject      *source_object,
+			       GAsyncResult *result,
+			       gpointer      user_data)
+{
+	DownloadSchedulerRequest *request = user_data;
+
+	request->bytes = gs_download_scheduler_download_bytes_finish (GS_DOWNLOAD_SCHEDULER (source_object),
+								      result, &request->error);
+	request->done = TRUE;
+	if (request->order != NULL)
+		g_ptr_array_add (request->order, (gpointer) request->label);
+
+	g_main_context_wakeup (g_main_context_get_thread_default ());
+}
+
+static void
+download_scheduler_request_clear (DownloadSchedulerRequest *request)
+{
+	g_clear_pointer (&request->bytes, g_bytes_unref);
+	g_clear_error (&request->error);
+	request->done = FALSE;
+}
+
+static void
+gs_download_scheduler_func (void)
+{
+	g_autoptr(GMainContext) context = g_main_context_new ();
+	g_autoptr(GMainContextPusher) context_pusher = g_main_context_pusher_new (context);
+	g_autoptr(GsDownloadScheduler) scheduler = gs_download_scheduler_new ();
+	g_autoptr(SoupServer) soup_server = NULL;
+	g_autoptr(SoupSession) soup_session = NULL;
+	g_autoptr(GCancellable) cancellable = NULL;
+	g_autoptr(GPtrArray) order = g_ptr_array_new ();
+	g_autofree gchar *uri = NULL;
+	g_autofree gchar *uri_a = NULL;
+	g_autofree gchar *uri_b = NULL;
+	g_autofree gchar *uri_c = NULL;
+	DownloadSchedulerRequest requests[3] = { { NULL, }, };
+	DownloadTestServer server = { NULL, "\"v1\"", 0, NULL };
+	const gchar *content = "screenshot";
+
+	server.content = g_bytes_new_static (content, strlen (content));
+	soup_server = soup_server_new (NULL, NULL);
+	uri = download_test_server_listen (soup_server, &server);
+	uri_a = g_strconcat (uri, "/a", NULL);
+	uri_b = g_strconcat (uri, "/b", NULL);
+	uri_c = g_strconcat (uri, "/c", NULL);
+	soup_session = gs_build_soup_session ();
+
+	g_assert_cmpuint (gs_download_scheduler_get_max_per_host (scheduler), ==,
+			  GS_DOWNLOAD_SCHEDULER_MAX_PER_HOST_DEFAULT);
+
+	/* overlapping requests for the same URI share one download */
+	for (guint i = 0; i < G_N_ELEMENTS (requests); i++)
+		gs_download_scheduler_download_bytes_async (scheduler, soup_session, uri, NULL,
+							    G_PRIORITY_DEFAULT, NULL,
+							    download_scheduler_request_cb, &requests[i]);
+	while (!requests[0].done || !requests[1].done || !requests[2].done)
+		g_main_context_iteration (context, TRUE);
+
+	g_assert_cmpuint (server.n_requests, ==, 1);
+	for (guint i = 0; i < G_N_ELEMENTS (requests); i++) {
+		g_assert_no_error (requests[i].error);
+		g_assert_cmpmem (g_bytes_get_data (requests[i].bytes, NULL), g_bytes_get_size (requests[i].bytes),
+				 content, strlen (content));
+		download_scheduler_request_clear (&requests[i]);
+	}
+
+	/* cancelling one request doesn’t affect the others sharing its download */
+	cancellable = g_cancellable_new ();
+	gs_download_scheduler_download_bytes_async (scheduler, soup_session, uri, NULL,
+						    G_PRIORITY_DEFAULT, cancellable,
+						    download_scheduler_request_cb, &requests[0]);
+	gs_download_scheduler_download_bytes_async (scheduler, soup_session, uri, NULL,
+						    G_PRIORITY_DEFAULT, NULL,
+						    download_scheduler_request_cb, &requests[1]);
+	g_cancellable_cancel (cancellable);
+	while (!requests[0].done || !requests[1].done)
+		g_main_context_iteration (context, TRUE);
+
+	g_assert_error (requests[0].error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	g_assert_no_error (requests[1].error);
+	g_assert_cmpuint (g_bytes_get_size (requests[1].bytes), ==, strlen (content));
+	g_assert_cmpuint (server.n_requests, ==, 2);
+	download_scheduler_request_clear (&requests[0]);
+	download_scheduler_request_clear (&requests[1]);
+	g_clear_object (&cancellable);
+
+	/* once every request is cancelled, the download is dropped, and a new
+	 * request for the same URI starts afresh rather than joining it */
+	cancellable = g_cancellable_new ();
+	gs_download_scheduler_download_bytes_async (scheduler, soup_session, uri, NULL,
+						    G_PRIORITY_DEFAULT, cancellable,
+						    download_scheduler_request_cb, &requests[0]);
+	g_cancellable_cancel (cancellable);
+	while (!requests[0].done)
+		g_main_context_iteration (context, TRUE);
+
+	g_assert_error (requests[0].error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	download_scheduler_request_clear (&requests[0]);
+	g_clear_object (&cancellable);
+
+	gs_download_scheduler_download_bytes_async (scheduler, soup_session, uri, NULL,
+						    G_PRIORITY_DEFAULT, NULL,
+						    download_scheduler_request_cb, &requests[0]);
+	while (!requests[0].done)
+		g_main_context_iteration (context, TRUE);
+
+	g_assert_no_error (requests[0].error);
+	g_assert_cmpuint (g_bytes_get_size (requests[0].bytes), ==, strlen (content));
+	download_scheduler_request_clear (&requests[0]);
+
+	/* with one download per host, queued downloads run in order of
+	 * priority rather than of request */
+	gs_download_scheduler_set_max_per_host (scheduler, 1);
+	requests[0] = (DownloadSchedulerRequest) { order, "a", NULL, NULL, FALSE };
+	requests[1] = (DownloadSchedulerRequest) { order, "b", NULL, NULL, FALSE };
+	requests[2] = (DownloadSchedulerRequest) { order, "c", NULL, NULL, FALSE };
+	gs_download_scheduler_download_bytes_async (scheduler, soup_session, uri_a, NULL,
+						    G_PRIORITY_LOW, NULL,
+						    download_scheduler_request_cb, &requests[0]);
+	gs_download_scheduler_download_bytes_async (scheduler, soup_session, uri_b, NULL,
+						    G_PRIORITY_LOW, NULL,
+						    download_scheduler_request_cb, &requests[1]);
+	gs_download_scheduler_download_bytes_async (scheduler, soup_session, uri_c, NULL,
+						    G_PRIORITY_DEFAULT, NULL,
+						    download_scheduler_request_cb, &requests[2]);
+	while (!requests[0].done || !requests[1].done || !requests[2].done)
+		g_main_context_iteration (context, TRUE);
+
+	g_assert_cmpuint (order->len, ==, 3);
+	g_assert_cmpstr (g_ptr_array_index (order, 0), ==, "a");
+	g_assert_cmpstr (g_ptr_array_index (order, 1), ==, "c");
+	g_assert_cmpstr (g_ptr_array_index (order, 2), ==, "b");
+	for (guint i = 0; i < G_N_ELEMENTS (requests); i++) {
+		g_assert_no_error (requests[i].error);
+		download_scheduler_request_clear (&requests[i]);
+	}
+
+	g_free (server.last_range);
+	g_bytes_unref (server.content);
+}
+
+static guint
+icon_downloader_count_available (GsApp **apps,
+				 guint   n_apps)
+{
+	guint n_available = 0;
+
+	for (guint i = 0; i < n_apps; i++) {
+		if (gs_app_get_icons_state (apps[i]) == GS_APP_ICONS_STATE_AVAILABLE)
+			n_available++;
+	}
+
+	return n_available;
+}
+
+static void
+gs_icon_downloader_func (void)
+{
+	g_autoptr(GsIconDownloader) icon_downloader = NULL;
+	g_autoptr(SoupServer) soup_server = NULL;
+	g_autoptr(SoupSession) soup_session = NULL;
+	g_autoptr(GdkPixbuf) pixbuf = NULL;
+	g_autoptr(GAsyncResult) result = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *uri = NULL;
+	g_autofree gchar *png = NULL;
+	gsize png_size = 0;
+	GsApp *apps[6] = { NULL, };
+	DownloadTestServer server = { NULL, "\"v1\"", 0, NULL };
+
+	/* serve a small PNG for every icon */
+	pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 16, 16);
+	gdk_pixbuf_fill (pixbuf, 0xff0000ff);
+	g_assert_true (gdk_pixbuf_save_to_buffer (pixbuf, &png, &png_size, "png", &error, NULL));
+	g_assert_no_error (error);
+	server.content = g_bytes_new_static (png, png_size);
+
+	/* the server runs in, and app notifications are sent to, the global
+	 * default main context, which the downloads don’t block */
+	soup_server = soup_server_new (NULL, NULL);
+	uri = download_test_server_listen (soup_server, &server);
+	soup_session = gs_build_soup_session ();
+	icon_downloader = gs_icon_downloader_new (soup_session, 64);
+
+	/* queue several apps at once, each with its own remote icons */
+	for (guint i = 0; i < G_N_ELEMENTS (apps); i++) {
+		g_autofree gchar *id = g_strdup_printf ("icon%u.desktop", i);
+		g_autofree gchar *icon_uri1 = g_strdup_printf ("%s/%u-1.png", uri, i);
+		g_autofree gchar *icon_uri2 = g_strdup_printf ("%s/%u-2.png", uri, i);
+		g_autoptr(GIcon) icon1 = gs_remote_icon_new (icon_uri1);
+		g_autoptr(GIcon) icon2 = gs_remote_icon_new (icon_uri2);
+
+		apps[i] = gs_app_new (id);
+		gs_app_add_icon (apps[i], icon1);
+		gs_app_add_icon (apps[i], icon2);
+		gs_icon_downloader_queue_app (icon_downloader, apps[i], (i % 2) == 0);
+		g_assert_cmpint (gs_app_get_icons_state (apps[i]), !=, GS_APP_ICONS_STATE_AVAILABLE);
+	}
+
+	while (icon_downloader_count_available (apps, G_N_ELEMENTS (apps)) < G_N_ELEMENTS (apps))
+		g_main_context_iteration (NULL, TRUE);
+
+	/* every icon was downloaded once, and is now in the cache */
+	g_assert_cmpuint (server.n_requests, ==, 2 * G_N_ELEMENTS (apps));
+	for (guint i = 0; i < G_N_ELEMENTS (apps); i++) {
+		g_autoptr(GPtrArray) icons = gs_app_dup_icons (apps[i]);
+
+		g_assert_nonnull (icons);
+		g_assert_cmpuint (icons->len, ==, 2);
+		for (guint j = 0; j < icons->len; j++) {
+			GIcon *icon = g_ptr_array_index (icons, j);
+
+			g_assert_true (GS_IS_REMOTE_ICON (icon));
+			g_assert_true (g_file_query_exists (g_file_icon_get_file (G_FILE_ICON (icon)), NULL));
+			g_assert_cmpint (GPOINTER_TO_INT (g_object_get_data (G_OBJECT (icon), "width")), ==, 16);
+		}
+	}
+
+	/* queueing the apps again doesn’t download the cached icons again */
+	for (guint i = 0; i < G_N_ELEMENTS (apps); i++)
+		gs_app_set_icons_state (apps[i], GS_APP_ICONS_STATE_UNKNOWN);
+	for (guint i = 0; i < G_N_ELEMENTS (apps); i++)
+		gs_icon_downloader_queue_app (icon_downloader, apps[i], FALSE);
+	while (icon_downloader_count_available (apps, G_N_ELEMENTS (apps)) < G_N_ELEMENTS (apps))
+		g_main_context_iteration (NULL, TRUE);
+	g_assert_cmpuint (server.n_requests, ==, 2 * G_N_ELEMENTS (apps));
+
+	/* shutting down cancels the queued downloads, and drains them all
+	 * before completing */
+	for (guint i = 0; i < G_N_ELEMENTS (apps); i++) {
+		g_autofree gchar *icon_uri = g_strdup_printf ("%s/%u-3.png", uri, i);
+		g_autoptr(GIcon) icon = gs_remote_icon_new (icon_uri);
+
+		gs_app_set_icons_state (apps[i], GS_APP_ICONS_STATE_UNKNOWN);
+		gs_app_add_icon (apps[i], icon);
+		gs_icon_downloader_queue_app (icon_downloader, apps[i], FALSE);
+	}
+
+	gs_icon_downloader_shutdown_async (icon_downloader, NULL, async_result_cb, &result);
+	while (result == NULL)
+		g_main_context_iteration (NULL, TRUE);
+	g_assert_true (gs_icon_downloader_shutdown_finish (icon_downloader, result, &error));
+	g_assert_no_error (error);
+	g_assert_cmpuint (icon_downloader_count_available (apps, G_N_ELEMENTS (apps)), ==, G_N_ELEMENTS (apps));
+
+	/* apps queued after shutdown aren’t downloaded */
+	gs_app_set_icons_state (apps[0], GS_APP_ICONS_STATE_UNKNOWN);
+	gs_icon_downloader_queue_app (icon_downloader, apps[0], TRUE);
+	g_assert_cmpint (gs_app_get_icons_state (apps[0]), ==, GS_APP_ICONS_STATE_AVAILABLE);
+
+	for (guint i = 0; i < G_N_ELEMENTS (apps); i++)
+		g_object_unref (apps[i]);
+	g_free (server.last_range);
+	g_bytes_unref (server.content);
+}
+
+/* refines @app_id with a new provider, so the ratings are loaded from disk
+ * again, and returns its number of 5-star ratings */
+static guint32
+odrs_ratings_cache_get_star5 (const gchar *app_id)
+{
+	g_autoptr(SoupSession) soup_session = gs_build_soup_session ();
+	g_autoptr(GsOdrsProvider) provider = NULL;
+	g_autoptr(GsApp) app = gs_app_new (app_id);
+	g_autoptr(GsAppList) list = gs_app_list_new ();
+	g_autoptr(GAsyncResult) result = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GMainContext) context = g_main_context_new ();
+	g_autoptr(GMainContextPusher) context_pusher = g_main_context_pusher_new (context);
+	GArray *review_ratings;
+
+	provider = gs_odrs_provider_new ("https://odrs.invalid/1.0/reviews/api",
+					 "0123456789abcdef", "test", 0, 10,
+					 soup_session);
+	gs_app_list_add (list, app);
+	gs_odrs_provider_refine_async (provider, list,
+				       GS_ODRS_PROVIDER_REFINE_FLAGS_GET_RATINGS,
+				       NULL, async_result_cb, &result);
+
+	while (result == NULL)
+		g_main_context_iteration (context, TRUE);
+
+	g_assert_true (gs_odrs_provider_refine_finish (provider, result, &error));
+	g_assert_no_error (error);
+
+	review_ratings = gs_app_get_review_ratings (app);
+	if (review_ratings == NULL)
+		return 0;
+	g_assert_cmpuint (review_ratings->len, ==, 6);
+	return g_array_index (review_ratings, guint32, 5);
+}
+
+static void
+gs_odrs_ratings_cache_func (void)
+{
+	g_autofree gchar *json_filename = NULL;
+	g_autofree gchar *cache_filename = NULL;
+	g_autofree gchar *dirname = NULL;
+	g_autofree gchar *cache = NULL;
+	g_autofree gchar *corrupt = NULL;
+	gsize cache_size = 0;
+	guint32 offsets[2];
+	g_autoptr(GError) error = NULL;
+	const gchar *json =
+		"{"
+		"  \"org.example.B\": { \"star0\": 0, \"star1\": 1, \"star2\": 0, \"star3\": 0, \"star4\": 0, \"star5\": 20 },"
+		"  \"org.example.A\": { \"star0\": 0, \"star1\": 0, \"star2\": 2, \"star3\": 0, \"star4\": 0, \"star5\": 10 },"
+		"  \"org.example.C\": { \"star0\": 0, \"star1\": 0, \"star2\": 0, \"star3\": 3, \"star4\": 0, \"star5\": 30 }"
+		"}";
+
+	/* the ratings are loaded from the local JSON when offline */
+	json_filename = gs_utils_get_cache_filename ("odrs",
+						     "ratings.json",
+						     GS_UTILS_CACHE_FLAG_WRITEABLE |
+						     GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
+						     &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (json_filename);
+	g_assert_true (g_file_set_contents (json_filename, json, -1, &error));
+	g_assert_no_error (error);
+	dirname = g_path_get_dirname (json_filename);
+	cache_filename = g_build_filename (dirname, "ratings.bin", NULL);
+	g_assert_false (g_file_test (cache_filename, G_FILE_TEST_EXISTS));
+
+	/* parsing the JSON writes the binary cache */
+	g_assert_cmpuint (odrs_ratings_cache_get_star5 ("org.example.A"), ==, 10);
+	g_assert_true (g_file_get_contents (cache_filename, &cache, &cache_size, &error));
+	g_assert_no_error (error);
+
+	/* which gives the same ratings when it’s loaded back */
+	g_assert_cmpuint (odrs_ratings_cache_get_star5 ("org.example.A"), ==, 10);
+	g_assert_cmpuint (odrs_ratings_cache_get_star5 ("org.example.B"), ==, 20);
+	g_assert_cmpuint (odrs_ratings_cache_get_star5 ("org.example.C"), ==, 30);
+	g_assert_cmpuint (odrs_ratings_cache_get_star5 ("org.example.D"), ==, 0);
+
+	/* swap the app IDs of the first two records (after the 24-byte header,
+	 * each record is an offset and 6 counts), so the cache is valid apart
+	 * from its ordering */
+	g_assert_cmpuint (cache_size, >, 24 + 2 * 28);
+	corrupt = g_memdup2 (cache, cache_size);
+	memcpy (&offsets[0], corrupt + 24, sizeof (guint32));
+	memcpy (&offsets[1], corrupt + 24 + 28, sizeof (guint32));
+	memcpy (corrupt + 24, &offsets[1], sizeof (guint32));
+	memcpy (corrupt + 24 + 28, &offsets[0], sizeof (guint32));
+	g_assert_true (g_file_set_contents (cache_filename, corrupt, cache_size, &error));
+	g_assert_no_error (error);
+
+	/* the unsorted cache is ignored and rebuilt from the JSON, rather than
+	 * giving A’s ratings to B */
+	g_assert_cmpuint (odrs_ratings_cache_get_star5 ("org.example.B"), ==, 20);
+	g_clear_pointer (&corrupt, g_free);
+	g_assert_true (g_file_get_contents (cache_filename, &corrupt, NULL, &error));
+	g_assert_no_error (error);
+	g_assert_cmpmem (corrupt, cache_size, cache, cache_size);
+	g_assert_cmpuint (odrs_ratings_cache_get_star5 ("org.example.A"), ==, 10);
+}
+
+static void
+gs_app_cache_func (void)
+{
+	g_autoptr(GsAppCache) cache = gs_app_cache_new ();
+	g_autoptr(GsApp) held = NULL;
+	g_autoptr(GsApp) app = NULL;
+	guint64 hits, misses, evictions;
+
+	gs_app_cache_set_max_size (cache, 2);
+
+	/* an installed app, which is never evicted */
+	app = gs_app_new ("installed");
+	gs_app_set_state (app, GS_APP_STATE_INSTALLED);
+	gs_app_cache_add (cache, "installed", app);
+	g_clear_object (&app);
+
+	/* an app still used elsewhere, which is never evicted */
+	held = gs_app_new ("held");
+	gs_app_cache_add (cache, "held", held);
+
+	for (guint i = 0; i < 3; i++) {
+		g_autofree gchar *id = g_strdup_printf ("available%u", i);
+		app = gs_app_new (id);
+		gs_app_set_state (app, GS_APP_STATE_AVAILABLE);
+		gs_app_cache_add (cache, id, app);
+		g_clear_object (&app);
+	}
+
+	/* the unused available apps were evicted, oldest first, to get back
+	 * as close to the limit as possible */
+	g_assert_cmpuint (gs_app_cache_get_size (cache), ==, 3);
+	app = gs_app_cache_lookup (cache, "installed");
+	g_assert_nonnull (app);
+	g_clear_object (&app);
+	app = gs_app_cache_lookup (cache, "held");
+	g_assert_true (app == held);
+	g_clear_object (&app);
+	app = gs_app_cache_lookup (cache, "available0");
+	g_assert_null (app);
+	app = gs_app_cache_lookup (cache, "available2");
+	g_assert_nonnull (app);
+	g_clear_object (&app);
+
+	gs_app_cache_get_stats (cache, &hits, &misses, &evictions);
+	g_assert_cmpuint (hits, ==, 3);
+	g_assert_cmpuint (misses, ==, 1);
+	g_assert_cmpuint (evictions, ==, 2);
+
+	/* recently used apps get a second chance */
+	gs_app_cache_set_max_size (cache, 0);
+	app = gs_app_new ("available3");
+	gs_app_cache_add (cache, "available3", app);
+	g_clear_object (&app);
+	app = gs_app_cache_lookup (cache, "available2");
+	g_clear_object (&app);
+	gs_app_cache_set_max_size (cache, 3);
+	app = gs_app_cache_lookup (cache, "available2");
+	g_assert_nonnull (app);
+	g_clear_object (&app);
+	app = gs_app_cache_lookup (cache, "available3");
+	g_assert_null (app);
+
+	/* looking up a batch of keys */
+	{
+		const gchar *keys[] = { "held", "available0", "installed", "available2" };
+		GsApp *apps[G_N_ELEMENTS (keys)];
+
+		g_assert_cmpuint (gs_app_cache_lookup_many (cache, keys, G_N_ELEMENTS (keys), apps), ==, 3);
+		g_assert_true (apps[0] == held);
+		g_assert_null (apps[1]);
+		g_assert_nonnull (apps[2]);
+		g_assert_cmpstr (gs_app_get_id (apps[2]), ==, "installed");
+		g_assert_nonnull (apps[3]);
+		g_assert_cmpstr (gs_app_get_id (apps[3]), ==, "available2");
+		for (gsize i = 0; i < G_N_ELEMENTS (apps); i++)
+			g_clear_object (&apps[i]);
+	}
+
+	/* removing and clearing */
+	gs_app_cache_remove (cache, "held");
+	g_assert_cmpuint (gs_app_cache_get_size (cache), ==, 2);
+	gs_app_cache_clear (cache);
+	g_assert_cmpuint (gs_app_cache_get_size (cache), ==, 0);
+}
+
 static void
 gs_plugin_func (void)
 {
@@ -589,6 +1395,328 @@ gs_app_unique_id_func (void)
 	g_clear_pointer (&data_id, g_free);
 }
 
+static void
+gs_app_refined_flags_func (void)
+{
+	g_autoptr(GsApp) app = gs_app_new ("test.desktop");
+	gint64 refine_time;
+
+	g_assert_cmpint (gs_app_get_refined_flags (app, G_MAXINT64), ==, 0);
+
+	/* setting the state of a new app doesn’t invalidate anything */
+	refine_time = g_get_monotonic_time ();
+	gs_app_set_state (app, GS_APP_STATE_AVAILABLE);
+	gs_app_add_refined_flags (app,
+				  GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENSE |
+				  GS_PLUGIN_REFINE_FLAGS_ALLOW_PACKAGES,
+				  refine_time);
+	gs_app_add_refined_flags (app, GS_PLUGIN_REFINE_FLAGS_REQUIRE_URL, refine_time);
+	g_assert_cmpint (gs_app_get_refined_flags (app, G_MAXINT64), ==,
+			 GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENSE |
+			 GS_PLUGIN_REFINE_FLAGS_REQUIRE_URL);
+
+	/* too old */
+	g_usleep (1000);
+	g_assert_cmpint (gs_app_get_refined_flags (app, 1), ==, 0);
+
+	/* a state change makes earlier refines stale */
+	gs_app_set_state (app, GS_APP_STATE_INSTALLING);
+	g_assert_cmpint (gs_app_get_refined_flags (app, G_MAXINT64), ==, 0);
+	g_usleep (1);
+	gs_app_add_refined_flags (app, GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENSE,
+				  g_get_monotonic_time ());
+	g_assert_cmpint (gs_app_get_refined_flags (app, G_MAXINT64), ==,
+			 GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENSE);
+
+	/* and so does recovering the state */
+	gs_app_set_state_recover (app);
+	g_assert_cmpint (gs_app_get_state (app), ==, GS_APP_STATE_AVAILABLE);
+	g_assert_cmpint (gs_app_get_refined_flags (app, G_MAXINT64), ==, 0);
+
+	/* as does adding or removing metadata, but not setting it again */
+	g_usleep (1);
+	gs_app_add_refined_flags (app, GS_PLUGIN_REFINE_FLAGS_REQUIRE_URL,
+				  g_get_monotonic_time ());
+	g_usleep (1);
+	gs_app_set_metadata (app, "GnomeSoftware::test", "true");
+	g_assert_cmpint (gs_app_get_refined_flags (app, G_MAXINT64), ==, 0);
+	g_usleep (1);
+	gs_app_add_refined_flags (app, GS_PLUGIN_REFINE_FLAGS_REQUIRE_URL,
+				  g_get_monotonic_time ());
+	g_usleep (1);
+	gs_app_set_metadata (app, "GnomeSoftware::test", "true");
+	g_assert_cmpint (gs_app_get_refined_flags (app, G_MAXINT64), ==,
+			 GS_PLUGIN_REFINE_FLAGS_REQUIRE_URL);
+	gs_app_set_metadata (app, "GnomeSoftware::test", NULL);
+	g_assert_cmpint (gs_app_get_refined_flags (app, G_MAXINT64), ==, 0);
+
+	g_usleep (1);
+	gs_app_add_refined_flags (app, GS_PLUGIN_REFINE_FLAGS_REQUIRE_URL,
+				  g_get_monotonic_time ());
+	g_usleep (1);
+	gs_app_invalidate_refined_flags (app);
+	g_assert_cmpint (gs_app_get_refined_flags (app, G_MAXINT64), ==, 0);
+
+	g_usleep (1);
+	gs_app_add_refined_flags (app, GS_PLUGIN_REFINE_FLAGS_REQUIRE_URL,
+				  g_get_monotonic_time ());
+	g_usleep (1);
+	gs_app_invalidate_all_refined_flags ();
+	g_assert_cmpint (gs_app_get_refined_flags (app, G_MAXINT64), ==, 0);
+}
+
+static void
+gs_app_interned_func (void)
+{
+	g_autoptr(GsApp) app1 = gs_app_new ("a.desktop");
+	g_autoptr(GsApp) app2 = gs_app_new ("b.desktop");
+	g_autofree gchar *origin = g_strdup ("fedora");
+	g_autoptr(GPtrArray) categories = g_ptr_array_new_with_free_func (g_free);
+
+	/* the same value is shared between apps */
+	gs_app_set_origin (app1, "fedora");
+	gs_app_set_origin (app2, origin);
+	g_assert_cmpstr (gs_app_get_origin (app1), ==, "fedora");
+	g_assert_true (gs_app_get_origin (app1) == gs_app_get_origin (app2));
+	gs_app_set_branch (app1, "stable");
+	gs_app_set_branch (app2, "stable");
+	g_assert_true (gs_app_get_branch (app1) == gs_app_get_branch (app2));
+	gs_app_set_license (app1, GS_APP_QUALITY_NORMAL, "GPL-2.0-or-later");
+	gs_app_set_license (app2, GS_APP_QUALITY_NORMAL, "GPL-2.0-or-later");
+	g_assert_true (gs_app_get_license (app1) == gs_app_get_license (app2));
+
+	/* and still belongs to the app once the other has changed */
+	gs_app_set_branch (app2, "devel");
+	g_assert_cmpstr (gs_app_get_branch (app1), ==, "stable");
+	g_assert_cmpstr (gs_app_get_branch (app2), ==, "devel");
+
+	/* the passed array is copied */
+	g_ptr_array_add (categories, g_strdup ("Utility"));
+	gs_app_set_categories (app1, categories);
+	gs_app_add_category (app2, "Utility");
+	g_ptr_array_set_size (categories, 0);
+	g_assert_true (gs_app_has_category (app1, "Utility"));
+	g_assert_true (g_ptr_array_index (gs_app_get_categories (app1), 0) ==
+		       g_ptr_array_index (gs_app_get_categories (app2), 0));
+	gs_app_set_categories (app1, gs_app_get_categories (app1));
+	g_assert_true (gs_app_has_category (app1, "Utility"));
+}
+
+static gboolean
+gs_app_lazy_load_cb (GsApp          *app,
+		     GsAppLazyField  field,
+		     gpointer        user_data)
+{
+	guint *n_calls = user_data;
+
+	(*n_calls)++;
+	if (field == GS_APP_LAZY_FIELD_DESCRIPTION) {
+		gs_app_set_description (app, GS_APP_QUALITY_NORMAL, "lazy");
+	} else if (field == GS_APP_LAZY_FIELD_SCREENSHOTS) {
+		g_autoptr(AsScreenshot) ss = as_screenshot_new ();
+		as_screenshot_set_caption (ss, "lazy", NULL);
+		gs_app_add_screenshot (app, ss);
+	}
+
+	/* the version history is loaded from stale data */
+	return field != GS_APP_LAZY_FIELD_VERSION_HISTORY;
+}
+
+static void
+gs_app_lazy_func (void)
+{
+	g_autoptr(GsApp) app = gs_app_new ("test.desktop");
+	g_autoptr(AsScreenshot) ss = as_screenshot_new ();
+	g_autoptr(GPtrArray) version_history = NULL;
+	guint n_calls = 0;
+
+	gs_app_set_lazy_loader (app,
+				GS_APP_LAZY_FIELD_DESCRIPTION |
+				GS_APP_LAZY_FIELD_SCREENSHOTS |
+				GS_APP_LAZY_FIELD_VERSION_HISTORY,
+				gs_app_lazy_load_cb, &n_calls, NULL);
+	g_assert_cmpint (n_calls, ==, 0);
+
+	/* loaded on first read, and only once */
+	g_assert_cmpstr (gs_app_get_description (app), ==, "lazy");
+	g_assert_cmpstr (gs_app_get_description (app), ==, "lazy");
+	g_assert_cmpint (n_calls, ==, 1);
+	g_assert_cmpint (gs_app_get_lazy_fields (app), ==,
+			 GS_APP_LAZY_FIELD_SCREENSHOTS |
+			 GS_APP_LAZY_FIELD_VERSION_HISTORY);
+
+	/* setters load the field first, so quality and order are kept */
+	gs_app_set_description (app, GS_APP_QUALITY_LOWEST, "worse");
+	g_assert_cmpstr (gs_app_get_description (app), ==, "lazy");
+	as_screenshot_set_caption (ss, "eager", NULL);
+	gs_app_add_screenshot (app, ss);
+	g_assert_cmpint (n_calls, ==, 2);
+	g_assert_cmpuint (gs_app_get_screenshots (app)->len, ==, 2);
+	g_assert_cmpstr (as_screenshot_get_caption (g_ptr_array_index (gs_app_get_screenshots (app), 0)), ==, "lazy");
+
+	/* stale data makes the app be refined again */
+	gs_app_add_refined_flags (app, GS_PLUGIN_REFINE_FLAGS_REQUIRE_URL,
+				  g_get_monotonic_time ());
+	g_usleep (1);
+	version_history = gs_app_get_version_history (app);
+	g_assert_null (version_history);
+	g_assert_cmpint (n_calls, ==, 3);
+	g_assert_cmpint (gs_app_get_lazy_fields (app), ==, GS_APP_LAZY_FIELD_NONE);
+	g_assert_cmpint (gs_app_get_refined_flags (app, G_MAXINT64), ==, 0);
+}
+
+static void
+gs_app_snapshot_func (void)
+{
+	g_autoptr(GsApp) app = gs_app_new ("test.desktop");
+	g_autoptr(GsAppSnapshot) snapshot1 = NULL;
+	g_autoptr(GsAppSnapshot) snapshot2 = NULL;
+	g_autoptr(GsAppSnapshot) snapshot3 = NULL;
+	g_autoptr(GIcon) icon = g_themed_icon_new ("test");
+	guint64 size_bytes = 0;
+
+	gs_app_set_name (app, GS_APP_QUALITY_NORMAL, "Name");
+	gs_app_set_state (app, GS_APP_STATE_AVAILABLE);
+	gs_app_set_size_installed (app, GS_SIZE_TYPE_VALID, 1234);
+
+	snapshot1 = gs_app_dup_snapshot (app);
+	g_assert_cmpstr (gs_app_snapshot_get_name (snapshot1), ==, "Name");
+	g_assert_null (gs_app_snapshot_get_summary (snapshot1));
+	g_assert_cmpint (gs_app_snapshot_get_state (snapshot1), ==, GS_APP_STATE_AVAILABLE);
+	g_assert_cmpint (gs_app_snapshot_get_size_installed (snapshot1, &size_bytes), ==, GS_SIZE_TYPE_VALID);
+	g_assert_cmpuint (size_bytes, ==, 1234);
+	g_assert_cmpint (gs_app_snapshot_get_size_download (snapshot1, &size_bytes), ==, GS_SIZE_TYPE_UNKNOWN);
+	g_assert_cmpuint (size_bytes, ==, 0);
+	g_assert_null (gs_app_snapshot_get_icons (snapshot1));
+
+	/* unchanged, so shared */
+	snapshot2 = gs_app_dup_snapshot (app);
+	g_assert_true (snapshot1 == snapshot2);
+
+	/* changes publish a new snapshot, and don’t affect the old one */
+	gs_app_set_name (app, GS_APP_QUALITY_HIGHEST, "New Name");
+	gs_app_add_icon (app, icon);
+	snapshot3 = gs_app_dup_snapshot (app);
+	g_assert_true (snapshot3 != snapshot1);
+	g_assert_cmpstr (gs_app_snapshot_get_name (snapshot1), ==, "Name");
+	g_assert_cmpstr (gs_app_snapshot_get_name (snapshot3), ==, "New Name");
+	g_assert_nonnull (gs_app_snapshot_get_icons (snapshot3));
+	g_assert_cmpuint (gs_app_snapshot_get_icons (snapshot3)->len, ==, 1);
+	g_assert_true (gs_app_has_icons (app));
+
+	g_clear_pointer (&snapshot3, gs_app_snapshot_unref);
+	gs_app_set_state (app, GS_APP_STATE_INSTALLING);
+	snapshot3 = gs_app_dup_snapshot (app);
+	g_assert_cmpint (gs_app_snapshot_get_state (snapshot3), ==, GS_APP_STATE_INSTALLING);
+}
+
+static void
+gs_key_colors_func (void)
+{
+	g_autoptr(GdkPixbuf) pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 64, 64);
+	g_autoptr(GdkPixbuf) transparent = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 32, 64);
+	g_autoptr(GArray) colors = NULL;
+	const GdkRGBA *color;
+
+	/* a solid green icon, with a transparent blue left half which should
+	 * be ignored */
+	gdk_pixbuf_fill (pixbuf, 0x00ff00ff);
+	gdk_pixbuf_fill (transparent, 0x0000ff00);
+	gdk_pixbuf_copy_area (transparent, 0, 0, 32, 64, pixbuf, 0, 0);
+
+	g_random_set_seed (1);
+	colors = gs_calculate_key_colors (pixbuf);
+	g_assert_cmpuint (colors->len, ==, 1);
+	color = &g_array_index (colors, GdkRGBA, 0);
+	g_assert_cmpfloat (color->red, ==, 0.0);
+	g_assert_cmpfloat (color->green, ==, 1.0);
+	g_assert_cmpfloat (color->blue, ==, 0.0);
+
+	/* a completely transparent icon has no key colors */
+	g_clear_pointer (&colors, g_array_unref);
+	gdk_pixbuf_fill (pixbuf, 0x00000000);
+	colors = gs_calculate_key_colors (pixbuf);
+	g_assert_cmpuint (colors->len, ==, 0);
+}
+
+static void
+gs_results_cache_func (void)
+{
+	g_autoptr(GsAppList) list = gs_app_list_new ();
+	g_autoptr(GsAppList) list2 = NULL;
+	g_autoptr(GsApp) app = gs_app_new ("org.example.Test");
+	g_autoptr(GsApp) app_noid = gs_app_new (NULL);
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GBytes) bytes_corrupt = NULL;
+	g_autoptr(GVariant) variant_old = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GIcon) themed_icon = g_themed_icon_new ("system-run");
+	g_autoptr(GIcon) remote_icon = gs_remote_icon_new ("https://example.com/icon.png");
+	g_autoptr(GPtrArray) icons = NULL;
+	GsApp *app2;
+	GArray *key_colors;
+	GdkRGBA color = { 0.25, 0.5, 0.75, 1.0 };
+	guint64 size_bytes = 0;
+
+	gs_app_set_kind (app, AS_COMPONENT_KIND_DESKTOP_APP);
+	gs_app_set_name (app, GS_APP_QUALITY_NORMAL, "Test");
+	gs_app_set_summary (app, GS_APP_QUALITY_NORMAL, "A test app");
+	gs_app_set_state (app, GS_APP_STATE_INSTALLED);
+	gs_app_set_size_installed (app, GS_SIZE_TYPE_VALID, 4096);
+	gs_app_add_quirk (app, GS_APP_QUIRK_COMPULSORY);
+	gs_app_add_key_color (app, &color);
+	gs_app_add_icon (app, themed_icon);
+	gs_app_add_icon (app, remote_icon);
+	gs_app_list_add (list, app);
+	gs_app_list_add (list, app_noid);
+
+	/* round trip; apps without an ID can’t be matched up later, so are dropped */
+	bytes = gs_results_cache_serialize (list);
+	list2 = gs_results_cache_deserialize (bytes, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (list2);
+	g_assert_cmpuint (gs_app_list_length (list2), ==, 1);
+	app2 = gs_app_list_index (list2, 0);
+	g_assert_true (app2 != app);
+	g_assert_cmpstr (gs_app_get_id (app2), ==, "org.example.Test");
+	g_assert_cmpint (gs_app_get_kind (app2), ==, AS_COMPONENT_KIND_DESKTOP_APP);
+	g_assert_cmpstr (gs_app_get_name (app2), ==, "Test");
+	g_assert_cmpstr (gs_app_get_summary (app2), ==, "A test app");
+	g_assert_cmpint (gs_app_get_state (app2), ==, GS_APP_STATE_INSTALLED);
+	g_assert_cmpint (gs_app_get_size_installed (app2, &size_bytes), ==, GS_SIZE_TYPE_VALID);
+	g_assert_cmpuint (size_bytes, ==, 4096);
+	g_assert_true (gs_app_has_quirk (app2, GS_APP_QUIRK_COMPULSORY));
+	key_colors = gs_app_peek_key_colors (app2);
+	g_assert_nonnull (key_colors);
+	g_assert_cmpuint (key_colors->len, ==, 1);
+	g_assert_cmpfloat (g_array_index (key_colors, GdkRGBA, 0).green, ==, 0.5);
+	g_assert_true (gs_results_cache_is_cached_app (app2));
+
+	/* the remote icon hasn’t been downloaded, so isn’t cached */
+	g_assert_false (gs_remote_icon_get_cached (GS_REMOTE_ICON (remote_icon)));
+	icons = gs_app_dup_icons (app2);
+	g_assert_nonnull (icons);
+	g_assert_cmpuint (icons->len, ==, 1);
+	g_assert_true (G_IS_THEMED_ICON (g_ptr_array_index (icons, 0)));
+	g_assert_false (gs_results_cache_is_cached_app (app));
+
+	/* truncated data */
+	bytes_corrupt = g_bytes_new_from_bytes (bytes, 0, g_bytes_get_size (bytes) / 2);
+	g_clear_object (&list2);
+	list2 = gs_results_cache_deserialize (bytes_corrupt, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert_null (list2);
+	g_clear_error (&error);
+
+	/* written by a different version */
+	variant_old = g_variant_ref_sink (g_variant_new_parsed ("(@u 0, @aa{sv} [])"));
+	g_clear_pointer (&bytes_corrupt, g_bytes_unref);
+	bytes_corrupt = g_variant_get_data_as_bytes (variant_old);
+	list2 = gs_results_cache_deserialize (bytes_corrupt, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert_null (list2);
+}
+
 static void
 gs_app_addons_func (void)
 {
@@ -692,6 +1820,93 @@ gs_app_progress_clamping_func (void)
 	}
 }
 
+static void
+gs_app_notify_count_cb (GObject    *object,
+			GParamSpec *pspec,
+			gpointer    user_data)
+{
+	guint *n_notifications = user_data;
+	(*n_notifications)++;
+}
+
+static void
+gs_app_notify_batch_func (void)
+{
+	g_autoptr(GsApp) app = gs_app_new ("gnome-software.desktop");
+	guint n_progress = 0;
+	guint n_icons_state = 0;
+
+	while (g_main_context_iteration (NULL, FALSE));
+
+	g_signal_connect (app, "notify::progress",
+			  G_CALLBACK (gs_app_notify_count_cb), &n_progress);
+	g_signal_connect (app, "notify::icons-state",
+			  G_CALLBACK (gs_app_notify_count_cb), &n_icons_state);
+
+	/* notifications are emitted from an idle callback */
+	gs_app_set_progress (app, 10);
+	gs_app_set_icons_state (app, GS_APP_ICONS_STATE_PENDING_DOWNLOAD);
+	gs_app_set_progress (app, 20);
+	gs_app_set_icons_state (app, GS_APP_ICONS_STATE_DOWNLOADING);
+	gs_app_set_progress (app, 30);
+	gs_app_set_icons_state (app, GS_APP_ICONS_STATE_AVAILABLE);
+	g_assert_cmpuint (n_progress, ==, 0);
+	g_assert_cmpuint (n_icons_state, ==, 0);
+
+	/* repeated icon state changes in one batch are only notified once;
+	 * other properties are notified for each change */
+	while (g_main_context_iteration (NULL, FALSE));
+	g_assert_cmpuint (n_progress, ==, 3);
+	g_assert_cmpuint (n_icons_state, ==, 1);
+	g_assert_cmpuint (gs_app_get_progress (app), ==, 30);
+
+	/* and later changes start a new batch */
+	gs_app_set_icons_state (app, GS_APP_ICONS_STATE_UNKNOWN);
+	while (g_main_context_iteration (NULL, FALSE));
+	g_assert_cmpuint (n_progress, ==, 3);
+	g_assert_cmpuint (n_icons_state, ==, 2);
+}
+
+static void
+gs_app_notify_order_cb (GObject    *object,
+			GParamSpec *pspec,
+			gpointer    user_data)
+{
+	GPtrArray *order = user_data;
+	g_ptr_array_add (order, object);
+}
+
+static void
+gs_app_notify_batch_order_func (void)
+{
+	g_autoptr(GsApp) app1 = gs_app_new ("app1.desktop");
+	g_autoptr(GsApp) app2 = gs_app_new ("app2.desktop");
+	g_autoptr(GsApp) app3 = gs_app_new ("app3.desktop");
+	g_autoptr(GPtrArray) order = g_ptr_array_new ();
+
+	while (g_main_context_iteration (NULL, FALSE));
+
+	g_signal_connect (app1, "notify::icons-state",
+			  G_CALLBACK (gs_app_notify_order_cb), order);
+	g_signal_connect (app2, "notify::icons-state",
+			  G_CALLBACK (gs_app_notify_order_cb), order);
+	g_signal_connect (app3, "notify::icons-state",
+			  G_CALLBACK (gs_app_notify_order_cb), order);
+
+	/* a batch is emitted in the order the apps first changed */
+	gs_app_set_icons_state (app2, GS_APP_ICONS_STATE_PENDING_DOWNLOAD);
+	gs_app_set_icons_state (app1, GS_APP_ICONS_STATE_PENDING_DOWNLOAD);
+	gs_app_set_icons_state (app2, GS_APP_ICONS_STATE_DOWNLOADING);
+	gs_app_set_icons_state (app3, GS_APP_ICONS_STATE_AVAILABLE);
+	gs_app_set_icons_state (app1, GS_APP_ICONS_STATE_AVAILABLE);
+
+	while (g_main_context_iteration (NULL, FALSE));
+	g_assert_cmpuint (order->len, ==, 3);
+	g_assert_true (g_ptr_array_index (order, 0) == app2);
+	g_assert_true (g_ptr_array_index (order, 1) == app1);
+	g_assert_true (g_ptr_array_index (order, 2) == app3);
+}
+
 static void
 gs_app_list_wildcard_dedupe_func (void)
 {
@@ -775,6 +1990,212 @@ gs_app_list_performance_func (void)
 		gs_app_list_add (list, app);
 	}
 	g_print ("%.2fms ", g_timer_elapsed (timer, NULL) * 1000);
+
+	/* check adding scales linearly, rather than quadratically, up to 100k
+	 * apps; this is slow, so only do it when asked */
+	if (g_test_perf ()) {
+		gdouble per_app_1k = 0.0;
+
+		for (guint n_apps = 1000; n_apps <= 100000; n_apps *= 10) {
+			g_autoptr(GPtrArray) many_apps = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+			g_autoptr(GsAppList) many_list = gs_app_list_new ();
+			g_autoptr(GsAppList) bulk_list = gs_app_list_new ();
+			gdouble elapsed, elapsed_bulk;
+
+			for (guint i = 0; i < n_apps; i++) {
+				g_autofree gchar *id = g_strdup_printf ("org.example.App%06u", i);
+				g_ptr_array_add (many_apps, gs_app_new (id));
+			}
+
+			g_timer_start (timer);
+			for (guint i = 0; i < many_apps->len; i++)
+				gs_app_list_add (many_list, g_ptr_array_index (many_apps, i));
+			elapsed = g_timer_elapsed (timer, NULL);
+			g_assert_cmpuint (gs_app_list_length (many_list), ==, n_apps);
+
+			g_timer_start (timer);
+			gs_app_list_add_many (bulk_list, (GsApp * const *) many_apps->pdata, many_apps->len);
+			elapsed_bulk = g_timer_elapsed (timer, NULL);
+			g_assert_cmpuint (gs_app_list_length (bulk_list), ==, n_apps);
+
+			g_test_message ("adding %u apps took %.2fms, or %.2fms in bulk",
+					n_apps, elapsed * 1000, elapsed_bulk * 1000);
+
+			/* allow a generous constant factor for noise */
+			if (n_apps == 1000)
+				per_app_1k = MAX (elapsed / n_apps, 1e-7);
+			else
+				g_assert_cmpfloat (elapsed / n_apps, <, per_app_1k * 10);
+		}
+	}
+}
+
+static void
+gs_app_list_index_func (void)
+{
+	g_autoptr(GsAppList) list = gs_app_list_new ();
+	g_autoptr(GsApp) app1 = gs_app_new ("a.desktop");
+	g_autoptr(GsApp) app2 = gs_app_new (NULL);
+	g_autoptr(GsApp) app3 = gs_app_new ("c.desktop");
+	g_autoptr(GsApp) app4 = gs_app_new ("e.desktop");
+	GsApp *apps[] = { app1, app2, app3, app1 };
+
+	gs_app_set_unique_id (app1, "system/flatpak/flathub/a.desktop/stable");
+	gs_app_set_unique_id (app3, "system/flatpak/flathub/c.desktop/stable");
+
+	/* duplicates are ignored when adding in bulk */
+	gs_app_list_add_many (list, apps, G_N_ELEMENTS (apps));
+	g_assert_cmpuint (gs_app_list_length (list), ==, 3);
+
+	/* look up by exact and wildcard unique IDs */
+	g_assert_true (gs_app_list_lookup (list, "system/flatpak/flathub/a.desktop/stable") == app1);
+	g_assert_true (gs_app_list_lookup (list, "*/*/*/c.desktop/*") == app3);
+	g_assert_null (gs_app_list_lookup (list, "*/*/*/b.desktop/*"));
+
+	/* an app which gets its ID after being added can still be found */
+	gs_app_set_id (app2, "b.desktop");
+	g_assert_true (gs_app_list_lookup (list, "*/*/*/b.desktop/*") == app2);
+
+	/* as can one whose ID changes after being added, under its new ID only */
+	gs_app_set_id (app2, "d.desktop");
+	g_assert_null (gs_app_list_lookup (list, "*/*/*/b.desktop/*"));
+	g_assert_true (gs_app_list_lookup (list, "*/*/*/d.desktop/*") == app2);
+	gs_app_set_unique_id (app3, "system/flatpak/flathub/e.desktop/stable");
+	g_assert_null (gs_app_list_lookup (list, "*/*/*/c.desktop/*"));
+	g_assert_true (gs_app_list_lookup (list, "system/flatpak/flathub/e.desktop/stable") == app3);
+
+	/* and another app with its new unique ID is spotted as a duplicate */
+	gs_app_set_unique_id (app4, "system/flatpak/flathub/e.desktop/stable");
+	gs_app_list_add (list, app4);
+	g_assert_cmpuint (gs_app_list_length (list), ==, 3);
+
+	/* changing the origin or branch doesn’t change the ID it’s found by */
+	gs_app_set_origin (app2, "fedora");
+	gs_app_set_branch (app2, "master");
+	g_assert_true (gs_app_list_lookup (list, "*/*/fedora/d.desktop/master") == app2);
+
+	/* and the index is kept up to date when removing and truncating */
+	g_assert_true (gs_app_list_remove (list, app1));
+	g_assert_false (gs_app_list_remove (list, app1));
+	g_assert_null (gs_app_list_lookup (list, "*/*/*/a.desktop/*"));
+	gs_app_list_add (list, app1);
+	g_assert_true (gs_app_list_lookup (list, "*/*/*/a.desktop/*") == app1);
+	gs_app_list_truncate (list, 2);
+	g_assert_null (gs_app_list_lookup (list, "*/*/*/a.desktop/*"));
+	gs_app_list_add (list, app1);
+	g_assert_cmpuint (gs_app_list_length (list), ==, 3);
+}
+
+static gint
+gs_app_list_sort_top_cb (GsApp    *app1,
+                         GsApp    *app2,
+                         gpointer  user_data)
+{
+	return (gint) gs_app_get_match_value (app2) - (gint) gs_app_get_match_value (app1);
+}
+
+static void
+gs_app_query_max_candidates_func (void)
+{
+	g_autoptr(GsAppQuery) unlimited = NULL;
+	g_autoptr(GsAppQuery) random = NULL;
+	g_autoptr(GsAppQuery) recent = NULL;
+	g_autoptr(GsAppQuery) by_name = NULL;
+	g_autoptr(GsApp) app1 = gs_app_new ("app1.desktop");
+	g_autoptr(GsApp) app2 = gs_app_new ("app2.desktop");
+	g_autoptr(GsApp) app3 = gs_app_new ("app3.desktop");
+
+	/* all the matches are needed if there’s no limit */
+	unlimited = gs_app_query_new ("is-curated", GS_APP_QUERY_TRISTATE_TRUE,
+				      "sort-func", gs_utils_app_sort_release_date,
+				      NULL);
+	g_assert_cmpuint (gs_app_query_get_max_candidates (unlimited, gs_utils_app_sort_release_date), ==, 0);
+
+	/* a random sample is enough if the results are in random order */
+	random = gs_app_query_new ("is-curated", GS_APP_QUERY_TRISTATE_TRUE,
+				   "max-results", 4,
+				   NULL);
+	g_assert_cmpuint (gs_app_query_get_max_candidates (random, NULL), >=, 4);
+	g_assert_cmpuint (gs_app_query_get_max_candidates (random, gs_utils_app_sort_release_date), ==, 0);
+
+	/* the top few are enough if they are listed in the query’s order */
+	recent = gs_app_query_new ("is-curated", GS_APP_QUERY_TRISTATE_TRUE,
+				   "max-results", 4,
+				   "sort-func", gs_utils_app_sort_release_date,
+				   NULL);
+	g_assert_cmpuint (gs_app_query_get_max_candidates (recent, gs_utils_app_sort_release_date), >=, 4);
+	g_assert_cmpuint (gs_app_query_get_max_candidates (recent, gs_utils_app_sort_match_value), ==, 0);
+	g_assert_cmpuint (gs_app_query_get_max_candidates (recent, NULL), ==, 0);
+
+	/* names may only be known after refining, so all are needed */
+	by_name = gs_app_query_new ("is-curated", GS_APP_QUERY_TRISTATE_TRUE,
+				    "max-results", 4,
+				    "sort-func", gs_utils_app_sort_name,
+				    NULL);
+	g_assert_cmpuint (gs_app_query_get_max_candidates (by_name, gs_utils_app_sort_name), ==, 0);
+
+	/* newest first, then by name */
+	gs_app_set_release_date (app1, 1000);
+	gs_app_set_name (app1, GS_APP_QUALITY_NORMAL, "Beta");
+	gs_app_set_release_date (app2, 2000);
+	gs_app_set_name (app2, GS_APP_QUALITY_NORMAL, "Gamma");
+	gs_app_set_release_date (app3, 1000);
+	gs_app_set_name (app3, GS_APP_QUALITY_NORMAL, "Alpha");
+	g_assert_cmpint (gs_utils_app_sort_release_date (app2, app1, NULL), <, 0);
+	g_assert_cmpint (gs_utils_app_sort_release_date (app1, app2, NULL), >, 0);
+	g_assert_cmpint (gs_utils_app_sort_release_date (app3, app1, NULL), <, 0);
+	g_assert_cmpint (gs_utils_app_sort_release_date (app1, app1, NULL), ==, 0);
+}
+
+static void
+gs_app_list_sort_top_func (void)
+{
+	g_autoptr(GsAppList) list = gs_app_list_new ();
+	g_autoptr(GsAppList) expected = gs_app_list_new ();
+
+	for (guint i = 0; i < 100; i++) {
+		g_autofree gchar *id = g_strdup_printf ("app%u.desktop", i);
+		g_autoptr(GsApp) app = gs_app_new (id);
+		gs_app_set_match_value (app, (i * 37) % 100);
+		gs_app_list_add (list, app);
+		gs_app_list_add (expected, app);
+	}
+
+	/* the same as sorting and then truncating */
+	gs_app_list_sort (expected, gs_app_list_sort_top_cb, NULL);
+	gs_app_list_truncate (expected, 10);
+	gs_app_list_sort_top (list, gs_app_list_sort_top_cb, NULL, 10);
+	g_assert_cmpuint (gs_app_list_length (list), ==, 10);
+	g_assert_true (gs_app_list_has_flag (list, GS_APP_LIST_FLAG_IS_TRUNCATED));
+	for (guint i = 0; i < 10; i++)
+		g_assert_true (gs_app_list_index (list, i) == gs_app_list_index (expected, i));
+	g_assert_cmpuint (gs_app_get_match_value (gs_app_list_index (list, 0)), ==, 99);
+
+	/* the apps which were dropped are no longer indexed */
+	g_assert_null (gs_app_list_lookup (list, "*/*/*/app0.desktop/*"));
+
+	/* asking for more than there are just sorts */
+	gs_app_list_sort_top (list, gs_app_list_sort_top_cb, NULL, 20);
+	g_assert_cmpuint (gs_app_list_length (list), ==, 10);
+
+	/* apps which rank equally are kept, and stay, in the order they were
+	 * in, as with a stable sort */
+	gs_app_list_remove_all (list);
+	gs_app_list_remove_all (expected);
+	for (guint i = 0; i < 100; i++) {
+		g_autofree gchar *id = g_strdup_printf ("tie%u.desktop", i);
+		g_autoptr(GsApp) app = gs_app_new (id);
+		gs_app_set_match_value (app, (i * 37) % 5);
+		gs_app_list_add (list, app);
+		gs_app_list_add (expected, app);
+	}
+
+	gs_app_list_sort (expected, gs_app_list_sort_top_cb, NULL);
+	gs_app_list_truncate (expected, 30);
+	gs_app_list_sort_top (list, gs_app_list_sort_top_cb, NULL, 30);
+	g_assert_cmpuint (gs_app_list_length (list), ==, 30);
+	for (guint i = 0; i < 30; i++)
+		g_assert_true (gs_app_list_index (list, i) == gs_app_list_index (expected, i));
 }
 
 static void
@@ -797,6 +2218,514 @@ gs_app_list_related_func (void)
 	g_assert_cmpint (gs_app_list_get_progress (list), ==, 50);
 }
 
+static void
+gs_appstream_category_sizes_func (void)
+{
+	g_autoptr(GString) xml = g_string_new ("<components>");
+	g_autoptr(XbBuilder) builder = xb_builder_new ();
+	g_autoptr(XbBuilderSource) source = xb_builder_source_new ();
+	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) list = g_ptr_array_new_with_free_func (g_object_unref);
+	const GsDesktopData *desktop_data = gs_desktop_get_data ();
+	GsCategory *parent = NULL;
+
+	/* more than the 100 the sizes used to be capped at */
+	for (guint i = 0; i < 150; i++) {
+		g_string_append_printf (xml,
+					"<component><id>viewer%u.desktop</id>"
+					"<categories><category>Viewer</category><category>Graphics</category></categories>"
+					"</component>", i);
+	}
+	g_string_append (xml,
+			 "<component><id>photos.desktop</id>"
+			 "<categories><category>Graphics</category><category>Photography</category>"
+			 "<category>Viewer</category><category>Graphics</category></categories>"
+			 "</component>"
+			 "<component merge=\"append\"><id>photos.desktop</id>"
+			 "<categories><category>3DGraphics</category></categories>"
+			 "</component>"
+			 "<component><id>player.desktop</id>"
+			 "<categories><category>AudioVideo</category><category>Player</category></categories>"
+			 "</component>"
+			 "</components>");
+	xb_builder_source_load_xml (source, xml->str, XB_BUILDER_SOURCE_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	xb_builder_import_source (builder, source);
+	silo = xb_builder_compile (builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (silo);
+
+	for (guint i = 0; desktop_data[i].id != NULL; i++) {
+		if (g_str_equal (desktop_data[i].id, "create"))
+			parent = gs_category_new_for_desktop_data (&desktop_data[i]);
+	}
+	g_assert_nonnull (parent);
+	g_ptr_array_add (list, parent);
+
+	g_assert_true (gs_appstream_refine_category_sizes (silo, list, NULL, &error));
+	g_assert_no_error (error);
+	g_assert_cmpuint (gs_category_get_size (gs_category_find_child (parent, "viewers")), ==, 151);
+	g_assert_cmpuint (gs_category_get_size (gs_category_find_child (parent, "photography")), ==, 1);
+	g_assert_cmpuint (gs_category_get_size (gs_category_find_child (parent, "3d")), ==, 0);
+	g_assert_cmpuint (gs_category_get_size (gs_category_find_child (parent, "music-players")), ==, 1);
+	g_assert_cmpuint (gs_category_get_size (gs_category_find_child (parent, "scanning")), ==, 0);
+
+	/* cached on the silo, so a second call gives the same answers */
+	gs_category_set_size (gs_category_find_child (parent, "viewers"), 0);
+	g_assert_true (gs_appstream_refine_category_sizes (silo, list, NULL, &error));
+	g_assert_no_error (error);
+	g_assert_cmpuint (gs_category_get_size (gs_category_find_child (parent, "viewers")), ==, 151);
+}
+
+static XbSilo *
+gs_appstream_lazy_silo_new (const gchar *xml)
+{
+	g_autoptr(XbBuilder) builder = xb_builder_new ();
+	g_autoptr(XbBuilderSource) source = xb_builder_source_new ();
+	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(GError) error = NULL;
+
+	xb_builder_source_load_xml (source, xml, XB_BUILDER_SOURCE_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	xb_builder_import_source (builder, source);
+	silo = xb_builder_compile (builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (silo);
+
+	return g_steal_pointer (&silo);
+}
+
+static void
+gs_appstream_search_index_func (void)
+{
+	const gchar *xml_a =
+		"<components>"
+		"<component><id>runner.desktop</id><name>Runner</name><summary>Go jogging</summary></component>"
+		"<component><id>walker.desktop</id><name>Walker</name><summary>Go for a stroll</summary></component>"
+		"</components>";
+	const gchar *xml_b =
+		"<components>"
+		"<component><id>swimmer.desktop</id><name>Swimmer</name><summary>Go for a dip</summary></component>"
+		"</components>";
+	const gchar *walk[] = { "walk", NULL };
+	const gchar *swim[] = { "swim", NULL };
+	g_autofree gchar *tmp_dir = NULL;
+	g_autofree gchar *silo_path = NULL;
+	g_autofree gchar *index_path = NULL;
+	g_autoptr(GFile) silo_file = NULL;
+	g_autoptr(XbSilo) reference = NULL;
+	g_autoptr(XbSilo) silo_a = NULL;
+	g_autoptr(XbSilo) silo_b = NULL;
+	g_autofree guint16 *expected = NULL;
+	g_autofree guint16 *matches = NULL;
+	g_autofree guint16 *matches_b = NULL;
+	g_autoptr(GError) error = NULL;
+
+	tmp_dir = g_dir_make_tmp ("gs-self-test-XXXXXX", &error);
+	g_assert_no_error (error);
+	silo_path = g_build_filename (tmp_dir, "components.xmlb", NULL);
+	index_path = g_strconcat (silo_path, ".gs-appstream-search-index", NULL);
+	silo_file = g_file_new_for_path (silo_path);
+
+	/* the index built when searching */
+	reference = gs_appstream_lazy_silo_new (xml_a);
+	expected = gs_appstream_search_match_apps (reference, walk, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (expected);
+	g_assert_cmpuint (expected[0], ==, 0);
+	g_assert_cmpuint (expected[1], !=, 0);
+
+	/* building it up front saves it, and gives the same matches */
+	silo_a = gs_appstream_lazy_silo_new (xml_a);
+	g_assert_true (gs_appstream_search_index_build (silo_a, silo_file, NULL, NULL, &error));
+	g_assert_no_error (error);
+	g_assert_true (g_file_test (index_path, G_FILE_TEST_EXISTS));
+	matches = gs_appstream_search_match_apps (silo_a, walk, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpmem (matches, 2 * sizeof (guint16), expected, 2 * sizeof (guint16));
+
+	/* the saved index is only used for the silo it was built for */
+	silo_b = gs_appstream_lazy_silo_new (xml_b);
+	g_assert_true (gs_appstream_search_index_build (silo_b, silo_file, NULL, NULL, &error));
+	g_assert_no_error (error);
+	matches_b = gs_appstream_search_match_apps (silo_b, swim, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (matches_b[0], !=, 0);
+
+	gs_utils_rmtree (tmp_dir, NULL);
+}
+
+static void
+gs_appstream_lazy_refine (GsApp *app, XbSilo *silo)
+{
+	g_autoptr(XbNode) component = NULL;
+	g_autoptr(GError) error = NULL;
+
+	component = xb_silo_query_first (silo, "components/component", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (component);
+	g_assert_true (gs_appstream_refine_app (NULL, app, silo, component,
+						GS_PLUGIN_REFINE_FLAGS_REQUIRE_DESCRIPTION |
+						GS_PLUGIN_REFINE_FLAGS_REQUIRE_SCREENSHOTS,
+						NULL, "", AS_COMPONENT_SCOPE_SYSTEM, &error));
+	g_assert_no_error (error);
+}
+
+static void
+gs_appstream_lazy_fields_func (void)
+{
+	g_autoptr(XbSilo) silo1 = gs_appstream_lazy_silo_new (
+		"<components>"
+		"<component type=\"desktop-application\">"
+		"<id>lazy.desktop</id>"
+		"<name>Lazy</name>"
+		"<summary>Loads on demand</summary>"
+		"<description><p>A long description.</p></description>"
+		"<screenshots><screenshot type=\"default\">"
+		"<image type=\"source\" width=\"800\" height=\"600\">https://example.com/1.png</image>"
+		"</screenshot></screenshots>"
+		"<releases>"
+		"<release version=\"1.1\" timestamp=\"1700000000\"><description><p>Fixes</p></description></release>"
+		"<release version=\"1.0\" date=\"2023-01-01\"/>"
+		"</releases>"
+		"</component>"
+		"</components>");
+	g_autoptr(XbSilo) silo2 = gs_appstream_lazy_silo_new (
+		"<components>"
+		"<component type=\"desktop-application\">"
+		"<id>lazy.desktop</id>"
+		"<name>Lazy</name>"
+		"<description><p>Another description.</p></description>"
+		"</component>"
+		"</components>");
+	g_autoptr(GsApp) app = gs_app_new ("lazy.desktop");
+	g_autoptr(GsApp) app_dropped = gs_app_new ("lazy.desktop");
+	g_autoptr(GsApp) app_stale = gs_app_new ("lazy.desktop");
+	g_autoptr(GPtrArray) version_history = NULL;
+
+	gs_appstream_lazy_refine (app, silo1);
+
+	/* nothing is built until it is read, apart from the kudo */
+	g_assert_cmpint (gs_app_get_lazy_fields (app), ==,
+			 GS_APP_LAZY_FIELD_DESCRIPTION |
+			 GS_APP_LAZY_FIELD_SCREENSHOTS |
+			 GS_APP_LAZY_FIELD_VERSION_HISTORY);
+	g_assert_true (gs_app_has_kudo (app, GS_APP_KUDO_HAS_SCREENSHOTS));
+	g_assert_cmpstr (gs_app_get_summary (app), ==, "Loads on demand");
+
+	/* a second component only replaces what it would have replaced if
+	 * both had been loaded straight away */
+	gs_appstream_lazy_refine (app, silo2);
+	g_assert_cmpstr (gs_app_get_description (app), ==, "Another description.");
+	g_assert_cmpuint (gs_app_get_screenshots (app)->len, ==, 1);
+	version_history = gs_app_get_version_history (app);
+	g_assert_nonnull (version_history);
+	g_assert_cmpuint (version_history->len, ==, 2);
+	g_assert_cmpstr (as_release_get_version (g_ptr_array_index (version_history, 0)), ==, "1.1");
+	g_assert_nonnull (as_release_get_description (g_ptr_array_index (version_history, 0)));
+	g_assert_cmpint (gs_app_get_lazy_fields (app), ==, GS_APP_LAZY_FIELD_NONE);
+
+	/* dropping the silo forgets the fields and makes the app be refined
+	 * again straight away */
+	gs_appstream_lazy_refine (app_dropped, silo1);
+	gs_app_add_refined_flags (app_dropped, GS_PLUGIN_REFINE_FLAGS_REQUIRE_SCREENSHOTS,
+				  g_get_monotonic_time ());
+	g_usleep (1);
+	gs_appstream_drop_lazy_data (silo1);
+	g_assert_cmpint (gs_app_get_lazy_fields (app_dropped), ==, GS_APP_LAZY_FIELD_NONE);
+	g_assert_cmpint (gs_app_get_refined_flags (app_dropped, G_MAXINT64), ==, 0);
+	g_assert_null (gs_app_get_description (app_dropped));
+
+	/* a silo invalidated without being dropped still gives the data the
+	 * app was refined with, but does make it be refined again */
+	gs_appstream_lazy_refine (app_stale, silo2);
+	gs_app_add_refined_flags (app_stale, GS_PLUGIN_REFINE_FLAGS_REQUIRE_DESCRIPTION,
+				  g_get_monotonic_time ());
+	g_usleep (1);
+	xb_silo_invalidate (silo2);
+	g_assert_cmpstr (gs_app_get_description (app_stale), ==, "Another description.");
+	g_assert_cmpint (gs_app_get_refined_flags (app_stale, G_MAXINT64), ==, 0);
+}
+
+static void
+gs_glob_set_func (void)
+{
+	g_autoptr(GsGlobSet) set = gs_glob_set_new ();
+	const gchar *patterns[] = {
+		"org.gnome.Software",	/* literal */
+		"fedora*",		/* prefix */
+		"*.desktop",		/* suffix */
+		"*",			/* prefix of "" */
+		"wine-*.desktop",
+		"*release-notes*",
+		"a?c",
+		"[abc]x",
+		"[!abc]y",
+		"[]a]z",
+		"[a-c-]w",
+		"\\*lit",
+		"*a*b*c",
+		"[[:digit:]]*",		/* needs fnmatch */
+		"[unterminated",	/* needs fnmatch */
+		"pci:v000010DEd*sv*sd*bc03sc*i*",
+		NULL };
+	const gchar *strings[] = {
+		"", "org.gnome.Software", "org.gnome.Softwar", "fedora", "fedora-updates",
+		"foo.desktop", ".desktop", "wine-notepad.desktop", "wine-.desktop",
+		"my-release-notes", "abc", "ac", "axc", "bx", "dx", "dy", "ay", "]z",
+		"az", "-w", "dw", "*lit", "\\lit", "xlit", "aXbYc", "abcc", "acb",
+		"1abc", "[unterminated", "pci:v000010DEd00001234sv1sd2bc03sc00i00",
+		"pci:v000010DEd00001234sv1sd2bc02sc00i00", "éa?c", "a\xc3\xa9" "c", "ab",
+		NULL };
+
+	/* the empty set matches nothing */
+	g_assert_true (gs_glob_set_is_empty (set));
+	g_assert_cmpuint (gs_glob_set_match (set, "anything"), ==, 0);
+
+	for (guint i = 0; patterns[i] != NULL; i++)
+		gs_glob_set_add (set, patterns[i], 1u << i);
+	g_assert_false (gs_glob_set_is_empty (set));
+
+	/* the same as matching each pattern with fnmatch(); run twice so the
+	 * second run uses the cached DFA states */
+	for (guint run = 0; run < 2; run++) {
+		for (guint j = 0; strings[j] != NULL; j++) {
+			guint expected = 0;
+
+			for (guint i = 0; patterns[i] != NULL; i++) {
+				if (fnmatch (patterns[i], strings[j], 0) == 0)
+					expected |= 1u << i;
+			}
+			g_assert_cmphex (gs_glob_set_match (set, strings[j]), ==, expected);
+			g_assert_cmpint (gs_glob_set_matches (set, strings[j]), ==, expected != 0);
+		}
+	}
+}
+
+static void
+gs_search_matcher_func (void)
+{
+	g_autoptr(GsAppList) list = gs_app_list_new ();
+	g_autoptr(GsApp) app1 = gs_app_new ("org.mozilla.firefox");
+	g_autoptr(GsApp) app2 = gs_app_new ("org.example.Matches");
+	g_autoptr(GsSearchMatcher) matcher = NULL;
+	g_autofree guint16 *match_values = NULL;
+	g_auto(GStrv) keywords = NULL;
+	g_autoptr(GError) error = NULL;
+
+	gs_app_set_name (app1, GS_APP_QUALITY_NORMAL, "Firefox");
+	gs_app_set_summary (app1, GS_APP_QUALITY_NORMAL, "Web Browser");
+	gs_app_set_name (app2, GS_APP_QUALITY_NORMAL, "Matches");
+	gs_app_set_summary (app2, GS_APP_QUALITY_NORMAL, "Lights fires");
+	gs_app_list_add (list, app1);
+	gs_app_list_add (list, app2);
+
+	matcher = gs_search_matcher_new (list, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (matcher);
+
+	/* all the keywords have to match, in any field */
+	keywords = gs_search_matcher_tokenize (" Fire  WEB ");
+	g_assert_cmpuint (g_strv_length (keywords), ==, 2);
+	match_values = gs_search_matcher_match (matcher, (const gchar * const *) keywords, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (match_values[0], >, 0);
+	g_assert_cmpuint (match_values[1], ==, 0);
+	g_clear_pointer (&match_values, g_free);
+	g_clear_pointer (&keywords, g_strfreev);
+
+	/* matching on the ID alone still gives a non-zero value */
+	keywords = gs_search_matcher_tokenize ("mozilla");
+	match_values = gs_search_matcher_match (matcher, (const gchar * const *) keywords, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (match_values[0], >, 0);
+	g_assert_cmpuint (match_values[1], ==, 0);
+
+	/* extending a keyword narrows the search, but anything else doesn’t */
+	g_assert_true (gs_search_matcher_keyword_narrows ("fire", "fire"));
+	g_assert_true (gs_search_matcher_keyword_narrows ("Firefox", "fire"));
+	g_assert_false (gs_search_matcher_keyword_narrows ("fire", "firefox"));
+	g_assert_false (gs_search_matcher_keyword_narrows ("water", "fire"));
+	g_assert_false (gs_search_matcher_keyword_narrows ("fire-starter", "fire"));
+}
+
+static gpointer
+metrics_thread_cb (gpointer user_data)
+{
+	const gchar *name = user_data;
+
+	for (guint i = 0; i < 1000; i++) {
+		gs_metrics_record_duration (name, i);
+		gs_metrics_record_duration ("test-shared-latency", i);
+		gs_metrics_increment_counter ("test-shared-counter", 1);
+	}
+
+	return NULL;
+}
+
+static void
+gs_metrics_func (void)
+{
+	guint64 count, p50, p95, p99;
+	g_autoptr(GVariant) metrics = NULL;
+	g_autofree gchar *str = NULL;
+	const gchar *thread_names[] = { "test-thread-0", "test-thread-1", "test-thread-2", "test-thread-3" };
+	GThread *threads[G_N_ELEMENTS (thread_names)];
+
+	gs_metrics_reset ();
+
+	/* counters */
+	g_assert_cmpuint (gs_metrics_get_counter ("test-counter"), ==, 0);
+	gs_metrics_increment_counter ("test-counter", 1);
+	gs_metrics_increment_counter ("test-counter", 2);
+	g_assert_cmpuint (gs_metrics_get_counter ("test-counter"), ==, 3);
+
+	/* histograms are accurate to within 25% */
+	g_assert_false (gs_metrics_get_percentiles ("test-latency", NULL, NULL, NULL, NULL));
+	for (guint64 i = 1; i <= 1000; i++)
+		gs_metrics_record_duration ("test-latency", i);
+	g_assert_true (gs_metrics_get_percentiles ("test-latency", &count, &p50, &p95, &p99));
+	g_assert_cmpuint (count, ==, 1000);
+	g_assert_cmpuint (p50, >=, 500);
+	g_assert_cmpuint (p50, <=, 625);
+	g_assert_cmpuint (p95, >=, 950);
+	g_assert_cmpuint (p95, <=, 1000);
+	g_assert_cmpuint (p99, >=, 990);
+	g_assert_cmpuint (p99, <=, 1000);
+
+	/* snapshot */
+	metrics = g_variant_ref_sink (gs_metrics_dup_variant ());
+	g_assert_true (g_variant_is_of_type (metrics, G_VARIANT_TYPE (GS_METRICS_VARIANT_TYPE)));
+	str = gs_metrics_variant_to_string (metrics);
+	g_assert_nonnull (strstr (str, "test-counter"));
+	g_assert_nonnull (strstr (str, "test-latency"));
+
+	gs_metrics_reset ();
+	g_assert_cmpuint (gs_metrics_get_counter ("test-counter"), ==, 0);
+	g_assert_false (gs_metrics_get_percentiles ("test-latency", NULL, NULL, NULL, NULL));
+
+	/* recording from several threads at once, both under the same name
+	 * and under different ones, loses nothing */
+	for (guint i = 0; i < G_N_ELEMENTS (threads); i++)
+		threads[i] = g_thread_new (thread_names[i], metrics_thread_cb, (gpointer) thread_names[i]);
+	for (guint i = 0; i < G_N_ELEMENTS (threads); i++)
+		g_thread_join (threads[i]);
+
+	g_assert_cmpuint (gs_metrics_get_counter ("test-shared-counter"), ==, 1000 * G_N_ELEMENTS (threads));
+	g_assert_true (gs_metrics_get_percentiles ("test-shared-latency", &count, NULL, NULL, NULL));
+	g_assert_cmpuint (count, ==, 1000 * G_N_ELEMENTS (threads));
+	for (guint i = 0; i < G_N_ELEMENTS (threads); i++) {
+		g_assert_true (gs_metrics_get_percentiles (thread_names[i], &count, NULL, NULL, NULL));
+		g_assert_cmpuint (count, ==, 1000);
+	}
+
+	gs_metrics_reset ();
+}
+
+static void
+job_scheduler_start_cb (gpointer      user_data,
+			const GError *error)
+{
+	guint *n_started = user_data;
+
+	g_assert_no_error (error);
+	(*n_started)++;
+}
+
+static void
+job_scheduler_dropped_cb (gpointer      user_data,
+			  const GError *error)
+{
+	guint *n_dropped = user_data;
+
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	(*n_dropped)++;
+}
+
+static void
+gs_job_scheduler_func (void)
+{
+	g_autoptr(GsJobScheduler) scheduler = gs_job_scheduler_new ();
+	g_autoptr(GsJobScheduler) dropping_scheduler = gs_job_scheduler_new ();
+	g_autoptr(GsJobScheduler) extra_ref = NULL;
+	guint n_user_started = 0;
+	guint n_background_started = 0;
+	guint n_dropped = 0;
+
+	gs_job_scheduler_set_max_running (scheduler, GS_JOB_LANE_USER, 1);
+
+	/* the second user job has to wait for the first */
+	g_assert_true (gs_job_scheduler_push (scheduler, GS_JOB_LANE_USER,
+					      job_scheduler_start_cb, &n_user_started, NULL));
+	g_assert_false (gs_job_scheduler_push (scheduler, GS_JOB_LANE_USER,
+					       job_scheduler_start_cb, &n_user_started, NULL));
+	g_assert_cmpuint (gs_job_scheduler_get_n_queued (scheduler, GS_JOB_LANE_USER), ==, 1);
+	g_assert_cmpuint (n_user_started, ==, 0);
+	gs_job_scheduler_release (scheduler, GS_JOB_LANE_USER);
+	g_assert_cmpuint (n_user_started, ==, 1);
+	g_assert_cmpuint (gs_job_scheduler_get_n_running (scheduler, GS_JOB_LANE_USER), ==, 1);
+	gs_job_scheduler_release (scheduler, GS_JOB_LANE_USER);
+
+	/* interactive jobs are unlimited, and hold back background jobs */
+	for (guint i = 0; i < 10; i++)
+		g_assert_true (gs_job_scheduler_push (scheduler, GS_JOB_LANE_INTERACTIVE,
+						      job_scheduler_start_cb, NULL, NULL));
+	g_assert_false (gs_job_scheduler_push (scheduler, GS_JOB_LANE_BACKGROUND,
+					       job_scheduler_start_cb, &n_background_started, NULL));
+	for (guint i = 0; i < 9; i++)
+		gs_job_scheduler_release (scheduler, GS_JOB_LANE_INTERACTIVE);
+	g_assert_cmpuint (n_background_started, ==, 0);
+	gs_job_scheduler_release (scheduler, GS_JOB_LANE_INTERACTIVE);
+	g_assert_cmpuint (n_background_started, ==, 1);
+	gs_job_scheduler_release (scheduler, GS_JOB_LANE_BACKGROUND);
+
+	/* but not forever */
+	gs_job_scheduler_set_max_delay (scheduler, 10);
+	g_assert_true (gs_job_scheduler_push (scheduler, GS_JOB_LANE_INTERACTIVE,
+					      job_scheduler_start_cb, NULL, NULL));
+	g_assert_false (gs_job_scheduler_push (scheduler, GS_JOB_LANE_BACKGROUND,
+					       job_scheduler_start_cb, &n_background_started, NULL));
+	while (n_background_started < 2)
+		g_main_context_iteration (NULL, TRUE);
+	g_assert_cmpuint (gs_job_scheduler_get_n_running (scheduler, GS_JOB_LANE_BACKGROUND), ==, 1);
+	gs_job_scheduler_release (scheduler, GS_JOB_LANE_BACKGROUND);
+	gs_job_scheduler_release (scheduler, GS_JOB_LANE_INTERACTIVE);
+
+	/* jobs still queued when the scheduler is shut down are cancelled,
+	 * even if something else still holds a reference to it */
+	gs_job_scheduler_set_max_running (dropping_scheduler, GS_JOB_LANE_USER, 1);
+	g_assert_true (gs_job_scheduler_push (dropping_scheduler, GS_JOB_LANE_USER,
+					      job_scheduler_dropped_cb, &n_dropped, NULL));
+	for (guint i = 0; i < 3; i++)
+		g_assert_false (gs_job_scheduler_push (dropping_scheduler, GS_JOB_LANE_USER,
+						       job_scheduler_dropped_cb, &n_dropped, NULL));
+	g_assert_cmpuint (n_dropped, ==, 0);
+	extra_ref = g_object_ref (dropping_scheduler);
+	gs_job_scheduler_shutdown (dropping_scheduler);
+	g_assert_cmpuint (n_dropped, ==, 3);
+	g_assert_cmpuint (gs_job_scheduler_get_n_queued (dropping_scheduler, GS_JOB_LANE_USER), ==, 0);
+
+	/* and later jobs are not held back */
+	g_assert_true (gs_job_scheduler_push (dropping_scheduler, GS_JOB_LANE_USER,
+					      job_scheduler_dropped_cb, &n_dropped, NULL));
+	gs_job_scheduler_release (dropping_scheduler, GS_JOB_LANE_USER);
+	gs_job_scheduler_release (dropping_scheduler, GS_JOB_LANE_USER);
+	g_clear_object (&dropping_scheduler);
+	g_clear_object (&extra_ref);
+	g_assert_cmpuint (n_dropped, ==, 3);
+
+	/* disposing of the scheduler shuts it down too */
+	dropping_scheduler = gs_job_scheduler_new ();
+	gs_job_scheduler_set_max_running (dropping_scheduler, GS_JOB_LANE_USER, 1);
+	g_assert_true (gs_job_scheduler_push (dropping_scheduler, GS_JOB_LANE_USER,
+					      job_scheduler_dropped_cb, &n_dropped, NULL));
+	g_assert_false (gs_job_scheduler_push (dropping_scheduler, GS_JOB_LANE_USER,
+					       job_scheduler_dropped_cb, &n_dropped, NULL));
+	g_clear_object (&dropping_scheduler);
+	g_assert_cmpuint (n_dropped, ==, 4);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -809,19 +2738,43 @@ main (int argc, char **argv)
 	g_test_add_func ("/gnome-software/lib/utils{wilson}", gs_utils_wilson_func);
 	g_test_add_func ("/gnome-software/lib/utils{error}", gs_utils_error_func);
 	g_test_add_func ("/gnome-software/lib/utils{cache}", gs_utils_cache_func);
+	g_test_add_func ("/gnome-software/lib/utils{file-size}", gs_utils_file_size_func);
 	g_test_add_func ("/gnome-software/lib/utils{append-kv}", gs_utils_append_kv_func);
 	g_test_add_func ("/gnome-software/lib/os-release", gs_os_release_func);
 	g_test_add_func ("/gnome-software/lib/app", gs_app_func);
 	g_test_add_func ("/gnome-software/lib/app/progress-clamping", gs_app_progress_clamping_func);
+	g_test_add_func ("/gnome-software/lib/app{notify-batch}", gs_app_notify_batch_func);
+	g_test_add_func ("/gnome-software/lib/app{notify-batch-order}", gs_app_notify_batch_order_func);
 	g_test_add_func ("/gnome-software/lib/app{addons}", gs_app_addons_func);
+	g_test_add_func ("/gnome-software/lib/app{refined-flags}", gs_app_refined_flags_func);
+	g_test_add_func ("/gnome-software/lib/app{lazy}", gs_app_lazy_func);
+	g_test_add_func ("/gnome-software/lib/app{interned}", gs_app_interned_func);
+	g_test_add_func ("/gnome-software/lib/app{snapshot}", gs_app_snapshot_func);
 	g_test_add_func ("/gnome-software/lib/app{unique-id}", gs_app_unique_id_func);
 	g_test_add_data_func ("/gnome-software/lib/app{thread}", debug, gs_app_thread_func);
 	g_test_add_func ("/gnome-software/lib/app{list}", gs_app_list_func);
 	g_test_add_func ("/gnome-software/lib/app{list-wildcard-dedupe}", gs_app_list_wildcard_dedupe_func);
 	g_test_add_func ("/gnome-software/lib/app{list-performance}", gs_app_list_performance_func);
+	g_test_add_func ("/gnome-software/lib/app{list-index}", gs_app_list_index_func);
+	g_test_add_func ("/gnome-software/lib/app{list-sort-top}", gs_app_list_sort_top_func);
 	g_test_add_func ("/gnome-software/lib/app{list-related}", gs_app_list_related_func);
+	g_test_add_func ("/gnome-software/lib/app-query{max-candidates}", gs_app_query_max_candidates_func);
+	g_test_add_func ("/gnome-software/lib/key-colors", gs_key_colors_func);
+	g_test_add_func ("/gnome-software/lib/results-cache", gs_results_cache_func);
+	g_test_add_func ("/gnome-software/lib/appstream{category-sizes}", gs_appstream_category_sizes_func);
+	g_test_add_func ("/gnome-software/lib/appstream{lazy-fields}", gs_appstream_lazy_fields_func);
+	g_test_add_func ("/gnome-software/lib/appstream{search-index}", gs_appstream_search_index_func);
+	g_test_add_func ("/gnome-software/lib/glob-set", gs_glob_set_func);
+	g_test_add_func ("/gnome-software/lib/search-matcher", gs_search_matcher_func);
+	g_test_add_func ("/gnome-software/lib/metrics", gs_metrics_func);
+	g_test_add_func ("/gnome-software/lib/job-scheduler", gs_job_scheduler_func);
+	g_test_add_func ("/gnome-software/lib/app-cache", gs_app_cache_func);
 	g_test_add_func ("/gnome-software/lib/plugin", gs_plugin_func);
 	g_test_add_func ("/gnome-software/lib/plugin{download-rewrite}", gs_plugin_download_rewrite_func);
+	g_test_add_func ("/gnome-software/lib/download{resume}", gs_download_resume_func);
+	g_test_add_func ("/gnome-software/lib/download-scheduler", gs_download_scheduler_func);
+	g_test_add_func ("/gnome-software/lib/icon-downloader", gs_icon_downloader_func);
+	g_test_add_func ("/gnome-software/lib/odrs{ratings-cache}", gs_odrs_ratings_cache_func);
 
 	return g_test_run ();
 }
@@ -20,10 +20,14 @@
 
 #include "config.h"
 
+#include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <fnmatch.h>
 #include <math.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <glib/gi18n-lib.h>
 #include <glib/gstdio.h>
 #include <json-glib/json-glib.h>
@@ -1451,6 +1455,263 @@ gs_utils_pixbuf_blur (GdkPixbuf *src, guint radius, guint iterations)
 		gs_pixbuf_blur_private (src, tmp, radius, div_kernel_size);
 }
 
+/* Directory trees are sized by a pool of threads, each taking a directory from
+ * the pool’s queue, stat()ing its entries relative to the directory’s fd, and
+ * queuing its subdirectories. */
+#define FILE_SIZE_MAX_THREADS 4
+
+/* Bound on the number of directories remembered in the size cache. */
+#define FILE_SIZE_CACHE_MAX_ENTRIES 65536
+
+typedef struct {
+	dev_t dev;
+	ino_t ino;
+} FileSizeInode;
+
+typedef struct {
+	FileSizeInode inode;
+	guint64 size;
+} FileSizeHardlink;
+
+/* What was found in one directory, excluding its subdirectories. It stays
+ * valid while the directory’s mtime and ctime are unchanged, as entries can’t
+ * be added, removed or renamed without changing those. Files changed in place
+ * don’t change them, so the cache can undercount files which grow. */
+typedef struct {
+	gint64 mtime_nsec;
+	gint64 ctime_nsec;
+	guint64 size;  /* of the entries which have only one link */
+	GArray *hardlinks;  /* (owned) (element-type FileSizeHardlink) */
+	GPtrArray *subdirs;  /* (owned) (element-type filename) */
+} FileSizeCacheEntry;
+
+static GMutex file_size_cache_mutex;
+static GHashTable *file_size_cache = NULL;  /* (mutex file_size_cache_mutex) (owned) (nullable) FileSizeInode → FileSizeCacheEntry */
+
+typedef struct {
+	int root_fd;
+	GsFileSizeIncludeFunc include_func;
+	gpointer user_data;
+	GCancellable *cancellable;
+	GThreadPool *pool;
+
+	GMutex mutex;
+	GCond cond;
+	guint n_pending;  /* (mutex mutex) directories queued or being sized */
+	guint64 size;  /* (mutex mutex) */
+	GHashTable *hardlinks;  /* (mutex mutex) (owned) set of FileSizeInode */
+} FileSizeWalk;
+
+typedef struct {
+	gchar *path;  /* (owned) relative to the root, or "." for the root */
+	struct stat st;
+} FileSizeDir;
+
+static guint
+file_size_inode_hash (gconstpointer v)
+{
+	const FileSizeInode *inode = v;
+	guint64 ino = (guint64) inode->ino;
+	return (guint) ino ^ (guint) (ino >> 32) ^ (guint) inode->dev;
+}
+
+static gboolean
+file_size_inode_equal (gconstpointer a,
+		       gconstpointer b)
+{
+	const FileSizeInode *inode_a = a;
+	const FileSizeInode *inode_b = b;
+	return inode_a->ino == inode_b->ino && inode_a->dev == inode_b->dev;
+}
+
+static void
+file_size_cache_entry_free (FileSizeCacheEntry *entry)
+{
+	g_array_unref (entry->hardlinks);
+	g_ptr_array_unref (entry->subdirs);
+	g_free (entry);
+}
+
+static gint64
+file_size_timespec_nsec (const struct timespec *ts)
+{
+	return (gint64) ts->tv_sec * G_GINT64_CONSTANT (1000000000) + ts->tv_nsec;
+}
+
+static void
+file_size_walk_queue (FileSizeWalk      *walk,
+		      gchar             *path,
+		      const struct stat *st)
+{
+	FileSizeDir *dir = g_new (FileSizeDir, 1);
+
+	dir->path = path;
+	dir->st = *st;
+
+	g_mutex_lock (&walk->mutex);
+	walk->n_pending++;
+	g_mutex_unlock (&walk->mutex);
+
+	g_thread_pool_push (walk->pool, dir, NULL);
+}
+
+static gchar *
+file_size_build_path (const gchar *parent,
+		      const gchar *name)
+{
+	if (g_str_equal (parent, "."))
+		return g_strdup (name);
+	return g_build_filename (parent, name, NULL);
+}
+
+/* Queue the subdirectories of @dir, listed in its cache entry as @subdirs,
+ * which are still there. */
+static void
+file_size_walk_cached (FileSizeWalk *walk,
+		       FileSizeDir  *dir,
+		       GPtrArray    *subdirs)
+{
+	for (guint i = 0; i < subdirs->len; i++) {
+		const gchar *name = g_ptr_array_index (subdirs, i);
+		g_autofree gchar *path = file_size_build_path (dir->path, name);
+		struct stat st;
+
+		if (fstatat (walk->root_fd, path, &st, AT_SYMLINK_NOFOLLOW) == 0 &&
+		    S_ISDIR (st.st_mode))
+			file_size_walk_queue (walk, g_steal_pointer (&path), &st);
+	}
+}
+
+/* Run in @walk->pool. */
+static void
+file_size_walk_dir_cb (gpointer data,
+		       gpointer user_data)
+{
+	FileSizeDir *dir = data;
+	FileSizeWalk *walk = user_data;
+	FileSizeInode inode = { dir->st.st_dev, dir->st.st_ino };
+	gint64 mtime_nsec = file_size_timespec_nsec (&dir->st.st_mtim);
+	gint64 ctime_nsec = file_size_timespec_nsec (&dir->st.st_ctim);
+	g_autoptr(GArray) hardlinks = NULL;
+	g_autoptr(GPtrArray) subdirs = NULL;
+	guint64 size = (guint64) dir->st.st_blocks * 512;
+	gboolean found_in_cache = FALSE;
+	DIR *dirp = NULL;
+	int fd;
+
+	if (g_cancellable_is_cancelled (walk->cancellable))
+		goto out;
+
+	/* The cached entries were counted without an include function. */
+	if (walk->include_func == NULL) {
+		FileSizeCacheEntry *entry;
+
+		g_mutex_lock (&file_size_cache_mutex);
+		entry = (file_size_cache != NULL) ? g_hash_table_lookup (file_size_cache, &inode) : NULL;
+		if (entry != NULL &&
+		    entry->mtime_nsec == mtime_nsec &&
+		    entry->ctime_nsec == ctime_nsec) {
+			size += entry->size;
+			hardlinks = g_array_ref (entry->hardlinks);
+			subdirs = g_ptr_array_ref (entry->subdirs);
+			found_in_cache = TRUE;
+		}
+		g_mutex_unlock (&file_size_cache_mutex);
+	}
+
+	if (found_in_cache) {
+		file_size_walk_cached (walk, dir, subdirs);
+		goto out;
+	}
+
+	hardlinks = g_array_new (FALSE, FALSE, sizeof (FileSizeHardlink));
+	subdirs = g_ptr_array_new_with_free_func (g_free);
+
+	fd = openat (walk->root_fd, dir->path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	if (fd < 0)
+		goto out;
+	dirp = fdopendir (fd);
+	if (dirp == NULL) {
+		close (fd);
+		goto out;
+	}
+
+	for (struct dirent *de = readdir (dirp); de != NULL; de = readdir (dirp)) {
+		g_autofree gchar *path = NULL;
+		struct stat st;
+
+		if (g_str_equal (de->d_name, ".") || g_str_equal (de->d_name, ".."))
+			continue;
+		if (fstatat (dirfd (dirp), de->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+			continue;
+
+		path = file_size_build_path (dir->path, de->d_name);
+
+		if (walk->include_func != NULL &&
+		    !walk->include_func (path,
+					 S_ISLNK (st.st_mode) ? G_FILE_TEST_IS_SYMLINK :
+					 S_ISDIR (st.st_mode) ? G_FILE_TEST_IS_DIR :
+					 G_FILE_TEST_IS_REGULAR,
+					 walk->user_data))
+			continue;
+
+		if (S_ISDIR (st.st_mode)) {
+			g_ptr_array_add (subdirs, g_strdup (de->d_name));
+			file_size_walk_queue (walk, g_steal_pointer (&path), &st);
+		} else if (st.st_nlink > 1) {
+			FileSizeHardlink hardlink = { { st.st_dev, st.st_ino }, (guint64) st.st_blocks * 512 };
+			g_array_append_val (hardlinks, hardlink);
+		} else {
+			size += (guint64) st.st_blocks * 512;
+		}
+	}
+
+	closedir (dirp);
+
+	if (walk->include_func == NULL && !g_cancellable_is_cancelled (walk->cancellable)) {
+		FileSizeCacheEntry *entry = g_new0 (FileSizeCacheEntry, 1);
+
+		entry->mtime_nsec = mtime_nsec;
+		entry->ctime_nsec = ctime_nsec;
+		entry->size = size - (guint64) dir->st.st_blocks * 512;
+		entry->hardlinks = g_array_ref (hardlinks);
+		entry->subdirs = g_ptr_array_ref (subdirs);
+
+		g_mutex_lock (&file_size_cache_mutex);
+		if (file_size_cache == NULL)
+			file_size_cache = g_hash_table_new_full (file_size_inode_hash, file_size_inode_equal,
+								 g_free, (GDestroyNotify) file_size_cache_entry_free);
+		else if (g_hash_table_size (file_size_cache) >= FILE_SIZE_CACHE_MAX_ENTRIES)
+			g_hash_table_remove_all (file_size_cache);
+		g_hash_table_replace (file_size_cache, g_memdup2 (&inode, sizeof (inode)), entry);
+		g_mutex_unlock (&file_size_cache_mutex);
+	}
+
+ out:
+	g_mutex_lock (&walk->mutex);
+
+	walk->size += size;
+
+	/* Files with several links are only counted the first time. */
+	for (guint i = 0; hardlinks != NULL && i < hardlinks->len; i++) {
+		const FileSizeHardlink *hardlink = &g_array_index (hardlinks, FileSizeHardlink, i);
+
+		if (!g_hash_table_contains (walk->hardlinks, &hardlink->inode)) {
+			g_hash_table_add (walk->hardlinks, g_memdup2 (&hardlink->inode, sizeof (hardlink->inode)));
+			walk->size += hardlink->size;
+		}
+	}
+
+	walk->n_pending--;
+	if (walk->n_pending == 0)
+		g_cond_signal (&walk->cond);
+
+	g_mutex_unlock (&walk->mutex);
+
+	g_free (dir->path);
+	g_free (dir);
+}
+
 /**
  * gs_utils_get_file_size:
  * @filename: a file name to get the size of; it can be a file or a directory
@@ -1463,6 +1724,15 @@ gs_utils_pixbuf_blur (GdkPixbuf *src, guint radius, guint iterations)
  * When the @include_func is not %NULL, it can limit which files are included
  * in the resulting size. When it's %NULL, all files and subdirectories are included.
  *
+ * The size is the disk space allocated to the files, as counted by `du`.
+ * Files with several hard links are only counted once, and symbolic links are
+ * not followed. Subdirectories are sized in parallel, so @include_func may be
+ * called from several threads at once.
+ *
+ * When @include_func is %NULL, the contents of each directory are cached
+ * between calls, and are only read again once the directory has been
+ * modified. Files which change size in place are not noticed until then.
+ *
  * Returns: disk size of the @filename; or 0 when not found
  *
  * Since: 41
@@ -1473,63 +1743,44 @@ gs_utils_get_file_size (const gchar *filename,
 			gpointer user_data,
 			GCancellable *cancellable)
 {
-	guint64 size = 0;
+	FileSizeWalk walk = { -1, };
+	struct stat st;
 
 	g_return_val_if_fail (filename != NULL, 0);
 
-	if (g_file_test (filename, G_FILE_TEST_IS_DIR)) {
-		GSList *dirs_to_do = NULL;
-		gsize base_len = strlen (filename);
-
-		/* The `include_func()` expects a path relative to the `filename`, without
-		   a leading dir separator. As the `dirs_to_do` contains the full path,
-		   constructed with `g_build_filename()`, the added dir separator needs
-		   to be skipped, when it's not part of the `filename` already. */
-		if (!g_str_has_suffix (filename, G_DIR_SEPARATOR_S))
-			base_len++;
-
-		dirs_to_do = g_slist_prepend (dirs_to_do, g_strdup (filename));
-		while (dirs_to_do != NULL && !g_cancellable_is_cancelled (cancellable)) {
-			g_autofree gchar *path = NULL;
-			g_autoptr(GDir) dir = NULL;
-
-			/* Steal the top `path` out of the `dirs_to_do`. */
-			path = dirs_to_do->data;
-			dirs_to_do = g_slist_remove (dirs_to_do, path);
-
-			dir = g_dir_open (path, 0, NULL);
-			if (dir) {
-				const gchar *name;
-				while (name = g_dir_read_name (dir), name != NULL && !g_cancellable_is_cancelled (cancellable)) {
-					g_autofree gchar *full_path = g_build_filename (path, name, NULL);
-					GStatBuf st;
-
-					if (g_stat (full_path, &st) == 0 && (include_func == NULL ||
-					    include_func (full_path + base_len,
-							  g_file_test (full_path, G_FILE_TEST_IS_SYMLINK) ? G_FILE_TEST_IS_SYMLINK :
-							  S_ISDIR (st.st_mode) ? G_FILE_TEST_IS_DIR :
-							  G_FILE_TEST_IS_REGULAR,
-							  user_data))) {
-						if (S_ISDIR (st.st_mode)) {
-							/* Skip symlinks, they can point to a shared storage */
-							if (!g_file_test (full_path, G_FILE_TEST_IS_SYMLINK))
-								dirs_to_do = g_slist_prepend (dirs_to_do, g_steal_pointer (&full_path));
-						} else {
-							size += st.st_size;
-						}
-					}
-				}
-			}
-		}
-		g_slist_free_full (dirs_to_do, g_free);
-	} else {
-		GStatBuf st;
+	if (stat (filename, &st) != 0)
+		return 0;
+	if (!S_ISDIR (st.st_mode))
+		return (guint64) st.st_blocks * 512;
 
-		if (g_stat (filename, &st) == 0)
-			size = st.st_size;
-	}
+	walk.root_fd = open (filename, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (walk.root_fd < 0)
+		return 0;
 
-	return size;
+	walk.include_func = include_func;
+	walk.user_data = user_data;
+	walk.cancellable = cancellable;
+	g_mutex_init (&walk.mutex);
+	g_cond_init (&walk.cond);
+	walk.hardlinks = g_hash_table_new_full (file_size_inode_hash, file_size_inode_equal, g_free, NULL);
+	walk.pool = g_thread_pool_new (file_size_walk_dir_cb, &walk,
+				       MIN (g_get_num_processors (), FILE_SIZE_MAX_THREADS),
+				       FALSE, NULL);
+
+	file_size_walk_queue (&walk, g_strdup ("."), &st);
+
+	g_mutex_lock (&walk.mutex);
+	while (walk.n_pending > 0)
+		g_cond_wait (&walk.cond, &walk.mutex);
+	g_mutex_unlock (&walk.mutex);
+
+	g_thread_pool_free (walk.pool, FALSE, TRUE);
+	g_hash_table_unref (walk.hardlinks);
+	g_cond_clear (&walk.cond);
+	g_mutex_clear (&walk.mutex);
+	close (walk.root_fd);
+
+	return walk.size;
 }
 
 #define METADATA_ETAG_ATTRIBUTE "xattr::gnome-software::etag"
@@ -1715,6 +1966,35 @@ gs_utils_app_sort_match_value (GsApp    *app1,
 	return gs_app_get_match_value (app2) - gs_app_get_match_value (app1);
 }
 
+/**
+ * gs_utils_app_sort_release_date:
+ * @app1: a #GsApp
+ * @app2: another #GsApp
+ * @user_data: data passed to the sort function
+ *
+ * Comparison function to sort apps in decreasing order of release date
+ * (#GsApp:release-date), so the most recently released come first. Apps
+ * with the same release date are sorted by name.
+ *
+ * This is suitable for passing to gs_app_list_sort().
+ *
+ * Returns: a strcmp()-style sort value comparing @app1 to @app2
+ * Since: 48
+ */
+gint
+gs_utils_app_sort_release_date (GsApp    *app1,
+                                GsApp    *app2,
+                                gpointer  user_data)
+{
+	guint64 date1 = gs_app_get_release_date (app1);
+	guint64 date2 = gs_app_get_release_date (app2);
+
+	if (date1 != date2)
+		return (date1 < date2) ? 1 : -1;
+
+	return gs_utils_app_sort_name (app1, app2, user_data);
+}
+
 /**
  * gs_utils_app_sort_priority:
  * @app1: a #GsApp
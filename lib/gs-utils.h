@@ -154,6 +154,9 @@ gint		 gs_utils_app_sort_name		(GsApp			*app1,
 gint		 gs_utils_app_sort_match_value	(GsApp			*app1,
 						 GsApp			*app2,
 						 gpointer		 user_data);
+gint		 gs_utils_app_sort_release_date	(GsApp			*app1,
+						 GsApp			*app2,
+						 gpointer		 user_data);
 gint		 gs_utils_app_sort_priority	(GsApp			*app1,
 						 GsApp			*app2,
 						 gpointer		 user_data);
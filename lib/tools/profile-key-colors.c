@@ -14,6 +14,8 @@
 #include <gdk/gdk.h>
 #include <locale.h>
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "gs-key-colors.h"
 
@@ -21,7 +23,189 @@
  * gs_calculate_key_colors() function. It is linked against libgnomesoftware, so
  * will use the function implementation from there. It outputs a HTML page which
  * lists each icon from the flathub appstream data in your home directory, along
- * with its extracted key colors and how long extraction took. */
+ * with its extracted key colors and how long extraction took.
+ *
+ * The results are compared against reference_calculate_key_colors(), a copy of
+ * the straightforward per-pixel implementation, run with the same random seed,
+ * so changes to the optimised implementation can be checked for both speed and
+ * output. Keep the reference implementation as it is. */
+
+#define N_CLUSTERS 3
+#define MINIMUM_ALPHA (0.5 * 255)
+
+typedef struct {
+	guint8 red;
+	guint8 green;
+	guint8 blue;
+} Pixel8;
+
+typedef struct {
+	Pixel8 color;
+	union {
+		guint8 alpha;
+		guint8 cluster;
+	};
+} ClusterPixel8;
+
+typedef struct {
+	guint red;
+	guint green;
+	guint blue;
+	guint n_members;
+} CentroidAccumulator;
+
+static inline guint
+reference_color_distance (const Pixel8 *a,
+                          const Pixel8 *b)
+{
+	gint dr = b->red - a->red;
+	gint dg = b->green - a->green;
+	gint db = b->blue - a->blue;
+
+	return abs (dr * dr + dg * dg + db * db);
+}
+
+static inline gsize
+reference_nearest_cluster (const Pixel8 *pixel,
+                           const Pixel8 *cluster_centres,
+                           gsize         n_cluster_centres)
+{
+	gsize nearest_cluster = 0;
+	guint nearest_cluster_distance = reference_color_distance (&cluster_centres[0], pixel);
+
+	for (gsize i = 1; i < n_cluster_centres; i++) {
+		guint distance = reference_color_distance (&cluster_centres[i], pixel);
+		if (distance < nearest_cluster_distance) {
+			nearest_cluster = i;
+			nearest_cluster_distance = distance;
+		}
+	}
+
+	return nearest_cluster;
+}
+
+static gint32
+reference_random_int_range_no_replacement (guint     max_ints,
+                                           gboolean *used_ints,
+                                           guint    *n_used_ints)
+{
+	gint32 random_value = g_random_int_range (0, (gint32) max_ints);
+
+	if (*n_used_ints < max_ints) {
+		while (used_ints[random_value])
+			random_value = (random_value + 1) % max_ints;
+
+		used_ints[random_value] = TRUE;
+		*n_used_ints = *n_used_ints + 1;
+	}
+
+	return random_value;
+}
+
+static GArray *
+reference_calculate_key_colors (GdkPixbuf *pixbuf)
+{
+	g_autoptr(GdkPixbuf) pb_small = NULL;
+	g_autoptr(GArray) colors = g_array_new (FALSE, FALSE, sizeof (GdkRGBA));
+	ClusterPixel8 *pixels;
+	const ClusterPixel8 *pixels_end;
+	Pixel8 cluster_centres[N_CLUSTERS];
+	CentroidAccumulator cluster_accumulators[N_CLUSTERS];
+	gboolean used_clusters[N_CLUSTERS];
+	guint n_used_clusters = 0;
+	guint n_assignments_changed;
+	guint n_iterations = 0;
+	guint assignments_termination_limit;
+
+	pb_small = gdk_pixbuf_scale_simple (pixbuf, 32, 32, GDK_INTERP_NEAREST);
+	if (gdk_pixbuf_get_n_channels (pixbuf) != 4) {
+		g_autoptr(GdkPixbuf) temp = g_steal_pointer (&pb_small);
+		pb_small = gdk_pixbuf_add_alpha (temp, FALSE, 0, 0, 0);
+	}
+
+	pixels = (ClusterPixel8 *) gdk_pixbuf_get_pixels (pb_small);
+	pixels_end = &pixels[gdk_pixbuf_get_height (pb_small) * gdk_pixbuf_get_width (pb_small)];
+
+	memset (cluster_centres, 0, sizeof (cluster_centres));
+	memset (used_clusters, 0, sizeof (used_clusters));
+
+	for (ClusterPixel8 *p = pixels; p < pixels_end; p++) {
+		if (p->alpha < MINIMUM_ALPHA)
+			p->cluster = N_CLUSTERS;
+		else
+			p->cluster = reference_random_int_range_no_replacement (N_CLUSTERS, used_clusters, &n_used_clusters);
+	}
+
+	assignments_termination_limit = (pixels_end - pixels) * 0.01;
+	do {
+		memset (cluster_accumulators, 0, sizeof (cluster_accumulators));
+
+		for (const ClusterPixel8 *p = pixels; p < pixels_end; p++) {
+			if (p->cluster >= N_CLUSTERS)
+				continue;
+
+			cluster_accumulators[p->cluster].red += p->color.red;
+			cluster_accumulators[p->cluster].green += p->color.green;
+			cluster_accumulators[p->cluster].blue += p->color.blue;
+			cluster_accumulators[p->cluster].n_members++;
+		}
+
+		for (gsize i = 0; i < N_CLUSTERS; i++) {
+			if (cluster_accumulators[i].n_members == 0)
+				continue;
+
+			cluster_centres[i].red = cluster_accumulators[i].red / cluster_accumulators[i].n_members;
+			cluster_centres[i].green = cluster_accumulators[i].green / cluster_accumulators[i].n_members;
+			cluster_centres[i].blue = cluster_accumulators[i].blue / cluster_accumulators[i].n_members;
+		}
+
+		n_assignments_changed = 0;
+		for (ClusterPixel8 *p = pixels; p < pixels_end; p++) {
+			gsize new_cluster;
+
+			if (p->cluster >= N_CLUSTERS)
+				continue;
+
+			new_cluster = reference_nearest_cluster (&p->color, cluster_centres, N_CLUSTERS);
+			if (new_cluster != p->cluster)
+				n_assignments_changed++;
+			p->cluster = new_cluster;
+		}
+
+		n_iterations++;
+	} while (n_assignments_changed > assignments_termination_limit && n_iterations < 50);
+
+	for (gsize i = 0; i < N_CLUSTERS; i++) {
+		GdkRGBA color;
+
+		if (cluster_accumulators[i].n_members == 0)
+			continue;
+
+		color.red = (gdouble) cluster_centres[i].red / 255.0;
+		color.green = (gdouble) cluster_centres[i].green / 255.0;
+		color.blue = (gdouble) cluster_centres[i].blue / 255.0;
+		color.alpha = 1.0;
+		g_array_append_val (colors, color);
+	}
+
+	return g_steal_pointer (&colors);
+}
+
+static gboolean
+colours_equal (GArray *a,
+               GArray *b)
+{
+	if (a->len != b->len)
+		return FALSE;
+
+	for (guint i = 0; i < a->len; i++) {
+		if (!gdk_rgba_equal (&g_array_index (a, GdkRGBA, i),
+				     &g_array_index (b, GdkRGBA, i)))
+			return FALSE;
+	}
+
+	return TRUE;
+}
 
 static void
 print_colours (GString *html_output,
@@ -85,6 +269,8 @@ main (void)
 	g_autoptr(GPtrArray) pixbufs = g_ptr_array_new_with_free_func (g_object_unref);
 	g_autoptr(GString) html_output = g_string_new ("");
 	g_autoptr(GArray) durations = g_array_new (FALSE, FALSE, sizeof (gint64));
+	g_autoptr(GArray) reference_durations = g_array_new (FALSE, FALSE, sizeof (gint64));
+	guint n_mismatches = 0;
 
 	setlocale (LC_ALL, "");
 
@@ -128,6 +314,8 @@ main (void)
 			 "        <tr>\n"
 			 "          <td>Filename</td>\n"
 			 "          <td>Icon</td>\n"
+			 "          <td>Reference duration (μs)</td>\n"
+			 "          <td>Reference colours</td>\n"
 			 "          <td>Code duration (μs)</td>\n"
 			 "          <td>Code colours</td>\n"
 			 "        </tr>\n"
@@ -138,34 +326,60 @@ main (void)
 		GdkPixbuf *pixbuf = pixbufs->pdata[i];
 		const gchar *filename = filenames->pdata[i];
 		g_autofree gchar *basename = g_path_get_basename (filename);
+		g_autoptr(GArray) reference_colours = NULL;
 		g_autoptr(GArray) colours = NULL;
-		gint64 start_time, duration;
+		gint64 start_time, duration, reference_duration;
+		gboolean match;
 
 		g_message ("Processing %u of %u, %s", i + 1, pixbufs->len, filename);
 
+		/* Both implementations use the same random initialisation, so
+		 * should give the same results from the same seed. */
+		g_random_set_seed (i);
+		start_time = g_get_real_time ();
+		reference_colours = reference_calculate_key_colors (pixbuf);
+		reference_duration = g_get_real_time () - start_time;
+
+		g_random_set_seed (i);
 		start_time = g_get_real_time ();
 		colours = gs_calculate_key_colors (pixbuf);
 		duration = g_get_real_time () - start_time;
 
+		match = colours_equal (reference_colours, colours);
+		if (!match)
+			n_mismatches++;
+
 		g_string_append_printf (html_output,
 					"<tr>\n"
 					"<th>%s</th>\n"
 					"<td><img src='file:%s'></td>\n"
 					"<td class='number'>%" G_GINT64_FORMAT "</td>\n"
 					"<td>",
-					basename, filename, duration);
+					basename, filename, reference_duration);
+		print_colours (html_output, reference_colours);
+		g_string_append_printf (html_output,
+					"</td>\n"
+					"<td class='number %s'>%" G_GINT64_FORMAT "</td>\n"
+					"<td class='%s'>",
+					(duration < reference_duration) ? "faster" : (duration > reference_duration) ? "slower" : "",
+					duration,
+					match ? "" : "slower");
 		print_colours (html_output, colours);
 		g_string_append (html_output,
 				 "</td>\n"
 				 "</tr>\n");
 
+		g_array_append_val (reference_durations, reference_duration);
 		g_array_append_val (durations, duration);
 	}
 
 	/* Summary statistics for the timings. */
 	g_string_append (html_output, "<tfoot><tr><td></td><td></td><td>");
+	print_summary_statistics (html_output, reference_durations);
+	g_string_append (html_output, "</td><td></td><td>");
 	print_summary_statistics (html_output, durations);
-	g_string_append (html_output, "</td><td></td></tr></tfoot>");
+	g_string_append_printf (html_output, "</td><td>%u of %u differ</td></tr></tfoot>",
+				n_mismatches, pixbufs->len);
 
 	g_string_append (html_output, "</table></body></html>");
 
@@ -369,21 +369,23 @@ gs_plugin_appstream_load_dep11_cb (XbBuilderSource *self,
 	return g_memory_input_stream_new_from_data (g_steal_pointer (&xml), (gssize) -1, g_free);
 }
 
+/* the elements which are tokenized in the silo, for searching */
+static const gchar * const elements_to_tokenize[] = {
+	"id",
+	"keyword",
+	"launchable",
+	"mimetype",
+	"name",
+	"pkgname",
+	"summary",
+	NULL };
+
 static gboolean
 gs_plugin_appstream_tokenize_cb (XbBuilderFixup *self,
 				 XbBuilderNode *bn,
 				 gpointer user_data,
 				 GError **error)
 {
-	const gchar * const elements_to_tokenize[] = {
-		"id",
-		"keyword",
-		"launchable",
-		"mimetype",
-		"name",
-		"pkgname",
-		"summary",
-		NULL };
 	if (xb_builder_node_get_element (bn) != NULL &&
 	    g_strv_contains (elements_to_tokenize, xb_builder_node_get_element (bn)))
 		xb_builder_node_tokenize_text (bn);
@@ -549,6 +551,7 @@ gs_plugin_appstream_check_silo (GsPluginAppstream  *self,
 	g_autoptr(GPtrArray) parent_appdata = g_ptr_array_new_with_free_func (g_free);
 	g_autoptr(GPtrArray) parent_appstream = NULL;
 	g_autoptr(GMainContext) old_thread_default = NULL;
+	g_autoptr(GError) local_error = NULL;
 
 	reader_locker = g_rw_lock_reader_locker_new (&self->silo_lock);
 	/* everything is okay */
@@ -560,6 +563,8 @@ gs_plugin_appstream_check_silo (GsPluginAppstream  *self,
 	/* drat! silo needs regenerating */
 	writer_locker = g_rw_lock_writer_locker_new (&self->silo_lock);
  reload:
+	if (self->silo != NULL)
+		gs_appstream_drop_lazy_data (self->silo);
 	g_clear_object (&self->silo);
 	g_clear_pointer (&self->silo_filename, g_free);
 	g_clear_pointer (&self->silo_installed_by_desktopid, g_hash_table_unref);
@@ -614,21 +619,36 @@ gs_plugin_appstream_check_silo (GsPluginAppstream  *self,
 		parent_appstream = g_ptr_array_new_with_free_func (g_free);
 	} else {
 		g_autoptr(GPtrArray) parent_desktop = g_ptr_array_new ();
-
-		g_ptr_array_add (parent_desktop, (gpointer) DATADIR "/applications");
-		if (g_strcmp0 (DATADIR, "/usr/share") != 0)
-			g_ptr_array_add (parent_desktop, (gpointer) "/usr/share/applications");
-
-		/* add search paths */
-		parent_appstream = gs_appstream_get_appstream_data_dirs ();
-		gs_add_appstream_metainfo_location (parent_appdata, DATADIR);
-
-		/* Add the normal system directories if the installation prefix
-		 * is different from normal — typically this happens when doing
-		 * development builds. It’s useful to still list the system apps
-		 * during development. */
-		if (g_strcmp0 (DATADIR, "/usr/share") != 0)
-			gs_add_appstream_metainfo_location (parent_appdata, "/usr/share");
+		g_autofree gchar *test_desktop_dir = NULL;
+		const gchar *test_prefix;
+
+		/* only when benchmarking; unlike GS_SELF_TEST_APPSTREAM_XML,
+		 * this loads files through the same code paths as the system
+		 * data, so it can be used to measure them */
+		test_prefix = g_getenv ("GS_SELF_TEST_APPSTREAM_PREFIX");
+		if (test_prefix != NULL) {
+			test_desktop_dir = g_build_filename (test_prefix, "applications", NULL);
+			g_ptr_array_add (parent_desktop, test_desktop_dir);
+
+			parent_appstream = g_ptr_array_new_with_free_func (g_free);
+			g_ptr_array_add (parent_appstream, g_build_filename (test_prefix, "swcatalog", "xml", NULL));
+			gs_add_appstream_metainfo_location (parent_appdata, test_prefix);
+		} else {
+			g_ptr_array_add (parent_desktop, (gpointer) DATADIR "/applications");
+			if (g_strcmp0 (DATADIR, "/usr/share") != 0)
+				g_ptr_array_add (parent_desktop, (gpointer) "/usr/share/applications");
+
+			/* add search paths */
+			parent_appstream = gs_appstream_get_appstream_data_dirs ();
+			gs_add_appstream_metainfo_location (parent_appdata, DATADIR);
+
+			/* Add the normal system directories if the installation prefix
+			 * is different from normal — typically this happens when doing
+			 * development builds. It’s useful to still list the system apps
+			 * during development. */
+			if (g_strcmp0 (DATADIR, "/usr/share") != 0)
+				gs_add_appstream_metainfo_location (parent_appdata, "/usr/share");
+		}
 
 		/* FIXME: https://gitlab.gnome.org/GNOME/gnome-software/-/issues/1422 */
 		old_thread_default = g_main_context_ref_thread_default ();
@@ -725,6 +745,14 @@ gs_plugin_appstream_check_silo (GsPluginAppstream  *self,
 
 	g_clear_object (&n);
 
+	/* build the search indexes now, or load them if the silo hasn’t
+	 * changed, rather than on the first search */
+	if (!gs_appstream_search_index_build (self->silo, file, elements_to_tokenize,
+					      cancellable, &local_error)) {
+		g_debug ("appstream: Failed to build search index: %s", local_error->message);
+		g_clear_error (&local_error);
+	}
+
 	self->silo_installed_by_desktopid = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
 	self->silo_installed_by_id = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
@@ -794,8 +822,10 @@ gs_plugin_appstream_reload (GsPlugin *plugin)
 
 	self = GS_PLUGIN_APPSTREAM (plugin);
 	writer_locker = g_rw_lock_writer_locker_new (&self->silo_lock);
-	if (self->silo != NULL)
+	if (self->silo != NULL) {
 		xb_silo_invalidate (self->silo);
+		gs_appstream_drop_lazy_data (self->silo);
+	}
 }
 
 static gint
@@ -1035,6 +1065,7 @@ gs_plugin_refine_from_id (GsPluginAppstream    *self,
 {
 	const gchar *id, *origin;
 	GPtrArray *components;
+	g_autoptr(GPtrArray) apps = NULL;
 	g_autoptr(GRWLockReaderLocker) locker = NULL;
 
 	/* not enough info to find */
@@ -1329,15 +1360,17 @@ refine_wildcard (GsPluginAppstream    *self,
 	components = g_hash_table_lookup (apps_by_id, id);
 	if (components == NULL)
 		return TRUE;
-	for (guint i = 0; i < components->len; i++) {
+
+	/* new apps, resolved against the plugin cache in one go */
+	apps = gs_appstream_create_apps (GS_PLUGIN (self), self->silo, components, self->silo_filename ? self->silo_filename : "",
+					 self->default_scope, error);
+	if (apps == NULL)
+		return FALSE;
+
+	for (guint i = 0; i < apps->len; i++) {
 		XbNode *component = g_ptr_array_index (components, i);
-		g_autoptr(GsApp) new = NULL;
+		GsApp *new = g_ptr_array_index (apps, i);
 
-		/* new app */
-		new = gs_appstream_create_app (GS_PLUGIN (self), self->silo, component, self->silo_filename ? self->silo_filename : "",
-					       self->default_scope, error);
-		if (new == NULL)
-			return FALSE;
 		gs_app_set_scope (new, AS_COMPONENT_SCOPE_SYSTEM);
 		gs_app_subsume_metadata (new, app);
 		if (!gs_appstream_refine_app (GS_PLUGIN (self), new, self->silo, component, refine_flags, self->silo_installed_by_desktopid,
@@ -1476,6 +1509,8 @@ list_apps_thread_cb (GTask        *task,
 	const gchar * const *developers = NULL;
 	const gchar * const *keywords = NULL;
 	GsApp *alternate_of = NULL;
+	guint max_recent = 0;
+	guint max_matches = 0;
 	g_autoptr(GError) local_error = NULL;
 
 	assert_in_worker (self);
@@ -1490,6 +1525,11 @@ list_apps_thread_cb (GTask        *task,
 		developers = gs_app_query_get_developers (data->query);
 		keywords = gs_app_query_get_keywords (data->query);
 		alternate_of = gs_app_query_get_alternate_of (data->query);
+
+		/* only the top results are needed, if the query is sorted
+		 * in the order they are listed in */
+		max_recent = gs_app_query_get_max_candidates (data->query, gs_utils_app_sort_release_date);
+		max_matches = gs_app_query_get_max_candidates (data->query, gs_utils_app_sort_match_value);
 	}
 	if (released_since != NULL) {
 		g_autoptr(GDateTime) now = g_date_time_new_now_utc ();
@@ -1526,7 +1566,7 @@ list_apps_thread_cb (GTask        *task,
 
 	if (released_since != NULL &&
 	    !gs_appstream_add_recent (GS_PLUGIN (self), self->silo, list, age_secs,
-				      cancellable, &local_error)) {
+				      max_recent, cancellable, &local_error)) {
 		g_task_return_error (task, g_steal_pointer (&local_error));
 		return;
 	}
@@ -1569,7 +1609,7 @@ list_apps_thread_cb (GTask        *task,
 	}
 
 	if (keywords != NULL &&
-	    !gs_appstream_search (GS_PLUGIN (self), self->silo, keywords, list, cancellable, &local_error)) {
+	    !gs_appstream_search (GS_PLUGIN (self), self->silo, keywords, list, max_matches, cancellable, &local_error)) {
 		g_task_return_error (task, g_steal_pointer (&local_error));
 		return;
 	}
@@ -8,9 +8,9 @@
 
 #include <config.h>
 
-#include <fnmatch.h>
 #include <gnome-software.h>
 
+#include "gs-glob-set.h"
 #include "gs-plugin-hardcoded-blocklist.h"
 
 /*
@@ -23,6 +23,8 @@
 struct _GsPluginHardcodedBlocklist
 {
 	GsPlugin		 parent;
+
+	GsGlobSet		*app_globs;  /* (owned) */
 };
 
 G_DEFINE_TYPE (GsPluginHardcodedBlocklist, gs_plugin_hardcoded_blocklist, GS_TYPE_PLUGIN)
@@ -30,18 +32,6 @@ G_DEFINE_TYPE (GsPluginHardcodedBlocklist, gs_plugin_hardcoded_blocklist, GS_TYP
 static void
 gs_plugin_hardcoded_blocklist_init (GsPluginHardcodedBlocklist *self)
 {
-	/* need ID */
-	gs_plugin_add_rule (GS_PLUGIN (self), GS_PLUGIN_RULE_RUN_AFTER, "appstream");
-}
-
-static gboolean
-refine_app (GsPlugin             *plugin,
-	    GsApp                *app,
-	    GsPluginRefineFlags   flags,
-	    GCancellable         *cancellable,
-	    GError              **error)
-{
-	guint i;
 	const gchar *app_globs[] = {
 		"freeciv-server.desktop",
 		"links.desktop",
@@ -57,17 +47,42 @@ refine_app (GsPlugin             *plugin,
 		"wine-*.desktop",
 		NULL };
 
+	/* need ID */
+	gs_plugin_add_rule (GS_PLUGIN (self), GS_PLUGIN_RULE_RUN_AFTER, "appstream");
+
+	/* compiled once, so each app is matched against all the globs in
+	 * one pass */
+	self->app_globs = gs_glob_set_new ();
+	for (guint i = 0; app_globs[i] != NULL; i++)
+		gs_glob_set_add (self->app_globs, app_globs[i], 1);
+}
+
+static void
+gs_plugin_hardcoded_blocklist_finalize (GObject *object)
+{
+	GsPluginHardcodedBlocklist *self = GS_PLUGIN_HARDCODED_BLOCKLIST (object);
+
+	g_clear_pointer (&self->app_globs, gs_glob_set_unref);
+
+	G_OBJECT_CLASS (gs_plugin_hardcoded_blocklist_parent_class)->finalize (object);
+}
+
+static gboolean
+refine_app (GsPlugin             *plugin,
+	    GsApp                *app,
+	    GsPluginRefineFlags   flags,
+	    GCancellable         *cancellable,
+	    GError              **error)
+{
+	GsPluginHardcodedBlocklist *self = GS_PLUGIN_HARDCODED_BLOCKLIST (plugin);
+
 	/* not set yet */
 	if (gs_app_get_id (app) == NULL)
 		return TRUE;
 
 	/* search */
-	for (i = 0; app_globs[i] != NULL; i++) {
-		if (fnmatch (app_globs[i], gs_app_get_id (app), 0) == 0) {
-			gs_app_add_quirk (app, GS_APP_QUIRK_HIDE_EVERYWHERE);
-			break;
-		}
-	}
+	if (gs_glob_set_matches (self->app_globs, gs_app_get_id (app)))
+		gs_app_add_quirk (app, GS_APP_QUIRK_HIDE_EVERYWHERE);
 
 	return TRUE;
 }
@@ -108,8 +123,11 @@ gs_plugin_hardcoded_blocklist_refine_finish (GsPlugin      *plugin,
 static void
 gs_plugin_hardcoded_blocklist_class_init (GsPluginHardcodedBlocklistClass *klass)
 {
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
 	GsPluginClass *plugin_class = GS_PLUGIN_CLASS (klass);
 
+	object_class->finalize = gs_plugin_hardcoded_blocklist_finalize;
+
 	plugin_class->refine_async = gs_plugin_hardcoded_blocklist_refine_async;
 	plugin_class->refine_finish = gs_plugin_hardcoded_blocklist_refine_finish;
 }
@@ -11,6 +11,7 @@
 
 #include <gnome-software.h>
 
+#include "gs-glob-set.h"
 #include "gs-plugin-provenance.h"
 
 /*
@@ -25,30 +26,11 @@ struct _GsPluginProvenance {
 	GsPlugin		 parent;
 
 	GSettings		*settings;
-	GHashTable		*repos; /* gchar *name ~> guint flags */
-	GPtrArray		*provenance_wildcards; /* non-NULL, when have names with wildcards */
-	GPtrArray		*compulsory_wildcards; /* non-NULL, when have names with wildcards */
+	GsGlobSet		*repos; /* (owned), repo name glob ~> GsAppQuirk flags */
 };
 
 G_DEFINE_TYPE (GsPluginProvenance, gs_plugin_provenance, GS_TYPE_PLUGIN)
 
-static GHashTable *
-gs_plugin_provenance_remove_by_flag (GHashTable *old_repos,
-				     GsAppQuirk quirk)
-{
-	GHashTable *new_repos = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
-	GHashTableIter iter;
-	gpointer key, value;
-	g_hash_table_iter_init (&iter, old_repos);
-	while (g_hash_table_iter_next (&iter, &key, &value)) {
-		guint flags = GPOINTER_TO_UINT (value);
-		flags = flags & (~quirk);
-		if (flags != 0)
-			g_hash_table_insert (new_repos, g_strdup (key), GUINT_TO_POINTER (flags));
-	}
-	return new_repos;
-}
-
 static void
 gs_plugin_provenance_add_quirks (GsApp *app,
 				 guint quirks)
@@ -75,61 +57,48 @@ gs_plugin_provenance_get_sources (GsPluginProvenance *self,
 	return g_settings_get_strv (self->settings, key);
 }
 
+static void
+gs_plugin_provenance_add_sources (GsPluginProvenance *self,
+				  GsGlobSet *repos,
+				  const gchar *key,
+				  GsAppQuirk quirk)
+{
+	g_auto(GStrv) sources = gs_plugin_provenance_get_sources (self, key);
+
+	for (guint i = 0; sources != NULL && sources[i] != NULL; i++)
+		gs_glob_set_add (repos, sources[i], quirk);
+}
+
 static void
 gs_plugin_provenance_settings_changed_cb (GSettings *settings,
 					  const gchar *key,
 					  gpointer user_data)
 {
 	GsPluginProvenance *self = GS_PLUGIN_PROVENANCE (user_data);
-	GsAppQuirk quirk = GS_APP_QUIRK_NONE;
-	GPtrArray **pwildcards = NULL;
-
-	if (g_strcmp0 (key, "official-repos") == 0) {
-		quirk = GS_APP_QUIRK_PROVENANCE;
-		pwildcards = &self->provenance_wildcards;
-	} else if (g_strcmp0 (key, "required-repos") == 0) {
-		quirk = GS_APP_QUIRK_COMPULSORY;
-		pwildcards = &self->compulsory_wildcards;
-	}
+	g_autoptr(GsGlobSet) repos = NULL;
 
-	if (quirk != GS_APP_QUIRK_NONE) {
-		/* The keys are stolen by the hash table, thus free only the array */
-		g_autofree gchar **repos = NULL;
-		g_autoptr(GHashTable) old_repos = self->repos;
-		g_autoptr(GPtrArray) old_wildcards = *pwildcards;
-		GHashTable *new_repos = gs_plugin_provenance_remove_by_flag (old_repos, quirk);
-		GPtrArray *new_wildcards = NULL;
-		repos = gs_plugin_provenance_get_sources (self, key);
-		for (guint ii = 0; repos && repos[ii]; ii++) {
-			gchar *repo = g_steal_pointer (&(repos[ii]));
-			if (strchr (repo, '*') ||
-			    strchr (repo, '?') ||
-			    strchr (repo, '[')) {
-				if (new_wildcards == NULL)
-					new_wildcards = g_ptr_array_new_with_free_func (g_free);
-				g_ptr_array_add (new_wildcards, repo);
-			} else {
-				g_hash_table_insert (new_repos, repo,
-					GUINT_TO_POINTER (quirk |
-					GPOINTER_TO_UINT (g_hash_table_lookup (new_repos, repo))));
-			}
-		}
-		if (new_wildcards != NULL)
-			g_ptr_array_add (new_wildcards, NULL);
-		self->repos = new_repos;
-		*pwildcards = new_wildcards;
-	}
+	if (g_strcmp0 (key, "official-repos") != 0 &&
+	    g_strcmp0 (key, "required-repos") != 0)
+		return;
+
+	/* rebuilt from both keys, as a repo can be in both; the set is
+	 * replaced rather than modified, as refines in progress hold a
+	 * reference to the old one */
+	repos = gs_glob_set_new ();
+	gs_plugin_provenance_add_sources (self, repos, "official-repos", GS_APP_QUIRK_PROVENANCE);
+	gs_plugin_provenance_add_sources (self, repos, "required-repos", GS_APP_QUIRK_COMPULSORY);
+
+	g_clear_pointer (&self->repos, gs_glob_set_unref);
+	self->repos = g_steal_pointer (&repos);
 }
 
 static void
 gs_plugin_provenance_init (GsPluginProvenance *self)
 {
 	self->settings = g_settings_new ("org.gnome.software");
-	self->repos = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 	g_signal_connect (self->settings, "changed",
 			  G_CALLBACK (gs_plugin_provenance_settings_changed_cb), self);
 	gs_plugin_provenance_settings_changed_cb (self->settings, "official-repos", self);
-	gs_plugin_provenance_settings_changed_cb (self->settings, "required-repos", self);
 
 	/* after the package source is set */
 	gs_plugin_add_rule (GS_PLUGIN (self), GS_PLUGIN_RULE_RUN_AFTER, "dummy");
@@ -142,30 +111,20 @@ gs_plugin_provenance_dispose (GObject *object)
 {
 	GsPluginProvenance *self = GS_PLUGIN_PROVENANCE (object);
 
-	g_clear_pointer (&self->repos, g_hash_table_unref);
-	g_clear_pointer (&self->provenance_wildcards, g_ptr_array_unref);
-	g_clear_pointer (&self->compulsory_wildcards, g_ptr_array_unref);
+	g_clear_pointer (&self->repos, gs_glob_set_unref);
 	g_clear_object (&self->settings);
 
 	G_OBJECT_CLASS (gs_plugin_provenance_parent_class)->dispose (object);
 }
 
 static gboolean
-gs_plugin_provenance_find_repo_flags (GHashTable *repos,
-				      GPtrArray *provenance_wildcards,
-				      GPtrArray *compulsory_wildcards,
+gs_plugin_provenance_find_repo_flags (GsGlobSet *repos,
 				      const gchar *repo,
 				      guint *out_flags)
 {
 	if (repo == NULL || *repo == '\0')
 		return FALSE;
-	*out_flags = GPOINTER_TO_UINT (g_hash_table_lookup (repos, repo));
-	if (provenance_wildcards != NULL &&
-	    gs_utils_strv_fnmatch ((gchar **) provenance_wildcards->pdata, repo))
-		*out_flags |= GS_APP_QUIRK_PROVENANCE;
-	if (compulsory_wildcards != NULL &&
-	    gs_utils_strv_fnmatch ((gchar **) compulsory_wildcards->pdata, repo))
-		*out_flags |= GS_APP_QUIRK_COMPULSORY;
+	*out_flags = gs_glob_set_match (repos, repo);
 	return *out_flags != 0;
 }
 
@@ -173,9 +132,7 @@ static gboolean
 refine_app (GsPlugin             *plugin,
 	    GsApp                *app,
 	    GsPluginRefineFlags   flags,
-	    GHashTable		 *repos,
-	    GPtrArray		 *provenance_wildcards,
-	    GPtrArray		 *compulsory_wildcards,
+	    GsGlobSet		 *repos,
 	    GCancellable         *cancellable,
 	    GError              **error)
 {
@@ -192,7 +149,7 @@ refine_app (GsPlugin             *plugin,
 	 * provenance quirk to the system-configured repositories (but not
 	 * user-configured ones). */
 	if (gs_app_get_kind (app) == AS_COMPONENT_KIND_REPOSITORY) {
-		if (gs_plugin_provenance_find_repo_flags (repos, provenance_wildcards, compulsory_wildcards, gs_app_get_id (app), &quirks) &&
+		if (gs_plugin_provenance_find_repo_flags (repos, gs_app_get_id (app), &quirks) &&
 		    gs_app_get_scope (app) != AS_COMPONENT_SCOPE_USER)
 			gs_plugin_provenance_add_quirks (app, quirks);
 		return TRUE;
@@ -200,7 +157,7 @@ refine_app (GsPlugin             *plugin,
 
 	/* simple case */
 	origin = gs_app_get_origin (app);
-	if (gs_plugin_provenance_find_repo_flags (repos, provenance_wildcards, compulsory_wildcards, origin, &quirks)) {
+	if (gs_plugin_provenance_find_repo_flags (repos, origin, &quirks)) {
 		gs_plugin_provenance_add_quirks (app, quirks);
 		return TRUE;
 	}
@@ -214,7 +171,7 @@ refine_app (GsPlugin             *plugin,
 		return TRUE;
 	if (g_str_has_prefix (origin + 1, "installed:"))
 		origin += 10;
-	if (gs_plugin_provenance_find_repo_flags (repos, provenance_wildcards, compulsory_wildcards, origin + 1, &quirks))
+	if (gs_plugin_provenance_find_repo_flags (repos, origin + 1, &quirks))
 		gs_plugin_provenance_add_quirks (app, quirks);
 
 	return TRUE;
@@ -231,9 +188,7 @@ gs_plugin_provenance_refine_async (GsPlugin            *plugin,
 	GsPluginProvenance *self = GS_PLUGIN_PROVENANCE (plugin);
 	g_autoptr(GTask) task = NULL;
 	g_autoptr(GError) local_error = NULL;
-	g_autoptr(GHashTable) repos = NULL;
-	g_autoptr(GPtrArray) provenance_wildcards = NULL;
-	g_autoptr(GPtrArray) compulsory_wildcards = NULL;
+	g_autoptr(GsGlobSet) repos = NULL;
 
 	task = g_task_new (plugin, cancellable, callback, user_data);
 	g_task_set_source_tag (task, gs_plugin_provenance_refine_async);
@@ -244,19 +199,17 @@ gs_plugin_provenance_refine_async (GsPlugin            *plugin,
 		return;
 	}
 
-	repos = g_hash_table_ref (self->repos);
-	provenance_wildcards = self->provenance_wildcards != NULL ? g_ptr_array_ref (self->provenance_wildcards) : NULL;
-	compulsory_wildcards = self->compulsory_wildcards != NULL ? g_ptr_array_ref (self->compulsory_wildcards) : NULL;
+	repos = gs_glob_set_ref (self->repos);
 
 	/* nothing to search */
-	if (g_hash_table_size (repos) == 0 && provenance_wildcards == NULL && compulsory_wildcards == NULL) {
+	if (gs_glob_set_is_empty (repos)) {
 		g_task_return_boolean (task, TRUE);
 		return;
 	}
 
 	for (guint i = 0; i < gs_app_list_length (list); i++) {
 		GsApp *app = gs_app_list_index (list, i);
-		if (!refine_app (plugin, app, flags, repos, provenance_wildcards, compulsory_wildcards, cancellable, &local_error)) {
+		if (!refine_app (plugin, app, flags, repos, cancellable, &local_error)) {
 			g_task_return_error (task, g_steal_pointer (&local_error));
 			return;
 		}
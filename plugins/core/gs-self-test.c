@@ -65,6 +65,68 @@ gs_plugins_core_search_repo_name_func (GsPluginLoader *plugin_loader)
 	g_assert_cmpint (gs_app_get_kind (app), ==, AS_COMPONENT_KIND_DESKTOP_APP);
 }
 
+static void
+gs_plugins_core_search_tokens_check (GsPlugin    *plugin,
+                                     XbSilo      *silo,
+                                     const gchar *search,
+                                     const gchar *expected_id)
+{
+	const gchar *values[] = { search, NULL };
+	g_autoptr(GsAppList) list = gs_app_list_new ();
+	g_autoptr(GError) error = NULL;
+
+	g_assert_true (gs_appstream_search (plugin, silo, values, list, 0, NULL, &error));
+	g_assert_no_error (error);
+
+	if (expected_id == NULL) {
+		g_assert_cmpuint (gs_app_list_length (list), ==, 0);
+	} else {
+		g_assert_cmpuint (gs_app_list_length (list), ==, 1);
+		g_assert_cmpstr (gs_app_get_id (gs_app_list_index (list, 0)), ==, expected_id);
+	}
+}
+
+static void
+gs_plugins_core_search_tokens_func (GsPluginLoader *plugin_loader)
+{
+	GsPlugin *plugin = gs_plugin_loader_find_plugin (plugin_loader, "appstream");
+	g_autoptr(XbBuilder) builder = xb_builder_new ();
+	g_autoptr(XbBuilderSource) source = xb_builder_source_new ();
+	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(GError) error = NULL;
+	const gchar *xml =
+		"<?xml version=\"1.0\"?>\n"
+		"<components origin=\"tokens\" version=\"0.9\">\n"
+		"  <component type=\"desktop\">\n"
+		"    <id>org.example.Cafe</id>\n"
+		"    <name>Café Crème</name>\n"
+		"    <summary>Brew some coffee</summary>\n"
+		"  </component>\n"
+		"  <component type=\"desktop\">\n"
+		"    <id>org.example.Kafetiera</id>\n"
+		"    <name>Καφετιέρα</name>\n"
+		"    <summary>Φτιάξτε καφέ</summary>\n"
+		"  </component>\n"
+		"</components>\n";
+
+	xb_builder_source_load_xml (source, xml, XB_BUILDER_SOURCE_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	xb_builder_import_source (builder, source);
+	silo = xb_builder_compile (builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (silo);
+
+	/* words are split on the same boundaries as #GsAppQuery:keywords are
+	 * tokenised, so non-ASCII letters are part of words */
+	gs_plugins_core_search_tokens_check (plugin, silo, "coffee", "org.example.Cafe");
+	gs_plugins_core_search_tokens_check (plugin, silo, "café", "org.example.Cafe");
+	gs_plugins_core_search_tokens_check (plugin, silo, "crème", "org.example.Cafe");
+	gs_plugins_core_search_tokens_check (plugin, silo, "cafe", "org.example.Cafe");
+	gs_plugins_core_search_tokens_check (plugin, silo, "καφέ", "org.example.Kafetiera");
+	gs_plugins_core_search_tokens_check (plugin, silo, "Καφετιέρα", "org.example.Kafetiera");
+	gs_plugins_core_search_tokens_check (plugin, silo, "tea", NULL);
+}
+
 static void
 gs_plugins_core_os_release_func (GsPluginLoader *plugin_loader)
 {
@@ -262,6 +324,9 @@ main (int argc, char **argv)
 	g_test_add_data_func ("/gnome-software/plugins/core/search-repo-name",
 			      plugin_loader,
 			      (GTestDataFunc) gs_plugins_core_search_repo_name_func);
+	g_test_add_data_func ("/gnome-software/plugins/core/search-tokens",
+			      plugin_loader,
+			      (GTestDataFunc) gs_plugins_core_search_tokens_func);
 	g_test_add_data_func ("/gnome-software/plugins/core/os-release",
 			      plugin_loader,
 			      (GTestDataFunc) gs_plugins_core_os_release_func);
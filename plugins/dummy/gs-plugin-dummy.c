@@ -838,6 +838,10 @@ refine_app (GsPluginDummy        *self,
 	return TRUE;
 }
 
+static void refine_delay_cb (GObject      *source_object,
+                             GAsyncResult *result,
+                             gpointer      user_data);
+
 static void
 gs_plugin_dummy_refine_async (GsPlugin            *plugin,
                               GsAppList           *list,
@@ -849,22 +853,50 @@ gs_plugin_dummy_refine_async (GsPlugin            *plugin,
 	GsPluginDummy *self = GS_PLUGIN_DUMMY (plugin);
 	g_autoptr(GTask) task = NULL;
 	g_autoptr(GError) local_error = NULL;
+	guint delay_ms = 0;
 
 	task = g_task_new (plugin, cancellable, callback, user_data);
 	g_task_set_source_tag (task, gs_plugin_dummy_refine_async);
 
 	for (guint i = 0; i < gs_app_list_length (list); i++) {
 		GsApp *app = gs_app_list_index (list, i);
+		const gchar *delay_str;
 
 		if (!refine_app (self, app, flags, cancellable, &local_error)) {
 			g_task_return_error (task, g_steal_pointer (&local_error));
 			return;
 		}
+
+		/* let tests keep a refine in flight for a while */
+		delay_str = gs_app_get_metadata_item (app, "Dummy::RefineDelay");
+		if (delay_str != NULL)
+			delay_ms = MAX (delay_ms, g_ascii_strtoull (delay_str, NULL, 10));
+	}
+
+	if (delay_ms > 0) {
+		gs_plugin_dummy_delay_async (plugin, NULL, delay_ms, cancellable,
+					     refine_delay_cb, g_steal_pointer (&task));
+		return;
 	}
 
 	g_task_return_boolean (task, TRUE);
 }
 
+static void
+refine_delay_cb (GObject      *source_object,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+	GsPlugin *plugin = GS_PLUGIN (source_object);
+	g_autoptr(GTask) task = g_steal_pointer (&user_data);
+	g_autoptr(GError) local_error = NULL;
+
+	if (!gs_plugin_dummy_delay_finish (plugin, result, &local_error))
+		g_task_return_error (task, g_steal_pointer (&local_error));
+	else
+		g_task_return_boolean (task, TRUE);
+}
+
 static gboolean
 gs_plugin_dummy_refine_finish (GsPlugin      *plugin,
                                GAsyncResult  *result,
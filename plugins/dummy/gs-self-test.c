@@ -587,6 +587,142 @@ async_result_cb (GObject      *source_object,
 	g_main_context_wakeup (g_main_context_get_thread_default ());
 }
 
+static void
+refine_delay_status_changed_cb (GsPlugin       *plugin,
+                                GsApp          *app,
+                                GsPluginStatus  status,
+                                gpointer        user_data)
+{
+	gboolean *started = user_data;
+
+	if (status == GS_PLUGIN_STATUS_DOWNLOADING)
+		*started = TRUE;
+}
+
+static void
+gs_plugins_dummy_refine_coalesced_func (GsPluginLoader *plugin_loader)
+{
+	GsPlugin *plugin = gs_plugin_loader_find_plugin (plugin_loader, "dummy");
+	g_autoptr(GsApp) app = NULL;
+	g_autoptr(GsPluginJob) plugin_job1 = NULL;
+	g_autoptr(GsPluginJob) plugin_job2 = NULL;
+	g_autoptr(GsPluginJob) plugin_job3 = NULL;
+	g_autoptr(GCancellable) cancellable = NULL;
+	g_autoptr(GMainContext) context = NULL;
+	g_autoptr(GAsyncResult) result1 = NULL;
+	g_autoptr(GAsyncResult) result2 = NULL;
+	g_autoptr(GAsyncResult) result3 = NULL;
+	g_autoptr(GError) local_error = NULL;
+	guint64 n_coalesced = gs_metrics_get_counter ("refine-coalesced-apps");
+	gboolean started = FALSE;
+	gulong status_id;
+
+	app = gs_app_new ("chiron.desktop");
+	gs_app_set_management_plugin (app, plugin);
+
+	/* keep the dummy plugin’s refine of this app in flight, so the
+	 * later jobs are certain to find the first one still running */
+	gs_app_set_metadata (app, "Dummy::RefineDelay", "2000");
+	status_id = g_signal_connect (plugin, "status-changed",
+				      G_CALLBACK (refine_delay_status_changed_cb), &started);
+
+	context = g_main_context_new ();
+	g_main_context_push_thread_default (context);
+
+	plugin_job1 = gs_plugin_job_refine_new_for_app (app, GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENSE);
+	gs_plugin_loader_job_process_async (plugin_loader, plugin_job1, NULL,
+					    async_result_cb, &result1);
+
+	/* status updates from the delay arrive in the global default context */
+	while (!started)
+		g_main_context_iteration (NULL, TRUE);
+
+	g_signal_handler_disconnect (plugin, status_id);
+
+	/* the second job only needs to refine the URL itself, and waits for
+	 * the first to refine the license */
+	plugin_job2 = gs_plugin_job_refine_new_for_app (app,
+							GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENSE |
+							GS_PLUGIN_REFINE_FLAGS_REQUIRE_URL);
+	gs_plugin_loader_job_process_async (plugin_loader, plugin_job2, NULL,
+					    async_result_cb, &result2);
+
+	/* the third job only waits, and cancelling it must not wait for the
+	 * first job to finish */
+	cancellable = g_cancellable_new ();
+	plugin_job3 = gs_plugin_job_refine_new_for_app (app, GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENSE);
+	gs_plugin_loader_job_process_async (plugin_loader, plugin_job3, cancellable,
+					    async_result_cb, &result3);
+	g_cancellable_cancel (cancellable);
+
+	while (result3 == NULL)
+		g_main_context_iteration (context, TRUE);
+
+	g_assert_null (result1);
+	gs_plugin_loader_job_action_finish (plugin_loader, result3, &local_error);
+	g_assert_true (g_error_matches (local_error, GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_CANCELLED) ||
+		       g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED));
+	g_clear_error (&local_error);
+
+	while (result1 == NULL || result2 == NULL)
+		g_main_context_iteration (context, TRUE);
+
+	g_main_context_pop_thread_default (context);
+
+	gs_test_flush_main_context ();
+
+	gs_plugin_loader_job_action_finish (plugin_loader, result1, &local_error);
+	g_assert_no_error (local_error);
+	gs_plugin_loader_job_action_finish (plugin_loader, result2, &local_error);
+	g_assert_no_error (local_error);
+
+	g_assert_cmpuint (gs_metrics_get_counter ("refine-coalesced-apps"), >=, n_coalesced + 1);
+	g_assert_cmpstr (gs_app_get_license (app), ==, "GPL-2.0-or-later");
+	g_assert_cmpstr (gs_app_get_url (app, AS_URL_KIND_HOMEPAGE), ==, "http://www.test.org/");
+}
+
+static void
+gs_plugins_dummy_refine_satisfied_func (GsPluginLoader *plugin_loader)
+{
+	gboolean ret;
+	g_autoptr(GsApp) app = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GsPluginJob) plugin_job = NULL;
+	guint64 n_satisfied = gs_metrics_get_counter ("refine-satisfied-apps");
+
+	app = gs_app_new ("chiron.desktop");
+	gs_app_set_management_plugin (app, gs_plugin_loader_find_plugin (plugin_loader, "dummy"));
+
+	plugin_job = gs_plugin_job_refine_new_for_app (app, GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENSE);
+	ret = gs_plugin_loader_job_action (plugin_loader, plugin_job, NULL, &error);
+	gs_test_flush_main_context ();
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpuint (gs_metrics_get_counter ("refine-satisfied-apps"), ==, n_satisfied);
+	g_assert_cmpstr (gs_app_get_license (app), ==, "GPL-2.0-or-later");
+	g_assert_true (gs_app_get_refined_flags (app, G_MAXINT64) & GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENSE);
+
+	/* the license is already known, so the plugins aren’t asked again */
+	g_object_unref (plugin_job);
+	plugin_job = gs_plugin_job_refine_new_for_app (app, GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENSE);
+	ret = gs_plugin_loader_job_action (plugin_loader, plugin_job, NULL, &error);
+	gs_test_flush_main_context ();
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpuint (gs_metrics_get_counter ("refine-satisfied-apps"), ==, n_satisfied + 1);
+
+	/* but they are once the app has been invalidated */
+	gs_app_invalidate_refined_flags (app);
+	g_object_unref (plugin_job);
+	plugin_job = gs_plugin_job_refine_new_for_app (app, GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENSE);
+	ret = gs_plugin_loader_job_action (plugin_loader, plugin_job, NULL, &error);
+	gs_test_flush_main_context ();
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpuint (gs_metrics_get_counter ("refine-satisfied-apps"), ==, n_satisfied + 1);
+	g_assert_true (gs_app_get_refined_flags (app, G_MAXINT64) & GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENSE);
+}
+
 static void
 gs_plugins_dummy_limit_parallel_ops_func (GsPluginLoader *plugin_loader)
 {
@@ -924,6 +1060,12 @@ main (int argc, char **argv)
 	g_test_add_data_func ("/gnome-software/plugins/dummy/refine",
 			      plugin_loader,
 			      (GTestDataFunc) gs_plugins_dummy_refine_func);
+	g_test_add_data_func ("/gnome-software/plugins/dummy/refine-coalesced",
+			      plugin_loader,
+			      (GTestDataFunc) gs_plugins_dummy_refine_coalesced_func);
+	g_test_add_data_func ("/gnome-software/plugins/dummy/refine-satisfied",
+			      plugin_loader,
+			      (GTestDataFunc) gs_plugins_dummy_refine_satisfied_func);
 	g_test_add_data_func ("/gnome-software/plugins/dummy/updates",
 			      plugin_loader,
 			      (GTestDataFunc) gs_plugins_dummy_updates_func);
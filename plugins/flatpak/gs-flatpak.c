@@ -55,6 +55,8 @@ struct _GsFlatpak {
 	GsPlugin		*plugin;
 	XbSilo			*silo;
 	GRWLock			 silo_lock;
+	guint			 silo_generation;  /* (locked-by silo_lock), bumped on each invalidation */
+	GMutex			 silo_rebuild_mutex;  /* held while building a new silo */
 	gchar			*silo_filename;
 	GHashTable		*silo_installed_by_desktopid;
 	gchar			*id;
@@ -655,8 +657,11 @@ static void
 gs_flatpak_invalidate_silo (GsFlatpak *self)
 {
 	g_rw_lock_writer_lock (&self->silo_lock);
-	if (self->silo != NULL)
+	self->silo_generation++;
+	if (self->silo != NULL) {
 		xb_silo_invalidate (self->silo);
+		gs_appstream_drop_lazy_data (self->silo);
+	}
 	g_rw_lock_writer_unlock (&self->silo_lock);
 }
 
@@ -843,20 +848,22 @@ gs_flatpak_filter_noenumerate_cb (XbBuilderFixup *self,
 	return TRUE;
 }
 
+/* the elements which are tokenized in the silo, for searching */
+static const gchar * const elements_to_tokenize[] = {
+	"id",
+	"keyword",
+	"launchable",
+	"mimetype",
+	"name",
+	"summary",
+	NULL };
+
 static gboolean
 gs_flatpak_tokenize_cb (XbBuilderFixup *self,
 			XbBuilderNode *bn,
 			gpointer user_data,
 			GError **error)
 {
-	const gchar * const elements_to_tokenize[] = {
-		"id",
-		"keyword",
-		"launchable",
-		"mimetype",
-		"name",
-		"summary",
-		NULL };
 	if (xb_builder_node_get_element (bn) != NULL &&
 	    g_strv_contains (elements_to_tokenize, xb_builder_node_get_element (bn)))
 		xb_builder_node_tokenize_text (bn);
@@ -1085,32 +1092,27 @@ gs_flatpak_rescan_installed (GsFlatpak *self,
 		g_debug ("Failed to read flatpak .desktop files in %s: %s", path, error_local->message);
 }
 
-static gboolean
-gs_flatpak_rescan_appstream_store (GsFlatpak *self,
-				   gboolean interactive,
-				   GCancellable *cancellable,
-				   GError **error)
+/* Builds a new silo for all the remotes, along with its indexes. This does not
+ * touch @self->silo, so it can run without holding @self->silo_lock. */
+static XbSilo *
+gs_flatpak_build_appstream_silo (GsFlatpak *self,
+				 gboolean interactive,
+				 GHashTable **out_installed_by_desktopid,
+				 gchar **out_silo_filename,
+				 GCancellable *cancellable,
+				 GError **error)
 {
 	g_autofree gchar *blobfn = NULL;
 	g_autoptr(GFile) file = NULL;
 	g_autoptr(GPtrArray) xremotes = NULL;
 	g_autoptr(GPtrArray) desktop_paths = NULL;
-	g_autoptr(GRWLockReaderLocker) reader_locker = NULL;
-	g_autoptr(GRWLockWriterLocker) writer_locker = NULL;
+	g_autoptr(GPtrArray) installed = NULL;
+	g_autoptr(GHashTable) installed_by_desktopid = NULL;
 	g_autoptr(XbBuilder) builder = NULL;
+	g_autoptr(XbNode) info_filename = NULL;
+	g_autoptr(XbSilo) silo = NULL;
 	g_autoptr(GMainContext) old_thread_default = NULL;
-
-	reader_locker = g_rw_lock_reader_locker_new (&self->silo_lock);
-	/* everything is okay */
-	if (self->silo != NULL && xb_silo_is_valid (self->silo))
-		return TRUE;
-	g_clear_pointer (&reader_locker, g_rw_lock_reader_locker_free);
-
-	/* drat! silo needs regenerating */
-	writer_locker = g_rw_lock_writer_locker_new (&self->silo_lock);
-	g_clear_object (&self->silo);
-	g_clear_pointer (&self->silo_filename, g_free);
-	g_clear_pointer (&self->silo_installed_by_desktopid, g_hash_table_unref);
+	g_autoptr(GError) index_error = NULL;
 
 	/* FIXME: https://gitlab.gnome.org/GNOME/gnome-software/-/issues/1422 */
 	old_thread_default = g_main_context_ref_thread_default ();
@@ -1138,7 +1140,7 @@ gs_flatpak_rescan_appstream_store (GsFlatpak *self,
 						      error);
 	if (xremotes == NULL) {
 		gs_flatpak_error_convert (error);
-		return FALSE;
+		return NULL;
 	}
 	for (guint i = 0; i < xremotes->len; i++) {
 		g_autoptr(GError) error_local = NULL;
@@ -1152,7 +1154,7 @@ gs_flatpak_rescan_appstream_store (GsFlatpak *self,
 				 flatpak_remote_get_name (xremote), error_local->message);
 			if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
 				gs_flatpak_error_convert (error);
-				return FALSE;
+				return NULL;
 			}
 		}
 	}
@@ -1176,7 +1178,7 @@ gs_flatpak_rescan_appstream_store (GsFlatpak *self,
 					      GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
 					      error);
 	if (blobfn == NULL)
-		return FALSE;
+		return NULL;
 	file = g_file_new_for_path (blobfn);
 	g_debug ("ensuring %s", blobfn);
 
@@ -1187,39 +1189,104 @@ gs_flatpak_rescan_appstream_store (GsFlatpak *self,
 	if (old_thread_default != NULL)
 		g_main_context_pop_thread_default (old_thread_default);
 
-	self->silo = xb_builder_ensure (builder, file,
-					XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID |
-					XB_BUILDER_COMPILE_FLAG_SINGLE_LANG,
-					cancellable, error);
+	silo = xb_builder_ensure (builder, file,
+				  XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID |
+				  XB_BUILDER_COMPILE_FLAG_SINGLE_LANG,
+				  cancellable, error);
 
 	if (old_thread_default != NULL)
 		g_main_context_push_thread_default (old_thread_default);
 
-	if (self->silo != NULL) {
-		g_autoptr(GPtrArray) installed = NULL;
-		g_autoptr(XbNode) info_filename = NULL;
-
-		self->silo_installed_by_desktopid = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
-
-		installed = xb_silo_query (self->silo, "/component[@type='desktop-application']/launchable[@type='desktop-id']", 0, NULL);
-		for (guint i = 0; installed != NULL && i < installed->len; i++) {
-			XbNode *launchable = g_ptr_array_index (installed, i);
-			const gchar *id = xb_node_get_text (launchable);
-			if (id != NULL && *id != '\0') {
-				GPtrArray *nodes = g_hash_table_lookup (self->silo_installed_by_desktopid, id);
-				if (nodes == NULL) {
-					nodes = g_ptr_array_new_with_free_func (g_object_unref);
-					g_hash_table_insert (self->silo_installed_by_desktopid, g_strdup (id), nodes);
-				}
-				g_ptr_array_add (nodes, xb_node_get_parent (launchable));
+	if (silo == NULL)
+		return NULL;
+
+	/* build the search indexes now, or load them if the silo hasn’t
+	 * changed, rather than on the first search */
+	if (!gs_appstream_search_index_build (silo, file, elements_to_tokenize,
+					      cancellable, &index_error))
+		g_debug ("Failed to build search index: %s", index_error->message);
+
+	installed_by_desktopid = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
+
+	installed = xb_silo_query (silo, "/component[@type='desktop-application']/launchable[@type='desktop-id']", 0, NULL);
+	for (guint i = 0; installed != NULL && i < installed->len; i++) {
+		XbNode *launchable = g_ptr_array_index (installed, i);
+		const gchar *id = xb_node_get_text (launchable);
+		if (id != NULL && *id != '\0') {
+			GPtrArray *nodes = g_hash_table_lookup (installed_by_desktopid, id);
+			if (nodes == NULL) {
+				nodes = g_ptr_array_new_with_free_func (g_object_unref);
+				g_hash_table_insert (installed_by_desktopid, g_strdup (id), nodes);
 			}
+			g_ptr_array_add (nodes, xb_node_get_parent (launchable));
 		}
+	}
+
+	info_filename = xb_silo_query_first (silo, "/info/filename", NULL);
+	*out_silo_filename = (info_filename != NULL) ? g_strdup (xb_node_get_text (info_filename)) : NULL;
+	*out_installed_by_desktopid = g_steal_pointer (&installed_by_desktopid);
+
+	return g_steal_pointer (&silo);
+}
+
+static gboolean
+gs_flatpak_rescan_appstream_store (GsFlatpak *self,
+				   gboolean interactive,
+				   GCancellable *cancellable,
+				   GError **error)
+{
+	g_autofree gchar *silo_filename = NULL;
+	g_autoptr(GHashTable) installed_by_desktopid = NULL;
+	g_autoptr(GMutexLocker) rebuild_locker = NULL;
+	g_autoptr(GRWLockReaderLocker) reader_locker = NULL;
+	g_autoptr(GRWLockWriterLocker) writer_locker = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+	guint generation;
+
+	reader_locker = g_rw_lock_reader_locker_new (&self->silo_lock);
+	/* everything is okay */
+	if (self->silo != NULL && xb_silo_is_valid (self->silo))
+		return TRUE;
+	g_clear_pointer (&reader_locker, g_rw_lock_reader_locker_free);
+
+	/* drat! silo needs regenerating; only one thread does that at a time,
+	 * and the others pick up its result */
+	rebuild_locker = g_mutex_locker_new (&self->silo_rebuild_mutex);
+	reader_locker = g_rw_lock_reader_locker_new (&self->silo_lock);
+	if (self->silo != NULL && xb_silo_is_valid (self->silo))
+		return TRUE;
+	generation = self->silo_generation;
+	g_clear_pointer (&reader_locker, g_rw_lock_reader_locker_free);
+
+	/* compile without holding @silo_lock, so readers and
+	 * gs_flatpak_invalidate_silo() are not blocked meanwhile */
+	silo = gs_flatpak_build_appstream_silo (self, interactive,
+						&installed_by_desktopid,
+						&silo_filename,
+						cancellable, error);
+
+	/* only hold the writer lock to swap the new silo in */
+	writer_locker = g_rw_lock_writer_locker_new (&self->silo_lock);
 
-		info_filename = xb_silo_query_first (self->silo, "/info/filename", NULL);
-		if (info_filename != NULL)
-			self->silo_filename = g_strdup (xb_node_get_text (info_filename));
+	/* an invalidation which arrived during the build may not be reflected
+	 * in the new silo, so mark it as invalid straight away, as it would
+	 * have been had the invalidation waited for the build to finish; the
+	 * next caller then rebuilds it */
+	if (silo != NULL && generation != self->silo_generation) {
+		g_debug ("flatpak silo invalidated while it was being built");
+		xb_silo_invalidate (silo);
 	}
 
+	/* apps may have been refined from the old silo since it was
+	 * invalidated, while this one was being built */
+	if (self->silo != NULL && self->silo != silo)
+		gs_appstream_drop_lazy_data (self->silo);
+	g_set_object (&self->silo, silo);
+	g_clear_pointer (&self->silo_filename, g_free);
+	self->silo_filename = g_steal_pointer (&silo_filename);
+	g_clear_pointer (&self->silo_installed_by_desktopid, g_hash_table_unref);
+	self->silo_installed_by_desktopid = g_steal_pointer (&installed_by_desktopid);
+
 	/* success */
 	return self->silo != NULL;
 }
@@ -4291,6 +4358,7 @@ gboolean
 gs_flatpak_search (GsFlatpak *self,
 		   const gchar * const *values,
 		   GsAppList *list,
+		   guint max_results,
 		   gboolean interactive,
 		   GCancellable *cancellable,
 		   GError **error)
@@ -4306,7 +4374,7 @@ gs_flatpak_search (GsFlatpak *self,
 		return FALSE;
 
 	if (!gs_appstream_search (self->plugin, self->silo, values, list_tmp,
-				  cancellable, error))
+				  max_results, cancellable, error))
 		return FALSE;
 
 	gs_flatpak_ensure_remote_title (self, interactive, cancellable);
@@ -4345,7 +4413,7 @@ gs_flatpak_search (GsFlatpak *self,
 		}
 
 		if (!gs_appstream_search (self->plugin, app_silo, values, app_list_tmp,
-					  cancellable, error))
+					  max_results, cancellable, error))
 			return FALSE;
 
 		gs_flatpak_claim_app_list (self, app_list_tmp, interactive);
@@ -4553,6 +4621,7 @@ gboolean
 gs_flatpak_add_recent (GsFlatpak *self,
 		       GsAppList *list,
 		       guint64 age,
+		       guint max_results,
 		       gboolean interactive,
 		       GCancellable *cancellable,
 		       GError **error)
@@ -4564,7 +4633,7 @@ gs_flatpak_add_recent (GsFlatpak *self,
 		return FALSE;
 
 	if (!gs_appstream_add_recent (self->plugin, self->silo, list_tmp, age,
-				      cancellable, error))
+				      max_results, cancellable, error))
 		return FALSE;
 
 	gs_flatpak_claim_app_list (self, list_tmp, interactive);
@@ -4655,6 +4724,7 @@ gs_flatpak_finalize (GObject *object)
 	g_hash_table_unref (self->broken_remotes);
 	g_mutex_clear (&self->broken_remotes_mutex);
 	g_rw_lock_clear (&self->silo_lock);
+	g_mutex_clear (&self->silo_rebuild_mutex);
 	g_hash_table_unref (self->app_silos);
 	g_mutex_clear (&self->app_silos_mutex);
 	g_clear_pointer (&self->remote_title, g_hash_table_unref);
@@ -4676,6 +4746,7 @@ gs_flatpak_init (GsFlatpak *self)
 	/* XbSilo needs external locking as we destroy the silo and build a new
 	 * one when something changes */
 	g_rw_lock_init (&self->silo_lock);
+	g_mutex_init (&self->silo_rebuild_mutex);
 
 	g_mutex_init (&self->installed_refs_mutex);
 	self->installed_refs = NULL;
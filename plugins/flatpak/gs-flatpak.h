@@ -126,6 +126,7 @@ GsApp		*gs_flatpak_find_source_by_url	(GsFlatpak		*self,
 gboolean	gs_flatpak_search		(GsFlatpak		*self,
 						 const gchar * const	*values,
 						 GsAppList		*list,
+						 guint			 max_results,
 						 gboolean		 interactive,
 						 GCancellable		*cancellable,
 						 GError			**error);
@@ -172,6 +173,7 @@ gboolean	gs_flatpak_add_alternates	(GsFlatpak		*self,
 gboolean	gs_flatpak_add_recent		(GsFlatpak		*self,
 						 GsAppList		*list,
 						 guint64		 age,
+						 guint			 max_results,
 						 gboolean		 interactive,
 						 GCancellable		*cancellable,
 						 GError			**error);
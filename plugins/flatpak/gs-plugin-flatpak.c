@@ -2438,6 +2438,8 @@ list_apps_thread_cb (GTask        *task,
 	GsApp *alternate_of = NULL;
 	const gchar *provides_tag = NULL;
 	GsAppQueryProvidesType provides_type = GS_APP_QUERY_PROVIDES_UNKNOWN;
+	guint max_recent = 0;
+	guint max_matches = 0;
 	g_autoptr(GError) local_error = NULL;
 
 	assert_in_worker (self);
@@ -2455,6 +2457,11 @@ list_apps_thread_cb (GTask        *task,
 		provides_type = gs_app_query_get_provides (data->query, &provides_tag);
 		is_for_update = gs_app_query_get_is_for_update (data->query);
 		is_source = gs_app_query_get_is_source (data->query);
+
+		/* only the top results are needed, if the query is sorted
+		 * in the order they are listed in */
+		max_recent = gs_app_query_get_max_candidates (data->query, gs_utils_app_sort_release_date);
+		max_matches = gs_app_query_get_max_candidates (data->query, gs_utils_app_sort_match_value);
 	}
 
 	if (released_since != NULL) {
@@ -2511,7 +2518,7 @@ list_apps_thread_cb (GTask        *task,
 		const gchar * const provides_tag_strv[2] = { provides_tag, NULL };
 
 		if (released_since != NULL &&
-		    !gs_flatpak_add_recent (flatpak, list, age_secs, interactive, cancellable, &local_error)) {
+		    !gs_flatpak_add_recent (flatpak, list, age_secs, max_recent, interactive, cancellable, &local_error)) {
 			g_task_return_error (task, g_steal_pointer (&local_error));
 			return;
 		}
@@ -2553,7 +2560,7 @@ list_apps_thread_cb (GTask        *task,
 		}
 
 		if (keywords != NULL &&
-		    !gs_flatpak_search (flatpak, keywords, list, interactive, cancellable, &local_error)) {
+		    !gs_flatpak_search (flatpak, keywords, list, max_matches, interactive, cancellable, &local_error)) {
 			g_task_return_error (task, g_steal_pointer (&local_error));
 			return;
 		}
@@ -2569,7 +2576,7 @@ list_apps_thread_cb (GTask        *task,
 		 * future. */
 		if (provides_tag != NULL &&
 		    provides_type != GS_APP_QUERY_PROVIDES_UNKNOWN &&
-		    !gs_flatpak_search (flatpak, provides_tag_strv, list, interactive, cancellable, &local_error)) {
+		    !gs_flatpak_search (flatpak, provides_tag_strv, list, 0, interactive, cancellable, &local_error)) {
 			g_task_return_error (task, g_steal_pointer (&local_error));
 			return;
 		}
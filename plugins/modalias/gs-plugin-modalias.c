@@ -8,11 +8,12 @@
 
 #include <config.h>
 
-#include <fnmatch.h>
+#include <string.h>
 #include <gudev/gudev.h>
 
 #include <gnome-software.h>
 
+#include "gs-glob-set.h"
 #include "gs-plugin-modalias.h"
 
 struct _GsPluginModalias {
@@ -20,6 +21,9 @@ struct _GsPluginModalias {
 
 	GUdevClient		*client;
 	GPtrArray		*devices;
+
+	GMutex			 glob_sets_mutex;
+	GHashTable		*glob_sets;	/* (owned) (mutex glob_sets_mutex) (element-type utf8 GsGlobSet) keyed by the newline-separated modaliases */
 };
 
 G_DEFINE_TYPE (GsPluginModalias, gs_plugin_modalias, GS_TYPE_PLUGIN)
@@ -50,6 +54,9 @@ gs_plugin_modalias_init (GsPluginModalias *self)
 	gs_plugin_add_rule (plugin, GS_PLUGIN_RULE_RUN_BEFORE, "icons");
 
 	self->devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_mutex_init (&self->glob_sets_mutex);
+	self->glob_sets = g_hash_table_new_full (g_str_hash, g_str_equal,
+						 g_free, (GDestroyNotify) gs_glob_set_unref);
 	self->client = g_udev_client_new (NULL);
 	g_signal_connect (self->client, "uevent",
 			  G_CALLBACK (gs_plugin_modalias_uevent_cb), self);
@@ -62,10 +69,21 @@ gs_plugin_modalias_dispose (GObject *object)
 
 	g_clear_object (&self->client);
 	g_clear_pointer (&self->devices, g_ptr_array_unref);
+	g_clear_pointer (&self->glob_sets, g_hash_table_unref);
 
 	G_OBJECT_CLASS (gs_plugin_modalias_parent_class)->dispose (object);
 }
 
+static void
+gs_plugin_modalias_finalize (GObject *object)
+{
+	GsPluginModalias *self = GS_PLUGIN_MODALIAS (object);
+
+	g_mutex_clear (&self->glob_sets_mutex);
+
+	G_OBJECT_CLASS (gs_plugin_modalias_parent_class)->finalize (object);
+}
+
 static void
 gs_plugin_modalias_ensure_devices (GsPluginModalias *self)
 {
@@ -90,7 +108,7 @@ gs_plugin_modalias_ensure_devices (GsPluginModalias *self)
 
 static gboolean
 gs_plugin_modalias_matches (GsPluginModalias *self,
-                            const gchar      *modalias)
+                            GsGlobSet        *modaliases)
 {
 	gs_plugin_modalias_ensure_devices (self);
 	for (guint i = 0; i < self->devices->len; i++) {
@@ -101,14 +119,59 @@ gs_plugin_modalias_matches (GsPluginModalias *self,
 		modalias_tmp = g_udev_device_get_sysfs_attr (device, "modalias");
 		if (modalias_tmp == NULL)
 			continue;
-		if (fnmatch (modalias, modalias_tmp, 0) == 0) {
-			g_debug ("matched %s against %s", modalias_tmp, modalias);
+		if (gs_glob_set_matches (modaliases, modalias_tmp)) {
+			g_debug ("matched %s", modalias_tmp);
 			return TRUE;
 		}
 	}
 	return FALSE;
 }
 
+/* Returns (transfer full) (nullable) the set of the modaliases provided by
+ * @app, or %NULL if it has none. Drivers can list hundreds of modaliases,
+ * so each distinct list is only compiled once, and shared by every app
+ * which provides it (and every refine of that app). */
+static GsGlobSet *
+gs_plugin_modalias_dup_glob_set (GsPluginModalias *self,
+				 GsApp            *app)
+{
+	GPtrArray *provided = gs_app_get_provided (app);
+	g_autoptr(GString) key = g_string_new (NULL);
+	g_autoptr(GsGlobSet) modaliases = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+	GsGlobSet *cached;
+
+	for (guint i = 0 ; i < provided->len; i++) {
+		GPtrArray *items;
+		AsProvided *prov = g_ptr_array_index (provided, i);
+		if (as_provided_get_kind (prov) != AS_PROVIDED_KIND_MODALIAS)
+			continue;
+		items = as_provided_get_items (prov);
+		for (guint j = 0; j < items->len; j++) {
+			g_string_append (key, (const gchar *) g_ptr_array_index (items, j));
+			g_string_append_c (key, '\n');
+		}
+	}
+	if (key->len == 0)
+		return NULL;
+
+	locker = g_mutex_locker_new (&self->glob_sets_mutex);
+	cached = g_hash_table_lookup (self->glob_sets, key->str);
+	if (cached != NULL)
+		return gs_glob_set_ref (cached);
+
+	modaliases = gs_glob_set_new ();
+	for (const gchar *start = key->str, *end; (end = strchr (start, '\n')) != NULL; start = end + 1) {
+		g_autofree gchar *pattern = g_strndup (start, end - start);
+		gs_glob_set_add (modaliases, pattern, 1);
+	}
+	g_hash_table_insert (self->glob_sets,
+			     g_string_free (g_steal_pointer (&key), FALSE),
+			     gs_glob_set_ref (modaliases));
+
+	return g_steal_pointer (&modaliases);
+}
+
 static gboolean
 refine_app (GsPluginModalias     *self,
 	    GsApp                *app,
@@ -116,8 +179,7 @@ refine_app (GsPluginModalias     *self,
 	    GCancellable         *cancellable,
 	    GError              **error)
 {
-	GPtrArray *provided;
-	guint i;
+	g_autoptr(GsGlobSet) modaliases = NULL;
 
 	/* not required */
 	if (gs_app_has_icons (app))
@@ -125,23 +187,17 @@ refine_app (GsPluginModalias     *self,
 	if (gs_app_get_kind (app) != AS_COMPONENT_KIND_DRIVER)
 		return TRUE;
 
+	/* match each device against all the modaliases at once */
+	modaliases = gs_plugin_modalias_dup_glob_set (self, app);
+	if (modaliases == NULL)
+		return TRUE;
+
 	/* do any of the modaliases match any installed hardware */
-	provided = gs_app_get_provided (app);
-	for (i = 0 ; i < provided->len; i++) {
-		GPtrArray *items;
-		AsProvided *prov = g_ptr_array_index (provided, i);
-		if (as_provided_get_kind (prov) != AS_PROVIDED_KIND_MODALIAS)
-			continue;
-		items = as_provided_get_items (prov);
-		for (guint j = 0; j < items->len; j++) {
-			if (gs_plugin_modalias_matches (self, (const gchar*) g_ptr_array_index (items, j))) {
-				g_autoptr(GIcon) ic = NULL;
-				ic = g_themed_icon_new ("emblem-system-symbolic");
-				gs_app_add_icon (app, ic);
-				gs_app_add_quirk (app, GS_APP_QUIRK_NOT_LAUNCHABLE);
-				break;
-			}
-		}
+	if (gs_plugin_modalias_matches (self, modaliases)) {
+		g_autoptr(GIcon) ic = NULL;
+		ic = g_themed_icon_new ("emblem-system-symbolic");
+		gs_app_add_icon (app, ic);
+		gs_app_add_quirk (app, GS_APP_QUIRK_NOT_LAUNCHABLE);
 	}
 	return TRUE;
 }
@@ -187,6 +243,7 @@ gs_plugin_modalias_class_init (GsPluginModaliasClass *klass)
 	GsPluginClass *plugin_class = GS_PLUGIN_CLASS (klass);
 
 	object_class->dispose = gs_plugin_modalias_dispose;
+	object_class->finalize = gs_plugin_modalias_finalize;
 
 	plugin_class->refine_async = gs_plugin_modalias_refine_async;
 	plugin_class->refine_finish = gs_plugin_modalias_refine_finish;
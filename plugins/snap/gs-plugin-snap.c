@@ -626,6 +626,9 @@ category_build_full_path (GsCategory *category)
 }
 
 typedef struct {
+	/* Input data. */
+	guint max_apps_per_section;  /* 0 for no limit */
+
 	/* In-progress data. */
 	guint n_pending_ops;
 	GError *saved_error;  /* (owned) (nullable) */
@@ -784,6 +787,10 @@ gs_plugin_snap_list_apps_async (GsPlugin              *plugin,
 		return;
 	}
 
+	/* If only a few results in random order are wanted, only a random
+	 * selection of the snaps in each section needs converting to apps. */
+	data->max_apps_per_section = gs_app_query_get_max_candidates (query, NULL);
+
 	/* Work out which sections we’re querying for. */
 	if (is_curated != GS_APP_QUERY_TRISTATE_UNSET) {
 		sections = curated_sections;
@@ -952,9 +959,24 @@ list_apps_cb (GObject      *source_object,
 	snaps = snapd_client_find_section_finish (client, result, NULL, &local_error);
 
 	if (snaps != NULL) {
+		guint n_apps = snaps->len;
+
 		store_snap_cache_update (self, snaps, FALSE);
 
-		for (guint i = 0; i < snaps->len; i++) {
+		/* Move a random selection of the snaps to the front, so only
+		 * those are converted to apps. */
+		if (data->max_apps_per_section > 0 && n_apps > data->max_apps_per_section) {
+			n_apps = data->max_apps_per_section;
+			for (guint i = 0; i < n_apps; i++) {
+				guint j = g_random_int_range (i, snaps->len);
+				gpointer tmp = snaps->pdata[i];
+
+				snaps->pdata[i] = snaps->pdata[j];
+				snaps->pdata[j] = tmp;
+			}
+		}
+
+		for (guint i = 0; i < n_apps; i++) {
 			SnapdSnap *snap = g_ptr_array_index (snaps, i);
 			g_autoptr(GsApp) app = NULL;
 
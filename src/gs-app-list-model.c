@@ -0,0 +1,285 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Software contributors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/**
+ * SECTION:gs-app-list-model
+ * @short_description: A #GListModel of apps
+ *
+ * #GsAppListModel exposes a set of #GsApps as a #GListModel, so they can be
+ * shown in a #GtkListView or #GtkGridView, which only create widgets for the
+ * visible items, and sorted and filtered with #GtkSortListModel and
+ * #GtkFilterListModel rather than on the widgets.
+ *
+ * Whenever the #GsApp:state of one of the apps changes, the model emits
+ * #GListModel::items-changed for it, so that sorters and filters which depend
+ * on the state are re-evaluated for that app, and its row is rebound.
+ *
+ * Unlike #GsAppList, this must only be used from the main thread.
+ */
+
+#include "config.h"
+
+#include "gs-app-list-model.h"
+
+struct _GsAppListModel
+{
+	GObject			 parent_instance;
+
+	GPtrArray		*apps;		/* (owned) (element-type GsApp) */
+	GHashTable		*positions;	/* (owned) (element-type GsApp guint) index of each app in @apps */
+};
+
+static void gs_app_list_model_iface_init (GListModelInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (GsAppListModel, gs_app_list_model, G_TYPE_OBJECT,
+			 G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, gs_app_list_model_iface_init))
+
+static GType
+gs_app_list_model_get_item_type (GListModel *model)
+{
+	return GS_TYPE_APP;
+}
+
+static guint
+gs_app_list_model_get_n_items (GListModel *model)
+{
+	GsAppListModel *self = GS_APP_LIST_MODEL (model);
+	return self->apps->len;
+}
+
+static gpointer
+gs_app_list_model_get_item (GListModel *model,
+			    guint       position)
+{
+	GsAppListModel *self = GS_APP_LIST_MODEL (model);
+
+	if (position >= self->apps->len)
+		return NULL;
+
+	return g_object_ref (g_ptr_array_index (self->apps, position));
+}
+
+static void
+gs_app_list_model_iface_init (GListModelInterface *iface)
+{
+	iface->get_item_type = gs_app_list_model_get_item_type;
+	iface->get_n_items = gs_app_list_model_get_n_items;
+	iface->get_item = gs_app_list_model_get_item;
+}
+
+static gboolean
+gs_app_list_model_lookup_position (GsAppListModel *self,
+				   GsApp          *app,
+				   guint          *position_out)
+{
+	gpointer value;
+
+	if (!g_hash_table_lookup_extended (self->positions, app, NULL, &value))
+		return FALSE;
+
+	*position_out = GPOINTER_TO_UINT (value);
+	return TRUE;
+}
+
+/* state changes often come in bursts for many apps at once, such as when
+ * the installed apps are refreshed, so this must not search @apps */
+static void
+gs_app_list_model_notify_state_cb (GsApp          *app,
+				   GParamSpec     *pspec,
+				   GsAppListModel *self)
+{
+	guint position;
+
+	if (gs_app_list_model_lookup_position (self, app, &position))
+		g_list_model_items_changed (G_LIST_MODEL (self), position, 1, 1);
+}
+
+static void
+gs_app_list_model_watch_app (GsAppListModel *self,
+			     GsApp          *app)
+{
+	g_hash_table_insert (self->positions, app, GUINT_TO_POINTER (self->apps->len));
+	g_ptr_array_add (self->apps, g_object_ref (app));
+	g_signal_connect_object (app, "notify::state",
+				 G_CALLBACK (gs_app_list_model_notify_state_cb),
+				 self, 0);
+}
+
+static void
+gs_app_list_model_unwatch_app (gpointer data,
+			       gpointer user_data)
+{
+	GsApp *app = GS_APP (data);
+	GsAppListModel *self = GS_APP_LIST_MODEL (user_data);
+
+	g_signal_handlers_disconnect_by_func (app, gs_app_list_model_notify_state_cb, self);
+}
+
+/**
+ * gs_app_list_model_set_list:
+ * @self: a #GsAppListModel
+ * @list: (nullable): apps to show, or %NULL to clear the model
+ *
+ * Replace the contents of the model with the apps in @list, in the same order.
+ * Later changes to @list are not reflected in the model.
+ *
+ * Since: 48
+ */
+void
+gs_app_list_model_set_list (GsAppListModel *self,
+			    GsAppList      *list)
+{
+	guint n_removed;
+	guint n_added = 0;
+
+	g_return_if_fail (GS_IS_APP_LIST_MODEL (self));
+	g_return_if_fail (list == NULL || GS_IS_APP_LIST (list));
+
+	n_removed = self->apps->len;
+	g_ptr_array_foreach (self->apps, gs_app_list_model_unwatch_app, self);
+	g_ptr_array_set_size (self->apps, 0);
+	g_hash_table_remove_all (self->positions);
+
+	for (guint i = 0; list != NULL && i < gs_app_list_length (list); i++) {
+		GsApp *app = gs_app_list_index (list, i);
+		if (g_hash_table_contains (self->positions, app))
+			continue;
+		gs_app_list_model_watch_app (self, app);
+		n_added++;
+	}
+
+	if (n_removed > 0 || n_added > 0)
+		g_list_model_items_changed (G_LIST_MODEL (self), 0, n_removed, n_added);
+}
+
+/**
+ * gs_app_list_model_add:
+ * @self: a #GsAppListModel
+ * @app: a #GsApp
+ *
+ * Append @app to the model, unless it is already in it.
+ *
+ * Returns: %TRUE if @app was added
+ *
+ * Since: 48
+ */
+gboolean
+gs_app_list_model_add (GsAppListModel *self,
+		       GsApp          *app)
+{
+	g_return_val_if_fail (GS_IS_APP_LIST_MODEL (self), FALSE);
+	g_return_val_if_fail (GS_IS_APP (app), FALSE);
+
+	if (g_hash_table_contains (self->positions, app))
+		return FALSE;
+
+	gs_app_list_model_watch_app (self, app);
+	g_list_model_items_changed (G_LIST_MODEL (self), self->apps->len - 1, 0, 1);
+
+	return TRUE;
+}
+
+/**
+ * gs_app_list_model_remove:
+ * @self: a #GsAppListModel
+ * @app: a #GsApp
+ *
+ * Remove @app from the model.
+ *
+ * Returns: %TRUE if @app was in the model
+ *
+ * Since: 48
+ */
+gboolean
+gs_app_list_model_remove (GsAppListModel *self,
+			  GsApp          *app)
+{
+	guint position;
+
+	g_return_val_if_fail (GS_IS_APP_LIST_MODEL (self), FALSE);
+	g_return_val_if_fail (GS_IS_APP (app), FALSE);
+
+	if (!gs_app_list_model_lookup_position (self, app, &position))
+		return FALSE;
+
+	g_hash_table_remove (self->positions, app);
+	gs_app_list_model_unwatch_app (app, self);
+	g_ptr_array_remove_index (self->apps, position);
+
+	/* the apps after it have moved up one */
+	for (guint i = position; i < self->apps->len; i++)
+		g_hash_table_insert (self->positions, g_ptr_array_index (self->apps, i), GUINT_TO_POINTER (i));
+
+	g_list_model_items_changed (G_LIST_MODEL (self), position, 1, 0);
+
+	return TRUE;
+}
+
+/**
+ * gs_app_list_model_contains:
+ * @self: a #GsAppListModel
+ * @app: a #GsApp
+ *
+ * Check whether @app is in the model.
+ *
+ * Returns: %TRUE if @app is in the model
+ *
+ * Since: 48
+ */
+gboolean
+gs_app_list_model_contains (GsAppListModel *self,
+			    GsApp          *app)
+{
+	g_return_val_if_fail (GS_IS_APP_LIST_MODEL (self), FALSE);
+	g_return_val_if_fail (GS_IS_APP (app), FALSE);
+
+	return g_hash_table_contains (self->positions, app);
+}
+
+static void
+gs_app_list_model_dispose (GObject *object)
+{
+	GsAppListModel *self = GS_APP_LIST_MODEL (object);
+
+	if (self->apps != NULL)
+		g_ptr_array_foreach (self->apps, gs_app_list_model_unwatch_app, self);
+	g_clear_pointer (&self->apps, g_ptr_array_unref);
+	g_clear_pointer (&self->positions, g_hash_table_unref);
+
+	G_OBJECT_CLASS (gs_app_list_model_parent_class)->dispose (object);
+}
+
+static void
+gs_app_list_model_class_init (GsAppListModelClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = gs_app_list_model_dispose;
+}
+
+static void
+gs_app_list_model_init (GsAppListModel *self)
+{
+	self->apps = g_ptr_array_new_with_free_func (g_object_unref);
+	self->positions = g_hash_table_new (NULL, NULL);
+}
+
+/**
+ * gs_app_list_model_new:
+ *
+ * Create a new, empty #GsAppListModel.
+ *
+ * Returns: (transfer full): a new #GsAppListModel
+ *
+ * Since: 48
+ */
+GsAppListModel *
+gs_app_list_model_new (void)
+{
+	return g_object_new (GS_TYPE_APP_LIST_MODEL, NULL);
+}
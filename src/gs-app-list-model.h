@@ -0,0 +1,31 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Software contributors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "gnome-software-private.h"
+
+G_BEGIN_DECLS
+
+#define GS_TYPE_APP_LIST_MODEL (gs_app_list_model_get_type ())
+
+G_DECLARE_FINAL_TYPE (GsAppListModel, gs_app_list_model, GS, APP_LIST_MODEL, GObject)
+
+GsAppListModel	*gs_app_list_model_new			(void);
+void		 gs_app_list_model_set_list		(GsAppListModel	*self,
+							 GsAppList	*list);
+gboolean	 gs_app_list_model_add			(GsAppListModel	*self,
+							 GsApp		*app);
+gboolean	 gs_app_list_model_remove		(GsAppListModel	*self,
+							 GsApp		*app);
+gboolean	 gs_app_list_model_contains		(GsAppListModel	*self,
+							 GsApp		*app);
+
+G_END_DECLS
@@ -359,16 +359,20 @@ gs_app_row_actually_refresh (GsAppRow *app_row)
 	guint64 size_installed_bytes = 0;
 	GsSizeType size_installed_type = GS_SIZE_TYPE_UNKNOWN;
 	g_autoptr(GIcon) icon = NULL;
+	g_autoptr(GsAppSnapshot) snapshot = NULL;
 
 	if (priv->app == NULL)
 		return;
 
+	/* read the most common properties without locking the app each time */
+	snapshot = gs_app_dup_snapshot (priv->app);
+
 	/* is this a missing search result from the extras page? */
-	missing_search_result = (gs_app_get_state (priv->app) == GS_APP_STATE_UNAVAILABLE &&
+	missing_search_result = (gs_app_snapshot_get_state (snapshot) == GS_APP_STATE_UNAVAILABLE &&
 	                         gs_app_get_url_missing (priv->app) != NULL);
 
 	/* do a fill bar for the current progress */
-	switch (gs_app_get_state (priv->app)) {
+	switch (gs_app_snapshot_get_state (snapshot)) {
 	case GS_APP_STATE_INSTALLING:
 	case GS_APP_STATE_DOWNLOADING:
 		gs_progress_button_set_progress (GS_PROGRESS_BUTTON (priv->button),
@@ -418,7 +422,7 @@ gs_app_row_actually_refresh (GsAppRow *app_row)
 
 	/* installed tag */
 	if (!priv->show_buttons) {
-		switch (gs_app_get_state (priv->app)) {
+		switch (gs_app_snapshot_get_state (snapshot)) {
 		case GS_APP_STATE_UPDATABLE:
 		case GS_APP_STATE_UPDATABLE_LIVE:
 		case GS_APP_STATE_INSTALLED:
@@ -434,7 +438,7 @@ gs_app_row_actually_refresh (GsAppRow *app_row)
 
 	/* name */
 	gtk_label_set_label (GTK_LABEL (priv->name_label),
-	                     gs_app_get_name (priv->app));
+	                     gs_app_snapshot_get_name (snapshot));
 
 	if (priv->show_update) {
 		const gchar *version_current = NULL;
@@ -522,7 +526,7 @@ gs_app_row_actually_refresh (GsAppRow *app_row)
 		gtk_widget_remove_css_class (priv->image, "dimmer-label");
 
 	/* pending label */
-	switch (gs_app_get_state (priv->app)) {
+	switch (gs_app_snapshot_get_state (snapshot)) {
 	case GS_APP_STATE_QUEUED_FOR_INSTALL:
 		gtk_widget_set_visible (priv->label, TRUE);
 		gtk_label_set_label (GTK_LABEL (priv->label), _("Pending"));
@@ -541,7 +545,7 @@ gs_app_row_actually_refresh (GsAppRow *app_row)
 	}
 
 	/* spinner */
-	switch (gs_app_get_state (priv->app)) {
+	switch (gs_app_snapshot_get_state (snapshot)) {
 	case GS_APP_STATE_REMOVING:
 		gtk_spinner_start (GTK_SPINNER (priv->spinner));
 		gtk_widget_set_visible (priv->spinner, TRUE);
@@ -555,7 +559,7 @@ gs_app_row_actually_refresh (GsAppRow *app_row)
 	gs_app_row_refresh_button (app_row, missing_search_result);
 
 	/* hide buttons in the update list, unless the app is live updatable */
-	switch (gs_app_get_state (priv->app)) {
+	switch (gs_app_snapshot_get_state (snapshot)) {
 	case GS_APP_STATE_UPDATABLE_LIVE:
 		gtk_widget_set_visible (priv->button_box,
 					!priv->show_update ||
@@ -572,7 +576,7 @@ gs_app_row_actually_refresh (GsAppRow *app_row)
 
 	/* show the right size */
 	if (priv->show_installed_size) {
-		size_installed_type = gs_app_get_size_installed (priv->app, &size_installed_bytes);
+		size_installed_type = gs_app_snapshot_get_size_installed (snapshot, &size_installed_bytes);
 	}
 	if (size_installed_type == GS_SIZE_TYPE_VALID && size_installed_bytes > 0) {
 		g_autofree gchar *sizestr = NULL;
@@ -592,7 +596,7 @@ gs_app_row_actually_refresh (GsAppRow *app_row)
 			g_string_append (warning, _("Requires additional permissions"));
 
 		renamed_from = gs_app_get_renamed_from (priv->app);
-		if (renamed_from && g_strcmp0 (renamed_from, gs_app_get_name (priv->app)) != 0) {
+		if (renamed_from && g_strcmp0 (renamed_from, gs_app_snapshot_get_name (snapshot)) != 0) {
 			if (warning->len > 0)
 				g_string_append (warning, "\n");
 			/* Translators: A message to indicate that an app has been renamed. The placeholder is the old human-readable name. */
@@ -784,27 +788,58 @@ gs_app_row_notify_props_changed_cb (GsApp *app,
 	gs_app_row_schedule_refresh (app_row);
 }
 
-static void
+/**
+ * gs_app_row_set_app:
+ * @app_row: a #GsAppRow
+ * @app: (nullable): the #GsApp to show, or %NULL
+ *
+ * Set the value of #GsAppRow:app. This allows the row to be reused for
+ * another app, such as when it is recycled by a #GtkListView.
+ *
+ * Since: 48
+ */
+void
 gs_app_row_set_app (GsAppRow *app_row, GsApp *app)
 {
 	GsAppRowPrivate *priv = gs_app_row_get_instance_private (app_row);
+	gboolean recycled;
 
-	priv->app = g_object_ref (app);
-
-	g_signal_connect_object (priv->app, "notify::state",
-				 G_CALLBACK (gs_app_row_notify_props_changed_cb),
-				 app_row, 0);
-	g_signal_connect_object (priv->app, "notify::rating",
-				 G_CALLBACK (gs_app_row_notify_props_changed_cb),
-				 app_row, 0);
-	g_signal_connect_object (priv->app, "notify::progress",
-				 G_CALLBACK (gs_app_row_notify_props_changed_cb),
-				 app_row, 0);
-	g_signal_connect_object (priv->app, "notify::allow-cancel",
-				 G_CALLBACK (gs_app_row_notify_props_changed_cb),
-				 app_row, 0);
+	g_return_if_fail (GS_IS_APP_ROW (app_row));
+	g_return_if_fail (app == NULL || GS_IS_APP (app));
+
+	if (priv->app == app)
+		return;
+
+	recycled = (priv->app != NULL);
+	if (priv->app != NULL)
+		g_signal_handlers_disconnect_by_func (priv->app, gs_app_row_notify_props_changed_cb, app_row);
+
+	g_set_object (&priv->app, app);
+
+	if (priv->app != NULL) {
+		g_signal_connect_object (priv->app, "notify::state",
+					 G_CALLBACK (gs_app_row_notify_props_changed_cb),
+					 app_row, 0);
+		g_signal_connect_object (priv->app, "notify::rating",
+					 G_CALLBACK (gs_app_row_notify_props_changed_cb),
+					 app_row, 0);
+		g_signal_connect_object (priv->app, "notify::progress",
+					 G_CALLBACK (gs_app_row_notify_props_changed_cb),
+					 app_row, 0);
+		g_signal_connect_object (priv->app, "notify::allow-cancel",
+					 G_CALLBACK (gs_app_row_notify_props_changed_cb),
+					 app_row, 0);
+
+		/* don’t show the previous app’s details until the idle
+		 * callback when a row is recycled while scrolling */
+		if (recycled) {
+			g_clear_handle_id (&priv->pending_refresh_id, g_source_remove);
+			gs_app_row_actually_refresh (app_row);
+		} else {
+			gs_app_row_schedule_refresh (app_row);
+		}
+	}
 
-	gs_app_row_schedule_refresh (app_row);
 	g_object_notify_by_pspec (G_OBJECT (app_row), obj_props[PROP_APP]);
 }
 
@@ -924,12 +959,14 @@ gs_app_row_class_init (GsAppRowClass *klass)
 	 *
 	 * The #GsApp to show in this row.
 	 *
+	 * This can be changed after construction so the row can be recycled.
+	 *
 	 * Since: 3.38
 	 */
 	obj_props[PROP_APP] =
 		g_param_spec_object ("app", NULL, NULL,
 				     GS_TYPE_APP,
-				     G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+				     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_EXPLICIT_NOTIFY);
 
 	/**
 	 * GsAppRow:colorful:
@@ -42,6 +42,7 @@ struct _GsApplication {
 	GsDbusHelper	*dbus_helper;
 #endif
 	GsShellSearchProvider *search_provider;  /* (nullable) (owned) */
+	guint		 metrics_registration_id;
 	GSettings       *settings;
 	GSimpleActionGroup	*action_map;
 	guint		 shell_loaded_handler_id;
@@ -157,6 +158,42 @@ gs_application_init (GsApplication *application)
 	g_application_add_main_option_entries (G_APPLICATION (application), options);
 }
 
+static const gchar metrics_introspection_xml[] =
+	"<node>"
+	"  <interface name='org.gnome.Software.Metrics'>"
+	"    <method name='GetMetrics'>"
+	"      <arg type='a{st}' name='counters' direction='out'/>"
+	"      <arg type='a{s(tttttt)}' name='latencies' direction='out'/>"
+	"    </method>"
+	"  </interface>"
+	"</node>";
+
+static void
+gs_application_metrics_method_call_cb (GDBusConnection       *connection,
+                                       const gchar           *sender,
+                                       const gchar           *object_path,
+                                       const gchar           *interface_name,
+                                       const gchar           *method_name,
+                                       GVariant              *parameters,
+                                       GDBusMethodInvocation *invocation,
+                                       gpointer               user_data)
+{
+	if (g_strcmp0 (method_name, "GetMetrics") == 0) {
+		g_dbus_method_invocation_return_value (invocation, gs_metrics_dup_variant ());
+		return;
+	}
+
+	g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD,
+					       "Unknown method %s", method_name);
+}
+
+static const GDBusInterfaceVTable metrics_vtable = {
+	gs_application_metrics_method_call_cb,
+	NULL,
+	NULL,
+	{ NULL, }
+};
+
 static gboolean
 gs_application_dbus_register (GApplication    *application,
                               GDBusConnection *connection,
@@ -164,6 +201,19 @@ gs_application_dbus_register (GApplication    *application,
                               GError         **error)
 {
 	GsApplication *app = GS_APPLICATION (application);
+	g_autoptr(GDBusNodeInfo) metrics_info = NULL;
+
+	/* export the metrics from gs-metrics.h, for `gnome-software-cmd metrics` */
+	metrics_info = g_dbus_node_info_new_for_xml (metrics_introspection_xml, error);
+	if (metrics_info == NULL)
+		return FALSE;
+	app->metrics_registration_id = g_dbus_connection_register_object (connection, object_path,
+									  metrics_info->interfaces[0],
+									  &metrics_vtable,
+									  app, NULL, error);
+	if (app->metrics_registration_id == 0)
+		return FALSE;
+
 	app->search_provider = gs_shell_search_provider_new ();
 	return gs_shell_search_provider_register (app->search_provider, connection, error);
 }
@@ -175,6 +225,11 @@ gs_application_dbus_unregister (GApplication    *application,
 {
 	GsApplication *app = GS_APPLICATION (application);
 
+	if (app->metrics_registration_id != 0) {
+		g_dbus_connection_unregister_object (connection, app->metrics_registration_id);
+		app->metrics_registration_id = 0;
+	}
+
 	if (app->search_provider != NULL)
 		gs_shell_search_provider_unregister (app->search_provider);
 }
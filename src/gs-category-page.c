@@ -37,6 +37,9 @@ struct _GsCategoryPage
 	GtkWidget	*featured_flow_box;
 	GtkWidget	*recently_updated_flow_box;
 	GtkWidget	*web_apps_flow_box;
+
+	GPtrArray	*pending_tiles;  /* (owned) (nullable) (element-type GsAppTile) other apps still to be added */
+	guint		 add_pending_tiles_id;
 };
 
 G_DEFINE_TYPE (GsCategoryPage, gs_category_page, GS_TYPE_PAGE)
@@ -47,6 +50,9 @@ G_DEFINE_TYPE (GsCategoryPage, gs_category_page, GS_TYPE_PAGE)
 #define MIN_RECENT_APPS_REQUIRED 50
 #define MIN_SECTION_APPS 3
 
+/* enough tiles to fill the window, so the rest can be added in the background */
+#define ADD_TILES_BATCH_SIZE 60
+
 #define validate_app_buckets() \
 	n_total_apps = n_carousel_apps + n_featured_apps + n_recently_updated_apps + n_web_apps + n_other_apps; \
 	print_app_bucket_stats (self, n_carousel_apps, n_featured_apps, n_recently_updated_apps, n_web_apps, n_other_apps, n_category_apps); \
@@ -281,12 +287,9 @@ choose_top_carousel_apps (LoadCategoryData *data,
 }
 
 static gint
-app_name_flowbox_sort_func (GtkFlowBoxChild *child1,
-			    GtkFlowBoxChild *child2,
-			    gpointer         user_data)
+app_name_sort_func (GsAppTile *tile1,
+		    GsAppTile *tile2)
 {
-	GsAppTile *tile1 = GS_APP_TILE (child1);
-	GsAppTile *tile2 = GS_APP_TILE (child2);
 	GsApp *app1 = gs_app_tile_get_app (tile1);
 	GsApp *app2 = gs_app_tile_get_app (tile2);
 
@@ -301,6 +304,27 @@ app_name_flowbox_sort_func (GtkFlowBoxChild *child1,
 	return gs_utils_app_sort_name (app1, app2, NULL);
 }
 
+static gint
+app_name_gptrarray_sort_func (gconstpointer tile1,
+			      gconstpointer tile2)
+{
+	GsAppTile *tile_a = (*(GsAppTile **) tile1);
+	GsAppTile *tile_b = (*(GsAppTile **) tile2);
+
+	return app_name_sort_func (tile_a, tile_b);
+}
+
+static gint
+app_name_flowbox_sort_func (GtkFlowBoxChild *child1,
+			    GtkFlowBoxChild *child2,
+			    gpointer         user_data)
+{
+	GsAppTile *tile1 = GS_APP_TILE (child1);
+	GsAppTile *tile2 = GS_APP_TILE (child2);
+
+	return app_name_sort_func (tile1, tile2);
+}
+
 static gint
 release_date_sort_func (GsAppTile *tile1,
 			GsAppTile *tile2)
@@ -393,6 +417,34 @@ gs_category_page_set_sort (GsCategoryPage *self, gboolean enable)
 				    NULL);
 }
 
+static void
+gs_category_page_cancel_pending_tiles (GsCategoryPage *self)
+{
+	g_clear_handle_id (&self->add_pending_tiles_id, g_source_remove);
+	g_clear_pointer (&self->pending_tiles, g_ptr_array_unref);
+}
+
+static gboolean
+add_pending_tiles_cb (gpointer user_data)
+{
+	GsCategoryPage *self = GS_CATEGORY_PAGE (user_data);
+	guint n_tiles = MIN (ADD_TILES_BATCH_SIZE, self->pending_tiles->len);
+
+	/* the tiles are in name order, so each goes at the end */
+	for (guint i = 0; i < n_tiles; i++)
+		gtk_flow_box_insert (GTK_FLOW_BOX (self->category_detail_box),
+				     g_ptr_array_index (self->pending_tiles, i), -1);
+	g_ptr_array_remove_range (self->pending_tiles, 0, n_tiles);
+
+	if (self->pending_tiles->len > 0)
+		return G_SOURCE_CONTINUE;
+
+	self->add_pending_tiles_id = 0;
+	g_clear_pointer (&self->pending_tiles, g_ptr_array_unref);
+
+	return G_SOURCE_REMOVE;
+}
+
 static void
 populate_flow_boxes (GsCategoryPage *self,
 		     GPtrArray *featured_app_tiles,
@@ -440,12 +492,27 @@ populate_flow_boxes (GsCategoryPage *self,
 		}
 	}
 
-	/* Populate other apps flowbox */
+	/* Populate other apps flowbox. There can be thousands of them, so
+	   only add enough to fill the window now, in name order, and add the
+	   rest in batches from the main loop, so the page is shown sooner. */
 	if (other_app_tiles) {
+		g_ptr_array_sort (other_app_tiles, app_name_gptrarray_sort_func);
+
 		for (i = 0; i < other_app_tiles->len; i++) {
 			tile = g_ptr_array_index (other_app_tiles, i);
-			gtk_flow_box_insert (GTK_FLOW_BOX (self->category_detail_box), tile, -1);
+
+			if (i < ADD_TILES_BATCH_SIZE) {
+				gtk_flow_box_insert (GTK_FLOW_BOX (self->category_detail_box), tile, -1);
+				continue;
+			}
+
+			if (self->pending_tiles == NULL)
+				self->pending_tiles = g_ptr_array_new_full (other_app_tiles->len - i, g_object_unref);
+			g_ptr_array_add (self->pending_tiles, g_object_ref_sink (tile));
 		}
+
+		if (self->pending_tiles != NULL)
+			self->add_pending_tiles_id = g_idle_add (add_pending_tiles_cb, self);
 	}
 
 	/* Re-enable sorting on all flowboxes now that they are fully
@@ -497,7 +564,8 @@ load_category_finish (LoadCategoryData *data)
 		return;
 	}
 
-	/* Remove the loading tiles. */
+	/* Remove the loading tiles, and any still to be added from last time. */
+	gs_category_page_cancel_pending_tiles (self);
 	gs_widget_remove_all (self->featured_flow_box, (GsRemoveFunc) gtk_flow_box_remove);
 	gs_widget_remove_all (self->recently_updated_flow_box, (GsRemoveFunc) gtk_flow_box_remove);
 	gs_widget_remove_all (self->web_apps_flow_box, (GsRemoveFunc) gtk_flow_box_remove);
@@ -656,6 +724,7 @@ gs_category_page_load_category (GsCategoryPage *self)
 
 	/* Add placeholders only when the content is not valid */
 	if (!self->content_valid) {
+		gs_category_page_cancel_pending_tiles (self);
 		gs_featured_carousel_set_apps (GS_FEATURED_CAROUSEL (self->top_carousel), NULL);
 		gtk_widget_set_visible (self->web_apps_flow_box, FALSE);
 		gtk_widget_set_visible (self->other_heading, FALSE);
@@ -860,6 +929,7 @@ gs_category_page_dispose (GObject *object)
 
 	g_cancellable_cancel (self->cancellable);
 	g_clear_object (&self->cancellable);
+	gs_category_page_cancel_pending_tiles (self);
 
 	g_clear_object (&self->category);
 	g_clear_object (&self->subcategory);
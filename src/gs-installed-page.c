@@ -16,6 +16,7 @@
 #include "gs-shell.h"
 #include "gs-installed-page.h"
 #include "gs-common.h"
+#include "gs-app-list-model.h"
 #include "gs-app-row.h"
 #include "gs-utils.h"
 
@@ -30,22 +31,18 @@ struct _GsInstalledPage
 	GtkSizeGroup		*sizegroup_button_image;
 	gboolean		 cache_valid;
 	gboolean		 waiting;
+	gboolean		 loaded_once;
 	GsShell			*shell;
 	GSettings		*settings;
 	guint			 pending_apps_counter;
 	gboolean		 is_narrow;
 
-	GtkWidget		*group_install_in_progress;
-	GtkWidget		*group_install_apps;
-	GtkWidget		*group_install_system_apps;
-	GtkWidget		*group_install_addons;
-	GtkWidget		*group_install_web_apps;
-
-	GtkWidget		*list_box_install_in_progress;
-	GtkWidget		*list_box_install_apps;
-	GtkWidget		*list_box_install_system_apps;
-	GtkWidget		*list_box_install_addons;
-	GtkWidget		*list_box_install_web_apps;
+	/* All the apps shown on the page, filtered, sorted and split into
+	 * sections by the models between this and list_view_installed, which
+	 * only creates rows for the visible apps. */
+	GsAppListModel		*apps_model;
+
+	GtkWidget		*list_view_installed;
 	GtkWidget		*scrolledwindow_install;
 	GtkWidget		*spinner_install;
 	GtkWidget		*stack_install;
@@ -66,21 +63,28 @@ static void gs_installed_page_pending_apps_refined_cb (GObject *source,
 						       GAsyncResult *res,
 						       gpointer user_data);
 static GsPluginRefineFlags gs_installed_page_get_refine_flags (GsInstalledPage *self);
-static void gs_installed_page_notify_state_changed_cb (GsApp *app,
-						       GParamSpec *pspec,
-						       GsInstalledPage *self);
 
+/* In the order the sections are shown in. */
 typedef enum {
 	GS_UPDATE_LIST_SECTION_INSTALLING_AND_REMOVING,
 	GS_UPDATE_LIST_SECTION_REMOVABLE_APPS,
+	GS_UPDATE_LIST_SECTION_WEB_APPS,
 	GS_UPDATE_LIST_SECTION_SYSTEM_APPS,
 	GS_UPDATE_LIST_SECTION_ADDONS,
-	GS_UPDATE_LIST_SECTION_WEB_APPS,
 	GS_UPDATE_LIST_SECTION_LAST
 } GsInstalledPageSection;
 
-/* This must mostly mirror gs_installed_page_get_app_sort_key() otherwise apps
- * will end up sorted into a section they don’t belong in. */
+static const gchar *section_titles[GS_UPDATE_LIST_SECTION_LAST] = {
+	N_("In Progress"),
+	N_("Apps"),
+	N_("Web Apps"),
+	N_("System Apps"),
+	N_("Add-ons"),
+};
+
+/* This is used as the section sorter of the list, so the apps in each section
+ * are contiguous, and gs_installed_page_get_app_sort_key() orders them within
+ * the section. */
 static GsInstalledPageSection
 gs_installed_page_get_app_section (GsApp *app)
 {
@@ -107,47 +111,6 @@ gs_installed_page_get_app_section (GsApp *app)
 	return GS_UPDATE_LIST_SECTION_ADDONS;
 }
 
-static void
-update_groups (GsInstalledPage *self)
-{
-	gtk_widget_set_visible (self->group_install_in_progress,
-				gtk_widget_get_first_child (self->list_box_install_in_progress) != NULL);
-	gtk_widget_set_visible (self->group_install_apps,
-				gtk_widget_get_first_child (self->list_box_install_apps) != NULL);
-	gtk_widget_set_visible (self->group_install_system_apps,
-				gtk_widget_get_first_child (self->list_box_install_system_apps) != NULL);
-	gtk_widget_set_visible (self->group_install_addons,
-				gtk_widget_get_first_child (self->list_box_install_addons) != NULL);
-	gtk_widget_set_visible (self->group_install_web_apps,
-				gtk_widget_get_first_child (self->list_box_install_web_apps) != NULL);
-}
-
-static GsInstalledPageSection
-gs_installed_page_get_row_section (GsInstalledPage *self,
-				   GsAppRow *app_row)
-{
-	GtkWidget *parent;
-
-	g_return_val_if_fail (GS_IS_INSTALLED_PAGE (self), GS_UPDATE_LIST_SECTION_LAST);
-	g_return_val_if_fail (GS_IS_APP_ROW (app_row), GS_UPDATE_LIST_SECTION_LAST);
-
-	parent = gtk_widget_get_parent (GTK_WIDGET (app_row));
-	if (parent == self->list_box_install_in_progress)
-		return GS_UPDATE_LIST_SECTION_INSTALLING_AND_REMOVING;
-	if (parent == self->list_box_install_apps)
-		return GS_UPDATE_LIST_SECTION_REMOVABLE_APPS;
-	if (parent == self->list_box_install_system_apps)
-		return GS_UPDATE_LIST_SECTION_SYSTEM_APPS;
-	if (parent == self->list_box_install_addons)
-		return GS_UPDATE_LIST_SECTION_ADDONS;
-	if (parent == self->list_box_install_web_apps)
-		return GS_UPDATE_LIST_SECTION_WEB_APPS;
-
-	g_warn_if_reached ();
-
-	return GS_UPDATE_LIST_SECTION_LAST;
-}
-
 static void
 gs_installed_page_invalidate (GsInstalledPage *self)
 {
@@ -155,78 +118,23 @@ gs_installed_page_invalidate (GsInstalledPage *self)
 }
 
 static void
-gs_installed_page_app_row_activated_cb (GtkListBox *list_box,
-                                        GtkListBoxRow *row,
-                                        GsInstalledPage *self)
+gs_installed_page_list_view_activate_cb (GtkListView     *list_view,
+                                         guint            position,
+                                         GsInstalledPage *self)
 {
-	GsApp *app;
-	app = gs_app_row_get_app (GS_APP_ROW (row));
-	gs_shell_show_app (self->shell, app);
-}
+	GtkSelectionModel *model = gtk_list_view_get_model (list_view);
+	g_autoptr(GsApp) app = g_list_model_get_item (G_LIST_MODEL (model), position);
 
-static void
-row_unrevealed (GObject *row, GParamSpec *pspec, gpointer data)
-{
-	GsInstalledPage *self = GS_INSTALLED_PAGE (gtk_widget_get_ancestor (GTK_WIDGET (row),
-									    GS_TYPE_INSTALLED_PAGE));
-	GtkWidget *list;
-
-	list = gtk_widget_get_parent (GTK_WIDGET (row));
-	if (list == NULL)
-		return;
-	gtk_list_box_remove (GTK_LIST_BOX (list), GTK_WIDGET (row));
-	update_groups (self);
+	/* apps from the results cache can’t be shown until they’re loaded */
+	if (app != NULL && !gs_results_cache_is_cached_app (app))
+		gs_shell_show_app (self->shell, app);
 }
 
-static void
-gs_installed_page_unreveal_row (GsAppRow *app_row)
-{
-	GsApp *app = gs_app_row_get_app (app_row);
-	if (app != NULL) {
-		g_signal_handlers_disconnect_matched (app, G_SIGNAL_MATCH_FUNC, 0, 0, NULL,
-						      G_CALLBACK (gs_installed_page_notify_state_changed_cb), NULL);
-	}
-
-	g_signal_connect (app_row, "unrevealed",
-			  G_CALLBACK (row_unrevealed), NULL);
-	gs_app_row_unreveal (app_row);
-}
-
-static GsAppRow *  /* (transfer none) */
-gs_installed_page_find_app_row (GsInstalledPage *self,
-				GsApp *app)
-{
-	GtkWidget *lists[] = {
-		self->list_box_install_in_progress,
-		self->list_box_install_apps,
-		self->list_box_install_system_apps,
-		self->list_box_install_addons,
-		self->list_box_install_web_apps,
-		NULL
-	};
-
-	for (gsize i = 0; lists[i]; i++) {
-		for (GtkWidget *child = gtk_widget_get_first_child (lists[i]);
-		     child != NULL;
-		     child = gtk_widget_get_next_sibling (child)) {
-			GsAppRow *app_row = GS_APP_ROW (child);
-			if (gs_app_row_get_app (app_row) == app) {
-				return app_row;
-			}
-		}
-	}
-
-	return NULL;
-}
-
-
 static void
 gs_installed_page_app_removed (GsPage *page, GsApp *app)
 {
 	GsInstalledPage *self = GS_INSTALLED_PAGE (page);
-	GsAppRow *app_row = gs_installed_page_find_app_row (self, app);
-	if (app_row != NULL)
-		gs_installed_page_unreveal_row (app_row);
+	gs_app_list_model_remove (self->apps_model, app);
 }
 
 static void
@@ -236,78 +144,28 @@ gs_installed_page_app_remove_cb (GsAppRow *app_row,
 	GsApp *app;
 
 	app = gs_app_row_get_app (app_row);
+	if (gs_results_cache_is_cached_app (app))
+		return;
 	gs_page_remove_app (GS_PAGE (self), app, self->cancellable);
 }
 
-static void
-gs_installed_page_maybe_move_app_row (GsInstalledPage *self,
-				      GsAppRow *app_row)
-{
-	GsInstalledPageSection current_section, expected_section;
-
-	current_section = gs_installed_page_get_row_section (self, app_row);
-	g_return_if_fail (current_section != GS_UPDATE_LIST_SECTION_LAST);
-
-	expected_section = gs_installed_page_get_app_section (gs_app_row_get_app (app_row));
-	if (expected_section != current_section) {
-		GtkWidget *widget = GTK_WIDGET (app_row);
-
-		g_object_ref (app_row);
-		gtk_list_box_remove (GTK_LIST_BOX (gtk_widget_get_parent (widget)), widget);
-		switch (expected_section) {
-		case GS_UPDATE_LIST_SECTION_INSTALLING_AND_REMOVING:
-			widget = self->list_box_install_in_progress;
-			break;
-		case GS_UPDATE_LIST_SECTION_REMOVABLE_APPS:
-			widget = self->list_box_install_apps;
-			break;
-		case GS_UPDATE_LIST_SECTION_SYSTEM_APPS:
-			widget = self->list_box_install_system_apps;
-			break;
-		case GS_UPDATE_LIST_SECTION_ADDONS:
-			widget = self->list_box_install_addons;
-			break;
-		case GS_UPDATE_LIST_SECTION_WEB_APPS:
-			widget = self->list_box_install_web_apps;
-			break;
-		default:
-			g_warn_if_reached ();
-			widget = NULL;
-			break;
-		}
-
-		if (widget != NULL)
-			gtk_list_box_append (GTK_LIST_BOX (widget), GTK_WIDGET (app_row));
-
-		g_object_unref (app_row);
-		update_groups (self);
-	}
-}
-
-static void
-gs_installed_page_notify_state_changed_cb (GsApp *app,
-                                           GParamSpec *pspec,
-                                           GsInstalledPage *self)
+/* Filter which apps can be shown in the installed page. Apps queued for
+ * install are added from the pending apps, and are shown too. */
+static gboolean
+gs_installed_page_filter_cb (gpointer item,
+                             gpointer user_data)
 {
-	GsAppState state = gs_app_get_state (app);
-	GsAppRow *app_row = gs_installed_page_find_app_row (self, app);
-
-	g_assert (app_row != NULL);
-
-	gtk_list_box_row_changed (GTK_LIST_BOX_ROW (app_row));
-
-	/* Filter which apps can be shown in the installed page */
-	if (state != GS_APP_STATE_INSTALLING &&
-	    state != GS_APP_STATE_INSTALLED &&
-	    state != GS_APP_STATE_REMOVING &&
-	    state != GS_APP_STATE_DOWNLOADING &&
-	    state != GS_APP_STATE_UPDATABLE &&
-	    state != GS_APP_STATE_UPDATABLE_LIVE &&
-	    state != GS_APP_STATE_PENDING_INSTALL &&
-	    state != GS_APP_STATE_PENDING_REMOVE)
-		gs_installed_page_unreveal_row (app_row);
-	else
-		gs_installed_page_maybe_move_app_row (self, app_row);
+	GsAppState state = gs_app_get_state (GS_APP (item));
+
+	return (state == GS_APP_STATE_INSTALLING ||
+		state == GS_APP_STATE_INSTALLED ||
+		state == GS_APP_STATE_REMOVING ||
+		state == GS_APP_STATE_DOWNLOADING ||
+		state == GS_APP_STATE_UPDATABLE ||
+		state == GS_APP_STATE_UPDATABLE_LIVE ||
+		state == GS_APP_STATE_PENDING_INSTALL ||
+		state == GS_APP_STATE_PENDING_REMOVE ||
+		state == GS_APP_STATE_QUEUED_FOR_INSTALL);
 }
 
 static gboolean
@@ -336,57 +194,13 @@ gs_installed_page_is_actual_app (GsApp *app)
 }
 
 static void
-gs_installed_page_add_app (GsInstalledPage *self, GsAppList *list, GsApp *app)
+gs_installed_page_add_app (GsInstalledPage *self, GsApp *app)
 {
-	GtkWidget *app_row;
-
 	/* only show if is an actual app */
 	if (!gs_installed_page_is_actual_app (app))
 		return;
 
-	app_row = g_object_new (GS_TYPE_APP_ROW,
-				"app", app,
-				"show-buttons", TRUE,
-				"show-source", gs_utils_list_has_component_fuzzy (list, app),
-				"show-installed-size", !gs_app_has_quirk (app, GS_APP_QUIRK_COMPULSORY) && should_show_installed_size (self),
-				NULL);
-
-	g_signal_connect (app_row, "button-clicked",
-			  G_CALLBACK (gs_installed_page_app_remove_cb), self);
-	g_signal_connect_object (app, "notify::state",
-				 G_CALLBACK (gs_installed_page_notify_state_changed_cb),
-				 self, 0);
-
-	switch (gs_installed_page_get_app_section (app)) {
-	case GS_UPDATE_LIST_SECTION_INSTALLING_AND_REMOVING:
-		gtk_list_box_append (GTK_LIST_BOX (self->list_box_install_in_progress), app_row);
-		break;
-	case GS_UPDATE_LIST_SECTION_REMOVABLE_APPS:
-		gtk_list_box_append (GTK_LIST_BOX (self->list_box_install_apps), app_row);
-		break;
-	case GS_UPDATE_LIST_SECTION_SYSTEM_APPS:
-		gtk_list_box_append (GTK_LIST_BOX (self->list_box_install_system_apps), app_row);
-		break;
-	case GS_UPDATE_LIST_SECTION_ADDONS:
-		gtk_list_box_append (GTK_LIST_BOX (self->list_box_install_addons), app_row);
-		break;
-	case GS_UPDATE_LIST_SECTION_WEB_APPS:
-		gtk_list_box_append (GTK_LIST_BOX (self->list_box_install_web_apps), app_row);
-		break;
-	default:
-		g_assert_not_reached ();
-	}
-
-	update_groups (self);
-
-	gs_app_row_set_size_groups (GS_APP_ROW (app_row),
-				    self->sizegroup_name,
-				    self->sizegroup_button_label,
-				    self->sizegroup_button_image);
-
-	gs_app_row_set_show_description (GS_APP_ROW (app_row), FALSE);
-	gs_app_row_set_show_source (GS_APP_ROW (app_row), FALSE);
-	g_object_bind_property (self, "is-narrow", app_row, "is-narrow", G_BINDING_SYNC_CREATE);
+	gs_app_list_model_add (self->apps_model, app);
 }
 
 static void
@@ -394,12 +208,11 @@ gs_installed_page_get_installed_cb (GObject *source_object,
                                     GAsyncResult *res,
                                     gpointer user_data)
 {
-	guint i;
-	GsApp *app;
 	GsInstalledPage *self = GS_INSTALLED_PAGE (user_data);
 	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (source_object);
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GsAppList) list = NULL;
+	g_autoptr(GsAppList) actual_apps = NULL;
 	g_autoptr(GsAppList) pending = gs_plugin_loader_get_pending (plugin_loader);
 	g_autoptr(GsPluginJob) plugin_job = NULL;
 
@@ -416,12 +229,21 @@ gs_installed_page_get_installed_cb (GObject *source_object,
 		if (!g_error_matches (error, GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_CANCELLED) &&
 		    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
 			g_warning ("failed to get installed apps: %s", error->message);
+		gs_app_list_model_set_list (self->apps_model, NULL);
 		goto out;
 	}
-	for (i = 0; i < gs_app_list_length (list); i++) {
-		app = gs_app_list_index (list, i);
-		gs_installed_page_add_app (self, list, app);
+
+	/* add all the apps at once, so they are only sorted once */
+	actual_apps = gs_app_list_new ();
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		GsApp *app = gs_app_list_index (list, i);
+		if (gs_installed_page_is_actual_app (app))
+			gs_app_list_add (actual_apps, app);
 	}
+	gs_app_list_model_set_list (self->apps_model, actual_apps);
+
+	/* show these straight away next time the page is loaded */
+	gs_results_cache_save ("installed", actual_apps);
 out:
 	if (gs_app_list_length (pending) > 0) {
 		plugin_job = gs_plugin_job_refine_new (pending,
@@ -434,23 +256,6 @@ out:
 	}
 }
 
-static void
-gs_installed_page_remove_all_cb (GtkWidget *container,
-				 GtkWidget *child)
-{
-	if (GS_IS_APP_ROW (child)) {
-		GsApp *app = gs_app_row_get_app (GS_APP_ROW (child));
-		if (app != NULL) {
-			g_signal_handlers_disconnect_matched (app, G_SIGNAL_MATCH_FUNC, 0, 0, NULL,
-							      G_CALLBACK (gs_installed_page_notify_state_changed_cb), NULL);
-		}
-	} else {
-		g_warn_if_reached ();
-	}
-
-	gtk_list_box_remove (GTK_LIST_BOX (container), child);
-}
-
 static gboolean
 filter_app_kinds_cb (GsApp    *app,
                      gpointer  user_data)
@@ -495,6 +300,24 @@ gs_installed_page_get_refine_flags (GsInstalledPage *self)
 	return flags;
 }
 
+/* Show the apps from last time while the plugins are set up and queried, and
+ * replace them when the results arrive. This is called when the page is
+ * constructed, so it doesn’t wait for the plugin loader to be set up. */
+static void
+gs_installed_page_load_cached (GsInstalledPage *self)
+{
+	g_autoptr(GsAppList) cached_apps = NULL;
+	g_autoptr(GError) local_error = NULL;
+
+	cached_apps = gs_results_cache_load ("installed", &local_error);
+	if (cached_apps == NULL && !g_error_matches (local_error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+		g_debug ("failed to load cached installed apps: %s", local_error->message);
+	if (cached_apps != NULL && gs_app_list_length (cached_apps) > 0) {
+		gs_app_list_model_set_list (self->apps_model, cached_apps);
+		gtk_stack_set_visible_child_name (GTK_STACK (self->stack_install), "view");
+	}
+}
+
 static void
 gs_installed_page_load (GsInstalledPage *self)
 {
@@ -505,13 +328,11 @@ gs_installed_page_load (GsInstalledPage *self)
 		return;
 	self->waiting = TRUE;
 
-	/* remove old entries */
-	gs_widget_remove_all (self->list_box_install_in_progress, gs_installed_page_remove_all_cb);
-	gs_widget_remove_all (self->list_box_install_apps, gs_installed_page_remove_all_cb);
-	gs_widget_remove_all (self->list_box_install_system_apps, gs_installed_page_remove_all_cb);
-	gs_widget_remove_all (self->list_box_install_addons, gs_installed_page_remove_all_cb);
-	gs_widget_remove_all (self->list_box_install_web_apps, gs_installed_page_remove_all_cb);
-	update_groups (self);
+	/* remove old entries, but keep showing the cached apps until the
+	 * first results arrive */
+	if (self->loaded_once)
+		gs_app_list_model_set_list (self->apps_model, NULL);
+	self->loaded_once = TRUE;
 
 	/* get installed apps */
 	query = gs_app_query_new ("is-installed", GS_APP_QUERY_TRISTATE_TRUE,
@@ -524,8 +345,10 @@ gs_installed_page_load (GsInstalledPage *self)
 					    self->cancellable,
 					    gs_installed_page_get_installed_cb,
 					    self);
-	gtk_spinner_start (GTK_SPINNER (self->spinner_install));
-	gtk_stack_set_visible_child_name (GTK_STACK (self->stack_install), "spinner");
+	if (g_list_model_get_n_items (G_LIST_MODEL (self->apps_model)) == 0) {
+		gtk_spinner_start (GTK_SPINNER (self->spinner_install));
+		gtk_stack_set_visible_child_name (GTK_STACK (self->stack_install), "spinner");
+	}
 }
 
 static void
@@ -646,47 +469,29 @@ gs_installed_page_get_app_sort_key (GsApp *app)
 }
 
 static gint
-gs_installed_page_sort_func (GtkListBoxRow *a,
-                             GtkListBoxRow *b,
+gs_installed_page_sort_func (gconstpointer a,
+                             gconstpointer b,
                              gpointer user_data)
 {
-	GsApp *a1, *a2;
 	g_autofree gchar *key1 = NULL;
 	g_autofree gchar *key2 = NULL;
 
-	a1 = gs_app_row_get_app (GS_APP_ROW (a));
-	a2 = gs_app_row_get_app (GS_APP_ROW (b));
-	key1 = gs_installed_page_get_app_sort_key (a1);
-	key2 = gs_installed_page_get_app_sort_key (a2);
+	key1 = gs_installed_page_get_app_sort_key (GS_APP ((gpointer) a));
+	key2 = gs_installed_page_get_app_sort_key (GS_APP ((gpointer) b));
 
 	/* compare the keys according to the algorithm above */
 	return g_strcmp0 (key1, key2);
 }
 
-static gboolean
-gs_installed_page_has_app (GsInstalledPage *self,
-                           GsApp *app)
-{
-	GtkWidget *lists[] = {
-		self->list_box_install_in_progress,
-		self->list_box_install_apps,
-		self->list_box_install_system_apps,
-		self->list_box_install_addons,
-		self->list_box_install_web_apps,
-		NULL
-	};
-
-	for (gsize i = 0; lists[i]; i++) {
-		for (GtkWidget *child = gtk_widget_get_first_child (lists[i]);
-		     child != NULL;
-		     child = gtk_widget_get_next_sibling (child)) {
-			GsAppRow *app_row = GS_APP_ROW (child);
-			if (gs_app_row_get_app (app_row) == app)
-				return TRUE;
-		}
-	}
+static gint
+gs_installed_page_section_sort_func (gconstpointer a,
+                                     gconstpointer b,
+                                     gpointer user_data)
+{
+	GsInstalledPageSection section1 = gs_installed_page_get_app_section (GS_APP ((gpointer) a));
+	GsInstalledPageSection section2 = gs_installed_page_get_app_section (GS_APP ((gpointer) b));
 
-	return FALSE;
+	return (section1 > section2) - (section1 < section2);
 }
 
 static void
@@ -720,8 +525,7 @@ gs_installed_page_add_pending_apps (GsInstalledPage *self,
 					     gs_app_get_cancellable (app));
 
 		++pending_apps_count;
-		if (!gs_installed_page_has_app (self, app))
-			gs_installed_page_add_app (self, list, app);
+		gs_installed_page_add_app (self, app);
 	}
 
 	/* update the number of on-going operations */
@@ -784,22 +588,6 @@ gs_installed_page_setup (GsPage *page,
 
 	self->cancellable = g_object_ref (cancellable);
 
-	/* setup installed */
-	gtk_list_box_set_sort_func (GTK_LIST_BOX (self->list_box_install_in_progress),
-				    gs_installed_page_sort_func,
-				    self, NULL);
-	gtk_list_box_set_sort_func (GTK_LIST_BOX (self->list_box_install_apps),
-				    gs_installed_page_sort_func,
-				    self, NULL);
-	gtk_list_box_set_sort_func (GTK_LIST_BOX (self->list_box_install_system_apps),
-				    gs_installed_page_sort_func,
-				    self, NULL);
-	gtk_list_box_set_sort_func (GTK_LIST_BOX (self->list_box_install_addons),
-				    gs_installed_page_sort_func,
-				    self, NULL);
-	gtk_list_box_set_sort_func (GTK_LIST_BOX (self->list_box_install_web_apps),
-				    gs_installed_page_sort_func,
-				    self, NULL);
 	return TRUE;
 }
 
@@ -859,6 +647,7 @@ gs_installed_page_dispose (GObject *object)
 	g_clear_object (&self->sizegroup_name);
 	g_clear_object (&self->sizegroup_button_label);
 	g_clear_object (&self->sizegroup_button_image);
+	g_clear_object (&self->apps_model);
 
 	g_clear_object (&self->plugin_loader);
 	g_clear_object (&self->cancellable);
@@ -906,26 +695,96 @@ gs_installed_page_class_init (GsInstalledPageClass *klass)
 
 	gtk_widget_class_set_template_from_resource (widget_class, "/org/gnome/Software/gs-installed-page.ui");
 
-	gtk_widget_class_bind_template_child (widget_class, GsInstalledPage, group_install_in_progress);
-	gtk_widget_class_bind_template_child (widget_class, GsInstalledPage, group_install_apps);
-	gtk_widget_class_bind_template_child (widget_class, GsInstalledPage, group_install_system_apps);
-	gtk_widget_class_bind_template_child (widget_class, GsInstalledPage, group_install_addons);
-	gtk_widget_class_bind_template_child (widget_class, GsInstalledPage, group_install_web_apps);
-	gtk_widget_class_bind_template_child (widget_class, GsInstalledPage, list_box_install_in_progress);
-	gtk_widget_class_bind_template_child (widget_class, GsInstalledPage, list_box_install_apps);
-	gtk_widget_class_bind_template_child (widget_class, GsInstalledPage, list_box_install_system_apps);
-	gtk_widget_class_bind_template_child (widget_class, GsInstalledPage, list_box_install_addons);
-	gtk_widget_class_bind_template_child (widget_class, GsInstalledPage, list_box_install_web_apps);
+	gtk_widget_class_bind_template_child (widget_class, GsInstalledPage, list_view_installed);
 	gtk_widget_class_bind_template_child (widget_class, GsInstalledPage, scrolledwindow_install);
 	gtk_widget_class_bind_template_child (widget_class, GsInstalledPage, spinner_install);
 	gtk_widget_class_bind_template_child (widget_class, GsInstalledPage, stack_install);
 
-	gtk_widget_class_bind_template_callback (widget_class, gs_installed_page_app_row_activated_cb);
+	gtk_widget_class_bind_template_callback (widget_class, gs_installed_page_list_view_activate_cb);
+}
+
+static void
+gs_installed_page_setup_row_cb (GtkSignalListItemFactory *factory,
+                                GtkListItem              *list_item,
+                                GsInstalledPage          *self)
+{
+	GtkWidget *app_row;
+
+	app_row = g_object_new (GS_TYPE_APP_ROW,
+				"show-buttons", TRUE,
+				NULL);
+
+	g_signal_connect (app_row, "button-clicked",
+			  G_CALLBACK (gs_installed_page_app_remove_cb), self);
+
+	gs_app_row_set_size_groups (GS_APP_ROW (app_row),
+				    self->sizegroup_name,
+				    self->sizegroup_button_label,
+				    self->sizegroup_button_image);
+
+	gs_app_row_set_show_description (GS_APP_ROW (app_row), FALSE);
+	gs_app_row_set_show_source (GS_APP_ROW (app_row), FALSE);
+	g_object_bind_property (self, "is-narrow", app_row, "is-narrow", G_BINDING_SYNC_CREATE);
+
+	gtk_list_item_set_child (list_item, app_row);
+}
+
+static void
+gs_installed_page_bind_row_cb (GtkSignalListItemFactory *factory,
+                               GtkListItem              *list_item,
+                               GsInstalledPage          *self)
+{
+	GsAppRow *app_row = GS_APP_ROW (gtk_list_item_get_child (list_item));
+	GsApp *app = gtk_list_item_get_item (list_item);
+
+	gs_app_row_set_show_installed_size (app_row,
+					    !gs_app_has_quirk (app, GS_APP_QUIRK_COMPULSORY) &&
+					    should_show_installed_size (self));
+	gs_app_row_set_show_buttons (app_row, !gs_results_cache_is_cached_app (app));
+	gs_app_row_set_app (app_row, app);
+}
+
+static void
+gs_installed_page_unbind_row_cb (GtkSignalListItemFactory *factory,
+                                 GtkListItem              *list_item,
+                                 GsInstalledPage          *self)
+{
+	gs_app_row_set_app (GS_APP_ROW (gtk_list_item_get_child (list_item)), NULL);
+}
+
+static void
+gs_installed_page_setup_header_cb (GtkSignalListItemFactory *factory,
+                                   GtkListHeader            *list_header,
+                                   GsInstalledPage          *self)
+{
+	GtkWidget *label = gtk_label_new (NULL);
+
+	gtk_label_set_xalign (GTK_LABEL (label), 0.0);
+	gtk_widget_add_css_class (label, "heading");
+	gtk_list_header_set_child (list_header, label);
+}
+
+static void
+gs_installed_page_bind_header_cb (GtkSignalListItemFactory *factory,
+                                  GtkListHeader            *list_header,
+                                  GsInstalledPage          *self)
+{
+	GtkWidget *label = gtk_list_header_get_child (list_header);
+	GsApp *app = gtk_list_header_get_item (list_header);
+	GsInstalledPageSection section = gs_installed_page_get_app_section (app);
+
+	gtk_label_set_label (GTK_LABEL (label), _(section_titles[section]));
 }
 
 static void
 gs_installed_page_init (GsInstalledPage *self)
 {
+	GtkFilterListModel *filter_model;
+	GtkSortListModel *sort_model;
+	g_autoptr(GtkNoSelection) selection_model = NULL;
+	g_autoptr(GtkListItemFactory) factory = NULL;
+	g_autoptr(GtkListItemFactory) header_factory = NULL;
+
 	gtk_widget_init_template (GTK_WIDGET (self));
 
 	self->sizegroup_name = gtk_size_group_new (GTK_SIZE_GROUP_HORIZONTAL);
@@ -933,6 +792,34 @@ gs_installed_page_init (GsInstalledPage *self)
 	self->sizegroup_button_image = gtk_size_group_new (GTK_SIZE_GROUP_HORIZONTAL);
 
 	self->settings = g_settings_new ("org.gnome.software");
+
+	/* The apps are filtered and sorted on the model, and the list view
+	 * only creates and binds rows for the apps which are visible, so
+	 * this scales to thousands of installed apps and runtimes. Sorting by
+	 * section as well splits the list into sections with headers. */
+	self->apps_model = gs_app_list_model_new ();
+	filter_model = gtk_filter_list_model_new (G_LIST_MODEL (g_object_ref (self->apps_model)),
+						  GTK_FILTER (gtk_custom_filter_new (gs_installed_page_filter_cb, NULL, NULL)));
+	sort_model = gtk_sort_list_model_new (G_LIST_MODEL (filter_model),
+					      GTK_SORTER (gtk_custom_sorter_new (gs_installed_page_sort_func, NULL, NULL)));
+	gtk_sort_list_model_set_section_sorter (sort_model,
+						GTK_SORTER (gtk_custom_sorter_new (gs_installed_page_section_sort_func, NULL, NULL)));
+	selection_model = gtk_no_selection_new (G_LIST_MODEL (sort_model));
+
+	factory = gtk_signal_list_item_factory_new ();
+	g_signal_connect (factory, "setup", G_CALLBACK (gs_installed_page_setup_row_cb), self);
+	g_signal_connect (factory, "bind", G_CALLBACK (gs_installed_page_bind_row_cb), self);
+	g_signal_connect (factory, "unbind", G_CALLBACK (gs_installed_page_unbind_row_cb), self);
+
+	header_factory = gtk_signal_list_item_factory_new ();
+	g_signal_connect (header_factory, "setup", G_CALLBACK (gs_installed_page_setup_header_cb), self);
+	g_signal_connect (header_factory, "bind", G_CALLBACK (gs_installed_page_bind_header_cb), self);
+
+	gtk_list_view_set_factory (GTK_LIST_VIEW (self->list_view_installed), factory);
+	gtk_list_view_set_header_factory (GTK_LIST_VIEW (self->list_view_installed), header_factory);
+	gtk_list_view_set_model (GTK_LIST_VIEW (self->list_view_installed), GTK_SELECTION_MODEL (selection_model));
+
+	gs_installed_page_load_cached (self);
 }
 
 /**
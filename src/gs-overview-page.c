@@ -38,6 +38,9 @@ struct _GsOverviewPage
 	GsPluginLoader		*plugin_loader;
 	GCancellable		*cancellable;
 	gboolean		 cache_valid;
+	gboolean		 featured_cached;	/* showing apps from the results cache */
+	gboolean		 curated_cached;
+	gboolean		 recent_cached;
 	GsShell			*shell;
 	gint			 action_cnt;
 	gboolean		 loading_featured;
@@ -101,7 +104,8 @@ app_activated_cb (GsOverviewPage *self, GsAppTile *tile)
 
 	app = gs_app_tile_get_app (tile);
 
-	if (!app)
+	/* apps from the results cache can’t be shown until they’re loaded */
+	if (!app || gs_results_cache_is_cached_app (app))
 		return;
 
 	gs_shell_show_app (self->shell, app);
@@ -114,6 +118,9 @@ featured_carousel_app_clicked_cb (GsFeaturedCarousel *carousel,
 {
 	GsOverviewPage *self = GS_OVERVIEW_PAGE (user_data);
 
+	if (gs_results_cache_is_cached_app (app))
+		return;
+
 	gs_shell_show_app (self->shell, app);
 }
 
@@ -138,6 +145,21 @@ gs_overview_page_decrement_action_cnt (GsOverviewPage *self)
 	self->loading_recent = FALSE;
 }
 
+static void
+gs_overview_page_show_curated (GsOverviewPage *self,
+                               GsAppList      *list)
+{
+	gs_widget_remove_all (self->box_curated, (GsRemoveFunc) gtk_flow_box_remove);
+
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		GsApp *app = gs_app_list_index (list, i);
+		GtkWidget *tile = gs_summary_tile_new (app);
+		gtk_flow_box_insert (GTK_FLOW_BOX (self->box_curated), tile, -1);
+	}
+	gtk_widget_set_visible (self->box_curated, TRUE);
+	gtk_widget_set_visible (self->curated_heading, TRUE);
+}
+
 static void
 gs_overview_page_get_curated_cb (GObject *source_object,
                                  GAsyncResult *res,
@@ -145,9 +167,6 @@ gs_overview_page_get_curated_cb (GObject *source_object,
 {
 	GsOverviewPage *self = GS_OVERVIEW_PAGE (user_data);
 	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (source_object);
-	guint i;
-	GsApp *app;
-	GtkWidget *tile;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GsAppList) list = NULL;
 
@@ -157,6 +176,10 @@ gs_overview_page_get_curated_cb (GObject *source_object,
 		if (!g_error_matches (error, GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_CANCELLED) &&
 		    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
 			g_warning ("failed to get curated apps: %s", error->message);
+		if (self->curated_cached) {
+			gtk_widget_set_visible (self->box_curated, FALSE);
+			gtk_widget_set_visible (self->curated_heading, FALSE);
+		}
 		goto out;
 	}
 
@@ -180,15 +203,9 @@ gs_overview_page_get_curated_cb (GObject *source_object,
 		gs_app_list_remove (list, gs_app_list_index (list, gs_app_list_length (list) - 1));
 	}
 
-	gs_widget_remove_all (self->box_curated, (GsRemoveFunc) gtk_flow_box_remove);
-
-	for (i = 0; i < gs_app_list_length (list); i++) {
-		app = gs_app_list_index (list, i);
-		tile = gs_summary_tile_new (app);
-		gtk_flow_box_insert (GTK_FLOW_BOX (self->box_curated), tile, -1);
-	}
-	gtk_widget_set_visible (self->box_curated, TRUE);
-	gtk_widget_set_visible (self->curated_heading, TRUE);
+	gs_overview_page_show_curated (self, list);
+	self->curated_cached = FALSE;
+	gs_results_cache_save ("overview-curated", list);
 
 	self->empty = FALSE;
 
@@ -196,18 +213,6 @@ out:
 	gs_overview_page_decrement_action_cnt (self);
 }
 
-static gint
-gs_overview_page_sort_recent_cb (GsApp *app1,
-				 GsApp *app2,
-				 gpointer user_data)
-{
-	if (gs_app_get_release_date (app1) < gs_app_get_release_date (app2))
-		return 1;
-	if (gs_app_get_release_date (app1) == gs_app_get_release_date (app2))
-		return g_strcmp0 (gs_app_get_name (app1), gs_app_get_name (app2));
-	return -1;
-}
-
 static gboolean
 gs_overview_page_filter_recent_cb (GsApp    *app,
                                    gpointer  user_data)
@@ -216,14 +221,35 @@ gs_overview_page_filter_recent_cb (GsApp    *app,
 		gs_app_get_kind (app) == AS_COMPONENT_KIND_DESKTOP_APP);
 }
 
+static void
+gs_overview_page_show_recent (GsOverviewPage *self,
+                              GsAppList      *list)
+{
+	gs_widget_remove_all (self->box_recent, (GsRemoveFunc) gtk_flow_box_remove);
+
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		GsApp *app = gs_app_list_index (list, i);
+		GtkWidget *tile = gs_summary_tile_new (app);
+		guint64 release_date;
+		g_autofree gchar *release_date_tooltip = NULL;
+
+		/* Shows the latest release date of the app in
+		   relative format (e.g. "10 days ago") on hover. */
+		release_date = gs_app_get_release_date (app);
+		release_date_tooltip = gs_utils_time_to_string (release_date);
+		gtk_widget_set_tooltip_text (tile, release_date_tooltip);
+
+		gtk_flow_box_insert (GTK_FLOW_BOX (self->box_recent), tile, -1);
+	}
+	gtk_widget_set_visible (self->box_recent, TRUE);
+	gtk_widget_set_visible (self->recent_heading, TRUE);
+}
+
 static void
 gs_overview_page_get_recent_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
 {
 	GsOverviewPage *self = GS_OVERVIEW_PAGE (user_data);
 	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (source_object);
-	guint i;
-	GsApp *app;
-	GtkWidget *tile;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GsAppList) list = NULL;
 
@@ -233,6 +259,10 @@ gs_overview_page_get_recent_cb (GObject *source_object, GAsyncResult *res, gpoin
 		if (!g_error_matches (error, GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_CANCELLED) &&
 		    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
 			g_warning ("failed to get recent apps: %s", error->message);
+		if (self->recent_cached) {
+			gtk_widget_set_visible (self->box_recent, FALSE);
+			gtk_widget_set_visible (self->recent_heading, FALSE);
+		}
 		goto out;
 	}
 
@@ -247,25 +277,9 @@ gs_overview_page_get_recent_cb (GObject *source_object, GAsyncResult *res, gpoin
 
 	g_assert (gs_app_list_length (list) <= N_TILES);
 
-	gs_widget_remove_all (self->box_recent, (GsRemoveFunc) gtk_flow_box_remove);
-
-	for (i = 0; i < gs_app_list_length (list); i++) {
-		guint64 release_date;
-		g_autofree gchar *release_date_tooltip = NULL;
-
-		app = gs_app_list_index (list, i);
-		tile = gs_summary_tile_new (app);
-
-		/* Shows the latest release date of the app in
-		   relative format (e.g. "10 days ago") on hover. */
-		release_date = gs_app_get_release_date (app);
-		release_date_tooltip = gs_utils_time_to_string (release_date);
-		gtk_widget_set_tooltip_text (tile, release_date_tooltip);
-
-		gtk_flow_box_insert (GTK_FLOW_BOX (self->box_recent), tile, -1);
-	}
-	gtk_widget_set_visible (self->box_recent, TRUE);
-	gtk_widget_set_visible (self->recent_heading, TRUE);
+	gs_overview_page_show_recent (self, list);
+	self->recent_cached = FALSE;
+	gs_results_cache_save ("overview-recent", list);
 
 	self->empty = FALSE;
 
@@ -301,8 +315,11 @@ gs_overview_page_get_featured_cb (GObject *source_object,
 
 	list = gs_plugin_loader_job_process_finish (plugin_loader, res, &error);
 	if (g_error_matches (error, GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_CANCELLED) ||
-	    g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+	    g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		if (self->featured_cached)
+			gtk_widget_set_visible (self->featured_carousel, FALSE);
 		goto out;
+	}
 
 	if (self->featured_overwritten) {
 		g_debug ("Skipping set of featured apps, because being overwritten");
@@ -318,6 +335,8 @@ gs_overview_page_get_featured_cb (GObject *source_object,
 
 	gtk_widget_set_visible (self->featured_carousel, gs_app_list_length (list) > 0);
 	gs_featured_carousel_set_apps (GS_FEATURED_CAROUSEL (self->featured_carousel), list);
+	self->featured_cached = FALSE;
+	gs_results_cache_save ("overview-featured", list);
 
 	self->empty = self->empty && (gs_app_list_length (list) == 0);
 
@@ -959,6 +978,81 @@ gs_overview_page_read_deployment_featured_keys (gchar **out_label,
 	return TRUE;
 }
 
+static GsAppList *
+gs_overview_page_load_cached_apps (const gchar *name,
+                                   guint        min_apps)
+{
+	g_autoptr(GsAppList) list = NULL;
+	g_autoptr(GError) local_error = NULL;
+
+	list = gs_results_cache_load (name, &local_error);
+	if (list == NULL) {
+		if (!g_error_matches (local_error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			g_debug ("failed to load cached %s apps: %s", name, local_error->message);
+		return NULL;
+	}
+
+	/* it was saved after filtering, so this only fails if it’s been
+	 * tampered with */
+	if (gs_app_list_length (list) < min_apps || gs_app_list_length (list) > N_TILES)
+		return NULL;
+
+	return g_steal_pointer (&list);
+}
+
+/* Show the apps from when the page was last loaded, so it’s not empty while
+ * the plugins are set up and queried. They’re replaced as each query returns.
+ * This is called when the page is constructed, so it can be shown before the
+ * plugin loader has been set up. */
+static void
+gs_overview_page_load_cached (GsOverviewPage *self)
+{
+	g_autoptr(GsAppList) featured = NULL;
+	g_autoptr(GsAppList) curated = NULL;
+	g_autoptr(GsAppList) recent = NULL;
+
+	featured = gs_overview_page_load_cached_apps ("overview-featured", 1);
+	if (featured != NULL && !self->featured_overwritten) {
+		gtk_widget_set_visible (self->featured_carousel, TRUE);
+		gs_featured_carousel_set_apps (GS_FEATURED_CAROUSEL (self->featured_carousel), featured);
+		self->featured_cached = TRUE;
+	}
+
+	curated = gs_overview_page_load_cached_apps ("overview-curated", MIN_CURATED_APPS);
+	if (curated != NULL) {
+		gs_overview_page_show_curated (self, curated);
+		self->curated_cached = TRUE;
+	}
+
+	recent = gs_overview_page_load_cached_apps ("overview-recent", N_TILES);
+	if (recent != NULL) {
+		gs_overview_page_show_recent (self, recent);
+		self->recent_cached = TRUE;
+	}
+
+	if (featured != NULL || curated != NULL || recent != NULL)
+		gtk_stack_set_visible_child_name (GTK_STACK (self->stack_overview), "overview");
+}
+
+/**
+ * gs_overview_page_get_showing_cached:
+ * @self: a #GsOverviewPage
+ *
+ * Get whether the page is showing any apps from the results cache, which
+ * means it has something to show before the plugin loader has been set up.
+ *
+ * Returns: %TRUE if any cached apps are shown
+ *
+ * Since: 48
+ */
+gboolean
+gs_overview_page_get_showing_cached (GsOverviewPage *self)
+{
+	g_return_val_if_fail (GS_IS_OVERVIEW_PAGE (self), FALSE);
+
+	return self->featured_cached || self->curated_cached || self->recent_cached;
+}
+
 static void
 gs_overview_page_load (GsOverviewPage *self)
 {
@@ -1062,7 +1156,7 @@ gs_overview_page_load (GsOverviewPage *self)
 					  "dedupe-flags", GS_APP_LIST_FILTER_FLAG_KEY_ID |
 							  GS_APP_LIST_FILTER_FLAG_PREFER_INSTALLED |
 							  GS_APP_LIST_FILTER_FLAG_KEY_ID_PROVIDES,
-					  "sort-func", gs_overview_page_sort_recent_cb,
+					  "sort-func", gs_utils_app_sort_release_date,
 					  "filter-func", gs_overview_page_filter_recent_cb,
 					  "license-type", gs_page_get_query_license_type (GS_PAGE (self)),
 					  "developer-verified-type", gs_page_get_query_developer_verified_type (GS_PAGE (self)),
@@ -1233,6 +1327,8 @@ gs_overview_page_init (GsOverviewPage *self)
 
 	if (gs_overview_page_read_deployment_featured_keys (&tmp_label, &self->deployment_featured))
 		gtk_label_set_text (GTK_LABEL (self->deployment_featured_heading), tmp_label);
+
+	gs_overview_page_load_cached (self);
 }
 
 static void
@@ -18,6 +18,7 @@ G_BEGIN_DECLS
 G_DECLARE_FINAL_TYPE (GsOverviewPage, gs_overview_page, GS, OVERVIEW_PAGE, GsPage)
 
 GsOverviewPage	*gs_overview_page_new		(void);
+gboolean	 gs_overview_page_get_showing_cached	(GsOverviewPage	*self);
 void		 gs_overview_page_override_featured
 						(GsOverviewPage	*self,
 						 GsApp		*app);
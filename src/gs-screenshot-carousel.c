@@ -144,6 +144,10 @@ gs_screenshot_carousel_load_screenshots (GsScreenshotCarousel *self, GsApp *app,
 					      GS_IMAGE_NORMAL_WIDTH,
 					      GS_IMAGE_NORMAL_HEIGHT);
 		gtk_widget_add_css_class (ssimg, "screenshot-image-main");
+		/* only the first screenshot is visible straight away, so
+		 * download the others after anything else on screen */
+		if (i > 0)
+			gs_screenshot_image_set_io_priority (GS_SCREENSHOT_IMAGE (ssimg), G_PRIORITY_LOW);
 		gs_screenshot_image_load_async (GS_SCREENSHOT_IMAGE (ssimg), cancellable);
 
 		/* when we're offline, the load will be immediate, so we
@@ -31,7 +31,6 @@ struct _GsScreenshotImage
 	GtkWidget	*label_error;
 	GSettings	*settings;
 	SoupSession	*session;
-	SoupMessage	*message;
 	GCancellable	*cancellable;
 	gchar		*filename;
 	const gchar	*current_image;
@@ -39,6 +38,7 @@ struct _GsScreenshotImage
 	guint		 height;
 	guint		 scale;
 	guint		 load_timeout_id;
+	int		 io_priority;
 	gboolean	 showing_image;
 };
 
@@ -338,84 +338,44 @@ gs_screenshot_image_save_downloaded_img (GsScreenshotImage *ssimg,
 }
 
 static void
-#if SOUP_CHECK_VERSION(3, 0, 0)
 gs_screenshot_image_complete_cb (GObject *source_object,
 				 GAsyncResult *result,
 				 gpointer user_data)
-#else
-gs_screenshot_image_complete_cb (SoupSession *session,
-				 SoupMessage *msg,
-				 gpointer user_data)
-#endif
 {
 	g_autoptr(GsScreenshotImage) ssimg = GS_SCREENSHOT_IMAGE (user_data);
 	gboolean ret;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GdkPixbuf) pixbuf = NULL;
 	g_autoptr(GInputStream) stream = NULL;
-	guint status_code;
-
-#if SOUP_CHECK_VERSION(3, 0, 0)
 	g_autoptr(GBytes) bytes = NULL;
-	SoupMessage *msg;
 
-	bytes = soup_session_send_and_read_finish (SOUP_SESSION (source_object), result, &error);
-	if (bytes == NULL) {
-		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
-			g_warning ("Failed to download screenshot: %s", error->message);
-			/* Reset the width request, thus the image shrinks when the window width is small */
-			gtk_widget_set_size_request (ssimg->stack, -1, (gint) ssimg->height);
-			gs_screenshot_image_stop_spinner (ssimg);
-			gs_screenshot_image_set_error (ssimg, _("Screenshot not found"));
-		}
+	bytes = gs_download_scheduler_download_bytes_finish (GS_DOWNLOAD_SCHEDULER (source_object), result, &error);
+
+	/* return immediately if the download was cancelled or if we're in destruction */
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED) ||
+	    ssimg->session == NULL)
 		return;
-	}
 
-	msg = soup_session_get_async_result_message (SOUP_SESSION (source_object), result);
-	status_code = soup_message_get_status (msg);
-#else
-	status_code = msg->status_code;
-#endif
 	if (ssimg->load_timeout_id) {
 		g_source_remove (ssimg->load_timeout_id);
 		ssimg->load_timeout_id = 0;
 	}
 
-	/* return immediately if the message was cancelled or if we're in destruction */
-#if SOUP_CHECK_VERSION(3, 0, 0)
-	if (ssimg->session == NULL)
-#else
-	if (status_code == SOUP_STATUS_CANCELLED || ssimg->session == NULL)
-#endif
-		return;
-
 	/* Reset the width request, thus the image shrinks when the window width is small */
 	gtk_widget_set_size_request (ssimg->stack, -1, (gint) ssimg->height);
 
-	if (status_code == SOUP_STATUS_NOT_MODIFIED) {
+	if (g_error_matches (error, GS_DOWNLOAD_ERROR, GS_DOWNLOAD_ERROR_NOT_MODIFIED)) {
 		g_debug ("screenshot has not been modified");
 		as_screenshot_show_image (ssimg);
 		gs_screenshot_image_stop_spinner (ssimg);
 		return;
 	}
-	if (status_code != SOUP_STATUS_OK) {
+	if (bytes == NULL) {
 		/* Ignore failures due to being offline */
-#if SOUP_CHECK_VERSION(3, 0, 0)
-		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_HOST_UNREACHABLE) &&
-		    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NETWORK_UNREACHABLE)) {
-#else
-		if (status_code != SOUP_STATUS_CANT_RESOLVE) {
-#endif
-			const gchar *reason_phrase;
-#if SOUP_CHECK_VERSION(3, 0, 0)
-			reason_phrase = soup_message_get_reason_phrase (msg);
-#else
-			reason_phrase = msg->reason_phrase;
-#endif
-			g_warning ("Result of screenshot downloading attempt with "
-				   "status code '%u': %s", status_code,
-				   reason_phrase);
-		}
+		if (g_network_monitor_get_network_available (g_network_monitor_get_default ()) &&
+		    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_HOST_UNREACHABLE) &&
+		    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NETWORK_UNREACHABLE))
+			g_warning ("Failed to download screenshot: %s", error->message);
 		gs_screenshot_image_stop_spinner (ssimg);
 		/* if we're already showing an image, then don't set the error
 		 * as having an image (even if outdated) is better */
@@ -427,18 +387,7 @@ gs_screenshot_image_complete_cb (SoupSession *session,
 		return;
 	}
 
-#if SOUP_CHECK_VERSION(3, 0, 0)
 	stream = g_memory_input_stream_new_from_bytes (bytes);
-#else
-	/* create a buffer with the data */
-	stream = g_memory_input_stream_new_from_data (msg->response_body->data,
-						      msg->response_body->length,
-						      NULL);
-	if (stream == NULL) {
-		gs_screenshot_image_stop_spinner (ssimg);
-		return;
-	}
-#endif
 
 	/* load the image */
 	pixbuf = gdk_pixbuf_new_from_stream (stream, NULL, NULL);
@@ -513,15 +462,11 @@ gs_screenshot_get_cachefn_for_url (const gchar *url)
 	return g_strdup_printf ("%s-%s", checksum, basename);
 }
 
-static void
-gs_screenshot_soup_msg_set_modified_request (SoupMessage *msg, GFile *file)
+static GDateTime *
+gs_screenshot_get_modification_date_time (const gchar *filename)
 {
-#ifndef GLIB_VERSION_2_62
-	GTimeVal time_val;
-#endif
-	g_autoptr(GDateTime) date_time = NULL;
+	g_autoptr(GFile) file = g_file_new_for_path (filename);
 	g_autoptr(GFileInfo) info = NULL;
-	g_autofree gchar *mod_date = NULL;
 
 	info = g_file_query_info (file,
 				  G_FILE_ATTRIBUTE_TIME_MODIFIED,
@@ -529,22 +474,9 @@ gs_screenshot_soup_msg_set_modified_request (SoupMessage *msg, GFile *file)
 				  NULL,
 				  NULL);
 	if (info == NULL)
-		return;
-#ifdef GLIB_VERSION_2_62
-	date_time = g_file_info_get_modification_date_time (info);
-#else
-	g_file_info_get_modification_time (info, &time_val);
-	date_time = g_date_time_new_from_timeval_local (&time_val);
-#endif
-	mod_date = g_date_time_format (date_time, "%a, %d %b %Y %H:%M:%S %Z");
-	soup_message_headers_append (
-#if SOUP_CHECK_VERSION(3, 0, 0)
-				     soup_message_get_request_headers (msg),
-#else
-				     msg->request_headers,
-#endif
-				     "If-Modified-Since",
-				     mod_date);
+		return NULL;
+
+	return g_file_info_get_modification_date_time (info);
 }
 
 static gboolean
@@ -632,7 +564,7 @@ gs_screenshot_video_downloaded_cb (GObject *source_object,
 	g_autoptr(GsScreenshotImage) ssimg = user_data;
 	g_autoptr(GError) error = NULL;
 
-	if (gs_download_file_finish (ssimg->session, result, &error) ||
+	if (gs_download_scheduler_download_file_finish (GS_DOWNLOAD_SCHEDULER (source_object), result, &error) ||
 	    g_error_matches (error, GS_DOWNLOAD_ERROR, GS_DOWNLOAD_ERROR_NOT_MODIFIED)) {
 		gs_screenshot_image_stop_spinner (ssimg);
 		as_screenshot_show_image (ssimg);
@@ -656,7 +588,9 @@ gs_screenshot_image_load_async (GsScreenshotImage *ssimg,
 	g_autofree gchar *cache_kind = NULL;
 	g_autofree gchar *cachefn_thumb = NULL;
 	g_autofree gchar *sizedir = NULL;
+	g_autofree gchar *uri_str = NULL;
 	g_autoptr(GUri) base_uri = NULL;
+	g_autoptr(GDateTime) last_modified_date = NULL;
 
 	g_return_if_fail (GS_IS_SCREENSHOT_IMAGE (ssimg));
 
@@ -783,23 +717,15 @@ gs_screenshot_image_load_async (GsScreenshotImage *ssimg,
 		ssimg->load_timeout_id = 0;
 	}
 
-	/* cancel any previous messages */
+	/* cancel any previous downloads */
 	if (ssimg->cancellable != NULL) {
 		g_cancellable_cancel (ssimg->cancellable);
 		g_clear_object (&ssimg->cancellable);
 	}
 
-	if (ssimg->message != NULL) {
-#if !SOUP_CHECK_VERSION(3, 0, 0)
-		soup_session_cancel_message (ssimg->session,
-		                             ssimg->message,
-		                             SOUP_STATUS_CANCELLED);
-#endif
-		g_clear_object (&ssimg->message);
-	}
+	uri_str = g_uri_to_string (base_uri);
 
 	if (as_screenshot_get_media_kind (ssimg->screenshot) == AS_SCREENSHOT_MEDIA_KIND_VIDEO) {
-		g_autofree gchar *uri_str = g_uri_to_string (base_uri);
 		g_autoptr(GFile) output_file = NULL;
 
 		ssimg->cancellable = g_cancellable_new ();
@@ -808,47 +734,51 @@ gs_screenshot_image_load_async (GsScreenshotImage *ssimg,
 		/* Make sure the spinner takes approximately the size the screenshot will use */
 		gtk_widget_set_size_request (ssimg->stack, (gint) ssimg->width, (gint) ssimg->height);
 
-		gs_download_file_async (ssimg->session, uri_str, output_file, G_PRIORITY_DEFAULT, NULL, NULL,
-					ssimg->cancellable, gs_screenshot_video_downloaded_cb, g_object_ref (ssimg));
+		gs_download_scheduler_download_file_async (gs_download_scheduler_get_default (),
+							   ssimg->session, uri_str, output_file, ssimg->io_priority,
+							   NULL, NULL, ssimg->cancellable, gs_screenshot_video_downloaded_cb,
+							   g_object_ref (ssimg));
 
 		return;
 	}
 
-#if SOUP_CHECK_VERSION(3, 0, 0)
-	ssimg->message = soup_message_new_from_uri (SOUP_METHOD_GET, base_uri);
-#else
-	{
-	g_autofree gchar *uri_str = g_uri_to_string (base_uri);
-	ssimg->message = soup_message_new (SOUP_METHOD_GET, uri_str);
-	}
-#endif
-	if (ssimg->message == NULL) {
-		/* TRANSLATORS: this is when networking is not available */
-		gs_screenshot_image_set_error (ssimg, _("Screenshot not available"));
-		return;
-	}
-
 	/* not all servers support If-Modified-Since, but worst case we just
 	 * re-download the entire file again every 30 days */
-	if (g_file_test (ssimg->filename, G_FILE_TEST_EXISTS)) {
-		g_autoptr(GFile) file = g_file_new_for_path (ssimg->filename);
-		gs_screenshot_soup_msg_set_modified_request (ssimg->message, file);
-	}
+	if (g_file_test (ssimg->filename, G_FILE_TEST_EXISTS))
+		last_modified_date = gs_screenshot_get_modification_date_time (ssimg->filename);
 
 	ssimg->load_timeout_id = g_timeout_add_seconds (SPINNER_TIMEOUT_SECS,
 		gs_screenshot_show_spinner_cb, ssimg);
 
-	/* send async */
-#if SOUP_CHECK_VERSION(3, 0, 0)
+	/* the scheduler shares the download with any other widget showing
+	 * the same screenshot, and drops it if they are all destroyed */
 	ssimg->cancellable = g_cancellable_new ();
-	soup_session_send_and_read_async (ssimg->session, ssimg->message, G_PRIORITY_DEFAULT, ssimg->cancellable,
-					  gs_screenshot_image_complete_cb, g_object_ref (ssimg));
-#else
-	soup_session_queue_message (ssimg->session,
-				    g_object_ref (ssimg->message) /* transfer full */,
-				    gs_screenshot_image_complete_cb,
-				    g_object_ref (ssimg));
-#endif
+	gs_download_scheduler_download_bytes_async (gs_download_scheduler_get_default (),
+						    ssimg->session, uri_str, last_modified_date,
+						    ssimg->io_priority, ssimg->cancellable,
+						    gs_screenshot_image_complete_cb, g_object_ref (ssimg));
+}
+
+/**
+ * gs_screenshot_image_set_io_priority:
+ * @ssimg: a #GsScreenshotImage
+ * @io_priority: I/O priority to download the screenshot with
+ *
+ * Set the priority of the screenshot download relative to other downloads.
+ * Screenshots which are on screen should use %G_PRIORITY_DEFAULT (the
+ * default), and ones which are only being prefetched %G_PRIORITY_LOW.
+ *
+ * This takes effect from the next call to gs_screenshot_image_load_async().
+ *
+ * Since: 48
+ */
+void
+gs_screenshot_image_set_io_priority (GsScreenshotImage *ssimg,
+				     int io_priority)
+{
+	g_return_if_fail (GS_IS_SCREENSHOT_IMAGE (ssimg));
+
+	ssimg->io_priority = io_priority;
 }
 
 gboolean
@@ -884,14 +814,6 @@ gs_screenshot_image_dispose (GObject *object)
 		g_clear_object (&ssimg->cancellable);
 	}
 
-	if (ssimg->message != NULL) {
-#if !SOUP_CHECK_VERSION(3, 0, 0)
-		soup_session_cancel_message (ssimg->session,
-		                             ssimg->message,
-		                             SOUP_STATUS_CANCELLED);
-#endif
-		g_clear_object (&ssimg->message);
-	}
 	gs_widget_remove_all (GTK_WIDGET (ssimg), NULL);
 	g_clear_object (&ssimg->screenshot);
 	g_clear_object (&ssimg->session);
@@ -909,6 +831,7 @@ gs_screenshot_image_init (GsScreenshotImage *ssimg)
 
 	ssimg->settings = g_settings_new ("org.gnome.software");
 	ssimg->showing_image = FALSE;
+	ssimg->io_priority = G_PRIORITY_DEFAULT;
 
 	gtk_widget_init_template (GTK_WIDGET (ssimg));
 
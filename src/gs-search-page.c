@@ -16,6 +16,7 @@
 #include "gs-shell.h"
 #include "gs-common.h"
 #include "gs-app-row.h"
+#include "gs-search-session.h"
 
 #define GS_SEARCH_PAGE_MAX_RESULTS	50
 
@@ -30,6 +31,7 @@ struct _GsSearchPage
 	GtkSizeGroup		*sizegroup_button_label;
 	GtkSizeGroup		*sizegroup_button_image;
 	GsShell			*shell;
+	GsSearchSession		*search_session;
 	gchar			*appid_to_show;
 	gchar			*value;
 	guint			 waiting_id;
@@ -100,48 +102,26 @@ gs_search_page_app_to_show_created_cb (GObject *source_object,
 typedef struct {
 	GsSearchPage *self;
 	guint stamp;
+	gchar *value;  /* (owned) */
 } GetSearchData;
 
 static void
-gs_search_page_get_search_cb (GObject *source_object,
-                              GAsyncResult *res,
-                              gpointer user_data)
+get_search_data_free (GetSearchData *search_data)
 {
-	guint i;
-	g_autofree GetSearchData *search_data = user_data;
-	GsApp *app;
-	GsSearchPage *self = search_data->self;
-	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (source_object);
-	GtkWidget *app_row;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(GsAppList) list = NULL;
-
-	/* different stamps means another search had been started before this one finished */
-	if (search_data->stamp != self->stamp)
-		return;
+	g_free (search_data->value);
+	g_free (search_data);
+}
 
-	/* don't do the delayed spinner */
-	gs_search_page_waiting_cancel (self);
-
-	list = gs_plugin_loader_job_process_finish (plugin_loader, res, &error);
-	if (list == NULL) {
-		if (g_error_matches (error, GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_CANCELLED) ||
-		    g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
-			g_debug ("search cancelled");
-			return;
-		}
-		g_warning ("failed to get search apps: %s", error->message);
-		gtk_spinner_stop (GTK_SPINNER (self->spinner_search));
-		if (self->value && self->value[0])
-			gtk_stack_set_visible_child_name (GTK_STACK (self->stack_search), "no-results");
-		else
-			gtk_stack_set_visible_child_name (GTK_STACK (self->stack_search), "no-search");
-		return;
-	}
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GetSearchData, get_search_data_free)
 
+static void
+gs_search_page_show_results (GsSearchPage *self,
+			     GsAppList    *list)
+{
 	/* no results */
 	if (gs_app_list_length (list) == 0) {
 		g_debug ("no search results to show");
+		gtk_spinner_stop (GTK_SPINNER (self->spinner_search));
 		if (self->value && self->value[0])
 			gtk_stack_set_visible_child_name (GTK_STACK (self->stack_search), "no-results");
 		else
@@ -154,9 +134,9 @@ gs_search_page_get_search_cb (GObject *source_object,
 
 	gtk_spinner_stop (GTK_SPINNER (self->spinner_search));
 	gtk_stack_set_visible_child_name (GTK_STACK (self->stack_search), "results");
-	for (i = 0; i < gs_app_list_length (list); i++) {
-		app = gs_app_list_index (list, i);
-		app_row = gs_app_row_new (app);
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		GsApp *app = gs_app_list_index (list, i);
+		GtkWidget *app_row = gs_app_row_new (app);
 		gs_app_row_set_show_rating (GS_APP_ROW (app_row), TRUE);
 		g_signal_connect (app_row, "button-clicked",
 				  G_CALLBACK (gs_search_page_app_row_clicked_cb),
@@ -209,6 +189,47 @@ gs_search_page_get_search_cb (GObject *source_object,
 	}
 }
 
+static void
+gs_search_page_get_search_cb (GObject *source_object,
+                              GAsyncResult *res,
+                              gpointer user_data)
+{
+	g_autoptr(GetSearchData) search_data = user_data;
+	GsSearchPage *self = search_data->self;
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (source_object);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GsAppList) list = NULL;
+
+	/* different stamps means another search had been started before this one finished */
+	if (search_data->stamp != self->stamp)
+		return;
+
+	/* don't do the delayed spinner */
+	gs_search_page_waiting_cancel (self);
+
+	list = gs_plugin_loader_job_process_finish (plugin_loader, res, &error);
+	if (list == NULL) {
+		if (g_error_matches (error, GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_CANCELLED) ||
+		    g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			g_debug ("search cancelled");
+			return;
+		}
+		g_warning ("failed to get search apps: %s", error->message);
+		gs_search_session_reset (self->search_session);
+		gtk_spinner_stop (GTK_SPINNER (self->spinner_search));
+		if (self->value && self->value[0])
+			gtk_stack_set_visible_child_name (GTK_STACK (self->stack_search), "no-results");
+		else
+			gtk_stack_set_visible_child_name (GTK_STACK (self->stack_search), "no-search");
+		return;
+	}
+
+	/* remember the results so that extending the search text can refine them */
+	gs_search_session_set_results (self->search_session, search_data->value, list);
+
+	gs_search_page_show_results (self, list);
+}
+
 static gboolean
 gs_search_page_waiting_show_cb (gpointer user_data)
 {
@@ -273,8 +294,9 @@ gs_search_page_load (GsSearchPage *self)
 {
 	g_autoptr(GsPluginJob) plugin_job = NULL;
 	g_autoptr(GsAppQuery) query = NULL;
+	g_autoptr(GsAppList) refined_list = NULL;
 	const gchar *keywords[2] = { NULL, };
-	g_autofree GetSearchData *search_data = NULL;
+	g_autoptr(GetSearchData) search_data = NULL;
 
 	self->changed = FALSE;
 
@@ -284,13 +306,24 @@ gs_search_page_load (GsSearchPage *self)
 	self->search_cancellable = g_cancellable_new ();
 	self->stamp++;
 
-	/* search for apps */
 	gs_search_page_waiting_cancel (self);
+
+	/* if the text only extends the previous search, rescore its results
+	 * rather than searching through all the plugins again */
+	refined_list = gs_search_session_refine (self->search_session, self->value);
+	if (refined_list != NULL) {
+		gs_app_list_sort (refined_list, gs_search_page_sort_cb, self);
+		gs_search_page_show_results (self, refined_list);
+		return;
+	}
+
+	/* search for apps */
 	self->waiting_id = g_timeout_add (250, gs_search_page_waiting_show_cb, self);
 
 	search_data = g_new0 (GetSearchData, 1);
 	search_data->self = self;
 	search_data->stamp = self->stamp;
+	search_data->value = g_strdup (self->value);
 
 	keywords[0] = self->value;
 	query = gs_app_query_new ("keywords", keywords,
@@ -328,6 +361,7 @@ gs_search_page_app_row_activated_cb (GtkListBox *list_box,
 	/* increase the maximum allowed, and re-request the search */
 	if (!GS_IS_APP_ROW (row)) {
 		self->max_results *= 4;
+		gs_search_session_reset (self->search_session);
 		gs_search_page_load (self);
 		return;
 	}
@@ -340,6 +374,10 @@ static void
 gs_search_page_reload (GsPage *page)
 {
 	GsSearchPage *self = GS_SEARCH_PAGE (page);
+
+	/* the previous results may be stale */
+	gs_search_session_reset (self->search_session);
+
 	if (self->value != NULL)
 		gs_search_page_load (self);
 }
@@ -501,6 +539,7 @@ gs_search_page_dispose (GObject *object)
 	g_clear_object (&self->plugin_loader);
 	g_clear_object (&self->cancellable);
 	g_clear_object (&self->search_cancellable);
+	g_clear_object (&self->search_session);
 
 	G_OBJECT_CLASS (gs_search_page_parent_class)->dispose (object);
 }
@@ -555,6 +594,7 @@ gs_search_page_init (GsSearchPage *self)
 	self->sizegroup_button_image = gtk_size_group_new (GTK_SIZE_GROUP_HORIZONTAL);
 
 	self->max_results = GS_SEARCH_PAGE_MAX_RESULTS;
+	self->search_session = gs_search_session_new ();
 }
 
 GsSearchPage *
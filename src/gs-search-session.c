@@ -0,0 +1,235 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Software contributors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/**
+ * SECTION:gs-search-session
+ * @short_description: Incremental refinement of search results
+ *
+ * #GsSearchSession remembers the results of the last completed search, so
+ * that a query which only extends the previous one (for example, the user
+ * typing `fire`, then `firef`, then `firefox`) can be answered by rescoring
+ * the previous results locally, rather than running a full search through
+ * every plugin again.
+ *
+ * Because plugins may match apps on data which is not available on the
+ * #GsApp (such as keywords), the previous results are only reused if every
+ * one of them can be matched locally against the query which produced it,
+ * and if they were not truncated. Otherwise, and whenever a token is deleted
+ * or changed other than by appending to it, or is extended in a way which
+ * stemming means could match more apps, gs_search_session_refine() returns
+ * %NULL and the caller must do a full search.
+ *
+ * The previous results are matched with a #GsSearchMatcher, so they are
+ * ranked as a full search would rank them.
+ */
+
+#include "config.h"
+
+#include "gs-search-session.h"
+
+struct _GsSearchSession
+{
+	GObject			 parent_instance;
+
+	gchar			**tokens;	/* (owned) (nullable) */
+	GsAppList		*candidates;	/* (owned) (nullable) */
+	GsSearchMatcher		*matcher;	/* (owned) (nullable) for @candidates */
+};
+
+G_DEFINE_TYPE (GsSearchSession, gs_search_session, G_TYPE_OBJECT)
+
+/* Returns (transfer full) the match value of each of the candidates for
+ * @tokens, which is zero unless *all* of them match. */
+static guint16 *
+gs_search_session_match (GsSearchSession    *self,
+			 const gchar * const *tokens)
+{
+	g_autoptr(GError) local_error = NULL;
+	guint16 *match_values;
+
+	match_values = gs_search_matcher_match (self->matcher, tokens, NULL, &local_error);
+	if (match_values == NULL && local_error != NULL)
+		g_debug ("failed to match previous search results: %s", local_error->message);
+
+	return match_values;
+}
+
+/**
+ * gs_search_session_reset:
+ * @self: a #GsSearchSession
+ *
+ * Forget the previous results, so the next search is a full one.
+ **/
+void
+gs_search_session_reset (GsSearchSession *self)
+{
+	g_return_if_fail (GS_IS_SEARCH_SESSION (self));
+
+	g_clear_pointer (&self->tokens, g_strfreev);
+	g_clear_object (&self->candidates);
+	g_clear_pointer (&self->matcher, gs_search_matcher_unref);
+}
+
+/**
+ * gs_search_session_set_results:
+ * @self: a #GsSearchSession
+ * @text: the search text which was used
+ * @list: the results of a full search for @text
+ *
+ * Remember the results of a full search, to be refined by later calls to
+ * gs_search_session_refine().
+ **/
+void
+gs_search_session_set_results (GsSearchSession *self,
+			       const gchar     *text,
+			       GsAppList       *list)
+{
+	g_auto(GStrv) tokens = NULL;
+	g_autofree guint16 *match_values = NULL;
+	g_autoptr(GError) local_error = NULL;
+
+	g_return_if_fail (GS_IS_SEARCH_SESSION (self));
+	g_return_if_fail (GS_IS_APP_LIST (list));
+
+	gs_search_session_reset (self);
+
+	/* the apps which didn’t fit in the list may match a longer query */
+	if (gs_app_list_has_flag (list, GS_APP_LIST_FLAG_IS_TRUNCATED))
+		return;
+
+	tokens = gs_search_matcher_tokenize (text);
+	if (tokens == NULL)
+		return;
+
+	self->candidates = gs_app_list_copy (list);
+	if (gs_app_list_length (list) > 0) {
+		self->matcher = gs_search_matcher_new (self->candidates, NULL, &local_error);
+		if (self->matcher == NULL) {
+			g_debug ("not refining further searches: %s", local_error->message);
+			gs_search_session_reset (self);
+			return;
+		}
+
+		/* only reuse the results if the local matching can
+		 * reproduce them */
+		match_values = gs_search_session_match (self, (const gchar * const *) tokens);
+		for (guint i = 0; i < gs_app_list_length (self->candidates); i++) {
+			GsApp *app = gs_app_list_index (self->candidates, i);
+			if (match_values == NULL || match_values[i] == 0) {
+				g_debug ("not refining further searches as %s matched on other data",
+					 gs_app_get_unique_id (app));
+				gs_search_session_reset (self);
+				return;
+			}
+		}
+	}
+
+	self->tokens = g_steal_pointer (&tokens);
+}
+
+/**
+ * gs_search_session_refine:
+ * @self: a #GsSearchSession
+ * @text: the new search text
+ *
+ * Try to answer a search for @text from the previous results. This is only
+ * possible if every token of the previous search is a prefix of the token in
+ * the same position in @text, which can have additional tokens, and the
+ * longer token can’t match anything the previous one didn’t (see
+ * gs_search_matcher_keyword_narrows()).
+ *
+ * The match values of the returned apps are updated for @text, and @text is
+ * remembered, so later searches must extend it in turn to be refined.
+ *
+ * Returns: (transfer full) (nullable): the matching apps, which may be empty,
+ *   or %NULL if a full search is needed
+ **/
+GsAppList *
+gs_search_session_refine (GsSearchSession *self,
+			  const gchar     *text)
+{
+	g_auto(GStrv) tokens = NULL;
+	g_autoptr(GsAppList) list = NULL;
+	g_autofree guint16 *match_values = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	g_return_val_if_fail (GS_IS_SEARCH_SESSION (self), NULL);
+
+	if (self->tokens == NULL)
+		return NULL;
+
+	tokens = gs_search_matcher_tokenize (text);
+	if (tokens == NULL || g_strv_length (tokens) < g_strv_length (self->tokens))
+		return NULL;
+	for (guint i = 0; self->tokens[i] != NULL; i++) {
+		if (!gs_search_matcher_keyword_narrows (tokens[i], self->tokens[i]))
+			return NULL;
+	}
+
+	if (self->matcher != NULL) {
+		match_values = gs_search_session_match (self, (const gchar * const *) tokens);
+		if (match_values == NULL)
+			return NULL;
+	}
+
+	list = gs_app_list_new ();
+	for (guint i = 0; match_values != NULL && i < gs_app_list_length (self->candidates); i++) {
+		GsApp *app = gs_app_list_index (self->candidates, i);
+		if (match_values[i] == 0)
+			continue;
+		gs_app_set_match_value (app, match_values[i]);
+		gs_app_list_add (list, app);
+	}
+
+	g_debug ("refined %u results to %u for ‘%s’ in %fms",
+		 gs_app_list_length (self->candidates), gs_app_list_length (list),
+		 text, g_timer_elapsed (timer, NULL) * 1000);
+
+	g_strfreev (self->tokens);
+	self->tokens = g_steal_pointer (&tokens);
+
+	return g_steal_pointer (&list);
+}
+
+static void
+gs_search_session_finalize (GObject *object)
+{
+	GsSearchSession *self = GS_SEARCH_SESSION (object);
+
+	g_strfreev (self->tokens);
+	g_clear_object (&self->candidates);
+	g_clear_pointer (&self->matcher, gs_search_matcher_unref);
+
+	G_OBJECT_CLASS (gs_search_session_parent_class)->finalize (object);
+}
+
+static void
+gs_search_session_class_init (GsSearchSessionClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = gs_search_session_finalize;
+}
+
+static void
+gs_search_session_init (GsSearchSession *self)
+{
+}
+
+/**
+ * gs_search_session_new:
+ *
+ * Create a new #GsSearchSession with no previous results.
+ *
+ * Returns: (transfer full): a new #GsSearchSession
+ **/
+GsSearchSession *
+gs_search_session_new (void)
+{
+	return g_object_new (GS_TYPE_SEARCH_SESSION, NULL);
+}
@@ -0,0 +1,29 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2026 GNOME Software contributors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#include "gnome-software-private.h"
+
+G_BEGIN_DECLS
+
+#define GS_TYPE_SEARCH_SESSION (gs_search_session_get_type ())
+
+G_DECLARE_FINAL_TYPE (GsSearchSession, gs_search_session, GS, SEARCH_SESSION, GObject)
+
+GsSearchSession	*gs_search_session_new			(void);
+void		 gs_search_session_reset		(GsSearchSession	*self);
+void		 gs_search_session_set_results		(GsSearchSession	*self,
+							 const gchar		*text,
+							 GsAppList		*list);
+GsAppList	*gs_search_session_refine		(GsSearchSession	*self,
+							 const gchar		*text);
+
+G_END_DECLS
@@ -10,7 +10,9 @@
 
 #include "gnome-software-private.h"
 
+#include "gs-app-list-model.h"
 #include "gs-css.h"
+#include "gs-search-session.h"
 #include "gs-test.h"
 
 static void
@@ -40,13 +42,161 @@ gs_css_func (void)
 	g_assert_cmpstr (tmp, ==, "color: white;");
 }
 
+static GsApp *
+gs_search_session_test_app_new (const gchar *id,
+				const gchar *name,
+				const gchar *summary)
+{
+	GsApp *app = gs_app_new (id);
+	gs_app_set_name (app, GS_APP_QUALITY_NORMAL, name);
+	gs_app_set_summary (app, GS_APP_QUALITY_NORMAL, summary);
+	return app;
+}
+
+static void
+gs_search_session_func (void)
+{
+	g_autoptr(GsSearchSession) session = gs_search_session_new ();
+	g_autoptr(GsAppList) list = gs_app_list_new ();
+	g_autoptr(GsAppList) refined = NULL;
+	g_autoptr(GsApp) app1 = gs_search_session_test_app_new ("org.mozilla.firefox", "Firefox", "Web Browser");
+	g_autoptr(GsApp) app2 = gs_search_session_test_app_new ("org.example.FireStarter", "Fire Starter", "Lights fires");
+	g_autoptr(GsApp) app3 = gs_search_session_test_app_new ("org.example.Matches", "Matches", "Matched on a keyword");
+
+	/* nothing to refine yet */
+	refined = gs_search_session_refine (session, "fire");
+	g_assert_null (refined);
+
+	gs_app_list_add (list, app1);
+	gs_app_list_add (list, app2);
+	gs_search_session_set_results (session, "fire", list);
+
+	/* extending the token rescores the previous results */
+	refined = gs_search_session_refine (session, "Firef");
+	g_assert_nonnull (refined);
+	g_assert_cmpuint (gs_app_list_length (refined), ==, 1);
+	g_assert_true (gs_app_list_index (refined, 0) == app1);
+	g_assert_cmpuint (gs_app_get_match_value (app1), >, 0);
+	g_clear_object (&refined);
+
+	/* adding a token too */
+	refined = gs_search_session_refine (session, "firefox web");
+	g_assert_nonnull (refined);
+	g_assert_cmpuint (gs_app_list_length (refined), ==, 1);
+	g_clear_object (&refined);
+
+	/* tokens are split like #GsAppQuery:keywords and compared casefolded */
+	refined = gs_search_session_refine (session, " Firefox  WEB ");
+	g_assert_nonnull (refined);
+	g_assert_cmpuint (gs_app_list_length (refined), ==, 1);
+	g_assert_true (gs_app_list_index (refined, 0) == app1);
+	g_clear_object (&refined);
+
+	/* deleting from a token needs a full search */
+	refined = gs_search_session_refine (session, "firefox");
+	g_assert_null (refined);
+	refined = gs_search_session_refine (session, "fire web");
+	g_assert_null (refined);
+
+	/* results which can’t be explained locally aren’t refined */
+	gs_app_list_add (list, app3);
+	gs_search_session_set_results (session, "fire", list);
+	refined = gs_search_session_refine (session, "firef");
+	g_assert_null (refined);
+
+	/* nor are truncated results */
+	gs_app_list_remove (list, app3);
+	gs_app_list_add_flag (list, GS_APP_LIST_FLAG_IS_TRUNCATED);
+	gs_search_session_set_results (session, "fire", list);
+	refined = gs_search_session_refine (session, "firef");
+	g_assert_null (refined);
+}
+
+static void
+gs_app_list_model_items_changed_cb (GListModel *model,
+				    guint       position,
+				    guint       removed,
+				    guint       added,
+				    gpointer    user_data)
+{
+	guint *changed = user_data;
+
+	/* number of changes, and the position of the last one */
+	changed[0]++;
+	changed[1] = position;
+}
+
+static void
+gs_app_list_model_func (void)
+{
+	g_autoptr(GsAppListModel) model = gs_app_list_model_new ();
+	g_autoptr(GsAppList) list = gs_app_list_new ();
+	g_autoptr(GsApp) app1 = gs_app_new ("a.desktop");
+	g_autoptr(GsApp) app2 = gs_app_new ("b.desktop");
+	g_autoptr(GsApp) app3 = gs_app_new ("c.desktop");
+	g_autoptr(GsApp) item = NULL;
+	guint changed[2] = { 0, 0 };
+	guint *n_changed = &changed[0];
+	guint *last_position = &changed[1];
+
+	g_signal_connect (model, "items-changed",
+			  G_CALLBACK (gs_app_list_model_items_changed_cb), changed);
+	g_assert_true (g_list_model_get_item_type (G_LIST_MODEL (model)) == GS_TYPE_APP);
+
+	/* setting a list is one change */
+	gs_app_list_add (list, app1);
+	gs_app_list_add (list, app2);
+	gs_app_list_model_set_list (model, list);
+	g_assert_cmpuint (*n_changed, ==, 1);
+	g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (model)), ==, 2);
+	item = g_list_model_get_item (G_LIST_MODEL (model), 1);
+	g_assert_true (item == app2);
+	g_assert_null (g_list_model_get_item (G_LIST_MODEL (model), 2));
+
+	/* adding and removing */
+	g_assert_false (gs_app_list_model_add (model, app1));
+	g_assert_true (gs_app_list_model_add (model, app3));
+	g_assert_true (gs_app_list_model_contains (model, app3));
+	g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (model)), ==, 3);
+	g_assert_true (gs_app_list_model_remove (model, app1));
+	g_assert_false (gs_app_list_model_remove (model, app1));
+	g_assert_false (gs_app_list_model_contains (model, app1));
+	g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (model)), ==, 2);
+	g_assert_cmpuint (*n_changed, ==, 3);
+
+	/* a state change is an items-changed for the app, so sorters and
+	 * filters are re-evaluated */
+	gs_app_set_state (app2, GS_APP_STATE_INSTALLED);
+	while (g_main_context_iteration (NULL, FALSE));
+	g_assert_cmpuint (*n_changed, ==, 4);
+
+	/* app2 moved to the front when app1 was removed */
+	g_assert_cmpuint (*last_position, ==, 0);
+	gs_app_set_state (app3, GS_APP_STATE_INSTALLED);
+	while (g_main_context_iteration (NULL, FALSE));
+	g_assert_cmpuint (*n_changed, ==, 5);
+	g_assert_cmpuint (*last_position, ==, 1);
+
+	/* but not for apps which have been removed */
+	gs_app_set_state (app1, GS_APP_STATE_INSTALLED);
+	while (g_main_context_iteration (NULL, FALSE));
+	g_assert_cmpuint (*n_changed, ==, 5);
+
+	/* clearing */
+	gs_app_list_model_set_list (model, NULL);
+	g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (model)), ==, 0);
+	g_assert_cmpuint (*n_changed, ==, 6);
+}
+
 int
 main (int argc, char **argv)
 {
 	gs_test_init (&argc, &argv);
 
 	/* tests go here */
+	g_test_add_func ("/gnome-software/src/app-list-model", gs_app_list_model_func);
 	g_test_add_func ("/gnome-software/src/css", gs_css_func);
+	g_test_add_func ("/gnome-software/src/search-session", gs_search_session_func);
 
 	return g_test_run ();
 }
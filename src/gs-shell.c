@@ -92,6 +92,9 @@ struct _GsShell
 	GtkWidget		*details_header;
 	GtkWidget		*updates_paused_banner;
 	GtkWidget		*search_button;
+	GtkWidget		*menu_button;
+	GtkWidget		*view_switcher;
+	GtkWidget		*sidebar_switcher;
 	GtkWidget		*entry_search;
 	GtkWidget		*search_bar;
 	GtkWidget		*button_back;
@@ -102,6 +105,7 @@ struct _GsShell
 	GtkWidget		*sub_page_header_title;
 
 	gboolean		 activate_after_setup;
+	gboolean		 warm_started;
 	gboolean		 is_narrow;
 	gint			 allocation_width;
 	guint			 allocation_changed_cb_id;
@@ -159,12 +163,34 @@ gs_shell_modal_dialog_present (GsShell *shell, GtkWindow *window)
 	gtk_window_present (window);
 }
 
+/* Until the plugin loader is set up, no page can be switched to, so only
+ * the cached apps on the overview page can be shown. */
+static void
+gs_shell_set_interactive (GsShell  *shell,
+			  gboolean  interactive)
+{
+	gtk_widget_set_sensitive (shell->search_button, interactive);
+	gtk_widget_set_sensitive (shell->menu_button, interactive);
+	gtk_widget_set_sensitive (shell->view_switcher, interactive);
+	gtk_widget_set_sensitive (shell->sidebar_switcher, interactive);
+	gtk_search_bar_set_key_capture_widget (GTK_SEARCH_BAR (shell->search_bar),
+					       interactive ? GTK_WIDGET (shell) : NULL);
+}
+
 void
 gs_shell_activate (GsShell *shell)
 {
-	/* Waiting for plugin loader to setup first */
+	/* Waiting for plugin loader to setup first, but show the apps cached
+	 * from last time on the overview page meanwhile, if there are any */
 	if (shell->plugin_loader == NULL) {
 		shell->activate_after_setup = TRUE;
+		if (!shell->warm_started &&
+		    gs_overview_page_get_showing_cached (GS_OVERVIEW_PAGE (shell->pages[GS_SHELL_MODE_OVERVIEW]))) {
+			shell->warm_started = TRUE;
+			gs_shell_set_interactive (shell, FALSE);
+			gtk_widget_set_visible (GTK_WIDGET (shell), TRUE);
+			gtk_window_present (GTK_WINDOW (shell));
+		}
 		return;
 	}
 
@@ -926,6 +952,10 @@ window_keypress_handler (GtkEventControllerKey *key_controller,
 {
 	GdkModifierType modifiers = state & GDK_MODIFIER_MASK;
 
+	/* nothing can be searched until the plugins are set up */
+	if (shell->plugin_loader == NULL)
+		return GDK_EVENT_PROPAGATE;
+
 	/* handle ctrl+f shortcut */
 	if ((modifiers == GDK_CONTROL_MASK && keyval == GDK_KEY_f) ||
 	    (modifiers == (GDK_CONTROL_MASK | GDK_LOCK_MASK) && keyval == GDK_KEY_F)) {
@@ -2227,6 +2257,8 @@ gs_shell_setup (GsShell *shell, GsPluginLoader *plugin_loader, GCancellable *can
 
 	/* set up pages */
 	gs_shell_setup_pages (shell);
+	if (shell->warm_started)
+		gs_shell_set_interactive (shell, TRUE);
 
 	/* set up the metered data info bar and mogwai */
 	g_signal_connect (shell->settings, "changed::download-updates",
@@ -2241,11 +2273,18 @@ gs_shell_setup (GsShell *shell, GsPluginLoader *plugin_loader, GCancellable *can
 	/* primary menu */
 	gs_shell_add_about_menu_item (shell);
 
-	if (g_settings_get_boolean (shell->settings, "download-updates")) {
+	/* the loading page would hide the cached apps which are already shown;
+	 * those are only there if the plugins have loaded metadata before, so
+	 * there is no need to wait for it to be primed */
+	if (g_settings_get_boolean (shell->settings, "download-updates") &&
+	    !shell->warm_started) {
 		/* show loading page, which triggers the initial refresh */
 		gs_shell_change_mode (shell, GS_SHELL_MODE_LOADING, NULL, TRUE);
 	} else {
-		g_debug ("Skipped refresh of the repositories due to 'download-updates' disabled");
+		if (shell->warm_started)
+			g_debug ("Skipped refresh of the repositories as cached results are shown");
+		else
+			g_debug ("Skipped refresh of the repositories due to 'download-updates' disabled");
 		initial_refresh_done (GS_LOADING_PAGE (shell->pages[GS_SHELL_MODE_LOADING]), shell);
 
 		if (g_settings_get_boolean (shell->settings, "first-run"))
@@ -2644,6 +2683,9 @@ gs_shell_class_init (GsShellClass *klass)
 	gtk_widget_class_bind_template_child (widget_class, GsShell, stack_sub);
 	gtk_widget_class_bind_template_child (widget_class, GsShell, updates_paused_banner);
 	gtk_widget_class_bind_template_child (widget_class, GsShell, search_button);
+	gtk_widget_class_bind_template_child (widget_class, GsShell, menu_button);
+	gtk_widget_class_bind_template_child (widget_class, GsShell, view_switcher);
+	gtk_widget_class_bind_template_child (widget_class, GsShell, sidebar_switcher);
 	gtk_widget_class_bind_template_child (widget_class, GsShell, entry_search);
 	gtk_widget_class_bind_template_child (widget_class, GsShell, search_bar);
 	gtk_widget_class_bind_template_child (widget_class, GsShell, button_back);